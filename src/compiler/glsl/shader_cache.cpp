@@ -132,8 +132,12 @@ shader_cache_write_program_metadata(struct gl_context *ctx,
       }
    }
 
-   disk_cache_put(cache, prog->data->sha1, metadata.data, metadata.size,
-                  &cache_item_metadata);
+   /* None of the binaries the driver stores for the program can be used
+    * without this entry, and it's small.
+    */
+   disk_cache_put_with_priority(cache, prog->data->sha1, metadata.data,
+                                metadata.size, &cache_item_metadata,
+                                DISK_CACHE_PRIORITY_HIGH);
 
    if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
       _mesa_sha1_format(sha1_buf, prog->data->sha1);
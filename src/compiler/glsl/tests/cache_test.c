@@ -493,6 +493,112 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+static void
+test_put_limits(void)
+{
+   struct disk_cache *cache;
+   struct disk_cache_stats stats;
+   char blob[] = "This blob is stored without compression";
+   uint8_t blob_key[20];
+   uint8_t *one_MB;
+   uint8_t one_MB_key[20];
+   char *result;
+   size_t size;
+
+   setenv("MESA_GLSL_CACHE_MAX_PENDING_SIZE", "64K", 1);
+   setenv("MESA_GLSL_CACHE_COMPRESSION_LEVEL", "0", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   /* A put larger than the pending limit is dropped. */
+   one_MB = calloc(1024, 1024);
+   disk_cache_compute_key(cache, one_MB, 1024 * 1024, one_MB_key);
+   disk_cache_put(cache, one_MB_key, one_MB, 1024 * 1024, NULL);
+   free(one_MB);
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+
+   disk_cache_wait_for_idle(cache);
+
+   result = disk_cache_get(cache, one_MB_key, &size);
+   expect_null(result, "disk_cache_get of put over the pending limit");
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "disk_cache_get of uncompressed item");
+   expect_equal(size, sizeof(blob), "disk_cache_get of uncompressed item "
+                "(size)");
+   free(result);
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.puts_queued, 1, "stats: queued puts");
+   expect_equal(stats.puts_dropped, 1, "stats: dropped puts");
+   expect_equal(stats.entries_written, 1, "stats: entries written");
+   expect_equal(stats.queue_depth, 0, "stats: queue depth when idle");
+   expect_equal(stats.max_queue_depth, 1, "stats: maximum queue depth");
+   expect_equal(stats.pending_bytes, 0, "stats: pending bytes when idle");
+   expect_true(stats.max_pending_bytes >= sizeof(blob),
+               "stats: maximum pending bytes");
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_GLSL_CACHE_MAX_PENDING_SIZE");
+   unsetenv("MESA_GLSL_CACHE_COMPRESSION_LEVEL");
+}
+
+/* Put size bytes, starting with value, and tell whether they were stored. */
+static bool
+put_and_check(struct disk_cache *cache, size_t size, uint8_t value,
+              enum disk_cache_priority priority)
+{
+   uint8_t *data = calloc(1, size);
+   cache_key key;
+   size_t result_size;
+
+   data[0] = value;
+   disk_cache_compute_key(cache, data, size, key);
+   disk_cache_put_with_priority(cache, key, data, size, NULL, priority);
+   disk_cache_wait_for_idle(cache);
+   free(data);
+
+   void *result = disk_cache_get(cache, key, &result_size);
+   free(result);
+
+   return result != NULL;
+}
+
+static void
+test_put_priorities(void)
+{
+   struct disk_cache *cache;
+   struct disk_cache_stats stats;
+
+   setenv("MESA_GLSL_CACHE_MAX_PENDING_SIZE", "64K", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   /* Low priority puts get half of the pending limit, normal ones three
+    * quarters and high priority ones all of it.
+    */
+   expect_true(!put_and_check(cache, 40 * 1024, 1, DISK_CACHE_PRIORITY_LOW),
+               "low priority put over half of the pending limit");
+   expect_true(put_and_check(cache, 24 * 1024, 2, DISK_CACHE_PRIORITY_LOW),
+               "low priority put under half of the pending limit");
+   expect_true(!put_and_check(cache, 56 * 1024, 3,
+                              DISK_CACHE_PRIORITY_NORMAL),
+               "normal priority put over 3/4 of the pending limit");
+   expect_true(put_and_check(cache, 40 * 1024, 4, DISK_CACHE_PRIORITY_NORMAL),
+               "normal priority put under 3/4 of the pending limit");
+   expect_true(put_and_check(cache, 56 * 1024, 5, DISK_CACHE_PRIORITY_HIGH),
+               "high priority put under the pending limit");
+
+   disk_cache_get_stats(cache, &stats);
+   expect_equal(stats.puts_queued, 3, "stats: queued prioritized puts");
+   expect_equal(stats.puts_dropped, 2, "stats: dropped prioritized puts");
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_GLSL_CACHE_MAX_PENDING_SIZE");
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -507,6 +613,10 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_put_limits();
+
+   test_put_priorities();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
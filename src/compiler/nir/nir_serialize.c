@@ -23,6 +23,7 @@
 
 #include "nir_serialize.h"
 #include "nir_control_flow.h"
+#include "util/swiss_table.h"
 #include "util/u_dynarray.h"
 
 typedef struct {
@@ -37,7 +38,7 @@ typedef struct {
    struct blob *blob;
 
    /* maps pointer to index */
-   struct hash_table *remap_table;
+   struct swiss_table *remap_table;
 
    /* the next index to assign to a NIR in-memory object */
    uintptr_t next_idx;
@@ -71,13 +72,14 @@ static void
 write_add_object(write_ctx *ctx, const void *obj)
 {
    uintptr_t index = ctx->next_idx++;
-   _mesa_hash_table_insert(ctx->remap_table, obj, (void *) index);
+   _mesa_swiss_table_insert(ctx->remap_table, obj, (void *) index);
 }
 
 static uintptr_t
 write_lookup_object(write_ctx *ctx, const void *obj)
 {
-   struct hash_entry *entry = _mesa_hash_table_search(ctx->remap_table, obj);
+   struct hash_entry *entry =
+      _mesa_swiss_table_search_pointer(ctx->remap_table, obj);
    assert(entry);
    return (uintptr_t) entry->data;
 }
@@ -1070,8 +1072,7 @@ void
 nir_serialize(struct blob *blob, const nir_shader *nir)
 {
    write_ctx ctx;
-   ctx.remap_table = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
-                                             _mesa_key_pointer_equal);
+   ctx.remap_table = _mesa_swiss_table_create_pointer(NULL);
    ctx.next_idx = 0;
    ctx.blob = blob;
    ctx.nir = nir;
@@ -1122,7 +1123,7 @@ nir_serialize(struct blob *blob, const nir_shader *nir)
 
    *(uintptr_t *)(blob->data + idx_size_offset) = ctx.next_idx;
 
-   _mesa_hash_table_destroy(ctx.remap_table, NULL);
+   _mesa_swiss_table_destroy(ctx.remap_table, NULL);
    util_dynarray_fini(&ctx.phi_fixups);
 }
 
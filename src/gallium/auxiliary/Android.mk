@@ -66,7 +66,12 @@ $(intermediates)/indices/u_unfilled_gen.c \
 $(intermediates)/util/u_format_srgb.c: $(intermediates)/%.c: $(LOCAL_PATH)/%.py
 	$(transform-generated-source)
 
-$(intermediates)/util/u_format_table.c: $(intermediates)/%.c: $(LOCAL_PATH)/%.py $(LOCAL_PATH)/util/u_format.csv
+$(intermediates)/util/u_format_table.c \
+$(intermediates)/util/u_format_simd.c: $(intermediates)/%.c: $(LOCAL_PATH)/%.py $(LOCAL_PATH)/util/u_format.csv
+	$(transform-generated-source)
+
+$(intermediates)/util/u_format_simd.h: PRIVATE_CUSTOM_TOOL = $(PRIVATE_PYTHON) $^ --header > $@
+$(intermediates)/util/u_format_simd.h: $(LOCAL_PATH)/util/u_format_simd.py $(LOCAL_PATH)/util/u_format.csv
 	$(transform-generated-source)
 
 LOCAL_GENERATED_SOURCES += $(MESA_GEN_NIR_H)
@@ -287,7 +287,9 @@ util_format_read_4f(enum pipe_format format,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   src_row = (const uint8_t *)src + y*src_stride + x*(format_desc->block.bits/8);
+   src_row = (const uint8_t *)src +
+             (y/format_desc->block.height)*src_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    dst_row = dst;
 
    format_desc->unpack_rgba_float(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -309,7 +311,9 @@ util_format_write_4f(enum pipe_format format,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   dst_row = (uint8_t *)dst + y*dst_stride + x*(format_desc->block.bits/8);
+   dst_row = (uint8_t *)dst +
+             (y/format_desc->block.height)*dst_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    src_row = src;
 
    format_desc->pack_rgba_float(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -328,7 +332,9 @@ util_format_read_4ub(enum pipe_format format, uint8_t *dst, unsigned dst_stride,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   src_row = (const uint8_t *)src + y*src_stride + x*(format_desc->block.bits/8);
+   src_row = (const uint8_t *)src +
+             (y/format_desc->block.height)*src_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    dst_row = dst;
 
    format_desc->unpack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -347,7 +353,9 @@ util_format_write_4ub(enum pipe_format format, const uint8_t *src, unsigned src_
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   dst_row = (uint8_t *)dst + y*dst_stride + x*(format_desc->block.bits/8);
+   dst_row = (uint8_t *)dst +
+             (y/format_desc->block.height)*dst_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    src_row = src;
 
    format_desc->pack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -368,7 +376,9 @@ util_format_read_4ui(enum pipe_format format,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   src_row = (const uint8_t *)src + y*src_stride + x*(format_desc->block.bits/8);
+   src_row = (const uint8_t *)src +
+             (y/format_desc->block.height)*src_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    dst_row = dst;
 
    format_desc->unpack_rgba_uint(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -389,7 +399,9 @@ util_format_write_4ui(enum pipe_format format,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   dst_row = (uint8_t *)dst + y*dst_stride + x*(format_desc->block.bits/8);
+   dst_row = (uint8_t *)dst +
+             (y/format_desc->block.height)*dst_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    src_row = src;
 
    format_desc->pack_rgba_uint(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -410,7 +422,9 @@ util_format_read_4i(enum pipe_format format,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   src_row = (const uint8_t *)src + y*src_stride + x*(format_desc->block.bits/8);
+   src_row = (const uint8_t *)src +
+             (y/format_desc->block.height)*src_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    dst_row = dst;
 
    format_desc->unpack_rgba_sint(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -431,7 +445,9 @@ util_format_write_4i(enum pipe_format format,
    assert(x % format_desc->block.width == 0);
    assert(y % format_desc->block.height == 0);
 
-   dst_row = (uint8_t *)dst + y*dst_stride + x*(format_desc->block.bits/8);
+   dst_row = (uint8_t *)dst +
+             (y/format_desc->block.height)*dst_stride +
+             (x/format_desc->block.width)*(format_desc->block.bits/8);
    src_row = src;
 
    format_desc->pack_rgba_sint(dst_row, dst_stride, src_row, src_stride, w, h);
@@ -587,6 +603,172 @@ util_format_fits_8unorm(const struct util_format_description *format_desc)
 }
 
 
+/*
+ * Direct conversions between pairs of formats, which are done in a single
+ * pass over each row instead of unpacking it to a temporary RGBA row and
+ * packing it again.  They must give exactly the same results as the generic
+ * path of util_format_translate().
+ */
+
+static inline uint32_t
+r8g8b8_to_8888(uint32_t rgb, boolean swap_rb, uint32_t alpha)
+{
+   if (swap_rb)
+      rgb = ((rgb & 0xff) << 16) | (rgb & 0xff00) | ((rgb >> 16) & 0xff);
+   return util_cpu_to_le32((rgb & 0xffffff) | alpha);
+}
+
+static inline void
+translate_r8g8b8_unorm_row(void *dst, const void *src, unsigned width,
+                           boolean swap_rb, uint32_t alpha)
+{
+   const uint8_t *s = src;
+   uint32_t *d = dst;
+   unsigned x;
+
+   /* Four pixels are three 32-bit words of source */
+   for (x = 0; x + 4 <= width; x += 4) {
+      uint32_t w[3];
+      memcpy(w, s, sizeof w);
+      w[0] = util_le32_to_cpu(w[0]);
+      w[1] = util_le32_to_cpu(w[1]);
+      w[2] = util_le32_to_cpu(w[2]);
+      d[x + 0] = r8g8b8_to_8888(w[0], swap_rb, alpha);
+      d[x + 1] = r8g8b8_to_8888((w[0] >> 24) | (w[1] << 8), swap_rb, alpha);
+      d[x + 2] = r8g8b8_to_8888((w[1] >> 16) | (w[2] << 16), swap_rb, alpha);
+      d[x + 3] = r8g8b8_to_8888(w[2] >> 8, swap_rb, alpha);
+      s += 12;
+   }
+   for (; x < width; x++) {
+      d[x] = r8g8b8_to_8888(s[0] | (s[1] << 8) | (s[2] << 16), swap_rb, alpha);
+      s += 3;
+   }
+}
+
+static void
+translate_r8g8b8_unorm_to_b8g8r8x8_unorm(void *dst, const void *src,
+                                         unsigned width)
+{
+   translate_r8g8b8_unorm_row(dst, src, width, TRUE, 0);
+}
+
+static void
+translate_r8g8b8_unorm_to_b8g8r8a8_unorm(void *dst, const void *src,
+                                         unsigned width)
+{
+   translate_r8g8b8_unorm_row(dst, src, width, TRUE, 0xff000000);
+}
+
+static void
+translate_r8g8b8_unorm_to_r8g8b8x8_unorm(void *dst, const void *src,
+                                         unsigned width)
+{
+   translate_r8g8b8_unorm_row(dst, src, width, FALSE, 0);
+}
+
+static const struct {
+   enum pipe_format dst_format;
+   enum pipe_format src_format;
+   void (*translate_row)(void *dst, const void *src, unsigned width);
+} direct_translations[] = {
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_R8G8B8_UNORM,
+     translate_r8g8b8_unorm_to_b8g8r8x8_unorm },
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_R8G8B8_UNORM,
+     translate_r8g8b8_unorm_to_b8g8r8a8_unorm },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, PIPE_FORMAT_R8G8B8_UNORM,
+     translate_r8g8b8_unorm_to_r8g8b8x8_unorm },
+};
+
+
+enum direct_translate {
+   DIRECT_NONE,
+   DIRECT_ROW,
+   DIRECT_PACK_RGBA_8UNORM,
+   DIRECT_UNPACK_RGBA_8UNORM,
+   DIRECT_PACK_RGBA_FLOAT,
+   DIRECT_UNPACK_RGBA_FLOAT,
+};
+
+
+static enum direct_translate
+find_direct_translate(const struct util_format_description *dst_format_desc,
+                      const struct util_format_description *src_format_desc,
+                      unsigned *index)
+{
+   unsigned i;
+
+   if (dst_format_desc->block.width != 1 ||
+       dst_format_desc->block.height != 1 ||
+       src_format_desc->block.width != 1 ||
+       src_format_desc->block.height != 1 ||
+       dst_format_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS ||
+       src_format_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS) {
+      return DIRECT_NONE;
+   }
+
+   for (i = 0; i < ARRAY_SIZE(direct_translations); i++) {
+      if (direct_translations[i].dst_format == dst_format_desc->format &&
+          direct_translations[i].src_format == src_format_desc->format) {
+         *index = i;
+         return DIRECT_ROW;
+      }
+   }
+
+   /*
+    * When one of the formats is the intermediate format the generic path
+    * would use, the other one can be packed or unpacked in place.
+    */
+   if (src_format_desc->format == PIPE_FORMAT_R8G8B8A8_UNORM &&
+       dst_format_desc->pack_rgba_8unorm) {
+      return DIRECT_PACK_RGBA_8UNORM;
+   }
+
+   if (dst_format_desc->format == PIPE_FORMAT_R8G8B8A8_UNORM &&
+       src_format_desc->unpack_rgba_8unorm) {
+      return DIRECT_UNPACK_RGBA_8UNORM;
+   }
+
+   if (src_format_desc->format == PIPE_FORMAT_R32G32B32A32_FLOAT &&
+       !util_format_fits_8unorm(dst_format_desc) &&
+       dst_format_desc->pack_rgba_float) {
+      return DIRECT_PACK_RGBA_FLOAT;
+   }
+
+   if (dst_format_desc->format == PIPE_FORMAT_R32G32B32A32_FLOAT &&
+       !util_format_fits_8unorm(src_format_desc) &&
+       src_format_desc->unpack_rgba_float) {
+      return DIRECT_UNPACK_RGBA_FLOAT;
+   }
+
+   return DIRECT_NONE;
+}
+
+
+/**
+ * Whether util_format_translate() converts between the two formats in a
+ * single pass, without an intermediate RGBA row.
+ */
+boolean
+util_format_translate_is_direct(enum pipe_format dst_format,
+                                enum pipe_format src_format)
+{
+   const struct util_format_description *dst_format_desc;
+   const struct util_format_description *src_format_desc;
+   unsigned index;
+
+   dst_format_desc = util_format_description(dst_format);
+   src_format_desc = util_format_description(src_format);
+   if (!dst_format_desc || !src_format_desc)
+      return FALSE;
+
+   if (util_is_format_compatible(src_format_desc, dst_format_desc))
+      return TRUE;
+
+   return find_direct_translate(dst_format_desc, src_format_desc,
+                                &index) != DIRECT_NONE;
+}
+
+
 boolean
 util_format_translate(enum pipe_format dst_format,
                       void *dst, unsigned dst_stride,
@@ -603,6 +785,7 @@ util_format_translate(enum pipe_format dst_format,
    unsigned x_step, y_step;
    unsigned dst_step;
    unsigned src_step;
+   unsigned index;
 
    dst_format_desc = util_format_description(dst_format);
    src_format_desc = util_format_description(src_format);
@@ -639,9 +822,37 @@ util_format_translate(enum pipe_format dst_format,
    dst_step = y_step / dst_format_desc->block.height * dst_stride;
    src_step = y_step / src_format_desc->block.height * src_stride;
 
+   switch (find_direct_translate(dst_format_desc, src_format_desc, &index)) {
+   case DIRECT_ROW:
+      while (height--) {
+         direct_translations[index].translate_row(dst_row, src_row, width);
+         dst_row += dst_stride;
+         src_row += src_stride;
+      }
+      return TRUE;
+   case DIRECT_PACK_RGBA_8UNORM:
+      dst_format_desc->pack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride,
+                                        width, height);
+      return TRUE;
+   case DIRECT_UNPACK_RGBA_8UNORM:
+      src_format_desc->unpack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride,
+                                          width, height);
+      return TRUE;
+   case DIRECT_PACK_RGBA_FLOAT:
+      dst_format_desc->pack_rgba_float(dst_row, dst_stride,
+                                       (const float *)src_row, src_stride,
+                                       width, height);
+      return TRUE;
+   case DIRECT_UNPACK_RGBA_FLOAT:
+      src_format_desc->unpack_rgba_float((float *)dst_row, dst_stride,
+                                         src_row, src_stride, width, height);
+      return TRUE;
+   case DIRECT_NONE:
+      break;
+   }
+
    /*
     * TODO: double formats will loose precision
-    * TODO: Add a special case for formats that are mere swizzles of each other
     */
 
    if (src_format_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS ||
@@ -1223,6 +1223,8 @@ util_format_get_first_non_void_channel(enum pipe_format format)
 
 /*
  * Format access functions.
+ *
+ * x and y are in pixels, and must be aligned to the format's blocks.
  */
 
 void
@@ -1289,6 +1291,10 @@ util_format_translate(enum pipe_format dst_format,
                       unsigned src_x, unsigned src_y,
                       unsigned width, unsigned height);
 
+boolean
+util_format_translate_is_direct(enum pipe_format dst_format,
+                                enum pipe_format src_format);
+
 boolean
 util_format_translate_3d(enum pipe_format dst_format,
                          void *dst, unsigned dst_stride,
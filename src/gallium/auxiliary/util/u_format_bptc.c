@@ -27,6 +27,7 @@
 #include "u_format.h"
 #include "u_format_bptc.h"
 #include "util/format_srgb.h"
+#include "util/texcompress_bcn.h"
 
 #define BPTC_BLOCK_DECODE
 #include "../../../mesa/main/texcompress_bptc_tmp.h"
@@ -46,9 +47,9 @@ util_format_bptc_rgba_unorm_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stri
                                              const uint8_t *src_row, unsigned src_stride,
                                              unsigned width, unsigned height)
 {
-   compress_rgba_unorm(width, height,
-                       src_row, src_stride,
-                       dst_row, dst_stride);
+   util_bcn_compress(UTIL_BCN_BC7, util_bcn_default_quality(),
+                     width, height, src_row, 4, src_stride,
+                     dst_row, dst_stride);
 }
 
 void
@@ -79,9 +80,9 @@ util_format_bptc_rgba_unorm_pack_rgba_float(uint8_t *dst_row, unsigned dst_strid
                         temp_block, width * 4 * sizeof(uint8_t),
                         src_row, src_stride,
                         0, 0, width, height);
-   compress_rgba_unorm(width, height,
-                       temp_block, width * 4 * sizeof(uint8_t),
-                       dst_row, dst_stride);
+   util_bcn_compress(UTIL_BCN_BC7, util_bcn_default_quality(),
+                     width, height, temp_block, 4, width * 4 * sizeof(uint8_t),
+                     dst_row, dst_stride);
    free((void *) temp_block);
 }
 
@@ -115,9 +116,9 @@ util_format_bptc_srgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                                         const uint8_t *src_row, unsigned src_stride,
                                         unsigned width, unsigned height)
 {
-   compress_rgba_unorm(width, height,
-                       src_row, src_stride,
-                       dst_row, dst_stride);
+   util_bcn_compress(UTIL_BCN_BC7, util_bcn_default_quality(),
+                     width, height, src_row, 4, src_stride,
+                     dst_row, dst_stride);
 }
 
 void
@@ -142,10 +143,16 @@ util_format_bptc_srgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
                                        const float *src_row, unsigned src_stride,
                                        unsigned width, unsigned height)
 {
-   compress_rgb_float(width, height,
-                      src_row, src_stride,
-                      dst_row, dst_stride,
-                      true);
+   uint8_t *temp_block;
+   temp_block = malloc(width * height * 4 * sizeof(uint8_t));
+   util_format_write_4f(PIPE_FORMAT_R8G8B8A8_SRGB,
+                        src_row, src_stride,
+                        temp_block, width * 4 * sizeof(uint8_t),
+                        0, 0, width, height);
+   util_bcn_compress(UTIL_BCN_BC7, util_bcn_default_quality(),
+                     width, height, temp_block, 4, width * 4 * sizeof(uint8_t),
+                     dst_row, dst_stride);
+   free((void *) temp_block);
 }
 
 void
@@ -185,9 +192,16 @@ util_format_bptc_rgb_float_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_strid
                                             const uint8_t *src_row, unsigned src_stride,
                                             unsigned width, unsigned height)
 {
-   compress_rgba_unorm(width, height,
+   float *temp_block;
+   temp_block = malloc(width * height * 4 * sizeof(float));
+   util_format_read_4f(PIPE_FORMAT_R8G8B8A8_UNORM,
+                       temp_block, width * 4 * sizeof(float),
                        src_row, src_stride,
-                       dst_row, dst_stride);
+                       0, 0, width, height);
+   util_bcn_compress(UTIL_BCN_BC6H_SFLOAT, util_bcn_default_quality(),
+                     width, height, temp_block, 4, width * 4 * sizeof(float),
+                     dst_row, dst_stride);
+   free((void *) temp_block);
 }
 
 void
@@ -206,10 +220,9 @@ util_format_bptc_rgb_float_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride
                                            const float *src_row, unsigned src_stride,
                                            unsigned width, unsigned height)
 {
-   compress_rgb_float(width, height,
-                      src_row, src_stride,
-                      dst_row, dst_stride,
-                      true);
+   util_bcn_compress(UTIL_BCN_BC6H_SFLOAT, util_bcn_default_quality(),
+                     width, height, src_row, 4, src_stride,
+                     dst_row, dst_stride);
 }
 
 void
@@ -243,9 +256,16 @@ util_format_bptc_rgb_ufloat_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stri
                                              const uint8_t *src_row, unsigned src_stride,
                                              unsigned width, unsigned height)
 {
-   compress_rgba_unorm(width, height,
+   float *temp_block;
+   temp_block = malloc(width * height * 4 * sizeof(float));
+   util_format_read_4f(PIPE_FORMAT_R8G8B8A8_UNORM,
+                       temp_block, width * 4 * sizeof(float),
                        src_row, src_stride,
-                       dst_row, dst_stride);
+                       0, 0, width, height);
+   util_bcn_compress(UTIL_BCN_BC6H_UFLOAT, util_bcn_default_quality(),
+                     width, height, temp_block, 4, width * 4 * sizeof(float),
+                     dst_row, dst_stride);
+   free((void *) temp_block);
 }
 
 void
@@ -264,10 +284,9 @@ util_format_bptc_rgb_ufloat_pack_rgba_float(uint8_t *dst_row, unsigned dst_strid
                                             const float *src_row, unsigned src_stride,
                                             unsigned width, unsigned height)
 {
-   compress_rgb_float(width, height,
-                      src_row, src_stride,
-                      dst_row, dst_stride,
-                      false);
+   util_bcn_compress(UTIL_BCN_BC6H_UFLOAT, util_bcn_default_quality(),
+                     width, height, src_row, 4, src_stride,
+                     dst_row, dst_stride);
 }
 
 void
@@ -28,21 +28,21 @@ void
 util_format_etc1_rgb8_unpack_rgba_float(float *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc1_block block;
+   uint8_t texels[16][4];
    unsigned x, y, i, j;
 
    for (y = 0; y < height; y += bh) {
       const uint8_t *src = src_row;
 
       for (x = 0; x < width; x+= bw) {
-         etc1_parse_block(&block, src);
+         etc1_decode_block(src, texels);
 
          for (j = 0; j < bh; j++) {
             float *dst = dst_row + (y + j) * dst_stride / sizeof(*dst_row) + x * comps;
-            uint8_t tmp[3];
 
             for (i = 0; i < bw; i++) {
-               etc1_fetch_texel(&block, i, j, tmp);
+               const uint8_t *tmp = texels[j * bw + i];
+
                dst[0] = ubyte_to_float(tmp[0]);
                dst[1] = ubyte_to_float(tmp[1]);
                dst[2] = ubyte_to_float(tmp[2]);
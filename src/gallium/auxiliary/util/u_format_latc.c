@@ -32,10 +32,6 @@
 void
 util_format_latc1_unorm_fetch_rgba_8unorm(uint8_t *dst, const uint8_t *src, unsigned i, unsigned j)
 {
-   /* Fix warnings here: */
-   (void) util_format_unsigned_encode_rgtc_ubyte;
-   (void) util_format_signed_encode_rgtc_ubyte;
-
    util_format_unsigned_fetch_texel_rgtc(0, src, i, j, dst, 1);
    dst[1] = dst[0];
    dst[2] = dst[0];
@@ -144,7 +144,10 @@ util_format_r11g11b10_float_unpack_rgba_float(float *dst_row, unsigned dst_strid
    for(y = 0; y < height; y += 1) {
       float *dst = dst_row;
       const uint8_t *src = src_row;
-      for(x = 0; x < width; x += 1) {
+      x = util_format_r11g11b10_float_unpack_rgba_float_simd(dst, src, width);
+      src += x * 4;
+      dst += x * 4;
+      for(; x < width; x += 1) {
          uint32_t value = util_cpu_to_le32(*(const uint32_t *)src);
          r11g11b10f_to_float3(value, dst);
          dst[3] = 1; /* a */
@@ -165,7 +168,10 @@ util_format_r11g11b10_float_pack_rgba_float(uint8_t *dst_row, unsigned dst_strid
    for(y = 0; y < height; y += 1) {
       const float *src = src_row;
       uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += 1) {
+      x = util_format_r11g11b10_float_pack_rgba_float_simd(dst, src, width);
+      src += x * 4;
+      dst += x * 4;
+      for(; x < width; x += 1) {
          uint32_t value = util_cpu_to_le32(float3_to_r11g11b10f(src));
          *(uint32_t *)dst = value;
          src += 4;
@@ -82,6 +82,15 @@ util_format_r11g11b10_float_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stri
                                        const uint8_t *src_row, unsigned src_stride,
                                        unsigned width, unsigned height);
 
+/* Vector row kernels, from the generated u_format_simd.c */
+unsigned
+util_format_r11g11b10_float_unpack_rgba_float_simd(float *dst, const uint8_t *src,
+                                                   unsigned width);
+
+unsigned
+util_format_r11g11b10_float_pack_rgba_float_simd(uint8_t *dst, const float *src,
+                                                 unsigned width);
+
 
 void
 util_format_r1_unorm_unpack_rgba_float(float *dst_row, unsigned dst_stride,
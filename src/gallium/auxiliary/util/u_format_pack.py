@@ -41,6 +41,7 @@ from __future__ import division, print_function
 import sys
 
 from u_format_parse import *
+import u_format_simd
 
 
 if sys.version_info < (3, 0):
@@ -625,6 +626,7 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
     name = format.short_name()
+    simd = u_format_simd.has_kernel(format, 'unpack_' + dst_suffix)
 
     print('static inline void')
     print('util_format_%s_unpack_%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, dst_native_type))
@@ -635,7 +637,13 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      %s *dst = dst_row;' % (dst_native_type))
         print('      const uint8_t *src = src_row;')
-        print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
+        if simd:
+            print('      x = util_format_%s_unpack_%s_simd(dst, src, width);' % (name, dst_suffix))
+            print('      src += x * %u;' % (format.block_size() / 8,))
+            print('      dst += x * 4;')
+            print('      for(; x < width; x += %u) {' % (format.block_width,))
+        else:
+            print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -654,6 +662,7 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
     '''Generate the function to pack pixels to a particular format'''
 
     name = format.short_name()
+    simd = u_format_simd.has_kernel(format, 'pack_' + src_suffix)
 
     print('static inline void')
     print('util_format_%s_pack_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, src_native_type))
@@ -664,7 +673,13 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print('   for(y = 0; y < height; y += %u) {' % (format.block_height,))
         print('      const %s *src = src_row;' % (src_native_type))
         print('      uint8_t *dst = dst_row;')
-        print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
+        if simd:
+            print('      x = util_format_%s_pack_%s_simd(dst, src, width);' % (name, src_suffix))
+            print('      src += x * 4;')
+            print('      dst += x * %u;' % (format.block_size() / 8,))
+            print('      for(; x < width; x += %u) {' % (format.block_width,))
+        else:
+            print('      for(x = 0; x < width; x += %u) {' % (format.block_width,))
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
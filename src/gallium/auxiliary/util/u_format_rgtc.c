@@ -23,10 +23,50 @@
  **************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "u_math.h"
 #include "u_format.h"
 #include "u_format_rgtc.h"
 #include "util/rgtc.h"
+#include "util/texcompress_bcn.h"
+
+/**
+ * Converts the red channel, and the one chan2off components further for
+ * RGTC2, to bytes and compresses them.
+ */
+static void
+rgtc_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
+                     const float *src_row, unsigned src_stride,
+                     unsigned width, unsigned height,
+                     unsigned chan2off, enum util_bcn_format format)
+{
+   const boolean is_signed = format == UTIL_BCN_BC4_SNORM ||
+                             format == UTIL_BCN_BC5_SNORM;
+   const unsigned comps = format == UTIL_BCN_BC4_UNORM ||
+                          format == UTIL_BCN_BC4_SNORM ? 1 : 2;
+   uint8_t *tmp = malloc(width * height * comps);
+   unsigned x, y, c;
+
+   if (!tmp)
+      return;
+
+   for(y = 0; y < height; ++y) {
+      const float *src = src_row + y * src_stride / sizeof(*src_row);
+      uint8_t *dst = tmp + y * width * comps;
+      for(x = 0; x < width; ++x) {
+         for(c = 0; c < comps; ++c) {
+            const float value = src[x * 4 + c * chan2off];
+            dst[x * comps + c] = is_signed ? (uint8_t) float_to_byte_tex(value)
+                                           : float_to_ubyte(value);
+         }
+      }
+   }
+
+   util_bcn_compress(format, util_bcn_default_quality(), width, height,
+                     tmp, comps, width * comps, dst_row, dst_stride);
+
+   free(tmp);
+}
 
 void
 util_format_rgtc1_unorm_fetch_rgba_8unorm(uint8_t *dst, const uint8_t *src, unsigned i, unsigned j)
@@ -66,23 +106,9 @@ void
 util_format_rgtc1_unorm_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, 
 					 unsigned src_stride, unsigned width, unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bytes_per_block = 8;
-   unsigned x, y, i, j;
-
-   for(y = 0; y < height; y += bh) {
-      uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += bw) {
-         uint8_t tmp[4][4];  /* [bh][bw][comps] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-	       tmp[j][i] = src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4];
-            }
-         }
-         util_format_unsigned_encode_rgtc_ubyte(dst, tmp, 4, 4);
-         dst += bytes_per_block;
-      }
-      dst_row += dst_stride / sizeof(*dst_row);
-   }
+   util_bcn_compress(UTIL_BCN_BC4_UNORM, util_bcn_default_quality(),
+                     width, height, src_row, 4, src_stride,
+                     dst_row, dst_stride);
 }
 
 void
@@ -113,23 +139,8 @@ util_format_rgtc1_unorm_unpack_rgba_float(float *dst_row, unsigned dst_stride, c
 void
 util_format_rgtc1_unorm_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bytes_per_block = 8;
-   unsigned x, y, i, j;
-
-   for(y = 0; y < height; y += bh) {
-      uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += bw) {
-         uint8_t tmp[4][4];  /* [bh][bw][comps] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-	       tmp[j][i] = float_to_ubyte(src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4]);
-            }
-         }
-         util_format_unsigned_encode_rgtc_ubyte(dst, tmp, 4, 4);
-         dst += bytes_per_block;
-      }
-      dst_row += dst_stride / sizeof(*dst_row);
-   }
+   rgtc_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
+                        width, height, 0, UTIL_BCN_BC4_UNORM);
 }
 
 void
@@ -169,23 +180,8 @@ util_format_rgtc1_snorm_pack_rgba_8unorm(UNUSED uint8_t *dst_row, UNUSED unsigne
 void
 util_format_rgtc1_snorm_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bytes_per_block = 8;
-   unsigned x, y, i, j;
-
-   for(y = 0; y < height; y += bh) {
-      int8_t *dst = (int8_t *)dst_row;
-      for(x = 0; x < width; x += bw) {
-         int8_t tmp[4][4];  /* [bh][bw][comps] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-	       tmp[j][i] = float_to_byte_tex(src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4]);
-            }
-         }
-         util_format_signed_encode_rgtc_ubyte(dst, tmp, 4, 4);
-         dst += bytes_per_block;
-      }
-      dst_row += dst_stride / sizeof(*dst_row);
-   }
+   rgtc_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
+                        width, height, 0, UTIL_BCN_BC4_SNORM);
 }
 
 void
@@ -262,51 +258,16 @@ util_format_rgtc2_unorm_unpack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride
 void
 util_format_rgtc2_unorm_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
-   const unsigned bw = 4, bh = 4, bytes_per_block = 16;
-   unsigned x, y, i, j;
-
-   for(y = 0; y < height; y += bh) {
-      uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += bw) {
-         uint8_t tmp_r[4][4];  /* [bh][bw] */
-         uint8_t tmp_g[4][4];  /* [bh][bw] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-	       tmp_r[j][i] = src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4];
-	       tmp_g[j][i] = src_row[((y + j)*src_stride/sizeof(*src_row) + (x + i)*4) + 1];
-            }
-         }
-         util_format_unsigned_encode_rgtc_ubyte(dst, tmp_r, 4, 4);
-         util_format_unsigned_encode_rgtc_ubyte(dst + 8, tmp_g, 4, 4);
-         dst += bytes_per_block;
-      }
-      dst_row += dst_stride / sizeof(*dst_row);
-   }
+   util_bcn_compress(UTIL_BCN_BC5_UNORM, util_bcn_default_quality(),
+                     width, height, src_row, 4, src_stride,
+                     dst_row, dst_stride);
 }
 
 void
 util_format_rxtc2_unorm_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height, unsigned chan2off)
 {
-   const unsigned bw = 4, bh = 4, bytes_per_block = 16;
-   unsigned x, y, i, j;
-
-   for(y = 0; y < height; y += bh) {
-      uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += bw) {
-         uint8_t tmp_r[4][4];  /* [bh][bw][comps] */
-         uint8_t tmp_g[4][4];  /* [bh][bw][comps] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-	       tmp_r[j][i] = float_to_ubyte(src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4]);
-               tmp_g[j][i] = float_to_ubyte(src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4 + chan2off]);
-            }
-         }
-         util_format_unsigned_encode_rgtc_ubyte(dst, tmp_r, 4, 4);
-         util_format_unsigned_encode_rgtc_ubyte(dst + 8, tmp_g, 4, 4);
-         dst += bytes_per_block;
-      }
-      dst_row += dst_stride / sizeof(*dst_row);
-   }
+   rgtc_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
+                        width, height, chan2off, UTIL_BCN_BC5_UNORM);
 }
 
 void
@@ -406,26 +367,8 @@ util_format_rgtc2_snorm_unpack_rgba_float(float *dst_row, unsigned dst_stride, c
 void
 util_format_rxtc2_snorm_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height, unsigned chan2off)
 {
-   const unsigned bw = 4, bh = 4, bytes_per_block = 16;
-   unsigned x, y, i, j;
-
-   for(y = 0; y < height; y += bh) {
-      int8_t *dst = (int8_t *)dst_row;
-      for(x = 0; x < width; x += bw) {
-         int8_t tmp_r[4][4];  /* [bh][bw][comps] */
-         int8_t tmp_g[4][4];  /* [bh][bw][comps] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-	       tmp_r[j][i] = float_to_byte_tex(src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4]);
-               tmp_g[j][i] = float_to_byte_tex(src_row[(y + j)*src_stride/sizeof(*src_row) + (x + i)*4 + chan2off]);
-            }
-         }
-         util_format_signed_encode_rgtc_ubyte(dst, tmp_r, 4, 4);
-         util_format_signed_encode_rgtc_ubyte(dst + 8, tmp_g, 4, 4);
-         dst += bytes_per_block;
-      }
-      dst_row += dst_stride / sizeof(*dst_row);
-   }
+   rgtc_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
+                        width, height, chan2off, UTIL_BCN_BC5_SNORM);
 }
 
 void
@@ -28,6 +28,7 @@
 #include "u_format.h"
 #include "u_format_s3tc.h"
 #include "util/format_srgb.h"
+#include "util/texcompress_bcn.h"
 #include "../../../mesa/main/texcompress_s3tc_tmp.h"
 
 
@@ -36,7 +37,6 @@ util_format_dxtn_fetch_t util_format_dxt1_rgba_fetch = (util_format_dxtn_fetch_t
 util_format_dxtn_fetch_t util_format_dxt3_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt3;
 util_format_dxtn_fetch_t util_format_dxt5_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt5;
 
-util_format_dxtn_pack_t util_format_dxtn_pack = (util_format_dxtn_pack_t)tx_compress_dxtn;
 
 
 /*
@@ -285,38 +285,35 @@ static inline void
 util_format_dxtn_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                                   const uint8_t *src, unsigned src_stride,
                                   unsigned width, unsigned height,
-                                  enum util_format_dxtn format,
-                                  unsigned block_size, boolean srgb)
-{
-   const unsigned bw = 4, bh = 4, comps = 4;
-   unsigned x, y, i, j, k;
-   for(y = 0; y < height; y += bh) {
-      uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += bw) {
-         uint8_t tmp[4][4][4];  /* [bh][bw][comps] */
-         for(j = 0; j < bh; ++j) {
-            for(i = 0; i < bw; ++i) {
-               uint8_t src_tmp;
-               for(k = 0; k < 3; ++k) {
-                  src_tmp = src[(y + j)*src_stride/sizeof(*src) + (x+i)*comps + k];
-                  if (srgb) {
-                     tmp[j][i][k] = util_format_linear_to_srgb_8unorm(src_tmp);
-                  }
-                  else {
-                     tmp[j][i][k] = src_tmp;
-                  }
-               }
-               /* for sake of simplicity there's an unneeded 4th component for dxt1_rgb */
-               tmp[j][i][3] = src[(y + j)*src_stride/sizeof(*src) + (x+i)*comps + 3];
-            }
+                                  enum util_bcn_format format, boolean srgb)
+{
+   uint8_t *tmp = NULL;
+   unsigned x, y;
+
+   if (srgb) {
+      tmp = malloc(width * height * 4);
+      if (!tmp)
+         return;
+      for(y = 0; y < height; ++y) {
+         const uint8_t *src_pixel = src + y * src_stride;
+         uint8_t *tmp_pixel = tmp + y * width * 4;
+         for(x = 0; x < width; ++x) {
+            tmp_pixel[0] = util_format_linear_to_srgb_8unorm(src_pixel[0]);
+            tmp_pixel[1] = util_format_linear_to_srgb_8unorm(src_pixel[1]);
+            tmp_pixel[2] = util_format_linear_to_srgb_8unorm(src_pixel[2]);
+            tmp_pixel[3] = src_pixel[3];
+            src_pixel += 4;
+            tmp_pixel += 4;
          }
-         /* even for dxt1_rgb have 4 src comps */
-         util_format_dxtn_pack(4, 4, 4, &tmp[0][0][0], format, dst, 0);
-         dst += block_size;
       }
-      dst_row += dst_stride / sizeof(*dst_row);
+      src = tmp;
+      src_stride = width * 4;
    }
 
+   util_bcn_compress(format, util_bcn_default_quality(), width, height,
+                     src, 4, src_stride, dst_row, dst_stride);
+
+   free(tmp);
 }
 
 void
@@ -325,8 +322,8 @@ util_format_dxt1_rgb_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                                       unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src, src_stride,
-                                     width, height, UTIL_FORMAT_DXT1_RGB,
-                                     8, FALSE);
+                                     width, height, UTIL_BCN_BC1_RGB,
+                                     FALSE);
 }
 
 void
@@ -335,8 +332,8 @@ util_format_dxt1_rgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                                        unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src, src_stride,
-                                     width, height, UTIL_FORMAT_DXT1_RGBA,
-                                     8, FALSE);
+                                     width, height, UTIL_BCN_BC1_RGBA,
+                                     FALSE);
 }
 
 void
@@ -345,8 +342,8 @@ util_format_dxt3_rgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                                        unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src, src_stride,
-                                     width, height, UTIL_FORMAT_DXT3_RGBA,
-                                     16, FALSE);
+                                     width, height, UTIL_BCN_BC2,
+                                     FALSE);
 }
 
 void
@@ -355,44 +352,46 @@ util_format_dxt5_rgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                                        unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src, src_stride,
-                                     width, height, UTIL_FORMAT_DXT5_RGBA,
-                                     16, FALSE);
+                                     width, height, UTIL_BCN_BC3,
+                                     FALSE);
 }
 
 static inline void
 util_format_dxtn_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
                                  const float *src, unsigned src_stride,
                                  unsigned width, unsigned height,
-                                 enum util_format_dxtn format,
-                                 unsigned block_size, boolean srgb)
-{
-   unsigned x, y, i, j, k;
-   for(y = 0; y < height; y += 4) {
-      uint8_t *dst = dst_row;
-      for(x = 0; x < width; x += 4) {
-         uint8_t tmp[4][4][4];
-         for(j = 0; j < 4; ++j) {
-            for(i = 0; i < 4; ++i) {
-               float src_tmp;
-               for(k = 0; k < 3; ++k) {
-                  src_tmp = src[(y + j)*src_stride/sizeof(*src) + (x+i)*4 + k];
-                  if (srgb) {
-                     tmp[j][i][k] = util_format_linear_float_to_srgb_8unorm(src_tmp);
-                  }
-                  else {
-                     tmp[j][i][k] = float_to_ubyte(src_tmp);
-                  }
-               }
-               /* for sake of simplicity there's an unneeded 4th component for dxt1_rgb */
-               src_tmp = src[(y + j)*src_stride/sizeof(*src) + (x+i)*4 + 3];
-               tmp[j][i][3] = float_to_ubyte(src_tmp);
-            }
+                                 enum util_bcn_format format, boolean srgb)
+{
+   uint8_t *tmp = malloc(width * height * 4);
+   unsigned x, y;
+
+   if (!tmp)
+      return;
+
+   for(y = 0; y < height; ++y) {
+      const float *src_pixel = src + y * src_stride / sizeof(*src);
+      uint8_t *tmp_pixel = tmp + y * width * 4;
+      for(x = 0; x < width; ++x) {
+         if (srgb) {
+            tmp_pixel[0] = util_format_linear_float_to_srgb_8unorm(src_pixel[0]);
+            tmp_pixel[1] = util_format_linear_float_to_srgb_8unorm(src_pixel[1]);
+            tmp_pixel[2] = util_format_linear_float_to_srgb_8unorm(src_pixel[2]);
+         }
+         else {
+            tmp_pixel[0] = float_to_ubyte(src_pixel[0]);
+            tmp_pixel[1] = float_to_ubyte(src_pixel[1]);
+            tmp_pixel[2] = float_to_ubyte(src_pixel[2]);
          }
-         util_format_dxtn_pack(4, 4, 4, &tmp[0][0][0], format, dst, 0);
-         dst += block_size;
+         tmp_pixel[3] = float_to_ubyte(src_pixel[3]);
+         src_pixel += 4;
+         tmp_pixel += 4;
       }
-      dst_row += 4*dst_stride/sizeof(*dst_row);
    }
+
+   util_bcn_compress(format, util_bcn_default_quality(), width, height,
+                     tmp, 4, width * 4, dst_row, dst_stride);
+
+   free(tmp);
 }
 
 void
@@ -401,8 +400,8 @@ util_format_dxt1_rgb_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
                                      unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src, src_stride,
-                                    width, height, UTIL_FORMAT_DXT1_RGB,
-                                    8, FALSE);
+                                    width, height, UTIL_BCN_BC1_RGB,
+                                    FALSE);
 }
 
 void
@@ -411,8 +410,8 @@ util_format_dxt1_rgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
                                       unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src, src_stride,
-                                    width, height, UTIL_FORMAT_DXT1_RGBA,
-                                    8, FALSE);
+                                    width, height, UTIL_BCN_BC1_RGBA,
+                                    FALSE);
 }
 
 void
@@ -421,8 +420,8 @@ util_format_dxt3_rgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
                                       unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src, src_stride,
-                                    width, height, UTIL_FORMAT_DXT3_RGBA,
-                                    16, FALSE);
+                                    width, height, UTIL_BCN_BC2,
+                                    FALSE);
 }
 
 void
@@ -431,8 +430,8 @@ util_format_dxt5_rgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride,
                                       unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src, src_stride,
-                                    width, height, UTIL_FORMAT_DXT5_RGBA,
-                                    16, FALSE);
+                                    width, height, UTIL_BCN_BC3,
+                                    FALSE);
 }
 
 
@@ -612,63 +611,63 @@ void
 util_format_dxt1_srgb_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride,
-                                     width, height, UTIL_FORMAT_DXT1_RGB,
-                                     8, TRUE);
+                                     width, height, UTIL_BCN_BC1_RGB,
+                                     TRUE);
 }
 
 void
 util_format_dxt1_srgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride,
-                                     width, height, UTIL_FORMAT_DXT1_RGBA,
-                                     8, TRUE);
+                                     width, height, UTIL_BCN_BC1_RGBA,
+                                     TRUE);
 }
 
 void
 util_format_dxt3_srgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride,
-                                     width, height, UTIL_FORMAT_DXT3_RGBA,
-                                     16, TRUE);
+                                     width, height, UTIL_BCN_BC2,
+                                     TRUE);
 }
 
 void
 util_format_dxt5_srgba_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_8unorm(dst_row, dst_stride, src_row, src_stride,
-                                     width, height, UTIL_FORMAT_DXT5_RGBA,
-                                     16, TRUE);
+                                     width, height, UTIL_BCN_BC3,
+                                     TRUE);
 }
 
 void
 util_format_dxt1_srgb_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
-                                    width, height, UTIL_FORMAT_DXT1_RGB,
-                                    8, TRUE);
+                                    width, height, UTIL_BCN_BC1_RGB,
+                                    TRUE);
 }
 
 void
 util_format_dxt1_srgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
-                                    width, height, UTIL_FORMAT_DXT1_RGBA,
-                                    8, TRUE);
+                                    width, height, UTIL_BCN_BC1_RGBA,
+                                    TRUE);
 }
 
 void
 util_format_dxt3_srgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
-                                    width, height, UTIL_FORMAT_DXT3_RGBA,
-                                    16, TRUE);
+                                    width, height, UTIL_BCN_BC2,
+                                    TRUE);
 }
 
 void
 util_format_dxt5_srgba_pack_rgba_float(uint8_t *dst_row, unsigned dst_stride, const float *src_row, unsigned src_stride, unsigned width, unsigned height)
 {
    util_format_dxtn_pack_rgba_float(dst_row, dst_stride, src_row, src_stride,
-                                    width, height, UTIL_FORMAT_DXT5_RGBA,
-                                    16, TRUE);
+                                    width, height, UTIL_BCN_BC3,
+                                    TRUE);
 }
 
@@ -0,0 +1,822 @@
+from __future__ import division, print_function
+
+CopyRight = '''
+/**************************************************************************
+ *
+ * Copyright 2018 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+'''
+
+'''
+Vectorized row kernels for the pack/unpack functions of the most common
+formats.
+
+The kernels convert as many whole vectors of pixels of a row as they can and
+return how many pixels they did; the scalar functions generated by
+u_format_pack.py take care of the rest.  They must give exactly the same
+results as the scalar code, so every conversion below mirrors the expression
+conversion_expr() generates for it.
+
+The same kernels are emitted for SSE2 and, with --avx2, for AVX2.  The SSE2
+file also holds the util_format_*_simd() entry points, which pick the AVX2
+kernels at runtime when the CPU supports them.  With --header, the prototypes
+of the entry points and of the AVX2 kernels are emitted instead.
+'''
+
+
+import sys
+
+from u_format_parse import *
+
+
+# Formats with vector kernels.
+simd_formats = [
+    'PIPE_FORMAT_B8G8R8A8_UNORM',
+    'PIPE_FORMAT_B8G8R8X8_UNORM',
+    'PIPE_FORMAT_R8G8B8A8_UNORM',
+    'PIPE_FORMAT_R8G8B8X8_UNORM',
+    'PIPE_FORMAT_B5G6R5_UNORM',
+    'PIPE_FORMAT_R10G10B10A2_UNORM',
+    'PIPE_FORMAT_B10G10R10A2_UNORM',
+    'PIPE_FORMAT_B8G8R8A8_SRGB',
+    'PIPE_FORMAT_R8G8B8A8_SRGB',
+    'PIPE_FORMAT_R16G16B16A16_FLOAT',
+    'PIPE_FORMAT_R11G11B10_FLOAT',
+]
+
+
+def is_unorm_bitmask(format):
+    if not format.is_bitmask() or format.block_size() not in (16, 32):
+        return False
+    for channel in format.le_channels:
+        if channel.type == VOID:
+            continue
+        if channel.type != UNSIGNED or not channel.norm:
+            return False
+    return True
+
+
+def is_half_array(format):
+    if not format.is_array() or format.nr_channels() != 4:
+        return False
+    channel = format.array_element()
+    if channel.type != FLOAT or channel.size != 16:
+        return False
+    return format.le_swizzles == [SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Z, SWIZZLE_W]
+
+
+def kernel_names(format):
+    '''The pack/unpack functions of a format that have a vector kernel.'''
+
+    if format.name not in simd_formats:
+        return []
+
+    if format.name == 'PIPE_FORMAT_R11G11B10_FLOAT':
+        return ['unpack_rgba_float', 'pack_rgba_float']
+
+    if is_half_array(format):
+        return ['unpack_rgba_float', 'pack_rgba_float',
+                'unpack_rgba_8unorm', 'pack_rgba_8unorm']
+
+    assert is_unorm_bitmask(format)
+    if format.colorspace == SRGB:
+        # The sRGB <-> 8unorm conversions are byte table lookups
+        return ['unpack_rgba_float', 'pack_rgba_float']
+
+    return ['unpack_rgba_float', 'pack_rgba_float',
+            'unpack_rgba_8unorm', 'pack_rgba_8unorm']
+
+
+def has_kernel(format, name):
+    return name in kernel_names(format)
+
+
+def kernel_prototype(format, name, suffix):
+    if name == 'unpack_rgba_float':
+        args = 'float *dst, const uint8_t *src, unsigned width'
+    elif name == 'pack_rgba_float':
+        args = 'uint8_t *dst, const float *src, unsigned width'
+    else:
+        args = 'uint8_t *dst, const uint8_t *src, unsigned width'
+    return 'unsigned\nutil_format_%s_%s_%s(%s)' % (format.short_name(), name, suffix, args)
+
+
+sse2_helpers = '''
+#include <emmintrin.h>
+
+#define VEC_WIDTH 4
+
+typedef __m128i vec_i;
+typedef __m128 vec_f;
+
+#define vi_set1(x)         _mm_set1_epi32(x)
+#define vi_and(a, b)       _mm_and_si128(a, b)
+#define vi_andnot(a, b)    _mm_andnot_si128(a, b)
+#define vi_or(a, b)        _mm_or_si128(a, b)
+#define vi_add(a, b)       _mm_add_epi32(a, b)
+#define vi_sub(a, b)       _mm_sub_epi32(a, b)
+#define vi_sll(a, n)       _mm_slli_epi32(a, n)
+#define vi_srl(a, n)       _mm_srli_epi32(a, n)
+#define vi_cmpeq(a, b)     _mm_cmpeq_epi32(a, b)
+#define vi_cmpgt(a, b)     _mm_cmpgt_epi32(a, b)
+#define vi_madd16(a, b)    _mm_madd_epi16(a, b)
+#define vi_loadu(p)        _mm_loadu_si128((const __m128i *)(p))
+#define vi_storeu(p, a)    _mm_storeu_si128((__m128i *)(p), a)
+#define vi_as_f(a)         _mm_castsi128_ps(a)
+
+#define vf_set1(x)         _mm_set1_ps(x)
+#define vf_add(a, b)       _mm_add_ps(a, b)
+#define vf_mul(a, b)       _mm_mul_ps(a, b)
+#define vf_min(a, b)       _mm_min_ps(a, b)
+#define vf_max(a, b)       _mm_max_ps(a, b)
+#define vf_cmpge(a, b)     _mm_cmpge_ps(a, b)
+#define vf_from_i(a)       _mm_cvtepi32_ps(a)
+#define vf_to_i_trunc(a)   _mm_cvttps_epi32(a)
+#define vf_loadu(p)        _mm_loadu_ps(p)
+#define vf_storeu(p, a)    _mm_storeu_ps(p, a)
+#define vf_as_i(a)         _mm_castps_si128(a)
+
+static inline vec_i
+vi_mullo(vec_i a, vec_i b)
+{
+   const vec_i even = _mm_mul_epu32(a, b);
+   const vec_i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+   return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                             _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* Loads VEC_WIDTH 16-bit values, zero extended. */
+static inline vec_i
+vi_load_u16(const void *src)
+{
+   return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)src),
+                             _mm_setzero_si128());
+}
+
+/* Stores the low 16 bits of each lane. */
+static inline void
+vi_store_u16(void *dst, vec_i a)
+{
+   a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+   _mm_storel_epi64((__m128i *)dst, _mm_packs_epi32(a, a));
+}
+
+static inline vec_i
+vi_load_u8(const void *src)
+{
+   int32_t bytes;
+   memcpy(&bytes, src, sizeof bytes);
+   return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes),
+                                                _mm_setzero_si128()),
+                             _mm_setzero_si128());
+}
+
+/* Stores lanes which are known to be in [0, 255]. */
+static inline void
+vi_store_u8(void *dst, vec_i a)
+{
+   a = _mm_packs_epi32(a, a);
+   int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(a, a));
+   memcpy(dst, &bytes, sizeof bytes);
+}
+
+static inline vec_f
+vf_lookup(const float *table, vec_i index)
+{
+   uint32_t i[VEC_WIDTH];
+   vi_storeu(i, index);
+   return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+static inline vec_i
+vi_lookup(const unsigned *table, vec_i index)
+{
+   uint32_t i[VEC_WIDTH];
+   vi_storeu(i, index);
+   return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+/* Stores VEC_WIDTH pixels given as one vector per channel. */
+static inline void
+vf_store_rgba(float *dst, vec_f r, vec_f g, vec_f b, vec_f a)
+{
+   _MM_TRANSPOSE4_PS(r, g, b, a);
+   _mm_storeu_ps(dst + 0, r);
+   _mm_storeu_ps(dst + 4, g);
+   _mm_storeu_ps(dst + 8, b);
+   _mm_storeu_ps(dst + 12, a);
+}
+
+static inline void
+vf_load_rgba(const float *src, vec_f *r, vec_f *g, vec_f *b, vec_f *a)
+{
+   vec_f p0 = _mm_loadu_ps(src + 0);
+   vec_f p1 = _mm_loadu_ps(src + 4);
+   vec_f p2 = _mm_loadu_ps(src + 8);
+   vec_f p3 = _mm_loadu_ps(src + 12);
+   _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+   *r = p0;
+   *g = p1;
+   *b = p2;
+   *a = p3;
+}
+'''
+
+
+avx2_helpers = '''
+#include <immintrin.h>
+
+#define VEC_WIDTH 8
+
+typedef __m256i vec_i;
+typedef __m256 vec_f;
+
+#define vi_set1(x)         _mm256_set1_epi32(x)
+#define vi_and(a, b)       _mm256_and_si256(a, b)
+#define vi_andnot(a, b)    _mm256_andnot_si256(a, b)
+#define vi_or(a, b)        _mm256_or_si256(a, b)
+#define vi_add(a, b)       _mm256_add_epi32(a, b)
+#define vi_sub(a, b)       _mm256_sub_epi32(a, b)
+#define vi_sll(a, n)       _mm256_slli_epi32(a, n)
+#define vi_srl(a, n)       _mm256_srli_epi32(a, n)
+#define vi_cmpeq(a, b)     _mm256_cmpeq_epi32(a, b)
+#define vi_cmpgt(a, b)     _mm256_cmpgt_epi32(a, b)
+#define vi_madd16(a, b)    _mm256_madd_epi16(a, b)
+#define vi_mullo(a, b)     _mm256_mullo_epi32(a, b)
+#define vi_loadu(p)        _mm256_loadu_si256((const __m256i *)(p))
+#define vi_storeu(p, a)    _mm256_storeu_si256((__m256i *)(p), a)
+#define vi_as_f(a)         _mm256_castsi256_ps(a)
+
+#define vf_set1(x)         _mm256_set1_ps(x)
+#define vf_add(a, b)       _mm256_add_ps(a, b)
+#define vf_mul(a, b)       _mm256_mul_ps(a, b)
+#define vf_min(a, b)       _mm256_min_ps(a, b)
+#define vf_max(a, b)       _mm256_max_ps(a, b)
+#define vf_cmpge(a, b)     _mm256_cmp_ps(a, b, _CMP_GE_OS)
+#define vf_from_i(a)       _mm256_cvtepi32_ps(a)
+#define vf_to_i_trunc(a)   _mm256_cvttps_epi32(a)
+#define vf_loadu(p)        _mm256_loadu_ps(p)
+#define vf_storeu(p, a)    _mm256_storeu_ps(p, a)
+#define vf_as_i(a)         _mm256_castps_si256(a)
+
+#define vf_lookup(table, index) _mm256_i32gather_ps(table, index, 4)
+#define vi_lookup(table, index) _mm256_i32gather_epi32((const int *)(table), index, 4)
+
+/* Loads VEC_WIDTH 16-bit values, zero extended. */
+static inline vec_i
+vi_load_u16(const void *src)
+{
+   return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)src));
+}
+
+/* Stores the low 16 bits of each lane. */
+static inline void
+vi_store_u16(void *dst, vec_i a)
+{
+   a = _mm256_and_si256(a, _mm256_set1_epi32(0xffff));
+   a = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, a),
+                                _MM_SHUFFLE(3, 1, 2, 0));
+   _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(a));
+}
+
+static inline vec_i
+vi_load_u8(const void *src)
+{
+   return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+}
+
+/* Stores lanes which are known to be in [0, 255]. */
+static inline void
+vi_store_u8(void *dst, vec_i a)
+{
+   a = _mm256_packs_epi32(a, a);
+   a = _mm256_packus_epi16(a, a);
+   a = _mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4));
+   _mm_storel_epi64((__m128i *)dst, _mm256_castsi256_si128(a));
+}
+
+/* Transposes the 4x4 blocks in each 128-bit half. */
+static inline void
+vf_transpose4(vec_f *a, vec_f *b, vec_f *c, vec_f *d)
+{
+   const vec_f t0 = _mm256_unpacklo_ps(*a, *b);
+   const vec_f t1 = _mm256_unpacklo_ps(*c, *d);
+   const vec_f t2 = _mm256_unpackhi_ps(*a, *b);
+   const vec_f t3 = _mm256_unpackhi_ps(*c, *d);
+   *a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+   *b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+   *c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+   *d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+/* Stores VEC_WIDTH pixels given as one vector per channel. */
+static inline void
+vf_store_rgba(float *dst, vec_f r, vec_f g, vec_f b, vec_f a)
+{
+   /* Pixels 0-3 in the low halves, 4-7 in the high ones */
+   vf_transpose4(&r, &g, &b, &a);
+   _mm256_storeu_ps(dst + 0, _mm256_permute2f128_ps(r, g, 0x20));
+   _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(b, a, 0x20));
+   _mm256_storeu_ps(dst + 16, _mm256_permute2f128_ps(r, g, 0x31));
+   _mm256_storeu_ps(dst + 24, _mm256_permute2f128_ps(b, a, 0x31));
+}
+
+static inline void
+vf_load_rgba(const float *src, vec_f *r, vec_f *g, vec_f *b, vec_f *a)
+{
+   const vec_f p01 = _mm256_loadu_ps(src + 0);
+   const vec_f p23 = _mm256_loadu_ps(src + 8);
+   const vec_f p45 = _mm256_loadu_ps(src + 16);
+   const vec_f p67 = _mm256_loadu_ps(src + 24);
+   *r = _mm256_permute2f128_ps(p01, p45, 0x20);
+   *g = _mm256_permute2f128_ps(p01, p45, 0x31);
+   *b = _mm256_permute2f128_ps(p23, p67, 0x20);
+   *a = _mm256_permute2f128_ps(p23, p67, 0x31);
+   vf_transpose4(r, g, b, a);
+}
+'''
+
+
+conversion_helpers = '''
+static inline vec_i
+vi_select(vec_i mask, vec_i a, vec_i b)
+{
+   return vi_or(vi_and(mask, a), vi_andnot(mask, b));
+}
+
+/* float_to_ubyte() */
+static inline vec_i
+float_to_ubyte_vec(vec_f f)
+{
+   /* max() returns its second operand for NaNs */
+   f = vf_min(vf_max(f, vf_set1(0.0f)), vf_set1(1.0f));
+   f = vf_add(vf_mul(f, vf_set1(255.0f/256.0f)), vf_set1(32768.0f));
+   return vi_and(vf_as_i(f), vi_set1(0xff));
+}
+
+/* util_iround(CLAMP(f, 0.0f, 1.0f) * max) */
+static inline vec_i
+float_to_unorm_vec(vec_f f, float max)
+{
+   f = vf_min(vf_max(f, vf_set1(0.0f)), vf_set1(1.0f));
+   return vf_to_i_trunc(vf_add(vf_mul(f, vf_set1(max)), vf_set1(0.5f)));
+}
+
+/* util_half_to_float() */
+static inline vec_f
+half_to_float_vec(vec_i h)
+{
+   vec_f f = vi_as_f(vi_sll(vi_and(h, vi_set1(0x7fff)), 13));
+   f = vf_mul(f, vi_as_f(vi_set1(0xef << 23)));
+   vec_i i = vf_as_i(f);
+   i = vi_or(i, vi_and(vf_as_i(vf_cmpge(f, vf_set1(65536.0f))),
+                       vi_set1(0xff << 23)));
+   i = vi_or(i, vi_sll(vi_and(h, vi_set1(0x8000)), 16));
+   return vi_as_f(i);
+}
+
+/* util_float_to_half() */
+static inline vec_i
+float_to_half_vec(vec_f f)
+{
+   const vec_i f32inf = vi_set1(0xff << 23);
+   const vec_i f16inf = vi_set1(0x1f << 23);
+   const vec_i i = vf_as_i(f);
+   const vec_i sign = vi_and(i, vi_set1(0x80000000));
+   const vec_i abs = vi_andnot(vi_set1(0x80000000), i);
+
+   vec_i h = vi_andnot(vi_set1(0xfff), abs);
+   h = vf_as_i(vf_mul(vi_as_f(h), vi_as_f(vi_set1(0xf << 23))));
+   h = vi_add(h, vi_set1(0x1000));
+   h = vi_select(vi_cmpgt(h, f16inf), vi_sub(f16inf, vi_set1(1)), h);
+   h = vi_srl(h, 13);
+
+   h = vi_select(vi_cmpeq(abs, f32inf), vi_set1(0x7c00), h);
+   h = vi_select(vi_cmpgt(abs, f32inf), vi_set1(0x7e00), h);
+
+   return vi_or(h, vi_srl(sign, 16));
+}
+
+/* util_format_srgb_8unorm_to_linear_float() */
+static inline vec_f
+srgb_8unorm_to_linear_float_vec(vec_i x)
+{
+   return vf_lookup(util_format_srgb_8unorm_to_linear_float_table, x);
+}
+
+/* util_format_linear_float_to_srgb_8unorm() */
+static inline vec_i
+linear_float_to_srgb_8unorm_vec(vec_f x)
+{
+   const int minval = (127 - 13) << 23;
+
+   /* max() returns its second operand for NaNs */
+   x = vf_max(x, vi_as_f(vi_set1(minval)));
+   x = vf_min(x, vi_as_f(vi_set1(0x3f7fffff)));
+
+   const vec_i f = vf_as_i(x);
+   const vec_i tab = vi_lookup(util_format_linear_to_srgb_helper_table,
+                               vi_srl(vi_sub(f, vi_set1(minval)), 20));
+   const vec_i bias = vi_sll(vi_srl(tab, 16), 9);
+   const vec_i scale = vi_and(tab, vi_set1(0xffff));
+   const vec_i t = vi_and(vi_srl(f, 12), vi_set1(0xff));
+
+   return vi_and(vi_srl(vi_add(bias, vi_mullo(scale, t)), 16), vi_set1(0xff));
+}
+
+/* uf11_to_f32() and uf10_to_f32() */
+static inline vec_f
+ufN_to_float_vec(vec_i val, int mantissa_bits)
+{
+   const vec_i exponent = vi_and(vi_srl(val, mantissa_bits), vi_set1(0x1f));
+   const vec_i mantissa = vi_and(val, vi_set1((1 << mantissa_bits) - 1));
+
+   const vec_f denorm = vf_mul(vf_from_i(mantissa),
+                               vf_set1(1.0f / (1 << (14 + mantissa_bits))));
+   const vec_i norm = vi_or(vi_sll(vi_add(exponent, vi_set1(112)), 23),
+                            vi_sll(mantissa, 23 - mantissa_bits));
+   const vec_i infnan = vi_or(vi_set1(0x7f800000), mantissa);
+
+   vec_i f = vi_select(vi_cmpeq(exponent, vi_set1(0)), vf_as_i(denorm), norm);
+   f = vi_select(vi_cmpeq(exponent, vi_set1(31)), infnan, f);
+   return vi_as_f(f);
+}
+
+/* f32_to_uf11() and f32_to_uf10() */
+static inline vec_i
+float_to_ufN_vec(vec_f val, int mantissa_bits, float max)
+{
+   const vec_i max_exponent = vi_set1(0x1f << mantissa_bits);
+   const vec_i f = vf_as_i(val);
+   const vec_i sign = vi_cmpgt(vi_set1(0), f);
+   const vec_i exponent = vi_and(vi_srl(f, 23), vi_set1(0xff));
+   const vec_i mantissa = vi_and(f, vi_set1(0x7fffff));
+
+   vec_i uf = vi_or(vi_sll(vi_sub(exponent, vi_set1(112)), mantissa_bits),
+                    vi_srl(mantissa, 23 - mantissa_bits));
+   uf = vi_and(vi_cmpgt(exponent, vi_set1(112)), uf);
+   uf = vi_select(vi_cmpgt(f, vf_as_i(vf_set1(max))),
+                  vi_set1((30 << mantissa_bits) | ((1 << mantissa_bits) - 1)),
+                  uf);
+   uf = vi_andnot(sign, uf);
+
+   /* Infinity and NaN */
+   const vec_i nan = vi_cmpgt(mantissa, vi_set1(0));
+   const vec_i infnan = vi_or(vi_andnot(vi_andnot(nan, sign), max_exponent),
+                              vi_and(nan, vi_set1(1)));
+   return vi_select(vi_cmpeq(exponent, vi_set1(0xff)), infnan, uf);
+}
+'''
+
+
+def udiv_expr(value, num, den, xmax):
+    '''Vector expression for value * num / den with integer division, for
+    values in [0, xmax].'''
+
+    # Find the smallest shift for which a multiply by a rounded up
+    # reciprocal is exact for every value, using pmaddwd when the factor
+    # fits in 16 bits.
+    for kmax, mul in ((0x7fff, 'vi_madd16'), ((1 << 31) // (xmax + 1), 'vi_mullo')):
+        for shift in range(32):
+            factor = -(-(num << shift) // den)
+            if factor > kmax:
+                break
+            if all((x * factor) >> shift == x * num // den for x in range(xmax + 1)):
+                value = '%s(%s, vi_set1(0x%x))' % (mul, value, factor)
+                if shift:
+                    value = 'vi_srl(%s, %u)' % (value, shift)
+                return value
+    assert False
+
+
+def unorm_to_float_expr(value, size):
+    return 'vf_mul(vf_from_i(%s), vf_set1(1.0f/0x%x))' % (value, (1 << size) - 1)
+
+
+def unorm_to_unorm_expr(value, src_size, dst_size):
+    if src_size == dst_size:
+        return value
+    if src_size > dst_size:
+        return 'vi_srl(%s, %u)' % (value, src_size - dst_size)
+    src_max = (1 << src_size) - 1
+    dst_max = (1 << dst_size) - 1
+    return udiv_expr(value, dst_max, src_max, src_max)
+
+
+def float_to_unorm_expr(value, size, colorspace):
+    if colorspace == SRGB:
+        assert size == 8
+        return 'linear_float_to_srgb_8unorm_vec(%s)' % value
+    if size == 8:
+        return 'float_to_ubyte_vec(%s)' % value
+    return 'float_to_unorm_vec(%s, (float)0x%x)' % (value, (1 << size) - 1)
+
+
+def inv_swizzles(swizzles):
+    inv_swizzle = [None]*4
+    for i in range(4):
+        swizzle = swizzles[i]
+        if swizzle < 4 and inv_swizzle[swizzle] == None:
+            inv_swizzle[swizzle] = i
+    return inv_swizzle
+
+
+def generate_bitmask_kernel(format, name):
+    channels = format.le_channels
+    swizzles = format.le_swizzles
+    depth = format.block_size()
+
+    if depth == 32:
+        load = 'vi_loadu(src)'
+        store = 'vi_storeu(dst, value)'
+    else:
+        load = 'vi_load_u16(src)'
+        store = 'vi_store_u16(dst, value)'
+
+    if name.startswith('unpack'):
+        print('      const vec_i value = %s;' % load)
+
+        for channel in channels:
+            if channel.type == VOID:
+                continue
+            value = 'value'
+            if channel.shift:
+                value = 'vi_srl(%s, %u)' % (value, channel.shift)
+            if channel.shift + channel.size < depth:
+                value = 'vi_and(%s, vi_set1(0x%x))' % (value, (1 << channel.size) - 1)
+            print('      const vec_i %s = %s;' % (channel.name, value))
+
+        values = []
+        for i in range(4):
+            swizzle = swizzles[i]
+            if swizzle < 4:
+                channel = channels[swizzle]
+                value = channel.name
+                if name == 'unpack_rgba_float':
+                    if format.colorspace == SRGB and i != 3:
+                        value = 'srgb_8unorm_to_linear_float_vec(%s)' % value
+                    else:
+                        value = unorm_to_float_expr(value, channel.size)
+                else:
+                    value = unorm_to_unorm_expr(value, channel.size, 8)
+            elif swizzle == SWIZZLE_1:
+                value = 'vf_set1(1.0f)' if name == 'unpack_rgba_float' else 'vi_set1(0xff)'
+            else:
+                value = 'vf_set1(0.0f)' if name == 'unpack_rgba_float' else 'vi_set1(0)'
+            values.append(value)
+
+        if name == 'unpack_rgba_float':
+            print('      vf_store_rgba(dst,')
+            for i in range(4):
+                print('                    %s%s' % (values[i], ');' if i == 3 else ','))
+        else:
+            print('      vec_i rgba = %s;' % values[0])
+            for i in range(1, 4):
+                print('      rgba = vi_or(rgba, vi_sll(%s, %u));' % (values[i], 8 * i))
+            print('      vi_storeu(dst, rgba);')
+    else:
+        if name == 'pack_rgba_float':
+            print('      vec_f rgba[4];')
+            print('      vf_load_rgba(src, &rgba[0], &rgba[1], &rgba[2], &rgba[3]);')
+        else:
+            print('      const vec_i rgba = vi_loadu(src);')
+
+        print('      vec_i value = vi_set1(0);')
+        inv_swizzle = inv_swizzles(swizzles)
+        for i in range(4):
+            channel = channels[i]
+            if inv_swizzle[i] is None or channel.type == VOID:
+                continue
+            if name == 'pack_rgba_float':
+                colorspace = format.colorspace
+                if inv_swizzle[i] == 3:
+                    # Alpha channel is linear
+                    colorspace = RGB
+                value = float_to_unorm_expr('rgba[%u]' % inv_swizzle[i],
+                                            channel.size, colorspace)
+            else:
+                value = 'rgba'
+                if inv_swizzle[i]:
+                    value = 'vi_srl(%s, %u)' % (value, 8 * inv_swizzle[i])
+                if inv_swizzle[i] != 3:
+                    value = 'vi_and(%s, vi_set1(0xff))' % value
+                value = unorm_to_unorm_expr(value, 8, channel.size)
+            if channel.shift + channel.size < depth:
+                value = 'vi_and(%s, vi_set1(0x%x))' % (value, (1 << channel.size) - 1)
+            if channel.shift:
+                value = 'vi_sll(%s, %u)' % (value, channel.shift)
+            print('      value = vi_or(value, %s);' % value)
+        print('      %s;' % store)
+
+
+def generate_half_kernel(format, name):
+    # Four vectors of channels make VEC_WIDTH pixels
+    print('      unsigned i;')
+    print('      for (i = 0; i < 4; i++) {')
+    if name == 'unpack_rgba_float':
+        print('         const vec_i h = vi_load_u16(src + 2 * VEC_WIDTH * i);')
+        print('         vf_storeu(dst + VEC_WIDTH * i, half_to_float_vec(h));')
+    elif name == 'pack_rgba_float':
+        print('         const vec_f f = vf_loadu(src + VEC_WIDTH * i);')
+        print('         vi_store_u16(dst + 2 * VEC_WIDTH * i, float_to_half_vec(f));')
+    elif name == 'unpack_rgba_8unorm':
+        print('         const vec_i h = vi_load_u16(src + 2 * VEC_WIDTH * i);')
+        print('         vi_store_u8(dst + VEC_WIDTH * i, float_to_ubyte_vec(half_to_float_vec(h)));')
+    else:
+        print('         const vec_i u = vi_load_u8(src + VEC_WIDTH * i);')
+        print('         const vec_f f = %s;' % unorm_to_float_expr('u', 8))
+        print('         vi_store_u16(dst + 2 * VEC_WIDTH * i, float_to_half_vec(f));')
+    print('      }')
+
+
+def generate_r11g11b10_kernel(format, name):
+    if name == 'unpack_rgba_float':
+        print('      const vec_i value = vi_loadu(src);')
+        print('      vf_store_rgba(dst,')
+        print('                    ufN_to_float_vec(value, 6),')
+        print('                    ufN_to_float_vec(vi_srl(value, 11), 6),')
+        print('                    ufN_to_float_vec(vi_srl(value, 22), 5),')
+        print('                    vf_set1(1.0f));')
+    else:
+        print('      vec_f rgba[4];')
+        print('      vf_load_rgba(src, &rgba[0], &rgba[1], &rgba[2], &rgba[3]);')
+        print('      vec_i value = vi_and(float_to_ufN_vec(rgba[0], 6, 65024.0f), vi_set1(0x7ff));')
+        print('      value = vi_or(value, vi_sll(vi_and(float_to_ufN_vec(rgba[1], 6, 65024.0f), vi_set1(0x7ff)), 11));')
+        print('      value = vi_or(value, vi_sll(vi_and(float_to_ufN_vec(rgba[2], 5, 64512.0f), vi_set1(0x3ff)), 22));')
+        print('      vi_storeu(dst, value);')
+
+
+def generate_kernel(format, name, isa):
+    if isa == 'sse2':
+        print('static %s' % kernel_prototype(format, name, isa))
+    else:
+        print(kernel_prototype(format, name, isa))
+    print('{')
+    print('   unsigned x;')
+    print('   for (x = 0; x + VEC_WIDTH <= width; x += VEC_WIDTH) {')
+
+    if format.name == 'PIPE_FORMAT_R11G11B10_FLOAT':
+        generate_r11g11b10_kernel(format, name)
+    elif is_half_array(format):
+        generate_half_kernel(format, name)
+    else:
+        generate_bitmask_kernel(format, name)
+
+    if name.startswith('unpack'):
+        print('      src += VEC_WIDTH * %u;' % (format.block_size() // 8))
+        print('      dst += VEC_WIDTH * 4;')
+    else:
+        print('      src += VEC_WIDTH * 4;')
+        print('      dst += VEC_WIDTH * %u;' % (format.block_size() // 8))
+    print('   }')
+    print('   return x;')
+    print('}')
+    print()
+
+
+def generate_dispatch(format, name):
+    print(kernel_prototype(format, name, 'simd'))
+    print('{')
+    print('#if defined(PIPE_ARCH_X86_64)')
+    print('#ifdef USE_AVX2')
+    print('   if (has_avx2())')
+    print('      return util_format_%s_%s_avx2(dst, src, width);' % (format.short_name(), name))
+    print('#endif')
+    print('   return util_format_%s_%s_sse2(dst, src, width);' % (format.short_name(), name))
+    print('#else')
+    print('   return 0;')
+    print('#endif')
+    print('}')
+    print()
+
+
+def generate(formats, isa):
+    print('/* This file is autogenerated by u_format_simd.py from u_format.csv. Do not edit directly. */')
+    print()
+    print(CopyRight.strip())
+    print()
+    print('#include <string.h>')
+    print()
+    print('#include "pipe/p_config.h"')
+    print('#include "util/format_srgb.h"')
+    print('#include "u_format_simd.h"')
+    print()
+
+    formats = [format for format in formats if kernel_names(format)]
+
+    if isa == 'avx2':
+        print('/* Built with AVX2 enabled, and only called on CPUs that support it. */')
+        print('#ifndef __AVX2__')
+        print('#error "This file must be built with AVX2 enabled"')
+        print('#endif')
+        print()
+
+    # The kernels round the way the scalar code does on x86-64 only, see
+    # util_iround().
+    print('#if defined(PIPE_ARCH_X86_64)')
+    print(sse2_helpers if isa == 'sse2' else avx2_helpers)
+    print(conversion_helpers)
+    for format in formats:
+        for name in kernel_names(format):
+            generate_kernel(format, name, isa)
+    print('#endif /* PIPE_ARCH_X86_64 */')
+    print()
+
+    if isa == 'sse2':
+        print('#if defined(PIPE_ARCH_X86_64) && defined(USE_AVX2)')
+        print('#include "util/u_cpu_detect.h"')
+        print()
+        print('static inline boolean')
+        print('has_avx2(void)')
+        print('{')
+        print('   util_cpu_detect();')
+        print('   return util_cpu_caps.has_avx2;')
+        print('}')
+        print('#endif')
+        print()
+
+        for format in formats:
+            for name in kernel_names(format):
+                generate_dispatch(format, name)
+
+
+def generate_header(formats):
+    print('/* This file is autogenerated by u_format_simd.py from u_format.csv. Do not edit directly. */')
+    print()
+    print(CopyRight.strip())
+    print()
+    print('#ifndef U_FORMAT_SIMD_H')
+    print('#define U_FORMAT_SIMD_H')
+    print()
+    print('#include <stdint.h>')
+    print()
+    print('#include "pipe/p_config.h"')
+    print()
+    print('#ifdef __cplusplus')
+    print('extern "C" {')
+    print('#endif')
+    print()
+
+    formats = [format for format in formats if kernel_names(format)]
+
+    for format in formats:
+        for name in kernel_names(format):
+            print('%s;' % kernel_prototype(format, name, 'simd'))
+            print()
+
+    print('#if defined(PIPE_ARCH_X86_64)')
+    print()
+    for format in formats:
+        for name in kernel_names(format):
+            print('%s;' % kernel_prototype(format, name, 'avx2'))
+            print()
+    print('#endif /* PIPE_ARCH_X86_64 */')
+    print()
+    print('#ifdef __cplusplus')
+    print('}')
+    print('#endif')
+    print()
+    print('#endif /* U_FORMAT_SIMD_H */')
+
+
+def main():
+    formats = []
+    isa = 'sse2'
+    header = False
+    for arg in sys.argv[1:]:
+        if arg == '--avx2':
+            isa = 'avx2'
+        elif arg == '--header':
+            header = True
+        else:
+            formats.extend(parse(arg))
+    if header:
+        generate_header(formats)
+    else:
+        generate(formats, isa)
+
+
+if __name__ == '__main__':
+    main()
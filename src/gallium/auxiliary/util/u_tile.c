@@ -449,13 +449,24 @@ pipe_get_tile_rgba_format(struct pipe_transfer *pt,
       return;
    }
 
-   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
-   if (!packed) {
+   if (format == PIPE_FORMAT_UYVY || format == PIPE_FORMAT_YUYV) {
+      assert((x & 1) == 0);
+   }
+
+   /* Unpack straight from the mapping.  Only the depth/stencil helpers of
+    * pipe_tile_raw_to_rgba() want the rows packed together first.
+    */
+   if (!util_format_is_depth_or_stencil(format)) {
+      util_format_read_4f(format,
+                          p, dst_stride * sizeof(float),
+                          src, pt->stride,
+                          x, y, w, h);
       return;
    }
 
-   if (format == PIPE_FORMAT_UYVY || format == PIPE_FORMAT_YUYV) {
-      assert((x & 1) == 0);
+   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
+   if (!packed) {
+      return;
    }
 
    pipe_get_tile_raw(pt, src, x, y, w, h, packed, 0);
@@ -484,16 +495,11 @@ pipe_put_tile_rgba_format(struct pipe_transfer *pt,
                           const float *p)
 {
    unsigned src_stride = w * 4;
-   void *packed;
 
    if (u_clip_tile(x, y, &w, &h, &pt->box))
       return;
 
-   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
-
-   if (!packed)
-      return;
-
+   /* There is no float packing for these, so the surface is left alone. */
    switch (format) {
    case PIPE_FORMAT_Z16_UNORM:
       /*z16_put_tile_rgba((ushort *) packed, w, h, p, src_stride);*/
@@ -518,13 +524,9 @@ pipe_put_tile_rgba_format(struct pipe_transfer *pt,
    default:
       util_format_write_4f(format,
                            p, src_stride * sizeof(float),
-                           packed, util_format_get_stride(format, w),
-                           0, 0, w, h);
+                           dst, pt->stride,
+                           x, y, w, h);
    }
-
-   pipe_put_tile_raw(pt, dst, x, y, w, h, packed, 0);
-
-   FREE(packed);
 }
 
 void
@@ -535,24 +537,14 @@ pipe_put_tile_i_format(struct pipe_transfer *pt,
                        const int *p)
 {
    unsigned src_stride = w * 4;
-   void *packed;
 
    if (u_clip_tile(x, y, &w, &h, &pt->box))
       return;
 
-   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
-
-   if (!packed)
-      return;
-
    util_format_write_4i(format,
                         p, src_stride * sizeof(float),
-                        packed, util_format_get_stride(format, w),
-                        0, 0, w, h);
-
-   pipe_put_tile_raw(pt, dst, x, y, w, h, packed, 0);
-
-   FREE(packed);
+                        dst, pt->stride,
+                        x, y, w, h);
 }
 
 void
@@ -563,24 +555,14 @@ pipe_put_tile_ui_format(struct pipe_transfer *pt,
                         const unsigned int *p)
 {
    unsigned src_stride = w * 4;
-   void *packed;
 
    if (u_clip_tile(x, y, &w, &h, &pt->box))
       return;
 
-   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
-
-   if (!packed)
-      return;
-
    util_format_write_4ui(format,
                          p, src_stride * sizeof(float),
-                         packed, util_format_get_stride(format, w),
-                         0, 0, w, h);
-
-   pipe_put_tile_raw(pt, dst, x, y, w, h, packed, 0);
-
-   FREE(packed);
+                         dst, pt->stride,
+                         x, y, w, h);
 }
 
 /**
@@ -842,26 +824,19 @@ pipe_get_tile_ui_format(struct pipe_transfer *pt,
                         unsigned int *p)
 {
    unsigned dst_stride = w * 4;
-   void *packed;
 
    if (u_clip_tile(x, y, &w, &h, &pt->box)) {
       return;
    }
 
-   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
-   if (!packed) {
-      return;
-   }
-
    if (format == PIPE_FORMAT_UYVY || format == PIPE_FORMAT_YUYV) {
       assert((x & 1) == 0);
    }
 
-   pipe_get_tile_raw(pt, src, x, y, w, h, packed, 0);
-
-   pipe_tile_raw_to_unsigned(format, packed, w, h, p, dst_stride);
-
-   FREE(packed);
+   util_format_read_4ui(format,
+                        p, dst_stride * sizeof(float),
+                        src, pt->stride,
+                        x, y, w, h);
 }
 
 
@@ -873,24 +848,17 @@ pipe_get_tile_i_format(struct pipe_transfer *pt,
                        int *p)
 {
    unsigned dst_stride = w * 4;
-   void *packed;
 
    if (u_clip_tile(x, y, &w, &h, &pt->box)) {
       return;
    }
 
-   packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
-   if (!packed) {
-      return;
-   }
-
    if (format == PIPE_FORMAT_UYVY || format == PIPE_FORMAT_YUYV) {
       assert((x & 1) == 0);
    }
 
-   pipe_get_tile_raw(pt, src, x, y, w, h, packed, 0);
-
-   pipe_tile_raw_to_signed(format, packed, w, h, p, dst_stride);
-
-   FREE(packed);
+   util_format_read_4i(format,
+                       p, dst_stride * sizeof(float),
+                       src, pt->stride,
+                       x, y, w, h);
 }
@@ -54,7 +54,14 @@ void u_default_texture_subdata(struct pipe_context *pipe,
    usage |= PIPE_TRANSFER_WRITE;
 
    /* texture_subdata implicitly discards the rewritten buffer range */
-   usage |= PIPE_TRANSFER_DISCARD_RANGE;
+   if (resource->last_level == 0 &&
+       util_texrange_covers_whole_level(resource, level, box->x, box->y,
+                                        box->z, box->width, box->height,
+                                        box->depth)) {
+      usage |= PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE;
+   } else {
+      usage |= PIPE_TRANSFER_DISCARD_RANGE;
+   }
 
    map = pipe->transfer_map(pipe,
                             resource,
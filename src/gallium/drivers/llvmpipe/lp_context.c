@@ -33,6 +33,7 @@
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -45,6 +46,7 @@
 #include "lp_state.h"
 #include "lp_surface.h"
 #include "lp_query.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 
 /* This is only safe if there's just one concurrent context */
@@ -106,6 +108,8 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
 #endif
    llvmpipe->context = NULL;
 
+   p_atomic_dec(&llvmpipe_screen(pipe->screen)->num_contexts);
+
    align_free( llvmpipe );
 }
 
@@ -153,6 +157,8 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    llvmpipe->pipe.screen = screen;
    llvmpipe->pipe.priv = priv;
 
+   p_atomic_inc(&llvmpipe_screen(screen)->num_contexts);
+
    /* Init the pipe context methods */
    llvmpipe->pipe.destroy = llvmpipe_destroy;
    llvmpipe->pipe.set_framebuffer_state = llvmpipe_set_framebuffer_state;
@@ -45,6 +45,12 @@ struct resource_ref {
    struct resource_ref *next;
 };
 
+/** List of texture storage to free at the end of the scene */
+struct retired_data {
+   void *data;
+   struct retired_data *next;
+};
+
 
 /**
  * Create a new scene object.
@@ -274,6 +280,15 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
+   /* Free texture storage which was only kept for this scene
+    */
+   {
+      struct retired_data *retired;
+
+      for (retired = scene->retired; retired; retired = retired->next)
+         align_free(retired->data);
+   }
+
    /* Free all scene data blocks:
     */
    {
@@ -292,6 +307,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
    lp_fence_reference(&scene->fence, NULL);
 
    scene->resources = NULL;
+   scene->retired = NULL;
    scene->scene_size = 0;
    scene->resource_reference_size = 0;
 
@@ -447,6 +463,33 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 }
 
 
+/**
+ * Take ownership of texture storage that the scene commands may still read,
+ * freeing it with align_free() once the scene has been rasterized.  Fails,
+ * so that the caller flushes instead, once the scene holds on to too much.
+ */
+boolean
+lp_scene_retire_data(struct lp_scene *scene, void *data, unsigned size)
+{
+   struct retired_data *retired;
+
+   if (scene->resource_reference_size + size >= LP_SCENE_MAX_RESOURCE_SIZE)
+      return FALSE;
+
+   retired = lp_scene_alloc(scene, sizeof *retired);
+   if (!retired)
+      return FALSE;
+
+   scene->resource_reference_size += size;
+
+   retired->data = data;
+   retired->next = scene->retired;
+   scene->retired = retired;
+
+   return TRUE;
+}
+
+
 
 
 /** advance curr_x,y to the next bin */
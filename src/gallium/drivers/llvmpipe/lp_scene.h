@@ -116,6 +116,7 @@ struct data_block_list {
 };
 
 struct resource_ref;
+struct retired_data;
 
 /**
  * All bins and bin data are contained here.
@@ -154,6 +155,9 @@ struct lp_scene {
    /** list of resources referenced by the scene commands */
    struct resource_ref *resources;
 
+   /** texture storage replaced while the scene commands still read it */
+   struct retired_data *retired;
+
    /** Total memory used by the scene (in bytes).  This sums all the
     * data blocks and counts all bins, state, resource references and
     * other random allocations within the scene.
@@ -201,6 +205,9 @@ boolean lp_scene_add_resource_reference(struct lp_scene *scene,
 boolean lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                         const struct pipe_resource *resource );
 
+boolean lp_scene_retire_data(struct lp_scene *scene, void *data,
+                             unsigned size);
+
 
 /**
  * Allocate space for a command/data in the bin's data buffer.
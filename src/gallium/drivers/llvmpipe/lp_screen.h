@@ -55,6 +55,11 @@ struct llvmpipe_screen
     */
    unsigned timestamp;
 
+   /* Number of contexts.  Texture storage is only replaced under a scene
+    * when no other context's scenes may read it.
+    */
+   unsigned num_contexts;
+
    struct lp_rasterizer *rast;
    mtx_t rast_mutex;
 };
@@ -994,6 +994,21 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
 }
 
 
+/**
+ * Hand over texture storage which the current scene may still read, to be
+ * freed once the scene is done.  Fails when there is no scene to hand it to.
+ */
+boolean
+lp_setup_retire_data( struct lp_setup_context *setup,
+                      void *data, unsigned size )
+{
+   if (!setup->scene)
+      return FALSE;
+
+   return lp_scene_retire_data(setup->scene, data, size);
+}
+
+
 /**
  * Called by vbuf code when we're about to draw something.
  *
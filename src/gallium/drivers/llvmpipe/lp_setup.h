@@ -139,6 +139,10 @@ unsigned
 lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
                                 const struct pipe_resource *texture );
 
+boolean
+lp_setup_retire_data( struct lp_setup_context *setup,
+                      void *data, unsigned size );
+
 void
 lp_setup_set_flatshade_first( struct lp_setup_context *setup, 
                               boolean flatshade_first );
@@ -35,6 +35,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_format.h"
@@ -166,6 +167,8 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       depth = u_minify(depth, 1);
    }
 
+   lpr->tex_data_size = total_size;
+
    if (allocate) {
       lpr->tex_data = align_malloc(total_size, mip_align);
       if (!lpr->tex_data) {
@@ -504,6 +507,52 @@ llvmpipe_resource_get_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Give a texture new storage when it is about to be overwritten whole while
+ * the current scene still samples from it, so that the scene needn't be
+ * flushed first.  The old storage is freed once the scene is rasterized.
+ */
+static boolean
+llvmpipe_discard_texture_storage(struct llvmpipe_context *llvmpipe,
+                                 struct llvmpipe_resource *lpr)
+{
+   void *data;
+
+   if (lpr->dt || !llvmpipe_resource_is_texture(&lpr->base))
+      return FALSE;
+
+   /* Only the scenes of this context are known to be done with the old
+    * storage by the time it is freed.
+    */
+   if (p_atomic_read(&llvmpipe_screen(llvmpipe->pipe.screen)->num_contexts) != 1)
+      return FALSE;
+
+   /* Render targets are written through the storage at rasterization time */
+   if (llvmpipe_is_resource_referenced(&llvmpipe->pipe, &lpr->base, 0) !=
+       LP_REFERENCED_FOR_READ)
+      return FALSE;
+
+   /* Same alignment as llvmpipe_texture_layout() */
+   data = align_malloc(lpr->tex_data_size,
+                       MAX2(64, util_cpu_caps.cacheline));
+   if (!data)
+      return FALSE;
+
+   if (!lp_setup_retire_data(llvmpipe->setup, lpr->tex_data,
+                             lpr->tex_data_size)) {
+      align_free(data);
+      return FALSE;
+   }
+
+   /* The sampler views pick the new storage up through screen->timestamp,
+    * bumped for every write transfer.
+    */
+   lpr->tex_data = data;
+
+   return TRUE;
+}
+
+
 static void *
 llvmpipe_transfer_map( struct pipe_context *pipe,
                        struct pipe_resource *resource,
@@ -527,9 +576,11 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
 
    /*
     * Transfers, like other pipe operations, must happen in order, so flush the
-    * context if necessary.
+    * context if necessary, unless the old contents can be thrown away.
     */
-   if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
+   if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED) &&
+       !((usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE) &&
+         llvmpipe_discard_texture_storage(llvmpipe, lpr))) {
       boolean read_only = !(usage & PIPE_TRANSFER_WRITE);
       boolean do_not_block = !!(usage & PIPE_TRANSFER_DONTBLOCK);
       if (!llvmpipe_flush_resource(pipe, resource,
@@ -68,6 +68,8 @@ struct llvmpipe_resource
    unsigned mip_offsets[LP_MAX_TEXTURE_LEVELS];
    /** allocated total size (for non-display target texture resources only) */
    unsigned total_alloc_size;
+   /** size of tex_data (for non-display target texture resources only) */
+   unsigned tex_data_size;
 
    /**
     * Display target, for textures with the PIPE_BIND_DISPLAY_TARGET
@@ -1989,8 +1989,11 @@ void si_schedule_initial_compile(struct si_context *sctx, unsigned processor,
 		compiler_ctx_state->debug = async_debug.base;
 	}
 
-	util_queue_add_job(&sctx->screen->shader_compiler_queue, job,
-			   ready_fence, execute, NULL);
+	/* When waiting, don't let the shaders created earlier go first. */
+	util_queue_add_job_with_priority(&sctx->screen->shader_compiler_queue,
+					 job, ready_fence, execute, NULL,
+					 wait ? UTIL_QUEUE_PRIORITY_HIGH :
+						UTIL_QUEUE_PRIORITY_NORMAL);
 
 	if (wait) {
 		util_queue_fence_wait(ready_fence);
@@ -940,6 +940,8 @@ blend_fallback(struct quad_stage *qs,
          const boolean dual_source_blend = util_blend_state_is_dual(blend, cbuf);
          uint q, i, j;
 
+         sp_tile_mark_dirty(tile, quads[0]->input.y0, 2);
+
          if (clamp)
             blend_color = softpipe->blend_color_clamped.color;
          else
@@ -1039,6 +1041,8 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
+   sp_tile_mark_dirty(tile, quads[0]->input.y0, 2);
+
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
       float (*quadColor)[4] = quad->output.color[0];
@@ -1113,6 +1117,8 @@ blend_single_add_one_one(struct quad_stage *qs,
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
+   sp_tile_mark_dirty(tile, quads[0]->input.y0, 2);
+
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
       float (*quadColor)[4] = quad->output.color[0];
@@ -1181,6 +1187,8 @@ single_output_color(struct quad_stage *qs,
                            quads[0]->input.x0, 
                            quads[0]->input.y0, quads[0]->input.layer);
 
+   sp_tile_mark_dirty(tile, quads[0]->input.y0, 2);
+
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
       float (*quadColor)[4] = quad->output.color[0];
@@ -269,6 +269,8 @@ write_depth_stencil_values( struct depth_data *data,
    struct softpipe_cached_tile *tile = data->tile;
    unsigned j;
 
+   sp_tile_mark_dirty(tile, quad->input.y0, 2);
+
    /* put updated Z values back into cached tile */
    switch (data->format) {
    case PIPE_FORMAT_Z16_UNORM:
@@ -72,6 +72,7 @@ NAME(struct quad_stage *qs,
    depth_step = (ushort)(dzdx * scale);
 
    tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache, ix, iy, quads[0]->input.layer);
+   sp_tile_mark_dirty(tile, iy, 2);
 
    for (i = 0; i < nr; i++) {
       const unsigned outmask = quads[i]->inout.mask;
@@ -336,6 +336,38 @@ clear_tile(struct softpipe_cached_tile *tile,
 }
 
 
+/**
+ * Pack a row of TILE_SIZE pixels of the clear color in the given format, so
+ * that cleared tiles can be filled by copying it instead of converting a
+ * whole float tile for each of them.
+ * Returns FALSE for formats which aren't made of single pixel blocks.
+ */
+static boolean
+pack_clear_row(enum pipe_format format,
+               const union pipe_color_union *color,
+               ubyte row[TILE_SIZE * 16])
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const unsigned bpp = desc->block.bits / 8;
+   unsigned i;
+
+   if (desc->block.width != 1 || desc->block.height != 1 || bpp > 16)
+      return FALSE;
+
+   if (util_format_is_pure_uint(format))
+      util_format_write_4ui(format, color->ui, 0, row, 0, 0, 0, 1, 1);
+   else if (util_format_is_pure_sint(format))
+      util_format_write_4i(format, color->i, 0, row, 0, 0, 0, 1, 1);
+   else
+      util_format_write_4f(format, color->f, 0, row, 0, 0, 0, 1, 1);
+
+   for (i = 1; i < TILE_SIZE; i++)
+      memcpy(row + i * bpp, row, bpp);
+
+   return TRUE;
+}
+
+
 /**
  * Actually clear the tiles which were flagged as being in a clear state.
  */
@@ -345,16 +377,23 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
    struct pipe_transfer *pt = tc->transfer[layer];
    const uint w = tc->transfer[layer]->box.width;
    const uint h = tc->transfer[layer]->box.height;
+   ubyte row[TILE_SIZE * 16];
+   boolean fill;
    uint x, y;
    uint numCleared = 0;
 
    assert(pt->resource);
 
-   /* clear the scratch tile to the clear value */
+   /* clear the scratch tile to the clear value, unless the color can be
+    * filled in directly
+    */
    if (tc->depth_stencil) {
       clear_tile(tc->tile, pt->resource->format, tc->clear_val);
+      fill = FALSE;
    } else {
-      clear_tile_rgba(tc->tile, pt->resource->format, &tc->clear_color);
+      fill = pack_clear_row(pt->resource->format, &tc->clear_color, row);
+      if (!fill)
+         clear_tile_rgba(tc->tile, pt->resource->format, &tc->clear_color);
    }
 
    /* push the tile to all positions marked as clear */
@@ -364,7 +403,20 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
 
          if (is_clear_flag_set(tc->clear_flags, addr, tc->clear_flags_size)) {
             /* write the scratch tile to the surface */
-            if (tc->depth_stencil) {
+            if (fill) {
+               uint tw = TILE_SIZE, th = TILE_SIZE, i;
+
+               if (!u_clip_tile(x, y, &tw, &th, &pt->box)) {
+                  const unsigned bpp =
+                     util_format_get_blocksize(pt->resource->format);
+                  ubyte *dst = (ubyte *) tc->transfer_map[layer] +
+                               y * pt->stride + x * bpp;
+
+                  for (i = 0; i < th; i++)
+                     memcpy(dst + i * pt->stride, row, tw * bpp);
+               }
+            }
+            else if (tc->depth_stencil) {
                pipe_put_tile_raw(pt, tc->transfer_map[layer],
                                  x, y, TILE_SIZE, TILE_SIZE,
                                  tc->tile->data.any, 0/*STRIDE*/);
@@ -401,36 +453,43 @@ static void
 sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 {
    int layer = tc->tile_addrs[pos].bits.layer;
+   struct softpipe_cached_tile *tile = tc->entries[pos];
+
    if (!tc->tile_addrs[pos].bits.invalid) {
-      if (tc->depth_stencil) {
-         pipe_put_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
-                           tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                           tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                           TILE_SIZE, TILE_SIZE,
-                           tc->entries[pos]->data.depth32, 0/*STRIDE*/);
-      }
-      else {
-         if (util_format_is_pure_uint(tc->surface->format)) {
-            pipe_put_tile_ui_format(tc->transfer[layer], tc->transfer_map[layer],
-                                    tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                    tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                    TILE_SIZE, TILE_SIZE,
-                                    tc->surface->format,
-                                    (unsigned *) tc->entries[pos]->data.colorui128);
-         } else if (util_format_is_pure_sint(tc->surface->format)) {
-            pipe_put_tile_i_format(tc->transfer[layer], tc->transfer_map[layer],
-                                   tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                   tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                   TILE_SIZE, TILE_SIZE,
-                                   tc->surface->format,
-                                   (int *) tc->entries[pos]->data.colori128);
-         } else {
-            pipe_put_tile_rgba_format(tc->transfer[layer], tc->transfer_map[layer],
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
+      /* only store the rows which were written to */
+      const unsigned y0 = tile->dirty_y0;
+      const unsigned x = tc->tile_addrs[pos].bits.x * TILE_SIZE;
+      const unsigned y = tc->tile_addrs[pos].bits.y * TILE_SIZE + y0;
+
+      if (y0 < tile->dirty_y1) {
+         const unsigned h = tile->dirty_y1 - y0;
+
+         if (tc->depth_stencil) {
+            const unsigned bpp =
+               util_format_get_blocksize(tc->surface->format);
+
+            pipe_put_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
+                              x, y, TILE_SIZE, h,
+                              tile->data.any + y0 * TILE_SIZE * bpp,
+                              0/*STRIDE*/);
+         }
+         else {
+            if (util_format_is_pure_uint(tc->surface->format)) {
+               pipe_put_tile_ui_format(tc->transfer[layer], tc->transfer_map[layer],
+                                       x, y, TILE_SIZE, h,
+                                       tc->surface->format,
+                                       tile->data.colorui128[y0][0]);
+            } else if (util_format_is_pure_sint(tc->surface->format)) {
+               pipe_put_tile_i_format(tc->transfer[layer], tc->transfer_map[layer],
+                                      x, y, TILE_SIZE, h,
                                       tc->surface->format,
-                                      (float *) tc->entries[pos]->data.color);
+                                      tile->data.colori128[y0][0]);
+            } else {
+               pipe_put_tile_rgba_format(tc->transfer[layer], tc->transfer_map[layer],
+                                         x, y, TILE_SIZE, h,
+                                         tc->surface->format,
+                                         tile->data.color[y0][0]);
+            }
          }
       }
       tc->tile_addrs[pos].bits.invalid = 1;  /* mark as empty */
@@ -529,41 +588,8 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 
    if (addr.value != tc->tile_addrs[pos].value) {
 
-      layer = tc->tile_addrs[pos].bits.layer;
-      if (tc->tile_addrs[pos].bits.invalid == 0) {
-         /* put dirty tile back in framebuffer */
-         if (tc->depth_stencil) {
-            pipe_put_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_put_tile_ui_format(tc->transfer[layer], tc->transfer_map[layer],
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_put_tile_i_format(tc->transfer[layer], tc->transfer_map[layer],
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (int *) tile->data.colori128);
-            } else {
-               pipe_put_tile_rgba_format(tc->transfer[layer], tc->transfer_map[layer],
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
-      }
+      /* put dirty tile back in framebuffer */
+      sp_flush_tile(tc, pos);
 
       tc->tile_addrs[pos] = addr;
 
@@ -580,8 +606,13 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
             clear_tile_rgba(tile, pt->resource->format, &tc->clear_color);
          }
          clear_clear_flag(tc->clear_flags, addr, tc->clear_flags_size);
+         tile->dirty_y0 = 0;
+         tile->dirty_y1 = TILE_SIZE;
       }
       else {
+         tile->dirty_y0 = TILE_SIZE;
+         tile->dirty_y1 = 0;
+
          /* get new tile data from transfer */
          if (tc->depth_stencil) {
             pipe_get_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
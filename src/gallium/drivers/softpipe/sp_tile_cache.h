@@ -74,6 +74,9 @@ struct softpipe_cached_tile
       uint64_t depth64[TILE_SIZE][TILE_SIZE];
       ubyte any[1];
    } data;
+
+   /** Rows written since the tile was fetched, [dirty_y0, dirty_y1) */
+   unsigned dirty_y0, dirty_y1;
 };
 
 #define NUM_ENTRIES 50
@@ -156,6 +159,20 @@ sp_get_cached_tile(struct softpipe_tile_cache *tc,
 }
 
 
+/**
+ * Note that rows [y, y + height) of the tile containing window row y are
+ * about to be written, so that they get stored back on flush.
+ */
+static inline void
+sp_tile_mark_dirty(struct softpipe_cached_tile *tile,
+                   unsigned y, unsigned height)
+{
+   y %= TILE_SIZE;
+   tile->dirty_y0 = MIN2(tile->dirty_y0, y);
+   tile->dirty_y1 = MAX2(tile->dirty_y1, MIN2(y + height, TILE_SIZE));
+}
+
+
 
 
 #endif /* SP_TILE_CACHE_H */
@@ -818,6 +818,7 @@ enum pipe_cap
    PIPE_CAP_MAX_GS_INVOCATIONS,
    PIPE_CAP_MAX_SHADER_BUFFER_SIZE,
    PIPE_CAP_TEXTURE_MIRROR_CLAMP_TO_EDGE,
+   PIPE_CAP_PREFER_CPU_TEXTURE_TRANSFER,
 };
 
 /**
@@ -0,0 +1,265 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Times the two ways st_GetTexSubImage can read back a compressed texture
+ * as RGBA8: blitting it to a linear RGBA8 texture and copying that out of
+ * mapped memory, and decoding it on the CPU through a map, as it does on
+ * drivers that return 1 for PIPE_CAP_PREFER_CPU_TEXTURE_TRANSFER.  The CPU
+ * path decodes to floats first, like _mesa_GetTexSubImage_sw does for
+ * compressed textures.
+ */
+
+#include <stdio.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* pipe_transfer_* helpers */
+#include "util/u_inlines.h"
+/* util_format_read_4f & util_format_write_4f */
+#include "util/u_format.h"
+/* os_time_get_nano */
+#include "util/os_time.h"
+/* FREE, MALLOC & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+static const enum pipe_format formats[] = {
+	PIPE_FORMAT_DXT1_RGBA,
+	PIPE_FORMAT_DXT5_RGBA,
+	PIPE_FORMAT_RGTC1_UNORM,
+	PIPE_FORMAT_RGTC2_UNORM,
+	PIPE_FORMAT_BPTC_RGBA_UNORM,
+};
+
+static const unsigned sizes[] = { 256, 1024, 2048 };
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+};
+
+static struct pipe_resource *
+create_texture(struct program *p, enum pipe_format format, unsigned size,
+	       unsigned bind, enum pipe_resource_usage usage)
+{
+	struct pipe_resource tmplt;
+
+	memset(&tmplt, 0, sizeof(tmplt));
+	tmplt.target = PIPE_TEXTURE_2D;
+	tmplt.format = format;
+	tmplt.width0 = size;
+	tmplt.height0 = size;
+	tmplt.depth0 = 1;
+	tmplt.array_size = 1;
+	tmplt.bind = bind;
+	tmplt.usage = usage;
+
+	return p->screen->resource_create(p->screen, &tmplt);
+}
+
+/* Fills the texture with blocks of a repeating byte pattern */
+static void
+fill(struct program *p, struct pipe_resource *tex, unsigned size)
+{
+	const unsigned block_rows = util_format_get_nblocksy(tex->format, size);
+	const unsigned row_bytes = util_format_get_stride(tex->format, size);
+	struct pipe_transfer *xfer;
+	uint8_t *map;
+	unsigned x, y;
+
+	map = pipe_transfer_map(p->pipe, tex, 0, 0,
+				PIPE_TRANSFER_WRITE |
+				PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+				0, 0, size, size, &xfer);
+
+	for (y = 0; y < block_rows; y++)
+		for (x = 0; x < row_bytes; x++)
+			map[y * xfer->stride + x] = (x * 7 + y * 13) & 0xff;
+
+	pipe_transfer_unmap(p->pipe, xfer);
+}
+
+static void
+finish(struct program *p)
+{
+	struct pipe_fence_handle *fence = NULL;
+
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+	p->screen->fence_reference(p->screen, &fence, NULL);
+}
+
+/* Blits the texture to a linear RGBA8 one and copies it out */
+static void
+read_blit(struct program *p, struct pipe_resource *tex,
+	  struct pipe_resource *linear, uint8_t *dst, unsigned size)
+{
+	const unsigned stride = size * 4;
+	struct pipe_blit_info info;
+	struct pipe_transfer *xfer;
+	const uint8_t *map;
+	unsigned y;
+
+	memset(&info, 0, sizeof(info));
+	info.dst.resource = linear;
+	info.dst.format = linear->format;
+	info.dst.box.width = size;
+	info.dst.box.height = size;
+	info.dst.box.depth = 1;
+	info.src.resource = tex;
+	info.src.format = tex->format;
+	info.src.box = info.dst.box;
+	info.mask = PIPE_MASK_RGBA;
+	info.filter = PIPE_TEX_FILTER_NEAREST;
+
+	p->pipe->blit(p->pipe, &info);
+	finish(p);
+
+	map = pipe_transfer_map(p->pipe, linear, 0, 0, PIPE_TRANSFER_READ,
+				0, 0, size, size, &xfer);
+
+	for (y = 0; y < size; y++)
+		memcpy(dst + y * stride, map + y * xfer->stride, stride);
+
+	pipe_transfer_unmap(p->pipe, xfer);
+}
+
+/* Decodes the mapped texture to floats and packs those to RGBA8 */
+static void
+read_cpu(struct program *p, struct pipe_resource *tex, float *tmp,
+	 uint8_t *dst, unsigned size)
+{
+	struct pipe_transfer *xfer;
+	const uint8_t *map;
+
+	map = pipe_transfer_map(p->pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+				0, 0, size, size, &xfer);
+
+	util_format_read_4f(tex->format, tmp, size * 4 * sizeof(float),
+			    map, xfer->stride, 0, 0, size, size);
+	util_format_write_4f(PIPE_FORMAT_R8G8B8A8_UNORM,
+			     tmp, size * 4 * sizeof(float),
+			     dst, size * 4, 0, 0, size, size);
+
+	pipe_transfer_unmap(p->pipe, xfer);
+}
+
+static double
+mpixels_per_s(int64_t ns, unsigned size)
+{
+	return (double) size * size / (ns / 1000.0);
+}
+
+static void
+bench(struct program *p, enum pipe_format format, unsigned size)
+{
+	struct pipe_resource *tex, *linear;
+	int64_t best[2] = { INT64_MAX, INT64_MAX };
+	uint8_t *dst = MALLOC(size * size * 4);
+	float *tmp = MALLOC(size * size * 4 * sizeof(float));
+	unsigned i;
+
+	tex = create_texture(p, format, size, PIPE_BIND_SAMPLER_VIEW,
+			     PIPE_USAGE_DEFAULT);
+	linear = create_texture(p, PIPE_FORMAT_R8G8B8A8_UNORM, size,
+				PIPE_BIND_RENDER_TARGET, PIPE_USAGE_STAGING);
+	if (!tex || !linear || !dst || !tmp) {
+		printf("%-18s %4u: skipped\n",
+		       util_format_short_name(format), size);
+		goto out;
+	}
+
+	fill(p, tex, size);
+
+	for (i = 0; i < 3; i++) {
+		int64_t start;
+
+		start = os_time_get_nano();
+		read_blit(p, tex, linear, dst, size);
+		best[0] = MIN2(best[0], os_time_get_nano() - start);
+
+		start = os_time_get_nano();
+		read_cpu(p, tex, tmp, dst, size);
+		best[1] = MIN2(best[1], os_time_get_nano() - start);
+	}
+
+	printf("%-18s %4u: blit %7.1f, cpu decode %7.1f Mpixels/s\n",
+	       util_format_short_name(format), size,
+	       mpixels_per_s(best[0], size), mpixels_per_s(best[1], size));
+
+out:
+	pipe_resource_reference(&tex, NULL);
+	pipe_resource_reference(&linear, NULL);
+	FREE(tmp);
+	FREE(dst);
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	unsigned i, j;
+	int ret;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev);
+	assert(p->screen);
+
+	p->pipe = p->screen->context_create(p->screen, NULL, 0);
+
+	printf("%s, PIPE_CAP_PREFER_CPU_TEXTURE_TRANSFER = %d\n",
+	       p->screen->get_name(p->screen),
+	       p->screen->get_param(p->screen,
+				    PIPE_CAP_PREFER_CPU_TEXTURE_TRANSFER));
+
+	for (i = 0; i < ARRAY_SIZE(formats); i++) {
+		if (!p->screen->is_format_supported(p->screen, formats[i],
+						    PIPE_TEXTURE_2D, 0, 0,
+						    PIPE_BIND_SAMPLER_VIEW))
+			continue;
+
+		for (j = 0; j < ARRAY_SIZE(sizes); j++)
+			bench(p, formats[i], sizes[j]);
+	}
+
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+
+	return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Round trips a synthetic image through the BCn encoder and the gallium
+ * decoders, checking the PSNR and reporting the throughput of each quality
+ * level.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/os_time.h"
+#include "util/texcompress_bcn.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+
+/* Not a multiple of 4, to cover the partial blocks */
+#define WIDTH  254
+#define HEIGHT 250
+
+struct bcn_test {
+   enum pipe_format format;
+   enum util_bcn_format bcn;
+   unsigned num_channels;
+   float min_psnr[3];   /* per quality, a dB under what it does today */
+};
+
+static const struct bcn_test tests[] = {
+   { PIPE_FORMAT_DXT1_RGB,        UTIL_BCN_BC1_RGB,     3, { 38.5, 38.5, 38.5 } },
+   { PIPE_FORMAT_DXT1_RGBA,       UTIL_BCN_BC1_RGBA,    4, { 43.5, 43.5, 43.5 } },
+   { PIPE_FORMAT_DXT3_RGBA,       UTIL_BCN_BC2,         4, { 37, 37, 37 } },
+   { PIPE_FORMAT_DXT5_RGBA,       UTIL_BCN_BC3,         4, { 40, 40, 40 } },
+   { PIPE_FORMAT_RGTC1_UNORM,     UTIL_BCN_BC4_UNORM,   1, { 48.5, 49.5, 49.5 } },
+   { PIPE_FORMAT_RGTC1_SNORM,     UTIL_BCN_BC4_SNORM,   1, { 48.5, 49.5, 49.5 } },
+   { PIPE_FORMAT_RGTC2_UNORM,     UTIL_BCN_BC5_UNORM,   2, { 49.5, 50.5, 50.5 } },
+   { PIPE_FORMAT_RGTC2_SNORM,     UTIL_BCN_BC5_SNORM,   2, { 49.5, 50.5, 50.5 } },
+   { PIPE_FORMAT_BPTC_RGBA_UNORM, UTIL_BCN_BC7,         4, { 42.5, 42.5, 42.5 } },
+   { PIPE_FORMAT_BPTC_RGB_UFLOAT, UTIL_BCN_BC6H_UFLOAT, 3, { 38.5, 38.5, 38.5 } },
+   { PIPE_FORMAT_BPTC_RGB_FLOAT,  UTIL_BCN_BC6H_SFLOAT, 3, { 44.5, 44.5, 44.5 } },
+};
+
+static const char *quality_names[] = { "fast", "normal", "high" };
+
+/* Smooth gradients, hard edges and some noise, values in [0, 1] */
+static void
+make_image(float *image)
+{
+   srand(0);
+
+   for (unsigned y = 0; y < HEIGHT; y++) {
+      for (unsigned x = 0; x < WIDTH; x++) {
+         float *p = image + 4 * (y * WIDTH + x);
+         const float noise = (rand() % 1024) / 1024.0f * 0.04f;
+         const bool inside = (x - 96) * (x - 96) + (y - 128) * (y - 128) <
+                             48 * 48;
+
+         p[0] = 0.5f + 0.45f * sinf(x * 0.05f) * cosf(y * 0.031f);
+         p[1] = 0.5f + 0.45f * sinf((x + y) * 0.021f);
+         p[2] = (float) y / HEIGHT;
+         p[3] = inside ? 0.2f : (float) x / WIDTH;
+
+         if (inside) {
+            p[0] = 1.0f - p[0];
+            p[2] *= 0.25f;
+         }
+         if ((x / 32 + y / 32) % 5 == 0)
+            p[1] *= 0.3f;
+
+         for (unsigned c = 0; c < 3; c++)
+            p[c] = CLAMP(p[c] + noise, 0.0f, 1.0f);
+      }
+   }
+}
+
+/* Maps the test image to the input of the encoder, and back to [0, 1] */
+static float
+to_unit(const struct bcn_test *test, float v)
+{
+   switch (test->bcn) {
+   case UTIL_BCN_BC4_SNORM:
+   case UTIL_BCN_BC5_SNORM:
+      return (v + 1.0f) * 0.5f;
+   case UTIL_BCN_BC6H_UFLOAT:
+      /* Tone mapped, so that all exposures count */
+      return v / (1.0f + v);
+   case UTIL_BCN_BC6H_SFLOAT:
+      return 0.5f + 0.5f * v / (1.0f + fabsf(v));
+   default:
+      return v;
+   }
+}
+
+static float
+from_image(const struct bcn_test *test, float v, unsigned c)
+{
+   switch (test->bcn) {
+   case UTIL_BCN_BC4_SNORM:
+   case UTIL_BCN_BC5_SNORM:
+      return v * 2.0f - 1.0f;
+   case UTIL_BCN_BC6H_UFLOAT:
+      return exp2f(v * 16.0f - 6.0f);
+   case UTIL_BCN_BC6H_SFLOAT:
+      /* Crossing zero within a block is hopeless, and rare. */
+      return (c == 1 ? -1.0f : 1.0f) * exp2f(v * 16.0f - 6.0f);
+   default:
+      return v;
+   }
+}
+
+static bool
+test_format(const struct bcn_test *test, const float *image)
+{
+   const struct util_format_description *desc =
+      util_format_description(test->format);
+   const bool is_float = test->bcn == UTIL_BCN_BC6H_UFLOAT ||
+                         test->bcn == UTIL_BCN_BC6H_SFLOAT;
+   const unsigned src_bytes = is_float ? sizeof(float) : 1;
+   const unsigned dst_stride = DIV_ROUND_UP(WIDTH, 4) * desc->block.bits / 8;
+   float *src_float = malloc(WIDTH * HEIGHT * 4 * sizeof(float));
+   uint8_t *src = malloc(WIDTH * HEIGHT * 4);
+   uint8_t *dst = malloc(dst_stride * DIV_ROUND_UP(HEIGHT, 4));
+   /* The decoders write whole blocks */
+   const unsigned decoded_stride = align(WIDTH, 4) * 4;
+   float *decoded = malloc(decoded_stride * align(HEIGHT, 4) * sizeof(float));
+   bool success = true;
+
+   for (unsigned i = 0; i < WIDTH * HEIGHT * 4; i++) {
+      const float v = from_image(test, image[i], i % 4);
+
+      src_float[i] = v;
+      if (test->bcn == UTIL_BCN_BC4_SNORM || test->bcn == UTIL_BCN_BC5_SNORM)
+         src[i] = (int8_t) lroundf(v * 127.0f);
+      else
+         src[i] = lroundf(v * 255.0f);
+   }
+
+   /* BC1 only has 1-bit alpha, and transparent texels are black. */
+   if (test->bcn == UTIL_BCN_BC1_RGBA) {
+      for (unsigned i = 0; i < WIDTH * HEIGHT; i++) {
+         if (src[4 * i + 3] < 128)
+            memset(&src[4 * i], 0, 4);
+         else
+            src[4 * i + 3] = 255;
+      }
+   }
+
+   for (unsigned q = 0; q < ARRAY_SIZE(quality_names); q++) {
+      int64_t best = INT64_MAX;
+      double err = 0.0;
+
+      for (unsigned i = 0; i < 3; i++) {
+         const int64_t start = os_time_get_nano();
+
+         util_bcn_compress(test->bcn, q, WIDTH, HEIGHT,
+                           is_float ? (const void *) src_float : src, 4,
+                           WIDTH * 4 * src_bytes, dst, dst_stride);
+         best = MIN2(best, os_time_get_nano() - start);
+      }
+
+      desc->unpack_rgba_float(decoded, decoded_stride * sizeof(float),
+                              dst, dst_stride, WIDTH, HEIGHT);
+
+      for (unsigned i = 0; i < WIDTH * HEIGHT; i++) {
+         const float *p = decoded + i / WIDTH * decoded_stride + i % WIDTH * 4;
+
+         for (unsigned c = 0; c < test->num_channels; c++) {
+            const float ref = is_float ? src_float[4 * i + c] :
+               test->bcn == UTIL_BCN_BC4_SNORM ||
+               test->bcn == UTIL_BCN_BC5_SNORM ?
+               MAX2((int8_t) src[4 * i + c] / 127.0f, -1.0f) :
+               src[4 * i + c] / 255.0f;
+            const float d = to_unit(test, p[c]) -
+                            to_unit(test, ref);
+
+            err += d * d;
+         }
+      }
+
+      const double mse = err / (WIDTH * HEIGHT * test->num_channels);
+      const double psnr = mse > 0.0 ? 10.0 * log10(1.0 / mse) : 99.0;
+
+      printf("%-28s %-6s %6.2f dB %8.1f MB/s\n", desc->short_name,
+             quality_names[q], psnr,
+             WIDTH * HEIGHT * 4.0 * src_bytes / (best / 1000.0));
+
+      if (psnr < test->min_psnr[q]) {
+         printf("FAILED: expected at least %.1f dB\n", test->min_psnr[q]);
+         success = false;
+      }
+   }
+
+   free(src_float);
+   free(src);
+   free(dst);
+   free(decoded);
+
+   return success;
+}
+
+int
+main(int argc, char **argv)
+{
+   float *image = malloc(WIDTH * HEIGHT * 4 * sizeof(float));
+   bool success = true;
+
+   make_image(image);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(tests); i++)
+      success &= test_format(&tests[i], image);
+
+   free(image);
+
+   return success ? 0 : 1;
+}
@@ -29,11 +29,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
+#include <math.h>
 
+#include "util/os_time.h"
 #include "util/u_half.h"
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
+#include "util/u_tile.h"
 
 
 static boolean
@@ -668,6 +672,438 @@ test_format_pack_s_8uint(const struct util_format_description *format_desc,
 }
 
 
+#define ROW_WIDTH 67
+
+
+static float
+random_float(void)
+{
+   static const float special[] = {
+      0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 1.0f/255.0f, 65024.0f, 65536.0f,
+      1e-8f, 1e-40f, INFINITY, -INFINITY, NAN,
+   };
+   union fi f;
+
+   switch (rand() % 4) {
+   case 0:
+      return special[rand() % ARRAY_SIZE(special)];
+   case 1:
+      f.ui = (uint32_t)rand() << 16 ^ rand();
+      return f.f;
+   default:
+      return (float)rand() / RAND_MAX * 1.5f - 0.25f;
+   }
+}
+
+
+static boolean
+compare_row(const struct util_format_description *format_desc,
+            const char *name, const void *row, const void *pixels,
+            unsigned size)
+{
+   if (memcmp(row, pixels, size) == 0)
+      return TRUE;
+
+   printf("FAILED: util_format_%s_%s differs when converting whole rows\n",
+          format_desc->short_name, name);
+   return FALSE;
+}
+
+
+/*
+ * Convert random rows at once, which goes through the vector kernels of the
+ * formats which have them, and one pixel at a time, which doesn't.  The
+ * results must be exactly the same.
+ */
+static boolean
+test_format_rows(const struct util_format_description *format_desc)
+{
+   const unsigned bpp = format_desc->block.bits / 8;
+   uint8_t packed[ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+   float unpacked[ROW_WIDTH][4];
+   uint8_t unpacked_8unorm[ROW_WIDTH][4];
+   union {
+      uint8_t packed[ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+      float unpacked[ROW_WIDTH][4];
+      uint8_t unpacked_8unorm[ROW_WIDTH][4];
+   } row;
+   unsigned i, x;
+   boolean success = TRUE;
+
+   if (format_desc->block.width != 1 || format_desc->block.height != 1)
+      return TRUE;
+
+   for (i = 0; i < sizeof packed; i++)
+      packed[i] = rand();
+   for (x = 0; x < ROW_WIDTH; x++) {
+      for (i = 0; i < 4; i++) {
+         unpacked[x][i] = random_float();
+         unpacked_8unorm[x][i] = rand();
+      }
+   }
+
+   if (format_desc->unpack_rgba_float) {
+      float pixels[ROW_WIDTH][4];
+
+      memset(&row, 0, sizeof row);
+      memset(pixels, 0, sizeof pixels);
+      format_desc->unpack_rgba_float(&row.unpacked[0][0], 0, packed, 0,
+                                     ROW_WIDTH, 1);
+      for (x = 0; x < ROW_WIDTH; x++)
+         format_desc->unpack_rgba_float(pixels[x], 0, packed + x * bpp, 0, 1, 1);
+      success &= compare_row(format_desc, "unpack_rgba_float",
+                             row.unpacked, pixels, sizeof pixels);
+   }
+
+   if (format_desc->pack_rgba_float) {
+      uint8_t pixels[ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+
+      memset(&row, 0, sizeof row);
+      memset(pixels, 0, sizeof pixels);
+      format_desc->pack_rgba_float(row.packed, 0, &unpacked[0][0], 0,
+                                   ROW_WIDTH, 1);
+      for (x = 0; x < ROW_WIDTH; x++)
+         format_desc->pack_rgba_float(pixels + x * bpp, 0, unpacked[x], 0, 1, 1);
+      success &= compare_row(format_desc, "pack_rgba_float",
+                             row.packed, pixels, ROW_WIDTH * bpp);
+   }
+
+   if (format_desc->unpack_rgba_8unorm) {
+      uint8_t pixels[ROW_WIDTH][4];
+
+      memset(&row, 0, sizeof row);
+      memset(pixels, 0, sizeof pixels);
+      format_desc->unpack_rgba_8unorm(&row.unpacked_8unorm[0][0], 0, packed, 0,
+                                      ROW_WIDTH, 1);
+      for (x = 0; x < ROW_WIDTH; x++)
+         format_desc->unpack_rgba_8unorm(pixels[x], 0, packed + x * bpp, 0, 1, 1);
+      success &= compare_row(format_desc, "unpack_rgba_8unorm",
+                             row.unpacked_8unorm, pixels, sizeof pixels);
+   }
+
+   if (format_desc->pack_rgba_8unorm) {
+      uint8_t pixels[ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+
+      memset(&row, 0, sizeof row);
+      memset(pixels, 0, sizeof pixels);
+      format_desc->pack_rgba_8unorm(row.packed, 0, &unpacked_8unorm[0][0], 0,
+                                    ROW_WIDTH, 1);
+      for (x = 0; x < ROW_WIDTH; x++)
+         format_desc->pack_rgba_8unorm(pixels + x * bpp, 0, unpacked_8unorm[x], 0, 1, 1);
+      success &= compare_row(format_desc, "pack_rgba_8unorm",
+                             row.packed, pixels, ROW_WIDTH * bpp);
+   }
+
+   return success;
+}
+
+
+/*
+ * Get a tile away from the origin of a random image with
+ * pipe_get_tile_rgba_format(), the way softpipe's texture tile cache does,
+ * and compare it with the same pixels of the whole image unpacked at once.
+ * This catches tiles of compressed and subsampled formats being read from
+ * the wrong blocks.
+ */
+static boolean
+test_format_tile(const struct util_format_description *format_desc)
+{
+   const unsigned bw = format_desc->block.width;
+   const unsigned bh = format_desc->block.height;
+   const unsigned width = 6 * bw, height = 4 * bh;
+   const unsigned x = 2 * bw, y = bh, w = 3 * bw, h = 2 * bh;
+   const unsigned stride = 6 * format_desc->block.bits / 8;
+   struct pipe_transfer transfer;
+   uint8_t packed[4 * 6 * UTIL_FORMAT_MAX_PACKED_BYTES];
+   float *image, *tile;
+   unsigned i, j;
+   boolean success = TRUE;
+
+   if (!format_desc->unpack_rgba_float ||
+       util_format_is_depth_or_stencil(format_desc->format))
+      return TRUE;
+
+   for (i = 0; i < sizeof packed; i++)
+      packed[i] = rand();
+
+   image = calloc(width * height, 4 * sizeof(float));
+   tile = calloc(w * h, 4 * sizeof(float));
+
+   format_desc->unpack_rgba_float(image, width * 4 * sizeof(float),
+                                  packed, stride, width, height);
+
+   memset(&transfer, 0, sizeof transfer);
+   transfer.box.width = width;
+   transfer.box.height = height;
+   transfer.box.depth = 1;
+   transfer.stride = stride;
+   pipe_get_tile_rgba_format(&transfer, packed, x, y, w, h,
+                             format_desc->format, tile);
+
+   for (j = 0; j < h; j++) {
+      if (memcmp(&tile[j * w * 4], &image[((y + j) * width + x) * 4],
+                 w * 4 * sizeof(float)) != 0) {
+         printf("FAILED: pipe_get_tile_rgba_format differs for a tile of "
+                "%s at %u,%u\n", format_desc->short_name, x, y);
+         success = FALSE;
+         break;
+      }
+   }
+
+   free(image);
+   free(tile);
+
+   return success;
+}
+
+
+typedef void
+(*convert_func_t)(void *dst, unsigned dst_stride,
+                  const void *src, unsigned src_stride,
+                  unsigned width, unsigned height);
+
+
+/*
+ * Returns how many bytes of packed pixels a pack or unpack function goes
+ * through per second, in GB/s.
+ */
+static double
+benchmark_func(const struct util_format_description *format_desc,
+               convert_func_t func, boolean pack, unsigned unpacked_bpp)
+{
+   const unsigned width = 1024, height = 64;
+   const unsigned packed_stride = width * format_desc->block.bits / 8;
+   const unsigned unpacked_stride = width * unpacked_bpp;
+   uint8_t *packed = calloc(packed_stride, height);
+   uint8_t *unpacked = calloc(unpacked_stride, height);
+   unsigned iterations = 0;
+   int64_t start, elapsed;
+
+   start = os_time_get_nano();
+   do {
+      if (pack)
+         func(packed, packed_stride, unpacked, unpacked_stride, width, height);
+      else
+         func(unpacked, unpacked_stride, packed, packed_stride, width, height);
+      iterations++;
+      elapsed = os_time_get_nano() - start;
+   } while (elapsed < 20000000);
+
+   free(packed);
+   free(unpacked);
+
+   return (double)packed_stride * height * iterations / elapsed;
+}
+
+
+static void
+benchmark_format(const struct util_format_description *format_desc)
+{
+   if (format_desc->block.width != 1 || format_desc->block.height != 1)
+      return;
+
+   if (!format_desc->unpack_rgba_float && !format_desc->unpack_rgba_8unorm)
+      return;
+
+   printf("%-32s", format_desc->short_name);
+
+#  define BENCHMARK_FUNC(name, pack, unpacked_bpp) \
+   if (format_desc->name) { \
+      printf(" %6.2f", benchmark_func(format_desc, \
+                                      (convert_func_t)format_desc->name, \
+                                      pack, unpacked_bpp)); \
+   } else { \
+      printf("      -"); \
+   }
+
+   BENCHMARK_FUNC(unpack_rgba_float, FALSE, 16);
+   BENCHMARK_FUNC(pack_rgba_float, TRUE, 16);
+   BENCHMARK_FUNC(unpack_rgba_8unorm, FALSE, 4);
+   BENCHMARK_FUNC(pack_rgba_8unorm, TRUE, 4);
+
+#  undef BENCHMARK_FUNC
+
+   printf("\n");
+}
+
+
+/*
+ * What util_format_translate() does for formats without a direct
+ * conversion: unpack each row to RGBA and pack it again.
+ */
+static void
+translate_via_rgba(const struct util_format_description *dst_format_desc,
+                   void *dst, unsigned dst_stride,
+                   const struct util_format_description *src_format_desc,
+                   const void *src, unsigned src_stride,
+                   unsigned width, unsigned height)
+{
+   uint8_t *dst_row = dst;
+   const uint8_t *src_row = src;
+   void *tmp = calloc(width, 4 * sizeof(float));
+
+   while (height--) {
+      if (util_format_fits_8unorm(src_format_desc) ||
+          util_format_fits_8unorm(dst_format_desc)) {
+         src_format_desc->unpack_rgba_8unorm(tmp, 0, src_row, 0, width, 1);
+         dst_format_desc->pack_rgba_8unorm(dst_row, 0, tmp, 0, width, 1);
+      } else {
+         src_format_desc->unpack_rgba_float(tmp, 0, src_row, 0, width, 1);
+         dst_format_desc->pack_rgba_float(dst_row, 0, tmp, 0, width, 1);
+      }
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   free(tmp);
+}
+
+
+static void
+fill_random(const struct util_format_description *format_desc,
+            void *data, unsigned size)
+{
+   unsigned i;
+
+   if (format_desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT &&
+       format_desc->channel[0].size == 32) {
+      for (i = 0; i < size / 4; i++)
+         ((float *)data)[i] = random_float();
+   } else {
+      for (i = 0; i < size; i++)
+         ((uint8_t *)data)[i] = rand();
+   }
+}
+
+
+#define TRANSLATE_HEIGHT 2
+
+/*
+ * Check that the format pairs util_format_translate() converts directly give
+ * the same results as going through RGBA.
+ */
+static boolean
+test_translate_direct(void)
+{
+   enum pipe_format dst_format, src_format;
+   const unsigned width = ROW_WIDTH, height = TRANSLATE_HEIGHT;
+   const unsigned stride = width * UTIL_FORMAT_MAX_PACKED_BYTES;
+   uint8_t src[TRANSLATE_HEIGHT][ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+   uint8_t dst[TRANSLATE_HEIGHT][ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+   uint8_t ref[TRANSLATE_HEIGHT][ROW_WIDTH * UTIL_FORMAT_MAX_PACKED_BYTES];
+   boolean success = TRUE;
+
+   for (dst_format = 1; dst_format < PIPE_FORMAT_COUNT; ++dst_format) {
+      const struct util_format_description *dst_format_desc =
+         util_format_description(dst_format);
+
+      for (src_format = 1; src_format < PIPE_FORMAT_COUNT; ++src_format) {
+         const struct util_format_description *src_format_desc =
+            util_format_description(src_format);
+
+         /* Compatible formats are merely copied */
+         if (!util_format_translate_is_direct(dst_format, src_format) ||
+             util_is_format_compatible(src_format_desc, dst_format_desc))
+            continue;
+
+         fill_random(src_format_desc, src, sizeof src);
+         memset(dst, 0, sizeof dst);
+         memset(ref, 0, sizeof ref);
+
+         util_format_translate(dst_format, dst, stride, 0, 0,
+                               src_format, src, stride, 0, 0,
+                               width, height);
+         translate_via_rgba(dst_format_desc, ref, stride,
+                            src_format_desc, src, stride, width, height);
+
+         if (memcmp(dst, ref, sizeof dst) != 0) {
+            printf("FAILED: util_format_translate from %s to %s differs "
+                   "from going through RGBA\n",
+                   src_format_desc->short_name, dst_format_desc->short_name);
+            success = FALSE;
+         }
+      }
+   }
+
+   return success;
+}
+
+
+/*
+ * Prints the throughput of util_format_translate() for texture upload style
+ * conversions, in Mpixels/s, and whether they are done directly.
+ */
+static void
+benchmark_translate(void)
+{
+   static const struct {
+      enum pipe_format src_format, dst_format;
+   } pairs[] = {
+      { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+      { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_B5G6R5_UNORM },
+      { PIPE_FORMAT_R8G8B8_UNORM, PIPE_FORMAT_B8G8R8X8_UNORM },
+      { PIPE_FORMAT_R8G8B8_UNORM, PIPE_FORMAT_B5G6R5_UNORM },
+      { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM },
+      { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_B5G6R5_UNORM },
+      { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_R16G16B16A16_FLOAT },
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R16G16B16A16_FLOAT },
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R11G11B10_FLOAT },
+      { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   };
+   const unsigned width = 1024, height = 256;
+   const unsigned stride = width * 16;
+   uint8_t *src = calloc(stride, height);
+   uint8_t *dst = calloc(stride, height);
+   unsigned i;
+
+   printf("\n%-48s %8s %8s\n", "Mpixels/s", "translate", "via RGBA");
+
+   for (i = 0; i < ARRAY_SIZE(pairs); i++) {
+      const struct util_format_description *src_format_desc =
+         util_format_description(pairs[i].src_format);
+      const struct util_format_description *dst_format_desc =
+         util_format_description(pairs[i].dst_format);
+      unsigned iterations;
+      int64_t start, elapsed;
+      double direct;
+      char name[64];
+
+      fill_random(src_format_desc, src, stride * height);
+
+      iterations = 0;
+      start = os_time_get_nano();
+      do {
+         util_format_translate(pairs[i].dst_format, dst, stride, 0, 0,
+                               pairs[i].src_format, src, stride, 0, 0,
+                               width, height);
+         iterations++;
+         elapsed = os_time_get_nano() - start;
+      } while (elapsed < 20000000);
+      direct = (double)width * height * iterations / elapsed * 1000.0;
+
+      iterations = 0;
+      start = os_time_get_nano();
+      do {
+         translate_via_rgba(dst_format_desc, dst, stride,
+                            src_format_desc, src, stride, width, height);
+         iterations++;
+         elapsed = os_time_get_nano() - start;
+      } while (elapsed < 20000000);
+
+      snprintf(name, sizeof name, "%s -> %s%s", src_format_desc->short_name,
+               dst_format_desc->short_name,
+               util_format_translate_is_direct(pairs[i].dst_format,
+                                               pairs[i].src_format) ?
+               " (direct)" : "");
+      printf("%-48s %8.1f %8.1f\n", name, direct,
+             (double)width * height * iterations / elapsed * 1000.0);
+   }
+
+   free(src);
+   free(dst);
+}
+
+
 typedef boolean
 (*test_func_t)(const struct util_format_description *format_desc,
                const struct util_format_test_case *test);
@@ -738,17 +1174,59 @@ test_all(void)
       TEST_ONE_FUNC(pack_s_8uint);
 
 #     undef TEST_ONE_FUNC
+
+      if (!test_format_rows(format_desc)) {
+         success = FALSE;
+      }
+
+      if (!test_format_tile(format_desc)) {
+         success = FALSE;
+      }
+   }
+
+   if (!test_translate_direct()) {
+      success = FALSE;
    }
 
    return success;
 }
 
 
+/*
+ * Prints the throughput of the pack and unpack functions of every format,
+ * in GB/s of packed pixels, and of util_format_translate().
+ */
+static void
+benchmark_all(void)
+{
+   enum pipe_format format;
+
+   printf("%-32s %6s %6s %6s %6s\n", "GB/s", "unpack", "pack",
+          "unpack", "pack");
+   printf("%-32s %6s %6s %6s %6s\n", "", "float", "float", "8unorm", "8unorm");
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+      const struct util_format_description *format_desc;
+
+      format_desc = util_format_description(format);
+      if (format_desc) {
+         benchmark_format(format_desc);
+      }
+   }
+
+   benchmark_translate();
+}
+
+
 int main(int argc, char **argv)
 {
    boolean success;
 
    success = test_all();
 
+   if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+      benchmark_all();
+   }
+
    return success ? 0 : 1;
 }
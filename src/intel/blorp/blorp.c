@@ -35,6 +35,7 @@ blorp_init(struct blorp_context *blorp, void *driver_ctx,
 {
    blorp->driver_ctx = driver_ctx;
    blorp->isl_dev = isl_dev;
+   blorp->program_cache = NULL;
 }
 
 void
@@ -276,8 +277,8 @@ blorp_ensure_sf_program(struct blorp_context *blorp,
    memcpy(key.key.interp_mode, wm_prog_data->interp_mode,
           sizeof(key.key.interp_mode));
 
-   if (blorp->lookup_shader(blorp, &key, sizeof(key),
-                            &params->sf_prog_kernel, &params->sf_prog_data))
+   if (blorp_lookup_shader(blorp, &key, sizeof(key),
+                           &params->sf_prog_kernel, &params->sf_prog_data))
       return true;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -293,9 +294,9 @@ blorp_ensure_sf_program(struct blorp_context *blorp,
                             &prog_data_tmp, &vue_map, &program_size);
 
    bool result =
-      blorp->upload_shader(blorp, &key, sizeof(key), program, program_size,
-                           (void *)&prog_data_tmp, sizeof(prog_data_tmp),
-                           &params->sf_prog_kernel, &params->sf_prog_data);
+      blorp_upload_shader(blorp, &key, sizeof(key), program, program_size,
+                          (void *)&prog_data_tmp, sizeof(prog_data_tmp),
+                          &params->sf_prog_kernel, &params->sf_prog_data);
 
    ralloc_free(mem_ctx);
 
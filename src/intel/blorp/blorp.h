@@ -30,6 +30,7 @@
 #include "isl/isl.h"
 
 struct brw_stage_prog_data;
+struct disk_cache;
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,6 +38,7 @@ extern "C" {
 
 struct blorp_batch;
 struct blorp_params;
+struct blorp_program_cache;
 
 struct blorp_context {
    void *driver_ctx;
@@ -55,12 +57,29 @@ struct blorp_context {
                          uint32_t prog_data_size,
                          uint32_t *kernel_out, void *prog_data_out);
    void (*exec)(struct blorp_batch *batch, const struct blorp_params *params);
+
+   /**
+    * Optional cache of compiled programs, looked up when lookup_shader()
+    * fails before compiling anything.  NULL after blorp_init().
+    */
+   struct blorp_program_cache *program_cache;
 };
 
 void blorp_init(struct blorp_context *blorp, void *driver_ctx,
                 struct isl_device *isl_dev);
 void blorp_finish(struct blorp_context *blorp);
 
+/**
+ * Create a cache of compiled BLORP programs which can be shared by all the
+ * blorp_contexts of a device, from any thread.  If disk_cache isn't NULL,
+ * programs are also stored there and the ones compiled by previous runs are
+ * loaded in the background.
+ */
+struct blorp_program_cache *
+blorp_program_cache_create(struct disk_cache *disk_cache);
+
+void blorp_program_cache_destroy(struct blorp_program_cache *cache);
+
 enum blorp_batch_flags {
    /**
     * This flag indicates that blorp should *not* re-emit the depth and
@@ -1431,8 +1431,8 @@ brw_blorp_get_blit_kernel(struct blorp_context *blorp,
                           struct blorp_params *params,
                           const struct brw_blorp_blit_prog_key *prog_key)
 {
-   if (blorp->lookup_shader(blorp, prog_key, sizeof(*prog_key),
-                            &params->wm_prog_kernel, &params->wm_prog_data))
+   if (blorp_lookup_shader(blorp, prog_key, sizeof(*prog_key),
+                           &params->wm_prog_kernel, &params->wm_prog_data))
       return true;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -1454,10 +1454,10 @@ brw_blorp_get_blit_kernel(struct blorp_context *blorp,
                               &prog_data);
 
    bool result =
-      blorp->upload_shader(blorp, prog_key, sizeof(*prog_key),
-                           program, prog_data.base.program_size,
-                           &prog_data.base, sizeof(prog_data),
-                           &params->wm_prog_kernel, &params->wm_prog_data);
+      blorp_upload_shader(blorp, prog_key, sizeof(*prog_key),
+                          program, prog_data.base.program_size,
+                          &prog_data.base, sizeof(prog_data),
+                          &params->wm_prog_kernel, &params->wm_prog_data);
 
    ralloc_free(mem_ctx);
    return result;
@@ -0,0 +1,467 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file blorp_cache.c
+ *
+ * A cache of compiled BLORP programs that lives next to the driver's own
+ * shader cache.  The driver tables hold the kernels uploaded to the GPU for
+ * a given context, this one holds the compiler output so that a new context
+ * doesn't go through brw_compile_fs() again, and, when given a disk_cache,
+ * so that a new process doesn't either.
+ *
+ * Each program is stored on disk under the hash of its BLORP key.  An extra
+ * index entry lists the keys of the programs compiled so far.  When the
+ * cache is created, a low priority thread loads them in the background, so
+ * that the first blit or clear of a given kind usually only costs an upload.
+ */
+
+#include "compiler/blob.h"
+#include "util/disk_cache.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "util/simple_mtx.h"
+#include "util/u_atomic.h"
+#include "util/u_dynarray.h"
+#include "util/u_queue.h"
+
+#include "blorp_priv.h"
+#include "compiler/brw_compiler.h"
+
+/* Past this many programs, the index only keeps the most recent ones. */
+#define BLORP_CACHE_MAX_INDEXED_PROGRAMS 256
+
+/* The index is rewritten after this many new programs, and when the cache
+ * is destroyed.
+ */
+#define BLORP_CACHE_INDEX_BATCH 16
+
+static const char blorp_cache_index_name[] = "blorp program index";
+
+struct blorp_program {
+   uint32_t key_size;
+   uint32_t kernel_size;
+   uint32_t prog_data_size;
+
+   const void *key;
+   const void *kernel;
+   const void *prog_data;
+};
+
+struct blorp_program_cache {
+   simple_mtx_t mutex;
+   struct hash_table *programs;
+   struct disk_cache *disk_cache;
+
+   /* The programs in the order they were added, for the index. */
+   struct util_dynarray order;
+   /* Number of programs compiled since the index was last written. */
+   uint32_t unindexed;
+
+   /* Loads the programs of the index in the background. */
+   struct util_queue queue;
+   struct util_queue_fence warm_up_fence;
+   /* Set when the cache is destroyed, to cut the loading short. */
+   int destroyed;
+};
+
+static uint32_t
+program_hash(const void *key)
+{
+   const struct blorp_program *program = key;
+   return _mesa_hash_data(program->key, program->key_size);
+}
+
+static bool
+program_equal(const void *a, const void *b)
+{
+   const struct blorp_program *pa = a, *pb = b;
+   return pa->key_size == pb->key_size &&
+          memcmp(pa->key, pb->key, pa->key_size) == 0;
+}
+
+/* Must be called with the cache mutex held. */
+static struct blorp_program *
+search_program(struct blorp_program_cache *cache,
+               const void *key, uint32_t key_size)
+{
+   const struct blorp_program search = {
+      .key = key,
+      .key_size = key_size,
+   };
+
+   struct hash_entry *entry = _mesa_hash_table_search(cache->programs,
+                                                      &search);
+   return entry ? entry->data : NULL;
+}
+
+/* Copies the key, the kernel and the program data into a single allocation.
+ * Must be called with the cache mutex held.
+ */
+static struct blorp_program *
+program_create(struct blorp_program_cache *cache,
+               const void *key, uint32_t key_size,
+               const void *kernel, uint32_t kernel_size,
+               const void *prog_data, uint32_t prog_data_size)
+{
+   struct blorp_program *program =
+      ralloc_size(cache->programs, sizeof(*program) + key_size +
+                                   kernel_size + prog_data_size);
+   if (program == NULL)
+      return NULL;
+
+   /* The program data goes first to keep it aligned. */
+   char *p = (char *)(program + 1);
+   memcpy(p, prog_data, prog_data_size);
+   program->prog_data = p;
+   p += prog_data_size;
+   memcpy(p, kernel, kernel_size);
+   program->kernel = p;
+   p += kernel_size;
+   memcpy(p, key, key_size);
+   program->key = p;
+
+   /* BLORP programs have no uniforms, clear the pointers to the (empty)
+    * parameter arrays so that the program data can be stored as is.
+    */
+   if (*(const enum blorp_shader_type *)key != BLORP_SHADER_TYPE_GEN4_SF) {
+      struct brw_stage_prog_data *stage_prog_data = (void *)(program + 1);
+      assert(stage_prog_data->nr_params == 0 &&
+             stage_prog_data->nr_pull_params == 0);
+      stage_prog_data->param = NULL;
+      stage_prog_data->pull_param = NULL;
+   }
+
+   program->key_size = key_size;
+   program->kernel_size = kernel_size;
+   program->prog_data_size = prog_data_size;
+
+   _mesa_hash_table_insert(cache->programs, program, program);
+   util_dynarray_append(&cache->order, struct blorp_program *, program);
+
+   return program;
+}
+
+static void
+program_disk_key(struct blorp_program_cache *cache,
+                 const void *key, uint32_t key_size, cache_key disk_key)
+{
+   struct blob blob;
+   blob_init(&blob);
+   blob_write_string(&blob, "blorp");
+   blob_write_bytes(&blob, key, key_size);
+   disk_cache_compute_key(cache->disk_cache, blob.data, blob.size, disk_key);
+   blob_finish(&blob);
+}
+
+static void
+write_program(struct blorp_program_cache *cache,
+              const struct blorp_program *program)
+{
+   struct blob blob;
+   blob_init(&blob);
+   blob_write_uint32(&blob, program->key_size);
+   blob_write_bytes(&blob, program->key, program->key_size);
+   blob_write_uint32(&blob, program->kernel_size);
+   blob_write_bytes(&blob, program->kernel, program->kernel_size);
+   blob_write_uint32(&blob, program->prog_data_size);
+   blob_write_bytes(&blob, program->prog_data, program->prog_data_size);
+
+   if (!blob.out_of_memory) {
+      cache_key disk_key;
+      program_disk_key(cache, program->key, program->key_size, disk_key);
+      /* BLORP programs are quick to compile again, unlike the application's
+       * shaders.
+       */
+      disk_cache_put_with_priority(cache->disk_cache, disk_key,
+                                   blob.data, blob.size, NULL,
+                                   DISK_CACHE_PRIORITY_LOW);
+   }
+
+   blob_finish(&blob);
+}
+
+/* Reads a program from the disk cache.  On success, returns the data, which
+ * the caller must free(), and points the fields of *program into it.
+ */
+static void *
+read_program(struct blorp_program_cache *cache,
+             const void *key, uint32_t key_size,
+             struct blorp_program *program)
+{
+   cache_key disk_key;
+   program_disk_key(cache, key, key_size, disk_key);
+
+   size_t size;
+   void *data = disk_cache_get(cache->disk_cache, disk_key, &size);
+   if (data == NULL)
+      return NULL;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, data, size);
+
+   program->key_size = blob_read_uint32(&blob);
+   program->key = blob_read_bytes(&blob, program->key_size);
+   program->kernel_size = blob_read_uint32(&blob);
+   program->kernel = blob_read_bytes(&blob, program->kernel_size);
+   program->prog_data_size = blob_read_uint32(&blob);
+   program->prog_data = blob_read_bytes(&blob, program->prog_data_size);
+
+   if (blob.overrun || blob.current != blob.end ||
+       program->key_size != key_size ||
+       memcmp(program->key, key, key_size) != 0) {
+      /* Corrupted or from a colliding key, get rid of it. */
+      disk_cache_remove(cache->disk_cache, disk_key);
+      free(data);
+      return NULL;
+   }
+
+   return data;
+}
+
+/* Looks a program up in the disk cache and adds it to the in-memory table.
+ * Must be called with the cache mutex held.
+ */
+static struct blorp_program *
+load_program(struct blorp_program_cache *cache,
+             const void *key, uint32_t key_size)
+{
+   struct blorp_program stored;
+   void *data = read_program(cache, key, key_size, &stored);
+   if (data == NULL)
+      return NULL;
+
+   struct blorp_program *program =
+      program_create(cache, key, key_size, stored.kernel, stored.kernel_size,
+                     stored.prog_data, stored.prog_data_size);
+   free(data);
+
+   return program;
+}
+
+/* Writes the keys of the most recent programs to the index.  Must be called
+ * with the cache mutex held.
+ */
+static void
+write_index(struct blorp_program_cache *cache)
+{
+   const uint32_t count =
+      cache->order.size / sizeof(struct blorp_program *);
+   struct blorp_program **programs =
+      util_dynarray_begin(&cache->order);
+
+   const uint32_t first = count > BLORP_CACHE_MAX_INDEXED_PROGRAMS ?
+                          count - BLORP_CACHE_MAX_INDEXED_PROGRAMS : 0;
+
+   struct blob blob;
+   blob_init(&blob);
+   blob_write_uint32(&blob, count - first);
+   for (uint32_t i = first; i < count; i++) {
+      blob_write_uint32(&blob, programs[i]->key_size);
+      blob_write_bytes(&blob, programs[i]->key, programs[i]->key_size);
+   }
+
+   if (!blob.out_of_memory) {
+      cache_key disk_key;
+      disk_cache_compute_key(cache->disk_cache, blorp_cache_index_name,
+                             sizeof(blorp_cache_index_name), disk_key);
+      disk_cache_put(cache->disk_cache, disk_key, blob.data, blob.size, NULL);
+   }
+
+   blob_finish(&blob);
+   cache->unindexed = 0;
+}
+
+/* Loads every program listed in the index.  Runs on the cache's queue, and
+ * only takes the mutex to add a program, so that lookups meanwhile don't wait
+ * for the disk.
+ */
+static void
+warm_up(void *data, int thread_index)
+{
+   struct blorp_program_cache *cache = data;
+
+   cache_key disk_key;
+   disk_cache_compute_key(cache->disk_cache, blorp_cache_index_name,
+                          sizeof(blorp_cache_index_name), disk_key);
+
+   size_t size;
+   void *index = disk_cache_get(cache->disk_cache, disk_key, &size);
+   if (index == NULL)
+      return;
+
+   struct blob_reader blob;
+   blob_reader_init(&blob, index, size);
+
+   uint32_t count = blob_read_uint32(&blob);
+   for (uint32_t i = 0; i < count && !blob.overrun; i++) {
+      if (p_atomic_read(&cache->destroyed))
+         break;
+
+      const uint32_t key_size = blob_read_uint32(&blob);
+      const void *key = blob_read_bytes(&blob, key_size);
+      if (blob.overrun)
+         break;
+
+      /* A context may have needed it already. */
+      simple_mtx_lock(&cache->mutex);
+      bool found = search_program(cache, key, key_size) != NULL;
+      simple_mtx_unlock(&cache->mutex);
+      if (found)
+         continue;
+
+      struct blorp_program stored;
+      void *program_data = read_program(cache, key, key_size, &stored);
+      if (program_data == NULL)
+         continue;
+
+      simple_mtx_lock(&cache->mutex);
+      if (search_program(cache, key, key_size) == NULL) {
+         program_create(cache, key, key_size,
+                        stored.kernel, stored.kernel_size,
+                        stored.prog_data, stored.prog_data_size);
+      }
+      simple_mtx_unlock(&cache->mutex);
+
+      free(program_data);
+   }
+
+   free(index);
+}
+
+struct blorp_program_cache *
+blorp_program_cache_create(struct disk_cache *disk_cache)
+{
+   struct blorp_program_cache *cache =
+      rzalloc(NULL, struct blorp_program_cache);
+   if (cache == NULL)
+      return NULL;
+
+   simple_mtx_init(&cache->mutex, mtx_plain);
+   cache->disk_cache = disk_cache;
+   cache->programs = _mesa_hash_table_create(cache, program_hash,
+                                             program_equal);
+   if (cache->programs == NULL) {
+      ralloc_free(cache);
+      return NULL;
+   }
+
+   util_dynarray_init(&cache->order, cache);
+   util_queue_fence_init(&cache->warm_up_fence);
+
+   /* Without a thread, the programs are only loaded on demand. */
+   if (cache->disk_cache &&
+       util_queue_init(&cache->queue, "blorp", 1, 1,
+                       UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY)) {
+      util_queue_add_job(&cache->queue, cache, &cache->warm_up_fence,
+                         warm_up, NULL);
+   }
+
+   return cache;
+}
+
+void
+blorp_program_cache_destroy(struct blorp_program_cache *cache)
+{
+   if (cache == NULL)
+      return;
+
+   if (util_queue_is_initialized(&cache->queue)) {
+      p_atomic_set(&cache->destroyed, 1);
+      util_queue_fence_wait(&cache->warm_up_fence);
+      util_queue_destroy(&cache->queue);
+   }
+   util_queue_fence_destroy(&cache->warm_up_fence);
+
+   if (cache->unindexed > 0) {
+      write_index(cache);
+      disk_cache_wait_for_idle(cache->disk_cache);
+   }
+
+   simple_mtx_destroy(&cache->mutex);
+   ralloc_free(cache);
+}
+
+bool
+blorp_lookup_shader(struct blorp_context *blorp,
+                    const void *key, uint32_t key_size,
+                    uint32_t *kernel_out, void *prog_data_out)
+{
+   if (blorp->lookup_shader(blorp, key, key_size, kernel_out, prog_data_out))
+      return true;
+
+   struct blorp_program_cache *cache = blorp->program_cache;
+   if (cache == NULL)
+      return false;
+
+   simple_mtx_lock(&cache->mutex);
+
+   const struct blorp_program *program = search_program(cache, key, key_size);
+   if (program == NULL && cache->disk_cache)
+      program = load_program(cache, key, key_size);
+
+   simple_mtx_unlock(&cache->mutex);
+
+   if (program == NULL)
+      return false;
+
+   /* Programs are never removed from the table before the cache gets
+    * destroyed, it's fine to use this one without holding the lock.
+    */
+   return blorp->upload_shader(blorp, key, key_size,
+                               program->kernel, program->kernel_size,
+                               program->prog_data, program->prog_data_size,
+                               kernel_out, prog_data_out);
+}
+
+bool
+blorp_upload_shader(struct blorp_context *blorp,
+                    const void *key, uint32_t key_size,
+                    const void *kernel, uint32_t kernel_size,
+                    const struct brw_stage_prog_data *prog_data,
+                    uint32_t prog_data_size,
+                    uint32_t *kernel_out, void *prog_data_out)
+{
+   struct blorp_program_cache *cache = blorp->program_cache;
+
+   if (cache) {
+      simple_mtx_lock(&cache->mutex);
+
+      /* Another context may have compiled the same program meanwhile. */
+      if (search_program(cache, key, key_size) == NULL) {
+         struct blorp_program *program =
+            program_create(cache, key, key_size, kernel, kernel_size,
+                           prog_data, prog_data_size);
+         if (program && cache->disk_cache) {
+            write_program(cache, program);
+            if (++cache->unindexed >= BLORP_CACHE_INDEX_BATCH)
+               write_index(cache);
+         }
+      }
+
+      simple_mtx_unlock(&cache->mutex);
+   }
+
+   return blorp->upload_shader(blorp, key, key_size, kernel, kernel_size,
+                               prog_data, prog_data_size,
+                               kernel_out, prog_data_out);
+}
@@ -54,8 +54,8 @@ blorp_params_get_clear_kernel(struct blorp_context *blorp,
       .clear_rgb_as_red = clear_rgb_as_red,
    };
 
-   if (blorp->lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
-                            &params->wm_prog_kernel, &params->wm_prog_data))
+   if (blorp_lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
+                           &params->wm_prog_kernel, &params->wm_prog_data))
       return true;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -104,10 +104,10 @@ blorp_params_get_clear_kernel(struct blorp_context *blorp,
                        &prog_data);
 
    bool result =
-      blorp->upload_shader(blorp, &blorp_key, sizeof(blorp_key),
-                           program, prog_data.base.program_size,
-                           &prog_data.base, sizeof(prog_data),
-                           &params->wm_prog_kernel, &params->wm_prog_data);
+      blorp_upload_shader(blorp, &blorp_key, sizeof(blorp_key),
+                          program, prog_data.base.program_size,
+                          &prog_data.base, sizeof(prog_data),
+                          &params->wm_prog_kernel, &params->wm_prog_data);
 
    ralloc_free(mem_ctx);
    return result;
@@ -136,8 +136,8 @@ blorp_params_get_layer_offset_vs(struct blorp_context *blorp,
    if (params->wm_prog_data)
       blorp_key.num_inputs = params->wm_prog_data->num_varying_inputs;
 
-   if (blorp->lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
-                            &params->vs_prog_kernel, &params->vs_prog_data))
+   if (blorp_lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
+                           &params->vs_prog_kernel, &params->vs_prog_data))
       return true;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -194,10 +194,10 @@ blorp_params_get_layer_offset_vs(struct blorp_context *blorp,
       blorp_compile_vs(blorp, mem_ctx, b.shader, &vs_prog_data);
 
    bool result =
-      blorp->upload_shader(blorp, &blorp_key, sizeof(blorp_key),
-                           program, vs_prog_data.base.base.program_size,
-                           &vs_prog_data.base.base, sizeof(vs_prog_data),
-                           &params->vs_prog_kernel, &params->vs_prog_data);
+      blorp_upload_shader(blorp, &blorp_key, sizeof(blorp_key),
+                          program, vs_prog_data.base.base.program_size,
+                          &vs_prog_data.base.base, sizeof(vs_prog_data),
+                          &params->vs_prog_kernel, &params->vs_prog_data);
 
    ralloc_free(mem_ctx);
    return result;
@@ -946,8 +946,8 @@ blorp_params_get_mcs_partial_resolve_kernel(struct blorp_context *blorp,
       .num_samples = params->num_samples,
    };
 
-   if (blorp->lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
-                            &params->wm_prog_kernel, &params->wm_prog_data))
+   if (blorp_lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
+                           &params->wm_prog_kernel, &params->wm_prog_data))
       return true;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -1002,10 +1002,10 @@ blorp_params_get_mcs_partial_resolve_kernel(struct blorp_context *blorp,
                        &prog_data);
 
    bool result =
-      blorp->upload_shader(blorp, &blorp_key, sizeof(blorp_key),
-                           program, prog_data.base.program_size,
-                           &prog_data.base, sizeof(prog_data),
-                           &params->wm_prog_kernel, &params->wm_prog_data);
+      blorp_upload_shader(blorp, &blorp_key, sizeof(blorp_key),
+                          program, prog_data.base.program_size,
+                          &prog_data.base, sizeof(prog_data),
+                          &params->wm_prog_kernel, &params->wm_prog_data);
 
    ralloc_free(mem_ctx);
    return result;
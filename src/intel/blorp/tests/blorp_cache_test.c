@@ -0,0 +1,252 @@
+/*
+ * Copyright 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the programs stored by a blorp_program_cache come back
+ * unchanged from a new cache on top of the same disk cache directory, as
+ * they would in the next run of an application, whether they get loaded by
+ * the background warm-up or on demand.
+ */
+
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blorp/blorp_priv.h"
+#include "compiler/brw_compiler.h"
+#include "util/disk_cache.h"
+
+// An assert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+/* More than a few batches of index writes, and not a multiple of them, so
+ * that the last programs only get indexed when the cache is destroyed.
+ */
+#define NUM_PROGRAMS 45
+
+#define MAX_KERNEL_SIZE 1024
+#define PROG_DATA_SIZE (sizeof(struct brw_stage_prog_data) + 64)
+
+struct program {
+   uint32_t key[4];
+   uint32_t key_size;
+   uint8_t kernel[MAX_KERNEL_SIZE];
+   uint32_t kernel_size;
+   union {
+      struct brw_stage_prog_data base;
+      uint8_t bytes[PROG_DATA_SIZE];
+   } prog_data;
+};
+
+static struct program programs[NUM_PROGRAMS];
+
+/* What the driver got in its last upload_shader() call. */
+static struct program uploaded;
+
+static bool
+lookup_shader(struct blorp_context *blorp,
+              const void *key, uint32_t key_size,
+              uint32_t *kernel_out, void *prog_data_out)
+{
+   /* The driver's own cache always misses, like in a new context. */
+   return false;
+}
+
+static bool
+upload_shader(struct blorp_context *blorp,
+              const void *key, uint32_t key_size,
+              const void *kernel, uint32_t kernel_size,
+              const struct brw_stage_prog_data *prog_data,
+              uint32_t prog_data_size,
+              uint32_t *kernel_out, void *prog_data_out)
+{
+   t_assert(key_size <= sizeof(uploaded.key));
+   t_assert(kernel_size <= sizeof(uploaded.kernel));
+   t_assert(prog_data_size == sizeof(uploaded.prog_data));
+
+   memcpy(uploaded.key, key, key_size);
+   uploaded.key_size = key_size;
+   memcpy(uploaded.kernel, kernel, kernel_size);
+   uploaded.kernel_size = kernel_size;
+   memcpy(&uploaded.prog_data, prog_data, prog_data_size);
+
+   *kernel_out = 0;
+   *(const struct brw_stage_prog_data **)prog_data_out =
+      &uploaded.prog_data.base;
+   return true;
+}
+
+static void
+init_programs(void)
+{
+   srand(1);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      struct program *p = &programs[i];
+
+      /* Keys of a few different sizes, all starting with the shader type
+       * like the real ones.
+       */
+      p->key[0] = BLORP_SHADER_TYPE_BLIT;
+      p->key[1] = i;
+      p->key[2] = rand();
+      p->key[3] = rand();
+      p->key_size = sizeof(uint32_t) * (2 + i % 3);
+
+      p->kernel_size = 16 * (1 + rand() % (MAX_KERNEL_SIZE / 16));
+      for (unsigned j = 0; j < p->kernel_size; j++)
+         p->kernel[j] = rand();
+
+      /* BLORP programs have no parameters, the rest is plain data. */
+      memset(&p->prog_data, 0, sizeof(p->prog_data));
+      for (unsigned j = sizeof(p->prog_data.base); j < PROG_DATA_SIZE; j++)
+         p->prog_data.bytes[j] = rand();
+   }
+}
+
+static void
+init_context(struct blorp_context *blorp, struct blorp_program_cache *cache)
+{
+   memset(blorp, 0, sizeof(*blorp));
+   blorp->lookup_shader = lookup_shader;
+   blorp->upload_shader = upload_shader;
+   blorp->program_cache = cache;
+}
+
+static bool
+lookup(struct blorp_context *blorp, const struct program *p)
+{
+   uint32_t kernel;
+   const struct brw_stage_prog_data *prog_data;
+
+   memset(&uploaded, 0, sizeof(uploaded));
+   return blorp_lookup_shader(blorp, p->key, p->key_size,
+                              &kernel, &prog_data);
+}
+
+static void
+check_uploaded(const struct program *p)
+{
+   t_assert(uploaded.key_size == p->key_size);
+   t_assert(memcmp(uploaded.key, p->key, p->key_size) == 0);
+   t_assert(uploaded.kernel_size == p->kernel_size);
+   t_assert(memcmp(uploaded.kernel, p->kernel, p->kernel_size) == 0);
+   t_assert(memcmp(&uploaded.prog_data, &p->prog_data,
+                   sizeof(p->prog_data)) == 0);
+}
+
+static int
+remove_entry(const char *path, const struct stat *sb, int typeflag,
+             struct FTW *ftwbuf)
+{
+   return remove(path);
+}
+
+int main(void)
+{
+   char dir[] = "/tmp/blorp_cache_test.XXXXXX";
+   if (mkdtemp(dir) == NULL)
+      return 77;
+
+   setenv("MESA_GLSL_CACHE_DIR", dir, 1);
+   unsetenv("MESA_GLSL_CACHE_DISABLE");
+
+   init_programs();
+
+   /* First run: compile and store everything. */
+   struct disk_cache *disk_cache =
+      disk_cache_create("blorp_cache_test", "test", 0);
+   if (disk_cache == NULL) {
+      /* Built without the shader cache. */
+      nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+      return 77;
+   }
+
+   struct blorp_program_cache *cache = blorp_program_cache_create(disk_cache);
+   struct blorp_context blorp;
+   init_context(&blorp, cache);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      const struct program *p = &programs[i];
+      t_assert(!lookup(&blorp, p));
+
+      uint32_t kernel;
+      const struct brw_stage_prog_data *prog_data;
+      t_assert(blorp_upload_shader(&blorp, p->key, p->key_size,
+                                   p->kernel, p->kernel_size,
+                                   &p->prog_data.base, sizeof(p->prog_data),
+                                   &kernel, &prog_data));
+      check_uploaded(p);
+
+      /* Now in memory. */
+      t_assert(lookup(&blorp, p));
+      check_uploaded(p);
+   }
+
+   blorp_program_cache_destroy(cache);
+   disk_cache_wait_for_idle(disk_cache);
+   disk_cache_destroy(disk_cache);
+
+   /* Second run: everything comes back from the disk, the first programs
+    * racing with the warm-up thread.
+    */
+   disk_cache = disk_cache_create("blorp_cache_test", "test", 0);
+   t_assert(disk_cache);
+   cache = blorp_program_cache_create(disk_cache);
+   init_context(&blorp, cache);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      t_assert(lookup(&blorp, &programs[i]));
+      check_uploaded(&programs[i]);
+   }
+
+   /* A key which was never stored. */
+   struct program missing = programs[0];
+   missing.key[1] = NUM_PROGRAMS;
+   t_assert(!lookup(&blorp, &missing));
+
+   blorp_program_cache_destroy(cache);
+   disk_cache_destroy(disk_cache);
+
+   /* Third run: destroyed before the warm-up thread is done, or even
+    * started, with nothing new to index.
+    */
+   disk_cache = disk_cache_create("blorp_cache_test", "test", 0);
+   t_assert(disk_cache);
+   cache = blorp_program_cache_create(disk_cache);
+   blorp_program_cache_destroy(cache);
+   disk_cache_destroy(disk_cache);
+
+   nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+   return 0;
+}
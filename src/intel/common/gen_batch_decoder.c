@@ -795,12 +795,30 @@ get_address(struct gen_spec *spec, const uint32_t *p)
    return addr;
 }
 
+static struct gen_batch_decode_bo
+get_next_batch(struct gen_batch_decode_ctx *ctx, struct gen_group *inst,
+               const uint32_t *p, bool *second_level)
+{
+   struct gen_batch_decode_bo next_batch = {};
+   struct gen_field_iterator iter;
+   gen_field_iterator_init(&iter, inst, p, 0, false);
+   while (gen_field_iterator_next(&iter)) {
+      if (strcmp(iter.name, "Batch Buffer Start Address") == 0) {
+         next_batch = ctx_get_bo(ctx, iter.raw_value);
+      } else if (strcmp(iter.name, "Second Level Batch Buffer") == 0) {
+         *second_level = iter.raw_value;
+      }
+   }
+
+   return next_batch;
+}
+
 void
 gen_print_batch(struct gen_batch_decode_ctx *ctx,
                 const uint32_t *batch, uint32_t batch_size,
                 uint64_t batch_addr)
 {
-   const uint32_t *p, *end = batch + batch_size;
+   const uint32_t *p, *end = batch + batch_size / sizeof(uint32_t);
    int length;
    struct gen_group *inst;
 
@@ -858,17 +876,9 @@ gen_print_batch(struct gen_batch_decode_ctx *ctx,
       }
 
       if (strcmp(inst_name, "MI_BATCH_BUFFER_START") == 0) {
-         struct gen_batch_decode_bo next_batch = {};
-         bool second_level;
-         struct gen_field_iterator iter;
-         gen_field_iterator_init(&iter, inst, p, 0, false);
-         while (gen_field_iterator_next(&iter)) {
-            if (strcmp(iter.name, "Batch Buffer Start Address") == 0) {
-               next_batch = ctx_get_bo(ctx, iter.raw_value);
-            } else if (strcmp(iter.name, "Second Level Batch Buffer") == 0) {
-               second_level = iter.raw_value;
-            }
-         }
+         bool second_level = false;
+         struct gen_batch_decode_bo next_batch =
+            get_next_batch(ctx, inst, p, &second_level);
 
          if (next_batch.map == NULL) {
             fprintf(ctx->fp, "Secondary batch at 0x%08"PRIx64" unavailable\n",
@@ -897,3 +907,39 @@ gen_print_batch(struct gen_batch_decode_ctx *ctx,
       }
    }
 }
+
+void
+gen_scan_batch(struct gen_batch_decode_ctx *ctx,
+               const uint32_t *batch, uint32_t batch_size,
+               uint64_t batch_addr)
+{
+   const uint32_t *p, *end = batch + batch_size / sizeof(uint32_t);
+   int length;
+   struct gen_group *inst;
+
+   for (p = batch; p < end; p += length) {
+      inst = gen_spec_find_instruction(ctx->spec, p);
+      length = MAX2(1, gen_group_get_length(inst, p));
+
+      if (inst == NULL)
+         continue;
+
+      const char *inst_name = gen_group_get_name(inst);
+      if (strcmp(inst_name, "STATE_BASE_ADDRESS") == 0) {
+         handle_state_base_address(ctx, p);
+      } else if (strcmp(inst_name, "MI_BATCH_BUFFER_START") == 0) {
+         bool second_level = false;
+         struct gen_batch_decode_bo next_batch =
+            get_next_batch(ctx, inst, p, &second_level);
+
+         if (next_batch.map != NULL) {
+            gen_scan_batch(ctx, next_batch.map, next_batch.size,
+                           next_batch.addr);
+         }
+         if (!second_level)
+            break;
+      } else if (strcmp(inst_name, "MI_BATCH_BUFFER_END") == 0) {
+         break;
+      }
+   }
+}
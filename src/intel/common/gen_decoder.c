@@ -28,7 +28,6 @@
 #include <string.h>
 #include <expat.h>
 #include <inttypes.h>
-#include <zlib.h>
 
 #include <util/macros.h>
 #include <util/ralloc.h>
@@ -36,11 +35,83 @@
 #include "gen_decoder.h"
 
 #include "isl/isl.h"
-#include "genxml/genX_xml.h"
 
 #define XML_BUFFER_SIZE 4096
 #define MAX_VALUE_ITEMS 128
 
+/* The built-in specs generated by gen_decoder_tables.py.  They only use
+ * indices and string offsets so that they end up in read-only memory
+ * without any relocations, load_builtin_spec() turns them into a gen_spec.
+ */
+#define GEN_BUILTIN_NONE 0xffff
+#define GEN_BUILTIN_NO_STRING UINT32_MAX
+
+struct gen_builtin_value {
+   uint32_t name;
+   uint64_t value;
+};
+
+struct gen_builtin_field {
+   uint32_t name;
+   int32_t start, end;
+   uint32_t default_value;
+   bool has_default;
+   uint8_t type_kind;
+   /* Group of a GEN_TYPE_STRUCT, enum of a GEN_TYPE_ENUM, or integer and
+    * fractional sizes of a GEN_TYPE_UFIXED or GEN_TYPE_SFIXED.
+    */
+   int16_t type_a, type_b;
+   uint16_t values, nvalues;
+};
+
+struct gen_builtin_group {
+   uint32_t name;
+   uint16_t fields, nfields;
+   uint16_t parent, next;
+   uint32_t dw_length;
+   uint32_t group_offset, group_count;
+   uint32_t group_size;
+   bool variable;
+   bool fixed_length;
+   uint32_t opcode_mask;
+   uint32_t opcode;
+   uint32_t register_offset;
+};
+
+struct gen_builtin_enum {
+   uint32_t name;
+   uint16_t values, nvalues;
+};
+
+struct gen_builtin_spec {
+   uint32_t gen_10;
+   uint32_t gen;
+
+   const struct gen_builtin_group *groups;
+   const struct gen_builtin_field *fields;
+   const struct gen_builtin_value *values;
+   const struct gen_builtin_enum *enum_defs;
+   uint16_t ngroups, nfields, nvalues, nenum_defs;
+
+   /* Indices into groups and enum_defs, sorted like in gen_spec. */
+   const uint16_t *commands;
+   const uint16_t *structs;
+   const uint16_t *registers_by_name;
+   const uint16_t *registers_by_offset;
+   const uint16_t *enums;
+   uint16_t ncommands, nstructs, nregisters_by_name, nregisters_by_offset;
+   uint16_t nenums;
+
+   /* Indices into groups, GEN_BUILTIN_NONE for the empty slots. */
+   const uint16_t *opcode_hash;
+   uint32_t opcode_hash_mult;
+   uint32_t opcode_hash_bits;
+   uint32_t opcode_masks[GEN_SPEC_MAX_OPCODE_MASKS];
+   int n_opcode_masks;
+};
+
+#include "genxml/genX_decoder_tables.h"
+
 struct location {
    const char *filename;
    int line_number;
@@ -60,6 +131,15 @@ struct parser_context {
    struct gen_field *last_field;
 
    struct gen_spec *spec;
+
+   /* Where the groups and enums go while parsing, before being sorted into
+    * the arrays of the spec.
+    */
+   struct hash_table *commands;
+   struct hash_table *structs;
+   struct hash_table *registers_by_name;
+   struct hash_table *registers_by_offset;
+   struct hash_table *enums;
 };
 
 const char *
@@ -74,37 +154,63 @@ gen_group_get_opcode(struct gen_group *group)
    return group->opcode;
 }
 
+static int
+compare_group_name(const void *key, const void *elem)
+{
+   return strcmp(key, (*(struct gen_group * const *) elem)->name);
+}
+
+static int
+compare_group_offset(const void *key, const void *elem)
+{
+   uint32_t offset = *(const uint32_t *) key;
+   uint32_t elem_offset = (*(struct gen_group * const *) elem)->register_offset;
+
+   return offset < elem_offset ? -1 : offset > elem_offset;
+}
+
+static int
+compare_enum_name(const void *key, const void *elem)
+{
+   return strcmp(key, (*(struct gen_enum * const *) elem)->name);
+}
+
+static struct gen_group *
+find_group(struct gen_group **groups, int count, const void *key,
+           int (*compare)(const void *, const void *))
+{
+   struct gen_group **group = bsearch(key, groups, count, sizeof(*groups),
+                                      compare);
+   return group ? *group : NULL;
+}
+
 struct gen_group *
 gen_spec_find_struct(struct gen_spec *spec, const char *name)
 {
-   struct hash_entry *entry = _mesa_hash_table_search(spec->structs,
-                                                      name);
-   return entry ? entry->data : NULL;
+   return find_group(spec->structs, spec->nstructs, name,
+                     compare_group_name);
 }
 
 struct gen_group *
 gen_spec_find_register(struct gen_spec *spec, uint32_t offset)
 {
-   struct hash_entry *entry =
-      _mesa_hash_table_search(spec->registers_by_offset,
-                              (void *) (uintptr_t) offset);
-   return entry ? entry->data : NULL;
+   return find_group(spec->registers_by_offset, spec->nregisters_by_offset, &offset,
+                     compare_group_offset);
 }
 
 struct gen_group *
 gen_spec_find_register_by_name(struct gen_spec *spec, const char *name)
 {
-   struct hash_entry *entry =
-      _mesa_hash_table_search(spec->registers_by_name, name);
-   return entry ? entry->data : NULL;
+   return find_group(spec->registers_by_name, spec->nregisters_by_name, name,
+                     compare_group_name);
 }
 
 struct gen_enum *
 gen_spec_find_enum(struct gen_spec *spec, const char *name)
 {
-   struct hash_entry *entry = _mesa_hash_table_search(spec->enums,
-                                                      name);
-   return entry ? entry->data : NULL;
+   struct gen_enum **e = bsearch(name, spec->enums, spec->nenums,
+                                 sizeof(*spec->enums), compare_enum_name);
+   return e ? *e : NULL;
 }
 
 uint32_t
@@ -248,8 +354,7 @@ static struct gen_type
 string_to_type(struct parser_context *ctx, const char *s)
 {
    int i, f;
-   struct gen_group *g;
-   struct gen_enum *e;
+   struct hash_entry *g, *e;
 
    if (strcmp(s, "int") == 0)
       return (struct gen_type) { .kind = GEN_TYPE_INT };
@@ -267,10 +372,10 @@ string_to_type(struct parser_context *ctx, const char *s)
       return (struct gen_type) { .kind = GEN_TYPE_UFIXED, .i = i, .f = f };
    else if (sscanf(s, "s%d.%d", &i, &f) == 2)
       return (struct gen_type) { .kind = GEN_TYPE_SFIXED, .i = i, .f = f };
-   else if (g = gen_spec_find_struct(ctx->spec, s), g != NULL)
-      return (struct gen_type) { .kind = GEN_TYPE_STRUCT, .gen_struct = g };
-   else if (e = gen_spec_find_enum(ctx->spec, s), e != NULL)
-      return (struct gen_type) { .kind = GEN_TYPE_ENUM, .gen_enum = e };
+   else if (g = _mesa_hash_table_search(ctx->structs, s), g != NULL)
+      return (struct gen_type) { .kind = GEN_TYPE_STRUCT, .gen_struct = g->data };
+   else if (e = _mesa_hash_table_search(ctx->enums, s), e != NULL)
+      return (struct gen_type) { .kind = GEN_TYPE_ENUM, .gen_enum = e->data };
    else if (strcmp(s, "mbo") == 0)
       return (struct gen_type) { .kind = GEN_TYPE_MBO };
    else
@@ -408,7 +513,6 @@ static void
 end_element(void *data, const char *name)
 {
    struct parser_context *ctx = data;
-   struct gen_spec *spec = ctx->spec;
 
    if (strcmp(name, "instruction") == 0 ||
        strcmp(name, "struct") == 0 ||
@@ -428,12 +532,12 @@ end_element(void *data, const char *name)
       }
 
       if (strcmp(name, "instruction") == 0)
-         _mesa_hash_table_insert(spec->commands, group->name, group);
+         _mesa_hash_table_insert(ctx->commands, group->name, group);
       else if (strcmp(name, "struct") == 0)
-         _mesa_hash_table_insert(spec->structs, group->name, group);
+         _mesa_hash_table_insert(ctx->structs, group->name, group);
       else if (strcmp(name, "register") == 0) {
-         _mesa_hash_table_insert(spec->registers_by_name, group->name, group);
-         _mesa_hash_table_insert(spec->registers_by_offset,
+         _mesa_hash_table_insert(ctx->registers_by_name, group->name, group);
+         _mesa_hash_table_insert(ctx->registers_by_offset,
                                  (void *) (uintptr_t) group->register_offset,
                                  group);
       }
@@ -453,7 +557,7 @@ end_element(void *data, const char *name)
       ctx->values = ralloc_array(ctx->spec, struct gen_value*, ctx->n_allocated_values = 2);
       ctx->n_values = 0;
       ctx->enoom = NULL;
-      _mesa_hash_table_insert(spec->enums, e->name, e);
+      _mesa_hash_table_insert(ctx->enums, e->name, e);
    }
 }
 
@@ -473,133 +577,333 @@ devinfo_to_gen(const struct gen_device_info *devinfo)
    return value;
 }
 
-static uint32_t zlib_inflate(const void *compressed_data,
-                             uint32_t compressed_len,
-                             void **out_ptr)
+static uint32_t _hash_uint32(const void *key)
 {
-   struct z_stream_s zstream;
-   void *out;
+   return (uint32_t) (uintptr_t) key;
+}
 
-   memset(&zstream, 0, sizeof(zstream));
+static int
+compare_groups_by_name(const void *a, const void *b)
+{
+   return strcmp((*(struct gen_group * const *) a)->name,
+                 (*(struct gen_group * const *) b)->name);
+}
 
-   zstream.next_in = (unsigned char *)compressed_data;
-   zstream.avail_in = compressed_len;
+static int
+compare_groups_by_offset(const void *a, const void *b)
+{
+   return compare_group_offset(&(*(struct gen_group * const *) a)->register_offset, b);
+}
 
-   if (inflateInit(&zstream) != Z_OK)
-      return 0;
+static int
+compare_enums_by_name(const void *a, const void *b)
+{
+   return strcmp((*(struct gen_enum * const *) a)->name,
+                 (*(struct gen_enum * const *) b)->name);
+}
 
-   out = malloc(4096);
-   zstream.next_out = out;
-   zstream.avail_out = 4096;
+static void *
+sorted_table_data(struct gen_spec *spec, struct hash_table *table,
+                  int (*compare)(const void *, const void *))
+{
+   void **data = ralloc_array(spec, void *, MAX2(table->entries, 1));
+   struct hash_entry *entry;
+   int i = 0;
 
-   do {
-      switch (inflate(&zstream, Z_SYNC_FLUSH)) {
-      case Z_STREAM_END:
-         goto end;
-      case Z_OK:
-         break;
-      default:
-         inflateEnd(&zstream);
-         return 0;
-      }
+   hash_table_foreach(table, entry)
+      data[i++] = entry->data;
 
-      if (zstream.avail_out)
-         break;
+   qsort(data, table->entries, sizeof(*data), compare);
 
-      out = realloc(out, 2*zstream.total_out);
-      if (out == NULL) {
-         inflateEnd(&zstream);
-         return 0;
-      }
+   return data;
+}
 
-      zstream.next_out = (unsigned char *)out + zstream.total_out;
-      zstream.avail_out = zstream.total_out;
-   } while (1);
- end:
-   inflateEnd(&zstream);
-   *out_ptr = out;
-   return zstream.total_out;
+static inline uint32_t
+opcode_hash(uint32_t opcode, uint32_t mult, uint32_t bits)
+{
+   return (opcode * mult) >> (32 - bits);
 }
 
-static uint32_t _hash_uint32(const void *key)
+static int
+compare_opcode_masks(const void *a, const void *b)
 {
-   return (uint32_t) (uintptr_t) key;
+   uint32_t mask_a = *(const uint32_t *) a, mask_b = *(const uint32_t *) b;
+   int bits_a = __builtin_popcount(mask_a), bits_b = __builtin_popcount(mask_b);
+
+   if (bits_a != bits_b)
+      return bits_b - bits_a;
+   return mask_a < mask_b ? -1 : mask_a > mask_b;
 }
 
-struct gen_spec *
-gen_spec_load(const struct gen_device_info *devinfo)
+/* Looks for a multiplier hashing the opcodes of all the commands to distinct
+ * slots, the same way as gen_decoder_tables.py does for the built-in specs.
+ * The lookups fall back to a linear search if there is none.
+ */
+static void
+build_opcode_hash(struct gen_spec *spec)
 {
-   struct parser_context ctx;
-   void *buf;
-   uint8_t *text_data = NULL;
-   uint32_t text_offset = 0, text_length = 0;
-   MAYBE_UNUSED uint32_t total_length;
-   uint32_t gen_10 = devinfo_to_gen(devinfo);
+   spec->n_opcode_masks = 0;
+   for (int i = 0; i < spec->ncommands; i++) {
+      uint32_t mask = spec->commands[i]->opcode_mask;
+      int j;
+
+      for (j = 0; j < spec->n_opcode_masks; j++) {
+         if (spec->opcode_masks[j] == mask)
+            break;
+      }
 
-   for (int i = 0; i < ARRAY_SIZE(genxml_files_table); i++) {
-      if (genxml_files_table[i].gen_10 == gen_10) {
-         text_offset = genxml_files_table[i].offset;
-         text_length = genxml_files_table[i].length;
-         break;
+      if (j == spec->n_opcode_masks) {
+         if (spec->n_opcode_masks == GEN_SPEC_MAX_OPCODE_MASKS)
+            return;
+         spec->opcode_masks[spec->n_opcode_masks++] = mask;
       }
    }
 
-   if (text_length == 0) {
-      fprintf(stderr, "unable to find gen (%u) data\n", gen_10);
-      return NULL;
+   qsort(spec->opcode_masks, spec->n_opcode_masks, sizeof(uint32_t),
+         compare_opcode_masks);
+
+   uint32_t bits = 1;
+   while ((1 << bits) < 2 * spec->ncommands)
+      bits++;
+
+   for (; bits <= 16; bits++) {
+      struct gen_group **table =
+         ralloc_array(spec, struct gen_group *, 1 << bits);
+      uint32_t mult = 0x9e3779b1;
+
+      for (int tries = 0; tries < (1 << 16); tries++, mult += 2) {
+         memset(table, 0, sizeof(*table) << bits);
+
+         int i;
+         for (i = 0; i < spec->ncommands; i++) {
+            struct gen_group *command = spec->commands[i];
+            uint32_t h = opcode_hash(command->opcode, mult, bits);
+            if (table[h])
+               break;
+            table[h] = command;
+         }
+
+         if (i == spec->ncommands) {
+            spec->opcode_hash = table;
+            spec->opcode_hash_mult = mult;
+            spec->opcode_hash_bits = bits;
+            return;
+         }
+      }
+
+      ralloc_free(table);
    }
+}
 
-   memset(&ctx, 0, sizeof ctx);
-   ctx.parser = XML_ParserCreate(NULL);
-   XML_SetUserData(ctx.parser, &ctx);
-   if (ctx.parser == NULL) {
-      fprintf(stderr, "failed to create parser\n");
+static void
+parser_context_init_tables(struct parser_context *ctx)
+{
+   ctx->commands =
+      _mesa_hash_table_create(NULL, _mesa_hash_string, _mesa_key_string_equal);
+   ctx->structs =
+      _mesa_hash_table_create(NULL, _mesa_hash_string, _mesa_key_string_equal);
+   ctx->registers_by_name =
+      _mesa_hash_table_create(NULL, _mesa_hash_string, _mesa_key_string_equal);
+   ctx->registers_by_offset =
+      _mesa_hash_table_create(NULL, _hash_uint32, _mesa_key_pointer_equal);
+   ctx->enums =
+      _mesa_hash_table_create(NULL, _mesa_hash_string, _mesa_key_string_equal);
+}
+
+/* Moves what was parsed into the sorted arrays of the spec. */
+static void
+parser_context_finish_tables(struct parser_context *ctx)
+{
+   struct gen_spec *spec = ctx->spec;
+
+   if (spec) {
+      spec->commands = sorted_table_data(spec, ctx->commands,
+                                         compare_groups_by_name);
+      spec->structs = sorted_table_data(spec, ctx->structs,
+                                        compare_groups_by_name);
+      spec->registers_by_name =
+         sorted_table_data(spec, ctx->registers_by_name,
+                           compare_groups_by_name);
+      spec->registers_by_offset =
+         sorted_table_data(spec, ctx->registers_by_offset,
+                           compare_groups_by_offset);
+      spec->enums = sorted_table_data(spec, ctx->enums,
+                                      compare_enums_by_name);
+
+      spec->ncommands = ctx->commands->entries;
+      spec->nstructs = ctx->structs->entries;
+      spec->nregisters_by_name = ctx->registers_by_name->entries;
+      spec->nregisters_by_offset = ctx->registers_by_offset->entries;
+      spec->nenums = ctx->enums->entries;
+
+      build_opcode_hash(spec);
+   }
+
+   _mesa_hash_table_destroy(ctx->commands, NULL);
+   _mesa_hash_table_destroy(ctx->structs, NULL);
+   _mesa_hash_table_destroy(ctx->registers_by_name, NULL);
+   _mesa_hash_table_destroy(ctx->registers_by_offset, NULL);
+   _mesa_hash_table_destroy(ctx->enums, NULL);
+}
+
+static char *
+builtin_string(uint32_t offset)
+{
+   if (offset == GEN_BUILTIN_NO_STRING)
       return NULL;
+   return (char *) &gen_builtin_strings[offset];
+}
+
+static struct gen_group **
+builtin_group_table(struct gen_spec *spec, struct gen_group *groups,
+                    const uint16_t *indices, int count)
+{
+   struct gen_group **table =
+      ralloc_array(spec, struct gen_group *, MAX2(count, 1));
+
+   for (int i = 0; i < count; i++)
+      table[i] = &groups[indices[i]];
+
+   return table;
+}
+
+/* Only the strings are shared with the built-in tables, everything else is
+ * allocated out of the spec so that it can be freed like a parsed one.
+ */
+static struct gen_spec *
+load_builtin_spec(const struct gen_builtin_spec *b)
+{
+   struct gen_spec *spec = rzalloc(NULL, struct gen_spec);
+   struct gen_group *groups = rzalloc_array(spec, struct gen_group,
+                                            b->ngroups);
+   struct gen_field *fields = rzalloc_array(spec, struct gen_field,
+                                            MAX2(b->nfields, 1));
+   struct gen_value *values = ralloc_array(spec, struct gen_value,
+                                           MAX2(b->nvalues, 1));
+   struct gen_value **value_ptrs = ralloc_array(spec, struct gen_value *,
+                                                MAX2(b->nvalues, 1));
+   struct gen_enum *enum_defs = rzalloc_array(spec, struct gen_enum,
+                                              MAX2(b->nenum_defs, 1));
+
+   spec->gen = b->gen;
+
+   for (int i = 0; i < b->nvalues; i++) {
+      values[i].name = builtin_string(b->values[i].name);
+      values[i].value = b->values[i].value;
+      value_ptrs[i] = &values[i];
    }
 
-   XML_SetElementHandler(ctx.parser, start_element, end_element);
-   XML_SetCharacterDataHandler(ctx.parser, character_data);
+   for (int i = 0; i < b->nenum_defs; i++) {
+      const struct gen_builtin_enum *e = &b->enum_defs[i];
 
-   ctx.spec = rzalloc(NULL, struct gen_spec);
+      enum_defs[i].name = builtin_string(e->name);
+      enum_defs[i].nvalues = e->nvalues;
+      enum_defs[i].values = e->nvalues ? &value_ptrs[e->values] : NULL;
+   }
 
-   ctx.spec->commands =
-      _mesa_hash_table_create(ctx.spec, _mesa_hash_string, _mesa_key_string_equal);
-   ctx.spec->structs =
-      _mesa_hash_table_create(ctx.spec, _mesa_hash_string, _mesa_key_string_equal);
-   ctx.spec->registers_by_name =
-      _mesa_hash_table_create(ctx.spec, _mesa_hash_string, _mesa_key_string_equal);
-   ctx.spec->registers_by_offset =
-      _mesa_hash_table_create(ctx.spec, _hash_uint32, _mesa_key_pointer_equal);
-   ctx.spec->enums =
-      _mesa_hash_table_create(ctx.spec, _mesa_hash_string, _mesa_key_string_equal);
-
-   ctx.spec->access_cache =
-      _mesa_hash_table_create(ctx.spec, _mesa_hash_string, _mesa_key_string_equal);
-
-   total_length = zlib_inflate(compress_genxmls,
-                               sizeof(compress_genxmls),
-                               (void **) &text_data);
-   assert(text_offset + text_length <= total_length);
-
-   buf = XML_GetBuffer(ctx.parser, text_length);
-   memcpy(buf, &text_data[text_offset], text_length);
-
-   if (XML_ParseBuffer(ctx.parser, text_length, true) == 0) {
-      fprintf(stderr,
-              "Error parsing XML at line %ld col %ld byte %ld/%u: %s\n",
-              XML_GetCurrentLineNumber(ctx.parser),
-              XML_GetCurrentColumnNumber(ctx.parser),
-              XML_GetCurrentByteIndex(ctx.parser), text_length,
-              XML_ErrorString(XML_GetErrorCode(ctx.parser)));
-      XML_ParserFree(ctx.parser);
-      free(text_data);
-      return NULL;
+   for (int i = 0; i < b->ngroups; i++) {
+      const struct gen_builtin_group *g = &b->groups[i];
+      struct gen_group *group = &groups[i];
+
+      group->spec = spec;
+      group->name = builtin_string(g->name);
+      group->fields = g->nfields ? &fields[g->fields] : NULL;
+      group->dw_length = g->dw_length;
+      group->group_offset = g->group_offset;
+      group->group_count = g->group_count;
+      group->group_size = g->group_size;
+      group->variable = g->variable;
+      group->fixed_length = g->fixed_length;
+      group->parent = g->parent != GEN_BUILTIN_NONE ? &groups[g->parent] : NULL;
+      group->next = g->next != GEN_BUILTIN_NONE ? &groups[g->next] : NULL;
+      group->opcode_mask = g->opcode_mask;
+      group->opcode = g->opcode;
+      group->register_offset = g->register_offset;
+
+      for (int j = 0; j < g->nfields; j++) {
+         const struct gen_builtin_field *f = &b->fields[g->fields + j];
+         struct gen_field *field = &fields[g->fields + j];
+
+         field->parent = group;
+         field->next = j + 1 < g->nfields ? field + 1 : NULL;
+         field->name = builtin_string(f->name);
+         field->start = f->start;
+         field->end = f->end;
+         field->has_default = f->has_default;
+         field->default_value = f->default_value;
+         field->inline_enum.nvalues = f->nvalues;
+         field->inline_enum.values =
+            f->nvalues ? &value_ptrs[f->values] : NULL;
+
+         field->type.kind = f->type_kind;
+         switch (f->type_kind) {
+         case GEN_TYPE_STRUCT:
+            field->type.gen_struct = &groups[f->type_a];
+            break;
+         case GEN_TYPE_ENUM:
+            field->type.gen_enum = &enum_defs[f->type_a];
+            break;
+         case GEN_TYPE_UFIXED:
+         case GEN_TYPE_SFIXED:
+            field->type.i = f->type_a;
+            field->type.f = f->type_b;
+            break;
+         default:
+            break;
+         }
+      }
    }
 
-   XML_ParserFree(ctx.parser);
-   free(text_data);
+   spec->commands = builtin_group_table(spec, groups, b->commands,
+                                        b->ncommands);
+   spec->structs = builtin_group_table(spec, groups, b->structs,
+                                       b->nstructs);
+   spec->registers_by_name =
+      builtin_group_table(spec, groups, b->registers_by_name,
+                          b->nregisters_by_name);
+   spec->registers_by_offset =
+      builtin_group_table(spec, groups, b->registers_by_offset,
+                          b->nregisters_by_offset);
+
+   spec->enums = ralloc_array(spec, struct gen_enum *, MAX2(b->nenums, 1));
+   for (int i = 0; i < b->nenums; i++)
+      spec->enums[i] = &enum_defs[b->enums[i]];
+
+   spec->ncommands = b->ncommands;
+   spec->nstructs = b->nstructs;
+   spec->nregisters_by_name = b->nregisters_by_name;
+   spec->nregisters_by_offset = b->nregisters_by_offset;
+   spec->nenums = b->nenums;
+
+   if (b->opcode_hash) {
+      int size = 1 << b->opcode_hash_bits;
+
+      spec->opcode_hash = ralloc_array(spec, struct gen_group *, size);
+      for (int i = 0; i < size; i++) {
+         spec->opcode_hash[i] = b->opcode_hash[i] != GEN_BUILTIN_NONE ?
+                                &groups[b->opcode_hash[i]] : NULL;
+      }
+      spec->opcode_hash_mult = b->opcode_hash_mult;
+      spec->opcode_hash_bits = b->opcode_hash_bits;
+      memcpy(spec->opcode_masks, b->opcode_masks, sizeof(spec->opcode_masks));
+      spec->n_opcode_masks = b->n_opcode_masks;
+   }
 
-   return ctx.spec;
+   return spec;
+}
+
+struct gen_spec *
+gen_spec_load(const struct gen_device_info *devinfo)
+{
+   uint32_t gen_10 = devinfo_to_gen(devinfo);
+
+   for (int i = 0; i < ARRAY_SIZE(gen_builtin_specs); i++) {
+      if (gen_builtin_specs[i].gen_10 == gen_10)
+         return load_builtin_spec(&gen_builtin_specs[i]);
+   }
+
+   fprintf(stderr, "unable to find gen (%u) data\n", gen_10);
+   return NULL;
 }
 
 struct gen_spec *
@@ -637,13 +941,14 @@ gen_spec_load_from_path(const struct gen_device_info *devinfo,
    XML_SetCharacterDataHandler(ctx.parser, character_data);
    ctx.loc.filename = filename;
    ctx.spec = rzalloc(NULL, struct gen_spec);
+   parser_context_init_tables(&ctx);
 
    do {
       buf = XML_GetBuffer(ctx.parser, XML_BUFFER_SIZE);
       len = fread(buf, 1, XML_BUFFER_SIZE, input);
-      if (len == 0) {
+      if (ferror(input)) {
          fprintf(stderr, "fread: %m\n");
-         free(ctx.spec);
+         ralloc_free(ctx.spec);
          ctx.spec = NULL;
          goto end;
       }
@@ -653,13 +958,14 @@ gen_spec_load_from_path(const struct gen_device_info *devinfo,
                  XML_GetCurrentLineNumber(ctx.parser),
                  XML_GetCurrentColumnNumber(ctx.parser),
                  XML_ErrorString(XML_GetErrorCode(ctx.parser)));
-         free(ctx.spec);
+         ralloc_free(ctx.spec);
          ctx.spec = NULL;
          goto end;
       }
    } while (len > 0);
 
  end:
+   parser_context_finish_tables(&ctx);
    XML_ParserFree(ctx.parser);
 
    fclose(input);
@@ -676,12 +982,23 @@ void gen_spec_destroy(struct gen_spec *spec)
 struct gen_group *
 gen_spec_find_instruction(struct gen_spec *spec, const uint32_t *p)
 {
-   struct hash_entry *entry;
+   if (spec->opcode_hash) {
+      for (int i = 0; i < spec->n_opcode_masks; i++) {
+         uint32_t h = opcode_hash(p[0] & spec->opcode_masks[i],
+                                  spec->opcode_hash_mult,
+                                  spec->opcode_hash_bits);
+         struct gen_group *command = spec->opcode_hash[h];
+
+         if (command && (p[0] & command->opcode_mask) == command->opcode)
+            return command;
+      }
 
-   hash_table_foreach(spec->commands, entry) {
-      struct gen_group *command = entry->data;
-      uint32_t opcode = *p & command->opcode_mask;
-      if (opcode == command->opcode)
+      return NULL;
+   }
+
+   for (int i = 0; i < spec->ncommands; i++) {
+      struct gen_group *command = spec->commands[i];
+      if ((p[0] & command->opcode_mask) == command->opcode)
          return command;
    }
 
@@ -691,24 +1008,9 @@ gen_spec_find_instruction(struct gen_spec *spec, const uint32_t *p)
 struct gen_field *
 gen_group_find_field(struct gen_group *group, const char *name)
 {
-   char path[256];
-   snprintf(path, sizeof(path), "%s/%s", group->name, name);
-
-   struct gen_spec *spec = group->spec;
-   struct hash_entry *entry = _mesa_hash_table_search(spec->access_cache,
-                                                      path);
-   if (entry)
-      return entry->data;
-
-   struct gen_field *field = group->fields;
-   while (field) {
-      if (strcmp(field->name, name) == 0) {
-         _mesa_hash_table_insert(spec->access_cache,
-                                 ralloc_strdup(spec, path),
-                                 field);
+   for (struct gen_field *field = group->fields; field; field = field->next) {
+      if (field->name && strcmp(field->name, name) == 0)
          return field;
-      }
-      field = field->next;
    }
 
    return NULL;
@@ -936,9 +1238,7 @@ iter_decode_field(struct gen_field_iterator *iter)
    case GEN_TYPE_STRUCT:
       snprintf(iter->value, sizeof(iter->value), "<struct %s>",
                iter->field->type.gen_struct->name);
-      iter->struct_desc =
-         gen_spec_find_struct(iter->group->spec,
-                              iter->field->type.gen_struct->name);
+      iter->struct_desc = iter->field->type.gen_struct;
       break;
    case GEN_TYPE_UFIXED:
       snprintf(iter->value, sizeof(iter->value), "%f",
@@ -82,16 +82,32 @@ struct gen_field_iterator {
    bool print_colors;
 };
 
+#define GEN_SPEC_MAX_OPCODE_MASKS 8
+
 struct gen_spec {
    uint32_t gen;
 
-   struct hash_table *commands;
-   struct hash_table *structs;
-   struct hash_table *registers_by_name;
-   struct hash_table *registers_by_offset;
-   struct hash_table *enums;
-
-   struct hash_table *access_cache;
+   /* Sorted by name, except registers_by_offset which is sorted by offset. */
+   struct gen_group **commands;
+   struct gen_group **structs;
+   struct gen_group **registers_by_name;
+   struct gen_group **registers_by_offset;
+   struct gen_enum **enums;
+
+   int ncommands;
+   int nstructs;
+   int nregisters_by_name;
+   int nregisters_by_offset;
+   int nenums;
+
+   /* Perfect hash of the commands by opcode, probed once with each of the
+    * distinct opcode masks of the commands, or NULL if none was found.
+    */
+   struct gen_group **opcode_hash;
+   uint32_t opcode_hash_mult;
+   uint32_t opcode_hash_bits;
+   uint32_t opcode_masks[GEN_SPEC_MAX_OPCODE_MASKS];
+   int n_opcode_masks;
 };
 
 struct gen_group {
@@ -239,10 +255,20 @@ void gen_batch_decode_ctx_init(struct gen_batch_decode_ctx *ctx,
 void gen_batch_decode_ctx_finish(struct gen_batch_decode_ctx *ctx);
 
 
+/* batch_size is in bytes. */
 void gen_print_batch(struct gen_batch_decode_ctx *ctx,
                      const uint32_t *batch, uint32_t batch_size,
                      uint64_t batch_addr);
 
+/**
+ * Walks a batch the same way gen_print_batch() does without printing
+ * anything, only updating the state carried over to the following batches
+ * (the base addresses).
+ */
+void gen_scan_batch(struct gen_batch_decode_ctx *ctx,
+                    const uint32_t *batch, uint32_t batch_size,
+                    uint64_t batch_addr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,9 @@
 #include "compiler/nir/nir.h"
 #include "main/errors.h"
 #include "util/debug.h"
+#include "util/u_queue.h"
+
+#include <unistd.h>
 
 #define COMMON_OPTIONS                                                        \
    .lower_sub = true,                                                         \
@@ -114,6 +117,34 @@ static const struct nir_shader_compiler_options vector_nir_options_gen6 = {
    .max_unroll_iterations = 32,
 };
 
+static void
+destroy_simd_queue(void *queue)
+{
+   util_queue_destroy((struct util_queue *) queue);
+}
+
+static void
+brw_compiler_init_simd_queue(struct brw_compiler *compiler)
+{
+   /* Each shader compile queues at most a SIMD16 and a SIMD32 variant. */
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   unsigned num_threads =
+      env_var_as_unsigned("INTEL_COMPILER_THREADS", num_cpus > 1 ? 2 : 0);
+
+   if (num_threads == 0)
+      return;
+
+   struct util_queue *queue = ralloc(compiler, struct util_queue);
+   if (!util_queue_init(queue, "brw_simd", 16, num_threads,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+      ralloc_free(queue);
+      return;
+   }
+
+   ralloc_set_destructor(queue, destroy_simd_queue);
+   compiler->simd_queue = queue;
+}
+
 struct brw_compiler *
 brw_compiler_create(void *mem_ctx, const struct gen_device_info *devinfo)
 {
@@ -127,6 +158,8 @@ brw_compiler_create(void *mem_ctx, const struct gen_device_info *devinfo)
 
    compiler->precise_trig = env_var_as_boolean("INTEL_PRECISE_TRIG", false);
 
+   brw_compiler_init_simd_queue(compiler);
+
    if (devinfo->gen >= 10) {
       /* We don't support vec4 mode on Cannonlake. */
       for (int i = MESA_SHADER_VERTEX; i < MESA_SHADER_STAGES; i++)
@@ -35,6 +35,7 @@ extern "C" {
 #endif
 
 struct ra_regs;
+struct util_queue;
 struct nir_shader;
 struct brw_program;
 
@@ -92,6 +93,17 @@ struct brw_compiler {
    void (*shader_debug_log)(void *, const char *str, ...) PRINTFLIKE(2, 3);
    void (*shader_perf_log)(void *, const char *str, ...) PRINTFLIKE(2, 3);
 
+   /**
+    * If set, called with the CPU time in nanoseconds spent in each pass of
+    * the backend, for profiling the compiler offline.  dispatch_width is 0
+    * for NIR passes and vec4 shaders.  This may be called from the threads
+    * of simd_queue.
+    */
+   void (*pass_time)(void *data, gl_shader_stage stage,
+                     unsigned dispatch_width, const char *pass,
+                     uint64_t nsec);
+   void *pass_time_data;
+
    bool scalar_stage[MESA_SHADER_STAGES];
    struct gl_shader_compiler_options glsl_compiler_options[MESA_SHADER_STAGES];
 
@@ -118,6 +130,13 @@ struct brw_compiler {
     * whether nir_opt_large_constants will be run.
     */
    bool supports_shader_constants;
+
+   /**
+    * Threads compiling the SIMD16 and SIMD32 variants of fragment and
+    * compute shaders while the first variant is being finished, or NULL if
+    * the variants are compiled one after the other.
+    */
+   struct util_queue *simd_queue;
 };
 
 /**
@@ -75,7 +75,9 @@
 #include "brw_eu.h"
 #include "brw_shader.h"
 #include "brw_disasm_info.h"
+#include "c11/threads.h"
 #include "common/gen_debug.h"
+#include "util/u_dynarray.h"
 
 static const uint32_t g45_control_index_table[32] = {
    0b00000000000000000,
@@ -699,11 +701,113 @@ static const uint64_t gen8_3src_source_index_table[4] = {
    0b0000001110010011100100111001000001111000000100000
 };
 
+/**
+ * Reverse lookup of a 32-entry compaction table: an open-addressed hash of
+ * the uncompacted values giving their index in the table, so that finding
+ * whether an instruction compacts doesn't have to scan every table.
+ */
+#define COMPACTION_MAP_SIZE 128
+
+struct compaction_map {
+   uint32_t values[COMPACTION_MAP_SIZE];
+   int8_t indices[COMPACTION_MAP_SIZE];
+};
+
+static inline unsigned
+compaction_map_hash(uint32_t value)
+{
+   return (value * 0x9e3779b1u) >> (32 - 7);
+}
+
+static void
+compaction_map_init(struct compaction_map *map,
+                    const void *table, unsigned entry_size)
+{
+   memset(map->indices, -1, sizeof(map->indices));
+
+   for (int i = 0; i < 32; i++) {
+      const uint32_t value = entry_size == 2 ? ((const uint16_t *)table)[i] :
+                                               ((const uint32_t *)table)[i];
+      unsigned h = compaction_map_hash(value);
+
+      while (map->indices[h] >= 0 && map->values[h] != value)
+         h = (h + 1) % COMPACTION_MAP_SIZE;
+
+      /* Keep the first index for duplicated values, as a scan would. */
+      if (map->indices[h] < 0) {
+         map->values[h] = value;
+         map->indices[h] = i;
+      }
+   }
+}
+
+static inline int
+compaction_map_lookup(const struct compaction_map *map, uint32_t value)
+{
+   for (unsigned h = compaction_map_hash(value); map->indices[h] >= 0;
+        h = (h + 1) % COMPACTION_MAP_SIZE) {
+      if (map->values[h] == value)
+         return map->indices[h];
+   }
+
+   return -1;
+}
+
+static struct compaction_map g45_control_index_map;
+static struct compaction_map g45_datatype_map;
+static struct compaction_map g45_subreg_map;
+static struct compaction_map g45_src_index_map;
+static struct compaction_map gen6_control_index_map;
+static struct compaction_map gen6_datatype_map;
+static struct compaction_map gen6_subreg_map;
+static struct compaction_map gen6_src_index_map;
+static struct compaction_map gen7_control_index_map;
+static struct compaction_map gen7_datatype_map;
+static struct compaction_map gen7_subreg_map;
+static struct compaction_map gen7_src_index_map;
+static struct compaction_map gen8_control_index_map;
+static struct compaction_map gen8_datatype_map;
+static struct compaction_map gen8_subreg_map;
+static struct compaction_map gen8_src_index_map;
+static struct compaction_map gen11_datatype_map;
+
+static void
+init_compaction_maps(void)
+{
+#define INIT_MAP(name) \
+   compaction_map_init(&name##_map, name##_table, sizeof(name##_table[0]))
+
+   INIT_MAP(g45_control_index);
+   INIT_MAP(g45_datatype);
+   INIT_MAP(g45_subreg);
+   INIT_MAP(g45_src_index);
+   INIT_MAP(gen6_control_index);
+   INIT_MAP(gen6_datatype);
+   INIT_MAP(gen6_subreg);
+   INIT_MAP(gen6_src_index);
+   INIT_MAP(gen7_control_index);
+   INIT_MAP(gen7_datatype);
+   INIT_MAP(gen7_subreg);
+   INIT_MAP(gen7_src_index);
+   INIT_MAP(gen8_control_index);
+   INIT_MAP(gen8_datatype);
+   INIT_MAP(gen8_subreg);
+   INIT_MAP(gen8_src_index);
+   INIT_MAP(gen11_datatype);
+
+#undef INIT_MAP
+}
+
 static const uint32_t *control_index_table;
 static const uint32_t *datatype_table;
 static const uint16_t *subreg_table;
 static const uint16_t *src_index_table;
 
+static const struct compaction_map *control_index_map;
+static const struct compaction_map *datatype_map;
+static const struct compaction_map *subreg_map;
+static const struct compaction_map *src_index_map;
+
 static bool
 set_control_index(const struct gen_device_info *devinfo,
                   brw_compact_inst *dst, const brw_inst *src)
@@ -723,14 +827,12 @@ set_control_index(const struct gen_device_info *devinfo,
    if (devinfo->gen == 7)
       uncompacted |= brw_inst_bits(src, 90, 89) << 17; /* 2b */
 
-   for (int i = 0; i < 32; i++) {
-      if (control_index_table[i] == uncompacted) {
-         brw_compact_inst_set_control_index(devinfo, dst, i);
-	 return true;
-      }
-   }
+   int index = compaction_map_lookup(control_index_map, uncompacted);
+   if (index < 0)
+      return false;
 
-   return false;
+   brw_compact_inst_set_control_index(devinfo, dst, index);
+   return true;
 }
 
 static bool
@@ -744,14 +846,12 @@ set_datatype_index(const struct gen_device_info *devinfo, brw_compact_inst *dst,
       : (brw_inst_bits(src, 63, 61) << 15) | /*  3b */
         (brw_inst_bits(src, 46, 32));        /* 15b */
 
-   for (int i = 0; i < 32; i++) {
-      if (datatype_table[i] == uncompacted) {
-         brw_compact_inst_set_datatype_index(devinfo, dst, i);
-	 return true;
-      }
-   }
+   int index = compaction_map_lookup(datatype_map, uncompacted);
+   if (index < 0)
+      return false;
 
-   return false;
+   brw_compact_inst_set_datatype_index(devinfo, dst, index);
+   return true;
 }
 
 static bool
@@ -765,28 +865,24 @@ set_subreg_index(const struct gen_device_info *devinfo, brw_compact_inst *dst,
    if (!is_immediate)
       uncompacted |= brw_inst_bits(src, 100, 96) << 10; /* 5b */
 
-   for (int i = 0; i < 32; i++) {
-      if (subreg_table[i] == uncompacted) {
-         brw_compact_inst_set_subreg_index(devinfo, dst, i);
-	 return true;
-      }
-   }
+   int index = compaction_map_lookup(subreg_map, uncompacted);
+   if (index < 0)
+      return false;
 
-   return false;
+   brw_compact_inst_set_subreg_index(devinfo, dst, index);
+   return true;
 }
 
 static bool
 get_src_index(uint16_t uncompacted,
               uint16_t *compacted)
 {
-   for (int i = 0; i < 32; i++) {
-      if (src_index_table[i] == uncompacted) {
-	 *compacted = i;
-	 return true;
-      }
-   }
+   int index = compaction_map_lookup(src_index_map, uncompacted);
+   if (index < 0)
+      return false;
 
-   return false;
+   *compacted = index;
+   return true;
 }
 
 static bool
@@ -1487,12 +1583,19 @@ brw_init_compaction_tables(const struct gen_device_info *devinfo)
    assert(gen8_src_index_table[ARRAY_SIZE(gen8_src_index_table) - 1] != 0);
    assert(gen11_datatype_table[ARRAY_SIZE(gen11_datatype_table) - 1] != 0);
 
+   static once_flag compaction_maps_once = ONCE_FLAG_INIT;
+   call_once(&compaction_maps_once, init_compaction_maps);
+
    switch (devinfo->gen) {
    case 11:
       control_index_table = gen8_control_index_table;
       datatype_table = gen11_datatype_table;
       subreg_table = gen8_subreg_table;
       src_index_table = gen8_src_index_table;
+      control_index_map = &gen8_control_index_map;
+      datatype_map = &gen11_datatype_map;
+      subreg_map = &gen8_subreg_map;
+      src_index_map = &gen8_src_index_map;
       break;
    case 10:
    case 9:
@@ -1501,18 +1604,30 @@ brw_init_compaction_tables(const struct gen_device_info *devinfo)
       datatype_table = gen8_datatype_table;
       subreg_table = gen8_subreg_table;
       src_index_table = gen8_src_index_table;
+      control_index_map = &gen8_control_index_map;
+      datatype_map = &gen8_datatype_map;
+      subreg_map = &gen8_subreg_map;
+      src_index_map = &gen8_src_index_map;
       break;
    case 7:
       control_index_table = gen7_control_index_table;
       datatype_table = gen7_datatype_table;
       subreg_table = gen7_subreg_table;
       src_index_table = gen7_src_index_table;
+      control_index_map = &gen7_control_index_map;
+      datatype_map = &gen7_datatype_map;
+      subreg_map = &gen7_subreg_map;
+      src_index_map = &gen7_src_index_map;
       break;
    case 6:
       control_index_table = gen6_control_index_table;
       datatype_table = gen6_datatype_table;
       subreg_table = gen6_subreg_table;
       src_index_table = gen6_src_index_table;
+      control_index_map = &gen6_control_index_map;
+      datatype_map = &gen6_datatype_map;
+      subreg_map = &gen6_subreg_map;
+      src_index_map = &gen6_src_index_map;
       break;
    case 5:
    case 4:
@@ -1520,12 +1635,43 @@ brw_init_compaction_tables(const struct gen_device_info *devinfo)
       datatype_table = g45_datatype_table;
       subreg_table = g45_subreg_table;
       src_index_table = g45_src_index_table;
+      control_index_map = &g45_control_index_map;
+      datatype_map = &g45_datatype_map;
+      subreg_map = &g45_subreg_map;
+      src_index_map = &g45_src_index_map;
       break;
    default:
       unreachable("unknown generation");
    }
 }
 
+/**
+ * Whether brw_compact_instructions() may have to adjust the jump distance of
+ * an instruction once the instructions around it have been compacted.
+ */
+static bool
+is_jump_instruction(const struct gen_device_info *devinfo,
+                    const brw_inst *inst)
+{
+   switch (brw_inst_opcode(devinfo, inst)) {
+   case BRW_OPCODE_BREAK:
+   case BRW_OPCODE_CONTINUE:
+   case BRW_OPCODE_HALT:
+   case BRW_OPCODE_IF:
+   case BRW_OPCODE_IFF:
+   case BRW_OPCODE_ELSE:
+   case BRW_OPCODE_ENDIF:
+   case BRW_OPCODE_WHILE:
+      return true;
+   case BRW_OPCODE_ADD:
+      return brw_inst_dst_reg_file(devinfo, inst) ==
+                BRW_ARCHITECTURE_REGISTER_FILE &&
+             brw_inst_dst_da_reg_nr(devinfo, inst) == BRW_ARF_IP;
+   default:
+      return false;
+   }
+}
+
 void
 brw_compact_instructions(struct brw_codegen *p, int start_offset,
                          struct disasm_info *disasm)
@@ -1537,9 +1683,10 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
    void *store = p->store + start_offset / 16;
    /* For an instruction at byte offset 16*i before compaction, this is the
     * number of compacted instructions minus the number of padding NOP/NENOPs
-    * that preceded it.
+    * that preceded it.  The extra entry is for jumps to the end of the
+    * program.
     */
-   int compacted_counts[(p->next_insn_offset - start_offset) / sizeof(brw_inst)];
+   int compacted_counts[(p->next_insn_offset - start_offset) / sizeof(brw_inst) + 1];
    /* For an instruction at byte offset 8*i after compaction, this was its IP
     * (in 16-byte units) before compaction.
     */
@@ -1548,6 +1695,13 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
    if (devinfo->gen == 4 && !devinfo->is_g4x)
       return;
 
+   /* Offsets after compaction of the instructions whose jump distances need
+    * fixing up, so that the second pass doesn't have to walk the whole
+    * program.
+    */
+   struct util_dynarray jumps;
+   util_dynarray_init(&jumps, NULL);
+
    int offset = 0;
    int compacted_count = 0;
    for (int src_offset = 0; src_offset < p->next_insn_offset - start_offset;
@@ -1561,6 +1715,8 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
       brw_inst inst = precompact(devinfo, *src);
       brw_inst saved = inst;
 
+      const bool is_jump = is_jump_instruction(devinfo, &inst);
+
       if (brw_try_compact_instruction(devinfo, dst, &inst)) {
          compacted_count++;
 
@@ -1572,6 +1728,9 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
             }
          }
 
+         if (is_jump)
+            util_dynarray_append(&jumps, int, offset);
+
          offset += sizeof(brw_compact_inst);
       } else {
          /* All uncompacted instructions need to be aligned on G45. */
@@ -1594,6 +1753,10 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
          if (offset != src_offset) {
             memmove(dst, src, sizeof(brw_inst));
          }
+
+         if (is_jump)
+            util_dynarray_append(&jumps, int, offset);
+
          offset += sizeof(brw_inst);
       }
    }
@@ -1603,13 +1766,14 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
     */
    old_ip[offset / sizeof(brw_compact_inst)] =
       (p->next_insn_offset - start_offset) / sizeof(brw_inst);
+   compacted_counts[(p->next_insn_offset - start_offset) / sizeof(brw_inst)] =
+      compacted_count;
 
    /* Fix up control flow offsets. */
    p->next_insn_offset = start_offset + offset;
-   for (offset = 0; offset < p->next_insn_offset - start_offset;
-        offset = next_offset(devinfo, store, offset)) {
-      brw_inst *insn = store + offset;
-      int this_old_ip = old_ip[offset / sizeof(brw_compact_inst)];
+   util_dynarray_foreach(&jumps, int, jump_offset) {
+      brw_inst *insn = store + *jump_offset;
+      int this_old_ip = old_ip[*jump_offset / sizeof(brw_compact_inst)];
       int this_compacted_count = compacted_counts[this_old_ip];
 
       switch (brw_inst_opcode(devinfo, insn)) {
@@ -1685,6 +1849,8 @@ brw_compact_instructions(struct brw_codegen *p, int start_offset,
       }
    }
 
+   util_dynarray_fini(&jumps);
+
    /* p->nr_insn is counting the number of uncompacted instructions still, so
     * divide.  We do want to be sure there's a valid instruction in any
     * alignment padding, so that the next compression pass (for the FS 8/16
@@ -39,6 +39,8 @@
 #include "compiler/glsl_types.h"
 #include "compiler/nir/nir_builder.h"
 #include "program/prog_parameter.h"
+#include "util/u_dynarray.h"
+#include "util/u_queue.h"
 
 using namespace brw;
 
@@ -6252,6 +6254,8 @@ fs_visitor::optimize()
    bld = fs_builder(this, 64);
 
    assign_constant_locations();
+   if (uniforms_assigned)
+      uniforms_assigned(this, uniforms_assigned_data);
    lower_constant_loads();
 
    validate();
@@ -6261,7 +6265,9 @@ fs_visitor::optimize()
 
 #define OPT(pass, args...) ({                                           \
       pass_num++;                                                       \
+      uint64_t pass_start = brw_pass_start(compiler);                   \
       bool this_progress = pass(args);                                  \
+      brw_pass_end(compiler, stage, dispatch_width, #pass, pass_start); \
                                                                         \
       if (unlikely(INTEL_DEBUG & DEBUG_OPTIMIZER) && this_progress) {   \
          char filename[64];                                             \
@@ -6432,7 +6438,9 @@ fs_visitor::allocate_registers(unsigned min_dispatch_width, bool allow_spilling)
          assign_regs_trivial();
          allocated_without_spills = true;
       } else {
+         uint64_t start = brw_pass_start(compiler);
          allocated_without_spills = assign_regs(false, spill_all);
+         brw_pass_end(compiler, stage, dispatch_width, "assign_regs", start);
       }
       if (allocated_without_spills)
          break;
@@ -6460,10 +6468,12 @@ fs_visitor::allocate_registers(unsigned min_dispatch_width, bool allow_spilling)
       /* Since we're out of heuristics, just go spill registers until we
        * get an allocation.
        */
+      uint64_t start = brw_pass_start(compiler);
       while (!assign_regs(true, spill_all)) {
          if (failed)
             break;
       }
+      brw_pass_end(compiler, stage, dispatch_width, "assign_regs", start);
    }
 
    /* This must come after all optimization and register allocation, since
@@ -7087,6 +7097,256 @@ brw_register_blocks(int reg_count)
    return ALIGN(reg_count, 16) / 16 - 1;
 }
 
+static nir_shader *
+compile_cs_to_nir(const struct brw_compiler *compiler,
+                  void *mem_ctx,
+                  const struct brw_cs_prog_key *key,
+                  const nir_shader *src_shader,
+                  unsigned dispatch_width);
+
+struct brw_simd_compile_msg {
+   bool perf;
+   char *msg;
+};
+
+/**
+ * A SIMD16 or SIMD32 compile of a fragment or compute shader, running on
+ * compiler->simd_queue while the compile it takes its uniform layout from is
+ * being finished.
+ *
+ * The compile only gets private copies of the state it writes: it allocates
+ * from its own ralloc context, which the caller's mem_ctx steals after the
+ * join, it fills its own copy of the prog_data, and its compiler is a copy
+ * whose log callbacks keep the messages until the caller replays them.
+ */
+struct brw_simd_compile {
+   struct util_queue_fence fence;
+
+   struct brw_compiler compiler;
+   union {
+      struct brw_stage_prog_data base;
+      struct brw_wm_prog_data wm;
+      struct brw_cs_prog_data cs;
+   } prog_data;
+   void *mem_ctx;
+   struct util_dynarray log;
+
+   const void *key;
+   struct gl_program *prog;
+   /* The fragment shader, or the compute shader before its lowering for the
+    * dispatch width.
+    */
+   const nir_shader *shader;
+   unsigned dispatch_width;
+   int shader_time_index;
+   fs_visitor *uniforms_from;
+
+   bool allow_spilling;
+   bool use_rep_send;
+   unsigned min_dispatch_width;
+
+   fs_visitor *v;
+};
+
+/**
+ * The SIMD16 and SIMD32 compiles started by the first compile of a shader
+ * once it has assigned its uniforms.
+ */
+struct brw_simd_fork {
+   const struct brw_compiler *compiler;
+   void *mem_ctx;
+   struct brw_stage_prog_data *prog_data;
+   size_t prog_data_size;
+
+   const void *key;
+   struct gl_program *prog;
+   const nir_shader *shader;
+   int shader_time_index[2];
+   bool allow_spilling;
+   bool use_rep_send;
+   unsigned min_dispatch_width;
+
+   /** Dispatch widths the compiles should be started for. */
+   unsigned widths;
+   /** The SIMD16 and SIMD32 compiles, if started. */
+   struct brw_simd_compile *jobs[2];
+};
+
+static void
+simd_compile_vlog(struct brw_simd_compile *job, bool perf,
+                  const char *fmt, va_list args)
+{
+   struct brw_simd_compile_msg msg;
+   msg.perf = perf;
+   msg.msg = ralloc_vasprintf(job->mem_ctx, fmt, args);
+   util_dynarray_append(&job->log, struct brw_simd_compile_msg, msg);
+}
+
+static void
+simd_compile_debug_log(void *data, const char *fmt, ...)
+{
+   va_list args;
+   va_start(args, fmt);
+   simd_compile_vlog((struct brw_simd_compile *) data, false, fmt, args);
+   va_end(args);
+}
+
+static void
+simd_compile_perf_log(void *data, const char *fmt, ...)
+{
+   va_list args;
+   va_start(args, fmt);
+   simd_compile_vlog((struct brw_simd_compile *) data, true, fmt, args);
+   va_end(args);
+}
+
+static void
+run_simd_compile(void *data, int thread_index)
+{
+   struct brw_simd_compile *job = (struct brw_simd_compile *) data;
+   const nir_shader *shader = job->shader;
+
+   if (shader->info.stage == MESA_SHADER_COMPUTE) {
+      shader = compile_cs_to_nir(&job->compiler, job->mem_ctx,
+                                 (const struct brw_cs_prog_key *) job->key,
+                                 shader, job->dispatch_width);
+   }
+
+   job->v = new fs_visitor(&job->compiler, job, job->mem_ctx, job->key,
+                           &job->prog_data.base, job->prog, shader,
+                           job->dispatch_width, job->shader_time_index);
+   job->v->import_uniforms(job->uniforms_from);
+
+   if (shader->info.stage == MESA_SHADER_COMPUTE)
+      job->v->run_cs(job->min_dispatch_width);
+   else
+      job->v->run_fs(job->allow_spilling, job->use_rep_send);
+}
+
+/**
+ * fs_visitor::uniforms_assigned callback of the first compile, starting the
+ * wider ones.
+ */
+static void
+start_simd_compiles(fs_visitor *v, void *data)
+{
+   struct brw_simd_fork *simd = (struct brw_simd_fork *) data;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(simd->jobs); i++) {
+      const unsigned width = 16 << i;
+
+      if (!(simd->widths & width) || width <= v->dispatch_width ||
+          v->max_dispatch_width < width)
+         continue;
+
+      struct brw_simd_compile *job =
+         rzalloc(simd->mem_ctx, struct brw_simd_compile);
+
+      util_queue_fence_init(&job->fence);
+      job->compiler = *simd->compiler;
+      job->compiler.shader_debug_log = simd_compile_debug_log;
+      job->compiler.shader_perf_log = simd_compile_perf_log;
+      assert(simd->prog_data_size <= sizeof(job->prog_data));
+      memcpy(&job->prog_data, simd->prog_data, simd->prog_data_size);
+      /* Only set by register allocation, which this compile hasn't got to,
+       * so that the join can tell whether the wider one set it.
+       */
+      job->prog_data.base.total_scratch = 0;
+      job->mem_ctx = ralloc_context(NULL);
+      util_dynarray_init(&job->log, job->mem_ctx);
+
+      job->key = simd->key;
+      job->prog = simd->prog;
+      job->shader = simd->shader;
+      job->dispatch_width = width;
+      job->shader_time_index = simd->shader_time_index[i];
+      job->uniforms_from = v;
+      job->allow_spilling = simd->allow_spilling;
+      job->use_rep_send = simd->use_rep_send;
+      job->min_dispatch_width = simd->min_dispatch_width;
+
+      simd->jobs[i] = job;
+      util_queue_add_job(simd->compiler->simd_queue, job, &job->fence,
+                         run_simd_compile, NULL);
+   }
+}
+
+/**
+ * Sets up the first compile of a shader to start the SIMD16 and SIMD32
+ * compiles in the given mask on compiler->simd_queue.  Shaders whose
+ * compile prints debug output are compiled one variant after the other, so
+ * that the output isn't interleaved.
+ */
+static void
+fork_simd_compiles(struct brw_simd_fork *simd, fs_visitor *v, unsigned widths)
+{
+   const uint64_t debug_flags =
+      intel_debug_flag_for_shader_stage(v->stage) | DEBUG_OPTIMIZER;
+
+   if (!simd->compiler->simd_queue || (INTEL_DEBUG & debug_flags))
+      return;
+
+   simd->widths = widths;
+   v->uniforms_assigned = start_simd_compiles;
+   v->uniforms_assigned_data = simd;
+}
+
+/**
+ * Waits for the compile of the given width if it was started, and returns
+ * its visitor as if the compile had run here, after the first one: the
+ * messages it logged are passed on and the prog_data fields it sets are
+ * copied.  Everything else it writes to the prog_data has the same value as
+ * what the first compile wrote.
+ */
+static fs_visitor *
+join_simd_compile(struct brw_simd_fork *simd, unsigned width,
+                  void *log_data)
+{
+   struct brw_simd_compile *job = simd->jobs[width / 32];
+   if (!job)
+      return NULL;
+
+   simd->jobs[width / 32] = NULL;
+   util_queue_fence_wait(&job->fence);
+   util_queue_fence_destroy(&job->fence);
+
+   util_dynarray_foreach(&job->log, struct brw_simd_compile_msg, msg) {
+      if (msg->perf)
+         simd->compiler->shader_perf_log(log_data, "%s", msg->msg);
+      else
+         simd->compiler->shader_debug_log(log_data, "%s", msg->msg);
+   }
+
+   if (job->prog_data.base.total_scratch)
+      simd->prog_data->total_scratch = job->prog_data.base.total_scratch;
+   simd->prog_data->binding_table.size_bytes =
+      MAX2(simd->prog_data->binding_table.size_bytes,
+           job->prog_data.base.binding_table.size_bytes);
+
+   ralloc_steal(simd->mem_ctx, job->mem_ctx);
+   return job->v;
+}
+
+/**
+ * Waits for and throws away the compiles that ended up not being needed,
+ * e.g. because the first compile failed.
+ */
+static void
+discard_simd_compiles(struct brw_simd_fork *simd)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(simd->jobs); i++) {
+      struct brw_simd_compile *job = simd->jobs[i];
+      if (!job)
+         continue;
+
+      util_queue_fence_wait(&job->fence);
+      util_queue_fence_destroy(&job->fence);
+      delete job->v;
+      ralloc_free(job->mem_ctx);
+      simd->jobs[i] = NULL;
+   }
+}
+
 const unsigned *
 brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
                void *mem_ctx,
@@ -7145,10 +7405,32 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
 
    cfg_t *simd8_cfg = NULL, *simd16_cfg = NULL, *simd32_cfg = NULL;
 
+   const bool try_simd16 = likely(!(INTEL_DEBUG & DEBUG_NO16) || use_rep_send);
+   /* Currently, the compiler only supports SIMD32 on SNB+ */
+   const bool try_simd32 = !use_rep_send && compiler->devinfo->gen >= 6 &&
+                           unlikely(INTEL_DEBUG & DEBUG_DO32);
+
+   struct brw_simd_fork simd = {};
+   simd.compiler = compiler;
+   simd.mem_ctx = mem_ctx;
+   simd.prog_data = &prog_data->base;
+   simd.prog_data_size = sizeof(*prog_data);
+   simd.key = key;
+   simd.prog = prog;
+   simd.shader = shader;
+   simd.shader_time_index[0] = shader_time_index16;
+   simd.shader_time_index[1] = shader_time_index32;
+   simd.allow_spilling = allow_spilling;
+   simd.use_rep_send = use_rep_send;
+
    fs_visitor v8(compiler, log_data, mem_ctx, key,
                  &prog_data->base, prog, shader, 8,
                  shader_time_index8);
+   fork_simd_compiles(&simd, &v8,
+                      (try_simd16 ? 16 : 0) | (try_simd32 ? 32 : 0));
    if (!v8.run_fs(allow_spilling, false /* do_rep_send */)) {
+      discard_simd_compiles(&simd);
+
       if (error_str)
          *error_str = ralloc_strdup(mem_ctx, v8.fail_msg);
 
@@ -7159,42 +7441,54 @@ brw_compile_fs(const struct brw_compiler *compiler, void *log_data,
       prog_data->reg_blocks_8 = brw_register_blocks(v8.grf_used);
    }
 
-   if (v8.max_dispatch_width >= 16 &&
-       likely(!(INTEL_DEBUG & DEBUG_NO16) || use_rep_send)) {
-      /* Try a SIMD16 compile */
-      fs_visitor v16(compiler, log_data, mem_ctx, key,
-                     &prog_data->base, prog, shader, 16,
-                     shader_time_index16);
-      v16.import_uniforms(&v8);
-      if (!v16.run_fs(allow_spilling, use_rep_send)) {
+   if (v8.max_dispatch_width >= 16 && try_simd16) {
+      /* Try a SIMD16 compile, unless it already ran on the compiler
+       * threads.
+       */
+      fs_visitor *v16 = join_simd_compile(&simd, 16, log_data);
+      if (!v16) {
+         v16 = new fs_visitor(compiler, log_data, mem_ctx, key,
+                              &prog_data->base, prog, shader, 16,
+                              shader_time_index16);
+         v16->import_uniforms(&v8);
+         v16->run_fs(allow_spilling, use_rep_send);
+      }
+
+      if (v16->failed) {
          compiler->shader_perf_log(log_data,
                                    "SIMD16 shader failed to compile: %s",
-                                   v16.fail_msg);
+                                   v16->fail_msg);
       } else {
-         simd16_cfg = v16.cfg;
-         prog_data->dispatch_grf_start_reg_16 = v16.payload.num_regs;
-         prog_data->reg_blocks_16 = brw_register_blocks(v16.grf_used);
+         simd16_cfg = v16->cfg;
+         prog_data->dispatch_grf_start_reg_16 = v16->payload.num_regs;
+         prog_data->reg_blocks_16 = brw_register_blocks(v16->grf_used);
       }
+
+      delete v16;
    }
 
-   /* Currently, the compiler only supports SIMD32 on SNB+ */
-   if (v8.max_dispatch_width >= 32 && !use_rep_send &&
-       compiler->devinfo->gen >= 6 &&
-       unlikely(INTEL_DEBUG & DEBUG_DO32)) {
+   if (v8.max_dispatch_width >= 32 && try_simd32) {
       /* Try a SIMD32 compile */
-      fs_visitor v32(compiler, log_data, mem_ctx, key,
-                     &prog_data->base, prog, shader, 32,
-                     shader_time_index32);
-      v32.import_uniforms(&v8);
-      if (!v32.run_fs(allow_spilling, false)) {
+      fs_visitor *v32 = join_simd_compile(&simd, 32, log_data);
+      if (!v32) {
+         v32 = new fs_visitor(compiler, log_data, mem_ctx, key,
+                              &prog_data->base, prog, shader, 32,
+                              shader_time_index32);
+         v32->import_uniforms(&v8);
+         v32->run_fs(allow_spilling, false);
+      }
+
+      if (v32->failed) {
          compiler->shader_perf_log(log_data,
                                    "SIMD32 shader failed to compile: %s",
-                                   v32.fail_msg);
+                                   v32->fail_msg);
       } else {
-         simd32_cfg = v32.cfg;
-         prog_data->dispatch_grf_start_reg_32 = v32.payload.num_regs;
-         prog_data->reg_blocks_32 = brw_register_blocks(v32.grf_used);
+         simd32_cfg = v32->cfg;
+         prog_data->dispatch_grf_start_reg_32 = v32->payload.num_regs;
+         prog_data->reg_blocks_32 = brw_register_blocks(v32->grf_used);
       }
+
+      delete v32;
    }
 
    /* When the caller requests a repclear shader, they want SIMD16-only */
@@ -7396,6 +7690,26 @@ brw_compile_cs(const struct brw_compiler *compiler, void *log_data,
    const char *fail_msg = NULL;
    unsigned promoted_constants = 0;
 
+   const bool try_simd16 = likely(!(INTEL_DEBUG & DEBUG_NO16)) &&
+                           min_dispatch_width <= 16;
+   const bool try_simd32 = min_dispatch_width > 16 ||
+                           (INTEL_DEBUG & DEBUG_DO32);
+
+   /* The SIMD16 and SIMD32 compiles lower their own copy of the shader, so
+    * they can run on the compiler threads as soon as the first compile has
+    * assigned the uniforms.
+    */
+   struct brw_simd_fork simd = {};
+   simd.compiler = compiler;
+   simd.mem_ctx = mem_ctx;
+   simd.prog_data = &prog_data->base;
+   simd.prog_data_size = sizeof(*prog_data);
+   simd.key = key;
+   simd.shader = src_shader;
+   simd.shader_time_index[0] = shader_time_index;
+   simd.shader_time_index[1] = shader_time_index;
+   simd.min_dispatch_width = min_dispatch_width;
+
    /* Now the main event: Visit the shader IR and generate our CS IR for it.
     */
    if (min_dispatch_width <= 8) {
@@ -7404,6 +7718,8 @@ brw_compile_cs(const struct brw_compiler *compiler, void *log_data,
       v8 = new fs_visitor(compiler, log_data, mem_ctx, key, &prog_data->base,
                           NULL, /* Never used in core profile */
                           nir8, 8, shader_time_index);
+      fork_simd_compiles(&simd, v8,
+                         (try_simd16 ? 16 : 0) | (try_simd32 ? 32 : 0));
       if (!v8->run_cs(min_dispatch_width)) {
          fail_msg = v8->fail_msg;
       } else {
@@ -7417,18 +7733,28 @@ brw_compile_cs(const struct brw_compiler *compiler, void *log_data,
       }
    }
 
-   if (likely(!(INTEL_DEBUG & DEBUG_NO16)) &&
-       !fail_msg && min_dispatch_width <= 16) {
-      /* Try a SIMD16 compile */
-      nir_shader *nir16 = compile_cs_to_nir(compiler, mem_ctx, key,
-                                            src_shader, 16);
-      v16 = new fs_visitor(compiler, log_data, mem_ctx, key, &prog_data->base,
-                           NULL, /* Never used in core profile */
-                           nir16, 16, shader_time_index);
-      if (v8)
-         v16->import_uniforms(v8);
+   if (try_simd16 && !fail_msg) {
+      /* Try a SIMD16 compile, unless it already ran on the compiler
+       * threads.
+       */
+      v16 = join_simd_compile(&simd, 16, log_data);
+      if (!v16) {
+         nir_shader *nir16 = compile_cs_to_nir(compiler, mem_ctx, key,
+                                               src_shader, 16);
+         v16 = new fs_visitor(compiler, log_data, mem_ctx, key,
+                              &prog_data->base,
+                              NULL, /* Never used in core profile */
+                              nir16, 16, shader_time_index);
+         if (v8) {
+            v16->import_uniforms(v8);
+         } else {
+            fork_simd_compiles(&simd, v16, try_simd32 ? 32 : 0);
+         }
 
-      if (!v16->run_cs(min_dispatch_width)) {
+         v16->run_cs(min_dispatch_width);
+      }
+
+      if (v16->failed) {
          compiler->shader_perf_log(log_data,
                                    "SIMD16 shader failed to compile: %s",
                                    v16->fail_msg);
@@ -7451,22 +7777,28 @@ brw_compile_cs(const struct brw_compiler *compiler, void *log_data,
    /* We should always be able to do SIMD32 for compute shaders */
    assert(!v16 || v16->max_dispatch_width >= 32);
 
-   if (!fail_msg && (min_dispatch_width > 16 || (INTEL_DEBUG & DEBUG_DO32))) {
+   if (try_simd32 && !fail_msg) {
       /* Try a SIMD32 compile */
-      nir_shader *nir32 = compile_cs_to_nir(compiler, mem_ctx, key,
-                                            src_shader, 32);
-      v32 = new fs_visitor(compiler, log_data, mem_ctx, key, &prog_data->base,
-                           NULL, /* Never used in core profile */
-                           nir32, 32, shader_time_index);
-      if (v8)
-         v32->import_uniforms(v8);
-      else if (v16)
-         v32->import_uniforms(v16);
-
-      if (!v32->run_cs(min_dispatch_width)) {
+      v32 = join_simd_compile(&simd, 32, log_data);
+      if (!v32) {
+         nir_shader *nir32 = compile_cs_to_nir(compiler, mem_ctx, key,
+                                               src_shader, 32);
+         v32 = new fs_visitor(compiler, log_data, mem_ctx, key,
+                              &prog_data->base,
+                              NULL, /* Never used in core profile */
+                              nir32, 32, shader_time_index);
+         if (v8)
+            v32->import_uniforms(v8);
+         else if (v16)
+            v32->import_uniforms(v16);
+
+         v32->run_cs(min_dispatch_width);
+      }
+
+      if (v32->failed) {
          compiler->shader_perf_log(log_data,
                                    "SIMD32 shader failed to compile: %s",
-                                   v16->fail_msg);
+                                   v32->fail_msg);
          if (!cfg) {
             fail_msg =
                "Couldn't generate SIMD32 program and not "
@@ -7480,6 +7812,9 @@ brw_compile_cs(const struct brw_compiler *compiler, void *log_data,
       }
    }
 
+   /* Compiles started for a first one that then failed. */
+   discard_simd_compiles(&simd);
+
    const unsigned *ret = NULL;
    if (unlikely(cfg == NULL)) {
       assert(fail_msg);
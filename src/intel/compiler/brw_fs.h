@@ -127,6 +127,7 @@ public:
                       unsigned *out_pull_index);
    void lower_constant_loads();
    void invalidate_live_intervals();
+   void invalidate_live_intervals(const bblock_t *block);
    void calculate_live_intervals();
    void calculate_register_pressure();
    void validate();
@@ -320,6 +321,14 @@ public:
     */
    int *push_constant_loc;
 
+   /**
+    * Called by optimize() once the push and pull constant layout has been
+    * decided, which is all that compiles taking it with import_uniforms()
+    * need from this one, so that they can start.
+    */
+   void (*uniforms_assigned)(fs_visitor *v, void *data);
+   void *uniforms_assigned_data;
+
    fs_reg subgroup_id;
    fs_reg frag_depth;
    fs_reg frag_stencil;
@@ -334,11 +334,11 @@ fs_visitor::opt_cmod_propagation()
    bool progress = false;
 
    foreach_block_reverse(block, cfg) {
-      progress = opt_cmod_propagation_local(devinfo, block) || progress;
+      if (opt_cmod_propagation_local(devinfo, block)) {
+         invalidate_live_intervals(block);
+         progress = true;
+      }
    }
 
-   if (progress)
-      invalidate_live_intervals();
-
    return progress;
 }
@@ -871,8 +871,11 @@ fs_visitor::opt_copy_propagation()
     * the set of copies available at the end of the block.
     */
    foreach_block (block, cfg) {
-      progress = opt_copy_propagation_local(copy_prop_ctx, block,
-                                            out_acp[block->num]) || progress;
+      if (opt_copy_propagation_local(copy_prop_ctx, block,
+                                     out_acp[block->num])) {
+         invalidate_live_intervals(block);
+         progress = true;
+      }
    }
 
    /* Do dataflow analysis for those available copies. */
@@ -891,16 +894,15 @@ fs_visitor::opt_copy_propagation()
          }
       }
 
-      progress = opt_copy_propagation_local(copy_prop_ctx, block, in_acp) ||
-                 progress;
+      if (opt_copy_propagation_local(copy_prop_ctx, block, in_acp)) {
+         invalidate_live_intervals(block);
+         progress = true;
+      }
    }
 
    for (int i = 0; i < cfg->num_blocks; i++)
       delete [] out_acp[i];
    ralloc_free(copy_prop_ctx);
 
-   if (progress)
-      invalidate_live_intervals();
-
    return progress;
 }
@@ -369,11 +369,11 @@ fs_visitor::opt_cse()
    calculate_live_intervals();
 
    foreach_block (block, cfg) {
-      progress = opt_cse_local(block) || progress;
+      if (opt_cse_local(block)) {
+         invalidate_live_intervals(block);
+         progress = true;
+      }
    }
 
-   if (progress)
-      invalidate_live_intervals();
-
    return progress;
 }
@@ -84,6 +84,8 @@ fs_visitor::dead_code_eliminate()
    BITSET_WORD *flag_live = rzalloc_array(NULL, BITSET_WORD, 1);
 
    foreach_block_reverse_safe(block, cfg) {
+      bool block_progress = false;
+
       memcpy(live, live_intervals->block_data[block->num].liveout,
              sizeof(BITSET_WORD) * BITSET_WORDS(num_vars));
       memcpy(flag_live, live_intervals->block_data[block->num].flag_liveout,
@@ -100,13 +102,13 @@ fs_visitor::dead_code_eliminate()
             if (!result_live &&
                 (can_omit_write(inst) || can_eliminate(inst, flag_live))) {
                inst->dst = fs_reg(retype(brw_null_reg(), inst->dst.type));
-               progress = true;
+               block_progress = true;
             }
          }
 
          if (inst->dst.is_null() && can_eliminate(inst, flag_live)) {
             inst->opcode = BRW_OPCODE_NOP;
-            progress = true;
+            block_progress = true;
          }
 
          if (inst->dst.file == VGRF) {
@@ -138,13 +140,15 @@ fs_visitor::dead_code_eliminate()
 
          flag_live[0] |= inst->flags_read(devinfo);
       }
+
+      if (block_progress) {
+         invalidate_live_intervals(block);
+         progress = true;
+      }
    }
 
    ralloc_free(live);
    ralloc_free(flag_live);
 
-   if (progress)
-      invalidate_live_intervals();
-
    return progress;
 }
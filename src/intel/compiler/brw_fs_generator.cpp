@@ -1773,6 +1773,7 @@ fs_generator::generate_code(const cfg_t *cfg, int dispatch_width)
 
    this->dispatch_width = dispatch_width;
 
+   uint64_t pass_start = brw_pass_start(compiler);
    int start_offset = p->next_insn_offset;
    int spill_count = 0, fill_count = 0;
    int loop_count = 0;
@@ -2459,8 +2460,13 @@ fs_generator::generate_code(const cfg_t *cfg, int dispatch_width)
                                 p->next_insn_offset,
                                 disasm_info);
 
+   brw_pass_end(compiler, stage, dispatch_width, "generate_code", pass_start);
+
    int before_size = p->next_insn_offset - start_offset;
+   pass_start = brw_pass_start(compiler);
    brw_compact_instructions(p, start_offset, disasm_info);
+   brw_pass_end(compiler, stage, dispatch_width, "brw_compact_instructions",
+                pass_start);
    int after_size = p->next_insn_offset - start_offset;
 
    if (unlikely(debug_flag)) {
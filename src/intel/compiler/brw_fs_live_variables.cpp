@@ -52,6 +52,29 @@ using namespace brw;
  * 14.1 (p444).
  */
 
+/**
+ * Records an access to \p var at \p ip, relative to the start of the block
+ * being set up.
+ */
+void
+fs_live_variables::setup_one_access(int var, int ip, bool written)
+{
+   if (range_from_var[var] < 0) {
+      struct var_range *r = &block_ranges[num_block_ranges];
+
+      range_from_var[var] = num_block_ranges++;
+      r->var = var;
+      r->start = ip;
+      r->end = ip;
+      r->written = written;
+   } else {
+      struct var_range *r = &block_ranges[range_from_var[var]];
+
+      r->end = ip;
+      r->written |= written;
+   }
+}
+
 void
 fs_live_variables::setup_one_read(struct block_data *bd, fs_inst *inst,
                                   int ip, const fs_reg &reg)
@@ -59,8 +82,7 @@ fs_live_variables::setup_one_read(struct block_data *bd, fs_inst *inst,
    int var = var_from_reg(reg);
    assert(var < num_vars);
 
-   start[var] = MIN2(start[var], ip);
-   end[var] = MAX2(end[var], ip);
+   setup_one_access(var, ip, false);
 
    /* The use[] bitset marks when the block makes use of a variable (VGRF
     * channel) without having completely defined that variable within the
@@ -77,8 +99,7 @@ fs_live_variables::setup_one_write(struct block_data *bd, fs_inst *inst,
    int var = var_from_reg(reg);
    assert(var < num_vars);
 
-   start[var] = MIN2(start[var], ip);
-   end[var] = MAX2(end[var], ip);
+   setup_one_access(var, ip, true);
 
    /* The def[] bitset marks when an initialization in a block completely
     * screens off previous updates of that variable (VGRF channel).
@@ -86,19 +107,20 @@ fs_live_variables::setup_one_write(struct block_data *bd, fs_inst *inst,
    if (inst->dst.file == VGRF) {
       if (!inst->is_partial_write() && !BITSET_TEST(bd->use, var))
          BITSET_SET(bd->def, var);
-
-      BITSET_SET(bd->defout, var);
    }
 }
 
 /**
- * Sets up the use[] and def[] bitsets.
+ * Sets up the use[] and def[] bitsets and the ranges of the dirty blocks.
  *
  * The basic-block-level live variable analysis needs to know which
  * variables get used before they're completely defined, and which
  * variables are completely defined before they're used.
  *
  * These are tracked at the per-component level, rather than whole VGRFs.
+ *
+ * The other blocks keep the information from the previous update, their
+ * instructions didn't change.
  */
 void
 fs_live_variables::setup_def_use()
@@ -112,7 +134,19 @@ fs_live_variables::setup_def_use()
 
       struct block_data *bd = &block_data[block->num];
 
+      if (!BITSET_TEST(dirty_blocks, block->num)) {
+         ip = block->end_ip + 1;
+         continue;
+      }
+
+      memset(bd->def, 0, 2 * bitset_words * sizeof(BITSET_WORD));
+      bd->flag_def[0] = 0;
+      bd->flag_use[0] = 0;
+      num_block_ranges = 0;
+
       foreach_inst_in_block(fs_inst, inst, block) {
+         const int block_ip = ip - block->start_ip;
+
 	 /* Set use[] for this instruction */
 	 for (unsigned int i = 0; i < inst->sources; i++) {
             fs_reg reg = inst->src[i];
@@ -121,7 +155,7 @@ fs_live_variables::setup_def_use()
                continue;
 
             for (unsigned j = 0; j < regs_read(inst, i); j++) {
-               setup_one_read(bd, inst, ip, reg);
+               setup_one_read(bd, inst, block_ip, reg);
                reg.offset += REG_SIZE;
             }
 	 }
@@ -132,7 +166,7 @@ fs_live_variables::setup_def_use()
          if (inst->dst.file == VGRF) {
             fs_reg reg = inst->dst;
             for (unsigned j = 0; j < regs_written(inst); j++) {
-               setup_one_write(bd, inst, ip, reg);
+               setup_one_write(bd, inst, block_ip, reg);
                reg.offset += REG_SIZE;
             }
 	 }
@@ -142,6 +176,15 @@ fs_live_variables::setup_def_use()
 
 	 ip++;
       }
+
+      ralloc_free(bd->ranges);
+      bd->ranges = ralloc_array(mem_ctx, struct var_range, num_block_ranges);
+      bd->num_ranges = num_block_ranges;
+      memcpy(bd->ranges, block_ranges,
+             num_block_ranges * sizeof(struct var_range));
+
+      for (int i = 0; i < num_block_ranges; i++)
+         range_from_var[block_ranges[i].var] = -1;
    }
 }
 
@@ -150,36 +193,56 @@ fs_live_variables::setup_def_use()
  * propagating it through control flow.  It will eventually terminate
  * because it only ever adds bits, and stops when no bits are added in
  * a pass.
+ *
+ * Only the blocks whose successors (or predecessors, for defin and defout)
+ * gained bits in the previous updates are revisited, so that blocks far from
+ * the loops don't get processed again until everything settles.
+ *
+ * Bits can go away when instructions are modified, so this always starts
+ * over from the def/use information of every block.
  */
 void
 fs_live_variables::compute_live_variables()
 {
+   BITSET_WORD *dirty = rzalloc_array(mem_ctx, BITSET_WORD,
+                                      BITSET_WORDS(cfg->num_blocks));
    bool cont = true;
 
+   for (int i = 0; i < cfg->num_blocks; i++) {
+      struct block_data *bd = &block_data[i];
+
+      memset(bd->livein, 0, 4 * bitset_words * sizeof(BITSET_WORD));
+      bd->flag_livein[0] = 0;
+      bd->flag_liveout[0] = 0;
+
+      for (int j = 0; j < bd->num_ranges; j++) {
+         if (bd->ranges[j].written)
+            BITSET_SET(bd->defout, bd->ranges[j].var);
+      }
+
+      BITSET_SET(dirty, i);
+   }
+
    while (cont) {
       cont = false;
 
       foreach_block_reverse (block, cfg) {
          struct block_data *bd = &block_data[block->num];
+         bool progress = false;
+
+         if (!BITSET_TEST(dirty, block->num))
+            continue;
+
+         BITSET_CLEAR(dirty, block->num);
 
 	 /* Update liveout */
 	 foreach_list_typed(bblock_link, child_link, link, &block->children) {
             struct block_data *child_bd = &block_data[child_link->block->num];
 
-	    for (int i = 0; i < bitset_words; i++) {
-               BITSET_WORD new_liveout = (child_bd->livein[i] &
-                                          ~bd->liveout[i]);
-               if (new_liveout) {
-                  bd->liveout[i] |= new_liveout;
-                  cont = true;
-               }
-	    }
-            BITSET_WORD new_liveout = (child_bd->flag_livein[0] &
-                                       ~bd->flag_liveout[0]);
-            if (new_liveout) {
-               bd->flag_liveout[0] |= new_liveout;
-               cont = true;
-            }
+	    for (int i = 0; i < bitset_words; i++)
+               bd->liveout[i] |= child_bd->livein[i];
+
+            bd->flag_liveout[0] |= child_bd->flag_livein[0];
 	 }
 
          /* Update livein */
@@ -189,7 +252,7 @@ fs_live_variables::compute_live_variables()
                                        ~bd->def[i]));
             if (new_livein & ~bd->livein[i]) {
                bd->livein[i] |= new_livein;
-               cont = true;
+               progress = true;
             }
          }
          BITSET_WORD new_livein = (bd->flag_use[0] |
@@ -197,6 +260,13 @@ fs_live_variables::compute_live_variables()
                                     ~bd->flag_def[0]));
          if (new_livein & ~bd->flag_livein[0]) {
             bd->flag_livein[0] |= new_livein;
+            progress = true;
+         }
+
+         if (progress) {
+            foreach_list_typed(bblock_link, parent_link, link,
+                               &block->parents)
+               BITSET_SET(dirty, parent_link->block->num);
             cont = true;
          }
       }
@@ -205,43 +275,76 @@ fs_live_variables::compute_live_variables()
    /* Propagate defin and defout down the CFG to calculate the union of live
     * variables potentially defined along any possible control flow path.
     */
+   for (int i = 0; i < cfg->num_blocks; i++)
+      BITSET_SET(dirty, i);
+
    do {
       cont = false;
 
       foreach_block (block, cfg) {
          const struct block_data *bd = &block_data[block->num];
 
+         if (!BITSET_TEST(dirty, block->num))
+            continue;
+
+         BITSET_CLEAR(dirty, block->num);
+
 	 foreach_list_typed(bblock_link, child_link, link, &block->children) {
             struct block_data *child_bd = &block_data[child_link->block->num];
+            BITSET_WORD progress = 0;
 
 	    for (int i = 0; i < bitset_words; i++) {
                const BITSET_WORD new_def = bd->defout[i] & ~child_bd->defin[i];
                child_bd->defin[i] |= new_def;
                child_bd->defout[i] |= new_def;
-               cont |= new_def;
+               progress |= new_def;
 	    }
+
+            if (progress) {
+               BITSET_SET(dirty, child_link->block->num);
+               cont = true;
+            }
 	 }
       }
    } while (cont);
+
+   ralloc_free(dirty);
 }
 
 /**
- * Extend the start/end ranges for each variable to account for the
- * new information calculated from control flow.
+ * Compute the start/end ranges for each variable from the accesses in each
+ * block, extended to account for the new information calculated from control
+ * flow.
  */
 void
 fs_live_variables::compute_start_end()
 {
+   for (int i = 0; i < num_vars; i++) {
+      start[i] = MAX_INSTRUCTION;
+      end[i] = -1;
+   }
+
    foreach_block (block, cfg) {
       struct block_data *bd = &block_data[block->num];
 
-      for (int i = 0; i < num_vars; i++) {
-         if (BITSET_TEST(bd->livein, i) && BITSET_TEST(bd->defin, i)) {
+      for (int j = 0; j < bd->num_ranges; j++) {
+         const struct var_range *r = &bd->ranges[j];
+         start[r->var] = MIN2(start[r->var], block->start_ip + r->start);
+         end[r->var] = MAX2(end[r->var], block->start_ip + r->end);
+      }
+
+      for (int w = 0; w < bitset_words; w++) {
+         BITSET_WORD livedefin = bd->livein[w] & bd->defin[w];
+         BITSET_WORD livedefout = bd->liveout[w] & bd->defout[w];
+
+         while (livedefin) {
+            const int i = w * BITSET_WORDBITS + u_bit_scan(&livedefin);
             start[i] = MIN2(start[i], block->start_ip);
             end[i] = MAX2(end[i], block->start_ip);
          }
 
-         if (BITSET_TEST(bd->liveout, i) && BITSET_TEST(bd->defout, i)) {
+         while (livedefout) {
+            const int i = w * BITSET_WORDBITS + u_bit_scan(&livedefout);
             start[i] = MIN2(start[i], block->end_ip);
             end[i] = MAX2(end[i], block->end_ip);
          }
@@ -250,57 +353,156 @@ fs_live_variables::compute_start_end()
 }
 
 fs_live_variables::fs_live_variables(fs_visitor *v, const cfg_t *cfg)
-   : v(v), cfg(cfg)
+   : v(v), cfg(cfg), num_blocks(cfg->num_blocks)
 {
    mem_ctx = ralloc_context(NULL);
 
-   num_vgrfs = v->alloc.count;
+   num_vgrfs = 0;
    num_vars = 0;
-   var_from_vgrf = rzalloc_array(mem_ctx, int, num_vgrfs);
+   bitset_words = 0;
+   var_from_vgrf = NULL;
+   vgrf_from_var = NULL;
+   start = NULL;
+   end = NULL;
+   bitsets = NULL;
+   block_ranges = NULL;
+   range_from_var = NULL;
+
+   block_data = rzalloc_array(mem_ctx, struct block_data, num_blocks);
+
+   /* Set up every block the first time. */
+   dirty_blocks = rzalloc_array(mem_ctx, BITSET_WORD,
+                                BITSET_WORDS(num_blocks));
+   for (int i = 0; i < num_blocks; i++)
+      BITSET_SET(dirty_blocks, i);
+
+   setup_vars();
+   setup_def_use();
+   compute_live_variables();
+   compute_start_end();
+
+   memset(dirty_blocks, 0, BITSET_WORDS(num_blocks) * sizeof(BITSET_WORD));
+   dirty = false;
+}
+
+fs_live_variables::~fs_live_variables()
+{
+   ralloc_free(mem_ctx);
+}
+
+/**
+ * Sets up the variables of the virtual GRFs allocated since the last update.
+ *
+ * New virtual GRFs are allocated at the end, so the variables of the previous
+ * ones, and the def/use information of the blocks referring to them, stay
+ * the same.
+ */
+bool
+fs_live_variables::setup_vars()
+{
+   const int new_num_vgrfs = v->alloc.count;
+
+   if (new_num_vgrfs < num_vgrfs)
+      return false;
+
    for (int i = 0; i < num_vgrfs; i++) {
-      var_from_vgrf[i] = num_vars;
-      num_vars += v->alloc.sizes[i];
+      const int size = (i + 1 < num_vgrfs ? var_from_vgrf[i + 1] : num_vars) -
+                       var_from_vgrf[i];
+      if (v->alloc.sizes[i] != (unsigned)size)
+         return false;
    }
 
-   vgrf_from_var = rzalloc_array(mem_ctx, int, num_vars);
-   for (int i = 0; i < num_vgrfs; i++) {
+   if (new_num_vgrfs == num_vgrfs && bitsets)
+      return true;
+
+   int new_num_vars = num_vars;
+   var_from_vgrf = reralloc(mem_ctx, var_from_vgrf, int, new_num_vgrfs);
+   for (int i = num_vgrfs; i < new_num_vgrfs; i++) {
+      var_from_vgrf[i] = new_num_vars;
+      new_num_vars += v->alloc.sizes[i];
+   }
+
+   vgrf_from_var = reralloc(mem_ctx, vgrf_from_var, int, new_num_vars);
+   for (int i = num_vgrfs; i < new_num_vgrfs; i++) {
       for (unsigned j = 0; j < v->alloc.sizes[i]; j++) {
          vgrf_from_var[var_from_vgrf[i] + j] = i;
       }
    }
 
-   start = ralloc_array(mem_ctx, int, num_vars);
-   end = rzalloc_array(mem_ctx, int, num_vars);
-   for (int i = 0; i < num_vars; i++) {
-      start[i] = MAX_INSTRUCTION;
-      end[i] = -1;
-   }
+   start = reralloc(mem_ctx, start, int, new_num_vars);
+   end = reralloc(mem_ctx, end, int, new_num_vars);
 
-   block_data= rzalloc_array(mem_ctx, struct block_data, cfg->num_blocks);
+   block_ranges = reralloc(mem_ctx, block_ranges, struct var_range,
+                           new_num_vars);
+   range_from_var = reralloc(mem_ctx, range_from_var, int, new_num_vars);
+   for (int i = num_vars; i < new_num_vars; i++)
+      range_from_var[i] = -1;
 
-   bitset_words = BITSET_WORDS(num_vars);
-   for (int i = 0; i < cfg->num_blocks; i++) {
-      block_data[i].def = rzalloc_array(mem_ctx, BITSET_WORD, bitset_words);
-      block_data[i].use = rzalloc_array(mem_ctx, BITSET_WORD, bitset_words);
-      block_data[i].livein = rzalloc_array(mem_ctx, BITSET_WORD, bitset_words);
-      block_data[i].liveout = rzalloc_array(mem_ctx, BITSET_WORD, bitset_words);
-      block_data[i].defin = rzalloc_array(mem_ctx, BITSET_WORD, bitset_words);
-      block_data[i].defout = rzalloc_array(mem_ctx, BITSET_WORD, bitset_words);
-
-      block_data[i].flag_def[0] = 0;
-      block_data[i].flag_use[0] = 0;
-      block_data[i].flag_livein[0] = 0;
-      block_data[i].flag_liveout[0] = 0;
+   /* The bitsets of all the blocks are carved out of a single allocation.
+    * Only def and use need to be kept, the others are computed again by
+    * every update.
+    */
+   const int new_bitset_words = BITSET_WORDS(new_num_vars);
+   if (!bitsets || new_bitset_words != bitset_words) {
+      BITSET_WORD *new_bitsets =
+         rzalloc_array(mem_ctx, BITSET_WORD,
+                       6 * new_bitset_words * num_blocks);
+
+      for (int i = 0; i < num_blocks; i++) {
+         struct block_data *bd = &block_data[i];
+         BITSET_WORD *b = new_bitsets + 6 * new_bitset_words * i;
+
+         if (bitsets) {
+            memcpy(b, bd->def, bitset_words * sizeof(BITSET_WORD));
+            memcpy(b + new_bitset_words, bd->use,
+                   bitset_words * sizeof(BITSET_WORD));
+         }
+
+         bd->def = b;
+         bd->use = b + new_bitset_words;
+         bd->livein = b + 2 * new_bitset_words;
+         bd->liveout = b + 3 * new_bitset_words;
+         bd->defin = b + 4 * new_bitset_words;
+         bd->defout = b + 5 * new_bitset_words;
+      }
+
+      ralloc_free(bitsets);
+      bitsets = new_bitsets;
+      bitset_words = new_bitset_words;
    }
 
+   num_vgrfs = new_num_vgrfs;
+   num_vars = new_num_vars;
+
+   return true;
+}
+
+void
+fs_live_variables::invalidate_block(const bblock_t *block)
+{
+   assert(block->num < num_blocks);
+   BITSET_SET(dirty_blocks, block->num);
+   dirty = true;
+}
+
+bool
+fs_live_variables::update()
+{
+   /* Blocks got added or removed. */
+   if (v->cfg != cfg || cfg->num_blocks != num_blocks)
+      return false;
+
+   if (!setup_vars())
+      return false;
+
    setup_def_use();
    compute_live_variables();
    compute_start_end();
-}
 
-fs_live_variables::~fs_live_variables()
-{
-   ralloc_free(mem_ctx);
+   memset(dirty_blocks, 0, BITSET_WORDS(num_blocks) * sizeof(BITSET_WORD));
+   dirty = false;
+
+   return true;
 }
 
 void
@@ -310,6 +512,18 @@ fs_visitor::invalidate_live_intervals()
    live_intervals = NULL;
 }
 
+/**
+ * Invalidates the live intervals after a pass only modified the instructions
+ * of \p block, so that the next calculate_live_intervals() call only has to
+ * walk the instructions of the modified blocks.
+ */
+void
+fs_visitor::invalidate_live_intervals(const bblock_t *block)
+{
+   if (live_intervals)
+      live_intervals->invalidate_block(block);
+}
+
 /**
  * Compute the live intervals for each virtual GRF.
  *
@@ -319,8 +533,13 @@ fs_visitor::invalidate_live_intervals()
 void
 fs_visitor::calculate_live_intervals()
 {
-   if (this->live_intervals)
-      return;
+   if (this->live_intervals) {
+      if (!this->live_intervals->is_dirty())
+         return;
+
+      if (!this->live_intervals->update())
+         invalidate_live_intervals();
+   }
 
    int num_vgrfs = this->alloc.count;
    ralloc_free(this->virtual_grf_start);
@@ -333,7 +552,8 @@ fs_visitor::calculate_live_intervals()
       virtual_grf_end[i] = -1;
    }
 
-   this->live_intervals = new(mem_ctx) fs_live_variables(this, cfg);
+   if (!this->live_intervals)
+      this->live_intervals = new(mem_ctx) fs_live_variables(this, cfg);
 
    /* Merge the per-component live ranges to whole VGRF live ranges. */
    for (int i = 0; i < live_intervals->num_vars; i++) {
@@ -35,6 +35,20 @@ struct cfg_t;
 
 namespace brw {
 
+/**
+ * Range of IPs where a block accesses a variable, relative to the start of
+ * the block, so that it stays valid when instructions get added to or removed
+ * from other blocks.
+ */
+struct var_range {
+   int var;
+   int start;
+   int end;
+
+   /** Whether any of the accesses is a write. */
+   bool written;
+};
+
 struct block_data {
    /**
     * Which variables are defined before being used in the block.
@@ -71,6 +85,10 @@ struct block_data {
    BITSET_WORD flag_use[1];
    BITSET_WORD flag_livein[1];
    BITSET_WORD flag_liveout[1];
+
+   /** Variables accessed by the block, in order of first access. */
+   struct var_range *ranges;
+   int num_ranges;
 };
 
 class fs_live_variables {
@@ -81,6 +99,30 @@ public:
    ~fs_live_variables();
 
    bool vars_interfere(int a, int b);
+
+   /**
+    * Marks \p block as modified since the last update.
+    *
+    * Only the instructions of the block may have changed, the CFG and the
+    * variables of the existing virtual GRFs must be the same.
+    */
+   void invalidate_block(const bblock_t *block);
+
+   /** Whether some blocks were modified since the last update. */
+   bool is_dirty() const
+   {
+      return dirty;
+   }
+
+   /**
+    * Recomputes the live intervals, only walking the instructions of the
+    * blocks marked by invalidate_block().
+    *
+    * Returns false if the CFG or the existing virtual GRFs changed, in which
+    * case the live intervals have to be computed from scratch.
+    */
+   bool update();
+
    int var_from_reg(const fs_reg &reg) const
    {
       return var_from_vgrf[reg.nr] + reg.offset / REG_SIZE;
@@ -113,7 +155,9 @@ public:
    struct block_data *block_data;
 
 protected:
+   bool setup_vars();
    void setup_def_use();
+   void setup_one_access(int var, int ip, bool written);
    void setup_one_read(struct block_data *bd, fs_inst *inst, int ip,
                        const fs_reg &reg);
    void setup_one_write(struct block_data *bd, fs_inst *inst, int ip,
@@ -123,8 +167,28 @@ protected:
 
    fs_visitor *v;
    const cfg_t *cfg;
+   int num_blocks;
    void *mem_ctx;
 
+   /** Storage for the bitsets of all the blocks. */
+   BITSET_WORD *bitsets;
+
+   /** @{
+    * Blocks whose def/use information has to be set up again.
+    */
+   BITSET_WORD *dirty_blocks;
+   bool dirty;
+   /** @} */
+
+   /** @{
+    * Ranges of the block being set up, and index of each variable in them,
+    * or -1.
+    */
+   struct var_range *block_ranges;
+   int num_block_ranges;
+   int *range_from_var;
+   /** @} */
+
 };
 
 } /* namespace brw */
@@ -32,6 +32,8 @@ using namespace brw::surface_access;
 void
 fs_visitor::emit_nir_code()
 {
+   uint64_t start = brw_pass_start(compiler);
+
    /* emit the arrays used for inputs and outputs - load/store intrinsics will
     * be converted to reads/writes of these arrays
     */
@@ -45,6 +47,8 @@ fs_visitor::emit_nir_code()
       assert(function->impl);
       nir_emit_impl(function->impl);
    }
+
+   brw_pass_end(compiler, stage, dispatch_width, "emit_nir_code", start);
 }
 
 void
@@ -978,6 +978,7 @@ fs_visitor::spill_reg(int spill_reg)
              */
             emit_unspill(ibld.exec_all().group(width, 0),
                          unspill_dst, subset_spill_offset, count);
+            invalidate_live_intervals(block);
 	 }
       }
 
@@ -1035,8 +1036,7 @@ fs_visitor::spill_reg(int spill_reg)
 
          emit_spill(ubld.at(block, inst->next), spill_src,
                     subset_spill_offset, regs_written(inst));
+         invalidate_live_intervals(block);
       }
    }
-
-   invalidate_live_intervals();
 }
@@ -252,12 +252,13 @@ fs_visitor::register_coalesce()
          }
       }
 
-      foreach_block_and_inst(block, fs_inst, scan_inst, cfg) {
+      foreach_block_and_inst(scan_block, fs_inst, scan_inst, cfg) {
          if (scan_inst->dst.file == VGRF &&
              scan_inst->dst.nr == src_reg) {
             scan_inst->dst.nr = dst_reg;
             scan_inst->dst.offset = scan_inst->dst.offset % REG_SIZE +
                dst_reg_offset[scan_inst->dst.offset / REG_SIZE] * REG_SIZE;
+            invalidate_live_intervals(scan_block);
          }
 
          for (int j = 0; j < scan_inst->sources; j++) {
@@ -266,6 +267,7 @@ fs_visitor::register_coalesce()
                scan_inst->src[j].nr = dst_reg;
                scan_inst->src[j].offset = scan_inst->src[j].offset % REG_SIZE +
                   dst_reg_offset[scan_inst->src[j].offset / REG_SIZE] * REG_SIZE;
+               invalidate_live_intervals(scan_block);
             }
          }
       }
@@ -285,10 +287,9 @@ fs_visitor::register_coalesce()
       foreach_block_and_inst_safe (block, backend_instruction, inst, cfg) {
          if (inst->opcode == BRW_OPCODE_NOP) {
             inst->remove(block);
+            invalidate_live_intervals(block);
          }
       }
-
-      invalidate_live_intervals();
    }
 
    return progress;
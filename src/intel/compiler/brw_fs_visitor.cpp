@@ -900,6 +900,8 @@ fs_visitor::init()
    this->last_scratch = 0;
    this->pull_constant_loc = NULL;
    this->push_constant_loc = NULL;
+   this->uniforms_assigned = NULL;
+   this->uniforms_assigned_data = NULL;
 
    this->promoted_constants = 0,
 
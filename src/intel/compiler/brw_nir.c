@@ -509,7 +509,10 @@ brw_nir_lower_fs_outputs(nir_shader *nir)
 
 #define OPT(pass, ...) ({                                  \
    bool this_progress = false;                             \
+   uint64_t pass_start = brw_pass_start(compiler);         \
    NIR_PASS(this_progress, nir, pass, ##__VA_ARGS__);      \
+   brw_pass_end(compiler, nir->info.stage, 0, #pass,       \
+                pass_start);                               \
    if (this_progress)                                      \
       progress = true;                                     \
    this_progress;                                          \
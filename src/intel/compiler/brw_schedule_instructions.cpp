@@ -81,6 +81,25 @@ public:
     */
    unsigned cand_generation;
 
+   /**
+    * Order in which this node became a candidate.  The list of candidates is
+    * kept sorted by decreasing cand_order.
+    */
+   unsigned cand_order;
+
+   /**
+    * The exit_unblocked_time() and unblocked_time this node was last sorted
+    * with in instruction_scheduler::ready_heap.
+    */
+   int heap_exit_time;
+   int heap_unblocked_time;
+
+   /**
+    * Scratch slot of this node among the children of the node that
+    * remove_duplicate_deps() is processing.
+    */
+   int dedup_slot;
+
    /**
     * This is the sum of the instruction's latency plus the maximum delay of
     * its children, or just the issue_time if it's a leaf node.
@@ -114,6 +133,21 @@ exit_unblocked_time(const schedule_node *n)
    return n->exit ? n->exit->unblocked_time : INT_MAX;
 }
 
+/**
+ * Order of the candidates in instruction_scheduler::ready_heap: the one most
+ * likely to unblock an early program exit first, then the one closest to
+ * being ready, then the first one in the list of candidates.
+ */
+static inline bool
+heap_before(const schedule_node *a, const schedule_node *b)
+{
+   if (a->heap_exit_time != b->heap_exit_time)
+      return a->heap_exit_time < b->heap_exit_time;
+   if (a->heap_unblocked_time != b->heap_unblocked_time)
+      return a->heap_unblocked_time < b->heap_unblocked_time;
+   return a->cand_order > b->cand_order;
+}
+
 void
 schedule_node::set_latency_gen4()
 {
@@ -441,6 +475,9 @@ public:
       this->instructions_to_schedule = 0;
       this->post_reg_alloc = (mode == SCHEDULE_POST);
       this->mode = mode;
+      this->use_ready_heap = (mode == SCHEDULE_PRE || mode == SCHEDULE_POST);
+      this->ready_heap = NULL;
+      this->ready_count = 0;
       if (!post_reg_alloc) {
          this->reg_pressure_in = rzalloc_array(mem_ctx, int, block_count);
 
@@ -485,10 +522,14 @@ public:
 
    void run(cfg_t *cfg);
    void add_insts_from_block(bblock_t *block);
+   void remove_duplicate_deps();
    void compute_delays();
    void compute_exits();
    virtual void calculate_deps() = 0;
-   virtual schedule_node *choose_instruction_to_schedule() = 0;
+   virtual schedule_node *choose_instruction_to_schedule();
+
+   void add_candidate(schedule_node *n, unsigned *cand_order);
+   void sift_down(int i);
 
    /**
     * Returns how many cycles it takes the instruction to issue.
@@ -519,6 +560,19 @@ public:
 
    instruction_scheduler_mode mode;
 
+   /*
+    * Whether the candidates are chosen by their latency alone, from
+    * ready_heap, rather than by a scan of the list of candidates.
+    */
+   bool use_ready_heap;
+
+   /*
+    * Binary min-heap of the candidates ordered by heap_before(), with
+    * ready_count entries.
+    */
+   schedule_node **ready_heap;
+   int ready_count;
+
    /*
     * The register pressure at the beginning of each basic block.
     */
@@ -746,7 +800,6 @@ class vec4_instruction_scheduler : public instruction_scheduler
 public:
    vec4_instruction_scheduler(vec4_visitor *v, int grf_count);
    void calculate_deps();
-   schedule_node *choose_instruction_to_schedule();
    int issue_time(backend_instruction *inst);
    vec4_visitor *v;
 
@@ -797,6 +850,10 @@ schedule_node::schedule_node(backend_instruction *inst,
    this->parent_count = 0;
    this->unblocked_time = 0;
    this->cand_generation = 0;
+   this->cand_order = 0;
+   this->heap_exit_time = 0;
+   this->heap_unblocked_time = 0;
+   this->dedup_slot = 0;
    this->delay = 0;
    this->exit = NULL;
 
@@ -821,6 +878,42 @@ instruction_scheduler::add_insts_from_block(bblock_t *block)
    }
 
    this->instructions_to_schedule = block->end_ip - block->start_ip + 1;
+
+   if (use_ready_heap) {
+      ready_heap = ralloc_array(mem_ctx, schedule_node *,
+                                instructions_to_schedule);
+      ready_count = 0;
+   }
+}
+
+/**
+ * Merge the edges add_dep() added more than once into the first one, with
+ * the largest of their latencies.
+ */
+void
+instruction_scheduler::remove_duplicate_deps()
+{
+   foreach_in_list(schedule_node, n, &instructions) {
+      int count = 0;
+
+      for (int i = 0; i < n->child_count; i++) {
+         schedule_node *child = n->children[i];
+         const int slot = child->dedup_slot;
+
+         if (slot < count && n->children[slot] == child) {
+            n->child_latency[slot] = MAX2(n->child_latency[slot],
+                                          n->child_latency[i]);
+            child->parent_count--;
+         } else {
+            child->dedup_slot = count;
+            n->children[count] = child;
+            n->child_latency[count] = n->child_latency[i];
+            count++;
+         }
+      }
+
+      n->child_count = count;
+   }
 }
 
 /** Computation of the delay member of each node. */
@@ -884,13 +977,9 @@ instruction_scheduler::add_dep(schedule_node *before, schedule_node *after,
 
    assert(before != after);
 
-   for (int i = 0; i < before->child_count; i++) {
-      if (before->children[i] == after) {
-         before->child_latency[i] = MAX2(before->child_latency[i], latency);
-         return;
-      }
-   }
-
+   /* Edges added more than once are merged by remove_duplicate_deps(), as
+    * looking for them here would be quadratic in the number of children.
+    */
    if (before->child_array_size <= before->child_count) {
       if (before->child_array_size < 16)
          before->child_array_size = 16;
@@ -1408,21 +1497,7 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
    schedule_node *chosen = NULL;
 
    if (mode == SCHEDULE_PRE || mode == SCHEDULE_POST) {
-      int chosen_time = 0;
-
-      /* Of the instructions ready to execute or the closest to being ready,
-       * choose the one most likely to unblock an early program exit, or
-       * otherwise the oldest one.
-       */
-      foreach_in_list(schedule_node, n, &instructions) {
-         if (!chosen ||
-             exit_unblocked_time(n) < exit_unblocked_time(chosen) ||
-             (exit_unblocked_time(n) == exit_unblocked_time(chosen) &&
-              n->unblocked_time < chosen_time)) {
-            chosen = n;
-            chosen_time = n->unblocked_time;
-         }
-      }
+      chosen = instruction_scheduler::choose_instruction_to_schedule();
    } else {
       /* Before register allocation, we don't care about the latencies of
        * instructions.  All we care about is reducing live intervals of
@@ -1525,22 +1600,84 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
    return chosen;
 }
 
+void
+instruction_scheduler::sift_down(int i)
+{
+   schedule_node *n = ready_heap[i];
+
+   for (;;) {
+      int child = 2 * i + 1;
+
+      if (child >= ready_count)
+         break;
+      if (child + 1 < ready_count &&
+          heap_before(ready_heap[child + 1], ready_heap[child]))
+         child++;
+      if (!heap_before(ready_heap[child], n))
+         break;
+
+      ready_heap[i] = ready_heap[child];
+      i = child;
+   }
+
+   ready_heap[i] = n;
+}
+
+/**
+ * Number a node that was just added to the head of the list of candidates,
+ * and add it to ready_heap.
+ */
+void
+instruction_scheduler::add_candidate(schedule_node *n, unsigned *cand_order)
+{
+   n->cand_order = (*cand_order)++;
+
+   if (!use_ready_heap)
+      return;
+
+   n->heap_exit_time = exit_unblocked_time(n);
+   n->heap_unblocked_time = n->unblocked_time;
+
+   int i = ready_count++;
+   while (i > 0 && heap_before(n, ready_heap[(i - 1) / 2])) {
+      ready_heap[i] = ready_heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+   }
+   ready_heap[i] = n;
+}
+
+/**
+ * Of the instructions ready to execute or the closest to being ready, choose
+ * the one most likely to unblock an early program exit, or otherwise the
+ * oldest one, and remove it from ready_heap.
+ */
 schedule_node *
-vec4_instruction_scheduler::choose_instruction_to_schedule()
+instruction_scheduler::choose_instruction_to_schedule()
 {
-   schedule_node *chosen = NULL;
-   int chosen_time = 0;
+   assert(use_ready_heap && ready_count > 0);
 
-   /* Of the instructions ready to execute or the closest to being ready,
-    * choose the oldest one.
+   /* The unblocked times of the candidates and of their exits only grow
+    * after they were sorted, so the top of the heap is the right choice as
+    * soon as its own times are up to date.
     */
-   foreach_in_list(schedule_node, n, &instructions) {
-      if (!chosen || n->unblocked_time < chosen_time) {
-         chosen = n;
-         chosen_time = n->unblocked_time;
-      }
+   for (;;) {
+      schedule_node *n = ready_heap[0];
+
+      if (n->heap_exit_time == exit_unblocked_time(n) &&
+          n->heap_unblocked_time == n->unblocked_time)
+         break;
+
+      n->heap_exit_time = exit_unblocked_time(n);
+      n->heap_unblocked_time = n->unblocked_time;
+      sift_down(0);
    }
 
+   schedule_node *chosen = ready_heap[0];
+
+   ready_heap[0] = ready_heap[--ready_count];
+   if (ready_count > 0)
+      sift_down(0);
+
    return chosen;
 }
 
@@ -1576,6 +1713,13 @@ instruction_scheduler::schedule_instructions(bblock_t *block)
          n->remove();
    }
 
+   /* The heads are in program order, the first one being preferred among
+    * equal candidates like the ones pushed on the head of the list later.
+    */
+   unsigned cand_order = 0;
+   foreach_in_list_reverse(schedule_node, n, &instructions)
+      add_candidate(n, &cand_order);
+
    unsigned cand_generation = 1;
    while (!instructions.is_empty()) {
       schedule_node *chosen = choose_instruction_to_schedule();
@@ -1635,6 +1779,7 @@ instruction_scheduler::schedule_instructions(bblock_t *block)
                fprintf(stderr, "\t\tnow available\n");
             }
             instructions.push_head(child);
+            add_candidate(child, &cand_order);
          }
       }
       cand_generation++;
@@ -1701,6 +1846,7 @@ instruction_scheduler::run(cfg_t *cfg)
       add_insts_from_block(block);
 
       calculate_deps();
+      remove_duplicate_deps();
 
       compute_delays();
       compute_exits();
@@ -1720,6 +1866,8 @@ instruction_scheduler::run(cfg_t *cfg)
 void
 fs_visitor::schedule_instructions(instruction_scheduler_mode mode)
 {
+   uint64_t start = brw_pass_start(compiler);
+
    if (mode != SCHEDULE_POST)
       calculate_live_intervals();
 
@@ -1734,13 +1882,20 @@ fs_visitor::schedule_instructions(instruction_scheduler_mode mode)
    sched.run(cfg);
 
    invalidate_live_intervals();
+
+   brw_pass_end(compiler, stage, dispatch_width, "schedule_instructions",
+                start);
 }
 
 void
 vec4_visitor::opt_schedule_instructions()
 {
+   uint64_t start = brw_pass_start(compiler);
+
    vec4_instruction_scheduler sched(this, prog_data->total_grf);
    sched.run(cfg);
 
    invalidate_live_intervals();
+
+   brw_pass_end(compiler, stage, 0, "schedule_instructions", start);
 }
@@ -30,6 +30,7 @@
 #include "brw_eu_defines.h"
 #include "brw_inst.h"
 #include "compiler/nir/nir.h"
+#include "util/os_time.h"
 
 #ifdef __cplusplus
 #include "brw_ir_allocator.h"
@@ -268,6 +269,25 @@ void brw_vec4_alloc_reg_set(struct brw_compiler *compiler);
 extern const char *const conditional_modifier[16];
 extern const char *const pred_ctrl_align16[16];
 
+/**
+ * Start and end timing a pass for brw_compiler::pass_time.
+ */
+static inline uint64_t
+brw_pass_start(const struct brw_compiler *compiler)
+{
+   return unlikely(compiler->pass_time) ? os_time_get_nano() : 0;
+}
+
+static inline void
+brw_pass_end(const struct brw_compiler *compiler, gl_shader_stage stage,
+             unsigned dispatch_width, const char *pass, uint64_t start)
+{
+   if (unlikely(compiler->pass_time)) {
+      compiler->pass_time(compiler->pass_time_data, stage, dispatch_width,
+                          pass, os_time_get_nano() - start);
+   }
+}
+
 /* Per-thread scratch space is a power-of-two multiple of 1KB. */
 static inline int
 brw_get_scratch_size(int size)
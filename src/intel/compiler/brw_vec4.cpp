@@ -2659,7 +2659,9 @@ vec4_visitor::run()
 
 #define OPT(pass, args...) ({                                          \
       pass_num++;                                                      \
+      uint64_t pass_start = brw_pass_start(compiler);                  \
       bool this_progress = pass(args);                                 \
+      brw_pass_end(compiler, stage, 0, #pass, pass_start);             \
                                                                        \
       if (unlikely(INTEL_DEBUG & DEBUG_OPTIMIZER) && this_progress) {  \
          char filename[64];                                            \
@@ -2758,7 +2760,9 @@ vec4_visitor::run()
 
    fixup_3src_null_dest();
 
+   uint64_t start = brw_pass_start(compiler);
    bool allocated_without_spills = reg_allocate();
+   brw_pass_end(compiler, stage, 0, "reg_allocate", start);
 
    if (!allocated_without_spills) {
       compiler->shader_perf_log(log_data,
@@ -2767,10 +2771,12 @@ vec4_visitor::run()
                                 "to improve performance.\n",
                                 stage_name);
 
+      start = brw_pass_start(compiler);
       while (!reg_allocate()) {
          if (failed)
             return false;
       }
+      brw_pass_end(compiler, stage, 0, "reg_allocate", start);
 
       /* We want to run this after spilling because 64-bit (un)spills need to
        * emit code to shuffle 64-bit data for the 32-bit scratch read/write
@@ -1504,6 +1504,7 @@ generate_code(struct brw_codegen *p,
    const char *stage_abbrev = _mesa_shader_stage_to_abbrev(nir->info.stage);
    bool debug_flag = INTEL_DEBUG &
       intel_debug_flag_for_shader_stage(nir->info.stage);
+   uint64_t pass_start = brw_pass_start(compiler);
    struct disasm_info *disasm_info = disasm_initialize(devinfo, cfg);
    int spill_count = 0, fill_count = 0;
    int loop_count = 0;
@@ -2191,8 +2192,13 @@ generate_code(struct brw_codegen *p,
                                 0, p->next_insn_offset,
                                 disasm_info);
 
+   brw_pass_end(compiler, nir->info.stage, 0, "generate_code", pass_start);
+
    int before_size = p->next_insn_offset;
+   pass_start = brw_pass_start(compiler);
    brw_compact_instructions(p, 0, disasm_info);
+   brw_pass_end(compiler, nir->info.stage, 0, "brw_compact_instructions",
+                pass_start);
    int after_size = p->next_insn_offset;
 
    if (unlikely(debug_flag)) {
@@ -34,6 +34,8 @@ namespace brw {
 void
 vec4_visitor::emit_nir_code()
 {
+   uint64_t start = brw_pass_start(compiler);
+
    if (nir->num_uniforms > 0)
       nir_setup_uniforms();
 
@@ -43,6 +45,8 @@ vec4_visitor::emit_nir_code()
       assert(function->impl);
       nir_emit_impl(function->impl);
    }
+
+   brw_pass_end(compiler, stage, 0, "emit_nir_code", start);
 }
 
 void
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include "util/os_time.h"
 #include "util/ralloc.h"
 #include "brw_eu.h"
 
@@ -316,14 +317,87 @@ run_tests(const struct gen_device_info *devinfo)
    return fail;
 }
 
+/* A mix of ALU and control flow instructions, most of which compact. */
+static void
+gen_bench_program(struct brw_codegen *p)
+{
+   for (unsigned i = 0; i < 400; i++) {
+      struct brw_reg dst = brw_vec8_grf(2 + i % 32, 0);
+      struct brw_reg a = brw_vec8_grf(34 + i % 16, 0);
+      struct brw_reg b = brw_vec8_grf(50 + i % 8, 0);
+
+      brw_MOV(p, dst, a);
+      brw_ADD(p, dst, a, b);
+      brw_MUL(p, dst, a, brw_vec1_grf(60, i % 8));
+      brw_ADD(p, dst, a, brw_imm_f(1.0f + i));
+      brw_ADD(p, retype(dst, BRW_REGISTER_TYPE_D),
+              retype(a, BRW_REGISTER_TYPE_D), brw_imm_d(i % 16));
+      brw_CMP(p, retype(brw_null_reg(), BRW_REGISTER_TYPE_F),
+              BRW_CONDITIONAL_L, a, b);
+
+      brw_IF(p, BRW_EXECUTE_8);
+      brw_MOV(p, dst, b);
+      brw_ELSE(p);
+      brw_ADD(p, dst, dst, a);
+      brw_ENDIF(p);
+   }
+
+   /* Real programs don't end on a jump target. */
+   brw_NOP(p);
+}
+
+/* Prints how long brw_compact_instructions() takes on the program above.
+ * Only run when TEST_BENCH is set, so that the test itself stays quiet.
+ */
+static void
+run_benchmark(const struct gen_device_info *devinfo)
+{
+   brw_init_compaction_tables(devinfo);
+
+   struct brw_codegen *p = rzalloc(NULL, struct brw_codegen);
+   brw_init_codegen(devinfo, p, p);
+   gen_bench_program(p);
+   brw_set_uip_jip(p, 0);
+
+   const int size = p->next_insn_offset;
+   const int nr_insn = p->nr_insn;
+   brw_inst *program = ralloc_array(p, brw_inst, nr_insn);
+   memcpy(program, p->store, size);
+
+   int64_t best = INT64_MAX;
+   int compacted_size = 0;
+   for (unsigned i = 0; i < 20; i++) {
+      memcpy(p->store, program, size);
+      p->next_insn_offset = size;
+      p->nr_insn = nr_insn;
+
+      int64_t start = os_time_get_nano();
+      brw_compact_instructions(p, 0, NULL);
+      int64_t time = os_time_get_nano() - start;
+
+      if (time < best)
+         best = time;
+      compacted_size = p->next_insn_offset;
+   }
+
+   printf("gen%d: %d instructions compacted to %d%% in %.1f ns/instruction\n",
+          devinfo->gen, nr_insn, compacted_size * 100 / size,
+          (double)best / nr_insn);
+
+   ralloc_free(p);
+}
+
 int
 main(int argc, char **argv)
 {
    struct gen_device_info *devinfo = (struct gen_device_info *)calloc(1, sizeof(*devinfo));
+   const bool bench = getenv("TEST_BENCH");
    bool fail = false;
 
    for (devinfo->gen = 5; devinfo->gen <= 9; devinfo->gen++) {
       fail |= run_tests(devinfo);
+      if (bench)
+         run_benchmark(devinfo);
    }
 
    return fail;
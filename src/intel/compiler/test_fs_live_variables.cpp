@@ -0,0 +1,335 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the live intervals updated after some blocks got invalidated
+ * match the ones computed from scratch.
+ */
+
+#include <gtest/gtest.h>
+#include "brw_fs.h"
+#include "brw_fs_live_variables.h"
+#include "brw_cfg.h"
+#include "program/program.h"
+
+using namespace brw;
+
+class live_variables_test : public ::testing::Test {
+   virtual void SetUp();
+
+public:
+   struct brw_compiler *compiler;
+   struct gen_device_info *devinfo;
+   struct brw_wm_prog_data *prog_data;
+   fs_visitor *v;
+
+   fs_reg a, b, c, d, e, f, vec;
+   bblock_t *then_block, *else_block, *loop_block;
+
+   void emit_program();
+};
+
+class live_variables_fs_visitor : public fs_visitor
+{
+public:
+   live_variables_fs_visitor(struct brw_compiler *compiler,
+                             struct brw_wm_prog_data *prog_data,
+                             nir_shader *shader)
+      : fs_visitor(compiler, NULL, NULL, NULL,
+                   &prog_data->base, (struct gl_program *) NULL,
+                   shader, 8, -1) {}
+};
+
+
+void live_variables_test::SetUp()
+{
+   compiler = (struct brw_compiler *)calloc(1, sizeof(*compiler));
+   devinfo = (struct gen_device_info *)calloc(1, sizeof(*devinfo));
+   compiler->devinfo = devinfo;
+
+   prog_data = ralloc(NULL, struct brw_wm_prog_data);
+   nir_shader *shader =
+      nir_shader_create(NULL, MESA_SHADER_FRAGMENT, NULL, NULL);
+
+   v = new live_variables_fs_visitor(compiler, prog_data, shader);
+
+   devinfo->gen = 4;
+}
+
+/* = Program =
+ *
+ * block0:
+ *  0: mov(8)        a  1.0f
+ *  1: mov(8)        b  2.0f
+ *  2: add(8)        c  a  b
+ *  3: mov(8)        vec+1  c
+ *  4: cmp.l.f0(8)   null  a  b
+ *  5: (+f0) if(8)
+ * block1:
+ *  6: mul(8)        d  c  a
+ *  7: else(8)
+ * block2:
+ *  8: mov(8)        d  b
+ * block3:
+ *  9: endif(8)
+ * block4:
+ * 10: do(8)
+ * block5:
+ * 11: add(8)        e  d  vec+1
+ * 12: mul(8)        d  e  c
+ * 13: cmp.l.f0(8)   null  e  a
+ * 14: (+f0) while(8)
+ * block6:
+ * 15: add(8)        f  e  d
+ * 16: mov(8)        m1  f
+ */
+void live_variables_test::emit_program()
+{
+   const fs_builder &bld = v->bld;
+
+   a = v->vgrf(glsl_type::float_type);
+   b = v->vgrf(glsl_type::float_type);
+   c = v->vgrf(glsl_type::float_type);
+   d = v->vgrf(glsl_type::float_type);
+   e = v->vgrf(glsl_type::float_type);
+   f = v->vgrf(glsl_type::float_type);
+   vec = v->vgrf(glsl_type::vec4_type);
+
+   bld.MOV(a, brw_imm_f(1.0f));
+   bld.MOV(b, brw_imm_f(2.0f));
+   bld.ADD(c, a, b);
+   bld.MOV(offset(vec, bld, 1), c);
+   bld.CMP(bld.null_reg_f(), a, b, BRW_CONDITIONAL_L);
+   bld.IF(BRW_PREDICATE_NORMAL);
+   bld.MUL(d, c, a);
+   bld.emit(BRW_OPCODE_ELSE);
+   bld.MOV(d, b);
+   bld.emit(BRW_OPCODE_ENDIF);
+   bld.emit(BRW_OPCODE_DO);
+   bld.ADD(e, d, offset(vec, bld, 1));
+   bld.MUL(d, e, c);
+   bld.CMP(bld.null_reg_f(), e, a, BRW_CONDITIONAL_L);
+   set_predicate(BRW_PREDICATE_NORMAL, bld.emit(BRW_OPCODE_WHILE));
+   bld.ADD(f, e, d);
+   bld.MOV(fs_reg(MRF, 1, BRW_REGISTER_TYPE_F), f);
+
+   v->calculate_cfg();
+
+   ASSERT_EQ(7, v->cfg->num_blocks);
+   then_block = v->cfg->blocks[1];
+   else_block = v->cfg->blocks[2];
+   loop_block = v->cfg->blocks[5];
+}
+
+static fs_inst *
+instruction(bblock_t *block, int num)
+{
+   fs_inst *inst = (fs_inst *)block->start();
+   for (int i = 0; i < num; i++) {
+      inst = (fs_inst *)inst->next;
+   }
+   return inst;
+}
+
+static void
+expect_bitsets_eq(const BITSET_WORD *expected, const BITSET_WORD *actual,
+                  int words, const char *name, int block)
+{
+   for (int i = 0; i < words; i++) {
+      EXPECT_EQ(expected[i], actual[i])
+         << name << " of block " << block << ", word " << i;
+   }
+}
+
+/**
+ * Compares the live intervals of \p v, after calculate_live_intervals(), to
+ * the ones computed from scratch.
+ */
+static void
+check_live_intervals(fs_visitor *v)
+{
+   if (getenv("TEST_DEBUG"))
+      v->cfg->dump(v);
+
+   v->calculate_live_intervals();
+
+   const fs_live_variables *live = v->live_intervals;
+   const fs_live_variables expected(v, v->cfg);
+
+   ASSERT_EQ(expected.num_vgrfs, live->num_vgrfs);
+   ASSERT_EQ(expected.num_vars, live->num_vars);
+   ASSERT_EQ(expected.bitset_words, live->bitset_words);
+
+   for (int i = 0; i < expected.num_vgrfs; i++)
+      EXPECT_EQ(expected.var_from_vgrf[i], live->var_from_vgrf[i]);
+
+   for (int i = 0; i < expected.num_vars; i++) {
+      EXPECT_EQ(expected.vgrf_from_var[i], live->vgrf_from_var[i]);
+      EXPECT_EQ(expected.start[i], live->start[i]) << "var " << i;
+      EXPECT_EQ(expected.end[i], live->end[i]) << "var " << i;
+   }
+
+   for (int i = 0; i < v->cfg->num_blocks; i++) {
+      const struct block_data *ebd = &expected.block_data[i];
+      const struct block_data *bd = &live->block_data[i];
+      const int words = expected.bitset_words;
+
+      expect_bitsets_eq(ebd->def, bd->def, words, "def", i);
+      expect_bitsets_eq(ebd->use, bd->use, words, "use", i);
+      expect_bitsets_eq(ebd->livein, bd->livein, words, "livein", i);
+      expect_bitsets_eq(ebd->liveout, bd->liveout, words, "liveout", i);
+      expect_bitsets_eq(ebd->defin, bd->defin, words, "defin", i);
+      expect_bitsets_eq(ebd->defout, bd->defout, words, "defout", i);
+      EXPECT_EQ(ebd->flag_def[0], bd->flag_def[0]) << "block " << i;
+      EXPECT_EQ(ebd->flag_use[0], bd->flag_use[0]) << "block " << i;
+      EXPECT_EQ(ebd->flag_livein[0], bd->flag_livein[0]) << "block " << i;
+      EXPECT_EQ(ebd->flag_liveout[0], bd->flag_liveout[0]) << "block " << i;
+   }
+
+   for (int i = 0; i < expected.num_vgrfs; i++) {
+      int start = expected.start[expected.var_from_vgrf[i]];
+      int end = expected.end[expected.var_from_vgrf[i]];
+
+      for (int j = 0; j < expected.num_vars; j++) {
+         if (expected.vgrf_from_var[j] == i) {
+            start = MIN2(start, expected.start[j]);
+            end = MAX2(end, expected.end[j]);
+         }
+      }
+
+      EXPECT_EQ(start, v->virtual_grf_start[i]) << "vgrf " << i;
+      EXPECT_EQ(end, v->virtual_grf_end[i]) << "vgrf " << i;
+   }
+}
+
+TEST_F(live_variables_test, unchanged)
+{
+   emit_program();
+   check_live_intervals(v);
+
+   /* Nothing was modified, the live intervals are kept as they are. */
+   const fs_live_variables *live = v->live_intervals;
+   v->calculate_live_intervals();
+   EXPECT_EQ(live, v->live_intervals);
+}
+
+TEST_F(live_variables_test, modified_source)
+{
+   emit_program();
+   check_live_intervals(v);
+   const fs_live_variables *live = v->live_intervals;
+
+   /* b is no longer used after the IF, nor a in the loop. */
+   fs_inst *mov = instruction(else_block, 0);
+   ASSERT_EQ(BRW_OPCODE_MOV, mov->opcode);
+   mov->src[0] = c;
+   v->invalidate_live_intervals(else_block);
+
+   fs_inst *cmp = instruction(loop_block, 2);
+   ASSERT_EQ(BRW_OPCODE_CMP, cmp->opcode);
+   cmp->src[1] = brw_imm_f(4.0f);
+   v->invalidate_live_intervals(loop_block);
+
+   EXPECT_TRUE(v->live_intervals->is_dirty());
+   check_live_intervals(v);
+   EXPECT_EQ(live, v->live_intervals);
+   EXPECT_FALSE(v->live_intervals->is_dirty());
+}
+
+TEST_F(live_variables_test, added_instructions)
+{
+   emit_program();
+   check_live_intervals(v);
+   const fs_live_variables *live = v->live_intervals;
+
+   /* New instructions shift the IPs of the following blocks, and use new
+    * virtual GRFs, one of them large enough to need another bitset word.
+    */
+   const fs_builder ibld = v->bld.at(then_block, instruction(then_block, 0));
+   fs_reg tmp = v->vgrf(glsl_type::float_type);
+   fs_reg big = fs_reg(VGRF, v->alloc.allocate(40), BRW_REGISTER_TYPE_F);
+   ibld.ADD(tmp, a, b);
+   ibld.MOV(offset(big, ibld, 39), tmp);
+   ibld.MUL(c, offset(big, ibld, 39), a);
+   v->invalidate_live_intervals(then_block);
+
+   check_live_intervals(v);
+   EXPECT_EQ(live, v->live_intervals);
+   EXPECT_EQ(18, v->cfg->blocks[6]->start_ip);
+}
+
+TEST_F(live_variables_test, removed_instruction)
+{
+   emit_program();
+   check_live_intervals(v);
+   const fs_live_variables *live = v->live_intervals;
+
+   /* d is only defined in the THEN block now, and the IPs of the following
+    * blocks go down.
+    */
+   instruction(loop_block, 1)->remove(loop_block);
+   v->invalidate_live_intervals(loop_block);
+   check_live_intervals(v);
+   EXPECT_EQ(live, v->live_intervals);
+
+   instruction(else_block, 0)->remove(else_block);
+   v->invalidate_live_intervals(else_block);
+   check_live_intervals(v);
+}
+
+TEST_F(live_variables_test, full_invalidation)
+{
+   emit_program();
+   check_live_intervals(v);
+
+   instruction(v->cfg->blocks[6], 0)->src[1] = a;
+   v->invalidate_live_intervals(v->cfg->blocks[6]);
+   instruction(then_block, 0)->src[1] = b;
+   v->invalidate_live_intervals();
+   EXPECT_EQ(NULL, v->live_intervals);
+
+   check_live_intervals(v);
+}
+
+TEST_F(live_variables_test, passes)
+{
+   emit_program();
+
+   /* Give copy propagation and dead code elimination something to do. */
+   const fs_builder ibld = v->bld.at(loop_block, instruction(loop_block, 0));
+   fs_reg copy = v->vgrf(glsl_type::float_type);
+   ibld.MOV(copy, c);
+   instruction(loop_block, 2)->src[1] = copy;
+   instruction(v->cfg->blocks[6], 0)->dst = v->vgrf(glsl_type::float_type);
+
+   check_live_intervals(v);
+   const fs_live_variables *live = v->live_intervals;
+
+   EXPECT_TRUE(v->opt_copy_propagation());
+   check_live_intervals(v);
+   EXPECT_EQ(live, v->live_intervals);
+
+   EXPECT_TRUE(v->dead_code_eliminate());
+   check_live_intervals(v);
+   EXPECT_EQ(live, v->live_intervals);
+}
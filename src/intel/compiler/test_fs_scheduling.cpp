@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Schedules single blocks of growing size, with thousands of instructions
+ * ready at once like in unrolled loops, checks that the dependencies are
+ * respected and reports the scheduling time per instruction, which should
+ * stay about the same as the blocks grow.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include "brw_fs.h"
+#include "brw_cfg.h"
+#include "program/program.h"
+#include "util/os_time.h"
+
+using namespace brw;
+
+class scheduling_test : public ::testing::Test {
+   virtual void SetUp();
+   virtual void TearDown();
+
+public:
+   struct brw_compiler *compiler;
+   struct gen_device_info *devinfo;
+   struct brw_wm_prog_data *prog_data;
+   nir_shader *shader;
+};
+
+class scheduling_fs_visitor : public fs_visitor
+{
+public:
+   scheduling_fs_visitor(struct brw_compiler *compiler,
+                         struct brw_wm_prog_data *prog_data,
+                         nir_shader *shader)
+      : fs_visitor(compiler, NULL, NULL, NULL,
+                   &prog_data->base, (struct gl_program *) NULL,
+                   shader, 8, -1) {}
+};
+
+
+void scheduling_test::SetUp()
+{
+   compiler = (struct brw_compiler *)calloc(1, sizeof(*compiler));
+   devinfo = (struct gen_device_info *)calloc(1, sizeof(*devinfo));
+   compiler->devinfo = devinfo;
+
+   prog_data = ralloc(NULL, struct brw_wm_prog_data);
+   shader = nir_shader_create(NULL, MESA_SHADER_FRAGMENT, NULL, NULL);
+
+   devinfo->gen = 9;
+}
+
+void scheduling_test::TearDown()
+{
+   ralloc_free(shader);
+   ralloc_free(prog_data);
+   free(devinfo);
+   free(compiler);
+}
+
+/* Emits num_values independent instructions, followed by a chain of
+ * instructions adding them up in the opposite order.
+ */
+static void
+emit_block(fs_visitor *v, unsigned num_values)
+{
+   const fs_builder &bld = v->bld;
+   fs_reg src = v->vgrf(glsl_type::float_type);
+   fs_reg values[num_values];
+
+   for (unsigned i = 0; i < num_values; i++) {
+      values[i] = v->vgrf(glsl_type::float_type);
+      bld.ADD(values[i], src, brw_imm_f(i));
+   }
+
+   fs_reg sum = values[num_values - 1];
+   for (unsigned i = 1; i < num_values; i++) {
+      fs_reg tmp = v->vgrf(glsl_type::float_type);
+      bld.ADD(tmp, sum, values[num_values - 1 - i]);
+      sum = tmp;
+   }
+
+   bld.MOV(retype(brw_vec8_grf(0, 0), BRW_REGISTER_TYPE_F), sum);
+}
+
+/* Checks that every VGRF is read after it is written. */
+static void
+check_block(fs_visitor *v, unsigned num_insts)
+{
+   bool written[v->alloc.count];
+   unsigned count = 0;
+
+   memset(written, 0, sizeof(written));
+   written[0] = true;
+
+   foreach_block_and_inst(block, fs_inst, inst, v->cfg) {
+      for (int i = 0; i < inst->sources; i++) {
+         if (inst->src[i].file == VGRF)
+            EXPECT_TRUE(written[inst->src[i].nr]);
+      }
+
+      if (inst->dst.file == VGRF)
+         written[inst->dst.nr] = true;
+
+      count++;
+   }
+
+   EXPECT_EQ(num_insts, count);
+}
+
+static double
+time_scheduling(scheduling_test *t, unsigned num_values)
+{
+   double best = 0.0;
+
+   /* Keep the best of a few runs to leave out the noise. */
+   for (unsigned i = 0; i < 3; i++) {
+      fs_visitor *v = new scheduling_fs_visitor(t->compiler, t->prog_data,
+                                                t->shader);
+      emit_block(v, num_values);
+      v->calculate_cfg();
+
+      int64_t start = os_time_get_nano();
+      v->schedule_instructions(SCHEDULE_PRE);
+      double time = (os_time_get_nano() - start) / 1e6;
+
+      check_block(v, 2 * num_values);
+      delete v;
+
+      if (i == 0 || time < best)
+         best = time;
+   }
+
+   printf("%6u instructions: %8.2f ms, %6.3f us per instruction\n",
+          2 * num_values, best, best * 1e3 / (2 * num_values));
+
+   return best / (2 * num_values);
+}
+
+TEST_F(scheduling_test, block_size)
+{
+   double small = time_scheduling(this, 500);
+
+   time_scheduling(this, 1000);
+   time_scheduling(this, 2000);
+   time_scheduling(this, 4000);
+
+   double large = time_scheduling(this, 8000);
+
+   /* The blocks grow 16 times.  Choosing each instruction by a scan of all
+    * the candidates took about 5 times longer per instruction here.
+    */
+   EXPECT_LT(large, 3 * small);
+}
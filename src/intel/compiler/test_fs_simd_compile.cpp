@@ -0,0 +1,314 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Compiles the same fragment and compute shaders with the SIMD16 and SIMD32
+ * variants on compiler->simd_queue and one after the other, checks that the
+ * results are identical and reports the compile latency of both.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include "brw_compiler.h"
+#include "brw_nir.h"
+#include "common/gen_debug.h"
+#include "compiler/nir/nir_builder.h"
+#include "util/os_time.h"
+#include "util/u_queue.h"
+
+#define NUM_COMPILES 3
+
+class simd_compile_test : public ::testing::Test {
+   virtual void SetUp();
+   virtual void TearDown();
+
+public:
+   void *mem_ctx;
+   struct gen_device_info devinfo;
+   struct brw_compiler *compiler;
+   struct util_queue queue;
+   unsigned num_perf_msgs;
+};
+
+static void
+count_log(void *data, const char *fmt, ...)
+{
+   if (data)
+      (*(unsigned *) data)++;
+}
+
+void simd_compile_test::SetUp()
+{
+   mem_ctx = ralloc_context(NULL);
+
+   /* Skylake GT2 */
+   ASSERT_TRUE(gen_get_device_info(0x1912, &devinfo));
+   compiler = brw_compiler_create(mem_ctx, &devinfo);
+   compiler->shader_debug_log = count_log;
+   compiler->shader_perf_log = count_log;
+   num_perf_msgs = 0;
+
+   /* Check the compiles on the threads even where the compiler doesn't
+    * start any by default.
+    */
+   if (!compiler->simd_queue) {
+      ASSERT_TRUE(util_queue_init(&queue, "brw_simd", 16, 2, 0));
+      compiler->simd_queue = &queue;
+   }
+}
+
+void simd_compile_test::TearDown()
+{
+   if (compiler->simd_queue == &queue)
+      util_queue_destroy(&queue);
+   ralloc_free(mem_ctx);
+}
+
+/* A long chain of math on a few inputs, with enough values live at once to
+ * put some pressure on the register allocator in SIMD16.
+ */
+static nir_shader *
+build_shader(const struct brw_compiler *compiler, void *mem_ctx,
+             gl_shader_stage stage, unsigned num_values, unsigned num_ops)
+{
+   const nir_shader_compiler_options *options =
+      compiler->glsl_compiler_options[stage].NirOptions;
+   nir_builder b;
+   nir_ssa_def *values[num_values];
+
+   nir_builder_init_simple_shader(&b, mem_ctx, stage, options);
+
+   if (stage == MESA_SHADER_FRAGMENT) {
+      for (unsigned i = 0; i < 4; i++) {
+         nir_variable *in =
+            nir_variable_create(b.shader, nir_var_shader_in,
+                                glsl_vec4_type(), "in");
+         in->data.location = VARYING_SLOT_VAR0 + i;
+         values[i] = nir_load_var(&b, in);
+      }
+   } else {
+      b.shader->info.cs.local_size[0] = 64;
+      b.shader->info.cs.local_size[1] = 1;
+      b.shader->info.cs.local_size[2] = 1;
+      nir_ssa_def *id = nir_u2f32(&b, nir_load_local_invocation_id(&b));
+      for (unsigned i = 0; i < 4; i++)
+         values[i] = nir_vec4(&b, nir_channel(&b, id, 0), nir_imm_float(&b, i),
+                              nir_channel(&b, id, 1), nir_imm_float(&b, 1));
+   }
+
+   for (unsigned i = 4; i < num_values; i++)
+      values[i] = nir_fmul(&b, values[i - 4], values[i % 4]);
+
+   for (unsigned i = 0; i < num_ops; i++) {
+      nir_ssa_def *a = values[i % num_values];
+      nir_ssa_def *c = values[(i * 7 + 3) % num_values];
+
+      switch (i % 4) {
+      case 0: a = nir_ffma(&b, a, c, values[(i + 1) % num_values]); break;
+      case 1: a = nir_fmax(&b, nir_fsin(&b, a), c); break;
+      case 2: a = nir_fadd(&b, nir_frsq(&b, a), c); break;
+      case 3: a = nir_bcsel(&b, nir_flt(&b, a, c), nir_fneg(&b, a), c); break;
+      }
+
+      values[i % num_values] = a;
+   }
+
+   nir_ssa_def *result = values[0];
+   for (unsigned i = 1; i < num_values; i++)
+      result = nir_fadd(&b, result, values[i]);
+
+   if (stage == MESA_SHADER_FRAGMENT) {
+      nir_variable *out =
+         nir_variable_create(b.shader, nir_var_shader_out,
+                             glsl_vec4_type(), "out");
+      out->data.location = FRAG_RESULT_DATA0;
+      nir_store_var(&b, out, result, 0xf);
+   } else {
+      nir_intrinsic_instr *store =
+         nir_intrinsic_instr_create(b.shader, nir_intrinsic_store_ssbo);
+      store->num_components = 4;
+      store->src[0] = nir_src_for_ssa(result);
+      store->src[1] = nir_src_for_ssa(nir_imm_int(&b, 0));
+      store->src[2] = nir_src_for_ssa(
+         nir_imul(&b, nir_channel(&b, nir_load_local_invocation_id(&b), 0),
+                  nir_imm_int(&b, 16)));
+      nir_intrinsic_set_write_mask(store, 0xf);
+      nir_builder_instr_insert(&b, &store->instr);
+      b.shader->info.num_ssbos = 1;
+   }
+
+   nir_shader *nir = brw_preprocess_nir(compiler, b.shader);
+   nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
+   return nir;
+}
+
+struct compile_result {
+   unsigned size;
+   const unsigned *assembly;
+   union {
+      struct brw_wm_prog_data wm;
+      struct brw_cs_prog_data cs;
+   } prog_data;
+};
+
+static void
+compile_shader(simd_compile_test *t, const nir_shader *nir,
+               struct compile_result *result)
+{
+   char *error_str = NULL;
+
+   memset(&result->prog_data, 0, sizeof(result->prog_data));
+
+   if (nir->info.stage == MESA_SHADER_FRAGMENT) {
+      struct brw_wm_prog_key key;
+      memset(&key, 0, sizeof(key));
+      key.nr_color_regions = 1;
+
+      result->assembly =
+         brw_compile_fs(t->compiler, &t->num_perf_msgs, t->mem_ctx, &key,
+                        &result->prog_data.wm, nir, NULL, -1, -1, -1,
+                        true, false, NULL, &error_str);
+      result->size = result->prog_data.wm.base.program_size;
+   } else {
+      struct brw_cs_prog_key key;
+      memset(&key, 0, sizeof(key));
+
+      result->assembly =
+         brw_compile_cs(t->compiler, &t->num_perf_msgs, t->mem_ctx, &key,
+                        &result->prog_data.cs, nir, -1, &error_str);
+      result->size = result->prog_data.cs.base.program_size;
+   }
+
+   ASSERT_TRUE(result->assembly != NULL) << error_str;
+}
+
+static int64_t
+thread_time(struct util_queue *queue)
+{
+   int64_t time = 0;
+
+   for (unsigned i = 0; i < queue->num_threads; i++)
+      time += util_queue_get_thread_time_nano(queue, i);
+
+   return time;
+}
+
+static double
+time_compiles(simd_compile_test *t, const nir_shader *nir, bool parallel,
+              struct compile_result *result)
+{
+   struct util_queue *queue = t->compiler->simd_queue;
+   int64_t time = 0;
+
+   if (!parallel)
+      t->compiler->simd_queue = NULL;
+
+   t->num_perf_msgs = 0;
+   for (unsigned i = 0; i < NUM_COMPILES; i++) {
+      int64_t start = os_time_get_nano();
+      compile_shader(t, nir, result);
+      time += os_time_get_nano() - start;
+   }
+
+   t->compiler->simd_queue = queue;
+
+   return time / 1e6 / NUM_COMPILES;
+}
+
+static void
+check_shader(simd_compile_test *t, const nir_shader *nir, const char *name)
+{
+   struct compile_result serial, parallel;
+
+   double serial_time = time_compiles(t, nir, false, &serial);
+   unsigned serial_perf_msgs = t->num_perf_msgs;
+
+   int64_t start = thread_time(t->compiler->simd_queue);
+   double parallel_time = time_compiles(t, nir, true, &parallel);
+   double offloaded_time =
+      (thread_time(t->compiler->simd_queue) - start) / 1e6 / NUM_COMPILES;
+
+   EXPECT_GT(offloaded_time, 0.0);
+   EXPECT_EQ(serial_perf_msgs, t->num_perf_msgs);
+   EXPECT_EQ(serial.size, parallel.size);
+   EXPECT_EQ(0, memcmp(serial.assembly, parallel.assembly, serial.size));
+
+   /* The arrays of params are allocated by each compile. */
+   EXPECT_EQ(serial.prog_data.wm.base.nr_params,
+             parallel.prog_data.wm.base.nr_params);
+   serial.prog_data.wm.base.param = parallel.prog_data.wm.base.param = NULL;
+   EXPECT_EQ(0, memcmp(&serial.prog_data, &parallel.prog_data,
+                       sizeof(serial.prog_data)));
+
+   printf("%s, %u bytes of assembly, %u of scratch:\n"
+          "  one after the other:  %8.2f ms\n"
+          "  on %u threads:         %8.2f ms, %8.2f ms of it on the "
+          "compiler threads\n",
+          name, serial.size, serial.prog_data.wm.base.total_scratch,
+          serial_time,
+          t->compiler->simd_queue->num_threads, parallel_time,
+          offloaded_time);
+}
+
+TEST_F(simd_compile_test, fs)
+{
+   check_shader(this,
+                build_shader(compiler, mem_ctx, MESA_SHADER_FRAGMENT, 12, 150),
+                "fragment shader");
+}
+
+TEST_F(simd_compile_test, fs_spilling)
+{
+   /* SIMD8 spills and SIMD16 fails to compile. */
+   check_shader(this,
+                build_shader(compiler, mem_ctx, MESA_SHADER_FRAGMENT, 28, 100),
+                "fragment shader with spills");
+}
+
+TEST_F(simd_compile_test, fs_simd32)
+{
+   uint64_t debug = INTEL_DEBUG;
+   INTEL_DEBUG |= DEBUG_DO32;
+   check_shader(this,
+                build_shader(compiler, mem_ctx, MESA_SHADER_FRAGMENT, 12, 150),
+                "fragment shader with SIMD32");
+   INTEL_DEBUG = debug;
+}
+
+TEST_F(simd_compile_test, cs)
+{
+   check_shader(this,
+                build_shader(compiler, mem_ctx, MESA_SHADER_COMPUTE, 16, 200),
+                "compute shader");
+}
+
+TEST_F(simd_compile_test, cs_simd32)
+{
+   uint64_t debug = INTEL_DEBUG;
+   INTEL_DEBUG |= DEBUG_DO32;
+   check_shader(this,
+                build_shader(compiler, mem_ctx, MESA_SHADER_COMPUTE, 16, 200),
+                "compute shader with SIMD32");
+   INTEL_DEBUG = debug;
+}
@@ -0,0 +1,613 @@
+#encoding=utf-8
+# Copyright © 2018 Intel Corporation
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Compiles the genxml files into the const tables gen_spec_load() builds
+its gen_spec from, so the decoder doesn't have to parse any XML at runtime.
+
+The parsing below mirrors the expat handlers of gen_decoder.c, which are
+still used for gen_spec_load_from_path(), and must be kept in sync with
+them.
+"""
+
+from __future__ import (
+    absolute_import, division, print_function, unicode_literals
+)
+
+import argparse
+import re
+import string
+import sys
+import xml.parsers.expat
+
+from mako.template import Template
+
+TEMPLATE = Template("""\
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* THIS FILE HAS BEEN GENERATED, DO NOT HAND EDIT.
+ *
+ * The compiled genxml files, only meant to be included by gen_decoder.c
+ * which turns them back into a gen_spec in gen_spec_load().  Everything is
+ * const and refers to other entries by index, the strings by offset into
+ * gen_builtin_strings.
+ */
+
+static const char gen_builtin_strings[] =
+% for s in strings.strings:
+   ${c_string(s)[:-1]}\\0"
+% endfor
+   ;
+% for spec in specs:
+<% p = spec.prefix %>
+/* ${spec.filename} */
+
+% if spec.values:
+static const struct gen_builtin_value ${p}_values[] = {
+% for v in spec.values:
+   { ${strings.ref(v.name)}, ${v.value}ull },
+% endfor
+};
+
+% endif
+% if spec.fields:
+static const struct gen_builtin_field ${p}_fields[] = {
+% for f in spec.fields:
+   { ${strings.ref(f.name)}, ${f.start}, ${f.end}, ${f.default_value}u, ${c_bool(f.has_default)},
+     ${f.type[0]}, ${f.c_type_a}, ${f.c_type_b}, ${f.c_values}, ${len(f.values)} },
+% endfor
+};
+
+% endif
+static const struct gen_builtin_group ${p}_groups[] = {
+% for g in spec.groups:
+   { ${strings.ref(g.name)}, ${g.c_fields}, ${len(g.fields)}, ${g.c_parent}, ${g.c_next},
+     ${g.dw_length}, ${g.group_offset}, ${g.group_count}, ${g.group_size},
+     ${c_bool(g.variable)}, ${c_bool(g.fixed_length)},
+     0x${'%08x' % g.opcode_mask}, 0x${'%08x' % g.opcode}, 0x${'%x' % g.register_offset} },
+% endfor
+};
+
+% if spec.enums:
+static const struct gen_builtin_enum ${p}_enum_defs[] = {
+% for e in spec.enums:
+   { ${strings.ref(e.name)}, ${e.c_values}, ${len(e.values)} },
+% endfor
+};
+
+% endif
+% for table, items in spec.sorted_tables():
+% if items:
+static const uint16_t ${p}_${table.name}[] = {
+% for line in c_index_lines([item.index for item in items]):
+   ${line}
+% endfor
+};
+
+% endif
+% endfor
+% if spec.opcode_hash:
+static const uint16_t ${p}_opcode_hash[] = {
+% for line in c_index_lines([item.index if item is not None else NONE for item in spec.opcode_hash]):
+   ${line}
+% endfor
+};
+
+% endif
+% endfor
+
+static const struct gen_builtin_spec gen_builtin_specs[] = {
+% for spec in specs:
+<% p = spec.prefix %>\\
+   {
+      .gen_10 = ${spec.gen_10},
+      .gen = 0x${'%x' % spec.gen},
+      .groups = ${p}_groups,
+      .fields = ${'%s_fields' % p if spec.fields else 'NULL'},
+      .values = ${'%s_values' % p if spec.values else 'NULL'},
+      .enum_defs = ${'%s_enum_defs' % p if spec.enums else 'NULL'},
+      .ngroups = ${len(spec.groups)},
+      .nfields = ${len(spec.fields)},
+      .nvalues = ${len(spec.values)},
+      .nenum_defs = ${len(spec.enums)},
+% for table, items in spec.sorted_tables():
+      .${table.name} = ${'%s_%s' % (p, table.name) if items else 'NULL'},
+% endfor
+      .ncommands = ${len(spec.commands)},
+      .nstructs = ${len(spec.structs)},
+      .nregisters_by_name = ${len(spec.registers_by_name)},
+      .nregisters_by_offset = ${len(spec.registers_by_offset)},
+      .nenums = ${len(spec.enum_table)},
+      .opcode_hash = ${'%s_opcode_hash' % p if spec.opcode_hash else 'NULL'},
+      .opcode_hash_mult = 0x${'%08x' % spec.opcode_hash_mult}u,
+      .opcode_hash_bits = ${spec.opcode_hash_bits},
+      .opcode_masks = { ${', '.join('0x%08x' % m for m in spec.opcode_masks)} },
+      .n_opcode_masks = ${len(spec.opcode_masks)},
+   },
+% endfor
+};
+""", output_encoding='utf-8')
+
+# Keep in sync with GEN_SPEC_MAX_OPCODE_MASKS in gen_decoder.h and
+# build_opcode_hash() in gen_decoder.c.
+MAX_OPCODE_MASKS = 8
+OPCODE_HASH_SEED = 0x9e3779b1
+OPCODE_HASH_TRIES = 1 << 16
+
+# Keep in sync with GEN_BUILTIN_NONE and GEN_BUILTIN_NO_STRING in
+# gen_decoder.c.
+NONE = 0xffff
+NO_STRING = 'UINT32_MAX'
+
+def c_bool(b):
+    return 'true' if b else 'false'
+
+def c_string(s):
+    out = '"'
+    for c in bytearray(s.encode('utf-8')):
+        if c in (ord('"'), ord('\\')) or c < 0x20 or c >= 0x7f:
+            out += '\\%03o' % c
+        else:
+            out += chr(c)
+    return out + '"'
+
+def c_index_lines(indices, per_line=12):
+    return [' '.join('{},'.format(i) for i in indices[j:j + per_line])
+            for j in range(0, len(indices), per_line)]
+
+class StringTable(object):
+    """All the strings of the specs, each stored once."""
+
+    def __init__(self):
+        self.strings = []
+        self.offsets = {}
+        self.size = 0
+
+    def add(self, s):
+        if s is not None and s not in self.offsets:
+            self.offsets[s] = self.size
+            self.strings.append(s)
+            self.size += len(s.encode('utf-8')) + 1
+
+    def ref(self, s):
+        return NO_STRING if s is None else '{}u'.format(self.offsets[s])
+
+def strtoul(s):
+    """Mimics strtoul(s, NULL, 0) with a 64-bit unsigned long."""
+    s = s.lstrip()
+    negative = False
+    if s[:1] in ('+', '-'):
+        negative = s[0] == '-'
+        s = s[1:]
+
+    if s[:2] in ('0x', '0X') and s[2:3] and s[2] in string.hexdigits:
+        base, digits, s = 16, string.hexdigits, s[2:]
+    elif s[:1] == '0':
+        base, digits = 8, string.octdigits
+    else:
+        base, digits = 10, string.digits
+
+    n = 0
+    while n < len(s) and s[n] in digits:
+        n += 1
+
+    value = int(s[:n], base) if n else 0
+    return (-value if negative else value) % (1 << 64)
+
+def to_uint32(v):
+    return v & 0xffffffff
+
+def to_int32(v):
+    v &= 0xffffffff
+    return v - (1 << 32) if v & 0x80000000 else v
+
+def mask(start, end):
+    return (((1 << 64) - 1) >> (63 - end + start)) << start & ((1 << 64) - 1)
+
+def opcode_hash(opcode, mult, bits):
+    return to_uint32(opcode * mult) >> (32 - bits)
+
+class Value(object):
+    def __init__(self, attrs):
+        self.name = None
+        self.value = 0
+        for k, v in attrs:
+            if k == 'name':
+                self.name = v
+            elif k == 'value':
+                self.value = strtoul(v)
+
+class Enum(object):
+    def __init__(self, name):
+        self.name = name
+        self.values = []
+
+class Field(object):
+    def __init__(self, parent):
+        self.parent = parent
+        self.name = None
+        self.start = 0
+        self.end = 0
+        self.type = ('GEN_TYPE_UNKNOWN',)
+        self.has_default = False
+        self.default_value = 0
+        self.values = []
+
+class Group(object):
+    def __init__(self, name, attrs, parent, fixed_length):
+        self.name = name
+        self.fields = []
+        self.dw_length = 0
+        self.group_offset = 0
+        self.group_count = 0
+        self.group_size = 0
+        self.variable = False
+        self.fixed_length = fixed_length
+        self.parent = parent
+        self.next = None
+        self.opcode_mask = 0
+        self.opcode = 0
+        self.register_offset = 0
+
+        for k, v in attrs:
+            if k == 'length':
+                self.dw_length = to_uint32(strtoul(v))
+
+        if parent is not None:
+            for k, v in attrs:
+                if k == 'count':
+                    self.group_count = to_uint32(strtoul(v))
+                    if self.group_count == 0:
+                        self.variable = True
+                elif k == 'start':
+                    self.group_offset = to_uint32(strtoul(v))
+                elif k == 'size':
+                    self.group_size = to_uint32(strtoul(v))
+
+class Table(object):
+    def __init__(self, name, type):
+        self.name = name
+        self.type = type
+
+TABLES = [
+    Table('commands', 'group'),
+    Table('structs', 'group'),
+    Table('registers_by_name', 'group'),
+    Table('registers_by_offset', 'group'),
+    Table('enums', 'enum'),
+]
+
+class Spec(object):
+    def __init__(self, filename):
+        self.filename = filename
+        self.gen = 0
+        self.gen_10 = 0
+        self.groups = []
+        self.enums = []
+        self.fields = []
+        self.values = []
+
+        # Name (or offset) => item, the last definition wins like with the
+        # hash tables in gen_decoder.c.
+        self.commands = {}
+        self.structs = {}
+        self.registers_by_name = {}
+        self.registers_by_offset = {}
+        self.enum_table = {}
+
+        self.opcode_hash = None
+        self.opcode_hash_mult = 0
+        self.opcode_hash_bits = 0
+        self.opcode_masks = []
+
+    def sorted_tables(self):
+        return [
+            (TABLES[0], [v for k, v in sorted(self.commands.items())]),
+            (TABLES[1], [v for k, v in sorted(self.structs.items())]),
+            (TABLES[2], [v for k, v in sorted(self.registers_by_name.items())]),
+            (TABLES[3], [v for k, v in sorted(self.registers_by_offset.items())]),
+            (TABLES[4], [v for k, v in sorted(self.enum_table.items())]),
+        ]
+
+class XmlParser(object):
+
+    def __init__(self, filename):
+        self.parser = xml.parsers.expat.ParserCreate()
+        self.parser.ordered_attributes = True
+        self.parser.StartElementHandler = self.start_element
+        self.parser.EndElementHandler = self.end_element
+
+        self.filename = filename
+        self.spec = Spec(filename)
+        self.group = None
+        self.enum = None
+        self.values = []
+        self.last_field = None
+
+    def fail(self, msg):
+        sys.exit('{}:{}: error: {}'.format(self.filename,
+                                            self.parser.CurrentLineNumber,
+                                            msg))
+
+    def parse(self):
+        with open(self.filename, 'rb') as f:
+            self.parser.ParseFile(f)
+        return self.spec
+
+    def string_to_type(self, s):
+        simple = {
+            'int': 'GEN_TYPE_INT',
+            'uint': 'GEN_TYPE_UINT',
+            'bool': 'GEN_TYPE_BOOL',
+            'float': 'GEN_TYPE_FLOAT',
+            'address': 'GEN_TYPE_ADDRESS',
+            'offset': 'GEN_TYPE_OFFSET',
+        }
+        if s in simple:
+            return (simple[s],)
+
+        m = re.match(r'u\s*([+-]?\d+)\.\s*([+-]?\d+)', s)
+        if m:
+            return ('GEN_TYPE_UFIXED', int(m.group(1)), int(m.group(2)))
+        m = re.match(r's\s*([+-]?\d+)\.\s*([+-]?\d+)', s)
+        if m:
+            return ('GEN_TYPE_SFIXED', int(m.group(1)), int(m.group(2)))
+        if s in self.spec.structs:
+            return ('GEN_TYPE_STRUCT', self.spec.structs[s])
+        if s in self.spec.enum_table:
+            return ('GEN_TYPE_ENUM', self.spec.enum_table[s])
+        if s == 'mbo':
+            return ('GEN_TYPE_MBO',)
+
+        self.fail('invalid type: {}'.format(s))
+
+    def create_field(self, attrs):
+        field = Field(self.group)
+
+        for k, v in attrs:
+            if k == 'name':
+                field.name = v
+            elif k == 'start':
+                field.start = to_int32(strtoul(v))
+            elif k == 'end':
+                field.end = to_int32(strtoul(v))
+            elif k == 'type':
+                field.type = self.string_to_type(v)
+            elif k == 'default' and field.start >= 16 and field.end <= 31:
+                field.has_default = True
+                field.default_value = to_uint32(strtoul(v))
+
+        # Sorted by start bit, in front of the fields starting at the same
+        # bit.
+        fields = self.group.fields
+        i = 0
+        while i < len(fields) and field.start > fields[i].start:
+            i += 1
+        fields.insert(i, field)
+
+        return field
+
+    def start_element(self, element_name, attrs):
+        attrs = list(zip(attrs[0::2], attrs[1::2]))
+        name = None
+        gen = None
+        for k, v in attrs:
+            if k == 'name':
+                name = v
+            elif k == 'gen':
+                gen = v
+
+        spec = self.spec
+        if element_name == 'genxml':
+            if name is None:
+                self.fail('no platform name given')
+            if gen is None:
+                self.fail('no gen given')
+            m = re.match(r'(\d+)(?:\.(\d+))?', gen)
+            if not m:
+                self.fail('invalid gen given: {}'.format(gen))
+            major, minor = int(m.group(1)), int(m.group(2) or 0)
+            spec.gen = (major << 8) | minor
+            spec.gen_10 = int(float(gen) * 10)
+        elif element_name in ('instruction', 'struct', 'register'):
+            self.group = Group(name, attrs, None,
+                               element_name != 'instruction')
+            spec.groups.append(self.group)
+            if element_name == 'register':
+                for k, v in attrs:
+                    if k == 'num':
+                        self.group.register_offset = to_uint32(strtoul(v))
+        elif element_name == 'group':
+            previous_group = self.group
+            while previous_group.next is not None:
+                previous_group = previous_group.next
+
+            group = Group('', attrs, self.group, False)
+            spec.groups.append(group)
+            previous_group.next = group
+            self.group = group
+        elif element_name == 'field':
+            self.last_field = self.create_field(attrs)
+        elif element_name == 'enum':
+            self.enum = Enum(name)
+            spec.enums.append(self.enum)
+        elif element_name == 'value':
+            self.values.append(Value(attrs))
+
+    def end_element(self, name):
+        spec = self.spec
+        if name in ('instruction', 'struct', 'register'):
+            group = self.group
+            self.group = group.parent
+
+            for field in group.fields:
+                if field.end > 31:
+                    break
+                if field.start >= 16 and field.has_default:
+                    group.opcode_mask |= mask(field.start % 32, field.end % 32)
+                    group.opcode |= field.default_value << field.start
+            group.opcode_mask = to_uint32(group.opcode_mask)
+            group.opcode = to_uint32(group.opcode)
+
+            if name == 'instruction':
+                spec.commands[group.name] = group
+            elif name == 'struct':
+                spec.structs[group.name] = group
+            else:
+                spec.registers_by_name[group.name] = group
+                spec.registers_by_offset[group.register_offset] = group
+        elif name == 'group':
+            self.group = self.group.parent
+        elif name == 'field':
+            self.last_field.values = self.values
+            self.last_field = None
+            self.values = []
+        elif name == 'enum':
+            self.enum.values = self.values
+            spec.enum_table[self.enum.name] = self.enum
+            self.enum = None
+            self.values = []
+
+def build_opcode_hash(spec):
+    commands = list(spec.commands.values())
+
+    masks = sorted(set(c.opcode_mask for c in commands),
+                   key=lambda m: (-bin(m).count('1'), m))
+    if len(masks) > MAX_OPCODE_MASKS:
+        return
+
+    bits = 1
+    while (1 << bits) < 2 * len(commands):
+        bits += 1
+
+    while bits <= 16:
+        mult = OPCODE_HASH_SEED
+        for _ in range(OPCODE_HASH_TRIES):
+            table = [None] * (1 << bits)
+            for c in commands:
+                h = opcode_hash(c.opcode, mult, bits)
+                if table[h] is not None:
+                    break
+                table[h] = c
+            else:
+                spec.opcode_hash = table
+                spec.opcode_hash_mult = mult
+                spec.opcode_hash_bits = bits
+                spec.opcode_masks = masks
+                return
+            mult = to_uint32(mult + 2)
+        bits += 1
+
+def finish(spec, prefix):
+    """Numbers everything and computes the C indices referring to it."""
+    spec.prefix = prefix
+
+    def values_ref(values):
+        if not values:
+            return 0
+        start = len(spec.values)
+        spec.values.extend(values)
+        return start
+
+    for i, e in enumerate(spec.enums):
+        e.index = i
+        e.c_values = values_ref(e.values)
+
+    for i, g in enumerate(spec.groups):
+        g.index = i
+
+    for g in spec.groups:
+        g.c_parent = g.parent.index if g.parent else NONE
+        g.c_next = g.next.index if g.next else NONE
+        g.c_fields = len(spec.fields)
+        spec.fields.extend(g.fields)
+
+    for f in spec.fields:
+        f.c_values = values_ref(f.values)
+        kind = f.type[0]
+        if kind in ('GEN_TYPE_STRUCT', 'GEN_TYPE_ENUM'):
+            f.c_type_a, f.c_type_b = f.type[1].index, 0
+        elif kind in ('GEN_TYPE_UFIXED', 'GEN_TYPE_SFIXED'):
+            f.c_type_a, f.c_type_b = f.type[1], f.type[2]
+        else:
+            f.c_type_a, f.c_type_b = 0, 0
+        assert -0x8000 <= min(f.c_type_a, f.c_type_b)
+        assert max(f.c_type_a, f.c_type_b) < 0x8000
+
+    for items in (spec.groups, spec.fields, spec.values, spec.enums):
+        assert len(items) < NONE
+
+    build_opcode_hash(spec)
+
+def parse_args():
+    p = argparse.ArgumentParser()
+    p.add_argument('-o', '--output', type=str,
+                   help="If OUTPUT is unset or '-', then it defaults to '/dev/stdout'")
+    p.add_argument('xml_sources', metavar='XML_SOURCE', nargs='+')
+
+    pargs = p.parse_args()
+
+    if pargs.output in (None, '-'):
+        pargs.output = '/dev/stdout'
+
+    return pargs
+
+def main():
+    pargs = parse_args()
+
+    specs = []
+    strings = StringTable()
+    for source in pargs.xml_sources:
+        spec = XmlParser(source).parse()
+        finish(spec, 'gen{}'.format(spec.gen_10))
+        specs.append(spec)
+
+        for items in (spec.groups, spec.fields, spec.values, spec.enums):
+            for item in items:
+                strings.add(item.name)
+
+    with open(pargs.output, 'wb') as f:
+        f.write(TEMPLATE.render(specs=specs, strings=strings, NONE=NONE,
+                                c_bool=c_bool, c_string=c_string,
+                                c_index_lines=c_index_lines))
+
+if __name__ == '__main__':
+    main()
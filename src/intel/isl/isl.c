@@ -26,6 +26,7 @@
 #include <stdio.h>
 
 #include "genxml/genX_bits.h"
+#include "util/u_queue.h"
 
 #include "isl.h"
 #include "isl_gen4.h"
@@ -56,6 +57,7 @@ isl_device_init(struct isl_device *dev,
    dev->info = info;
    dev->use_separate_stencil = ISL_DEV_GEN(dev) >= 6;
    dev->has_bit6_swizzling = has_bit6_swizzling;
+   dev->surf_cache = NULL;
 
    /* The ISL_DEV macros may be defined in the CFLAGS, thus hardcoding some
     * device properties at buildtime. Verify that the macros with the device
@@ -1404,10 +1406,10 @@ isl_calc_row_pitch(const struct isl_device *dev,
    return true;
 }
 
-bool
-isl_surf_init_s(const struct isl_device *dev,
-                struct isl_surf *surf,
-                const struct isl_surf_init_info *restrict info)
+static bool
+isl_surf_init_uncached(const struct isl_device *dev,
+                       struct isl_surf *surf,
+                       const struct isl_surf_init_info *restrict info)
 {
    const struct isl_format_layout *fmtl = isl_format_get_layout(info->format);
 
@@ -1548,6 +1550,24 @@ isl_surf_init_s(const struct isl_device *dev,
    return true;
 }
 
+bool
+isl_surf_init_s(const struct isl_device *dev,
+                struct isl_surf *surf,
+                const struct isl_surf_init_info *restrict info)
+{
+   if (dev->surf_cache == NULL)
+      return isl_surf_init_uncached(dev, surf, info);
+
+   if (_isl_surf_cache_search(dev->surf_cache, dev, info, surf))
+      return true;
+
+   if (!isl_surf_init_uncached(dev, surf, info))
+      return false;
+
+   _isl_surf_cache_insert(dev->surf_cache, dev, info, surf);
+   return true;
+}
+
 void
 isl_surf_get_tile_info(const struct isl_surf *surf,
                        struct isl_tile_info *tile_info)
@@ -2442,3 +2462,180 @@ isl_swizzle_invert(struct isl_swizzle swizzle)
 
    return (struct isl_swizzle) { chans[0], chans[1], chans[2], chans[3] };
 }
+
+/* Copies are only split between threads if each of them gets at least this
+ * many bytes, below that the cost of waking them up dominates.
+ */
+#define ISL_MEMCPY_MIN_THREAD_BYTES (1 << 20)
+#define ISL_MEMCPY_MAX_JOBS 16
+
+struct isl_memcpy_job {
+   struct util_queue_fence fence;
+   bool to_tiled;
+   uint32_t xt1, xt2;
+   uint32_t yt1, yt2;
+   char *dst;
+   const char *src;
+   int32_t linear_pitch;
+   uint32_t tiled_pitch;
+   bool has_swizzling;
+   enum isl_tiling tiling;
+   enum isl_memcpy_type copy_type;
+};
+
+static void
+isl_memcpy_run_job(void *data, int thread_index)
+{
+   const struct isl_memcpy_job *job = data;
+
+   if (job->to_tiled) {
+#ifdef USE_AVX2
+      if (__builtin_cpu_supports("avx2")) {
+         _isl_memcpy_linear_to_tiled_avx2(job->xt1, job->xt2,
+                                          job->yt1, job->yt2,
+                                          job->dst, job->src,
+                                          job->tiled_pitch, job->linear_pitch,
+                                          job->has_swizzling, job->tiling,
+                                          job->copy_type);
+         return;
+      }
+#endif
+      _isl_memcpy_linear_to_tiled(job->xt1, job->xt2, job->yt1, job->yt2,
+                                  job->dst, job->src,
+                                  job->tiled_pitch, job->linear_pitch,
+                                  job->has_swizzling, job->tiling,
+                                  job->copy_type);
+   } else {
+#ifdef USE_AVX2
+      if (__builtin_cpu_supports("avx2")) {
+         _isl_memcpy_tiled_to_linear_avx2(job->xt1, job->xt2,
+                                          job->yt1, job->yt2,
+                                          job->dst, job->src,
+                                          job->linear_pitch, job->tiled_pitch,
+                                          job->has_swizzling, job->tiling,
+                                          job->copy_type);
+         return;
+      }
+#endif
+      _isl_memcpy_tiled_to_linear(job->xt1, job->xt2, job->yt1, job->yt2,
+                                  job->dst, job->src,
+                                  job->linear_pitch, job->tiled_pitch,
+                                  job->has_swizzling, job->tiling,
+                                  job->copy_type);
+   }
+}
+
+/**
+ * Runs a copy, split by rows of tiles between the calling thread and the
+ * threads of the queue if it is large enough.
+ */
+static void
+isl_memcpy_run(struct isl_memcpy_job *copy, struct util_queue *queue)
+{
+   const uint32_t tile_height = copy->tiling == ISL_TILING_X ? 8 :
+                                copy->tiling == ISL_TILING_Y0 ? 32 : 64;
+   const uint32_t first_row = copy->yt1 / tile_height;
+   const uint32_t num_rows = DIV_ROUND_UP(copy->yt2, tile_height) - first_row;
+   const uint64_t size = (uint64_t)(copy->xt2 - copy->xt1) *
+                         (copy->yt2 - copy->yt1);
+   unsigned num_jobs = 1;
+
+   if (queue && copy->yt2 > copy->yt1) {
+      num_jobs = MIN3(queue->num_threads + 1, num_rows,
+                      MAX2(size / ISL_MEMCPY_MIN_THREAD_BYTES, 1));
+      num_jobs = MIN2(num_jobs, ISL_MEMCPY_MAX_JOBS);
+   }
+
+   if (num_jobs <= 1) {
+      isl_memcpy_run_job(copy, 0);
+      return;
+   }
+
+   struct isl_memcpy_job jobs[ISL_MEMCPY_MAX_JOBS];
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      const uint32_t yt1 = i == 0 ? copy->yt1 :
+         (first_row + num_rows * i / num_jobs) * tile_height;
+      const uint32_t yt2 = i == num_jobs - 1 ? copy->yt2 :
+         (first_row + num_rows * (i + 1) / num_jobs) * tile_height;
+      const ptrdiff_t linear_offset =
+         (ptrdiff_t)(yt1 - copy->yt1) * copy->linear_pitch;
+
+      jobs[i] = *copy;
+      jobs[i].yt1 = yt1;
+      jobs[i].yt2 = yt2;
+      if (copy->to_tiled)
+         jobs[i].src += linear_offset;
+      else
+         jobs[i].dst += linear_offset;
+
+      if (i > 0) {
+         util_queue_fence_init(&jobs[i].fence);
+         util_queue_add_job(queue, &jobs[i], &jobs[i].fence,
+                            isl_memcpy_run_job, NULL);
+      }
+   }
+
+   isl_memcpy_run_job(&jobs[0], 0);
+
+   for (unsigned i = 1; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+void
+isl_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
+                           uint32_t yt1, uint32_t yt2,
+                           char *dst, const char *src,
+                           uint32_t dst_pitch, int32_t src_pitch,
+                           bool has_swizzling,
+                           enum isl_tiling tiling,
+                           enum isl_memcpy_type copy_type,
+                           struct util_queue *queue)
+{
+   struct isl_memcpy_job copy = {
+      .to_tiled = true,
+      .xt1 = xt1,
+      .xt2 = xt2,
+      .yt1 = yt1,
+      .yt2 = yt2,
+      .dst = dst,
+      .src = src,
+      .linear_pitch = src_pitch,
+      .tiled_pitch = dst_pitch,
+      .has_swizzling = has_swizzling,
+      .tiling = tiling,
+      .copy_type = copy_type,
+   };
+
+   isl_memcpy_run(&copy, queue);
+}
+
+void
+isl_memcpy_tiled_to_linear(uint32_t xt1, uint32_t xt2,
+                           uint32_t yt1, uint32_t yt2,
+                           char *dst, const char *src,
+                           int32_t dst_pitch, uint32_t src_pitch,
+                           bool has_swizzling,
+                           enum isl_tiling tiling,
+                           enum isl_memcpy_type copy_type,
+                           struct util_queue *queue)
+{
+   struct isl_memcpy_job copy = {
+      .to_tiled = false,
+      .xt1 = xt1,
+      .xt2 = xt2,
+      .yt1 = yt1,
+      .yt2 = yt2,
+      .dst = dst,
+      .src = src,
+      .linear_pitch = dst_pitch,
+      .tiled_pitch = src_pitch,
+      .has_swizzling = has_swizzling,
+      .tiling = tiling,
+      .copy_type = copy_type,
+   };
+
+   isl_memcpy_run(&copy, queue);
+}
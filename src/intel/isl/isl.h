@@ -51,6 +51,8 @@ extern "C" {
 
 struct gen_device_info;
 struct brw_image_param;
+struct util_queue;
+struct isl_surf_cache;
 
 #ifndef ISL_DEV_GEN
 /**
@@ -492,6 +494,15 @@ typedef uint32_t isl_tiling_flags_t;
                                            ISL_TILING_Ys_BIT)
 /** @} */
 
+/**
+ * @brief Conversion done by isl_memcpy_linear_to_tiled() and
+ * isl_memcpy_tiled_to_linear().
+ */
+enum isl_memcpy_type {
+   ISL_MEMCPY = 0,
+   ISL_MEMCPY_BGRA8, /**< Swap the R and B channels of 8-bit RGBA pixels */
+};
+
 /**
  * @brief Logical dimension of surface.
  *
@@ -955,6 +966,12 @@ struct isl_device {
    bool use_separate_stencil;
    bool has_bit6_swizzling;
 
+   /**
+    * If set, isl_surf_init() looks surfaces up in this cache before
+    * computing their layout. NULL after isl_device_init().
+    */
+   struct isl_surf_cache *surf_cache;
+
    /**
     * Describes the layout of a RENDER_SURFACE_STATE structure for the
     * current gen.
@@ -1787,6 +1804,17 @@ isl_surf_init_s(const struct isl_device *dev,
                 struct isl_surf *surf,
                 const struct isl_surf_init_info *restrict info);
 
+/**
+ * Create a cache of isl_surf_init() results, to be set as
+ * isl_device::surf_cache.  It is safe to use from several threads and to
+ * share between devices.
+ */
+struct isl_surf_cache *
+isl_surf_cache_create(void);
+
+void
+isl_surf_cache_destroy(struct isl_surf_cache *cache);
+
 void
 isl_surf_get_tile_info(const struct isl_surf *surf,
                        struct isl_tile_info *tile_info);
@@ -2065,6 +2093,48 @@ uint32_t
 isl_surf_get_depth_format(const struct isl_device *dev,
                           const struct isl_surf *surf);
 
+/**
+ * @brief Copy a rectangle from a linear buffer to a tiled surface.
+ *
+ * The rectangle is [xt1, xt2) x [yt1, yt2), with the X range in bytes and
+ * the Y range in rows.  @a dst is the address of (0, 0) in the tiled surface
+ * and @a src the address of (xt1, yt1) in the linear buffer, whose pitch may
+ * be negative.  X, Y0 and W tiling are supported, W only with ISL_MEMCPY.
+ *
+ * If @a has_swizzling, the surface is assumed to be swizzled with bits 9 and
+ * 10 for X tiling and bit 9 for Y and W tiling.
+ *
+ * If @a queue is not NULL, large copies are split between the calling thread
+ * and the threads of the queue.
+ */
+void
+isl_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
+                           uint32_t yt1, uint32_t yt2,
+                           char *dst, const char *src,
+                           uint32_t dst_pitch, int32_t src_pitch,
+                           bool has_swizzling,
+                           enum isl_tiling tiling,
+                           enum isl_memcpy_type copy_type,
+                           struct util_queue *queue);
+
+/**
+ * @brief Copy a rectangle from a tiled surface to a linear buffer.
+ *
+ * @a dst is the address of (xt1, yt1) in the linear buffer and @a src the
+ * address of (0, 0) in the tiled surface.
+ *
+ * @see isl_memcpy_linear_to_tiled()
+ */
+void
+isl_memcpy_tiled_to_linear(uint32_t xt1, uint32_t xt2,
+                           uint32_t yt1, uint32_t yt2,
+                           char *dst, const char *src,
+                           int32_t dst_pitch, uint32_t src_pitch,
+                           bool has_swizzling,
+                           enum isl_tiling tiling,
+                           enum isl_memcpy_type copy_type,
+                           struct util_queue *queue);
+
 #ifdef __cplusplus
 }
 #endif
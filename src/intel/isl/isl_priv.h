@@ -158,6 +158,60 @@ isl_extent3d_el_to_sa(enum isl_format fmt, struct isl_extent3d extent_el)
    };
 }
 
+/* The tiled copies, built once with the default compiler flags and once with
+ * AVX2 enabled if the compiler supports it.
+ */
+void
+_isl_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
+                            uint32_t yt1, uint32_t yt2,
+                            char *dst, const char *src,
+                            uint32_t dst_pitch, int32_t src_pitch,
+                            bool has_swizzling,
+                            enum isl_tiling tiling,
+                            enum isl_memcpy_type copy_type);
+
+void
+_isl_memcpy_tiled_to_linear(uint32_t xt1, uint32_t xt2,
+                            uint32_t yt1, uint32_t yt2,
+                            char *dst, const char *src,
+                            int32_t dst_pitch, uint32_t src_pitch,
+                            bool has_swizzling,
+                            enum isl_tiling tiling,
+                            enum isl_memcpy_type copy_type);
+
+void
+_isl_memcpy_linear_to_tiled_avx2(uint32_t xt1, uint32_t xt2,
+                                 uint32_t yt1, uint32_t yt2,
+                                 char *dst, const char *src,
+                                 uint32_t dst_pitch, int32_t src_pitch,
+                                 bool has_swizzling,
+                                 enum isl_tiling tiling,
+                                 enum isl_memcpy_type copy_type);
+
+void
+_isl_memcpy_tiled_to_linear_avx2(uint32_t xt1, uint32_t xt2,
+                                 uint32_t yt1, uint32_t yt2,
+                                 char *dst, const char *src,
+                                 int32_t dst_pitch, uint32_t src_pitch,
+                                 bool has_swizzling,
+                                 enum isl_tiling tiling,
+                                 enum isl_memcpy_type copy_type);
+
+/* Lookup and insertion in isl_device::surf_cache, keyed by the device and
+ * the isl_surf_init_info.
+ */
+bool
+_isl_surf_cache_search(struct isl_surf_cache *cache,
+                       const struct isl_device *dev,
+                       const struct isl_surf_init_info *restrict info,
+                       struct isl_surf *surf);
+
+void
+_isl_surf_cache_insert(struct isl_surf_cache *cache,
+                       const struct isl_device *dev,
+                       const struct isl_surf_init_info *restrict info,
+                       const struct isl_surf *surf);
+
 /* This is useful for adding the isl_prefix to genX functions */
 #define __PASTE2(x, y) x ## y
 #define __PASTE(x, y) __PASTE2(x, y)
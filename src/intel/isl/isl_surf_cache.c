@@ -0,0 +1,230 @@
+/*
+ * Copyright 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "isl_priv.h"
+
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "util/simple_mtx.h"
+
+/* Past this many surfaces, the cache is emptied rather than growing
+ * further.  Applications churning through surfaces only ever use a handful
+ * of distinct descriptors.
+ */
+#define ISL_SURF_CACHE_MAX_ENTRIES 4096
+
+/* Everything isl_surf_init_s() depends on, with no padding so that keys
+ * can be hashed and compared as plain memory.
+ */
+struct isl_surf_cache_key {
+   uint32_t gen;
+   uint32_t gt;
+   uint32_t dev_flags;
+
+   uint32_t dim;
+   uint32_t format;
+   uint32_t width;
+   uint32_t height;
+   uint32_t depth;
+   uint32_t levels;
+   uint32_t array_len;
+   uint32_t samples;
+   uint32_t min_alignment;
+   uint32_t row_pitch;
+   uint32_t tiling_flags;
+   uint64_t usage;
+};
+
+struct isl_surf_cache_entry {
+   struct isl_surf_cache_key key;
+   struct isl_surf surf;
+};
+
+struct isl_surf_cache {
+   simple_mtx_t mutex;
+   struct hash_table *entries;
+};
+
+static uint32_t
+key_hash(const void *key)
+{
+   const uint64_t *qw = key;
+   uint64_t hash = 0;
+
+   STATIC_ASSERT(sizeof(struct isl_surf_cache_key) % 8 == 0);
+
+   /* This is on the path of every lookup, keep it to one multiply per
+    * qword.
+    */
+   for (unsigned i = 0; i < sizeof(struct isl_surf_cache_key) / 8; i++)
+      hash = (hash ^ qw[i]) * 0x9e3779b97f4a7c15ull;
+
+   return hash ^ (hash >> 32);
+}
+
+static bool
+key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct isl_surf_cache_key)) == 0;
+}
+
+static void
+init_key(struct isl_surf_cache_key *key, const struct isl_device *dev,
+         const struct isl_surf_init_info *restrict info)
+{
+   memset(key, 0, sizeof(*key));
+
+   /* The device is identified by the contents of its info rather than by
+    * the pointer, which may be freed and reused for another device while
+    * its entries are still in the cache.
+    */
+   const struct gen_device_info *devinfo = dev->info;
+   key->gen = devinfo->gen;
+   key->gt = devinfo->gt;
+   key->dev_flags = dev->use_separate_stencil |
+                    dev->has_bit6_swizzling << 1 |
+                    devinfo->has_hiz_and_separate_stencil << 2 |
+                    devinfo->must_use_separate_stencil << 3 |
+                    devinfo->is_g4x << 4 |
+                    devinfo->is_ivybridge << 5 |
+                    devinfo->is_baytrail << 6 |
+                    devinfo->is_haswell << 7 |
+                    devinfo->is_broadwell << 8 |
+                    devinfo->is_cherryview << 9 |
+                    devinfo->is_skylake << 10 |
+                    devinfo->is_broxton << 11 |
+                    devinfo->is_kabylake << 12 |
+                    devinfo->is_geminilake << 13 |
+                    devinfo->is_coffeelake << 14 |
+                    devinfo->is_cannonlake << 15;
+
+   key->dim = info->dim;
+   key->format = info->format;
+   key->width = info->width;
+   key->height = info->height;
+   key->depth = info->depth;
+   key->levels = info->levels;
+   key->array_len = info->array_len;
+   key->samples = info->samples;
+   key->min_alignment = info->min_alignment;
+   key->row_pitch = info->row_pitch;
+   key->tiling_flags = info->tiling_flags;
+   key->usage = info->usage;
+}
+
+struct isl_surf_cache *
+isl_surf_cache_create(void)
+{
+   struct isl_surf_cache *cache = ralloc(NULL, struct isl_surf_cache);
+   if (cache == NULL)
+      return NULL;
+
+   simple_mtx_init(&cache->mutex, mtx_plain);
+   cache->entries = _mesa_hash_table_create(cache, key_hash, key_equal);
+   if (cache->entries == NULL) {
+      ralloc_free(cache);
+      return NULL;
+   }
+
+   return cache;
+}
+
+void
+isl_surf_cache_destroy(struct isl_surf_cache *cache)
+{
+   if (cache == NULL)
+      return;
+
+   simple_mtx_destroy(&cache->mutex);
+   ralloc_free(cache);
+}
+
+bool
+_isl_surf_cache_search(struct isl_surf_cache *cache,
+                       const struct isl_device *dev,
+                       const struct isl_surf_init_info *restrict info,
+                       struct isl_surf *surf)
+{
+   struct isl_surf_cache_key key;
+   init_key(&key, dev, info);
+
+   const uint32_t hash = key_hash(&key);
+
+   simple_mtx_lock(&cache->mutex);
+
+   struct hash_entry *entry =
+      _mesa_hash_table_search_pre_hashed(cache->entries, hash, &key);
+   if (entry) {
+      const struct isl_surf_cache_entry *cached = entry->data;
+      *surf = cached->surf;
+   }
+
+   simple_mtx_unlock(&cache->mutex);
+
+   return entry != NULL;
+}
+
+static void
+free_entry(struct hash_entry *entry)
+{
+   ralloc_free(entry->data);
+}
+
+void
+_isl_surf_cache_insert(struct isl_surf_cache *cache,
+                       const struct isl_device *dev,
+                       const struct isl_surf_init_info *restrict info,
+                       const struct isl_surf *surf)
+{
+   struct isl_surf_cache_key key;
+   init_key(&key, dev, info);
+
+   const uint32_t hash = key_hash(&key);
+
+   /* The entries are allocated under the lock as well since ralloc contexts
+    * aren't thread-safe.
+    */
+   simple_mtx_lock(&cache->mutex);
+
+   /* Another thread may have added the same surface in the meantime. */
+   if (_mesa_hash_table_search_pre_hashed(cache->entries, hash, &key)) {
+      simple_mtx_unlock(&cache->mutex);
+      return;
+   }
+
+   if (cache->entries->entries >= ISL_SURF_CACHE_MAX_ENTRIES)
+      _mesa_hash_table_clear(cache->entries, free_entry);
+
+   struct isl_surf_cache_entry *cached =
+      ralloc(cache->entries, struct isl_surf_cache_entry);
+   if (cached) {
+      cached->key = key;
+      cached->surf = *surf;
+      _mesa_hash_table_insert_pre_hashed(cache->entries, hash,
+                                         &cached->key, cached);
+   }
+
+   simple_mtx_unlock(&cache->mutex);
+}
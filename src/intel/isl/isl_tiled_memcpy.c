@@ -0,0 +1,1276 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright 2012 Intel Corporation
+ * Copyright 2013 Google
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *    Chad Versace <chad.versace@linux.intel.com>
+ *    Frank Henigman <fjhenigman@google.com>
+ */
+
+/* This file is not compiled on its own but included by
+ * isl_tiled_memcpy_normal.c and isl_tiled_memcpy_avx2.c, which build the
+ * same copy functions with and without AVX2.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "util/macros.h"
+
+#include "isl_priv.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* All the tile dimensions are powers of two. */
+#define ALIGN_DOWN(a, b) ((a) & ~((b) - 1))
+#define ALIGN_UP(a, b) ALIGN_POT(a, b)
+
+/* Tile dimensions.  Width and span are in bytes, height is in pixels (i.e.
+ * unitless).  A "span" is the most number of bytes we can copy from linear
+ * to tiled without needing to calculate a new destination address.  W tiles
+ * interleave the bytes of 8x8 blocks, so their span is a row of a block.
+ */
+static const uint32_t xtile_width = 512;
+static const uint32_t xtile_height = 8;
+static const uint32_t xtile_span = 64;
+static const uint32_t ytile_width = 128;
+static const uint32_t ytile_height = 32;
+static const uint32_t ytile_span = 16;
+static const uint32_t wtile_width = 64;
+static const uint32_t wtile_height = 64;
+static const uint32_t wtile_span = 8;
+
+typedef void *(*mem_copy_fn)(void *dest, const void *src, size_t n);
+
+static inline uint32_t
+ror(uint32_t n, uint32_t d)
+{
+   return (n >> d) | (n << (32 - d));
+}
+
+static inline uint32_t
+bswap32(uint32_t n)
+{
+#if defined(HAVE___BUILTIN_BSWAP32)
+   return __builtin_bswap32(n);
+#else
+   return (n >> 24) |
+          ((n >> 8) & 0x0000ff00) |
+          ((n << 8) & 0x00ff0000) |
+          (n << 24);
+#endif
+}
+
+/**
+ * Copy RGBA to BGRA - swap R and B.
+ */
+static inline void *
+rgba8_copy(void *dst, const void *src, size_t bytes)
+{
+   uint32_t *d = dst;
+   uint32_t const *s = src;
+
+   assert(bytes % 4 == 0);
+
+   while (bytes >= 4) {
+      *d = ror(bswap32(*s), 8);
+      d += 1;
+      s += 1;
+      bytes -= 4;
+   }
+   return dst;
+}
+
+#ifdef __SSSE3__
+static const uint8_t rgba8_permutation[16] =
+   { 2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15 };
+
+static inline void
+rgba8_copy_16_aligned_dst(void *dst, const void *src)
+{
+   _mm_store_si128(dst,
+                   _mm_shuffle_epi8(_mm_loadu_si128(src),
+                                    *(__m128i *)rgba8_permutation));
+}
+
+static inline void
+rgba8_copy_16_aligned_src(void *dst, const void *src)
+{
+   _mm_storeu_si128(dst,
+                    _mm_shuffle_epi8(_mm_load_si128(src),
+                                     *(__m128i *)rgba8_permutation));
+}
+
+#elif defined(__SSE2__)
+static inline void
+rgba8_copy_16_aligned_dst(void *dst, const void *src)
+{
+   __m128i srcreg, dstreg, agmask, ag, rb, br;
+
+   agmask = _mm_set1_epi32(0xFF00FF00);
+   srcreg = _mm_loadu_si128((__m128i *)src);
+
+   rb = _mm_andnot_si128(agmask, srcreg);
+   ag = _mm_and_si128(agmask, srcreg);
+   br = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1)),
+                            _MM_SHUFFLE(2, 3, 0, 1));
+   dstreg = _mm_or_si128(ag, br);
+
+   _mm_store_si128((__m128i *)dst, dstreg);
+}
+
+static inline void
+rgba8_copy_16_aligned_src(void *dst, const void *src)
+{
+   __m128i srcreg, dstreg, agmask, ag, rb, br;
+
+   agmask = _mm_set1_epi32(0xFF00FF00);
+   srcreg = _mm_load_si128((__m128i *)src);
+
+   rb = _mm_andnot_si128(agmask, srcreg);
+   ag = _mm_and_si128(agmask, srcreg);
+   br = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1)),
+                            _MM_SHUFFLE(2, 3, 0, 1));
+   dstreg = _mm_or_si128(ag, br);
+
+   _mm_storeu_si128((__m128i *)dst, dstreg);
+}
+#endif
+
+#ifdef __AVX2__
+static inline __m256i
+rgba8_swap_32(__m256i src)
+{
+   return _mm256_shuffle_epi8(src,
+                              _mm256_setr_epi8(2,1,0,3, 6,5,4,7,
+                                               10,9,8,11, 14,13,12,15,
+                                               2,1,0,3, 6,5,4,7,
+                                               10,9,8,11, 14,13,12,15));
+}
+
+/**
+ * Copy 32 bytes of RGBA to BGRA.  Unaligned AVX loads and stores are as
+ * fast as the aligned ones on aligned addresses, so this is used on either
+ * side.
+ */
+static inline void
+rgba8_copy_32(void *dst, const void *src)
+{
+   _mm256_storeu_si256((__m256i *)dst,
+                       rgba8_swap_32(_mm256_loadu_si256((const __m256i *)src)));
+}
+#endif
+
+/**
+ * Copy RGBA to BGRA - swap R and B, with the destination 16-byte aligned.
+ */
+static inline void *
+rgba8_copy_aligned_dst(void *dst, const void *src, size_t bytes)
+{
+   assert(bytes == 0 || !(((uintptr_t)dst) & 0xf));
+
+#if defined(__SSSE3__) || defined(__SSE2__)
+   if (bytes == 64) {
+#ifdef __AVX2__
+      rgba8_copy_32(dst +  0, src +  0);
+      rgba8_copy_32(dst + 32, src + 32);
+#else
+      rgba8_copy_16_aligned_dst(dst +  0, src +  0);
+      rgba8_copy_16_aligned_dst(dst + 16, src + 16);
+      rgba8_copy_16_aligned_dst(dst + 32, src + 32);
+      rgba8_copy_16_aligned_dst(dst + 48, src + 48);
+#endif
+      return dst;
+   }
+
+   while (bytes >= 16) {
+      rgba8_copy_16_aligned_dst(dst, src);
+      src += 16;
+      dst += 16;
+      bytes -= 16;
+   }
+#endif
+
+   rgba8_copy(dst, src, bytes);
+
+   return dst;
+}
+
+/**
+ * Copy RGBA to BGRA - swap R and B, with the source 16-byte aligned.
+ */
+static inline void *
+rgba8_copy_aligned_src(void *dst, const void *src, size_t bytes)
+{
+   assert(bytes == 0 || !(((uintptr_t)src) & 0xf));
+
+#if defined(__SSSE3__) || defined(__SSE2__)
+   if (bytes == 64) {
+#ifdef __AVX2__
+      rgba8_copy_32(dst +  0, src +  0);
+      rgba8_copy_32(dst + 32, src + 32);
+#else
+      rgba8_copy_16_aligned_src(dst +  0, src +  0);
+      rgba8_copy_16_aligned_src(dst + 16, src + 16);
+      rgba8_copy_16_aligned_src(dst + 32, src + 32);
+      rgba8_copy_16_aligned_src(dst + 48, src + 48);
+#endif
+      return dst;
+   }
+
+   while (bytes >= 16) {
+      rgba8_copy_16_aligned_src(dst, src);
+      src += 16;
+      dst += 16;
+      bytes -= 16;
+   }
+#endif
+
+   rgba8_copy(dst, src, bytes);
+
+   return dst;
+}
+
+/**
+ * Each row from y0 to y1 is copied in three parts: [x0,x1), [x1,x2), [x2,x3).
+ * These ranges are in bytes, i.e. pixels * bytes-per-pixel.
+ * The first and last ranges must be shorter than a "span" (the longest linear
+ * stretch within a tile) and the middle must equal a whole number of spans.
+ * Ranges may be empty.  The region copied must land entirely within one tile.
+ * 'dst' is the start of the tile and 'src' is the corresponding
+ * address to copy from, though copying begins at (x0, y0).
+ * To enable swizzling 'swizzle_bit' must be 1<<6, otherwise zero.
+ * Swizzling flips bit 6 in the copy destination offset, when certain other
+ * bits are set in it.
+ */
+typedef void (*tile_copy_fn)(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                             uint32_t y0, uint32_t y1,
+                             char *dst, const char *src,
+                             int32_t linear_pitch,
+                             uint32_t swizzle_bit,
+                             mem_copy_fn mem_copy);
+
+/**
+ * Copy a span of four consecutive rows from linear to a Y tile, where they
+ * are 64 contiguous bytes of a column.
+ */
+static inline void
+linear_to_ytile_span4(char *dst, const char *src, int32_t src_pitch,
+                      mem_copy_fn mem_copy_align16)
+{
+#ifdef __AVX2__
+   __m256i rows01 = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src)),
+      _mm_loadu_si128((const __m128i *)(src + 1 * src_pitch)), 1);
+   __m256i rows23 = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(
+         _mm_loadu_si128((const __m128i *)(src + 2 * src_pitch))),
+      _mm_loadu_si128((const __m128i *)(src + 3 * src_pitch)), 1);
+
+   assert(mem_copy_align16 == memcpy ||
+          mem_copy_align16 == rgba8_copy_aligned_dst);
+   if (mem_copy_align16 == rgba8_copy_aligned_dst) {
+      rows01 = rgba8_swap_32(rows01);
+      rows23 = rgba8_swap_32(rows23);
+   }
+
+   _mm256_storeu_si256((__m256i *)dst, rows01);
+   _mm256_storeu_si256((__m256i *)(dst + 32), rows23);
+#else
+   mem_copy_align16(dst + 0 * ytile_span, src + 0 * src_pitch, ytile_span);
+   mem_copy_align16(dst + 1 * ytile_span, src + 1 * src_pitch, ytile_span);
+   mem_copy_align16(dst + 2 * ytile_span, src + 2 * src_pitch, ytile_span);
+   mem_copy_align16(dst + 3 * ytile_span, src + 3 * src_pitch, ytile_span);
+#endif
+}
+
+/**
+ * Copy a span of four consecutive rows from a Y tile to linear.
+ */
+static inline void
+ytile_to_linear_span4(char *dst, int32_t dst_pitch, const char *src,
+                      mem_copy_fn mem_copy_align16)
+{
+#ifdef __AVX2__
+   __m256i rows01 = _mm256_loadu_si256((const __m256i *)src);
+   __m256i rows23 = _mm256_loadu_si256((const __m256i *)(src + 32));
+
+   assert(mem_copy_align16 == memcpy ||
+          mem_copy_align16 == rgba8_copy_aligned_src);
+   if (mem_copy_align16 == rgba8_copy_aligned_src) {
+      rows01 = rgba8_swap_32(rows01);
+      rows23 = rgba8_swap_32(rows23);
+   }
+
+   _mm_storeu_si128((__m128i *)(dst + 0 * dst_pitch),
+                    _mm256_castsi256_si128(rows01));
+   _mm_storeu_si128((__m128i *)(dst + 1 * dst_pitch),
+                    _mm256_extracti128_si256(rows01, 1));
+   _mm_storeu_si128((__m128i *)(dst + 2 * dst_pitch),
+                    _mm256_castsi256_si128(rows23));
+   _mm_storeu_si128((__m128i *)(dst + 3 * dst_pitch),
+                    _mm256_extracti128_si256(rows23, 1));
+#else
+   mem_copy_align16(dst + 0 * dst_pitch, src + 0 * ytile_span, ytile_span);
+   mem_copy_align16(dst + 1 * dst_pitch, src + 1 * ytile_span, ytile_span);
+   mem_copy_align16(dst + 2 * dst_pitch, src + 2 * ytile_span, ytile_span);
+   mem_copy_align16(dst + 3 * dst_pitch, src + 3 * ytile_span, ytile_span);
+#endif
+}
+
+/**
+ * Copy texture data from linear to X tile layout.
+ *
+ * \copydoc tile_copy_fn
+ *
+ * The mem_copy parameters allow the user to specify an alternative mem_copy
+ * function that, for instance, may do RGBA -> BGRA swizzling.  The first
+ * function must handle any memory alignment while the second function must
+ * only handle 16-byte alignment in whichever side (source or destination) is
+ * tiled.
+ */
+static inline void
+linear_to_xtiled(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                 uint32_t y0, uint32_t y1,
+                 char *dst, const char *src,
+                 int32_t src_pitch,
+                 uint32_t swizzle_bit,
+                 mem_copy_fn mem_copy,
+                 mem_copy_fn mem_copy_align16)
+{
+   /* The copy destination offset for each range copied is the sum of
+    * an X offset 'x0' or 'xo' and a Y offset 'yo.'
+    */
+   uint32_t xo, yo;
+
+   src += (ptrdiff_t)y0 * src_pitch;
+
+   for (yo = y0 * xtile_width; yo < y1 * xtile_width; yo += xtile_width) {
+      /* Bits 9 and 10 of the copy destination offset control swizzling.
+       * Only 'yo' contributes to those bits in the total offset,
+       * so calculate 'swizzle' just once per row.
+       * Move bits 9 and 10 three and four places respectively down
+       * to bit 6 and xor them.
+       */
+      uint32_t swizzle = ((yo >> 3) ^ (yo >> 4)) & swizzle_bit;
+
+      mem_copy(dst + ((x0 + yo) ^ swizzle), src + x0, x1 - x0);
+
+      for (xo = x1; xo < x2; xo += xtile_span) {
+         mem_copy_align16(dst + ((xo + yo) ^ swizzle), src + xo, xtile_span);
+      }
+
+      mem_copy_align16(dst + ((xo + yo) ^ swizzle), src + x2, x3 - x2);
+
+      src += src_pitch;
+   }
+}
+
+/**
+ * Copy texture data from linear to Y tile layout.
+ *
+ * \copydoc tile_copy_fn
+ */
+static inline void
+linear_to_ytiled(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                 uint32_t y0, uint32_t y3,
+                 char *dst, const char *src,
+                 int32_t src_pitch,
+                 uint32_t swizzle_bit,
+                 mem_copy_fn mem_copy,
+                 mem_copy_fn mem_copy_align16)
+{
+   /* Y tiles consist of columns that are 'ytile_span' wide (and the same height
+    * as the tile).  Thus the destination offset for (x,y) is the sum of:
+    *   (x % column_width)                    // position within column
+    *   (x / column_width) * bytes_per_column // column number * bytes per column
+    *   y * column_width
+    *
+    * The copy destination offset for each range copied is the sum of
+    * an X offset 'xo0' or 'xo' and a Y offset 'yo.'
+    */
+   const uint32_t column_width = ytile_span;
+   const uint32_t bytes_per_column = column_width * ytile_height;
+
+   uint32_t y1 = MIN2(y3, ALIGN_UP(y0, 4));
+   uint32_t y2 = MAX2(y1, ALIGN_DOWN(y3, 4));
+
+   uint32_t xo0 = (x0 % ytile_span) + (x0 / ytile_span) * bytes_per_column;
+   uint32_t xo1 = (x1 % ytile_span) + (x1 / ytile_span) * bytes_per_column;
+
+   /* Bit 9 of the destination offset control swizzling.
+    * Only the X offset contributes to bit 9 of the total offset,
+    * so swizzle can be calculated in advance for these X positions.
+    * Move bit 9 three places down to bit 6.
+    */
+   uint32_t swizzle0 = (xo0 >> 3) & swizzle_bit;
+   uint32_t swizzle1 = (xo1 >> 3) & swizzle_bit;
+
+   uint32_t x, yo;
+
+   src += (ptrdiff_t)y0 * src_pitch;
+
+   if (y0 != y1) {
+      for (yo = y0 * column_width; yo < y1 * column_width; yo += column_width) {
+         uint32_t xo = xo1;
+         uint32_t swizzle = swizzle1;
+
+         mem_copy(dst + ((xo0 + yo) ^ swizzle0), src + x0, x1 - x0);
+
+         /* Step by spans/columns.  As it happens, the swizzle bit flips
+          * at each step so we don't need to calculate it explicitly.
+          */
+         for (x = x1; x < x2; x += ytile_span) {
+            mem_copy_align16(dst + ((xo + yo) ^ swizzle), src + x, ytile_span);
+            xo += bytes_per_column;
+            swizzle ^= swizzle_bit;
+         }
+
+         mem_copy_align16(dst + ((xo + yo) ^ swizzle), src + x2, x3 - x2);
+
+         src += src_pitch;
+      }
+   }
+
+   for (yo = y1 * column_width; yo < y2 * column_width; yo += 4 * column_width) {
+      uint32_t xo = xo1;
+      uint32_t swizzle = swizzle1;
+
+      if (x0 != x1) {
+         mem_copy(dst + ((xo0 + yo + 0 * column_width) ^ swizzle0), src + x0 + 0 * src_pitch, x1 - x0);
+         mem_copy(dst + ((xo0 + yo + 1 * column_width) ^ swizzle0), src + x0 + 1 * src_pitch, x1 - x0);
+         mem_copy(dst + ((xo0 + yo + 2 * column_width) ^ swizzle0), src + x0 + 2 * src_pitch, x1 - x0);
+         mem_copy(dst + ((xo0 + yo + 3 * column_width) ^ swizzle0), src + x0 + 3 * src_pitch, x1 - x0);
+      }
+
+      /* Step by spans/columns.  As it happens, the swizzle bit flips
+       * at each step so we don't need to calculate it explicitly.
+       */
+      for (x = x1; x < x2; x += ytile_span) {
+         linear_to_ytile_span4(dst + ((xo + yo) ^ swizzle), src + x, src_pitch,
+                               mem_copy_align16);
+         xo += bytes_per_column;
+         swizzle ^= swizzle_bit;
+      }
+
+      if (x2 != x3) {
+         mem_copy_align16(dst + ((xo + yo + 0 * column_width) ^ swizzle), src + x2 + 0 * src_pitch, x3 - x2);
+         mem_copy_align16(dst + ((xo + yo + 1 * column_width) ^ swizzle), src + x2 + 1 * src_pitch, x3 - x2);
+         mem_copy_align16(dst + ((xo + yo + 2 * column_width) ^ swizzle), src + x2 + 2 * src_pitch, x3 - x2);
+         mem_copy_align16(dst + ((xo + yo + 3 * column_width) ^ swizzle), src + x2 + 3 * src_pitch, x3 - x2);
+      }
+
+      src += 4 * src_pitch;
+   }
+
+   if (y2 != y3) {
+      for (yo = y2 * column_width; yo < y3 * column_width; yo += column_width) {
+         uint32_t xo = xo1;
+         uint32_t swizzle = swizzle1;
+
+         mem_copy(dst + ((xo0 + yo) ^ swizzle0), src + x0, x1 - x0);
+
+         /* Step by spans/columns.  As it happens, the swizzle bit flips
+          * at each step so we don't need to calculate it explicitly.
+          */
+         for (x = x1; x < x2; x += ytile_span) {
+            mem_copy_align16(dst + ((xo + yo) ^ swizzle), src + x, ytile_span);
+            xo += bytes_per_column;
+            swizzle ^= swizzle_bit;
+         }
+
+         mem_copy_align16(dst + ((xo + yo) ^ swizzle), src + x2, x3 - x2);
+
+         src += src_pitch;
+      }
+   }
+}
+
+/**
+ * Copy texture data from X tile layout to linear.
+ *
+ * \copydoc tile_copy_fn
+ */
+static inline void
+xtiled_to_linear(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                 uint32_t y0, uint32_t y1,
+                 char *dst, const char *src,
+                 int32_t dst_pitch,
+                 uint32_t swizzle_bit,
+                 mem_copy_fn mem_copy,
+                 mem_copy_fn mem_copy_align16)
+{
+   /* The copy destination offset for each range copied is the sum of
+    * an X offset 'x0' or 'xo' and a Y offset 'yo.'
+    */
+   uint32_t xo, yo;
+
+   dst += (ptrdiff_t)y0 * dst_pitch;
+
+   for (yo = y0 * xtile_width; yo < y1 * xtile_width; yo += xtile_width) {
+      /* Bits 9 and 10 of the copy destination offset control swizzling.
+       * Only 'yo' contributes to those bits in the total offset,
+       * so calculate 'swizzle' just once per row.
+       * Move bits 9 and 10 three and four places respectively down
+       * to bit 6 and xor them.
+       */
+      uint32_t swizzle = ((yo >> 3) ^ (yo >> 4)) & swizzle_bit;
+
+      mem_copy(dst + x0, src + ((x0 + yo) ^ swizzle), x1 - x0);
+
+      for (xo = x1; xo < x2; xo += xtile_span) {
+         mem_copy_align16(dst + xo, src + ((xo + yo) ^ swizzle), xtile_span);
+      }
+
+      mem_copy_align16(dst + x2, src + ((xo + yo) ^ swizzle), x3 - x2);
+
+      dst += dst_pitch;
+   }
+}
+
+ /**
+ * Copy texture data from Y tile layout to linear.
+ *
+ * \copydoc tile_copy_fn
+ */
+static inline void
+ytiled_to_linear(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                 uint32_t y0, uint32_t y3,
+                 char *dst, const char *src,
+                 int32_t dst_pitch,
+                 uint32_t swizzle_bit,
+                 mem_copy_fn mem_copy,
+                 mem_copy_fn mem_copy_align16)
+{
+   /* Y tiles consist of columns that are 'ytile_span' wide (and the same height
+    * as the tile).  Thus the destination offset for (x,y) is the sum of:
+    *   (x % column_width)                    // position within column
+    *   (x / column_width) * bytes_per_column // column number * bytes per column
+    *   y * column_width
+    *
+    * The copy destination offset for each range copied is the sum of
+    * an X offset 'xo0' or 'xo' and a Y offset 'yo.'
+    */
+   const uint32_t column_width = ytile_span;
+   const uint32_t bytes_per_column = column_width * ytile_height;
+
+   uint32_t y1 = MIN2(y3, ALIGN_UP(y0, 4));
+   uint32_t y2 = MAX2(y1, ALIGN_DOWN(y3, 4));
+
+   uint32_t xo0 = (x0 % ytile_span) + (x0 / ytile_span) * bytes_per_column;
+   uint32_t xo1 = (x1 % ytile_span) + (x1 / ytile_span) * bytes_per_column;
+
+   /* Bit 9 of the destination offset control swizzling.
+    * Only the X offset contributes to bit 9 of the total offset,
+    * so swizzle can be calculated in advance for these X positions.
+    * Move bit 9 three places down to bit 6.
+    */
+   uint32_t swizzle0 = (xo0 >> 3) & swizzle_bit;
+   uint32_t swizzle1 = (xo1 >> 3) & swizzle_bit;
+
+   uint32_t x, yo;
+
+   dst += (ptrdiff_t)y0 * dst_pitch;
+
+   if (y0 != y1) {
+      for (yo = y0 * column_width; yo < y1 * column_width; yo += column_width) {
+         uint32_t xo = xo1;
+         uint32_t swizzle = swizzle1;
+
+         mem_copy(dst + x0, src + ((xo0 + yo) ^ swizzle0), x1 - x0);
+
+         /* Step by spans/columns.  As it happens, the swizzle bit flips
+          * at each step so we don't need to calculate it explicitly.
+          */
+         for (x = x1; x < x2; x += ytile_span) {
+            mem_copy_align16(dst + x, src + ((xo + yo) ^ swizzle), ytile_span);
+            xo += bytes_per_column;
+            swizzle ^= swizzle_bit;
+         }
+
+         mem_copy_align16(dst + x2, src + ((xo + yo) ^ swizzle), x3 - x2);
+
+         dst += dst_pitch;
+      }
+   }
+
+   for (yo = y1 * column_width; yo < y2 * column_width; yo += 4 * column_width) {
+      uint32_t xo = xo1;
+      uint32_t swizzle = swizzle1;
+
+      if (x0 != x1) {
+         mem_copy(dst + x0 + 0 * dst_pitch, src + ((xo0 + yo + 0 * column_width) ^ swizzle0), x1 - x0);
+         mem_copy(dst + x0 + 1 * dst_pitch, src + ((xo0 + yo + 1 * column_width) ^ swizzle0), x1 - x0);
+         mem_copy(dst + x0 + 2 * dst_pitch, src + ((xo0 + yo + 2 * column_width) ^ swizzle0), x1 - x0);
+         mem_copy(dst + x0 + 3 * dst_pitch, src + ((xo0 + yo + 3 * column_width) ^ swizzle0), x1 - x0);
+      }
+
+      /* Step by spans/columns.  As it happens, the swizzle bit flips
+       * at each step so we don't need to calculate it explicitly.
+       */
+      for (x = x1; x < x2; x += ytile_span) {
+         ytile_to_linear_span4(dst + x, dst_pitch, src + ((xo + yo) ^ swizzle),
+                               mem_copy_align16);
+         xo += bytes_per_column;
+         swizzle ^= swizzle_bit;
+      }
+
+      if (x2 != x3) {
+         mem_copy_align16(dst + x2 + 0 * dst_pitch, src + ((xo + yo + 0 * column_width) ^ swizzle), x3 - x2);
+         mem_copy_align16(dst + x2 + 1 * dst_pitch, src + ((xo + yo + 1 * column_width) ^ swizzle), x3 - x2);
+         mem_copy_align16(dst + x2 + 2 * dst_pitch, src + ((xo + yo + 2 * column_width) ^ swizzle), x3 - x2);
+         mem_copy_align16(dst + x2 + 3 * dst_pitch, src + ((xo + yo + 3 * column_width) ^ swizzle), x3 - x2);
+      }
+
+      dst += 4 * dst_pitch;
+   }
+
+   if (y2 != y3) {
+      for (yo = y2 * column_width; yo < y3 * column_width; yo += column_width) {
+         uint32_t xo = xo1;
+         uint32_t swizzle = swizzle1;
+
+         mem_copy(dst + x0, src + ((xo0 + yo) ^ swizzle0), x1 - x0);
+
+         /* Step by spans/columns.  As it happens, the swizzle bit flips
+          * at each step so we don't need to calculate it explicitly.
+          */
+         for (x = x1; x < x2; x += ytile_span) {
+            mem_copy_align16(dst + x, src + ((xo + yo) ^ swizzle), ytile_span);
+            xo += bytes_per_column;
+            swizzle ^= swizzle_bit;
+         }
+
+         mem_copy_align16(dst + x2, src + ((xo + yo) ^ swizzle), x3 - x2);
+
+         dst += dst_pitch;
+      }
+   }
+}
+
+
+/**
+ * Offset of the byte at (x, y) in a W tile.
+ *
+ * W tiles are made of 8x8 blocks of 64 bytes stacked in columns of eight,
+ * and the bytes of each block are interleaved: bits 0, 2 and 4 of the offset
+ * within the block come from x, bits 1, 3 and 5 from y.  Swizzling flips bit
+ * 6 of the offset with bit 9, which only swaps whole blocks.
+ */
+static inline uint32_t
+wtile_offset(uint32_t x, uint32_t y, uint32_t swizzle_bit)
+{
+   uint32_t offset = (x / 8) * 512 + (y / 8) * 64 +
+                     ((x & 1) | (y & 1) << 1 | (x & 2) << 1 |
+                      (y & 2) << 2 | (x & 4) << 2 | (y & 4) << 3);
+
+   return offset ^ ((offset >> 3) & swizzle_bit);
+}
+
+#ifdef __AVX2__
+/* Moves the left halves of four 8-byte rows to the low 128-bit lane and the
+ * right halves to the high one, and back.
+ */
+#define wtile_split_halves() _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7)
+#define wtile_join_halves() _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)
+
+/* Interleaves the bytes of the 4x4 sub-blocks in each lane, by swapping bits
+ * 1 and 2 of their index, and back.
+ */
+#define wtile_interleave()                                               \
+   _mm256_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15, \
+                    0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15)
+#endif
+
+/**
+ * Copy an 8x8 block from linear to a W tile.
+ */
+static inline void
+linear_to_wtile_block(char *dst, const char *src, int32_t src_pitch)
+{
+#ifdef __AVX2__
+   for (unsigned i = 0; i < 2; i++) {
+      const char *rows = src + 4 * i * src_pitch;
+      __m128i rows01 =
+         _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)rows),
+                            _mm_loadl_epi64((const __m128i *)
+                                            (rows + src_pitch)));
+      __m128i rows23 =
+         _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)
+                                            (rows + 2 * src_pitch)),
+                            _mm_loadl_epi64((const __m128i *)
+                                            (rows + 3 * src_pitch)));
+      __m256i block =
+         _mm256_inserti128_si256(_mm256_castsi128_si256(rows01), rows23, 1);
+
+      block = _mm256_permutevar8x32_epi32(block, wtile_split_halves());
+      block = _mm256_shuffle_epi8(block, wtile_interleave());
+      _mm256_storeu_si256((__m256i *)(dst + 32 * i), block);
+   }
+#else
+   for (uint32_t y = 0; y < 8; y++) {
+      for (uint32_t x = 0; x < 8; x++)
+         dst[wtile_offset(x, y, 0)] = src[(ptrdiff_t)y * src_pitch + x];
+   }
+#endif
+}
+
+/**
+ * Copy an 8x8 block from a W tile to linear.
+ */
+static inline void
+wtile_to_linear_block(char *dst, int32_t dst_pitch, const char *src)
+{
+#ifdef __AVX2__
+   for (unsigned i = 0; i < 2; i++) {
+      char *rows = dst + 4 * i * dst_pitch;
+      __m256i block = _mm256_loadu_si256((const __m256i *)(src + 32 * i));
+
+      block = _mm256_shuffle_epi8(block, wtile_interleave());
+      block = _mm256_permutevar8x32_epi32(block, wtile_join_halves());
+
+      __m128i rows01 = _mm256_castsi256_si128(block);
+      __m128i rows23 = _mm256_extracti128_si256(block, 1);
+      _mm_storel_epi64((__m128i *)rows, rows01);
+      _mm_storel_epi64((__m128i *)(rows + dst_pitch),
+                       _mm_unpackhi_epi64(rows01, rows01));
+      _mm_storel_epi64((__m128i *)(rows + 2 * dst_pitch), rows23);
+      _mm_storel_epi64((__m128i *)(rows + 3 * dst_pitch),
+                       _mm_unpackhi_epi64(rows23, rows23));
+   }
+#else
+   for (uint32_t y = 0; y < 8; y++) {
+      for (uint32_t x = 0; x < 8; x++)
+         dst[(ptrdiff_t)y * dst_pitch + x] = src[wtile_offset(x, y, 0)];
+   }
+#endif
+}
+
+/**
+ * Copy the rectangle [x0,x1) x [y0,y1) from linear to a W tile, one byte at
+ * a time.
+ */
+static inline void
+linear_to_wtiled_bytes(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                       char *dst, const char *src,
+                       int32_t src_pitch,
+                       uint32_t swizzle_bit)
+{
+   for (uint32_t y = y0; y < y1; y++) {
+      for (uint32_t x = x0; x < x1; x++) {
+         dst[wtile_offset(x, y, swizzle_bit)] =
+            src[(ptrdiff_t)y * src_pitch + x];
+      }
+   }
+}
+
+/**
+ * Copy the rectangle [x0,x1) x [y0,y1) from a W tile to linear, one byte at
+ * a time.
+ */
+static inline void
+wtiled_to_linear_bytes(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                       char *dst, const char *src,
+                       int32_t dst_pitch,
+                       uint32_t swizzle_bit)
+{
+   for (uint32_t y = y0; y < y1; y++) {
+      for (uint32_t x = x0; x < x1; x++) {
+         dst[(ptrdiff_t)y * dst_pitch + x] =
+            src[wtile_offset(x, y, swizzle_bit)];
+      }
+   }
+}
+
+/**
+ * Copy texture data from linear to W tile layout.
+ *
+ * \copydoc tile_copy_fn
+ *
+ * W tiles only hold 8-bit stencil data, so this always does a plain copy.
+ * The rows in [y1,y2) are copied by whole 8x8 blocks between x1 and x2 and
+ * the rest one byte at a time.
+ */
+static FLATTEN void
+linear_to_wtiled(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                 uint32_t y0, uint32_t y3,
+                 char *dst, const char *src,
+                 int32_t src_pitch,
+                 uint32_t swizzle_bit,
+                 mem_copy_fn mem_copy)
+{
+   uint32_t y1 = MIN2(y3, ALIGN_UP(y0, 8));
+   uint32_t y2 = MAX2(y1, ALIGN_DOWN(y3, 8));
+   uint32_t x, y;
+
+   assert(mem_copy == memcpy);
+
+   linear_to_wtiled_bytes(x0, x3, y0, y1, dst, src, src_pitch, swizzle_bit);
+
+   for (y = y1; y < y2; y += 8) {
+      linear_to_wtiled_bytes(x0, x1, y, y + 8,
+                             dst, src, src_pitch, swizzle_bit);
+
+      for (x = x1; x < x2; x += wtile_span) {
+         linear_to_wtile_block(dst + wtile_offset(x, y, swizzle_bit),
+                               src + (ptrdiff_t)y * src_pitch + x, src_pitch);
+      }
+
+      linear_to_wtiled_bytes(x2, x3, y, y + 8,
+                             dst, src, src_pitch, swizzle_bit);
+   }
+
+   linear_to_wtiled_bytes(x0, x3, y2, y3, dst, src, src_pitch, swizzle_bit);
+}
+
+/**
+ * Copy texture data from W tile layout to linear.
+ *
+ * \copydoc tile_copy_fn
+ *
+ * \sa linear_to_wtiled
+ */
+static FLATTEN void
+wtiled_to_linear(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                 uint32_t y0, uint32_t y3,
+                 char *dst, const char *src,
+                 int32_t dst_pitch,
+                 uint32_t swizzle_bit,
+                 mem_copy_fn mem_copy)
+{
+   uint32_t y1 = MIN2(y3, ALIGN_UP(y0, 8));
+   uint32_t y2 = MAX2(y1, ALIGN_DOWN(y3, 8));
+   uint32_t x, y;
+
+   assert(mem_copy == memcpy);
+
+   wtiled_to_linear_bytes(x0, x3, y0, y1, dst, src, dst_pitch, swizzle_bit);
+
+   for (y = y1; y < y2; y += 8) {
+      wtiled_to_linear_bytes(x0, x1, y, y + 8,
+                             dst, src, dst_pitch, swizzle_bit);
+
+      for (x = x1; x < x2; x += wtile_span) {
+         wtile_to_linear_block(dst + (ptrdiff_t)y * dst_pitch + x, dst_pitch,
+                               src + wtile_offset(x, y, swizzle_bit));
+      }
+
+      wtiled_to_linear_bytes(x2, x3, y, y + 8,
+                             dst, src, dst_pitch, swizzle_bit);
+   }
+
+   wtiled_to_linear_bytes(x0, x3, y2, y3, dst, src, dst_pitch, swizzle_bit);
+}
+
+/**
+ * Copy texture data from linear to X tile layout, faster.
+ *
+ * Same as \ref linear_to_xtiled but faster, because it passes constant
+ * parameters for common cases, allowing the compiler to inline code
+ * optimized for those cases.
+ *
+ * \copydoc tile_copy_fn
+ */
+static FLATTEN void
+linear_to_xtiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                        uint32_t y0, uint32_t y1,
+                        char *dst, const char *src,
+                        int32_t src_pitch,
+                        uint32_t swizzle_bit,
+                        mem_copy_fn mem_copy)
+{
+   if (x0 == 0 && x3 == xtile_width && y0 == 0 && y1 == xtile_height) {
+      if (mem_copy == memcpy)
+         return linear_to_xtiled(0, 0, xtile_width, xtile_width, 0, xtile_height,
+                                 dst, src, src_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return linear_to_xtiled(0, 0, xtile_width, xtile_width, 0, xtile_height,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_dst);
+      else
+         unreachable("not reached");
+   } else {
+      if (mem_copy == memcpy)
+         return linear_to_xtiled(x0, x1, x2, x3, y0, y1,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return linear_to_xtiled(x0, x1, x2, x3, y0, y1,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_dst);
+      else
+         unreachable("not reached");
+   }
+   linear_to_xtiled(x0, x1, x2, x3, y0, y1,
+                    dst, src, src_pitch, swizzle_bit, mem_copy, mem_copy);
+}
+
+/**
+ * Copy texture data from linear to Y tile layout, faster.
+ *
+ * Same as \ref linear_to_ytiled but faster, because it passes constant
+ * parameters for common cases, allowing the compiler to inline code
+ * optimized for those cases.
+ *
+ * \copydoc tile_copy_fn
+ */
+static FLATTEN void
+linear_to_ytiled_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                        uint32_t y0, uint32_t y1,
+                        char *dst, const char *src,
+                        int32_t src_pitch,
+                        uint32_t swizzle_bit,
+                        mem_copy_fn mem_copy)
+{
+   if (x0 == 0 && x3 == ytile_width && y0 == 0 && y1 == ytile_height) {
+      if (mem_copy == memcpy)
+         return linear_to_ytiled(0, 0, ytile_width, ytile_width, 0, ytile_height,
+                                 dst, src, src_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return linear_to_ytiled(0, 0, ytile_width, ytile_width, 0, ytile_height,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_dst);
+      else
+         unreachable("not reached");
+   } else {
+      if (mem_copy == memcpy)
+         return linear_to_ytiled(x0, x1, x2, x3, y0, y1,
+                                 dst, src, src_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return linear_to_ytiled(x0, x1, x2, x3, y0, y1,
+                                 dst, src, src_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_dst);
+      else
+         unreachable("not reached");
+   }
+   linear_to_ytiled(x0, x1, x2, x3, y0, y1,
+                    dst, src, src_pitch, swizzle_bit, mem_copy, mem_copy);
+}
+
+/**
+ * Copy texture data from X tile layout to linear, faster.
+ *
+ * Same as \ref xtile_to_linear but faster, because it passes constant
+ * parameters for common cases, allowing the compiler to inline code
+ * optimized for those cases.
+ *
+ * \copydoc tile_copy_fn
+ */
+static FLATTEN void
+xtiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                        uint32_t y0, uint32_t y1,
+                        char *dst, const char *src,
+                        int32_t dst_pitch,
+                        uint32_t swizzle_bit,
+                        mem_copy_fn mem_copy)
+{
+   if (x0 == 0 && x3 == xtile_width && y0 == 0 && y1 == xtile_height) {
+      if (mem_copy == memcpy)
+         return xtiled_to_linear(0, 0, xtile_width, xtile_width, 0, xtile_height,
+                                 dst, src, dst_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return xtiled_to_linear(0, 0, xtile_width, xtile_width, 0, xtile_height,
+                                 dst, src, dst_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_src);
+      else
+         unreachable("not reached");
+   } else {
+      if (mem_copy == memcpy)
+         return xtiled_to_linear(x0, x1, x2, x3, y0, y1,
+                                 dst, src, dst_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return xtiled_to_linear(x0, x1, x2, x3, y0, y1,
+                                 dst, src, dst_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_src);
+      else
+         unreachable("not reached");
+   }
+   xtiled_to_linear(x0, x1, x2, x3, y0, y1,
+                    dst, src, dst_pitch, swizzle_bit, mem_copy, mem_copy);
+}
+
+/**
+ * Copy texture data from Y tile layout to linear, faster.
+ *
+ * Same as \ref ytile_to_linear but faster, because it passes constant
+ * parameters for common cases, allowing the compiler to inline code
+ * optimized for those cases.
+ *
+ * \copydoc tile_copy_fn
+ */
+static FLATTEN void
+ytiled_to_linear_faster(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3,
+                        uint32_t y0, uint32_t y1,
+                        char *dst, const char *src,
+                        int32_t dst_pitch,
+                        uint32_t swizzle_bit,
+                        mem_copy_fn mem_copy)
+{
+   if (x0 == 0 && x3 == ytile_width && y0 == 0 && y1 == ytile_height) {
+      if (mem_copy == memcpy)
+         return ytiled_to_linear(0, 0, ytile_width, ytile_width, 0, ytile_height,
+                                 dst, src, dst_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return ytiled_to_linear(0, 0, ytile_width, ytile_width, 0, ytile_height,
+                                 dst, src, dst_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_src);
+      else
+         unreachable("not reached");
+   } else {
+      if (mem_copy == memcpy)
+         return ytiled_to_linear(x0, x1, x2, x3, y0, y1,
+                                 dst, src, dst_pitch, swizzle_bit, memcpy, memcpy);
+      else if (mem_copy == rgba8_copy)
+         return ytiled_to_linear(x0, x1, x2, x3, y0, y1,
+                                 dst, src, dst_pitch, swizzle_bit,
+                                 rgba8_copy, rgba8_copy_aligned_src);
+      else
+         unreachable("not reached");
+   }
+   ytiled_to_linear(x0, x1, x2, x3, y0, y1,
+                    dst, src, dst_pitch, swizzle_bit, mem_copy, mem_copy);
+}
+
+static mem_copy_fn
+choose_copy_function(enum isl_memcpy_type copy_type)
+{
+   switch (copy_type) {
+   case ISL_MEMCPY:
+      return memcpy;
+   case ISL_MEMCPY_BGRA8:
+      return rgba8_copy;
+   }
+
+   unreachable("invalid copy type");
+}
+
+/**
+ * Copy from linear to tiled texture.
+ *
+ * Divide the region given by X range [xt1, xt2) and Y range [yt1, yt2) into
+ * pieces that do not cross tile boundaries and copy each piece with a tile
+ * copy function (\ref tile_copy_fn).
+ * The X range is in bytes, i.e. pixels * bytes-per-pixel.
+ * The Y range is in pixels (i.e. unitless).
+ * 'dst' is the address of (0, 0) in the destination tiled texture.
+ * 'src' is the address of (xt1, yt1) in the source linear texture.
+ */
+static void
+linear_to_tiled(uint32_t xt1, uint32_t xt2,
+                uint32_t yt1, uint32_t yt2,
+                char *dst, const char *src,
+                uint32_t dst_pitch, int32_t src_pitch,
+                bool has_swizzling,
+                enum isl_tiling tiling,
+                enum isl_memcpy_type copy_type)
+{
+   tile_copy_fn tile_copy;
+   uint32_t xt0, xt3;
+   uint32_t yt0, yt3;
+   uint32_t xt, yt;
+   uint32_t tw, th, span;
+   uint32_t swizzle_bit = has_swizzling ? 1<<6 : 0;
+   mem_copy_fn mem_copy = choose_copy_function(copy_type);
+
+   if (tiling == ISL_TILING_X) {
+      tw = xtile_width;
+      th = xtile_height;
+      span = xtile_span;
+      tile_copy = linear_to_xtiled_faster;
+   } else if (tiling == ISL_TILING_Y0) {
+      tw = ytile_width;
+      th = ytile_height;
+      span = ytile_span;
+      tile_copy = linear_to_ytiled_faster;
+   } else if (tiling == ISL_TILING_W) {
+      tw = wtile_width;
+      th = wtile_height;
+      span = wtile_span;
+      tile_copy = linear_to_wtiled;
+
+      /* W tiles are stored like Y tiles, as 32 rows of 128 bytes, and the
+       * pitch of W-tiled surfaces counts them that way.  A row of W tiles
+       * is thus 64 rows of half the pitch.
+       */
+      dst_pitch /= 2;
+   } else {
+      unreachable("unsupported tiling");
+   }
+
+   /* Round out to tile boundaries. */
+   xt0 = ALIGN_DOWN(xt1, tw);
+   xt3 = ALIGN_UP  (xt2, tw);
+   yt0 = ALIGN_DOWN(yt1, th);
+   yt3 = ALIGN_UP  (yt2, th);
+
+   /* Loop over all tiles to which we have something to copy.
+    * 'xt' and 'yt' are the origin of the destination tile, whether copying
+    * copying a full or partial tile.
+    * tile_copy() copies one tile or partial tile.
+    * Looping x inside y is the faster memory access pattern.
+    */
+   for (yt = yt0; yt < yt3; yt += th) {
+      for (xt = xt0; xt < xt3; xt += tw) {
+         /* The area to update is [x0,x3) x [y0,y1).
+          * May not want the whole tile, hence the min and max.
+          */
+         uint32_t x0 = MAX2(xt1, xt);
+         uint32_t y0 = MAX2(yt1, yt);
+         uint32_t x3 = MIN2(xt2, xt + tw);
+         uint32_t y1 = MIN2(yt2, yt + th);
+
+         /* [x0,x3) is split into [x0,x1), [x1,x2), [x2,x3) such that
+          * the middle interval is the longest span-aligned part.
+          * The sub-ranges could be empty.
+          */
+         uint32_t x1, x2;
+         x1 = ALIGN_UP(x0, span);
+         if (x1 > x3)
+            x1 = x2 = x3;
+         else
+            x2 = ALIGN_DOWN(x3, span);
+
+         assert(x0 <= x1 && x1 <= x2 && x2 <= x3);
+         assert(x1 - x0 < span && x3 - x2 < span);
+         assert(x3 - x0 <= tw);
+         assert((x2 - x1) % span == 0);
+
+         /* Translate by (xt,yt) for single-tile copier. */
+         tile_copy(x0-xt, x1-xt, x2-xt, x3-xt,
+                   y0-yt, y1-yt,
+                   dst + (ptrdiff_t)xt * th  +  (ptrdiff_t)yt        * dst_pitch,
+                   src + (ptrdiff_t)xt - xt1 + ((ptrdiff_t)yt - yt1) * src_pitch,
+                   src_pitch,
+                   swizzle_bit,
+                   mem_copy);
+      }
+   }
+}
+
+/**
+ * Copy from tiled to linear texture.
+ *
+ * Divide the region given by X range [xt1, xt2) and Y range [yt1, yt2) into
+ * pieces that do not cross tile boundaries and copy each piece with a tile
+ * copy function (\ref tile_copy_fn).
+ * The X range is in bytes, i.e. pixels * bytes-per-pixel.
+ * The Y range is in pixels (i.e. unitless).
+ * 'dst' is the address of (xt1, yt1) in the destination linear texture.
+ * 'src' is the address of (0, 0) in the source tiled texture.
+ */
+static void
+tiled_to_linear(uint32_t xt1, uint32_t xt2,
+                uint32_t yt1, uint32_t yt2,
+                char *dst, const char *src,
+                int32_t dst_pitch, uint32_t src_pitch,
+                bool has_swizzling,
+                enum isl_tiling tiling,
+                enum isl_memcpy_type copy_type)
+{
+   tile_copy_fn tile_copy;
+   uint32_t xt0, xt3;
+   uint32_t yt0, yt3;
+   uint32_t xt, yt;
+   uint32_t tw, th, span;
+   uint32_t swizzle_bit = has_swizzling ? 1<<6 : 0;
+   mem_copy_fn mem_copy = choose_copy_function(copy_type);
+
+   if (tiling == ISL_TILING_X) {
+      tw = xtile_width;
+      th = xtile_height;
+      span = xtile_span;
+      tile_copy = xtiled_to_linear_faster;
+   } else if (tiling == ISL_TILING_Y0) {
+      tw = ytile_width;
+      th = ytile_height;
+      span = ytile_span;
+      tile_copy = ytiled_to_linear_faster;
+   } else if (tiling == ISL_TILING_W) {
+      tw = wtile_width;
+      th = wtile_height;
+      span = wtile_span;
+      tile_copy = wtiled_to_linear;
+
+      /* See linear_to_tiled(). */
+      src_pitch /= 2;
+   } else {
+      unreachable("unsupported tiling");
+   }
+
+   /* Round out to tile boundaries. */
+   xt0 = ALIGN_DOWN(xt1, tw);
+   xt3 = ALIGN_UP  (xt2, tw);
+   yt0 = ALIGN_DOWN(yt1, th);
+   yt3 = ALIGN_UP  (yt2, th);
+
+   /* Loop over all tiles to which we have something to copy.
+    * 'xt' and 'yt' are the origin of the destination tile, whether copying
+    * copying a full or partial tile.
+    * tile_copy() copies one tile or partial tile.
+    * Looping x inside y is the faster memory access pattern.
+    */
+   for (yt = yt0; yt < yt3; yt += th) {
+      for (xt = xt0; xt < xt3; xt += tw) {
+         /* The area to update is [x0,x3) x [y0,y1).
+          * May not want the whole tile, hence the min and max.
+          */
+         uint32_t x0 = MAX2(xt1, xt);
+         uint32_t y0 = MAX2(yt1, yt);
+         uint32_t x3 = MIN2(xt2, xt + tw);
+         uint32_t y1 = MIN2(yt2, yt + th);
+
+         /* [x0,x3) is split into [x0,x1), [x1,x2), [x2,x3) such that
+          * the middle interval is the longest span-aligned part.
+          * The sub-ranges could be empty.
+          */
+         uint32_t x1, x2;
+         x1 = ALIGN_UP(x0, span);
+         if (x1 > x3)
+            x1 = x2 = x3;
+         else
+            x2 = ALIGN_DOWN(x3, span);
+
+         assert(x0 <= x1 && x1 <= x2 && x2 <= x3);
+         assert(x1 - x0 < span && x3 - x2 < span);
+         assert(x3 - x0 <= tw);
+         assert((x2 - x1) % span == 0);
+
+         /* Translate by (xt,yt) for single-tile copier. */
+         tile_copy(x0-xt, x1-xt, x2-xt, x3-xt,
+                   y0-yt, y1-yt,
+                   dst + (ptrdiff_t)xt - xt1 + ((ptrdiff_t)yt - yt1) * dst_pitch,
+                   src + (ptrdiff_t)xt * th  +  (ptrdiff_t)yt        * src_pitch,
+                   dst_pitch,
+                   swizzle_bit,
+                   mem_copy);
+      }
+   }
+}
@@ -0,0 +1,438 @@
+/*
+ * Copyright 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that surfaces coming out of isl_device::surf_cache are identical to
+ * freshly computed ones, including when the cache is shared between devices
+ * and threads, overflows, or sees a device info reused for another device.
+ * The surfaces come from a stream of descriptors resembling what an
+ * application creates (render targets, depth buffers, mipmapped and
+ * compressed textures, cube maps...), a few of them being much more
+ * frequent than the others.
+ *
+ * With TEST_BENCH set in the environment, it also compares the cost of
+ * isl_surf_init() with and without the cache on that stream.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c11/threads.h"
+#include "dev/gen_device_info.h"
+#include "isl/isl.h"
+#include "util/os_time.h"
+
+// An asssert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+#define MAX_DESCS 1024
+#define STREAM_LENGTH (1 << 16)
+#define NUM_THREADS 4
+
+static struct isl_surf_init_info descs[MAX_DESCS];
+static unsigned num_descs;
+
+/* Indices into descs, in the order the surfaces get created. */
+static unsigned stream[STREAM_LENGTH];
+
+static unsigned
+num_levels(uint32_t width, uint32_t height)
+{
+   unsigned levels = 1;
+   while ((width | height) >> levels)
+      levels++;
+   return levels;
+}
+
+static void
+add_desc(enum isl_surf_dim dim, enum isl_format format,
+         uint32_t width, uint32_t height, uint32_t depth,
+         uint32_t levels, uint32_t array_len, uint32_t samples,
+         isl_surf_usage_flags_t usage, isl_tiling_flags_t tiling_flags)
+{
+   t_assert(num_descs < MAX_DESCS);
+   descs[num_descs++] = (struct isl_surf_init_info) {
+      .dim = dim,
+      .format = format,
+      .width = width,
+      .height = height,
+      .depth = depth,
+      .levels = levels,
+      .array_len = array_len,
+      .samples = samples,
+      .usage = usage,
+      .tiling_flags = tiling_flags,
+   };
+}
+
+static void
+build_descs(void)
+{
+   static const struct { uint32_t w, h; } screens[] = {
+      { 1920, 1080 }, { 1280, 720 }, { 2560, 1440 }, { 3840, 2160 },
+      { 960, 540 }, { 640, 360 }, { 1366, 768 },
+   };
+   static const enum isl_format rt_formats[] = {
+      ISL_FORMAT_B8G8R8A8_UNORM, ISL_FORMAT_R8G8B8A8_UNORM,
+      ISL_FORMAT_R16G16B16A16_FLOAT, ISL_FORMAT_R10G10B10A2_UNORM,
+      ISL_FORMAT_R11G11B10_FLOAT,
+   };
+   static const enum isl_format depth_formats[] = {
+      ISL_FORMAT_R24_UNORM_X8_TYPELESS, ISL_FORMAT_R32_FLOAT,
+      ISL_FORMAT_R16_UNORM,
+   };
+   static const enum isl_format tex_formats[] = {
+      ISL_FORMAT_R8G8B8A8_UNORM, ISL_FORMAT_R8G8B8A8_UNORM_SRGB,
+      ISL_FORMAT_BC1_UNORM, ISL_FORMAT_BC3_UNORM, ISL_FORMAT_BC7_UNORM,
+      ISL_FORMAT_R8_UNORM, ISL_FORMAT_R8G8_UNORM,
+   };
+   const isl_surf_usage_flags_t rt_usage =
+      ISL_SURF_USAGE_RENDER_TARGET_BIT | ISL_SURF_USAGE_TEXTURE_BIT;
+   const isl_surf_usage_flags_t depth_usage =
+      ISL_SURF_USAGE_DEPTH_BIT | ISL_SURF_USAGE_TEXTURE_BIT;
+
+   /* Render targets and depth buffers at screen size, with and without
+    * multisampling.
+    */
+   for (unsigned s = 0; s < ARRAY_SIZE(screens); s++) {
+      for (unsigned samples = 1; samples <= 8; samples *= 2) {
+         for (unsigned f = 0; f < ARRAY_SIZE(rt_formats); f++) {
+            add_desc(ISL_SURF_DIM_2D, rt_formats[f],
+                     screens[s].w, screens[s].h, 1, 1, 1, samples,
+                     rt_usage, ISL_TILING_ANY_MASK);
+         }
+         for (unsigned f = 0; f < ARRAY_SIZE(depth_formats); f++) {
+            add_desc(ISL_SURF_DIM_2D, depth_formats[f],
+                     screens[s].w, screens[s].h, 1, 1, 1, samples,
+                     depth_usage, ISL_TILING_Y0_BIT);
+         }
+         add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_R8_UINT,
+                  screens[s].w, screens[s].h, 1, 1, 1, samples,
+                  ISL_SURF_USAGE_STENCIL_BIT, ISL_TILING_W_BIT);
+      }
+
+      /* Staging buffers for readback. */
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_B8G8R8A8_UNORM,
+               screens[s].w, screens[s].h, 1, 1, 1, 1,
+               ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_LINEAR_BIT);
+   }
+
+   /* Shadow maps. */
+   for (uint32_t size = 512; size <= 4096; size *= 2) {
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_R32_FLOAT, size, size, 1,
+               1, 1, 1, depth_usage, ISL_TILING_Y0_BIT);
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_R32_FLOAT, size, size, 1,
+               1, 4, 1, depth_usage, ISL_TILING_Y0_BIT);
+   }
+
+   /* Mipmapped textures, square and not, plain and array. */
+   for (uint32_t w = 16; w <= 4096; w *= 2) {
+      for (unsigned f = 0; f < ARRAY_SIZE(tex_formats); f++) {
+         add_desc(ISL_SURF_DIM_2D, tex_formats[f], w, w, 1,
+                  num_levels(w, w), 1, 1,
+                  ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_ANY_MASK);
+         add_desc(ISL_SURF_DIM_2D, tex_formats[f], w, w / 2, 1,
+                  num_levels(w, w / 2), 1, 1,
+                  ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_ANY_MASK);
+         add_desc(ISL_SURF_DIM_2D, tex_formats[f], w, w, 1,
+                  1, 1, 1,
+                  ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_ANY_MASK);
+      }
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_R8G8B8A8_UNORM, w, w, 1,
+               num_levels(w, w), 16, 1,
+               ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_ANY_MASK);
+   }
+
+   /* Cube maps and volumes. */
+   for (uint32_t w = 16; w <= 1024; w *= 2) {
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_R16G16B16A16_FLOAT, w, w, 1,
+               num_levels(w, w), 6, 1,
+               ISL_SURF_USAGE_TEXTURE_BIT | ISL_SURF_USAGE_CUBE_BIT,
+               ISL_TILING_ANY_MASK);
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_BC1_UNORM, w, w, 1,
+               num_levels(w, w), 6, 1,
+               ISL_SURF_USAGE_TEXTURE_BIT | ISL_SURF_USAGE_CUBE_BIT,
+               ISL_TILING_ANY_MASK);
+   }
+   for (uint32_t w = 16; w <= 256; w *= 2) {
+      add_desc(ISL_SURF_DIM_3D, ISL_FORMAT_R8G8B8A8_UNORM, w, w, w,
+               num_levels(w, w), 1, 1,
+               ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_ANY_MASK);
+   }
+
+   /* Texture atlases and UI elements of odd sizes. */
+   for (unsigned i = 0; i < 64; i++) {
+      uint32_t w = 1 + rand() % 1024, h = 1 + rand() % 1024;
+      add_desc(ISL_SURF_DIM_2D, ISL_FORMAT_R8G8B8A8_UNORM, w, h, 1,
+               1, 1, 1, ISL_SURF_USAGE_TEXTURE_BIT, ISL_TILING_ANY_MASK);
+   }
+}
+
+/* A few surfaces, like the ones blitted through every frame, are created
+ * much more often than the others: pick them following Zipf's law.
+ */
+static void
+build_stream(void)
+{
+   double total = 0.0;
+   for (unsigned i = 0; i < num_descs; i++)
+      total += 1.0 / (i + 1);
+
+   /* Shuffle the descriptors so that the frequent ones aren't all render
+    * targets.
+    */
+   unsigned order[MAX_DESCS];
+   for (unsigned i = 0; i < num_descs; i++)
+      order[i] = i;
+   for (unsigned i = num_descs - 1; i > 0; i--) {
+      unsigned j = rand() % (i + 1);
+      unsigned tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+   }
+
+   for (unsigned s = 0; s < STREAM_LENGTH; s++) {
+      double r = total * rand() / RAND_MAX;
+      unsigned i = 0;
+      while (i < num_descs - 1 && (r -= 1.0 / (i + 1)) > 0.0)
+         i++;
+      stream[s] = order[i];
+   }
+}
+
+static bool
+surf_equal(const struct isl_surf *a, const struct isl_surf *b)
+{
+   return a->dim == b->dim &&
+          a->dim_layout == b->dim_layout &&
+          a->msaa_layout == b->msaa_layout &&
+          a->tiling == b->tiling &&
+          a->format == b->format &&
+          memcmp(&a->image_alignment_el, &b->image_alignment_el,
+                 sizeof(a->image_alignment_el)) == 0 &&
+          memcmp(&a->logical_level0_px, &b->logical_level0_px,
+                 sizeof(a->logical_level0_px)) == 0 &&
+          memcmp(&a->phys_level0_sa, &b->phys_level0_sa,
+                 sizeof(a->phys_level0_sa)) == 0 &&
+          a->levels == b->levels &&
+          a->samples == b->samples &&
+          a->size == b->size &&
+          a->alignment == b->alignment &&
+          a->row_pitch == b->row_pitch &&
+          a->array_pitch_el_rows == b->array_pitch_el_rows &&
+          a->array_pitch_span == b->array_pitch_span &&
+          a->usage == b->usage;
+}
+
+struct expected {
+   bool ok;
+   struct isl_surf surf;
+};
+
+static struct expected expected[MAX_DESCS];
+
+static void
+compute_expected(const struct isl_device *dev)
+{
+   t_assert(dev->surf_cache == NULL);
+   for (unsigned i = 0; i < num_descs; i++)
+      expected[i].ok = isl_surf_init_s(dev, &expected[i].surf, &descs[i]);
+}
+
+static void
+check_desc(const struct isl_device *dev, unsigned i)
+{
+   struct isl_surf surf;
+   bool ok = isl_surf_init_s(dev, &surf, &descs[i]);
+   t_assert(ok == expected[i].ok);
+   if (ok)
+      t_assert(surf_equal(&surf, &expected[i].surf));
+}
+
+struct thread_data {
+   const struct isl_device *dev;
+   unsigned first;
+};
+
+static int
+check_thread(void *_data)
+{
+   const struct thread_data *data = _data;
+
+   for (unsigned s = 0; s < STREAM_LENGTH; s++)
+      check_desc(data->dev, stream[(data->first + s) % STREAM_LENGTH]);
+
+   return 0;
+}
+
+static void
+test_threads(const struct isl_device *dev)
+{
+   thrd_t threads[NUM_THREADS];
+   struct thread_data data[NUM_THREADS];
+
+   for (unsigned t = 0; t < NUM_THREADS; t++) {
+      data[t] = (struct thread_data) {
+         .dev = dev,
+         .first = t * STREAM_LENGTH / NUM_THREADS,
+      };
+      t_assert(thrd_create(&threads[t], check_thread, &data[t]) ==
+               thrd_success);
+   }
+
+   for (unsigned t = 0; t < NUM_THREADS; t++)
+      thrd_join(threads[t], NULL);
+}
+
+/* Enough distinct surfaces to overflow the cache a couple of times. */
+static void
+test_overflow(const struct isl_device *dev, const struct isl_device *ref)
+{
+   for (uint32_t w = 1; w <= 10000; w++) {
+      struct isl_surf_init_info info = {
+         .dim = ISL_SURF_DIM_2D,
+         .format = ISL_FORMAT_R8G8B8A8_UNORM,
+         .width = w,
+         .height = 64,
+         .depth = 1,
+         .levels = 1,
+         .array_len = 1,
+         .samples = 1,
+         .usage = ISL_SURF_USAGE_TEXTURE_BIT,
+         .tiling_flags = ISL_TILING_ANY_MASK,
+      };
+      struct isl_surf a, b;
+      t_assert(isl_surf_init_s(dev, &a, &info));
+      t_assert(isl_surf_init_s(ref, &b, &info));
+      t_assert(surf_equal(&a, &b));
+   }
+}
+
+/* A device info that gets freed and reallocated for another device at the
+ * same address mustn't hit the entries of the first device.
+ */
+static void
+test_reused_devinfo(void)
+{
+   struct gen_device_info info;
+   struct isl_device dev, ref;
+   struct isl_surf_cache *cache = isl_surf_cache_create();
+   t_assert(cache);
+
+   t_assert(gen_get_device_info(0x0166, &info));
+   isl_device_init(&dev, &info, false);
+   dev.surf_cache = cache;
+   for (unsigned i = 0; i < num_descs; i++) {
+      struct isl_surf surf;
+      isl_surf_init_s(&dev, &surf, &descs[i]);
+   }
+
+   t_assert(gen_get_device_info(0x1912, &info));
+   isl_device_init(&ref, &info, false);
+   compute_expected(&ref);
+
+   isl_device_init(&dev, &info, false);
+   dev.surf_cache = cache;
+   for (unsigned i = 0; i < num_descs; i++)
+      check_desc(&dev, i);
+
+   isl_surf_cache_destroy(cache);
+}
+
+static double
+time_stream(const struct isl_device *dev)
+{
+   double best = 0.0;
+
+   /* Keep the best of a few runs to leave out the noise. */
+   for (unsigned i = 0; i < 5; i++) {
+      int64_t start = os_time_get_nano();
+      for (unsigned s = 0; s < STREAM_LENGTH; s++) {
+         struct isl_surf surf;
+         isl_surf_init_s(dev, &surf, &descs[stream[s]]);
+      }
+      double ns = (os_time_get_nano() - start) / (double)STREAM_LENGTH;
+      if (i == 0 || ns < best)
+         best = ns;
+   }
+
+   return best;
+}
+
+int main(void)
+{
+   struct gen_device_info skl_info, ivb_info;
+   struct isl_device skl, skl_cached, ivb, ivb_cached;
+
+   srand(1);
+
+   t_assert(gen_get_device_info(0x1912, &skl_info));
+   t_assert(gen_get_device_info(0x0166, &ivb_info));
+
+   isl_device_init(&skl, &skl_info, false);
+   isl_device_init(&ivb, &ivb_info, false);
+
+   /* Both devices share the cache, entries mustn't get mixed up. */
+   struct isl_surf_cache *cache = isl_surf_cache_create();
+   t_assert(cache);
+   skl_cached = skl;
+   skl_cached.surf_cache = cache;
+   ivb_cached = ivb;
+   ivb_cached.surf_cache = cache;
+
+   build_descs();
+   build_stream();
+
+   /* Each surface twice, missing then hitting the cache. */
+   compute_expected(&skl);
+   for (unsigned i = 0; i < num_descs; i++) {
+      check_desc(&skl_cached, i);
+      check_desc(&skl_cached, i);
+   }
+   test_threads(&skl_cached);
+
+   test_overflow(&ivb_cached, &ivb);
+   test_overflow(&skl_cached, &skl);
+
+   if (getenv("TEST_BENCH")) {
+      double uncached_ns = time_stream(&skl);
+      double cached_ns = time_stream(&skl_cached);
+      printf("%u distinct surfaces, isl_surf_init(): %.1f ns uncached, "
+             "%.1f ns cached\n", num_descs, uncached_ns, cached_ns);
+   }
+
+   isl_surf_cache_destroy(cache);
+
+   test_reused_devinfo();
+
+   return 0;
+}
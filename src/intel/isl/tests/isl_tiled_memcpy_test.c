@@ -0,0 +1,390 @@
+/*
+ * Copyright 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks the tiled memcpy of every variant (plain C, AVX2 and split across
+ * threads) against a byte-by-byte reference on random rectangles, then
+ * reports the throughput of each on a large copy.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isl/isl.h"
+#include "isl/isl_priv.h"
+#include "util/os_time.h"
+#include "util/u_queue.h"
+
+// An asssert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+enum copy_variant {
+   VARIANT_C,
+   VARIANT_AVX2,
+   VARIANT_THREADED,
+   NUM_VARIANTS,
+};
+
+static const char *variant_names[NUM_VARIANTS] = {
+   "C", "AVX2", "threaded",
+};
+
+static struct util_queue queue;
+
+static bool
+has_variant(enum copy_variant variant)
+{
+   switch (variant) {
+   case VARIANT_C:
+      return true;
+   case VARIANT_AVX2:
+#ifdef USE_AVX2
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+   case VARIANT_THREADED:
+      return util_queue_is_initialized(&queue);
+   default:
+      unreachable("bad variant");
+   }
+}
+
+static void
+copy_linear_to_tiled(enum copy_variant variant,
+                     uint32_t xt1, uint32_t xt2, uint32_t yt1, uint32_t yt2,
+                     char *dst, const char *src,
+                     uint32_t dst_pitch, int32_t src_pitch,
+                     bool has_swizzling, enum isl_tiling tiling,
+                     enum isl_memcpy_type copy_type)
+{
+   switch (variant) {
+   case VARIANT_C:
+      _isl_memcpy_linear_to_tiled(xt1, xt2, yt1, yt2, dst, src,
+                                  dst_pitch, src_pitch, has_swizzling,
+                                  tiling, copy_type);
+      break;
+#ifdef USE_AVX2
+   case VARIANT_AVX2:
+      _isl_memcpy_linear_to_tiled_avx2(xt1, xt2, yt1, yt2, dst, src,
+                                       dst_pitch, src_pitch, has_swizzling,
+                                       tiling, copy_type);
+      break;
+#endif
+   case VARIANT_THREADED:
+      isl_memcpy_linear_to_tiled(xt1, xt2, yt1, yt2, dst, src,
+                                 dst_pitch, src_pitch, has_swizzling,
+                                 tiling, copy_type, &queue);
+      break;
+   default:
+      unreachable("bad variant");
+   }
+}
+
+static void
+copy_tiled_to_linear(enum copy_variant variant,
+                     uint32_t xt1, uint32_t xt2, uint32_t yt1, uint32_t yt2,
+                     char *dst, const char *src,
+                     int32_t dst_pitch, uint32_t src_pitch,
+                     bool has_swizzling, enum isl_tiling tiling,
+                     enum isl_memcpy_type copy_type)
+{
+   switch (variant) {
+   case VARIANT_C:
+      _isl_memcpy_tiled_to_linear(xt1, xt2, yt1, yt2, dst, src,
+                                  dst_pitch, src_pitch, has_swizzling,
+                                  tiling, copy_type);
+      break;
+#ifdef USE_AVX2
+   case VARIANT_AVX2:
+      _isl_memcpy_tiled_to_linear_avx2(xt1, xt2, yt1, yt2, dst, src,
+                                       dst_pitch, src_pitch, has_swizzling,
+                                       tiling, copy_type);
+      break;
+#endif
+   case VARIANT_THREADED:
+      isl_memcpy_tiled_to_linear(xt1, xt2, yt1, yt2, dst, src,
+                                 dst_pitch, src_pitch, has_swizzling,
+                                 tiling, copy_type, &queue);
+      break;
+   default:
+      unreachable("bad variant");
+   }
+}
+
+/* Offset of byte (x, y) in a tiled surface, straight from the PRM. */
+static uint32_t
+tiled_offset(enum isl_tiling tiling, uint32_t pitch, uint32_t x, uint32_t y,
+             bool has_swizzling)
+{
+   uint32_t offset;
+
+   switch (tiling) {
+   case ISL_TILING_X:
+      offset = (y / 8) * pitch * 8 + (x / 512) * 4096 +
+               (y % 8) * 512 + x % 512;
+      if (has_swizzling)
+         offset ^= (((offset >> 9) ^ (offset >> 10)) & 1) << 6;
+      break;
+   case ISL_TILING_Y0:
+      offset = (y / 32) * pitch * 32 + (x / 128) * 4096 +
+               (x % 128 / 16) * 512 + (y % 32) * 16 + x % 16;
+      if (has_swizzling)
+         offset ^= ((offset >> 9) & 1) << 6;
+      break;
+   case ISL_TILING_W:
+      /* The pitch counts W tiles as 32 rows of 128 bytes. */
+      offset = (y / 64) * pitch * 32 + (x / 64) * 4096 +
+               (x % 64 / 8) * 512 + (y % 64 / 8) * 64 +
+               (y % 8 / 4) * 32 + (x % 8 / 4) * 16 +
+               (y % 4 / 2) * 8 + (x % 4 / 2) * 4 +
+               (y % 2) * 2 + x % 2;
+      if (has_swizzling)
+         offset ^= ((offset >> 9) & 1) << 6;
+      break;
+   default:
+      unreachable("bad tiling");
+   }
+
+   return offset;
+}
+
+static void
+tiling_size(enum isl_tiling tiling, uint32_t *tile_w, uint32_t *tile_h)
+{
+   switch (tiling) {
+   case ISL_TILING_X:  *tile_w = 512; *tile_h = 8;  break;
+   case ISL_TILING_Y0: *tile_w = 128; *tile_h = 32; break;
+   case ISL_TILING_W:  *tile_w = 64;  *tile_h = 64; break;
+   default:
+      unreachable("bad tiling");
+   }
+}
+
+static void
+fill_random(char *data, size_t size)
+{
+   static uint32_t state = 1;
+
+   /* rand() is too slow for the large surfaces. */
+   for (size_t i = 0; i < size; i++) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      data[i] = state;
+   }
+}
+
+/* Index of the byte of the other side of the copy that lands at byte x of a
+ * pixel row.
+ */
+static uint32_t
+swapped_x(uint32_t x, enum isl_memcpy_type copy_type)
+{
+   if (copy_type == ISL_MEMCPY_BGRA8 && x % 4 != 1 && x % 4 != 3)
+      return x ^ 2;
+   return x;
+}
+
+static void
+test_rect(enum copy_variant variant, enum isl_tiling tiling,
+          enum isl_memcpy_type copy_type, bool has_swizzling,
+          uint32_t tiles_x, uint32_t tiles_y,
+          uint32_t xt1, uint32_t xt2, uint32_t yt1, uint32_t yt2)
+{
+   uint32_t tile_w, tile_h;
+   tiling_size(tiling, &tile_w, &tile_h);
+
+   const uint32_t width = tiles_x * tile_w;
+   const uint32_t height = tiles_y * tile_h;
+   const uint32_t tiled_size = width * height;
+   const uint32_t tiled_pitch = tiling == ISL_TILING_W ? 2 * width : width;
+   /* Leave some padding after every linear row to check it is untouched. */
+   const uint32_t linear_pitch = xt2 - xt1 + 7;
+   const uint32_t linear_size = linear_pitch * (yt2 - yt1);
+
+   char *tiled = aligned_alloc(4096, tiled_size);
+   char *tiled_ref = malloc(tiled_size);
+   char *linear = malloc(linear_size);
+   char *linear_ref = malloc(linear_size);
+
+   /* Tiled to linear. */
+   fill_random(tiled, tiled_size);
+   fill_random(linear, linear_size);
+   memcpy(linear_ref, linear, linear_size);
+
+   for (uint32_t y = yt1; y < yt2; y++) {
+      for (uint32_t x = xt1; x < xt2; x++) {
+         uint32_t src_x = xt1 + swapped_x(x - xt1, copy_type);
+         linear_ref[(y - yt1) * linear_pitch + x - xt1] =
+            tiled[tiled_offset(tiling, tiled_pitch, src_x, y, has_swizzling)];
+      }
+   }
+
+   copy_tiled_to_linear(variant, xt1, xt2, yt1, yt2, linear, tiled,
+                        linear_pitch, tiled_pitch, has_swizzling,
+                        tiling, copy_type);
+   t_assert(memcmp(linear, linear_ref, linear_size) == 0);
+
+   /* Linear to tiled. */
+   fill_random(tiled, tiled_size);
+   fill_random(linear, linear_size);
+   memcpy(tiled_ref, tiled, tiled_size);
+
+   for (uint32_t y = yt1; y < yt2; y++) {
+      for (uint32_t x = xt1; x < xt2; x++) {
+         uint32_t src_x = swapped_x(x - xt1, copy_type);
+         tiled_ref[tiled_offset(tiling, tiled_pitch, x, y, has_swizzling)] =
+            linear[(y - yt1) * linear_pitch + src_x];
+      }
+   }
+
+   copy_linear_to_tiled(variant, xt1, xt2, yt1, yt2, tiled, linear,
+                        tiled_pitch, linear_pitch, has_swizzling,
+                        tiling, copy_type);
+   t_assert(memcmp(tiled, tiled_ref, tiled_size) == 0);
+
+   free(tiled);
+   free(tiled_ref);
+   free(linear);
+   free(linear_ref);
+}
+
+static void
+test_random_rects(enum copy_variant variant, enum isl_tiling tiling,
+                  enum isl_memcpy_type copy_type)
+{
+   const uint32_t align = copy_type == ISL_MEMCPY_BGRA8 ? 4 : 1;
+   uint32_t tile_w, tile_h;
+   tiling_size(tiling, &tile_w, &tile_h);
+
+   for (unsigned i = 0; i < 100; i++) {
+      const uint32_t tiles_x = 1 + rand() % 4;
+      const uint32_t tiles_y = 1 + rand() % 4;
+      const uint32_t width = tiles_x * tile_w / align;
+      const uint32_t height = tiles_y * tile_h;
+
+      /* Favour small and tile-aligned edges, which hit the special cases. */
+      uint32_t x1 = rand() % 2 ? rand() % width : 0;
+      uint32_t x2 = rand() % 2 ? x1 + 1 + rand() % (width - x1) : width;
+      uint32_t y1 = rand() % 2 ? rand() % height : 0;
+      uint32_t y2 = rand() % 2 ? y1 + 1 + rand() % (height - y1) : height;
+
+      test_rect(variant, tiling, copy_type, rand() % 2, tiles_x, tiles_y,
+                x1 * align, x2 * align, y1, y2);
+   }
+}
+
+/* Prints the bandwidth of each variant, only when TEST_BENCH is set so that
+ * a normal run stays quiet.
+ */
+static void
+test_throughput(enum isl_tiling tiling)
+{
+   /* A 4096x4096 RGBA8 texture. */
+   const uint32_t width = 4096 * 4;
+   const uint32_t height = 4096;
+   const size_t size = (size_t)width * height;
+   char *tiled = aligned_alloc(4096, size);
+   char *linear = aligned_alloc(64, size);
+
+   fill_random(linear, size);
+
+   for (unsigned v = 0; v < NUM_VARIANTS; v++) {
+      if (!has_variant(v))
+         continue;
+
+      double upload = 0.0, readback = 0.0;
+
+      /* Keep the best of a few runs to leave out the noise. */
+      for (unsigned i = 0; i < 3; i++) {
+         int64_t start = os_time_get_nano();
+         copy_linear_to_tiled(v, 0, width, 0, height, tiled, linear,
+                              width, width, true, tiling, ISL_MEMCPY);
+         int64_t middle = os_time_get_nano();
+         copy_tiled_to_linear(v, 0, width, 0, height, linear, tiled,
+                              width, width, true, tiling, ISL_MEMCPY);
+         int64_t end = os_time_get_nano();
+
+         double up = size / (double)(middle - start);
+         double down = size / (double)(end - middle);
+         upload = MAX2(upload, up);
+         readback = MAX2(readback, down);
+      }
+
+      printf("%c-tiled %-8s: upload %6.2f GB/s, readback %6.2f GB/s\n",
+             tiling == ISL_TILING_X ? 'X' : 'Y', variant_names[v],
+             upload, readback);
+   }
+
+   free(tiled);
+   free(linear);
+}
+
+int main(void)
+{
+   static const enum isl_tiling tilings[] = {
+      ISL_TILING_X, ISL_TILING_Y0, ISL_TILING_W,
+   };
+
+   srand(1);
+
+   util_queue_init(&queue, "isl_memcpy_test", 16, 3, 0);
+
+   for (unsigned v = 0; v < NUM_VARIANTS; v++) {
+      if (!has_variant(v))
+         continue;
+
+      for (unsigned t = 0; t < ARRAY_SIZE(tilings); t++) {
+         test_random_rects(v, tilings[t], ISL_MEMCPY);
+         if (tilings[t] != ISL_TILING_W)
+            test_random_rects(v, tilings[t], ISL_MEMCPY_BGRA8);
+
+         /* The random rectangles are too small to be split across threads,
+          * this one is large enough.
+          */
+         uint32_t tile_w, tile_h;
+         tiling_size(tilings[t], &tile_w, &tile_h);
+         test_rect(v, tilings[t], ISL_MEMCPY, true,
+                   4096 / tile_w, 1024 / tile_h, 3, 4096 - 5, 1, 1023);
+      }
+   }
+
+   if (getenv("TEST_BENCH")) {
+      test_throughput(ISL_TILING_X);
+      test_throughput(ISL_TILING_Y0);
+   }
+
+   util_queue_destroy(&queue);
+
+   return 0;
+}
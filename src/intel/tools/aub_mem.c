@@ -38,10 +38,13 @@ memfd_create(const char *name, unsigned int flags)
 }
 #endif
 
+#define AUB_MEM_CHUNK_SIZE (2 * 1024 * 1024)
+
 struct bo_map {
    struct list_head link;
    struct gen_batch_decode_bo bo;
    bool unmap_after_use;
+   bool free_after_use;
    bool ppgtt;
 };
 
@@ -55,11 +58,18 @@ struct phys_mem {
    struct rb_node node;
    uint64_t fd_offset;
    uint64_t phys_addr;
+   uint64_t epoch;
    uint8_t *data;
    const uint8_t *aub_data;
 };
 
-static void
+struct retired_page {
+   struct list_head link;
+   uint64_t fd_offset;
+   uint64_t last_epoch;
+};
+
+static struct bo_map *
 add_gtt_bo_map(struct aub_mem *mem, struct gen_batch_decode_bo bo, bool ppgtt, bool unmap_after_use)
 {
    struct bo_map *m = calloc(1, sizeof(*m));
@@ -68,6 +78,8 @@ add_gtt_bo_map(struct aub_mem *mem, struct gen_batch_decode_bo bo, bool ppgtt, b
    m->bo = bo;
    m->unmap_after_use = unmap_after_use;
    list_add(&m->link, &mem->maps);
+
+   return m;
 }
 
 void
@@ -76,6 +88,8 @@ aub_mem_clear_bo_maps(struct aub_mem *mem)
    list_for_each_entry_safe(struct bo_map, i, &mem->maps, link) {
       if (i->unmap_after_use)
          munmap((void *)i->bo.map, i->bo.size);
+      if (i->free_after_use)
+         free((void *)i->bo.map);
       list_del(&i->link);
       free(i);
    }
@@ -145,6 +159,36 @@ cmp_phys_mem(const struct rb_node *node, const void *addr)
    return cmp_uint64(mem->phys_addr, *(uint64_t *)addr);
 }
 
+static void
+alloc_phys_page(struct aub_mem *mem, struct phys_mem *pmem)
+{
+   if (util_dynarray_contains(&mem->free_pages, uint64_t)) {
+      pmem->fd_offset = util_dynarray_pop(&mem->free_pages, uint64_t);
+   } else {
+      if (mem->mem_fd_used == mem->mem_fd_len) {
+         MAYBE_UNUSED int ftruncate_res =
+            ftruncate(mem->mem_fd, mem->mem_fd_len + AUB_MEM_CHUNK_SIZE);
+         assert(ftruncate_res == 0);
+
+         uint8_t *chunk = mmap(NULL, AUB_MEM_CHUNK_SIZE,
+                               PROT_READ | PROT_WRITE, MAP_SHARED,
+                               mem->mem_fd, mem->mem_fd_len);
+         assert(chunk != MAP_FAILED);
+
+         util_dynarray_append(&mem->chunks, uint8_t *, chunk);
+         mem->mem_fd_len += AUB_MEM_CHUNK_SIZE;
+      }
+
+      pmem->fd_offset = mem->mem_fd_used;
+      mem->mem_fd_used += 4096;
+   }
+
+   uint8_t *chunk = *util_dynarray_element(&mem->chunks, uint8_t *,
+                                           pmem->fd_offset / AUB_MEM_CHUNK_SIZE);
+   pmem->data = chunk + pmem->fd_offset % AUB_MEM_CHUNK_SIZE;
+   pmem->epoch = mem->epoch;
+}
+
 static struct phys_mem *
 ensure_phys_mem(struct aub_mem *mem, uint64_t phys_addr)
 {
@@ -153,14 +197,9 @@ ensure_phys_mem(struct aub_mem *mem, uint64_t phys_addr)
    if (!node || (cmp = cmp_phys_mem(node, &phys_addr))) {
       struct phys_mem *new_mem = calloc(1, sizeof(*new_mem));
       new_mem->phys_addr = phys_addr;
-      new_mem->fd_offset = mem->mem_fd_len;
 
-      MAYBE_UNUSED int ftruncate_res = ftruncate(mem->mem_fd, mem->mem_fd_len += 4096);
-      assert(ftruncate_res == 0);
-
-      new_mem->data = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED,
-                           mem->mem_fd, new_mem->fd_offset);
-      assert(new_mem->data != MAP_FAILED);
+      alloc_phys_page(mem, new_mem);
+      memset(new_mem->data, 0, 4096);
 
       rb_tree_insert_at(&mem->mem, node, &new_mem->node, cmp > 0);
       node = &new_mem->node;
@@ -169,6 +208,24 @@ ensure_phys_mem(struct aub_mem *mem, uint64_t phys_addr)
    return rb_node_data(struct phys_mem, node, node);
 }
 
+static void
+cow_phys_mem(struct aub_mem *mem, struct phys_mem *pmem, bool overwrite)
+{
+   /* Pages allocated after the last snapshot aren't seen by any of them. */
+   if (mem->n_snapshots == 0 || pmem->epoch == mem->epoch)
+      return;
+
+   struct retired_page *retired = malloc(sizeof(*retired));
+   retired->fd_offset = pmem->fd_offset;
+   retired->last_epoch = mem->epoch - 1;
+   list_addtail(&retired->link, &mem->retired_pages);
+
+   const uint8_t *old_data = pmem->data;
+   alloc_phys_page(mem, pmem);
+   if (!overwrite)
+      memcpy(pmem->data, old_data, 4096);
+}
+
 static struct phys_mem *
 search_phys_mem(struct aub_mem *mem, uint64_t phys_addr)
 {
@@ -187,12 +244,19 @@ aub_mem_local_write(void *_mem, uint64_t address,
                     const void *data, uint32_t size)
 {
    struct aub_mem *mem = _mem;
+
+   /* Keep our own copy, the AUB data isn't guaranteed to stay around until
+    * the batch using it gets decoded.
+    */
+   void *map = malloc(size);
+   memcpy(map, data, size);
+
    struct gen_batch_decode_bo bo = {
-      .map = data,
+      .map = map,
       .addr = address,
       .size = size,
    };
-   add_gtt_bo_map(mem, bo, false, false);
+   add_gtt_bo_map(mem, bo, false, false)->free_after_use = true;
 }
 
 void
@@ -222,6 +286,7 @@ aub_mem_phys_write(void *_mem, uint64_t phys_address,
       uint64_t offset = MAX2(page, phys_address) - page;
       uint32_t size_this_page = MIN2(to_write, 4096 - offset);
       to_write -= size_this_page;
+      cow_phys_mem(mem, pmem, size_this_page == 4096);
       memcpy(pmem->data + offset, data, size_this_page);
       pmem->aub_data = data - offset;
       data = (const uint8_t *)data + size_this_page;
@@ -370,6 +435,9 @@ aub_mem_init(struct aub_mem *mem)
    memset(mem, 0, sizeof(*mem));
 
    list_inithead(&mem->maps);
+   list_inithead(&mem->retired_pages);
+   util_dynarray_init(&mem->chunks, NULL);
+   util_dynarray_init(&mem->free_pages, NULL);
 
    mem->mem_fd = memfd_create("phys memory", 0);
 
@@ -384,6 +452,9 @@ aub_mem_fini(struct aub_mem *mem)
 
    aub_mem_clear_bo_maps(mem);
 
+   list_for_each_entry_safe(struct retired_page, page, &mem->retired_pages, link)
+      free(page);
+   mem->n_snapshots = 0;
 
    rb_tree_foreach_safe(struct ggtt_entry, entry, &mem->ggtt, node) {
       rb_tree_remove(&mem->ggtt, &entry->node);
@@ -394,10 +465,43 @@ aub_mem_fini(struct aub_mem *mem)
       free(entry);
    }
 
+   util_dynarray_foreach(&mem->chunks, uint8_t *, chunk)
+      munmap(*chunk, AUB_MEM_CHUNK_SIZE);
+   util_dynarray_fini(&mem->chunks);
+   util_dynarray_fini(&mem->free_pages);
+
    close(mem->mem_fd);
    mem->mem_fd = -1;
 }
 
+uint64_t
+aub_mem_snapshot(struct aub_mem *mem)
+{
+   if (mem->n_snapshots++ == 0)
+      mem->oldest_snapshot = mem->epoch;
+
+   return mem->epoch++;
+}
+
+void
+aub_mem_release_snapshot(struct aub_mem *mem, uint64_t snapshot)
+{
+   assert(mem->n_snapshots > 0 && snapshot == mem->oldest_snapshot);
+
+   mem->n_snapshots--;
+   mem->oldest_snapshot = snapshot + 1;
+
+   /* Pages are retired in epoch order. */
+   list_for_each_entry_safe(struct retired_page, page, &mem->retired_pages, link) {
+      if (mem->n_snapshots > 0 && page->last_epoch >= mem->oldest_snapshot)
+         break;
+
+      util_dynarray_append(&mem->free_pages, uint64_t, page->fd_offset);
+      list_del(&page->link);
+      free(page);
+   }
+}
+
 struct gen_batch_decode_bo
 aub_mem_get_phys_addr_data(struct aub_mem *mem, uint64_t phys_addr)
 {
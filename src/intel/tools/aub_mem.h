@@ -29,6 +29,7 @@
 
 #include "util/list.h"
 #include "util/rb_tree.h"
+#include "util/u_dynarray.h"
 
 #include "dev/gen_device_info.h"
 #include "common/gen_decoder.h"
@@ -42,6 +43,21 @@ struct aub_mem {
 
    int mem_fd;
    off_t mem_fd_len;
+   off_t mem_fd_used;
+
+   /* mem_fd is mapped in AUB_MEM_CHUNK_SIZE chunks, pages are handed out of
+    * them in order or reused from free_pages.
+    */
+   struct util_dynarray chunks;
+   struct util_dynarray free_pages;
+
+   /* Snapshots taken with aub_mem_snapshot() and still in use, pages they
+    * can see are copied on write and retired until they are released.
+    */
+   uint64_t epoch;
+   uint64_t oldest_snapshot;
+   int n_snapshots;
+   struct list_head retired_pages;
 
    struct list_head maps;
    struct rb_tree ggtt;
@@ -53,6 +69,13 @@ void aub_mem_fini(struct aub_mem *mem);
 
 void aub_mem_clear_bo_maps(struct aub_mem *mem);
 
+/* Freezes the current memory contents for a process forked to decode them:
+ * later writes go to new pages of mem_fd instead of the ones the child
+ * process maps. Snapshots have to be released in the order they were taken.
+ */
+uint64_t aub_mem_snapshot(struct aub_mem *mem);
+void aub_mem_release_snapshot(struct aub_mem *mem, uint64_t snapshot);
+
 void aub_mem_phys_write(void *mem, uint64_t virt_address,
                         const void *data, uint32_t size);
 void aub_mem_ggtt_write(void *mem, uint64_t virt_address,
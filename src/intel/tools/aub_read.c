@@ -266,35 +266,55 @@ handle_memtrace_mem_write(struct aub_read *read, const uint32_t *p)
 }
 
 int
-aub_read_command(struct aub_read *read, const void *data, uint32_t data_len)
+aub_read_command_size(const void *data, uint32_t data_len)
 {
-   const uint32_t *p = data, *end = data + data_len, *next;
-   uint32_t h, header_length, bias;
+   const uint32_t *p = data;
+   uint32_t h, size;
 
-   assert(data_len >= 4);
+   if (data_len < 4)
+      return 0;
 
    h = *p;
-   header_length = h & 0xffff;
+   size = h & 0xffff;
 
    switch (OPCODE(h)) {
    case OPCODE_AUB:
-      bias = 2;
+      size += 2;
       break;
    case OPCODE_NEW_AUB:
-      bias = 1;
+      size += 1;
       break;
    default:
-      parse_error(read, data, "unknown opcode %d\n", OPCODE(h));
       return -1;
    }
 
-   next = p + header_length + bias;
    if ((h & 0xffff0000) == MAKE_HEADER(TYPE_AUB, OPCODE_AUB, SUBOPCODE_BLOCK)) {
-      assert(end - p >= 4);
-      next += p[4] / 4;
+      if (data_len < 5 * 4)
+         return 0;
+      size += p[4] / 4;
+   }
+
+   return size * 4;
+}
+
+int
+aub_read_command(struct aub_read *read, const void *data, uint32_t data_len)
+{
+   const uint32_t *p = data, *next;
+   uint32_t h;
+
+   assert(data_len >= 4);
+
+   h = *p;
+
+   int size = aub_read_command_size(data, data_len);
+   if (size < 0) {
+      parse_error(read, data, "unknown opcode %d\n", OPCODE(h));
+      return -1;
    }
 
-   assert(next <= end);
+   assert(size > 0 && size <= data_len);
+   next = p + size / 4;
 
    switch (h & 0xffff0000) {
    case MAKE_HEADER(TYPE_AUB, OPCODE_AUB, SUBOPCODE_HEADER):
@@ -70,6 +70,12 @@ struct aub_read {
 
 int aub_read_command(struct aub_read *read, const void *data, uint32_t data_len);
 
+/* Returns the size in bytes of the command at the start of data, 0 if more
+ * than data_len bytes are needed to tell, or -1 if data doesn't start with
+ * an AUB command.
+ */
+int aub_read_command_size(const void *data, uint32_t data_len);
+
 #ifdef __cplusplus
 }
 #endif
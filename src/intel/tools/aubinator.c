@@ -37,8 +37,10 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 
 #include "util/macros.h"
+#include "util/os_time.h"
 
 #include "common/gen_decoder.h"
 #include "aub_read.h"
@@ -55,6 +57,10 @@ static int option_full_decode = true;
 static int option_print_offsets = true;
 static int max_vbo_lines = -1;
 static enum { COLOR_AUTO, COLOR_ALWAYS, COLOR_NEVER } option_color;
+static int option_jobs = 1;
+static int option_stats = false;
+static uint64_t option_first_execbuf = 0;
+static uint64_t option_last_execbuf = UINT64_MAX;
 
 /* state */
 
@@ -65,6 +71,19 @@ struct gen_batch_decode_ctx batch_ctx;
 struct aub_mem mem;
 
 FILE *outfile;
+FILE *index_file;
+
+/* Offset in the AUB file of the command being processed */
+uint64_t command_offset;
+uint64_t n_execbufs, n_decoded_execbufs;
+
+/* Batches being decoded by child processes, in submission order */
+struct decode_job {
+   pid_t pid;
+   FILE *out;
+   uint64_t snapshot;
+} *jobs;
+int n_jobs, first_job;
 
 struct brw_instruction;
 
@@ -118,6 +137,114 @@ aubinator_init(void *user_data, int aub_pci_id, const char *app_name)
    fprintf(outfile, "\n");
 }
 
+static void
+finish_oldest_job(void)
+{
+   struct decode_job *job = &jobs[first_job];
+
+   while (waitpid(job->pid, NULL, 0) == -1 && errno == EINTR)
+      ;
+
+   /* Copy the output of the job without going through user space. */
+   int fd = fileno(job->out);
+   off_t size = lseek(fd, 0, SEEK_END), offset = 0;
+   fflush(outfile);
+   while (offset < size &&
+          sendfile(fileno(outfile), fd, &offset, size - offset) > 0)
+      ;
+   if (offset < size) {
+      char buf[4096];
+      size_t n;
+      fseek(job->out, offset, SEEK_SET);
+      while ((n = fread(buf, 1, sizeof(buf), job->out)) > 0)
+         fwrite(buf, 1, n, outfile);
+   }
+   fclose(job->out);
+
+   aub_mem_release_snapshot(&mem, job->snapshot);
+
+   first_job = (first_job + 1) % option_jobs;
+   n_jobs--;
+}
+
+static void
+finish_jobs(void)
+{
+   while (n_jobs > 0)
+      finish_oldest_job();
+}
+
+/* Returns whether the execbuf being submitted should be decoded. */
+static bool
+begin_execbuf(enum gen_engine engine)
+{
+   uint64_t execbuf = n_execbufs++;
+
+   if (index_file) {
+      fprintf(index_file, "%"PRIu64" %"PRIu64" %s\n", execbuf, command_offset,
+              engine == GEN_ENGINE_BLITTER ? "blitter" : "render");
+   }
+
+   if (execbuf < option_first_execbuf || execbuf > option_last_execbuf)
+      return false;
+
+   n_decoded_execbufs++;
+   return true;
+}
+
+static void
+decode_batch(bool print, const uint32_t *commands, uint32_t size)
+{
+   if (!print) {
+      gen_scan_batch(&batch_ctx, commands, size, 0);
+      return;
+   }
+
+   if (option_jobs <= 1) {
+      gen_print_batch(&batch_ctx, commands, size, 0);
+      return;
+   }
+
+   if (n_jobs == option_jobs)
+      finish_oldest_job();
+
+   /* Decode the batch in a child process working on a snapshot of the
+    * memory, while we carry on reading the AUB file. We only need to keep
+    * track of the state inherited by the next batches.
+    */
+   FILE *out = tmpfile();
+   if (out == NULL) {
+      finish_jobs();
+      gen_print_batch(&batch_ctx, commands, size, 0);
+      return;
+   }
+
+   uint64_t snapshot = aub_mem_snapshot(&mem);
+
+   fflush(outfile);
+   pid_t pid = fork();
+   if (pid == 0) {
+      batch_ctx.fp = out;
+      gen_print_batch(&batch_ctx, commands, size, 0);
+      fflush(out);
+      _exit(EXIT_SUCCESS);
+   } else if (pid == -1) {
+      finish_jobs();
+      aub_mem_release_snapshot(&mem, snapshot);
+      fclose(out);
+      gen_print_batch(&batch_ctx, commands, size, 0);
+      return;
+   }
+
+   jobs[(first_job + n_jobs++) % option_jobs] = (struct decode_job) {
+      .pid = pid,
+      .out = out,
+      .snapshot = snapshot,
+   };
+
+   gen_scan_batch(&batch_ctx, commands, size, 0);
+}
+
 static void
 handle_execlist_write(void *user_data, enum gen_engine engine, uint64_t context_descriptor)
 {
@@ -146,9 +273,8 @@ handle_execlist_write(void *user_data, enum gen_engine engine, uint64_t context_
       batch_ctx.get_bo = aub_mem_get_ggtt_bo;
    }
 
-   (void)engine; /* TODO */
-   gen_print_batch(&batch_ctx, commands, ring_buffer_tail - ring_buffer_head,
-                   0);
+   decode_batch(begin_execbuf(engine), commands,
+                ring_buffer_tail - ring_buffer_head);
    aub_mem_clear_bo_maps(&mem);
 }
 
@@ -159,55 +285,129 @@ handle_ring_write(void *user_data, enum gen_engine engine,
    batch_ctx.user_data = &mem;
    batch_ctx.get_bo = aub_mem_get_ggtt_bo;
 
-   gen_print_batch(&batch_ctx, data, data_len, 0);
+   decode_batch(begin_execbuf(engine), data, data_len);
 
    aub_mem_clear_bo_maps(&mem);
 }
 
+/* The AUB file is read through a window only large enough to hold the
+ * command being processed, so that memory usage doesn't grow with the size
+ * of the file, and so that it can be read from a pipe.
+ */
+#define AUB_FILE_READ_SIZE (256 * 1024)
+
 struct aub_file {
-   FILE *stream;
+   int fd;
+   bool eof;
+
+   uint8_t *buf;
+   size_t buf_size;
+   size_t start, end;
 
-   void *map, *end, *cursor;
+   /* Offset in the file of buf[start] */
+   uint64_t offset;
 };
 
 static struct aub_file *
 aub_file_open(const char *filename)
 {
    struct aub_file *file;
-   struct stat sb;
-   int fd;
 
    file = calloc(1, sizeof *file);
-   fd = open(filename, O_RDONLY);
-   if (fd == -1) {
-      fprintf(stderr, "open %s failed: %s\n", filename, strerror(errno));
-      exit(EXIT_FAILURE);
+   if (strcmp(filename, "-") == 0) {
+      file->fd = STDIN_FILENO;
+   } else {
+      file->fd = open(filename, O_RDONLY);
+      if (file->fd == -1) {
+         fprintf(stderr, "open %s failed: %s\n", filename, strerror(errno));
+         exit(EXIT_FAILURE);
+      }
+      posix_fadvise(file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
    }
 
-   if (fstat(fd, &sb) == -1) {
-      fprintf(stderr, "stat failed: %s\n", strerror(errno));
-      exit(EXIT_FAILURE);
+   return file;
+}
+
+static void
+aub_file_close(struct aub_file *file)
+{
+   if (file->fd != STDIN_FILENO)
+      close(file->fd);
+   free(file->buf);
+   free(file);
+}
+
+/* Makes sure there are at least size bytes available past the cursor. */
+static bool
+aub_file_fill(struct aub_file *file, size_t size)
+{
+   if (file->end - file->start >= size)
+      return true;
+
+   memmove(file->buf, file->buf + file->start, file->end - file->start);
+   file->end -= file->start;
+   file->start = 0;
+
+   if (file->buf_size < size + AUB_FILE_READ_SIZE) {
+      file->buf_size = size + AUB_FILE_READ_SIZE;
+      file->buf = realloc(file->buf, file->buf_size);
+      if (file->buf == NULL) {
+         fprintf(stderr, "out of memory reading the AUB file\n");
+         exit(EXIT_FAILURE);
+      }
    }
 
-   file->map = mmap(NULL, sb.st_size,
-                    PROT_READ, MAP_SHARED, fd, 0);
-   if (file->map == MAP_FAILED) {
-      fprintf(stderr, "mmap failed: %s\n", strerror(errno));
-      exit(EXIT_FAILURE);
+   while (file->end < size && !file->eof) {
+      ssize_t n = read(file->fd, file->buf + file->end,
+                       file->buf_size - file->end);
+      if (n == -1 && errno == EINTR)
+         continue;
+
+      if (n == -1) {
+         fprintf(stderr, "read failed: %s\n", strerror(errno));
+         file->eof = true;
+      } else if (n == 0) {
+         file->eof = true;
+      } else {
+         file->end += n;
+      }
    }
 
-   close(fd);
+   return file->end >= size;
+}
 
-   file->cursor = file->map;
-   file->end = file->map + sb.st_size;
+/* Returns the next command, or NULL at the end of the file. */
+static const void *
+aub_file_next_command(struct aub_file *file, uint32_t *size)
+{
+   /* Enough for aub_read_command_size() to work out any command size. */
+   aub_file_fill(file, 5 * 4);
+   if (file->start == file->end)
+      return NULL;
+
+   int cmd_size = aub_read_command_size(file->buf + file->start,
+                                        file->end - file->start);
+   if (cmd_size < 0) {
+      /* Let aub_read_command() report the error. */
+      *size = file->end - file->start;
+      return file->buf + file->start;
+   }
 
-   return file;
+   if (cmd_size == 0 || !aub_file_fill(file, cmd_size)) {
+      fprintf(stderr, "truncated command at offset %"PRIu64"\n",
+              file->offset);
+      return NULL;
+   }
+
+   *size = cmd_size;
+   return file->buf + file->start;
 }
 
-static int
-aub_file_more_stuff(struct aub_file *file)
+static void
+aub_file_advance(struct aub_file *file, uint32_t size)
 {
-   return file->cursor < file->end || (file->stream && !feof(file->stream));
+   file->start += size;
+   file->offset += size;
 }
 
 static void
@@ -251,7 +451,15 @@ print_help(const char *progname, FILE *file)
            "      --max-vbo-lines=N  limit the number of decoded VBO lines\n"
            "      --no-pager         don't launch pager\n"
            "      --no-offsets       don't print instruction offsets\n"
-           "      --xml=DIR          load hardware xml description from directory DIR\n",
+           "      --xml=DIR          load hardware xml description from directory DIR\n"
+           "      --execbuf=N[-M]    only decode execbufs N to M (numbered from 0),\n"
+           "                         earlier ones are replayed without decoding\n"
+           "      --index=FILE       write the number, file offset and engine of\n"
+           "                         each execbuf to FILE\n"
+           "      --jobs=N           decode up to N batches in parallel\n"
+           "      --stats            print decoding throughput on stderr\n"
+           "\n"
+           "FILE can be - to read from the standard input.\n",
            progname);
 }
 
@@ -260,6 +468,7 @@ int main(int argc, char *argv[])
    struct aub_file *file;
    int c, i;
    bool help = false, pager = true;
+   char *index_path = NULL;
    const struct option aubinator_opts[] = {
       { "help",          no_argument,       (int *) &help,                 true },
       { "no-pager",      no_argument,       (int *) &pager,                false },
@@ -269,6 +478,10 @@ int main(int argc, char *argv[])
       { "color",         required_argument, NULL,                          'c' },
       { "xml",           required_argument, NULL,                          'x' },
       { "max-vbo-lines", required_argument, NULL,                          'v' },
+      { "execbuf",       required_argument, NULL,                          'e' },
+      { "index",         required_argument, NULL,                          'i' },
+      { "jobs",          required_argument, NULL,                          'j' },
+      { "stats",         no_argument,       (int *) &option_stats,         true },
       { NULL,            0,                 NULL,                          0 }
    };
 
@@ -307,6 +520,25 @@ int main(int argc, char *argv[])
       case 'v':
          max_vbo_lines = atoi(optarg);
          break;
+      case 'e': {
+         char *end;
+         option_first_execbuf = strtoull(optarg, &end, 0);
+         if (*end == '-')
+            option_last_execbuf = strtoull(end + 1, &end, 0);
+         else
+            option_last_execbuf = option_first_execbuf;
+         if (*end != '\0' || option_last_execbuf < option_first_execbuf) {
+            fprintf(stderr, "invalid value for --execbuf: %s\n", optarg);
+            exit(EXIT_FAILURE);
+         }
+         break;
+      }
+      case 'i':
+         index_path = optarg;
+         break;
+      case 'j':
+         option_jobs = MAX2(1, atoi(optarg));
+         break;
       default:
          break;
       }
@@ -334,6 +566,19 @@ int main(int argc, char *argv[])
 
    file = aub_file_open(input_file);
 
+   if (index_path) {
+      index_file = fopen(index_path, "w");
+      if (index_file == NULL) {
+         fprintf(stderr, "open %s failed: %s\n", index_path, strerror(errno));
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   if (option_jobs > 1)
+      jobs = calloc(option_jobs, sizeof(*jobs));
+
+   int64_t start_time = os_time_get_nano();
+
    struct aub_read aub_read = {
       .user_data = &mem,
       .error = aubinator_error,
@@ -347,13 +592,37 @@ int main(int argc, char *argv[])
       .execlist_write = handle_execlist_write,
       .ring_write = handle_ring_write,
    };
+   const void *command;
+   uint32_t size;
    int consumed;
-   while (aub_file_more_stuff(file) &&
-          (consumed = aub_read_command(&aub_read, file->cursor,
-                                       file->end - file->cursor)) > 0) {
-      file->cursor += consumed;
+   while ((command = aub_file_next_command(file, &size)) != NULL) {
+      command_offset = file->offset;
+      consumed = aub_read_command(&aub_read, command, size);
+      if (consumed <= 0)
+         break;
+
+      aub_file_advance(file, consumed);
+
+      /* Nothing left to decode, unless we're building the index. */
+      if (n_execbufs > option_last_execbuf && index_file == NULL)
+         break;
+   }
+
+   finish_jobs();
+
+   if (option_stats) {
+      double elapsed = (os_time_get_nano() - start_time) / 1e9;
+      fprintf(stderr,
+              "Decoded %"PRIu64" of %"PRIu64" execbufs, read %.1f MB "
+              "in %.2f s (%.1f MB/s)\n",
+              n_decoded_execbufs, n_execbufs, file->offset / 1e6, elapsed,
+              file->offset / 1e6 / elapsed);
    }
 
+   if (index_file)
+      fclose(index_file);
+   free(jobs);
+   aub_file_close(file);
    aub_mem_fini(&mem);
 
    fflush(stdout);
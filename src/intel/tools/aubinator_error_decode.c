@@ -610,7 +610,8 @@ read_data_file(FILE *file)
           strcmp(sections[s].buffer_name, "batch buffer") == 0 ||
           strcmp(sections[s].buffer_name, "ring buffer") == 0 ||
           strcmp(sections[s].buffer_name, "HW Context") == 0) {
-         gen_print_batch(&batch_ctx, sections[s].data, sections[s].count,
+         gen_print_batch(&batch_ctx, sections[s].data,
+                         sections[s].count * 4,
                          sections[s].gtt_offset);
       }
    }
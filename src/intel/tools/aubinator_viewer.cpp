@@ -839,9 +839,9 @@ display_registers_window(struct window *win)
    filter.Draw();
 
    ImGui::BeginChild(ImGui::GetID("##block"));
-   struct hash_entry *entry;
-   hash_table_foreach(context.file->spec->registers_by_name, entry) {
-      struct gen_group *reg = (struct gen_group *) entry->data;
+   const struct gen_spec *spec = context.file->spec;
+   for (int i = 0; i < spec->nregisters_by_name; i++) {
+      struct gen_group *reg = spec->registers_by_name[i];
       if (filter.PassFilter(reg->name) &&
           ImGui::CollapsingHeader(reg->name)) {
          const struct gen_field *field = reg->fields;
@@ -895,9 +895,9 @@ display_commands_window(struct window *win)
    if (ImGui::Button("Dwords")) show_dwords ^= 1;
 
    ImGui::BeginChild(ImGui::GetID("##block"));
-   struct hash_entry *entry;
-   hash_table_foreach(context.file->spec->commands, entry) {
-      struct gen_group *cmd = (struct gen_group *) entry->data;
+   const struct gen_spec *spec = context.file->spec;
+   for (int i = 0; i < spec->ncommands; i++) {
+      struct gen_group *cmd = spec->commands[i];
       if ((cmd_filter.PassFilter(cmd->name) &&
            (opcode_len == 0 || (opcode & cmd->opcode_mask) == cmd->opcode)) &&
           ImGui::CollapsingHeader(cmd->name)) {
@@ -918,8 +918,8 @@ display_commands_window(struct window *win)
          }
       }
    }
-   hash_table_foreach(context.file->spec->structs, entry) {
-      struct gen_group *cmd = (struct gen_group *) entry->data;
+   for (int i = 0; i < spec->nstructs; i++) {
+      struct gen_group *cmd = spec->structs[i];
       if (cmd_filter.PassFilter(cmd->name) && opcode_len == 0 &&
           ImGui::CollapsingHeader(cmd->name)) {
          const struct gen_field *field = cmd->fields;
@@ -0,0 +1,986 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Offline driver for the backend compiler.
+ *
+ * Compiles SPIR-V or serialized NIR vertex, fragment and compute shaders for
+ * any platform without a device, and writes a JSON object per shader with
+ * the compile time, the CPU time spent in each compiler pass and the
+ * statistics of the generated code, for tracking compile-time changes.
+ *
+ * SPIR-V goes through the same lowering as in anv, except that descriptor
+ * sets are laid out in the binding table in the order the shader uses them
+ * and storage images and input attachments aren't supported.  Serialized NIR
+ * is the shader as it would be handed to brw_preprocess_nir, which is what
+ * --save-nir writes out.
+ */
+
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c11/threads.h"
+#include "common/gen_debug.h"
+#include "compiler/blob.h"
+#include "compiler/brw_compiler.h"
+#include "compiler/brw_nir.h"
+#include "compiler/nir/nir_builder.h"
+#include "compiler/nir/nir_serialize.h"
+#include "compiler/spirv/nir_spirv.h"
+#include "compiler/spirv/spirv.h"
+#include "dev/gen_device_info.h"
+#include "util/hash_table.h"
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/u_dynarray.h"
+
+#define PUSH_CONSTANTS_SIZE 128
+
+struct pass_time {
+   const char *name;
+   /* Indexed by dispatch_width / 8. */
+   struct {
+      unsigned calls;
+      uint64_t nsec;
+   } width[5];
+};
+
+struct shader_stats {
+   /* 0 for vec4 shaders */
+   unsigned dispatch_width;
+   unsigned instructions;
+   unsigned loops;
+   unsigned cycles;
+   unsigned spills;
+   unsigned fills;
+   unsigned size;
+};
+
+struct compile_state {
+   const char *filename;
+   void *mem_ctx;
+
+   mtx_t mutex;
+   struct hash_table *pass_table;
+   struct util_dynarray passes;
+
+   bool record_stats;
+   struct util_dynarray stats;
+   unsigned perf_msgs;
+};
+
+static bool verbose;
+
+static void
+record_pass_time(void *data, gl_shader_stage stage, unsigned dispatch_width,
+                 const char *name, uint64_t nsec)
+{
+   struct compile_state *state = data;
+
+   assert(dispatch_width / 8 < ARRAY_SIZE(((struct pass_time *)0)->width));
+
+   mtx_lock(&state->mutex);
+
+   struct hash_entry *entry = _mesa_hash_table_search(state->pass_table, name);
+   struct pass_time *pass;
+   if (entry) {
+      pass = entry->data;
+   } else {
+      pass = rzalloc(state->mem_ctx, struct pass_time);
+      pass->name = name;
+      _mesa_hash_table_insert(state->pass_table, name, pass);
+      util_dynarray_append(&state->passes, struct pass_time *, pass);
+   }
+
+   pass->width[dispatch_width / 8].calls++;
+   pass->width[dispatch_width / 8].nsec += nsec;
+
+   mtx_unlock(&state->mutex);
+}
+
+static void
+compiler_debug_log(void *data, const char *fmt, ...)
+{
+   struct compile_state *state = data;
+   struct shader_stats stats = { 0 };
+   unsigned before_size;
+   char msg[512];
+   va_list args;
+
+   va_start(args, fmt);
+   vsnprintf(msg, sizeof(msg), fmt, args);
+   va_end(args);
+
+   if (verbose)
+      fprintf(stderr, "%s: %s\n", state->filename, msg);
+
+   if (!state->record_stats)
+      return;
+
+   /* The statistics printed by the generators, also used by shader-db. */
+   const char *s = strchr(msg, ' ');
+   if (s &&
+       (sscanf(s, " SIMD%u shader: %u inst, %u loops, %u cycles, "
+                  "%u:%u spills:fills, Promoted %*u constants, "
+                  "compacted %u to %u bytes.",
+               &stats.dispatch_width, &stats.instructions, &stats.loops,
+               &stats.cycles, &stats.spills, &stats.fills, &before_size,
+               &stats.size) == 8 ||
+        sscanf(s, " vec4 shader: %u inst, %u loops, %u cycles, "
+                  "%u:%u spills:fills, compacted %u to %u bytes.",
+               &stats.instructions, &stats.loops, &stats.cycles,
+               &stats.spills, &stats.fills, &before_size,
+               &stats.size) == 7))
+      util_dynarray_append(&state->stats, struct shader_stats, stats);
+}
+
+static void
+compiler_perf_log(void *data, const char *fmt, ...)
+{
+   struct compile_state *state = data;
+   va_list args;
+
+   state->perf_msgs++;
+
+   if (verbose) {
+      fprintf(stderr, "%s: ", state->filename);
+      va_start(args, fmt);
+      vfprintf(stderr, fmt, args);
+      va_end(args);
+   }
+}
+
+static void *
+read_file(const char *filename, size_t *size)
+{
+   FILE *fp = fopen(filename, "rb");
+   if (fp == NULL)
+      return NULL;
+
+   fseek(fp, 0L, SEEK_END);
+   *size = ftell(fp);
+   fseek(fp, 0L, SEEK_SET);
+
+   void *data = malloc(*size);
+   if (data && fread(data, 1, *size, fp) != *size) {
+      free(data);
+      data = NULL;
+   }
+
+   fclose(fp);
+   return data;
+}
+
+/**
+ * Returns the stage of the given entry point of a SPIR-V module.
+ */
+static gl_shader_stage
+spirv_entrypoint_stage(const uint32_t *words, size_t word_count,
+                       const char *entrypoint)
+{
+   /* Skip the header. */
+   size_t w = 5;
+
+   while (w < word_count) {
+      SpvOp opcode = words[w] & SpvOpCodeMask;
+      unsigned count = words[w] >> SpvWordCountShift;
+
+      if (count == 0 || w + count > word_count)
+         break;
+
+      if (opcode == SpvOpEntryPoint && count > 3 &&
+          strncmp((const char *)&words[w + 3], entrypoint,
+                  (count - 3) * 4) == 0) {
+         switch (words[w + 1]) {
+         case SpvExecutionModelVertex:
+            return MESA_SHADER_VERTEX;
+         case SpvExecutionModelFragment:
+            return MESA_SHADER_FRAGMENT;
+         case SpvExecutionModelGLCompute:
+            return MESA_SHADER_COMPUTE;
+         default:
+            return MESA_SHADER_NONE;
+         }
+      }
+
+      /* The entry points come before any function. */
+      if (opcode == SpvOpFunction)
+         break;
+
+      w += count;
+   }
+
+   return MESA_SHADER_NONE;
+}
+
+static nir_shader *
+spirv_to_brw_nir(const struct brw_compiler *compiler, void *mem_ctx,
+                 const uint32_t *words, size_t word_count,
+                 const char *entrypoint, const char **error)
+{
+   const struct gen_device_info *devinfo = compiler->devinfo;
+
+   gl_shader_stage stage =
+      spirv_entrypoint_stage(words, word_count, entrypoint);
+   if (stage == MESA_SHADER_NONE) {
+      *error = "no vertex, fragment or compute entry point with that name";
+      return NULL;
+   }
+
+   const struct spirv_to_nir_options spirv_options = {
+      .lower_workgroup_access_to_offsets = true,
+      .caps = {
+         .float64 = devinfo->gen >= 8,
+         .int64 = devinfo->gen >= 8,
+         .tessellation = true,
+         .device_group = true,
+         .draw_parameters = true,
+         .image_write_without_format = true,
+         .multiview = true,
+         .variable_pointers = true,
+         .storage_16bit = devinfo->gen >= 8,
+         .int16 = devinfo->gen >= 8,
+         .shader_viewport_index_layer = true,
+         .subgroup_arithmetic = true,
+         .subgroup_basic = true,
+         .subgroup_ballot = true,
+         .subgroup_quad = true,
+         .subgroup_shuffle = true,
+         .subgroup_vote = true,
+         .stencil_export = devinfo->gen >= 9,
+         .storage_8bit = devinfo->gen >= 8,
+         .post_depth_coverage = devinfo->gen >= 9,
+      },
+   };
+
+   nir_function *entry_point =
+      spirv_to_nir(words, word_count, NULL, 0, stage, entrypoint,
+                   &spirv_options,
+                   compiler->glsl_compiler_options[stage].NirOptions);
+   if (entry_point == NULL) {
+      *error = "spirv_to_nir failed";
+      return NULL;
+   }
+
+   nir_shader *nir = entry_point->shader;
+   ralloc_steal(mem_ctx, nir);
+
+   /* The same lowering as anv_shader_compile_to_nir. */
+   NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_local);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_copy_prop);
+
+   foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+      if (func != entry_point)
+         exec_node_remove(&func->node);
+   }
+   entry_point->name = ralloc_strdup(entry_point, "main");
+
+   NIR_PASS_V(nir, nir_lower_constant_initializers, ~0);
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_split_per_member_structs);
+   NIR_PASS_V(nir, nir_remove_dead_variables,
+              nir_var_shader_in | nir_var_shader_out | nir_var_system_value);
+
+   if (stage == MESA_SHADER_FRAGMENT)
+      NIR_PASS_V(nir, nir_lower_wpos_center, false);
+
+   NIR_PASS_V(nir, nir_propagate_invariant);
+   NIR_PASS_V(nir, nir_lower_io_to_temporaries,
+              entry_point->impl, true, false);
+
+   nir->info.separate_shader = true;
+
+   return nir;
+}
+
+struct layout_state {
+   nir_builder builder;
+   unsigned bias;
+   struct hash_table_u64 *surfaces;
+   unsigned num_surfaces;
+   struct hash_table_u64 *samplers;
+   unsigned num_samplers;
+   const char *error;
+};
+
+/* Binding table index of a (set, binding) pair, assigned on first use. */
+static unsigned
+binding_index(struct hash_table_u64 *table, unsigned *count,
+              unsigned set, unsigned binding)
+{
+   /* Keys 0 and 1 are reserved by hash_table_u64. */
+   const uint64_t key = ((uint64_t)set << 32 | binding) + 2;
+   void *data = _mesa_hash_table_u64_search(table, key);
+
+   if (data == NULL) {
+      data = (void *)(uintptr_t)++(*count);
+      _mesa_hash_table_u64_insert(table, key, data);
+   }
+
+   return (uintptr_t)data - 1;
+}
+
+static void
+lower_res_index(nir_intrinsic_instr *intrin, struct layout_state *state)
+{
+   nir_builder *b = &state->builder;
+
+   b->cursor = nir_before_instr(&intrin->instr);
+
+   unsigned surface = state->bias +
+      binding_index(state->surfaces, &state->num_surfaces,
+                    nir_intrinsic_desc_set(intrin),
+                    nir_intrinsic_binding(intrin));
+
+   nir_ssa_def *index = nir_iadd(b, nir_imm_int(b, surface),
+                                 nir_ssa_for_src(b, intrin->src[0], 1));
+
+   nir_ssa_def_rewrite_uses(&intrin->dest.ssa, nir_src_for_ssa(index));
+   nir_instr_remove(&intrin->instr);
+}
+
+static void
+lower_res_reindex(nir_intrinsic_instr *intrin, struct layout_state *state)
+{
+   nir_builder *b = &state->builder;
+
+   b->cursor = nir_before_instr(&intrin->instr);
+
+   nir_ssa_def *index = nir_iadd(b, nir_ssa_for_src(b, intrin->src[0], 1),
+                                 nir_ssa_for_src(b, intrin->src[1], 1));
+
+   nir_ssa_def_rewrite_uses(&intrin->dest.ssa, nir_src_for_ssa(index));
+   nir_instr_remove(&intrin->instr);
+}
+
+static void
+lower_load_constant(nir_intrinsic_instr *intrin, struct layout_state *state)
+{
+   nir_builder *b = &state->builder;
+
+   b->cursor = nir_before_instr(&intrin->instr);
+
+   /* The shader constants get a surface of their own, like in anv. */
+   unsigned surface = state->bias +
+      binding_index(state->surfaces, &state->num_surfaces, UINT32_MAX, 0);
+
+   nir_ssa_def *offset = nir_iadd(b, nir_ssa_for_src(b, intrin->src[0], 1),
+                                  nir_imm_int(b, nir_intrinsic_base(intrin)));
+
+   nir_intrinsic_instr *load_ubo =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ubo);
+   load_ubo->num_components = intrin->num_components;
+   load_ubo->src[0] = nir_src_for_ssa(nir_imm_int(b, surface));
+   load_ubo->src[1] = nir_src_for_ssa(offset);
+   nir_ssa_dest_init(&load_ubo->instr, &load_ubo->dest,
+                     intrin->dest.ssa.num_components,
+                     intrin->dest.ssa.bit_size, NULL);
+   nir_builder_instr_insert(b, &load_ubo->instr);
+
+   nir_ssa_def_rewrite_uses(&intrin->dest.ssa,
+                            nir_src_for_ssa(&load_ubo->dest.ssa));
+   nir_instr_remove(&intrin->instr);
+}
+
+static void
+lower_tex_deref(nir_tex_instr *tex, nir_tex_src_type deref_src_type,
+                unsigned *index, struct layout_state *state)
+{
+   int deref_src_idx = nir_tex_instr_src_index(tex, deref_src_type);
+   if (deref_src_idx < 0)
+      return;
+
+   nir_deref_instr *deref = nir_src_as_deref(tex->src[deref_src_idx].src);
+   nir_variable *var = nir_deref_instr_get_variable(deref);
+
+   nir_tex_src_type offset_src_type;
+   if (deref_src_type == nir_tex_src_texture_deref) {
+      offset_src_type = nir_tex_src_texture_offset;
+      *index = state->bias +
+         binding_index(state->surfaces, &state->num_surfaces,
+                       var->data.descriptor_set, var->data.binding);
+   } else {
+      offset_src_type = nir_tex_src_sampler_offset;
+      *index = binding_index(state->samplers, &state->num_samplers,
+                             var->data.descriptor_set, var->data.binding);
+   }
+
+   nir_ssa_def *offset = NULL;
+   if (deref->deref_type == nir_deref_type_array) {
+      nir_const_value *const_index = nir_src_as_const_value(deref->arr.index);
+      if (const_index)
+         *index += const_index->u32[0];
+      else
+         offset = nir_ssa_for_src(&state->builder, deref->arr.index, 1);
+   }
+
+   if (offset) {
+      nir_instr_rewrite_src(&tex->instr, &tex->src[deref_src_idx].src,
+                            nir_src_for_ssa(offset));
+      tex->src[deref_src_idx].src_type = offset_src_type;
+   } else {
+      nir_tex_instr_remove_src(tex, deref_src_idx);
+   }
+}
+
+static void
+lower_tex(nir_tex_instr *tex, struct layout_state *state)
+{
+   state->builder.cursor = nir_before_instr(&tex->instr);
+
+   lower_tex_deref(tex, nir_tex_src_texture_deref, &tex->texture_index,
+                   state);
+   lower_tex_deref(tex, nir_tex_src_sampler_deref, &tex->sampler_index,
+                   state);
+
+   tex->texture_array_size = 1;
+}
+
+static void
+lower_layout_block(nir_block *block, struct layout_state *state)
+{
+   nir_foreach_instr_safe(instr, block) {
+      if (instr->type == nir_instr_type_tex) {
+         lower_tex(nir_instr_as_tex(instr), state);
+         continue;
+      }
+
+      if (instr->type != nir_instr_type_intrinsic)
+         continue;
+
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      switch (intrin->intrinsic) {
+      case nir_intrinsic_vulkan_resource_index:
+         lower_res_index(intrin, state);
+         break;
+      case nir_intrinsic_vulkan_resource_reindex:
+         lower_res_reindex(intrin, state);
+         break;
+      case nir_intrinsic_load_constant:
+         lower_load_constant(intrin, state);
+         break;
+      case nir_intrinsic_load_push_constant:
+         intrin->intrinsic = nir_intrinsic_load_uniform;
+         break;
+      case nir_intrinsic_image_deref_load:
+      case nir_intrinsic_image_deref_store:
+      case nir_intrinsic_image_deref_atomic_add:
+      case nir_intrinsic_image_deref_atomic_min:
+      case nir_intrinsic_image_deref_atomic_max:
+      case nir_intrinsic_image_deref_atomic_and:
+      case nir_intrinsic_image_deref_atomic_or:
+      case nir_intrinsic_image_deref_atomic_xor:
+      case nir_intrinsic_image_deref_atomic_exchange:
+      case nir_intrinsic_image_deref_atomic_comp_swap:
+      case nir_intrinsic_image_deref_size:
+      case nir_intrinsic_image_deref_samples:
+         state->error = "storage images are not supported";
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+/**
+ * Lays out the Vulkan resources of the shader in the binding table after the
+ * first bias entries, in place of anv_nir_apply_pipeline_layout.
+ */
+static bool
+lower_layout(nir_shader *nir, unsigned bias, const char **error)
+{
+   struct layout_state state = {
+      .bias = bias,
+      .surfaces = _mesa_hash_table_u64_create(NULL),
+      .samplers = _mesa_hash_table_u64_create(NULL),
+   };
+
+   nir_foreach_function(function, nir) {
+      if (!function->impl)
+         continue;
+
+      nir_builder_init(&state.builder, function->impl);
+      nir_foreach_block(block, function->impl)
+         lower_layout_block(block, &state);
+
+      nir_metadata_preserve(function->impl, nir_metadata_block_index |
+                                            nir_metadata_dominance);
+   }
+
+   _mesa_hash_table_u64_destroy(state.surfaces, NULL);
+   _mesa_hash_table_u64_destroy(state.samplers, NULL);
+
+   *error = state.error;
+   return state.error == NULL;
+}
+
+static void
+populate_sampler_prog_key(struct brw_sampler_prog_key_data *key)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(key->swizzles); i++)
+      key->swizzles[i] = SWIZZLE_XYZW;
+}
+
+static void
+fill_binding_table(struct brw_stage_prog_data *prog_data, unsigned bias)
+{
+   prog_data->binding_table.texture_start = bias;
+   prog_data->binding_table.gather_texture_start = bias;
+   prog_data->binding_table.ubo_start = bias;
+   prog_data->binding_table.ssbo_start = bias;
+   prog_data->binding_table.image_start = bias;
+}
+
+/**
+ * Compiles a copy of the shader like anv would, returning the assembly or
+ * NULL with an error message.
+ */
+static const unsigned *
+compile_shader(const struct brw_compiler *compiler,
+               struct compile_state *state, void *mem_ctx,
+               const nir_shader *front_end, const char **error)
+{
+   const gl_shader_stage stage = front_end->info.stage;
+   union brw_any_prog_data prog_data;
+   char *error_str = NULL;
+   unsigned bias = 0;
+
+   memset(&prog_data, 0, sizeof(prog_data));
+
+   nir_shader *nir = nir_shader_clone(mem_ctx, front_end);
+   nir = brw_preprocess_nir(compiler, nir);
+
+   /* One binding table entry per render target, or a null one. */
+   unsigned num_rts = 0;
+   if (stage == MESA_SHADER_FRAGMENT) {
+      num_rts = util_last_bit64(nir->info.outputs_written >>
+                                FRAG_RESULT_DATA0);
+      bias = MAX2(num_rts, 1);
+   } else if (stage == MESA_SHADER_COMPUTE) {
+      /* The first entry is for the work group size. */
+      bias = 1;
+   }
+
+   if (!lower_layout(nir, bias, error))
+      return NULL;
+
+   fill_binding_table(&prog_data.base, bias);
+
+   if (nir->num_uniforms > 0) {
+      nir->num_uniforms = PUSH_CONSTANTS_SIZE;
+      prog_data.base.nr_params = PUSH_CONSTANTS_SIZE / 4;
+      prog_data.base.param = ralloc_array(mem_ctx, uint32_t,
+                                          prog_data.base.nr_params);
+      for (unsigned i = 0; i < prog_data.base.nr_params; i++)
+         prog_data.base.param[i] = BRW_PARAM_BUILTIN_ZERO;
+   }
+
+   nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
+
+   if (stage != MESA_SHADER_COMPUTE) {
+      brw_nir_analyze_ubo_ranges(compiler, nir, NULL,
+                                 prog_data.base.ubo_ranges);
+   }
+
+   const unsigned *assembly = NULL;
+
+   switch (stage) {
+   case MESA_SHADER_VERTEX: {
+      struct brw_vs_prog_key key;
+      memset(&key, 0, sizeof(key));
+      populate_sampler_prog_key(&key.tex);
+
+      brw_compute_vue_map(compiler->devinfo, &prog_data.vs.base.vue_map,
+                          nir->info.outputs_written,
+                          nir->info.separate_shader);
+
+      assembly = brw_compile_vs(compiler, state, mem_ctx, &key,
+                                &prog_data.vs, nir, -1, &error_str);
+      break;
+   }
+
+   case MESA_SHADER_FRAGMENT: {
+      struct brw_wm_prog_key key;
+      memset(&key, 0, sizeof(key));
+      populate_sampler_prog_key(&key.tex);
+
+      key.nr_color_regions = num_rts;
+      key.color_outputs_valid = (1 << num_rts) - 1;
+      key.input_slots_valid = nir->info.inputs_read | VARYING_BIT_POS;
+
+      assembly = brw_compile_fs(compiler, state, mem_ctx, &key,
+                                &prog_data.wm, nir, NULL, -1, -1, -1,
+                                true, false, NULL, &error_str);
+      break;
+   }
+
+   case MESA_SHADER_COMPUTE: {
+      struct brw_cs_prog_key key;
+      memset(&key, 0, sizeof(key));
+      populate_sampler_prog_key(&key.tex);
+
+      prog_data.base.total_shared = nir->num_shared;
+
+      assembly = brw_compile_cs(compiler, state, mem_ctx, &key,
+                                &prog_data.cs, nir, -1, &error_str);
+      break;
+   }
+
+   default:
+      unreachable("Unsupported stage");
+   }
+
+   if (assembly == NULL)
+      *error = ralloc_strdup(state->mem_ctx, error_str);
+
+   return assembly;
+}
+
+static void
+print_json_string(FILE *fp, const char *str)
+{
+   fputc('"', fp);
+   for (const char *c = str; *c; c++) {
+      if (*c == '"' || *c == '\\')
+         fprintf(fp, "\\%c", *c);
+      else if ((unsigned char)*c < 0x20)
+         fprintf(fp, "\\u%04x", *c);
+      else
+         fputc(*c, fp);
+   }
+   fputc('"', fp);
+}
+
+static void
+print_results(FILE *fp, const struct compile_state *state,
+              const struct gen_device_info *devinfo, const char *platform,
+              const nir_shader *nir, unsigned iterations,
+              uint64_t front_end_time, uint64_t compile_time,
+              const char *error)
+{
+   fprintf(fp, "{\"shader\": ");
+   print_json_string(fp, state->filename);
+   fprintf(fp, ", \"platform\": \"%s\", \"gen\": %u",
+           platform, devinfo->gen);
+
+   if (nir) {
+      fprintf(fp, ", \"stage\": \"%s\"",
+              _mesa_shader_stage_to_abbrev(nir->info.stage));
+   }
+
+   if (error) {
+      fprintf(fp, ", \"error\": ");
+      print_json_string(fp, error);
+      fprintf(fp, "}\n");
+      return;
+   }
+
+   fprintf(fp, ", \"iterations\": %u, \"front_end_ms\": %.4f, "
+               "\"compile_ms\": %.4f, \"perf_messages\": %u",
+           iterations, front_end_time / 1e6,
+           compile_time / 1e6 / iterations, state->perf_msgs / iterations);
+
+   fprintf(fp, ", \"variants\": [");
+   unsigned i = 0;
+   util_dynarray_foreach(&state->stats, struct shader_stats, stats) {
+      fprintf(fp, "%s{\"simd\": %u, \"instructions\": %u, \"loops\": %u, "
+                  "\"cycles\": %u, \"spills\": %u, \"fills\": %u, "
+                  "\"size\": %u}",
+              i++ ? ", " : "", stats->dispatch_width, stats->instructions,
+              stats->loops, stats->cycles, stats->spills, stats->fills,
+              stats->size);
+   }
+
+   /* The passes in the order they first ran, with the time spent in each
+    * per compile.
+    */
+   fprintf(fp, "], \"passes\": [");
+   i = 0;
+   util_dynarray_foreach(&state->passes, struct pass_time *, pass) {
+      for (unsigned w = 0; w < ARRAY_SIZE((*pass)->width); w++) {
+         if ((*pass)->width[w].calls == 0)
+            continue;
+
+         fprintf(fp, "%s{\"name\": \"%s\", \"simd\": %u, \"calls\": %u, "
+                     "\"ms\": %.4f}",
+                 i++ ? ", " : "", (*pass)->name, w * 8,
+                 (*pass)->width[w].calls / iterations,
+                 (*pass)->width[w].nsec / 1e6 / iterations);
+      }
+   }
+   fprintf(fp, "]}\n");
+}
+
+static bool
+compile_file(struct brw_compiler *compiler, const char *filename,
+             const char *platform, const char *entrypoint,
+             unsigned iterations, const char *save_nir, FILE *out)
+{
+   struct compile_state state = {
+      .filename = filename,
+      .mem_ctx = ralloc_context(NULL),
+   };
+   const char *error = NULL;
+   nir_shader *nir = NULL;
+   uint64_t front_end_time = 0, compile_time = 0;
+   size_t size;
+
+   mtx_init(&state.mutex, mtx_plain);
+   state.pass_table = _mesa_hash_table_create(state.mem_ctx,
+                                              _mesa_key_hash_string,
+                                              _mesa_key_string_equal);
+   util_dynarray_init(&state.passes, state.mem_ctx);
+   util_dynarray_init(&state.stats, state.mem_ctx);
+
+   void *data = read_file(filename, &size);
+   if (data == NULL) {
+      error = "can't read the file";
+      goto done;
+   }
+
+   int64_t start = os_time_get_nano();
+
+   if (size >= 4 && *(uint32_t *)data == SpvMagicNumber) {
+      /* Like anv, the SPIR-V lowering assumes gen7+. */
+      if (compiler->devinfo->gen >= 7) {
+         nir = spirv_to_brw_nir(compiler, state.mem_ctx, data, size / 4,
+                                entrypoint, &error);
+      } else {
+         error = "SPIR-V needs gen7 or later";
+      }
+   } else {
+      struct blob_reader reader;
+      blob_reader_init(&reader, data, size);
+      nir = nir_deserialize(state.mem_ctx, NULL, &reader);
+      if (reader.overrun || nir->info.stage >= MESA_SHADER_STAGES) {
+         error = "not a SPIR-V module or serialized NIR shader";
+         nir = NULL;
+      } else {
+         nir->options =
+            compiler->glsl_compiler_options[nir->info.stage].NirOptions;
+      }
+   }
+
+   front_end_time = os_time_get_nano() - start;
+   free(data);
+
+   if (nir == NULL)
+      goto done;
+
+   if (nir->info.stage != MESA_SHADER_VERTEX &&
+       nir->info.stage != MESA_SHADER_FRAGMENT &&
+       nir->info.stage != MESA_SHADER_COMPUTE) {
+      error = "only vertex, fragment and compute shaders are supported";
+      goto done;
+   }
+
+   if (nir->info.stage == MESA_SHADER_COMPUTE && compiler->devinfo->gen < 7) {
+      error = "compute shaders need gen7 or later";
+      goto done;
+   }
+
+   if (save_nir) {
+      struct blob blob;
+      blob_init(&blob);
+      nir_serialize(&blob, nir);
+
+      FILE *fp = fopen(save_nir, "wb");
+      if (fp == NULL || fwrite(blob.data, 1, blob.size, fp) != blob.size)
+         error = "can't write the NIR";
+      if (fp)
+         fclose(fp);
+      blob_finish(&blob);
+
+      if (error)
+         goto done;
+   }
+
+   compiler->pass_time = record_pass_time;
+   compiler->pass_time_data = &state;
+
+   for (unsigned i = 0; i < iterations && !error; i++) {
+      void *mem_ctx = ralloc_context(NULL);
+      state.record_stats = i == 0;
+
+      start = os_time_get_nano();
+      compile_shader(compiler, &state, mem_ctx, nir, &error);
+      compile_time += os_time_get_nano() - start;
+
+      ralloc_free(mem_ctx);
+   }
+
+   compiler->pass_time = NULL;
+   compiler->pass_time_data = NULL;
+
+done:
+   print_results(out, &state, compiler->devinfo, platform, nir, iterations,
+                 front_end_time, compile_time, error);
+
+   mtx_destroy(&state.mutex);
+   ralloc_free(state.mem_ctx);
+
+   return error == NULL;
+}
+
+static void
+print_help(const char *progname, FILE *file)
+{
+   fprintf(file,
+           "Usage: %s [OPTION]... FILE...\n"
+           "Compile SPIR-V or serialized NIR shaders with the backend "
+           "compiler and report\nthe compile time, per pass, and the "
+           "statistics of the generated code as one\nJSON object per "
+           "shader.\n\n"
+           "      --help             display this help and exit\n"
+           "  -p, --gen=platform     compile for the given platform (3 letter "
+           "platform name),\n"
+           "                         skl by default\n"
+           "  -e, --entrypoint=NAME  compile the entry point NAME of SPIR-V "
+           "modules, main by\n"
+           "                         default\n"
+           "  -n, --iterations=N     compile each shader N times and report "
+           "the mean\n"
+           "  -j, --threads=N        compile the SIMD variants on N threads, "
+           "0 to compile\n"
+           "                         them one after the other\n"
+           "  -o, --output=FILE      write the results to FILE instead of "
+           "stdout\n"
+           "  -s, --save-nir=FILE    write the NIR of a single input shader, "
+           "before the\n"
+           "                         backend, serialized to FILE\n"
+           "  -v, --verbose          print the compiler messages\n",
+           progname);
+}
+
+int
+main(int argc, char *argv[])
+{
+   const char *platform = "skl";
+   const char *entrypoint = "main";
+   const char *output = NULL;
+   const char *save_nir = NULL;
+   unsigned iterations = 1;
+   bool help = false;
+   int c, i;
+
+   const struct option intel_compile_opts[] = {
+      { "help",        no_argument,       (int *) &help, true },
+      { "gen",         required_argument, NULL,          'p' },
+      { "entrypoint",  required_argument, NULL,          'e' },
+      { "iterations",  required_argument, NULL,          'n' },
+      { "threads",     required_argument, NULL,          'j' },
+      { "output",      required_argument, NULL,          'o' },
+      { "save-nir",    required_argument, NULL,          's' },
+      { "verbose",     no_argument,       NULL,          'v' },
+      { NULL,          0,                 NULL,          0 }
+   };
+
+   while ((c = getopt_long(argc, argv, "p:e:n:j:o:s:v",
+                           intel_compile_opts, &i)) != -1) {
+      switch (c) {
+      case 'p':
+         platform = optarg;
+         break;
+      case 'e':
+         entrypoint = optarg;
+         break;
+      case 'n':
+         iterations = MAX2(atoi(optarg), 1);
+         break;
+      case 'j':
+         /* Read by brw_compiler_create. */
+         setenv("INTEL_COMPILER_THREADS", optarg, 1);
+         break;
+      case 'o':
+         output = optarg;
+         break;
+      case 's':
+         save_nir = optarg;
+         break;
+      case 'v':
+         verbose = true;
+         break;
+      case 0:
+         break;
+      default:
+         print_help(argv[0], stderr);
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (help || optind == argc) {
+      print_help(argv[0], help ? stdout : stderr);
+      return help ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+   if (save_nir && argc - optind > 1) {
+      fprintf(stderr, "--save-nir needs a single input shader\n");
+      return EXIT_FAILURE;
+   }
+
+   const int pci_id = gen_device_name_to_pci_device_id(platform);
+   struct gen_device_info devinfo;
+   if (pci_id < 0 || !gen_get_device_info(pci_id, &devinfo)) {
+      fprintf(stderr, "can't find device information: %s\n", platform);
+      return EXIT_FAILURE;
+   }
+
+   FILE *out = stdout;
+   if (output) {
+      out = fopen(output, "w");
+      if (out == NULL) {
+         fprintf(stderr, "can't open %s\n", output);
+         return EXIT_FAILURE;
+      }
+   }
+
+   brw_process_intel_debug_variable();
+
+   void *mem_ctx = ralloc_context(NULL);
+   struct brw_compiler *compiler = brw_compiler_create(mem_ctx, &devinfo);
+
+   /* Configured like in anv. */
+   compiler->shader_debug_log = compiler_debug_log;
+   compiler->shader_perf_log = compiler_perf_log;
+   compiler->supports_pull_constants = false;
+   compiler->constant_buffer_0_is_relative = devinfo.gen < 8;
+   compiler->supports_shader_constants = true;
+
+   bool success = true;
+   for (i = optind; i < argc; i++) {
+      success &= compile_file(compiler, argv[i], platform, entrypoint,
+                              iterations, save_nir, out);
+   }
+
+   ralloc_free(mem_ctx);
+
+   if (out != stdout)
+      fclose(out);
+
+   return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
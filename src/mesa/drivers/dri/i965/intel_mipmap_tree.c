@@ -3225,15 +3225,14 @@ intel_miptree_unmap_s8(struct brw_context *brw,
 
       intel_miptree_get_image_offset(mt, level, slice, &image_x, &image_y);
 
-      for (uint32_t y = 0; y < map->h; y++) {
-	 for (uint32_t x = 0; x < map->w; x++) {
-	    ptrdiff_t offset = intel_offset_S8(mt->surf.row_pitch,
-	                                       image_x + x + map->x,
-	                                       image_y + y + map->y,
-					       brw->has_swizzling);
-	    tiled_s8_map[offset] = untiled_s8_map[y * map->w + x];
-	 }
-      }
+      assert(mt->surf.tiling == ISL_TILING_W);
+      isl_memcpy_linear_to_tiled(image_x + map->x, image_x + map->x + map->w,
+                                 image_y + map->y, image_y + map->y + map->h,
+                                 (char *) tiled_s8_map,
+                                 (const char *) untiled_s8_map,
+                                 mt->surf.row_pitch, map->stride,
+                                 brw->has_swizzling, ISL_TILING_W,
+                                 ISL_MEMCPY, brw->screen->tiled_memcpy_queue);
 
       intel_miptree_unmap_raw(mt);
    }
@@ -3267,15 +3266,14 @@ intel_miptree_map_s8(struct brw_context *brw,
 
       intel_miptree_get_image_offset(mt, level, slice, &image_x, &image_y);
 
-      for (uint32_t y = 0; y < map->h; y++) {
-	 for (uint32_t x = 0; x < map->w; x++) {
-	    ptrdiff_t offset = intel_offset_S8(mt->surf.row_pitch,
-	                                       x + image_x + map->x,
-	                                       y + image_y + map->y,
-					       brw->has_swizzling);
-	    untiled_s8_map[y * map->w + x] = tiled_s8_map[offset];
-	 }
-      }
+      assert(mt->surf.tiling == ISL_TILING_W);
+      isl_memcpy_tiled_to_linear(image_x + map->x, image_x + map->x + map->w,
+                                 image_y + map->y, image_y + map->y + map->h,
+                                 (char *) untiled_s8_map,
+                                 (const char *) tiled_s8_map,
+                                 map->stride, mt->surf.row_pitch,
+                                 brw->has_swizzling, ISL_TILING_W,
+                                 ISL_MEMCPY, brw->screen->tiled_memcpy_queue);
 
       intel_miptree_unmap_raw(mt);
 
@@ -87,7 +87,7 @@ intel_readpixels_tiled_memcpy(struct gl_context * ctx,
    struct brw_bo *bo;
 
    uint32_t cpp;
-   mem_copy_fn mem_copy = NULL;
+   enum isl_memcpy_type copy_type;
 
    /* This fastpath is restricted to specific renderbuffer types:
     * a 2D BGRA, RGBA, L8 or A8 texture. It could be generalized to support
@@ -125,7 +125,7 @@ intel_readpixels_tiled_memcpy(struct gl_context * ctx,
    if (rb->_BaseFormat == GL_RGB)
       return false;
 
-   if (!intel_get_memcpy(rb->Format, format, type, &mem_copy, &cpp))
+   if (!intel_get_memcpy_type(rb->Format, format, type, &copy_type, &cpp))
       return false;
 
    if (!irb->mt ||
@@ -178,7 +178,7 @@ intel_readpixels_tiled_memcpy(struct gl_context * ctx,
     * little creative.  First, we compute the Y-offset of the first row of
     * the renderbuffer (in renderbuffer coordinates).  We then match that
     * with the last row of the client's data.  Finally, we give
-    * tiled_to_linear a negative pitch so that it walks through the
+    * isl_memcpy_tiled_to_linear a negative pitch so that it walks through the
     * client's data backwards as it walks through the renderbufer forwards.
     */
    if (rb->Name == 0) {
@@ -198,7 +198,7 @@ intel_readpixels_tiled_memcpy(struct gl_context * ctx,
        pack->Alignment, pack->RowLength, pack->SkipPixels,
        pack->SkipRows);
 
-   tiled_to_linear(
+   isl_memcpy_tiled_to_linear(
       xoffset * cpp, (xoffset + width) * cpp,
       yoffset, yoffset + height,
       pixels,
@@ -206,7 +206,8 @@ intel_readpixels_tiled_memcpy(struct gl_context * ctx,
       dst_pitch, irb->mt->surf.row_pitch,
       brw->has_swizzling,
       irb->mt->surf.tiling,
-      mem_copy
+      copy_type,
+      brw->screen->tiled_memcpy_queue
    );
 
    brw_bo_unmap(bo);
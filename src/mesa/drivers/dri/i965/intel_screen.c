@@ -36,10 +36,13 @@
 #include "main/version.h"
 #include "swrast/s_renderbuffer.h"
 #include "util/ralloc.h"
+#include "util/debug.h"
+#include "util/u_queue.h"
 #include "util/disk_cache.h"
 #include "brw_defines.h"
 #include "brw_state.h"
 #include "compiler/nir/nir.h"
+#include "blorp/blorp.h"
 
 #include "utils.h"
 #include "util/disk_cache.h"
@@ -1663,6 +1666,35 @@ intel_get_integer(struct intel_screen *screen, int param)
    return -1;
 }
 
+static void
+destroy_tiled_memcpy_queue(void *queue)
+{
+   util_queue_destroy((struct util_queue *) queue);
+}
+
+static void
+intel_screen_init_tiled_memcpy_queue(struct intel_screen *screen)
+{
+   /* The calling thread copies its share as well, so leave it a core. */
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   unsigned num_threads =
+      env_var_as_unsigned("INTEL_TILED_MEMCPY_THREADS",
+                          num_cpus > 1 ? MIN2(num_cpus - 1, 3) : 0);
+
+   if (num_threads == 0)
+      return;
+
+   struct util_queue *queue = ralloc(screen, struct util_queue);
+   if (!util_queue_init(queue, "i965_memcpy", 16, num_threads,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+      ralloc_free(queue);
+      return;
+   }
+
+   ralloc_set_destructor(queue, destroy_tiled_memcpy_queue);
+   screen->tiled_memcpy_queue = queue;
+}
+
 static void
 intelDestroyScreen(__DRIscreen * sPriv)
 {
@@ -1671,6 +1703,7 @@ intelDestroyScreen(__DRIscreen * sPriv)
    brw_bufmgr_destroy(screen->bufmgr);
    driDestroyOptionInfo(&screen->optionCache);
 
+   blorp_program_cache_destroy(screen->blorp_program_cache);
    disk_cache_destroy(screen->disk_cache);
 
    ralloc_free(screen);
@@ -2723,6 +2756,8 @@ __DRIconfig **intelInitScreen2(__DRIscreen *dri_screen)
    screen->compiler->shader_debug_log = shader_debug_log_mesa;
    screen->compiler->shader_perf_log = shader_perf_log_mesa;
 
+   intel_screen_init_tiled_memcpy_queue(screen);
+
    /* Changing the meaning of constant buffer pointers from a dynamic state
     * offset to an absolute address is only safe if the kernel isolates other
     * contexts from our changes.
@@ -2749,6 +2784,8 @@ __DRIconfig **intelInitScreen2(__DRIscreen *dri_screen)
    }
 
    brw_disk_cache_init(screen);
+   screen->blorp_program_cache =
+      blorp_program_cache_create(screen->disk_cache);
 
    return (const __DRIconfig**) intel_screen_make_configs(dri_screen);
 }
@@ -44,6 +44,8 @@
 extern "C" {
 #endif
 
+struct blorp_program_cache;
+
 struct intel_screen
 {
    int deviceID;
@@ -94,6 +96,12 @@ struct intel_screen
 
    struct brw_compiler *compiler;
 
+   /**
+    * Worker threads splitting up large tiled memcpy uploads and readbacks,
+    * or NULL to copy on the calling thread only.
+    */
+   struct util_queue *tiled_memcpy_queue;
+
    /**
    * Configuration cache with default values for all contexts
    */
@@ -120,6 +128,12 @@ struct intel_screen
    enum isl_format mesa_to_isl_render_format[MESA_FORMAT_COUNT];
 
    struct disk_cache *disk_cache;
+
+   /**
+    * BLORP programs compiled by any context of the screen, backed by
+    * disk_cache.
+    */
+   struct blorp_program_cache *blorp_program_cache;
 };
 
 extern void intelDestroyContext(__DRIcontext * driContextPriv);
@@ -27,6 +27,8 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "util/format_r11g11b10f.h"
+#include "util/u_parallel.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(4, 1, 1, 1, 4, 0, 1, 2, 3);
@@ -238,36 +240,268 @@ convert_ubyte_rgba_to_bgra(size_t width, size_t height,
 
 
 /**
- * This can be used to convert between most color formats.
- *
- * Limitations:
- * - This function doesn't handle GL_COLOR_INDEX or YCBCR formats.
- * - This function doesn't handle byte-swapping or transferOps, these should
- *   be handled by the caller.
+ * Swaps the r/b channels of 8-bit RGBA pixels and clears the alpha channel,
+ * which is what packing to a BGRX format does.
+ */
+static void
+convert_ubyte_rgba_to_bgrx(size_t width, size_t height,
+                           const uint8_t *src, size_t src_stride,
+                           uint8_t *dst, size_t dst_stride)
+{
+   int row;
+
+   for (row = 0; row < height; row++) {
+      const GLuint *s = (const GLuint *) src;
+      GLuint *d = (GLuint *) dst;
+      int i;
+      for (i = 0; i < width; i++) {
+         d[i] = ( (s[i] &     0xff00) |
+                 ((s[i] &       0xff) << 16) |
+                 ((s[i] &   0xff0000) >> 16));
+      }
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
+
+
+/**
+ * Expands a 24-bit RGB pixel to a 32-bit one with a 0xff alpha.
+ */
+static inline uint32_t
+ubyte_rgb_to_rgba(uint32_t rgb, bool swap_rb)
+{
+   if (swap_rb) {
+      rgb = ((rgb & 0xff) << 16) | (rgb & 0xff00) | ((rgb >> 16) & 0xff);
+   }
+   return rgb | 0xff000000;
+}
+
+
+static inline void
+convert_ubyte_rgb(size_t width, size_t height,
+                  const uint8_t *src, size_t src_stride,
+                  uint8_t *dst, size_t dst_stride, bool swap_rb)
+{
+   int row;
+
+   for (row = 0; row < height; row++) {
+      const uint8_t *s = src;
+      GLuint *d = (GLuint *) dst;
+      int i;
+
+      /* Four pixels are three 32-bit words of source */
+      for (i = 0; i + 4 <= width; i += 4) {
+         GLuint w[3];
+         memcpy(w, s, sizeof(w));
+         d[i + 0] = ubyte_rgb_to_rgba(w[0] & 0xffffff, swap_rb);
+         d[i + 1] = ubyte_rgb_to_rgba(((w[0] >> 24) | (w[1] << 8)) & 0xffffff,
+                                      swap_rb);
+         d[i + 2] = ubyte_rgb_to_rgba(((w[1] >> 16) | (w[2] << 16)) & 0xffffff,
+                                      swap_rb);
+         d[i + 3] = ubyte_rgb_to_rgba(w[2] >> 8, swap_rb);
+         s += 12;
+      }
+      for (; i < width; i++) {
+         d[i] = ubyte_rgb_to_rgba(s[0] | (s[1] << 8) | (s[2] << 16), swap_rb);
+         s += 3;
+      }
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
+
+static void
+convert_ubyte_rgb_to_rgba(size_t width, size_t height,
+                          const uint8_t *src, size_t src_stride,
+                          uint8_t *dst, size_t dst_stride)
+{
+   convert_ubyte_rgb(width, height, src, src_stride, dst, dst_stride, false);
+}
+
+static void
+convert_ubyte_rgb_to_bgra(size_t width, size_t height,
+                          const uint8_t *src, size_t src_stride,
+                          uint8_t *dst, size_t dst_stride)
+{
+   convert_ubyte_rgb(width, height, src, src_stride, dst, dst_stride, true);
+}
+
+
+static inline void
+convert_ubyte_to_565(size_t width, size_t height,
+                     const uint8_t *src, size_t src_stride,
+                     uint8_t *dst, size_t dst_stride, int src_channels)
+{
+   int row;
+
+   for (row = 0; row < height; row++) {
+      const uint8_t *s = src;
+      uint16_t *d = (uint16_t *) dst;
+      int i;
+      for (i = 0; i < width; i++) {
+         d[i] = (_mesa_unorm_to_unorm(s[0], 8, 5) << 11) |
+                (_mesa_unorm_to_unorm(s[1], 8, 6) << 5) |
+                 _mesa_unorm_to_unorm(s[2], 8, 5);
+         s += src_channels;
+      }
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
+
+static void
+convert_ubyte_rgb_to_565(size_t width, size_t height,
+                         const uint8_t *src, size_t src_stride,
+                         uint8_t *dst, size_t dst_stride)
+{
+   convert_ubyte_to_565(width, height, src, src_stride, dst, dst_stride, 3);
+}
+
+static void
+convert_ubyte_rgba_to_565(size_t width, size_t height,
+                          const uint8_t *src, size_t src_stride,
+                          uint8_t *dst, size_t dst_stride)
+{
+   convert_ubyte_to_565(width, height, src, src_stride, dst, dst_stride, 4);
+}
+
+
+static void
+convert_float_rgb_to_r11g11b10f(size_t width, size_t height,
+                                const uint8_t *src, size_t src_stride,
+                                uint8_t *dst, size_t dst_stride)
+{
+   int row;
+
+   for (row = 0; row < height; row++) {
+      const float *s = (const float *) src;
+      GLuint *d = (GLuint *) dst;
+      int i;
+      for (i = 0; i < width; i++)
+         d[i] = float3_to_r11g11b10f(s + i * 3);
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
+
+
+static inline void
+convert_float_to_half(size_t width, size_t height,
+                      const uint8_t *src, size_t src_stride,
+                      uint8_t *dst, size_t dst_stride, int src_channels)
+{
+   const uint16_t one = _mesa_float_to_half(1.0f);
+   int row;
+
+   for (row = 0; row < height; row++) {
+      const float *s = (const float *) src;
+      uint16_t *d = (uint16_t *) dst;
+      int i;
+      for (i = 0; i < width; i++) {
+         d[0] = _mesa_float_to_half(s[0]);
+         d[1] = _mesa_float_to_half(s[1]);
+         d[2] = _mesa_float_to_half(s[2]);
+         d[3] = src_channels == 4 ? _mesa_float_to_half(s[3]) : one;
+         s += src_channels;
+         d += 4;
+      }
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
+
+static void
+convert_float_rgb_to_half(size_t width, size_t height,
+                          const uint8_t *src, size_t src_stride,
+                          uint8_t *dst, size_t dst_stride)
+{
+   convert_float_to_half(width, height, src, src_stride, dst, dst_stride, 3);
+}
+
+static void
+convert_float_rgba_to_half(size_t width, size_t height,
+                           const uint8_t *src, size_t src_stride,
+                           uint8_t *dst, size_t dst_stride)
+{
+   convert_float_to_half(width, height, src, src_stride, dst, dst_stride, 4);
+}
+
+
+#define UBYTE_RGBA MESA_ARRAY_FORMAT(1, 0, 0, 1, 4, 0, 1, 2, 3)
+#define UBYTE_BGRA MESA_ARRAY_FORMAT(1, 0, 0, 1, 4, 2, 1, 0, 3)
+#define UBYTE_RGB  MESA_ARRAY_FORMAT(1, 0, 0, 1, 3, 0, 1, 2, 5)
+#define UBYTE_BGR  MESA_ARRAY_FORMAT(1, 0, 0, 1, 3, 2, 1, 0, 5)
+#define FLOAT_RGBA MESA_ARRAY_FORMAT(4, 1, 1, 1, 4, 0, 1, 2, 3)
+#define FLOAT_RGB  MESA_ARRAY_FORMAT(4, 1, 1, 1, 3, 0, 1, 2, 5)
+
+/**
+ * Conversions done in a single pass, without the RGBA temporaries or the
+ * per-channel swizzling of the generic paths, for common upload and download
+ * format pairs.  They give exactly the same results as the generic paths.
  *
- * \param void_dst  The address where converted color data will be stored.
- *                  The caller must ensure that the buffer is large enough
- *                  to hold the converted pixel data.
- * \param dst_format  The destination color format. It can be a mesa_format
- *                    or a mesa_array_format represented as an uint32_t.
- * \param dst_stride  The stride of the destination format in bytes.
- * \param void_src  The address of the source color data to convert.
- * \param src_format  The source color format. It can be a mesa_format
- *                    or a mesa_array_format represented as an uint32_t.
- * \param src_stride  The stride of the source format in bytes.
- * \param width  The width, in pixels, of the source image to convert.
- * \param height  The height, in pixels, of the source image to convert.
- * \param rebase_swizzle  A swizzle transform to apply during the conversion,
- *                        typically used to match a different internal base
- *                        format involved. NULL if no rebase transform is needed
- *                        (i.e. the internal base format and the base format of
- *                        the dst or the src -depending on whether we are doing
- *                        an upload or a download respectively- are the same).
+ * The source and destination formats are either mesa_formats or array
+ * formats, as passed to _mesa_format_convert().
  */
-void
-_mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
-                     void *void_src, uint32_t src_format, size_t src_stride,
-                     size_t width, size_t height, uint8_t *rebase_swizzle)
+static const struct {
+   uint32_t dst_format;
+   uint32_t src_format;
+   void (*convert)(size_t width, size_t height,
+                   const uint8_t *src, size_t src_stride,
+                   uint8_t *dst, size_t dst_stride);
+} direct_conversions[] = {
+   { MESA_FORMAT_B8G8R8A8_UNORM, UBYTE_RGBA, convert_ubyte_rgba_to_bgra },
+   { MESA_FORMAT_B8G8R8X8_UNORM, UBYTE_RGBA, convert_ubyte_rgba_to_bgrx },
+   { MESA_FORMAT_R8G8B8A8_UNORM, UBYTE_BGRA, convert_ubyte_rgba_to_bgra },
+   { MESA_FORMAT_B8G8R8A8_UNORM, UBYTE_RGB,  convert_ubyte_rgb_to_bgra },
+   { MESA_FORMAT_B8G8R8X8_UNORM, UBYTE_RGB,  convert_ubyte_rgb_to_bgra },
+   { MESA_FORMAT_R8G8B8A8_UNORM, UBYTE_RGB,  convert_ubyte_rgb_to_rgba },
+   { MESA_FORMAT_R8G8B8X8_UNORM, UBYTE_RGB,  convert_ubyte_rgb_to_rgba },
+   { MESA_FORMAT_B8G8R8A8_UNORM, UBYTE_BGR,  convert_ubyte_rgb_to_rgba },
+   { MESA_FORMAT_B8G8R8X8_UNORM, UBYTE_BGR,  convert_ubyte_rgb_to_rgba },
+   { MESA_FORMAT_B5G6R5_UNORM,   UBYTE_RGB,  convert_ubyte_rgb_to_565 },
+   { MESA_FORMAT_B5G6R5_UNORM,   UBYTE_RGBA, convert_ubyte_rgba_to_565 },
+   { MESA_FORMAT_R11G11B10_FLOAT, FLOAT_RGB, convert_float_rgb_to_r11g11b10f },
+   { MESA_FORMAT_RGBA_FLOAT16,   FLOAT_RGB,  convert_float_rgb_to_half },
+   { MESA_FORMAT_RGBX_FLOAT16,   FLOAT_RGB,  convert_float_rgb_to_half },
+   { MESA_FORMAT_RGBA_FLOAT16,   FLOAT_RGBA, convert_float_rgba_to_half },
+};
+
+
+static int
+find_direct_conversion(uint32_t dst_format, uint32_t src_format)
+{
+   int i;
+
+#ifdef MESA_LITTLE_ENDIAN
+   for (i = 0; i < ARRAY_SIZE(direct_conversions); i++) {
+      if (direct_conversions[i].dst_format == dst_format &&
+          direct_conversions[i].src_format == src_format)
+         return i;
+   }
+#endif
+
+   return -1;
+}
+
+
+/**
+ * Whether _mesa_format_convert() converts from \p src_format to
+ * \p dst_format in a single pass, without going through an RGBA
+ * intermediate or the generic swizzle code.
+ */
+bool
+_mesa_format_convert_is_direct(uint32_t dst_format, uint32_t src_format)
+{
+   return find_direct_conversion(dst_format, src_format) >= 0;
+}
+
+
+/* Converts a band of rows, see _mesa_format_convert() */
+static void
+format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
+               void *void_src, uint32_t src_format, size_t src_stride,
+               size_t width, size_t height, uint8_t *rebase_swizzle)
 {
    uint8_t *dst = (uint8_t *)void_dst;
    uint8_t *src = (uint8_t *)void_src;
@@ -327,6 +561,13 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
          return;
       }
 
+      int direct = find_direct_conversion(dst_format, src_format);
+      if (direct >= 0) {
+         direct_conversions[direct].convert(width, height, src, src_stride,
+                                            dst, dst_stride);
+         return;
+      }
+
       /* Handle the cases where we can directly unpack */
       if (!src_format_is_mesa_array_format) {
          if (dst_array_format == RGBA32_FLOAT) {
@@ -371,18 +612,11 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
             return;
          } else if (src_array_format == RGBA8_UBYTE) {
             assert(!_mesa_is_format_integer_color(dst_format));
-
-            if (dst_format == MESA_FORMAT_B8G8R8A8_UNORM) {
-               convert_ubyte_rgba_to_bgra(width, height, src, src_stride,
-                                          dst, dst_stride);
-            }
-            else {
-               for (row = 0; row < height; ++row) {
-                  _mesa_pack_ubyte_rgba_row(dst_format, width,
-                                            (const uint8_t (*)[4])src, dst);
-                  src += src_stride;
-                  dst += dst_stride;
-               }
+            for (row = 0; row < height; ++row) {
+               _mesa_pack_ubyte_rgba_row(dst_format, width,
+                                         (const uint8_t (*)[4])src, dst);
+               src += src_stride;
+               dst += dst_stride;
             }
             return;
          } else if (src_array_format == RGBA32_UINT &&
@@ -647,6 +881,90 @@ _mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
    }
 }
 
+struct format_convert_job {
+   uint8_t *dst;
+   uint32_t dst_format;
+   size_t dst_stride;
+   uint8_t *src;
+   uint32_t src_format;
+   size_t src_stride;
+   size_t width;
+   uint8_t *rebase_swizzle;
+};
+
+static void
+format_convert_rows(void *data, unsigned y1, unsigned y2)
+{
+   const struct format_convert_job *job = data;
+
+   format_convert(job->dst + y1 * job->dst_stride, job->dst_format,
+                  job->dst_stride,
+                  job->src + y1 * job->src_stride, job->src_format,
+                  job->src_stride,
+                  job->width, y2 - y1, job->rebase_swizzle);
+}
+
+static unsigned
+format_bytes(uint32_t format)
+{
+   if (_mesa_format_is_mesa_array_format(format)) {
+      return _mesa_array_format_get_type_size(format) *
+             _mesa_array_format_get_num_channels(format);
+   }
+
+   return _mesa_get_format_bytes(format);
+}
+
+/**
+ * This can be used to convert between most color formats.
+ *
+ * Limitations:
+ * - This function doesn't handle GL_COLOR_INDEX or YCBCR formats.
+ * - This function doesn't handle byte-swapping or transferOps, these should
+ *   be handled by the caller.
+ *
+ * \param void_dst  The address where converted color data will be stored.
+ *                  The caller must ensure that the buffer is large enough
+ *                  to hold the converted pixel data.
+ * \param dst_format  The destination color format. It can be a mesa_format
+ *                    or a mesa_array_format represented as an uint32_t.
+ * \param dst_stride  The stride of the destination format in bytes.
+ * \param void_src  The address of the source color data to convert.
+ * \param src_format  The source color format. It can be a mesa_format
+ *                    or a mesa_array_format represented as an uint32_t.
+ * \param src_stride  The stride of the source format in bytes.
+ * \param width  The width, in pixels, of the source image to convert.
+ * \param height  The height, in pixels, of the source image to convert.
+ * \param rebase_swizzle  A swizzle transform to apply during the conversion,
+ *                        typically used to match a different internal base
+ *                        format involved. NULL if no rebase transform is needed
+ *                        (i.e. the internal base format and the base format of
+ *                        the dst or the src -depending on whether we are doing
+ *                        an upload or a download respectively- are the same).
+ */
+void
+_mesa_format_convert(void *void_dst, uint32_t dst_format, size_t dst_stride,
+                     void *void_src, uint32_t src_format, size_t src_stride,
+                     size_t width, size_t height, uint8_t *rebase_swizzle)
+{
+   struct format_convert_job job = {
+      .dst = void_dst,
+      .dst_format = dst_format,
+      .dst_stride = dst_stride,
+      .src = void_src,
+      .src_format = src_format,
+      .src_stride = src_stride,
+      .width = width,
+      .rebase_swizzle = rebase_swizzle,
+   };
+
+   /* Large images are converted in bands of rows on the shared pool. */
+   util_parallel_rows(util_parallel_queue(), height, 1,
+                      width * MAX2(format_bytes(dst_format),
+                                   format_bytes(src_format)),
+                      format_convert_rows, &job);
+}
+
 static const uint8_t map_identity[7] = { 0, 1, 2, 3, 4, 5, 6 };
 static const uint8_t map_3210[7] = { 3, 2, 1, 0, 4, 5, 6 };
 static const uint8_t map_1032[7] = { 1, 0, 3, 2, 4, 5, 6 };
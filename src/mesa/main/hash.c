@@ -37,7 +37,49 @@
 #include "errors.h"
 #include "glheader.h"
 #include "hash.h"
+#include "util/bitscan.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
+
+
+/**
+ * Lookup array for small keys.
+ *
+ * GL names are usually allocated contiguously from 1, so most of them fit
+ * in a small array, which _mesa_HashLookup() reads without locking.  The
+ * array only grows; an array that has been replaced may still be in use by
+ * a concurrent reader, so it is kept until the table is deleted.  Since the
+ * sizes double, this at most doubles the memory used.
+ */
+struct _mesa_HashDense {
+   GLuint Size;
+   struct _mesa_HashDense *Prev;   /**< the array this one replaced */
+   void *Data[];
+};
+
+/** Smallest and largest size of the lookup array */
+#define DENSE_MIN_SIZE 256
+#define DENSE_MAX_SIZE (1 << 20)
+
+/**
+ * Publishes a pointer to the lock-free readers of the lookup array.
+ *
+ * With the __atomic builtins p_atomic_set() is a release store, but with
+ * the older __sync ones it is a plain store, which needs a full barrier
+ * first so that what it points to is visible before the pointer is.  With
+ * other atomics, no lookup array is made and lookups always take the mutex.
+ */
+#if defined(USE_GCC_ATOMIC_BUILTINS)
+#define DENSE_LOOKUPS true
+#define dense_publish(_v, _i) p_atomic_set(_v, _i)
+#elif defined(PIPE_ATOMIC_GCC_INTRINSIC)
+#define DENSE_LOOKUPS true
+#define dense_publish(_v, _i) \
+   do { __sync_synchronize(); p_atomic_set(_v, _i); } while (0)
+#else
+#define DENSE_LOOKUPS false
+#define dense_publish(_v, _i) p_atomic_set(_v, _i)
+#endif
 
 
 /**
@@ -94,6 +136,12 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   while (table->Dense) {
+      struct _mesa_HashDense *prev = table->Dense->Prev;
+      free(table->Dense);
+      table->Dense = prev;
+   }
+
    mtx_destroy(&table->Mutex);
    free(table);
 }
@@ -112,6 +160,9 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
    assert(table);
    assert(key);
 
+   if (table->Dense && key < table->Dense->Size)
+      return table->Dense->Data[key];
+
    if (key == DELETED_KEY_VALUE)
       return table->deleted_key_data;
 
@@ -127,6 +178,8 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * Keys covered by the lookup array are read without taking the mutex.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -136,7 +189,12 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   struct _mesa_HashDense *dense = p_atomic_read(&table->Dense);
    void *res;
+
+   if (dense && key < dense->Size)
+      return p_atomic_read(&dense->Data[key]);
+
    _mesa_HashLockMutex(table);
    res = _mesa_HashLookup_unlocked(table, key);
    _mesa_HashUnlockMutex(table);
@@ -162,6 +220,55 @@ _mesa_HashLookupLocked(struct _mesa_HashTable *table, GLuint key)
 }
 
 
+/**
+ * Store data for a key in the lookup array, growing it if the key is beyond
+ * its end and the keys in the table are dense enough for it to be worth it.
+ * Called with the mutex held, after the hash table has been updated.
+ */
+static void
+dense_set(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+   struct _mesa_HashDense *dense = table->Dense, *new_dense;
+   GLuint size = dense ? dense->Size : 0;
+   GLuint new_size;
+
+   if (key < size) {
+      dense_publish(&dense->Data[key], data);
+      return;
+   }
+
+   if (!DENSE_LOOKUPS || !data || key >= DENSE_MAX_SIZE)
+      return;
+
+   new_size = MAX2(1u << util_last_bit(key), DENSE_MIN_SIZE);
+   if (new_size > DENSE_MIN_SIZE &&
+       new_size / 4 > _mesa_hash_table_num_entries(table->ht) + 1)
+      return;
+
+   new_dense = malloc(sizeof(*new_dense) + new_size * sizeof(void *));
+   if (!new_dense)
+      return;
+
+   new_dense->Size = new_size;
+   new_dense->Prev = dense;
+   if (size)
+      memcpy(new_dense->Data, dense->Data, size * sizeof(void *));
+   memset(new_dense->Data + size, 0, (new_size - size) * sizeof(void *));
+
+   /* Pick up keys that were too far out for the old array. */
+   struct hash_entry *entry;
+   hash_table_foreach(table->ht, entry) {
+      GLuint k = (uintptr_t)entry->key;
+      if (k >= size && k < new_size)
+         new_dense->Data[k] = entry->data;
+   }
+   if (size <= DELETED_KEY_VALUE)
+      new_dense->Data[DELETED_KEY_VALUE] = table->deleted_key_data;
+
+   dense_publish(&table->Dense, new_dense);
+}
+
+
 static inline void
 _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
 {
@@ -184,6 +291,8 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
          _mesa_hash_table_insert_pre_hashed(table->ht, hash, uint_key(key), data);
       }
    }
+
+   dense_set(table, key, data);
 }
 
 
@@ -252,6 +361,8 @@ _mesa_HashRemove_unlocked(struct _mesa_HashTable *table, GLuint key)
                                                  uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
    }
+
+   dense_set(table, key, NULL);
 }
 
 
@@ -296,6 +407,10 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
       callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
       table->deleted_key_data = NULL;
    }
+   if (table->Dense) {
+      for (GLuint i = 0; i < table->Dense->Size; i++)
+         p_atomic_set(&table->Dense->Data[i], NULL);
+   }
    table->InDeleteAll = GL_FALSE;
    _mesa_HashUnlockMutex(table);
 }
@@ -36,6 +36,10 @@
 #include "imports.h"
 #include "c11/threads.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Magic GLuint object name that gets stored outside of the struct hash_table.
  *
@@ -93,11 +97,19 @@ uint_key(GLuint id)
 }
 /** @} */
 
+struct _mesa_HashDense;
+
 /**
  * The hash table data structure.
  */
 struct _mesa_HashTable {
    struct hash_table *ht;
+   /**
+    * Array indexed by key mirroring the contents of the table for small keys,
+    * so that _mesa_HashLookup() can read it without taking the mutex.  Only
+    * written with the mutex held.
+    */
+   struct _mesa_HashDense *Dense;
    GLuint MaxKey;                        /**< highest key inserted so far */
    mtx_t Mutex;                          /**< mutual exclusion lock */
    GLboolean InDeleteAll;                /**< Debug check */
@@ -175,5 +187,9 @@ _mesa_HashNumEntries(const struct _mesa_HashTable *table);
 
 extern void _mesa_test_hash_functions(void);
 
+#ifdef __cplusplus
+}
+#endif
+
 
 #endif
@@ -37,6 +37,7 @@
 #include "imports.h"
 #include "macros.h"
 #include "mtypes.h"
+#include "util/u_parallel.h"
 
 
 
@@ -1015,3 +1016,61 @@ _mesa_swap_bytes_2d_image(GLenum format, GLenum type,
       }
    }
 }
+
+
+struct copy_mapped_rows_job {
+   GLubyte *dst;
+   GLint dst_stride;
+   const GLubyte *src;
+   GLint src_stride;
+   size_t row_bytes;
+};
+
+static void
+copy_mapped_rows(void *data, unsigned y1, unsigned y2)
+{
+   const struct copy_mapped_rows_job *job = data;
+   GLubyte *dst = job->dst + (ptrdiff_t) y1 * job->dst_stride;
+   const GLubyte *src = job->src + (ptrdiff_t) y1 * job->src_stride;
+   size_t row_bytes = job->row_bytes;
+   unsigned height = y2 - y1;
+   unsigned row;
+
+   if (job->dst_stride == row_bytes && job->src_stride == row_bytes) {
+      row_bytes *= height;
+      height = 1;
+   }
+
+   for (row = 0; row < height; row++) {
+      memcpy(dst, src, row_bytes);
+      dst += job->dst_stride;
+      src += job->src_stride;
+   }
+}
+
+/**
+ * Copy rows of pixels out of a mapped texture or renderbuffer.
+ *
+ * Large copies are split between the pixel threads.  Either stride may be
+ * negative.
+ *
+ * This uses plain loads.  Drivers that hand out write-combined mappings
+ * read them with _mesa_streaming_load_memcpy() themselves, as i965 does in
+ * intel_miptree_map_movntdqa(), since only they know how a buffer is mapped.
+ */
+void
+_mesa_copy_mapped_rows(GLvoid *dst, GLint dst_stride,
+                       const GLvoid *src, GLint src_stride,
+                       size_t row_bytes, GLsizei height)
+{
+   struct copy_mapped_rows_job job = {
+      .dst = dst,
+      .dst_stride = dst_stride,
+      .src = src,
+      .src_stride = src_stride,
+      .row_bytes = row_bytes,
+   };
+
+   util_parallel_rows(util_parallel_queue(), height, 1, row_bytes,
+                      copy_mapped_rows, &job);
+}
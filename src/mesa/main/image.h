@@ -29,6 +29,10 @@
 
 #include "glheader.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
 struct gl_pixelstore_attrib;
 struct gl_framebuffer;
@@ -140,4 +144,13 @@ _mesa_swap_bytes_2d_image(GLenum format, GLenum type,
                           GLsizei width, GLsizei height,
                           GLvoid *dst, const GLvoid *src);
 
+void
+_mesa_copy_mapped_rows(GLvoid *dst, GLint dst_stride,
+                       const GLvoid *src, GLint src_stride,
+                       size_t row_bytes, GLsizei height);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -41,6 +41,12 @@
 #include "util/half_float.h"
 #include "util/format_rgb9e5.h"
 #include "util/format_r11g11b10f.h"
+#include "util/format_srgb.h"
+#include "util/u_parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 /**
@@ -163,6 +169,257 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#ifdef __SSE2__
+/**
+ * \name SSE2 inner loops of do_row and do_row_3d
+ *
+ * These halve the width of the rows, rounding the same way as the C code,
+ * and return the number of destination pixels done.  The caller finishes
+ * the row.
+ */
+/*@{*/
+static GLuint
+halve_row_ubyte4_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                      GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + i * 8));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + i * 8 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + i * 8));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + i * 8 + 16));
+      /* vertical sums, two source pixels each */
+      const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                       _mm_unpacklo_epi8(b0, zero));
+      const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                       _mm_unpackhi_epi8(b0, zero));
+      const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                       _mm_unpacklo_epi8(b1, zero));
+      const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                       _mm_unpackhi_epi8(b1, zero));
+      /* horizontal sums, two destination pixels each */
+      const __m128i d0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1),
+                                       _mm_unpackhi_epi64(s0, s1));
+      const __m128i d1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3),
+                                       _mm_unpackhi_epi64(s2, s3));
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4),
+                       _mm_packus_epi16(_mm_srli_epi16(d0, 2),
+                                        _mm_srli_epi16(d1, 2)));
+   }
+
+   return i;
+}
+
+static GLuint
+halve_row_ubyte2_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                      GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 8 <= dstWidth; i += 8) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + i * 4));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + i * 4 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + i * 4));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + i * 4 + 16));
+      /* vertical sums, four source pixels each */
+      const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                       _mm_unpacklo_epi8(b0, zero));
+      const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                       _mm_unpackhi_epi8(b0, zero));
+      const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                       _mm_unpacklo_epi8(b1, zero));
+      const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                       _mm_unpackhi_epi8(b1, zero));
+      /* horizontal sums of the even and odd pixels */
+#define EVEN(x) _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 0, 2, 0))
+#define ODD(x) _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 1, 3, 1))
+      const __m128i d0 = _mm_add_epi16(_mm_unpacklo_epi64(EVEN(s0), EVEN(s1)),
+                                       _mm_unpacklo_epi64(ODD(s0), ODD(s1)));
+      const __m128i d1 = _mm_add_epi16(_mm_unpacklo_epi64(EVEN(s2), EVEN(s3)),
+                                       _mm_unpacklo_epi64(ODD(s2), ODD(s3)));
+#undef EVEN
+#undef ODD
+
+      _mm_storeu_si128((__m128i *) (dst + i * 2),
+                       _mm_packus_epi16(_mm_srli_epi16(d0, 2),
+                                        _mm_srli_epi16(d1, 2)));
+   }
+
+   return i;
+}
+
+static GLuint
+halve_row_ubyte1_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                      GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i one = _mm_set1_epi16(1);
+   GLuint i;
+
+   for (i = 0; i + 16 <= dstWidth; i += 16) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + i * 2));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + i * 2 + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + i * 2));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + i * 2 + 16));
+      /* vertical sums, then horizontal sums of neighbours in 32 bits */
+      const __m128i s0 = _mm_madd_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                                      _mm_unpacklo_epi8(b0, zero)),
+                                        one);
+      const __m128i s1 = _mm_madd_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                                      _mm_unpackhi_epi8(b0, zero)),
+                                        one);
+      const __m128i s2 = _mm_madd_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                                      _mm_unpacklo_epi8(b1, zero)),
+                                        one);
+      const __m128i s3 = _mm_madd_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                                      _mm_unpackhi_epi8(b1, zero)),
+                                        one);
+      const __m128i d0 = _mm_srli_epi16(_mm_packs_epi32(s0, s1), 2);
+      const __m128i d1 = _mm_srli_epi16(_mm_packs_epi32(s2, s3), 2);
+
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(d0, d1));
+   }
+
+   return i;
+}
+
+static GLuint
+halve_row_float4_sse2(const GLfloat *rowA, const GLfloat *rowB,
+                      GLuint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLuint i;
+
+   for (i = 0; i < dstWidth; i++) {
+      const __m128 aj = _mm_loadu_ps(rowA + i * 8);
+      const __m128 ak = _mm_loadu_ps(rowA + i * 8 + 4);
+      const __m128 bj = _mm_loadu_ps(rowB + i * 8);
+      const __m128 bk = _mm_loadu_ps(rowB + i * 8 + 4);
+
+      /* same order of additions as the C code */
+      _mm_storeu_ps(dst + i * 4,
+                    _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj),
+                                          bk),
+                               quarter));
+   }
+
+   return i;
+}
+
+static GLuint
+halve_row_3d_ubyte4_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                         const GLubyte *rowC, const GLubyte *rowD,
+                         GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i four = _mm_set1_epi16(4);
+   GLuint i;
+
+   for (i = 0; i + 2 <= dstWidth; i += 2) {
+      const __m128i a = _mm_loadu_si128((const __m128i *) (rowA + i * 8));
+      const __m128i b = _mm_loadu_si128((const __m128i *) (rowB + i * 8));
+      const __m128i c = _mm_loadu_si128((const __m128i *) (rowC + i * 8));
+      const __m128i d = _mm_loadu_si128((const __m128i *) (rowD + i * 8));
+      /* vertical sums of the four rows, two source pixels each */
+      const __m128i s0 =
+         _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                     _mm_unpacklo_epi8(b, zero)),
+                       _mm_add_epi16(_mm_unpacklo_epi8(c, zero),
+                                     _mm_unpacklo_epi8(d, zero)));
+      const __m128i s1 =
+         _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                     _mm_unpackhi_epi8(b, zero)),
+                       _mm_add_epi16(_mm_unpackhi_epi8(c, zero),
+                                     _mm_unpackhi_epi8(d, zero)));
+      __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1),
+                                  _mm_unpackhi_epi64(s0, s1));
+
+      sum = _mm_srli_epi16(_mm_add_epi16(sum, four), 3);
+      _mm_storel_epi64((__m128i *) (dst + i * 4), _mm_packus_epi16(sum, sum));
+   }
+
+   return i;
+}
+/*@}*/
+#endif
+
+
+/**
+ * do_row() for 8-bit sRGB formats.  The components set in srgbMask are
+ * averaged in linear space, the others (alpha) like GL_UNSIGNED_BYTE.
+ */
+static void
+do_row_srgb8(GLuint comps, GLuint srgbMask, GLint srcWidth,
+             const GLubyte *rowA, const GLubyte *rowB,
+             GLint dstWidth, GLubyte *dst)
+{
+   const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
+   const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
+   GLuint i, j, k, c;
+
+   for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+        i++, j += colStride, k += colStride) {
+      for (c = 0; c < comps; c++) {
+         const GLubyte aj = rowA[j * comps + c], ak = rowA[k * comps + c];
+         const GLubyte bj = rowB[j * comps + c], bk = rowB[k * comps + c];
+
+         if (srgbMask & (1 << c)) {
+            const GLfloat sum = util_format_srgb_8unorm_to_linear_float(aj) +
+                                util_format_srgb_8unorm_to_linear_float(ak) +
+                                util_format_srgb_8unorm_to_linear_float(bj) +
+                                util_format_srgb_8unorm_to_linear_float(bk);
+            dst[i * comps + c] =
+               util_format_linear_float_to_srgb_8unorm(sum * 0.25F);
+         }
+         else {
+            dst[i * comps + c] = (aj + ak + bj + bk) / 4;
+         }
+      }
+   }
+}
+
+
+/**
+ * do_row_3D() for 8-bit sRGB formats, see do_row_srgb8().
+ */
+static void
+do_row_3D_srgb8(GLuint comps, GLuint srgbMask, GLint srcWidth,
+                const GLubyte *rowA, const GLubyte *rowB,
+                const GLubyte *rowC, const GLubyte *rowD,
+                GLint dstWidth, GLubyte *dst)
+{
+   const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
+   const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
+   const GLubyte *rows[4] = { rowA, rowB, rowC, rowD };
+   GLuint i, j, k, c, r;
+
+   for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+        i++, j += colStride, k += colStride) {
+      for (c = 0; c < comps; c++) {
+         if (srgbMask & (1 << c)) {
+            GLfloat sum = 0.0F;
+            for (r = 0; r < 4; r++) {
+               sum += util_format_srgb_8unorm_to_linear_float(rows[r][j * comps + c]);
+               sum += util_format_srgb_8unorm_to_linear_float(rows[r][k * comps + c]);
+            }
+            dst[i * comps + c] =
+               util_format_linear_float_to_srgb_8unorm(sum * 0.125F);
+         }
+         else {
+            unsigned sum = 4;
+            for (r = 0; r < 4; r++)
+               sum += rows[r][j * comps + c] + rows[r][k * comps + c];
+            dst[i * comps + c] = sum >> 3;
+         }
+      }
+   }
+}
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -170,9 +427,10 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
  * dest width or two times the dest width.
  * \param datatype  GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_FLOAT, etc.
  * \param comps  number of components per pixel (1..4)
+ * \param srgbMask  components which are sRGB encoded, GL_UNSIGNED_BYTE only
  */
 static void
-do_row(GLenum datatype, GLuint comps, GLint srcWidth,
+do_row(GLenum datatype, GLuint comps, GLuint srgbMask, GLint srcWidth,
        const GLvoid *srcRowA, const GLvoid *srcRowB,
        GLint dstWidth, GLvoid *dstRow)
 {
@@ -186,12 +444,21 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    assert(srcWidth == dstWidth || srcWidth == 2 * dstWidth);
    */
 
-   if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
-      GLuint i, j, k;
+   if (srgbMask) {
+      assert(datatype == GL_UNSIGNED_BYTE);
+      do_row_srgb8(comps, srgbMask, srcWidth, srcRowA, srcRowB,
+                   dstWidth, dstRow);
+   }
+   else if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
+      GLuint i = 0, j, k;
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
       const GLubyte(*rowB)[4] = (const GLubyte(*)[4]) srcRowB;
       GLubyte(*dst)[4] = (GLubyte(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = halve_row_ubyte4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] + rowB[j][0] + rowB[k][0]) / 4;
          dst[i][1] = (rowA[j][1] + rowA[k][1] + rowB[j][1] + rowB[k][1]) / 4;
@@ -212,22 +479,30 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
       }
    }
    else if (datatype == GL_UNSIGNED_BYTE && comps == 2) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLubyte(*rowA)[2] = (const GLubyte(*)[2]) srcRowA;
       const GLubyte(*rowB)[2] = (const GLubyte(*)[2]) srcRowB;
       GLubyte(*dst)[2] = (GLubyte(*)[2]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = halve_row_ubyte2_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] + rowB[j][0] + rowB[k][0]) >> 2;
          dst[i][1] = (rowA[j][1] + rowA[k][1] + rowB[j][1] + rowB[k][1]) >> 2;
       }
    }
    else if (datatype == GL_UNSIGNED_BYTE && comps == 1) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLubyte *rowA = (const GLubyte *) srcRowA;
       const GLubyte *rowB = (const GLubyte *) srcRowB;
       GLubyte *dst = (GLubyte *) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = halve_row_ubyte1_sse2(rowA, rowB, dstWidth, dst);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i] = (rowA[j] + rowA[k] + rowB[j] + rowB[k]) >> 2;
       }
@@ -375,11 +650,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    }
 
    else if (datatype == GL_FLOAT && comps == 4) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLfloat(*rowA)[4] = (const GLfloat(*)[4]) srcRowA;
       const GLfloat(*rowB)[4] = (const GLfloat(*)[4]) srcRowB;
       GLfloat(*dst)[4] = (GLfloat(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = halve_row_float4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] +
                       rowB[j][0] + rowB[k][0]) * 0.25F;
@@ -796,6 +1075,7 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
  * \param datatype  GL pixel type \c GL_UNSIGNED_BYTE, \c GL_UNSIGNED_SHORT,
  *                  \c GL_FLOAT, etc.
  * \param comps     number of components per pixel (1..4)
+ * \param srgbMask  components which are sRGB encoded, GL_UNSIGNED_BYTE only
  * \param srcWidth  Width of a row in the source data
  * \param srcRowA   Pointer to one of the rows of source data
  * \param srcRowB   Pointer to one of the rows of source data
@@ -805,7 +1085,7 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
  * \param srcRowA   Pointer to the row of destination data
  */
 static void
-do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
+do_row_3D(GLenum datatype, GLuint comps, GLuint srgbMask, GLint srcWidth,
           const GLvoid *srcRowA, const GLvoid *srcRowB,
           const GLvoid *srcRowC, const GLvoid *srcRowD,
           GLint dstWidth, GLvoid *dstRow)
@@ -817,10 +1097,21 @@ do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
    assert(comps >= 1);
    assert(comps <= 4);
 
-   if ((datatype == GL_UNSIGNED_BYTE) && (comps == 4)) {
+   if (srgbMask) {
+      assert(datatype == GL_UNSIGNED_BYTE);
+      do_row_3D_srgb8(comps, srgbMask, srcWidth, srcRowA, srcRowB,
+                      srcRowC, srcRowD, dstWidth, dstRow);
+   }
+   else if ((datatype == GL_UNSIGNED_BYTE) && (comps == 4)) {
       DECLARE_ROW_POINTERS(GLubyte, 4);
 
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+      i = 0;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = halve_row_3d_ubyte4_sse2(srcRowA, srcRowB, srcRowC, srcRowD,
+                                      dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          FILTER_3D(0);
          FILTER_3D(1);
@@ -1438,7 +1729,8 @@ do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
  */
 
 static void
-make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
+make_1d_mipmap(GLenum datatype, GLuint comps, GLuint srgbMask,
+               GLint border,
                GLint srcWidth, const GLubyte *srcPtr,
                GLint dstWidth, GLubyte *dstPtr)
 {
@@ -1451,7 +1743,7 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
    dst = dstPtr + border * bpt;
 
    /* we just duplicate the input row, kind of hack, saves code */
-   do_row(datatype, comps, srcWidth - 2 * border, src, src,
+   do_row(datatype, comps, srgbMask, srcWidth - 2 * border, src, src,
           dstWidth - 2 * border, dst);
 
    if (border) {
@@ -1468,7 +1760,8 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
 
 static void
-make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
+make_2d_mipmap(GLenum datatype, GLuint comps, GLuint srgbMask,
+               GLint border,
                GLint srcWidth, GLint srcHeight,
                const GLubyte *srcPtr, GLint srcRowStride,
                GLint dstWidth, GLint dstHeight,
@@ -1498,7 +1791,7 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
    for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
+      do_row(datatype, comps, srgbMask, srcWidthNB, srcA, srcB,
              dstWidthNB, dst);
       srcA += srcRowStep * srcRowStride;
       srcB += srcRowStep * srcRowStride;
@@ -1522,12 +1815,12 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
       memcpy(dstPtr + (dstWidth * dstHeight - 1) * bpt,
              srcPtr + (srcWidth * srcHeight - 1) * bpt, bpt);
       /* lower border */
-      do_row(datatype, comps, srcWidthNB,
+      do_row(datatype, comps, srgbMask, srcWidthNB,
              srcPtr + bpt,
              srcPtr + bpt,
              dstWidthNB, dstPtr + bpt);
       /* upper border */
-      do_row(datatype, comps, srcWidthNB,
+      do_row(datatype, comps, srgbMask, srcWidthNB,
              srcPtr + (srcWidth * (srcHeight - 1) + 1) * bpt,
              srcPtr + (srcWidth * (srcHeight - 1) + 1) * bpt,
              dstWidthNB,
@@ -1545,11 +1838,11 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
       else {
          /* average two src pixels each dest pixel */
          for (row = 0; row < dstHeightNB; row += 2) {
-            do_row(datatype, comps, 1,
+            do_row(datatype, comps, srgbMask, 1,
                    srcPtr + (srcWidth * (row * 2 + 1)) * bpt,
                    srcPtr + (srcWidth * (row * 2 + 2)) * bpt,
                    1, dstPtr + (dstWidth * row + 1) * bpt);
-            do_row(datatype, comps, 1,
+            do_row(datatype, comps, srgbMask, 1,
                    srcPtr + (srcWidth * (row * 2 + 1) + srcWidth - 1) * bpt,
                    srcPtr + (srcWidth * (row * 2 + 2) + srcWidth - 1) * bpt,
                    1, dstPtr + (dstWidth * row + 1 + dstWidth - 1) * bpt);
@@ -1559,8 +1852,69 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+struct mipmap_3d_job {
+   GLenum datatype;
+   GLuint comps, srgbMask;
+   GLint border, bpt;
+   GLint srcWidthNB, dstWidthNB, dstHeightNB;
+   const GLubyte **srcPtr;
+   GLint srcRowStride, srcImageOffset, srcRowOffset;
+   GLubyte **dstPtr;
+   GLint dstRowStride;
+};
+
+/**
+ * Generates the dest images [first, last), without their border.
+ */
+static void
+make_3d_mipmap_images(void *data, unsigned first, unsigned last)
+{
+   const struct mipmap_3d_job *job = data;
+   const GLint border = job->border, bpt = job->bpt;
+   const GLint srcRowStride = job->srcRowStride;
+   const GLint srcRowOffset = job->srcRowOffset;
+   GLint img, row;
+
+   for (img = first; img < last; img++) {
+      /* first source image pointer, skipping border */
+      const GLubyte *imgSrcA = job->srcPtr[img * 2 + border]
+         + srcRowStride * border + bpt * border;
+      /* second source image pointer, skipping border */
+      const GLubyte *imgSrcB =
+         job->srcPtr[img * 2 + job->srcImageOffset + border]
+         + srcRowStride * border + bpt * border;
+
+      /* address of the dest image, skipping border */
+      GLubyte *imgDst = job->dstPtr[img + border]
+         + job->dstRowStride * border + bpt * border;
+
+      /* setup the four source row pointers and the dest row pointer */
+      const GLubyte *srcImgARowA = imgSrcA;
+      const GLubyte *srcImgARowB = imgSrcA + srcRowOffset;
+      const GLubyte *srcImgBRowA = imgSrcB;
+      const GLubyte *srcImgBRowB = imgSrcB + srcRowOffset;
+      GLubyte *dstImgRow = imgDst;
+
+      for (row = 0; row < job->dstHeightNB; row++) {
+         do_row_3D(job->datatype, job->comps, job->srgbMask, job->srcWidthNB,
+                   srcImgARowA, srcImgARowB,
+                   srcImgBRowA, srcImgBRowB,
+                   job->dstWidthNB, dstImgRow);
+
+         /* advance to next rows */
+         srcImgARowA += srcRowStride + srcRowOffset;
+         srcImgARowB += srcRowStride + srcRowOffset;
+         srcImgBRowA += srcRowStride + srcRowOffset;
+         srcImgBRowB += srcRowStride + srcRowOffset;
+         dstImgRow += job->dstRowStride;
+      }
+   }
+}
+
+
 static void
-make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
+make_3d_mipmap(GLenum datatype, GLuint comps, GLuint srgbMask,
+               GLint border,
                GLint srcWidth, GLint srcHeight, GLint srcDepth,
                const GLubyte **srcPtr, GLint srcRowStride,
                GLint dstWidth, GLint dstHeight, GLint dstDepth,
@@ -1572,9 +1926,10 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLint dstWidthNB = dstWidth - 2 * border;
    const GLint dstHeightNB = dstHeight - 2 * border;
    const GLint dstDepthNB = dstDepth - 2 * border;
-   GLint img, row;
+   GLint img;
    GLint bytesPerSrcImage, bytesPerDstImage;
    GLint srcImageOffset, srcRowOffset;
+   struct mipmap_3d_job job;
 
    (void) srcDepthNB; /* silence warnings */
 
@@ -1600,49 +1955,35 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
           srcWidth, srcHeight, srcDepth, dstWidth, dstHeight, dstDepth);
    */
 
-   for (img = 0; img < dstDepthNB; img++) {
-      /* first source image pointer, skipping border */
-      const GLubyte *imgSrcA = srcPtr[img * 2 + border]
-         + srcRowStride * border + bpt * border;
-      /* second source image pointer, skipping border */
-      const GLubyte *imgSrcB = srcPtr[img * 2 + srcImageOffset + border]
-         + srcRowStride * border + bpt * border;
-
-      /* address of the dest image, skipping border */
-      GLubyte *imgDst = dstPtr[img + border]
-         + dstRowStride * border + bpt * border;
-
-      /* setup the four source row pointers and the dest row pointer */
-      const GLubyte *srcImgARowA = imgSrcA;
-      const GLubyte *srcImgARowB = imgSrcA + srcRowOffset;
-      const GLubyte *srcImgBRowA = imgSrcB;
-      const GLubyte *srcImgBRowB = imgSrcB + srcRowOffset;
-      GLubyte *dstImgRow = imgDst;
-
-      for (row = 0; row < dstHeightNB; row++) {
-         do_row_3D(datatype, comps, srcWidthNB, 
-                   srcImgARowA, srcImgARowB,
-                   srcImgBRowA, srcImgBRowB,
-                   dstWidthNB, dstImgRow);
-
-         /* advance to next rows */
-         srcImgARowA += srcRowStride + srcRowOffset;
-         srcImgARowB += srcRowStride + srcRowOffset;
-         srcImgBRowA += srcRowStride + srcRowOffset;
-         srcImgBRowB += srcRowStride + srcRowOffset;
-         dstImgRow += dstRowStride;
-      }
-   }
+   job.datatype = datatype;
+   job.comps = comps;
+   job.srgbMask = srgbMask;
+   job.border = border;
+   job.bpt = bpt;
+   job.srcWidthNB = srcWidthNB;
+   job.dstWidthNB = dstWidthNB;
+   job.dstHeightNB = dstHeightNB;
+   job.srcPtr = srcPtr;
+   job.srcRowStride = srcRowStride;
+   job.srcImageOffset = srcImageOffset;
+   job.srcRowOffset = srcRowOffset;
+   job.dstPtr = dstPtr;
+   job.dstRowStride = dstRowStride;
+
+   /* the dest images are independent, do them in parallel */
+   util_parallel_rows(util_parallel_queue(), MAX2(dstDepthNB, 0), 1,
+                      (size_t) 2 * srcRowStride * srcHeight,
+                      make_3d_mipmap_images, &job);
 
 
    /* Luckily we can leverage the make_2d_mipmap() function here! */
    if (border > 0) {
       /* do front border image */
-      make_2d_mipmap(datatype, comps, 1,
+      make_2d_mipmap(datatype, comps, srgbMask, 1,
                      srcWidth, srcHeight, srcPtr[0], srcRowStride,
                      dstWidth, dstHeight, dstPtr[0], dstRowStride);
       /* do back border image */
-      make_2d_mipmap(datatype, comps, 1,
+      make_2d_mipmap(datatype, comps, srgbMask, 1,
                      srcWidth, srcHeight, srcPtr[srcDepth - 1], srcRowStride,
                      dstWidth, dstHeight, dstPtr[dstDepth - 1], dstRowStride);
 
@@ -1685,7 +2026,7 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
             srcA = srcPtr[img * 2 + 0];
             srcB = srcPtr[img * 2 + srcImageOffset];
             dst = dstPtr[img];
-            do_row(datatype, comps, 1, srcA, srcB, 1, dst);
+            do_row(datatype, comps, srgbMask, 1, srcA, srcB, 1, dst);
 
             /* do border along [img][row=dstHeight-1][col=0] */
             srcA = srcPtr[img * 2 + 0]
@@ -1693,28 +2034,68 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
             srcB = srcPtr[img * 2 + srcImageOffset]
                + (srcHeight - 1) * srcRowStride;
             dst = dstPtr[img] + (dstHeight - 1) * dstRowStride;
-            do_row(datatype, comps, 1, srcA, srcB, 1, dst);
+            do_row(datatype, comps, srgbMask, 1, srcA, srcB, 1, dst);
 
             /* do border along [img][row=0][col=dstWidth-1] */
             srcA = srcPtr[img * 2 + 0] + (srcWidth - 1) * bpt;
             srcB = srcPtr[img * 2 + srcImageOffset] + (srcWidth - 1) * bpt;
             dst = dstPtr[img] + (dstWidth - 1) * bpt;
-            do_row(datatype, comps, 1, srcA, srcB, 1, dst);
+            do_row(datatype, comps, srgbMask, 1, srcA, srcB, 1, dst);
 
             /* do border along [img][row=dstHeight-1][col=dstWidth-1] */
             srcA = srcPtr[img * 2 + 0] + (bytesPerSrcImage - bpt);
             srcB = srcPtr[img * 2 + srcImageOffset] + (bytesPerSrcImage - bpt);
             dst = dstPtr[img] + (bytesPerDstImage - bpt);
-            do_row(datatype, comps, 1, srcA, srcB, 1, dst);
+            do_row(datatype, comps, srgbMask, 1, srcA, srcB, 1, dst);
          }
       }
    }
 }
 
 
+struct mipmap_slices_job {
+   GLenum target, datatype;
+   GLuint comps, srgbMask;
+   GLint border;
+   GLint srcWidth, srcHeight;
+   const GLubyte **srcData;
+   GLint srcRowStride;
+   GLint dstWidth, dstHeight;
+   GLubyte **dstData;
+   GLint dstRowStride;
+};
+
+/**
+ * Generates the slices [first, last) of a 1D or 2D array level.
+ */
+static void
+make_mipmap_slices(void *data, unsigned first, unsigned last)
+{
+   const struct mipmap_slices_job *job = data;
+   unsigned i;
+
+   for (i = first; i < last; i++) {
+      if (job->target == GL_TEXTURE_1D_ARRAY_EXT) {
+         make_1d_mipmap(job->datatype, job->comps, job->srgbMask, job->border,
+                        job->srcWidth, job->srcData[i],
+                        job->dstWidth, job->dstData[i]);
+      }
+      else {
+         make_2d_mipmap(job->datatype, job->comps, job->srgbMask, job->border,
+                        job->srcWidth, job->srcHeight, job->srcData[i],
+                        job->srcRowStride,
+                        job->dstWidth, job->dstHeight, job->dstData[i],
+                        job->dstRowStride);
+      }
+   }
+}
+
+
 /**
  * Down-sample a texture image to produce the next lower mipmap level.
  * \param comps  components per texel (1, 2, 3 or 4)
+ * \param srgbMask  components which are sRGB encoded and need to be
+ *                  averaged in linear space, only for GL_UNSIGNED_BYTE
  * \param srcData  array[slice] of pointers to source image slices
  * \param dstData  array[slice] of pointers to dest image slices
  * \param srcRowStride  stride between source rows, in bytes
@@ -1722,7 +2103,7 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
  */
 void
 _mesa_generate_mipmap_level(GLenum target,
-                            GLenum datatype, GLuint comps,
+                            GLenum datatype, GLuint comps, GLuint srgbMask,
                             GLint border,
                             GLint srcWidth, GLint srcHeight, GLint srcDepth,
                             const GLubyte **srcData,
@@ -1731,11 +2112,11 @@ _mesa_generate_mipmap_level(GLenum target,
                             GLubyte **dstData,
                             GLint dstRowStride)
 {
-   int i;
+   struct mipmap_slices_job job;
 
    switch (target) {
    case GL_TEXTURE_1D:
-      make_1d_mipmap(datatype, comps, border,
+      make_1d_mipmap(datatype, comps, srgbMask, border,
                      srcWidth, srcData[0],
                      dstWidth, dstData[0]);
       break;
@@ -1746,12 +2127,12 @@ _mesa_generate_mipmap_level(GLenum target,
    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
    case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
-      make_2d_mipmap(datatype, comps, border,
+      make_2d_mipmap(datatype, comps, srgbMask, border,
                      srcWidth, srcHeight, srcData[0], srcRowStride,
                      dstWidth, dstHeight, dstData[0], dstRowStride);
       break;
    case GL_TEXTURE_3D:
-      make_3d_mipmap(datatype, comps, border,
+      make_3d_mipmap(datatype, comps, srgbMask, border,
                      srcWidth, srcHeight, srcDepth,
                      srcData, srcRowStride,
                      dstWidth, dstHeight, dstDepth,
@@ -1760,19 +2141,27 @@ _mesa_generate_mipmap_level(GLenum target,
    case GL_TEXTURE_1D_ARRAY_EXT:
       assert(srcHeight == 1);
       assert(dstHeight == 1);
-      for (i = 0; i < dstDepth; i++) {
-         make_1d_mipmap(datatype, comps, border,
-                        srcWidth, srcData[i],
-                        dstWidth, dstData[i]);
-      }
-      break;
+      /* fallthrough */
    case GL_TEXTURE_2D_ARRAY_EXT:
    case GL_TEXTURE_CUBE_MAP_ARRAY:
-      for (i = 0; i < dstDepth; i++) {
-         make_2d_mipmap(datatype, comps, border,
-                        srcWidth, srcHeight, srcData[i], srcRowStride,
-                        dstWidth, dstHeight, dstData[i], dstRowStride);
-      }
+      job.target = target;
+      job.datatype = datatype;
+      job.comps = comps;
+      job.srgbMask = srgbMask;
+      job.border = border;
+      job.srcWidth = srcWidth;
+      job.srcHeight = srcHeight;
+      job.srcData = srcData;
+      job.srcRowStride = srcRowStride;
+      job.dstWidth = dstWidth;
+      job.dstHeight = dstHeight;
+      job.dstData = dstData;
+      job.dstRowStride = dstRowStride;
+
+      /* the slices are independent, do them in parallel */
+      util_parallel_rows(util_parallel_queue(), dstDepth, 1,
+                         (size_t) srcRowStride * srcHeight,
+                         make_mipmap_slices, &job);
       break;
    case GL_TEXTURE_RECTANGLE_NV:
    case GL_TEXTURE_EXTERNAL_OES:
@@ -1942,6 +2331,230 @@ _mesa_prepare_mipmap_levels(struct gl_context *ctx,
 }
 
 
+/**
+ * Returns the components of the texels of the format, in the order of
+ * _mesa_uncompressed_format_to_type_and_comps(), which are sRGB encoded.
+ */
+static GLuint
+srgb_component_mask(mesa_format format, GLenum datatype, GLuint comps)
+{
+   uint8_t swizzle[4];
+   GLuint mask = (1 << comps) - 1;
+
+   if (_mesa_get_format_color_encoding(format) != GL_SRGB ||
+       datatype != GL_UNSIGNED_BYTE)
+      return 0;
+
+   /* everything but alpha */
+   _mesa_get_format_swizzle(format, swizzle);
+   if (swizzle[3] <= MESA_FORMAT_SWIZZLE_W)
+      mask &= ~(1 << swizzle[3]);
+
+   return mask;
+}
+
+
+/** Levels made together from each band of rows of a source level */
+#define MIPMAP_FUSED_LEVELS 4
+
+/**
+ * A run of mipmap levels of a 2D texture, cube face or 2D array.  Index 0 is
+ * the source level.  Only the slice and the levels being worked on are
+ * mapped.
+ */
+struct mipmap_chain {
+   GLenum datatype;
+   GLuint comps, srgbMask;
+   GLuint numLevels;
+   GLint width[MAX_TEXTURE_LEVELS];
+   GLint height[MAX_TEXTURE_LEVELS];
+   GLint rowStride[MAX_TEXTURE_LEVELS];
+   GLubyte *maps[MAX_TEXTURE_LEVELS];
+};
+
+struct mipmap_chain_job {
+   const struct mipmap_chain *chain;
+   GLuint level;       /**< source level */
+   GLuint numLevels;   /**< number of levels made from it */
+};
+
+/**
+ * Makes a row of a level from the previous level, like make_2d_mipmap().
+ */
+static void
+make_chain_row(const struct mipmap_chain *chain, GLuint level, GLint row)
+{
+   const GLint srcHeight = chain->height[level - 1];
+   const GLint srcRowStride = chain->rowStride[level - 1];
+   const GLubyte *srcA, *srcB;
+
+   if (srcHeight > 1 && srcHeight > chain->height[level]) {
+      srcA = chain->maps[level - 1] + 2 * row * srcRowStride;
+      srcB = srcA + srcRowStride;
+   }
+   else {
+      srcA = srcB = chain->maps[level - 1] + row * srcRowStride;
+   }
+
+   do_row(chain->datatype, chain->comps, chain->srgbMask,
+          chain->width[level - 1], srcA, srcB, chain->width[level],
+          chain->maps[level] + row * chain->rowStride[level]);
+}
+
+/**
+ * Makes the rows [y1, y2) of the first level of the job, and the rows of
+ * the following levels which come from them.  Every row is made as soon as
+ * its two source rows are, while they are in the cache.
+ *
+ * The levels after the first one halve the height of the previous one, and
+ * y1 is aligned to 1 << (numLevels - 1), so the band covers the rows
+ * [y1, y2) >> n of the n-th level after the first.
+ */
+static void
+make_chain_rows(void *data, unsigned y1, unsigned y2)
+{
+   const struct mipmap_chain_job *job = data;
+   const GLuint first = job->level + 1;
+   const GLuint last = job->level + job->numLevels;
+   GLint next[MAX_TEXTURE_LEVELS], end[MAX_TEXTURE_LEVELS];
+   GLuint l;
+
+   for (l = first; l <= last; l++) {
+      next[l] = y1 >> (l - first);
+      end[l] = y2 >> (l - first);
+   }
+
+   while (next[first] < end[first]) {
+      make_chain_row(job->chain, first, next[first]++);
+
+      for (l = first + 1;
+           l <= last && next[l] < end[l] && 2 * next[l] + 1 < next[l - 1];
+           l++) {
+         make_chain_row(job->chain, l, next[l]++);
+      }
+   }
+}
+
+
+/**
+ * Generates the mipmap levels of a 2D texture, cube face or 2D array
+ * without border.  Up to MIPMAP_FUSED_LEVELS levels are made from each band
+ * of a source level while it is in the cache, and the bands are done in
+ * parallel.
+ *
+ * The slices are done one after the other, and only the source level and
+ * the levels made from it are mapped at a time.
+ *
+ * \return the last level generated.  The caller generates the following
+ * ones, which don't have the expected size, a level at a time.
+ */
+static GLuint
+generate_mipmap_chain(struct gl_context *ctx, GLenum target,
+                      struct gl_texture_object *texObj, GLuint maxLevel,
+                      GLenum datatype, GLuint comps, GLuint srgbMask)
+{
+   const GLuint baseLevel = texObj->BaseLevel;
+   struct gl_texture_image *images[MAX_TEXTURE_LEVELS];
+   struct mipmap_chain chain;
+   struct mipmap_chain_job job;
+   GLint numSlices;
+   GLuint level, l;
+   GLint slice;
+   GLboolean success = GL_TRUE;
+
+   memset(&chain, 0, sizeof(chain));
+   chain.datatype = datatype;
+   chain.comps = comps;
+   chain.srgbMask = srgbMask;
+
+   images[0] = _mesa_select_tex_image(texObj, target, baseLevel);
+   chain.width[0] = images[0]->Width;
+   chain.height[0] = images[0]->Height;
+   numSlices = images[0]->Depth;
+
+   for (level = 1; baseLevel + level <= maxLevel &&
+                   level < MAX_TEXTURE_LEVELS; level++) {
+      GLint width, height, depth;
+
+      images[level] = _mesa_select_tex_image(texObj, target,
+                                             baseLevel + level);
+      if (!images[level] ||
+          !_mesa_next_mipmap_level_size(target, 0,
+                                        chain.width[level - 1],
+                                        chain.height[level - 1], numSlices,
+                                        &width, &height, &depth) ||
+          images[level]->Width != width ||
+          images[level]->Height != height ||
+          images[level]->Depth != depth ||
+          images[level]->Border != 0) {
+         break;
+      }
+
+      chain.width[level] = width;
+      chain.height[level] = height;
+   }
+   chain.numLevels = level;
+
+   if (chain.numLevels < 2)
+      return baseLevel;
+
+   job.chain = &chain;
+
+   for (slice = 0; slice < numSlices && success; slice++) {
+      for (level = 0; level < chain.numLevels - 1 && success;
+           level += job.numLevels) {
+         /* Bands of the source level make whole bands of the following
+          * levels as long as these halve the height.
+          */
+         job.level = level;
+         job.numLevels = 1;
+         while (job.numLevels < MIPMAP_FUSED_LEVELS &&
+                level + job.numLevels + 1 < chain.numLevels &&
+                chain.height[level + job.numLevels] > 1)
+            job.numLevels++;
+
+         /* The levels in between are both written and read. */
+         for (l = level; l <= level + job.numLevels; l++) {
+            GLbitfield access = 0;
+
+            if (l > level)
+               access |= GL_MAP_WRITE_BIT;
+            if (l < level + job.numLevels)
+               access |= GL_MAP_READ_BIT;
+
+            ctx->Driver.MapTextureImage(ctx, images[l], slice,
+                                        0, 0, chain.width[l],
+                                        chain.height[l], access,
+                                        &chain.maps[l], &chain.rowStride[l]);
+            if (!chain.maps[l]) {
+               success = GL_FALSE;
+               break;
+            }
+         }
+
+         if (success) {
+            util_parallel_rows(util_parallel_queue(), chain.height[level + 1],
+                               1 << (job.numLevels - 1),
+                               (size_t) 2 * chain.rowStride[level],
+                               make_chain_rows, &job);
+         }
+
+         for (l = level; l <= level + job.numLevels && chain.maps[l]; l++) {
+            ctx->Driver.UnmapTextureImage(ctx, images[l], slice);
+            chain.maps[l] = NULL;
+         }
+      }
+   }
+
+   if (!success) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "mipmap generation");
+      return maxLevel;
+   }
+
+   return baseLevel + chain.numLevels - 1;
+}
+
+
 static void
 generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
                              struct gl_texture_object *texObj,
@@ -1950,11 +2563,22 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
 {
    GLuint level;
    GLenum datatype;
-   GLuint comps;
+   GLuint comps, srgbMask;
 
    _mesa_uncompressed_format_to_type_and_comps(srcImage->TexFormat, &datatype, &comps);
+   srgbMask = srgb_component_mask(srcImage->TexFormat, datatype, comps);
 
-   for (level = texObj->BaseLevel; level < maxLevel; level++) {
+   level = texObj->BaseLevel;
+   if (srcImage->Border == 0 &&
+       (target == GL_TEXTURE_2D ||
+        _mesa_is_cube_face(target) ||
+        target == GL_TEXTURE_2D_ARRAY ||
+        target == GL_TEXTURE_CUBE_MAP_ARRAY)) {
+      level = generate_mipmap_chain(ctx, target, texObj, maxLevel,
+                                    datatype, comps, srgbMask);
+   }
+
+   for (; level < maxLevel; level++) {
       /* generate image[level+1] from image[level] */
       struct gl_texture_image *srcImage, *dstImage;
       GLint srcRowStride, dstRowStride;
@@ -2027,7 +2651,8 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
 
       if (success) {
          /* generate one mipmap level (for 1D/2D/3D/array/etc texture) */
-         _mesa_generate_mipmap_level(target, datatype, comps, border,
+         _mesa_generate_mipmap_level(target, datatype, comps, srgbMask,
+                                     border,
                                      srcWidth, srcHeight, srcDepth,
                                      (const GLubyte **) srcMaps, srcRowStride,
                                      dstWidth, dstHeight, dstDepth,
@@ -2075,6 +2700,7 @@ generate_mipmap_compressed(struct gl_context *ctx, GLenum target,
    GLubyte *temp_src = NULL, *temp_dst = NULL;
    GLenum temp_datatype;
    GLenum temp_base_format;
+   GLuint temp_srgb_mask = 0;
    GLubyte **temp_src_slices = NULL, **temp_dst_slices = NULL;
 
    /* only two types of compressed textures at this time */
@@ -2106,6 +2732,11 @@ generate_mipmap_compressed(struct gl_context *ctx, GLenum target,
 
    temp_base_format = _mesa_get_format_base_format(temp_format);
 
+   /* The temporary image is RGB or RGBA, in the encoding of the texture */
+   if (_mesa_get_format_color_encoding(srcImage->TexFormat) == GL_SRGB &&
+       temp_datatype == GL_UNSIGNED_BYTE)
+      temp_srgb_mask = (1 << MIN2(components, 3)) - 1;
+
 
    /* allocate storage for the temporary, uncompressed image */
    temp_src_row_stride = _mesa_format_row_stride(temp_format, srcImage->Width);
@@ -2191,7 +2822,8 @@ generate_mipmap_compressed(struct gl_context *ctx, GLenum target,
       /* Rescale src image to dest image.
        * This will loop over the slices of a 2D array.
        */
-      _mesa_generate_mipmap_level(target, temp_datatype, components, border,
+      _mesa_generate_mipmap_level(target, temp_datatype, components,
+                                  temp_srgb_mask, border,
                                   srcWidth, srcHeight, srcDepth,
                                   (const GLubyte **) temp_src_slices,
                                   temp_src_row_stride,
@@ -28,6 +28,10 @@
 
 #include "glheader.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
 struct gl_texture_object;
 
@@ -38,7 +42,7 @@ _mesa_compute_num_levels(struct gl_context *ctx,
 
 extern void
 _mesa_generate_mipmap_level(GLenum target,
-                            GLenum datatype, GLuint comps,
+                            GLenum datatype, GLuint comps, GLuint srgbMask,
                             GLint border,
                             GLint srcWidth, GLint srcHeight, GLint srcDepth,
                             const GLubyte **srcData,
@@ -61,4 +65,8 @@ _mesa_next_mipmap_level_size(GLenum target, GLint border,
                        GLint srcWidth, GLint srcHeight, GLint srcDepth,
                        GLint *dstWidth, GLint *dstHeight, GLint *dstDepth);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* MIPMAP_H */
@@ -36,6 +36,7 @@
 #include "imports.h"
 #include "mtypes.h"
 #include "util/rounding.h"
+#include "util/u_parallel.h"
 
 
 /*
@@ -156,14 +157,21 @@ _mesa_scale_and_bias_depth_uint(const struct gl_context *ctx, GLuint n,
    }
 }
 
-/**
- * Apply various pixel transfer operations to an array of RGBA pixels
- * as indicated by the transferOps bitmask
- */
-void
-_mesa_apply_rgba_transfer_ops(struct gl_context *ctx, GLbitfield transferOps,
-                              GLuint n, GLfloat rgba[][4])
+struct rgba_transfer_ops_job {
+   struct gl_context *ctx;
+   GLbitfield transferOps;
+   GLfloat (*rgba)[4];
+};
+
+static void
+apply_rgba_transfer_ops(void *data, unsigned start, unsigned end)
 {
+   const struct rgba_transfer_ops_job *job = data;
+   struct gl_context *ctx = job->ctx;
+   const GLbitfield transferOps = job->transferOps;
+   const GLuint n = end - start;
+   GLfloat (*rgba)[4] = job->rgba + start;
+
    /* scale & bias */
    if (transferOps & IMAGE_SCALE_BIAS_BIT) {
       _mesa_scale_and_bias_rgba(n, rgba,
@@ -189,6 +197,21 @@ _mesa_apply_rgba_transfer_ops(struct gl_context *ctx, GLbitfield transferOps,
    }
 }
 
+/**
+ * Apply various pixel transfer operations to an array of RGBA pixels
+ * as indicated by the transferOps bitmask.  Large arrays are split between
+ * the threads of the shared pool.
+ */
+void
+_mesa_apply_rgba_transfer_ops(struct gl_context *ctx, GLbitfield transferOps,
+                              GLuint n, GLfloat rgba[][4])
+{
+   struct rgba_transfer_ops_job job = { ctx, transferOps, rgba };
+
+   util_parallel_rows(util_parallel_queue(), n, 1, 4 * sizeof(GLfloat),
+                      apply_rgba_transfer_ops, &job);
+}
+
 
 /*
  * Apply color index shift and offset to an array of pixels.
@@ -222,7 +222,7 @@ readpixels_memcpy(struct gl_context *ctx,
    struct gl_renderbuffer *rb =
          _mesa_get_read_renderbuffer_for_format(ctx, format);
    GLubyte *dst, *map;
-   int dstStride, stride, j, texelBytes, bytesPerRow;
+   int dstStride, stride, texelBytes, bytesPerRow;
 
    /* Fail if memcpy cannot be used. */
    if (!readpixels_can_use_memcpy(ctx, format, type, packing)) {
@@ -243,16 +243,7 @@ readpixels_memcpy(struct gl_context *ctx,
    texelBytes = _mesa_get_format_bytes(rb->Format);
    bytesPerRow = texelBytes * width;
 
-   /* memcpy*/
-   if (dstStride == stride && dstStride == bytesPerRow) {
-      memcpy(dst, map, bytesPerRow * height);
-   } else {
-      for (j = 0; j < height; j++) {
-         memcpy(dst, map, bytesPerRow);
-         dst += dstStride;
-         map += stride;
-      }
-   }
+   _mesa_copy_mapped_rows(dst, dstStride, map, stride, bytesPerRow, height);
 
    ctx->Driver.UnmapRenderbuffer(ctx, rb);
    return GL_TRUE;
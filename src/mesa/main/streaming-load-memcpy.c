@@ -39,22 +39,17 @@ _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len)
    char *restrict d = dst;
    char *restrict s = src;
 
-   /* If dst and src are not co-aligned, fallback to memcpy(). */
-   if (((uintptr_t)d & 15) != ((uintptr_t)s & 15)) {
-      memcpy(d, s, len);
-      return;
-   }
-
-   /* memcpy() the misaligned header. At the end of this if block, <d> and <s>
-    * are aligned to a 16-byte boundary or <len> == 0.
+   /* memcpy() the misaligned header. At the end of this if block, <s> is
+    * aligned to a 16-byte boundary or <len> == 0.  MOVNTDQA needs an aligned
+    * source only, <d> keeps whatever alignment it has.
     */
-   if ((uintptr_t)d & 15) {
-      uintptr_t bytes_before_alignment_boundary = 16 - ((uintptr_t)d & 15);
+   if ((uintptr_t)s & 15) {
+      uintptr_t bytes_before_alignment_boundary = 16 - ((uintptr_t)s & 15);
       assert(bytes_before_alignment_boundary < 16);
 
       memcpy(d, s, MIN2(bytes_before_alignment_boundary, len));
 
-      d = (char *)ALIGN((uintptr_t)d, 16);
+      d += MIN2(bytes_before_alignment_boundary, len);
       s = (char *)ALIGN((uintptr_t)s, 16);
       len -= MIN2(bytes_before_alignment_boundary, len);
    }
@@ -62,23 +57,44 @@ _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len)
    if (len >= 64)
       _mm_mfence();
 
-   while (len >= 64) {
-      __m128i *dst_cacheline = (__m128i *)d;
-      __m128i *src_cacheline = (__m128i *)s;
+   if (((uintptr_t)d & 15) == 0) {
+      while (len >= 64) {
+         __m128i *dst_cacheline = (__m128i *)d;
+         __m128i *src_cacheline = (__m128i *)s;
+
+         __m128i temp1 = _mm_stream_load_si128(src_cacheline + 0);
+         __m128i temp2 = _mm_stream_load_si128(src_cacheline + 1);
+         __m128i temp3 = _mm_stream_load_si128(src_cacheline + 2);
+         __m128i temp4 = _mm_stream_load_si128(src_cacheline + 3);
+
+         _mm_store_si128(dst_cacheline + 0, temp1);
+         _mm_store_si128(dst_cacheline + 1, temp2);
+         _mm_store_si128(dst_cacheline + 2, temp3);
+         _mm_store_si128(dst_cacheline + 3, temp4);
+
+         d += 64;
+         s += 64;
+         len -= 64;
+      }
+   } else {
+      while (len >= 64) {
+         __m128i *dst_cacheline = (__m128i *)d;
+         __m128i *src_cacheline = (__m128i *)s;
 
-      __m128i temp1 = _mm_stream_load_si128(src_cacheline + 0);
-      __m128i temp2 = _mm_stream_load_si128(src_cacheline + 1);
-      __m128i temp3 = _mm_stream_load_si128(src_cacheline + 2);
-      __m128i temp4 = _mm_stream_load_si128(src_cacheline + 3);
+         __m128i temp1 = _mm_stream_load_si128(src_cacheline + 0);
+         __m128i temp2 = _mm_stream_load_si128(src_cacheline + 1);
+         __m128i temp3 = _mm_stream_load_si128(src_cacheline + 2);
+         __m128i temp4 = _mm_stream_load_si128(src_cacheline + 3);
 
-      _mm_store_si128(dst_cacheline + 0, temp1);
-      _mm_store_si128(dst_cacheline + 1, temp2);
-      _mm_store_si128(dst_cacheline + 2, temp3);
-      _mm_store_si128(dst_cacheline + 3, temp4);
+         _mm_storeu_si128(dst_cacheline + 0, temp1);
+         _mm_storeu_si128(dst_cacheline + 1, temp2);
+         _mm_storeu_si128(dst_cacheline + 2, temp3);
+         _mm_storeu_si128(dst_cacheline + 3, temp4);
 
-      d += 64;
-      s += 64;
-      len -= 64;
+         d += 64;
+         s += 64;
+         len -= 64;
+      }
    }
 
    /* memcpy() the tail. */
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name hash_table.cpp
+ *
+ * Check the GL object name table, including the lock-free lookup path while
+ * another thread modifies the table.
+ */
+
+#include <gtest/gtest.h>
+
+#include "main/hash.h"
+#include "util/u_atomic.h"
+
+static void *
+value(GLuint key)
+{
+   return (void *)(uintptr_t)(key * 2 + 1);
+}
+
+static void
+count_entry(GLuint key, void *data, void *userData)
+{
+   EXPECT_EQ(value(key), data);
+   (*(unsigned *)userData)++;
+}
+
+TEST(MesaHashTableTest, InsertLookupRemove)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   /* Contiguous names, a few far out ones, and the one stored outside of
+    * struct hash_table.
+    */
+   static const GLuint sparse[] = { 100000, 5000000, 0xfffffffe };
+   const GLuint num_dense = 3000;
+   unsigned count = 0;
+
+   for (GLuint key = 1; key <= num_dense; key++)
+      _mesa_HashInsert(table, key, value(key));
+   for (unsigned i = 0; i < ARRAY_SIZE(sparse); i++)
+      _mesa_HashInsert(table, sparse[i], value(sparse[i]));
+
+   EXPECT_EQ(num_dense + ARRAY_SIZE(sparse), _mesa_HashNumEntries(table));
+
+   for (GLuint key = 1; key <= num_dense; key++)
+      EXPECT_EQ(value(key), _mesa_HashLookup(table, key));
+   for (unsigned i = 0; i < ARRAY_SIZE(sparse); i++)
+      EXPECT_EQ(value(sparse[i]), _mesa_HashLookup(table, sparse[i]));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, num_dense + 1));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 100001));
+
+   for (GLuint key = 1; key <= num_dense; key += 2)
+      _mesa_HashRemove(table, key);
+   _mesa_HashRemove(table, sparse[0]);
+
+   for (GLuint key = 1; key <= num_dense; key++) {
+      EXPECT_EQ(key % 2 ? NULL : value(key), _mesa_HashLookup(table, key));
+   }
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, sparse[0]));
+
+   /* Replacing an entry. */
+   _mesa_HashInsert(table, 2, value(4));
+   EXPECT_EQ(value(4), _mesa_HashLookup(table, 2));
+   _mesa_HashInsert(table, 2, value(2));
+
+   _mesa_HashWalk(table, count_entry, &count);
+   EXPECT_EQ(num_dense / 2 + ARRAY_SIZE(sparse) - 1, count);
+
+   count = 0;
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   EXPECT_EQ(num_dense / 2 + ARRAY_SIZE(sparse) - 1, count);
+   EXPECT_EQ(0u, _mesa_HashNumEntries(table));
+   for (GLuint key = 1; key <= num_dense; key++)
+      EXPECT_EQ(NULL, _mesa_HashLookup(table, key));
+
+   _mesa_DeleteHashTable(table);
+}
+
+#define NUM_KEYS 4096
+#define NUM_READERS 4
+#define LOOKUPS_PER_READER (4 * 1000 * 1000)
+
+struct reader {
+   struct _mesa_HashTable *table;
+   bool locked;
+   unsigned errors;
+};
+
+static int
+reader_func(void *data)
+{
+   struct reader *r = (struct reader *)data;
+   unsigned errors = 0;
+
+   for (unsigned i = 0; i < LOOKUPS_PER_READER; i++) {
+      /* Odd keys are always present, even ones come and go. */
+      GLuint key = (i * 2 + 1) % NUM_KEYS;
+      void *data;
+
+      if (r->locked) {
+         _mesa_HashLockMutex(r->table);
+         data = _mesa_HashLookupLocked(r->table, key);
+         _mesa_HashUnlockMutex(r->table);
+      } else {
+         data = _mesa_HashLookup(r->table, key);
+      }
+
+      if (data != value(key))
+         errors++;
+   }
+
+   r->errors = errors;
+   return 0;
+}
+
+struct writer {
+   struct _mesa_HashTable *table;
+   int done;
+};
+
+static int
+writer_func(void *data)
+{
+   struct writer *w = (struct writer *)data;
+   GLuint key = 2;
+
+   /* Keep inserting and removing names, growing the table past the initial
+    * keys so that the lookup array gets replaced under the readers.
+    */
+   while (!p_atomic_read(&w->done)) {
+      _mesa_HashInsert(w->table, key, value(key));
+      _mesa_HashRemove(w->table, key);
+      _mesa_HashInsert(w->table, key + NUM_KEYS, value(key + NUM_KEYS));
+      key = key + 2 < 16 * NUM_KEYS ? key + 2 : 2;
+   }
+
+   return 0;
+}
+
+static void
+check_lookups(bool locked)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   struct reader readers[NUM_READERS];
+   thrd_t reader_threads[NUM_READERS];
+   struct writer writer;
+   thrd_t writer_thread;
+
+   for (GLuint key = 1; key < NUM_KEYS; key += 2)
+      _mesa_HashInsert(table, key, value(key));
+
+   writer.table = table;
+   writer.done = 0;
+   EXPECT_EQ(thrd_success, thrd_create(&writer_thread, writer_func, &writer));
+
+   for (unsigned i = 0; i < NUM_READERS; i++) {
+      readers[i].table = table;
+      readers[i].locked = locked;
+      readers[i].errors = 0;
+      EXPECT_EQ(thrd_success,
+                thrd_create(&reader_threads[i], reader_func, &readers[i]));
+   }
+   for (unsigned i = 0; i < NUM_READERS; i++) {
+      thrd_join(reader_threads[i], NULL);
+      EXPECT_EQ(0u, readers[i].errors);
+   }
+
+   p_atomic_set(&writer.done, 1);
+   thrd_join(writer_thread, NULL);
+
+   _mesa_HashDeleteAll(table, [](GLuint, void *, void *) {}, NULL);
+   _mesa_DeleteHashTable(table);
+}
+
+TEST(MesaHashTableTest, ConcurrentLookups)
+{
+   check_lookups(true);
+   check_lookups(false);
+}
@@ -30,8 +30,11 @@
  */
 
 #include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
 
 #include "main/formats.h"
+#include "main/format_utils.h"
 #include "main/glformats.h"
 
 /**
@@ -137,3 +140,86 @@ TEST(MesaFormatsTest, FormatSanity)
 
    }
 }
+
+/**
+ * Check that the common upload pairs that _mesa_format_convert() handles in
+ * a single pass give the same results as the generic paths, which an
+ * identity rebase swizzle forces.
+ */
+TEST(MesaFormatsTest, DirectConversions)
+{
+   static const struct {
+      GLenum format, type;
+      mesa_format dst;
+      /* The padding channel at the end of every pixel, left undefined */
+      unsigned x_bytes;
+   } pairs[] = {
+      { GL_RGBA, GL_UNSIGNED_BYTE, MESA_FORMAT_B8G8R8A8_UNORM, 0 },
+      { GL_RGBA, GL_UNSIGNED_BYTE, MESA_FORMAT_B8G8R8X8_UNORM, 1 },
+      { GL_BGRA, GL_UNSIGNED_BYTE, MESA_FORMAT_R8G8B8A8_UNORM, 0 },
+      { GL_RGB,  GL_UNSIGNED_BYTE, MESA_FORMAT_B8G8R8A8_UNORM, 0 },
+      { GL_RGB,  GL_UNSIGNED_BYTE, MESA_FORMAT_B8G8R8X8_UNORM, 1 },
+      { GL_RGB,  GL_UNSIGNED_BYTE, MESA_FORMAT_R8G8B8A8_UNORM, 0 },
+      { GL_RGB,  GL_UNSIGNED_BYTE, MESA_FORMAT_R8G8B8X8_UNORM, 1 },
+      { GL_BGR,  GL_UNSIGNED_BYTE, MESA_FORMAT_B8G8R8A8_UNORM, 0 },
+      { GL_BGR,  GL_UNSIGNED_BYTE, MESA_FORMAT_B8G8R8X8_UNORM, 1 },
+      { GL_RGB,  GL_UNSIGNED_BYTE, MESA_FORMAT_B5G6R5_UNORM, 0 },
+      { GL_RGBA, GL_UNSIGNED_BYTE, MESA_FORMAT_B5G6R5_UNORM, 0 },
+      { GL_RGB,  GL_FLOAT, MESA_FORMAT_R11G11B10_FLOAT, 0 },
+      { GL_RGB,  GL_FLOAT, MESA_FORMAT_RGBA_FLOAT16, 0 },
+      { GL_RGB,  GL_FLOAT, MESA_FORMAT_RGBX_FLOAT16, 2 },
+      { GL_RGBA, GL_FLOAT, MESA_FORMAT_RGBA_FLOAT16, 0 },
+   };
+   static const float special[] = {
+      0.0f, -0.0f, 1.0f, 0.5f, 65504.0f, 65520.0f, 1e-6f, 1e-40f,
+      INFINITY, -INFINITY, NAN,
+   };
+   const unsigned width = 37, height = 3;
+   uint8_t rebase_identity[4] = { 0, 1, 2, 3 };
+
+   srand(0);
+
+   for (unsigned p = 0; p < ARRAY_SIZE(pairs); p++) {
+      const uint32_t src_format =
+         _mesa_format_from_format_and_type(pairs[p].format, pairs[p].type);
+      const mesa_format dst_format = pairs[p].dst;
+      const unsigned dst_bpp = _mesa_get_format_bytes(dst_format);
+      const unsigned src_stride = width * 4 * sizeof(float);
+      const unsigned dst_stride = width * dst_bpp;
+      SCOPED_TRACE(_mesa_get_format_name(dst_format));
+
+      EXPECT_TRUE(_mesa_format_convert_is_direct(dst_format, src_format));
+
+      float src[height][width * 4];
+      uint8_t direct[height][width * 8], generic[height][width * 8];
+
+      for (unsigned y = 0; y < height; y++) {
+         for (unsigned i = 0; i < width * 4; i++) {
+            if (pairs[p].type == GL_UNSIGNED_BYTE) {
+               ((uint8_t *)src[y])[i] = rand();
+            } else if (rand() % 4 == 0) {
+               src[y][i] = special[rand() % ARRAY_SIZE(special)];
+            } else {
+               src[y][i] = (float)rand() / RAND_MAX * 2.5f - 0.5f;
+            }
+         }
+      }
+
+      memset(direct, 0, sizeof(direct));
+      memset(generic, 0, sizeof(generic));
+      _mesa_format_convert(direct, dst_format, dst_stride,
+                           src, src_format, src_stride,
+                           width, height, NULL);
+      _mesa_format_convert(generic, dst_format, dst_stride,
+                           src, src_format, src_stride,
+                           width, height, rebase_identity);
+
+      for (unsigned y = 0; y < height; y++) {
+         for (unsigned x = 0; x < width; x++) {
+            EXPECT_EQ(0, memcmp(&direct[0][0] + y * dst_stride + x * dst_bpp,
+                                &generic[0][0] + y * dst_stride + x * dst_bpp,
+                                dst_bpp - pairs[p].x_bytes));
+         }
+      }
+   }
+}
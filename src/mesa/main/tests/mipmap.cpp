@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \name mipmap.cpp
+ *
+ * Check the box filter of _mesa_generate_mipmap_level() for 8-bit sRGB
+ * formats against a double precision reference, which decodes the texels
+ * to linear, averages them and encodes the result back.
+ */
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "main/glheader.h"
+#include "main/mipmap.h"
+
+#define SIZE 32
+
+static double
+srgb_to_linear(GLubyte v)
+{
+   const double c = v / 255.0;
+   return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+static int
+linear_to_srgb(double l)
+{
+   const double c = l <= 0.0031308 ? l * 12.92 :
+                    1.055 * pow(l, 1.0 / 2.4) - 0.055;
+   return (int) floor(c * 255.0 + 0.5);
+}
+
+/* The sRGB components of the destination texel must be within 1 of the
+ * reference, and alpha must be the plain average, rounded like the
+ * non-sRGB code does.
+ */
+static void
+check_texel(const GLubyte *const *texels, unsigned count, const GLubyte *dst)
+{
+   for (unsigned c = 0; c < 4; c++) {
+      if (c < 3) {
+         double sum = 0.0;
+         for (unsigned t = 0; t < count; t++)
+            sum += srgb_to_linear(texels[t][c]);
+         EXPECT_LE(abs(dst[c] - linear_to_srgb(sum / count)), 1);
+      } else {
+         unsigned sum = 0;
+         for (unsigned t = 0; t < count; t++)
+            sum += texels[t][c];
+         if (count == 4)
+            EXPECT_EQ(sum / 4, dst[c]);
+         else
+            EXPECT_EQ((sum + 4) >> 3, dst[c]);
+      }
+   }
+}
+
+static void
+fill_random(GLubyte *data, size_t size)
+{
+   srand(1);
+   for (size_t i = 0; i < size; i++)
+      data[i] = rand() & 0xff;
+}
+
+TEST(MesaMipmapTest, SRGB2D)
+{
+   static GLubyte src[SIZE][SIZE][4], dst[SIZE / 2][SIZE / 2][4];
+   const GLubyte *srcData[1] = { &src[0][0][0] };
+   GLubyte *dstData[1] = { &dst[0][0][0] };
+
+   fill_random(&src[0][0][0], sizeof(src));
+
+   _mesa_generate_mipmap_level(GL_TEXTURE_2D, GL_UNSIGNED_BYTE, 4, 0x7, 0,
+                               SIZE, SIZE, 1, srcData, SIZE * 4,
+                               SIZE / 2, SIZE / 2, 1, dstData, SIZE * 2);
+
+   for (unsigned y = 0; y < SIZE / 2; y++) {
+      for (unsigned x = 0; x < SIZE / 2; x++) {
+         const GLubyte *texels[4] = {
+            src[2 * y][2 * x], src[2 * y][2 * x + 1],
+            src[2 * y + 1][2 * x], src[2 * y + 1][2 * x + 1],
+         };
+         check_texel(texels, 4, dst[y][x]);
+      }
+   }
+}
+
+/* A 1xN level only averages vertically. */
+TEST(MesaMipmapTest, SRGBColumn)
+{
+   static GLubyte src[SIZE][4], dst[SIZE / 2][4];
+   const GLubyte *srcData[1] = { &src[0][0] };
+   GLubyte *dstData[1] = { &dst[0][0] };
+
+   fill_random(&src[0][0], sizeof(src));
+
+   _mesa_generate_mipmap_level(GL_TEXTURE_2D, GL_UNSIGNED_BYTE, 4, 0x7, 0,
+                               1, SIZE, 1, srcData, 4,
+                               1, SIZE / 2, 1, dstData, 4);
+
+   for (unsigned y = 0; y < SIZE / 2; y++) {
+      const GLubyte *texels[4] = {
+         src[2 * y], src[2 * y], src[2 * y + 1], src[2 * y + 1],
+      };
+      check_texel(texels, 4, dst[y]);
+   }
+}
+
+TEST(MesaMipmapTest, SRGB3D)
+{
+   static GLubyte src[SIZE][SIZE][SIZE][4];
+   static GLubyte dst[SIZE / 2][SIZE / 2][SIZE / 2][4];
+   const GLubyte *srcData[SIZE];
+   GLubyte *dstData[SIZE / 2];
+
+   fill_random(&src[0][0][0][0], sizeof(src));
+   for (unsigned z = 0; z < SIZE; z++)
+      srcData[z] = &src[z][0][0][0];
+   for (unsigned z = 0; z < SIZE / 2; z++)
+      dstData[z] = &dst[z][0][0][0];
+
+   _mesa_generate_mipmap_level(GL_TEXTURE_3D, GL_UNSIGNED_BYTE, 4, 0x7, 0,
+                               SIZE, SIZE, SIZE, srcData, SIZE * 4,
+                               SIZE / 2, SIZE / 2, SIZE / 2, dstData,
+                               SIZE * 2);
+
+   for (unsigned z = 0; z < SIZE / 2; z++) {
+      for (unsigned y = 0; y < SIZE / 2; y++) {
+         for (unsigned x = 0; x < SIZE / 2; x++) {
+            const GLubyte *texels[8];
+            unsigned t = 0;
+
+            for (unsigned dz = 0; dz < 2; dz++)
+               for (unsigned dy = 0; dy < 2; dy++)
+                  for (unsigned dx = 0; dx < 2; dx++)
+                     texels[t++] = src[2 * z + dz][2 * y + dy][2 * x + dx];
+
+            check_texel(texels, 8, dst[z][y][x]);
+         }
+      }
+   }
+}
+
+/* Averaging identical texels must give them back unchanged. */
+TEST(MesaMipmapTest, SRGBSolid)
+{
+   static GLubyte src[2][256][4], dst[1][128][4];
+   const GLubyte *srcData[1] = { &src[0][0][0] };
+   GLubyte *dstData[1] = { &dst[0][0][0] };
+
+   for (unsigned y = 0; y < 2; y++) {
+      for (unsigned x = 0; x < 256; x++) {
+         for (unsigned c = 0; c < 4; c++)
+            src[y][x][c] = x & ~1;
+      }
+   }
+
+   _mesa_generate_mipmap_level(GL_TEXTURE_2D, GL_UNSIGNED_BYTE, 4, 0x7, 0,
+                               256, 2, 1, srcData, 256 * 4,
+                               128, 1, 1, dstData, 128 * 4);
+
+   for (unsigned x = 0; x < 128; x++) {
+      for (unsigned c = 0; c < 4; c++)
+         EXPECT_EQ(2 * x, dst[0][x][c]);
+   }
+}
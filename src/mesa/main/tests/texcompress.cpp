@@ -0,0 +1,205 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \name texcompress.cpp
+ *
+ * Decode images of pseudo-random ETC and ASTC blocks and compare them with
+ * golden hashes, which were computed with the texel at a time decoders the
+ * block decoders replaced.  Also check that decoding a whole image, which
+ * may be split in bands of block rows between threads, gives the same result
+ * as decoding each block row on its own.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "main/glheader.h"
+#include "main/formats.h"
+#include "main/macros.h"
+#include "main/texcompress_astc.h"
+#include "main/texcompress_etc.h"
+
+/* Not a multiple of any block size, and large enough to be split. */
+#define WIDTH 1030
+#define HEIGHT 70
+
+struct golden_image {
+   mesa_format format;
+   bool bgra;
+   unsigned texel_bytes;
+   uint32_t hash;
+};
+
+static const struct golden_image etc_images[] = {
+   { MESA_FORMAT_ETC1_RGB8,                        false, 4, 0x4dd952ce },
+   { MESA_FORMAT_ETC2_RGB8,                        false, 4, 0x814d5723 },
+   { MESA_FORMAT_ETC2_SRGB8,                       false, 4, 0x814d5723 },
+   { MESA_FORMAT_ETC2_SRGB8,                       true,  4, 0x37122877 },
+   { MESA_FORMAT_ETC2_RGBA8_EAC,                   false, 4, 0xdfab99f5 },
+   { MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC,            false, 4, 0xdfab99f5 },
+   { MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC,            true,  4, 0xc2a78641 },
+   { MESA_FORMAT_ETC2_R11_EAC,                     false, 2, 0x8c74b00f },
+   { MESA_FORMAT_ETC2_RG11_EAC,                    false, 4, 0xe823a5d9 },
+   { MESA_FORMAT_ETC2_SIGNED_R11_EAC,              false, 2, 0xbfde540c },
+   { MESA_FORMAT_ETC2_SIGNED_RG11_EAC,             false, 4, 0x8ec9b329 },
+   { MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1,    false, 4, 0x454b5522 },
+   { MESA_FORMAT_ETC2_SRGB8_PUNCHTHROUGH_ALPHA1,   false, 4, 0x454b5522 },
+   { MESA_FORMAT_ETC2_SRGB8_PUNCHTHROUGH_ALPHA1,   true,  4, 0x2de64296 },
+};
+
+static const struct golden_image astc_images[] = {
+   { MESA_FORMAT_RGBA_ASTC_4x4,                    false, 4, 0x643d5567 },
+   { MESA_FORMAT_RGBA_ASTC_5x5,                    false, 4, 0x94fbb6bf },
+   { MESA_FORMAT_RGBA_ASTC_6x6,                    false, 4, 0x93904911 },
+   { MESA_FORMAT_RGBA_ASTC_8x8,                    false, 4, 0x10881e9d },
+   { MESA_FORMAT_RGBA_ASTC_10x5,                   false, 4, 0xf18a6f7d },
+   { MESA_FORMAT_RGBA_ASTC_12x12,                  false, 4, 0x3d7ac062 },
+   { MESA_FORMAT_SRGB8_ALPHA8_ASTC_4x4,            false, 4, 0x61635163 },
+   { MESA_FORMAT_SRGB8_ALPHA8_ASTC_8x8,            false, 4, 0xeab25244 },
+};
+
+/* xorshift32, so that the blocks don't depend on the C library. */
+static void
+fill_random(std::vector<uint8_t> &data)
+{
+   uint32_t x = 1;
+
+   for (size_t i = 0; i < data.size(); i++) {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      data[i] = x >> 24;
+   }
+}
+
+/* Random ASTC blocks nearly all decode to the error color, so give most of
+ * them a valid header: a 4x4 weight grid of 26 to 48 bits, one or two
+ * partitions and an LDR color endpoint mode.  Their partitions, weights and
+ * endpoints stay random, as do the remaining blocks.
+ */
+static void
+make_astc_headers_valid(std::vector<uint8_t> &data)
+{
+   static const uint8_t ldr_cems[] = { 0, 1, 4, 5, 6, 8, 9, 10, 12, 13 };
+
+   for (size_t i = 0; i < data.size(); i += 16) {
+      uint32_t v = data[i] | data[i + 1] << 8 | data[i + 2] << 16 |
+                   (uint32_t) data[i + 3] << 24;
+      const unsigned range = 3 + v % 5;
+      const unsigned cem = ldr_cems[(v >> 3) % 10];
+      const uint32_t block_mode = (range >> 1) | (range & 1) << 4 | 2 << 5;
+
+      if (((v >> 28) & 7) == 0)
+         continue;
+
+      if (v >> 31)
+         v = (v & ~(0x1fffu | 0x3fu << 23)) | block_mode | 1 << 11 | cem << 25;
+      else
+         v = (v & ~0x1ffffu) | block_mode | cem << 13;
+
+      data[i] = v;
+      data[i + 1] = v >> 8;
+      data[i + 2] = v >> 16;
+      data[i + 3] = v >> 24;
+   }
+}
+
+/* 32-bit FNV-1a */
+static uint32_t
+hash_data(const std::vector<uint8_t> &data)
+{
+   uint32_t hash = 0x811c9dc5;
+
+   for (size_t i = 0; i < data.size(); i++)
+      hash = (hash ^ data[i]) * 0x01000193;
+
+   return hash;
+}
+
+static void
+unpack(const struct golden_image *image, uint8_t *dst, unsigned dst_stride,
+       const uint8_t *src, unsigned src_stride,
+       unsigned width, unsigned height)
+{
+   if (image->format == MESA_FORMAT_ETC1_RGB8) {
+      _mesa_etc1_unpack_rgba8888(dst, dst_stride, src, src_stride,
+                                 width, height);
+   } else if (_mesa_is_format_astc_2d(image->format)) {
+      _mesa_unpack_astc_2d_ldr(dst, dst_stride, src, src_stride,
+                               width, height, image->format);
+   } else {
+      _mesa_unpack_etc2_format(dst, dst_stride, src, src_stride,
+                               width, height, image->format, image->bgra);
+   }
+}
+
+static void
+check_image(const struct golden_image *image)
+{
+   GLuint bw, bh;
+   _mesa_get_format_block_size(image->format, &bw, &bh);
+
+   const unsigned src_stride =
+      DIV_ROUND_UP(WIDTH, bw) * _mesa_get_format_bytes(image->format);
+   const unsigned block_rows = DIV_ROUND_UP(HEIGHT, bh);
+   const unsigned dst_stride = WIDTH * image->texel_bytes;
+   std::vector<uint8_t> src(src_stride * block_rows);
+   std::vector<uint8_t> whole(dst_stride * HEIGHT);
+   std::vector<uint8_t> rows(dst_stride * HEIGHT);
+
+   fill_random(src);
+   if (_mesa_is_format_astc_2d(image->format))
+      make_astc_headers_valid(src);
+
+   unpack(image, &whole[0], dst_stride, &src[0], src_stride, WIDTH, HEIGHT);
+
+   EXPECT_EQ(image->hash, hash_data(whole))
+      << _mesa_get_format_name(image->format)
+      << (image->bgra ? " to BGRA" : "");
+
+   for (unsigned y = 0; y < block_rows; y++) {
+      unpack(image, &rows[y * bh * dst_stride], dst_stride,
+             &src[y * src_stride], src_stride,
+             WIDTH, MIN2(bh, HEIGHT - y * bh));
+   }
+
+   EXPECT_TRUE(whole == rows)
+      << _mesa_get_format_name(image->format)
+      << (image->bgra ? " to BGRA" : "")
+      << " differs when decoded a block row at a time";
+}
+
+TEST(texcompress, etc)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(etc_images); i++)
+      check_image(&etc_images[i]);
+}
+
+TEST(texcompress, astc)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(astc_images); i++)
+      check_image(&astc_images[i]);
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \name texgetimage.cpp
+ *
+ * Read back images with _mesa_GetTexSubImage_sw() on the paths that convert
+ * through float RGBA a chunk of rows at a time: compressed textures, decoded
+ * in place when reading back float RGBA or converted to the destination
+ * format otherwise, and float textures which need clamping.  The results are
+ * compared with a decode of the whole image at once.  Also check the plain
+ * row copy of _mesa_copy_mapped_rows().
+ *
+ * The test is run with MESA_PIXEL_THREADS=3, so that the images are split in
+ * bands between threads as well as in chunks.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "main/glheader.h"
+#include "main/mtypes.h"
+#include "main/formats.h"
+#include "main/format_utils.h"
+#include "main/image.h"
+#include "main/macros.h"
+#include "main/texcompress.h"
+#include "main/texgetimage.h"
+
+/* Not a multiple of any block size, and large enough to be split. */
+#define WIDTH 1030
+#define HEIGHT 70
+
+/* A texture image whose storage is a single malloc'd slice. */
+struct mapped_texture_image {
+   struct gl_texture_image base;
+   GLubyte *map;
+   GLint stride;
+};
+
+static void
+map_texture_image(struct gl_context *ctx, struct gl_texture_image *texImage,
+                  GLuint slice, GLuint x, GLuint y, GLuint w, GLuint h,
+                  GLbitfield mode, GLubyte **mapOut, GLint *rowStrideOut)
+{
+   struct mapped_texture_image *image =
+      (struct mapped_texture_image *) texImage;
+   GLuint bw, bh;
+
+   _mesa_get_format_block_size(texImage->TexFormat, &bw, &bh);
+   *mapOut = image->map + (y / bh) * image->stride +
+             (x / bw) * _mesa_get_format_bytes(texImage->TexFormat);
+   *rowStrideOut = image->stride;
+}
+
+static void
+unmap_texture_image(struct gl_context *ctx,
+                    struct gl_texture_image *texImage, GLuint slice)
+{
+}
+
+/* xorshift32, so that the texels don't depend on the C library. */
+static void
+fill_random(std::vector<GLubyte> &data)
+{
+   uint32_t x = 1;
+
+   for (size_t i = 0; i < data.size(); i++) {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      data[i] = x >> 24;
+   }
+}
+
+static GLint
+texture_stride(mesa_format format)
+{
+   GLuint bw, bh;
+
+   _mesa_get_format_block_size(format, &bw, &bh);
+   return DIV_ROUND_UP(WIDTH, bw) * _mesa_get_format_bytes(format);
+}
+
+static GLint
+texture_size(mesa_format format)
+{
+   GLuint bw, bh;
+
+   _mesa_get_format_block_size(format, &bw, &bh);
+   return DIV_ROUND_UP(HEIGHT, bh) * texture_stride(format);
+}
+
+/**
+ * Read the whole texture back with the given format, type and row length
+ * into dst, which is filled with 0xcd first so that writes to the row
+ * padding show up.
+ */
+static void
+get_tex_image(mesa_format tex_format, GLenum base_format,
+              std::vector<GLubyte> &src, GLenum format, GLenum type,
+              GLint row_length, std::vector<GLubyte> &dst)
+{
+   struct gl_context *ctx =
+      (struct gl_context *) calloc(1, sizeof(struct gl_context));
+   struct gl_texture_object obj;
+   struct mapped_texture_image image;
+
+   ctx->Pack.Alignment = 4;
+   ctx->Pack.RowLength = row_length;
+   ctx->Driver.MapTextureImage = map_texture_image;
+   ctx->Driver.UnmapTextureImage = unmap_texture_image;
+
+   memset(&obj, 0, sizeof(obj));
+   obj.Target = GL_TEXTURE_2D;
+
+   memset(&image, 0, sizeof(image));
+   image.base.TexObject = &obj;
+   image.base.TexFormat = tex_format;
+   image.base._BaseFormat = base_format;
+   image.base.Width = WIDTH;
+   image.base.Height = HEIGHT;
+   image.base.Depth = 1;
+   image.map = &src[0];
+   image.stride = texture_stride(tex_format);
+
+   dst.assign(_mesa_image_row_stride(&ctx->Pack, WIDTH, format, type) *
+              HEIGHT, 0xcd);
+
+   _mesa_GetTexSubImage_sw(ctx, 0, 0, 0, WIDTH, HEIGHT, 1, format, type,
+                           &dst[0], &image.base);
+
+   free(ctx);
+}
+
+static std::vector<GLfloat>
+decompress(mesa_format format, std::vector<GLubyte> &src)
+{
+   std::vector<GLfloat> rgba(WIDTH * HEIGHT * 4);
+
+   _mesa_decompress_image(format, WIDTH, HEIGHT, &src[0],
+                          texture_stride(format), &rgba[0]);
+   return rgba;
+}
+
+/* Decoded straight into the destination, chunk by chunk. */
+TEST(texgetimage, compressed_to_rgba_float)
+{
+   const mesa_format format = MESA_FORMAT_RGBA_DXT5;
+   std::vector<GLubyte> src(texture_size(format));
+   std::vector<GLubyte> dst;
+
+   fill_random(src);
+   const std::vector<GLfloat> rgba = decompress(format, src);
+
+   get_tex_image(format, GL_RGBA, src, GL_RGBA, GL_FLOAT, 0, dst);
+
+   ASSERT_EQ(rgba.size() * sizeof(GLfloat), dst.size());
+   EXPECT_EQ(0, memcmp(&rgba[0], &dst[0], dst.size()));
+}
+
+/* Padded rows can't be decoded in place and go through a temporary. */
+TEST(texgetimage, compressed_to_padded_rgba_float)
+{
+   const mesa_format format = MESA_FORMAT_RGBA_DXT5;
+   const unsigned row_length = WIDTH + 3;
+   const unsigned row_bytes = WIDTH * 4 * sizeof(GLfloat);
+   std::vector<GLubyte> src(texture_size(format));
+   std::vector<GLubyte> dst;
+
+   fill_random(src);
+   const std::vector<GLfloat> rgba = decompress(format, src);
+
+   get_tex_image(format, GL_RGBA, src, GL_RGBA, GL_FLOAT, row_length, dst);
+
+   ASSERT_EQ(row_length * 4 * sizeof(GLfloat) * HEIGHT, dst.size());
+   for (unsigned y = 0; y < HEIGHT; y++) {
+      const GLubyte *row = &dst[y * row_length * 4 * sizeof(GLfloat)];
+
+      EXPECT_EQ(0, memcmp(&rgba[y * WIDTH * 4], row, row_bytes))
+         << "row " << y;
+      for (unsigned i = row_bytes; i < row_length * 4 * sizeof(GLfloat); i++)
+         EXPECT_EQ(0xcd, row[i]) << "row " << y << " padding";
+   }
+}
+
+/* Luminance is rebased to red on the way out of float RGBA. */
+TEST(texgetimage, compressed_luminance_alpha_to_rgba8)
+{
+   const mesa_format format = MESA_FORMAT_LA_LATC2_UNORM;
+   std::vector<GLubyte> src(texture_size(format));
+   std::vector<GLubyte> dst;
+
+   fill_random(src);
+   const std::vector<GLfloat> rgba = decompress(format, src);
+
+   get_tex_image(format, GL_LUMINANCE_ALPHA, src,
+                 GL_RGBA, GL_UNSIGNED_BYTE, 0, dst);
+
+   ASSERT_EQ((size_t) WIDTH * HEIGHT * 4, dst.size());
+   for (unsigned i = 0; i < WIDTH * HEIGHT; i++) {
+      const GLubyte expected[4] = {
+         (GLubyte) _mesa_float_to_unorm(rgba[i * 4], 8), 0, 0,
+         (GLubyte) _mesa_float_to_unorm(rgba[i * 4 + 3], 8),
+      };
+
+      EXPECT_EQ(0, memcmp(expected, &dst[i * 4], 4))
+         << "texel " << i % WIDTH << ", " << i / WIDTH;
+   }
+}
+
+/* Signed texels are clamped, and the rows are padded to 4 bytes. */
+TEST(texgetimage, compressed_signed_to_red8)
+{
+   const mesa_format format = MESA_FORMAT_R_RGTC1_SNORM;
+   const unsigned stride = ALIGN(WIDTH, 4);
+   std::vector<GLubyte> src(texture_size(format));
+   std::vector<GLubyte> dst;
+
+   fill_random(src);
+   const std::vector<GLfloat> rgba = decompress(format, src);
+
+   get_tex_image(format, GL_RED, src, GL_RED, GL_UNSIGNED_BYTE, 0, dst);
+
+   ASSERT_EQ((size_t) stride * HEIGHT, dst.size());
+   for (unsigned y = 0; y < HEIGHT; y++) {
+      for (unsigned x = 0; x < stride; x++) {
+         const unsigned expected = x < WIDTH ?
+            _mesa_float_to_unorm(rgba[(y * WIDTH + x) * 4], 8) : 0xcd;
+
+         EXPECT_EQ(expected, dst[y * stride + x])
+            << "texel " << x << ", " << y;
+      }
+   }
+}
+
+/* Uncompressed textures only go through float RGBA for transfer ops. */
+TEST(texgetimage, float_to_rgba16)
+{
+   const mesa_format format = MESA_FORMAT_RGBA_FLOAT32;
+   std::vector<GLubyte> bytes(WIDTH * HEIGHT * 4);
+   std::vector<GLubyte> src(texture_size(format));
+   std::vector<GLubyte> dst;
+   GLfloat *texels = (GLfloat *) &src[0];
+
+   /* [-0.5, 1.5], so that half of the texels need clamping */
+   fill_random(bytes);
+   for (unsigned i = 0; i < bytes.size(); i++)
+      texels[i] = bytes[i] / 127.5f - 0.5f;
+
+   get_tex_image(format, GL_RGBA, src, GL_RGBA, GL_UNSIGNED_SHORT, 0, dst);
+
+   ASSERT_EQ(bytes.size() * sizeof(GLushort), dst.size());
+   const GLushort *packed = (const GLushort *) &dst[0];
+   for (unsigned i = 0; i < bytes.size(); i++) {
+      EXPECT_EQ(_mesa_float_to_unorm(texels[i], 16), packed[i])
+         << "texel " << i / 4 % WIDTH << ", " << i / 4 / WIDTH;
+   }
+}
+
+/* Flipped, with padding on both sides. */
+TEST(texgetimage, copy_mapped_rows)
+{
+   const unsigned row_bytes = WIDTH * 16;
+   const int src_stride = row_bytes + 64;
+   const int dst_stride = row_bytes + 16;
+   std::vector<GLubyte> src(src_stride * HEIGHT);
+   std::vector<GLubyte> dst(dst_stride * HEIGHT, 0xcd);
+
+   fill_random(src);
+
+   _mesa_copy_mapped_rows(&dst[0], dst_stride,
+                          &src[(HEIGHT - 1) * src_stride], -src_stride,
+                          row_bytes, HEIGHT);
+
+   for (unsigned y = 0; y < HEIGHT; y++) {
+      const GLubyte *row = &dst[y * dst_stride];
+
+      EXPECT_EQ(0, memcmp(&src[(HEIGHT - 1 - y) * src_stride], row,
+                          row_bytes)) << "row " << y;
+      for (unsigned i = row_bytes; i < (unsigned) dst_stride; i++)
+         EXPECT_EQ(0xcd, row[i]) << "row " << y << " padding";
+   }
+}
@@ -35,16 +35,32 @@
 
 #include "texcompress_astc.h"
 #include "macros.h"
+#include "util/bitscan.h"
 #include "util/half_float.h"
+#include "util/u_parallel.h"
 #include <stdio.h>
 
 static bool VERBOSE_DECODE = false;
 static bool VERBOSE_WRITE = false;
 
+/**
+ * Same as _mesa_half_to_unorm8(_mesa_uint16_div_64k_to_half(v)), but without
+ * going through the fp16 encoding, as this is done for every texel.
+ */
 static inline uint8_t
 uint16_div_64k_to_half_to_unorm8(uint16_t v)
 {
-   return _mesa_half_to_unorm8(_mesa_uint16_div_64k_to_half(v));
+   /* Zero and the subnormals all round to 0 */
+   if (v < 4)
+      return 0;
+
+   /* The 11 bits of the fp16 mantissa with the hidden 1 bit, rounded to
+    * zero, and their exponent.
+    */
+   const int n = 16 - util_last_bit(v);
+   const uint32_t m = ((uint32_t) v << n) >> 5;
+
+   return (((m * 255) >> (10 + n)) + 1) >> 1;
 }
 
 class decode_error
@@ -275,89 +291,106 @@ static uint32_t hash52(uint32_t p)
    return p;
 }
 
-static int select_partition(int seed, int x, int y, int z, int partitioncount,
-                            int small_block)
+/**
+ * Selects the partition of the texels of a block.  The hash of the partition
+ * index only depends on the block, so it is done once rather than per texel.
+ */
+struct PartitionSelector
 {
-   if (small_block) {
-      x <<= 1;
-      y <<= 1;
-      z <<= 1;
+   PartitionSelector(int seed, int partitioncount, int small_block)
+      : partitioncount(partitioncount), small_block(small_block)
+   {
+      seed += (partitioncount - 1) * 1024;
+      rnum = hash52(seed);
+      uint8_t seed1 = rnum & 0xF;
+      uint8_t seed2 = (rnum >> 4) & 0xF;
+      uint8_t seed3 = (rnum >> 8) & 0xF;
+      uint8_t seed4 = (rnum >> 12) & 0xF;
+      uint8_t seed5 = (rnum >> 16) & 0xF;
+      uint8_t seed6 = (rnum >> 20) & 0xF;
+      uint8_t seed7 = (rnum >> 24) & 0xF;
+      uint8_t seed8 = (rnum >> 28) & 0xF;
+      uint8_t seed9 = (rnum >> 18) & 0xF;
+      uint8_t seed10 = (rnum >> 22) & 0xF;
+      uint8_t seed11 = (rnum >> 26) & 0xF;
+      uint8_t seed12 = ((rnum >> 30) | (rnum << 2)) & 0xF;
+
+      seed1 *= seed1;
+      seed2 *= seed2;
+      seed3 *= seed3;
+      seed4 *= seed4;
+      seed5 *= seed5;
+      seed6 *= seed6;
+      seed7 *= seed7;
+      seed8 *= seed8;
+      seed9 *= seed9;
+      seed10 *= seed10;
+      seed11 *= seed11;
+      seed12 *= seed12;
+
+      int sh1, sh2, sh3;
+      if (seed & 1) {
+         sh1 = (seed & 2 ? 4 : 5);
+         sh2 = (partitioncount == 3 ? 6 : 5);
+      } else {
+         sh1 = (partitioncount == 3 ? 6 : 5);
+         sh2 = (seed & 2 ? 4 : 5);
+      }
+      sh3 = (seed & 0x10) ? sh1 : sh2;
+
+      /* Multipliers of x, y and z for each of a, b, c and d */
+      mul[0][0] = seed1 >> sh1;
+      mul[0][1] = seed2 >> sh2;
+      mul[0][2] = seed11 >> sh3;
+      mul[1][0] = seed3 >> sh1;
+      mul[1][1] = seed4 >> sh2;
+      mul[1][2] = seed12 >> sh3;
+      mul[2][0] = seed5 >> sh1;
+      mul[2][1] = seed6 >> sh2;
+      mul[2][2] = seed9 >> sh3;
+      mul[3][0] = seed7 >> sh1;
+      mul[3][1] = seed8 >> sh2;
+      mul[3][2] = seed10 >> sh3;
    }
-   seed += (partitioncount - 1) * 1024;
-   uint32_t rnum = hash52(seed);
-   uint8_t seed1 = rnum & 0xF;
-   uint8_t seed2 = (rnum >> 4) & 0xF;
-   uint8_t seed3 = (rnum >> 8) & 0xF;
-   uint8_t seed4 = (rnum >> 12) & 0xF;
-   uint8_t seed5 = (rnum >> 16) & 0xF;
-   uint8_t seed6 = (rnum >> 20) & 0xF;
-   uint8_t seed7 = (rnum >> 24) & 0xF;
-   uint8_t seed8 = (rnum >> 28) & 0xF;
-   uint8_t seed9 = (rnum >> 18) & 0xF;
-   uint8_t seed10 = (rnum >> 22) & 0xF;
-   uint8_t seed11 = (rnum >> 26) & 0xF;
-   uint8_t seed12 = ((rnum >> 30) | (rnum << 2)) & 0xF;
-
-   seed1 *= seed1;
-   seed2 *= seed2;
-   seed3 *= seed3;
-   seed4 *= seed4;
-   seed5 *= seed5;
-   seed6 *= seed6;
-   seed7 *= seed7;
-   seed8 *= seed8;
-   seed9 *= seed9;
-   seed10 *= seed10;
-   seed11 *= seed11;
-   seed12 *= seed12;
-
-   int sh1, sh2, sh3;
-   if (seed & 1) {
-      sh1 = (seed & 2 ? 4 : 5);
-      sh2 = (partitioncount == 3 ? 6 : 5);
-   } else {
-      sh1 = (partitioncount == 3 ? 6 : 5);
-      sh2 = (seed & 2 ? 4 : 5);
+
+   int select(int x, int y, int z) const
+   {
+      if (small_block) {
+         x <<= 1;
+         y <<= 1;
+         z <<= 1;
+      }
+
+      int a = mul[0][0] * x + mul[0][1] * y + mul[0][2] * z + (rnum >> 14);
+      int b = mul[1][0] * x + mul[1][1] * y + mul[1][2] * z + (rnum >> 10);
+      int c = mul[2][0] * x + mul[2][1] * y + mul[2][2] * z + (rnum >> 6);
+      int d = mul[3][0] * x + mul[3][1] * y + mul[3][2] * z + (rnum >> 2);
+
+      a &= 0x3F;
+      b &= 0x3F;
+      c &= 0x3F;
+      d &= 0x3F;
+
+      if (partitioncount < 4)
+         d = 0;
+      if (partitioncount < 3)
+         c = 0;
+
+      if (a >= b && a >= c && a >= d)
+         return 0;
+      else if (b >= c && b >= d)
+         return 1;
+      else if (c >= d)
+         return 2;
+      else
+         return 3;
    }
-   sh3 = (seed & 0x10) ? sh1 : sh2;
-
-   seed1 >>= sh1;
-   seed2 >>= sh2;
-   seed3 >>= sh1;
-   seed4 >>= sh2;
-   seed5 >>= sh1;
-   seed6 >>= sh2;
-   seed7 >>= sh1;
-   seed8 >>= sh2;
-   seed9 >>= sh3;
-   seed10 >>= sh3;
-   seed11 >>= sh3;
-   seed12 >>= sh3;
-
-   int a = seed1 * x + seed2 * y + seed11 * z + (rnum >> 14);
-   int b = seed3 * x + seed4 * y + seed12 * z + (rnum >> 10);
-   int c = seed5 * x + seed6 * y + seed9 * z + (rnum >> 6);
-   int d = seed7 * x + seed8 * y + seed10 * z + (rnum >> 2);
-
-   a &= 0x3F;
-   b &= 0x3F;
-   c &= 0x3F;
-   d &= 0x3F;
-
-   if (partitioncount < 4)
-      d = 0;
-   if (partitioncount < 3)
-      c = 0;
-
-   if (a >= b && a >= c && a >= d)
-      return 0;
-   else if (b >= c && b >= d)
-      return 1;
-   else if (c >= d)
-      return 2;
-   else
-      return 3;
-}
+
+   int partitioncount;
+   int small_block;
+   uint32_t rnum;
+   uint8_t mul[4][3];
+};
 
 
 struct InputBitVector
@@ -1635,6 +1668,24 @@ void Block::write_decoded(const Decoder &decoder, uint16_t *output)
    }
 
    int small_block = (decoder.block_w * decoder.block_h * decoder.block_d) < 31;
+   PartitionSelector partition_selector(partition_index, num_parts, small_block);
+
+   /* Expand the endpoints of each partition to 16 bits. */
+   uint16_t c0[4][4], c1[4][4];
+   for (int p = 0; p < num_parts; ++p) {
+      const uint8x4_t e0 = endpoints_decoded[0][p];
+      const uint8x4_t e1 = endpoints_decoded[1][p];
+
+      for (int i = 0; i < 4; ++i) {
+         if (decoder.srgb) {
+            c0[p][i] = (uint16_t)((e0.v[i] << 8) | 0x80);
+            c1[p][i] = (uint16_t)((e1.v[i] << 8) | 0x80);
+         } else {
+            c0[p][i] = (uint16_t)((e0.v[i] << 8) | e0.v[i]);
+            c1[p][i] = (uint16_t)((e1.v[i] << 8) | e1.v[i]);
+         }
+      }
+   }
 
    int idx = 0;
    for (int z = 0; z < decoder.block_d; ++z) {
@@ -1643,7 +1694,7 @@ void Block::write_decoded(const Decoder &decoder, uint16_t *output)
 
             int partition;
             if (num_parts > 1) {
-               partition = select_partition(partition_index, x, y, z, num_parts, small_block);
+               partition = partition_selector.select(x, y, z);
                assert(partition < num_parts);
             } else {
                partition = 0;
@@ -1651,32 +1702,8 @@ void Block::write_decoded(const Decoder &decoder, uint16_t *output)
 
             /* TODO: HDR */
 
-            uint8x4_t e0 = endpoints_decoded[0][partition];
-            uint8x4_t e1 = endpoints_decoded[1][partition];
-            uint16_t c0[4], c1[4];
-
-            /* Expand to 16 bits. */
-            if (decoder.srgb) {
-               c0[0] = (uint16_t)((e0.v[0] << 8) | 0x80);
-               c0[1] = (uint16_t)((e0.v[1] << 8) | 0x80);
-               c0[2] = (uint16_t)((e0.v[2] << 8) | 0x80);
-               c0[3] = (uint16_t)((e0.v[3] << 8) | 0x80);
-
-               c1[0] = (uint16_t)((e1.v[0] << 8) | 0x80);
-               c1[1] = (uint16_t)((e1.v[1] << 8) | 0x80);
-               c1[2] = (uint16_t)((e1.v[2] << 8) | 0x80);
-               c1[3] = (uint16_t)((e1.v[3] << 8) | 0x80);
-            } else {
-               c0[0] = (uint16_t)((e0.v[0] << 8) | e0.v[0]);
-               c0[1] = (uint16_t)((e0.v[1] << 8) | e0.v[1]);
-               c0[2] = (uint16_t)((e0.v[2] << 8) | e0.v[2]);
-               c0[3] = (uint16_t)((e0.v[3] << 8) | e0.v[3]);
-
-               c1[0] = (uint16_t)((e1.v[0] << 8) | e1.v[0]);
-               c1[1] = (uint16_t)((e1.v[1] << 8) | e1.v[1]);
-               c1[2] = (uint16_t)((e1.v[2] << 8) | e1.v[2]);
-               c1[3] = (uint16_t)((e1.v[3] << 8) | e1.v[3]);
-            }
+            const uint16_t *c0p = c0[partition];
+            const uint16_t *c1p = c1[partition];
 
             int w[4];
             if (dual_plane) {
@@ -1691,10 +1718,10 @@ void Block::write_decoded(const Decoder &decoder, uint16_t *output)
 
             /* Interpolate to produce UNORM16, applying weights. */
             uint16_t c[4] = {
-               (uint16_t)((c0[0] * (64 - w[0]) + c1[0] * w[0] + 32) >> 6),
-               (uint16_t)((c0[1] * (64 - w[1]) + c1[1] * w[1] + 32) >> 6),
-               (uint16_t)((c0[2] * (64 - w[2]) + c1[2] * w[2] + 32) >> 6),
-               (uint16_t)((c0[3] * (64 - w[3]) + c1[3] * w[3] + 32) >> 6),
+               (uint16_t)((c0p[0] * (64 - w[0]) + c1p[0] * w[0] + 32) >> 6),
+               (uint16_t)((c0p[1] * (64 - w[1]) + c1p[1] * w[1] + 32) >> 6),
+               (uint16_t)((c0p[2] * (64 - w[2]) + c1p[2] * w[2] + 32) >> 6),
+               (uint16_t)((c0p[3] * (64 - w[3]) + c1p[3] * w[3] + 32) >> 6),
             };
 
             if (decoder.output_unorm8) {
@@ -1813,35 +1840,36 @@ decode_error::type Block::calculate_colour_endpoints_size()
    return decode_error::invalid_colour_endpoints_size;
 }
 
-/**
- * Decode ASTC 2D LDR texture data.
- *
- * \param src_width in pixels
- * \param src_height in pixels
- * \param dst_stride in bytes
+/** Cost of a block, in bytes of the simple conversions util_parallel_rows()
+ * is tuned for.
  */
-extern "C" void
-_mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
-                         unsigned dst_stride,
-                         const uint8_t *src_row,
-                         unsigned src_stride,
-                         unsigned src_width,
-                         unsigned src_height,
-                         mesa_format format)
-{
-   assert(_mesa_is_format_astc_2d(format));
-   bool srgb = _mesa_get_format_color_encoding(format) == GL_SRGB;
+#define ASTC_BLOCK_COST 1024
 
+struct astc_unpack_job
+{
+   uint8_t *dst_row;
+   unsigned dst_stride;
+   const uint8_t *src_row;
+   unsigned src_stride;
+   unsigned width, height;
    unsigned blk_w, blk_h;
-   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+   bool srgb;
+};
 
+static void
+astc_unpack_rows(void *data, unsigned y1, unsigned y2)
+{
+   const astc_unpack_job *job = (const astc_unpack_job *) data;
    const unsigned block_size = 16;
-   unsigned x_blocks = (src_width + blk_w - 1) / blk_w;
-   unsigned y_blocks = (src_height + blk_h - 1) / blk_h;
+   const unsigned blk_w = job->blk_w, blk_h = job->blk_h;
+   unsigned x_blocks = (job->width + blk_w - 1) / blk_w;
+
+   Decoder dec(blk_w, blk_h, 1, job->srgb, true);
 
-   Decoder dec(blk_w, blk_h, 1, srgb, true);
+   for (unsigned y = y1; y < y2; ++y) {
+      const uint8_t *src_row = job->src_row + (size_t) y * job->src_stride;
+      uint8_t *dst_row = job->dst_row + (size_t) y * blk_h * job->dst_stride;
 
-   for (unsigned y = 0; y < y_blocks; ++y) {
       for (unsigned x = 0; x < x_blocks; ++x) {
          /* Same size as the largest block. */
          uint16_t block_out[12 * 12 * 4];
@@ -1849,12 +1877,12 @@ _mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
          dec.decode(src_row + x * block_size, block_out);
 
          /* This can be smaller with NPOT dimensions. */
-         unsigned dst_blk_w = MIN2(blk_w, src_width  - x*blk_w);
-         unsigned dst_blk_h = MIN2(blk_h, src_height - y*blk_h);
+         unsigned dst_blk_w = MIN2(blk_w, job->width  - x*blk_w);
+         unsigned dst_blk_h = MIN2(blk_h, job->height - y*blk_h);
 
          for (unsigned sub_y = 0; sub_y < dst_blk_h; ++sub_y) {
             for (unsigned sub_x = 0; sub_x < dst_blk_w; ++sub_x) {
-               uint8_t *dst = dst_row + sub_y * dst_stride +
+               uint8_t *dst = dst_row + sub_y * job->dst_stride +
                               (x * blk_w + sub_x) * 4;
                const uint16_t *src = &block_out[(sub_y * blk_w + sub_x) * 4];
 
@@ -1865,7 +1893,48 @@ _mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
             }
          }
       }
-      src_row += src_stride;
-      dst_row += dst_stride * blk_h;
    }
 }
+
+/**
+ * Decode ASTC 2D LDR texture data.
+ *
+ * Large images are decoded by bands of rows of blocks on the shared pool.
+ *
+ * \param src_width in pixels
+ * \param src_height in pixels
+ * \param dst_stride in bytes
+ */
+extern "C" void
+_mesa_unpack_astc_2d_ldr(uint8_t *dst_row,
+                         unsigned dst_stride,
+                         const uint8_t *src_row,
+                         unsigned src_stride,
+                         unsigned src_width,
+                         unsigned src_height,
+                         mesa_format format)
+{
+   assert(_mesa_is_format_astc_2d(format));
+   bool srgb = _mesa_get_format_color_encoding(format) == GL_SRGB;
+
+   unsigned blk_w, blk_h;
+   _mesa_get_format_block_size(format, &blk_w, &blk_h);
+
+   unsigned x_blocks = (src_width + blk_w - 1) / blk_w;
+   unsigned y_blocks = (src_height + blk_h - 1) / blk_h;
+
+   astc_unpack_job job;
+   job.dst_row = dst_row;
+   job.dst_stride = dst_stride;
+   job.src_row = src_row;
+   job.src_stride = src_stride;
+   job.width = src_width;
+   job.height = src_height;
+   job.blk_w = blk_w;
+   job.blk_h = blk_h;
+   job.srgb = srgb;
+
+   util_parallel_rows(util_parallel_queue(), y_blocks, 1,
+                      (size_t) x_blocks * ASTC_BLOCK_COST,
+                      astc_unpack_rows, &job);
+}
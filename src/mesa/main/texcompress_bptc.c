@@ -31,6 +31,7 @@
 #include "texcompress_bptc.h"
 #include "texcompress_bptc_tmp.h"
 #include "texstore.h"
+#include "util/texcompress_bcn.h"
 #include "image.h"
 #include "mtypes.h"
 
@@ -158,9 +159,9 @@ _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
                                          srcFormat, srcType);
    }
 
-   compress_rgba_unorm(srcWidth, srcHeight,
-                       pixels, rowstride,
-                       dstSlices[0], dstRowStride);
+   util_bcn_compress(UTIL_BCN_BC7, util_bcn_default_quality(),
+                     srcWidth, srcHeight, pixels, 4, rowstride,
+                     dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -203,10 +204,10 @@ texstore_bptc_rgb_float(TEXSTORE_PARAMS,
                                          srcFormat, srcType);
    }
 
-   compress_rgb_float(srcWidth, srcHeight,
-                      pixels, rowstride,
-                      dstSlices[0], dstRowStride,
-                      is_signed);
+   util_bcn_compress(is_signed ? UTIL_BCN_BC6H_SFLOAT : UTIL_BCN_BC6H_UFLOAT,
+                     util_bcn_default_quality(),
+                     srcWidth, srcHeight, pixels, 3, rowstride,
+                     dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
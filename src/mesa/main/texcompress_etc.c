@@ -45,6 +45,7 @@
 #include "macros.h"
 #include "format_unpack.h"
 #include "util/format_srgb.h"
+#include "util/u_parallel.h"
 
 
 struct etc2_block {
@@ -114,39 +115,6 @@ _mesa_texstore_etc1_rgb8(UNUSED_TEXSTORE_PARAMS)
    return GL_FALSE;
 }
 
-
-/**
- * Decode texture data in format `MESA_FORMAT_ETC1_RGB8` to
- * `MESA_FORMAT_ABGR8888`.
- *
- * The size of the source data must be a multiple of the ETC1 block size,
- * which is 8, even if the texture image's dimensions are not aligned to 4.
- * From the GL_OES_compressed_ETC1_RGB8_texture spec:
- *   The texture is described as a number of 4x4 pixel blocks. If the
- *   texture (or a particular mip-level) is smaller than 4 pixels in
- *   any dimension (such as a 2x2 or a 8x1 texture), the texture is
- *   found in the upper left part of the block(s), and the rest of the
- *   pixels are not used. For instance, a texture of size 4x2 will be
- *   placed in the upper half of a 4x4 block, and the lower half of the
- *   pixels in the block will not be accessed.
- *
- * \param src_width in pixels
- * \param src_height in pixels
- * \param dst_stride in bytes
- */
-void
-_mesa_etc1_unpack_rgba8888(uint8_t *dst_row,
-                           unsigned dst_stride,
-                           const uint8_t *src_row,
-                           unsigned src_stride,
-                           unsigned src_width,
-                           unsigned src_height)
-{
-   etc1_unpack_rgba8888(dst_row, dst_stride,
-                        src_row, src_stride,
-                        src_width, src_height);
-}
-
 static uint8_t
 etc2_base_color1_t_mode(const uint8_t *in, GLuint index)
 {
@@ -666,437 +634,277 @@ etc2_rgba8_fetch_texel(const struct etc2_block *block,
    etc2_alpha8_fetch_texel(block, x, y, dst);
 }
 
+/**
+ * Decodes the color part of an ETC2 block to 4x4 RGBA texels, row by row.
+ *
+ * Alpha is 255, except for the transparent texels of punch-through alpha
+ * blocks which are all zeros.  The 2 x 4 colors an individual, differential,
+ * T or H mode block can select are computed once, instead of per texel.
+ */
 static void
-etc2_unpack_rgb8(uint8_t *dst_row,
-                 unsigned dst_stride,
-                 const uint8_t *src_row,
-                 unsigned src_stride,
-                 unsigned width,
-                 unsigned height)
+etc2_rgb8_decode_block(const uint8_t *src, uint8_t texels[16][4],
+                       bool punchthrough_alpha)
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
    struct etc2_block block;
-   unsigned x, y, i, j;
-
-   for (y = 0; y < height; y += bh) {
-      const uint8_t *src = src_row;
-      /*
-       * Destination texture may not be a multiple of four texels in
-       * height. Compute a safe height to avoid writing outside the texture.
-       */
-      const unsigned h = MIN2(bh, height - y);
-
-      for (x = 0; x < width; x+= bw) {
-         /*
-          * Destination texture may not be a multiple of four texels in
-          * width. Compute a safe width to avoid writing outside the texture.
-          */
-         const unsigned w = MIN2(bw, width - x);
-
-         etc2_rgb8_parse_block(&block, src,
-                               false /* punchthrough_alpha */);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     false /* punchthrough_alpha */);
-               dst[3] = 255;
-               dst += comps;
+   uint8_t palette[2][4][4];
+   unsigned blk, i;
+   int x, y;
+
+   etc2_rgb8_parse_block(&block, src, punchthrough_alpha);
+
+   if (block.is_planar_mode) {
+      for (y = 0; y < 4; y++) {
+         for (x = 0; x < 4; x++) {
+            for (i = 0; i < 3; i++) {
+               const int o = block.base_colors[0][i];
+               const int h = block.base_colors[1][i];
+               const int v = block.base_colors[2][i];
+
+               texels[y * 4 + x][i] =
+                  etc2_clamp((x * (h - o) + y * (v - o) + 4 * o + 2) >> 2);
             }
+            texels[y * 4 + x][3] = 255;
          }
-
-         src += bs;
       }
-
-      src_row += src_stride;
+      return;
    }
-}
-
-static void
-etc2_unpack_srgb8(uint8_t *dst_row,
-                  unsigned dst_stride,
-                  const uint8_t *src_row,
-                  unsigned src_stride,
-                  unsigned width,
-		  unsigned height,
-		  bool bgra)
-{
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
-
-   for (y = 0; y < height; y += bh) {
-      const uint8_t *src = src_row;
-      const unsigned h = MIN2(bh, height - y);
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgb8_parse_block(&block, src,
-                               false /* punchthrough_alpha */);
-
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     false /* punchthrough_alpha */);
-
-	       if (bgra) {
-		  /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-		  tmp = dst[0];
-		  dst[0] = dst[2];
-		  dst[2] = tmp;
-		  dst[3] = 255;
-	       }
-
-               dst += comps;
-            }
+   for (blk = 0; blk < 2; blk++) {
+      for (i = 0; i < 4; i++) {
+         if (block.is_t_mode || block.is_h_mode) {
+            palette[blk][i][0] = block.paint_colors[i][0];
+            palette[blk][i][1] = block.paint_colors[i][1];
+            palette[blk][i][2] = block.paint_colors[i][2];
+         } else {
+            const int modifier = block.modifier_tables[blk][i];
+
+            palette[blk][i][0] = etc2_clamp(block.base_colors[blk][0] +
+                                            modifier);
+            palette[blk][i][1] = etc2_clamp(block.base_colors[blk][1] +
+                                            modifier);
+            palette[blk][i][2] = etc2_clamp(block.base_colors[blk][2] +
+                                            modifier);
          }
-         src += bs;
+         palette[blk][i][3] = 255;
       }
 
-      src_row += src_stride;
+      if (punchthrough_alpha && !block.opaque)
+         memset(palette[blk][2], 0, 4);
    }
-}
 
-static void
-etc2_unpack_rgba8(uint8_t *dst_row,
-                  unsigned dst_stride,
-                  const uint8_t *src_row,
-                  unsigned src_stride,
-                  unsigned width,
-                  unsigned height)
-{
-   /* If internalformat is COMPRESSED_RGBA8_ETC2_EAC, each 4 × 4 block of
-    * RGBA8888 information is compressed to 128 bits. To decode a block, the
-    * two 64-bit integers int64bitAlpha and int64bitColor are calculated.
-   */
-   const unsigned bw = 4, bh = 4, bs = 16, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++) {
+         const unsigned bit = y + x * 4;
+         const unsigned idx = ((block.pixel_indices[0] >> (15 + bit)) & 0x2) |
+                              ((block.pixel_indices[0] >> bit) & 0x1);
 
-   for (y = 0; y < height; y += bh) {
-      const uint8_t *src = src_row;
-      const unsigned h = MIN2(bh, height - y);
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgba8_parse_block(&block, src);
+         /* T and H mode blocks have a single set of paint colors */
+         blk = (block.is_ind_mode || block.is_diff_mode) &&
+               (block.flipped ? y >= 2 : x >= 2);
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgba8_fetch_texel(&block, i, j, dst);
-               dst += comps;
-            }
-         }
-         src += bs;
+         memcpy(texels[y * 4 + x], palette[blk][idx], 4);
       }
-
-      src_row += src_stride;
    }
 }
 
+/**
+ * Decodes an EAC alpha block to the 4x4 bytes dst[0], dst[stride], ...,
+ * row by row.
+ */
 static void
-etc2_unpack_srgb8_alpha8(uint8_t *dst_row,
-                         unsigned dst_stride,
-                         const uint8_t *src_row,
-                         unsigned src_stride,
-                         unsigned width,
-			 unsigned height,
-			 bool bgra)
+etc2_alpha8_decode_block(const uint8_t *src, uint8_t *dst, unsigned stride)
 {
-   /* If internalformat is COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, each 4 × 4 block
-    * of RGBA8888 information is compressed to 128 bits. To decode a block, the
-    * two 64-bit integers int64bitAlpha and int64bitColor are calculated.
-    */
-   const unsigned bw = 4, bh = 4, bs = 16, comps = 4;
    struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
-
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
+   uint8_t palette[8];
+   unsigned i, x, y;
 
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgba8_parse_block(&block, src);
+   etc2_alpha8_parse_block(&block, src);
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgba8_fetch_texel(&block, i, j, dst);
-
-	       if (bgra) {
-		  /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-		  tmp = dst[0];
-		  dst[0] = dst[2];
-		  dst[2] = tmp;
-		  dst[3] = dst[3];
-	       }
-
-               dst += comps;
-            }
-         }
-         src += bs;
-      }
+   for (i = 0; i < 8; i++) {
+      const int modifier = etc2_modifier_tables[block.table_index][i];
 
-      src_row += src_stride;
+      palette[i] = etc2_clamp(block.base_codeword +
+                              modifier * block.multiplier);
    }
-}
-
-static void
-etc2_unpack_r11(uint8_t *dst_row,
-                unsigned dst_stride,
-                const uint8_t *src_row,
-                unsigned src_stride,
-                unsigned width,
-                unsigned height)
-{
-   /* If internalformat is COMPRESSED_R11_EAC, each 4 × 4 block of
-      color information is compressed to 64 bits.
-   */
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 1, comp_size = 2;
-   struct etc2_block block;
-   unsigned x, y, i, j;
 
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_r11_parse_block(&block, src);
-
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps * comp_size;
-            for (i = 0; i < w; i++) {
-               etc2_r11_fetch_texel(&block, i, j, dst);
-               dst += comps * comp_size;
-            }
-         }
-         src += bs;
-      }
-
-      src_row += src_stride;
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++)
+         dst[(y * 4 + x) * stride] = palette[etc2_get_pixel_index(&block, x, y)];
    }
 }
 
+/**
+ * Decodes an R11 block to the 4x4 16-bit values dst[0], dst[stride], ...,
+ * row by row.
+ */
 static void
-etc2_unpack_rg11(uint8_t *dst_row,
-                 unsigned dst_stride,
-                 const uint8_t *src_row,
-                 unsigned src_stride,
-                 unsigned width,
-                 unsigned height)
+etc2_r11_decode_block(const uint8_t *src, uint16_t *dst, unsigned stride)
 {
-   /* If internalformat is COMPRESSED_RG11_EAC, each 4 × 4 block of
-      RG color information is compressed to 128 bits.
-   */
-   const unsigned bw = 4, bh = 4, bs = 16, comps = 2, comp_size = 2;
    struct etc2_block block;
-   unsigned x, y, i, j;
-
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
+   uint16_t palette[8];
+   unsigned i, x, y;
 
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         /* red component */
-         etc2_r11_parse_block(&block, src);
+   etc2_r11_parse_block(&block, src);
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride +
-                           x * comps * comp_size;
-            for (i = 0; i < w; i++) {
-               etc2_r11_fetch_texel(&block, i, j, dst);
-               dst += comps * comp_size;
-            }
-         }
-         /* green component */
-         etc2_r11_parse_block(&block, src + 8);
+   for (i = 0; i < 8; i++) {
+      const int modifier = etc2_modifier_tables[block.table_index][i];
+      unsigned color;
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride +
-                           x * comps * comp_size;
-            for (i = 0; i < w; i++) {
-               etc2_r11_fetch_texel(&block, i, j, dst + comp_size);
-               dst += comps * comp_size;
-            }
-         }
-         src += bs;
-      }
+      if (block.multiplier != 0)
+         color = etc2_clamp2(((block.base_codeword << 3) | 0x4) +
+                             modifier * block.multiplier * 8);
+      else
+         color = etc2_clamp2(((block.base_codeword << 3) | 0x4) + modifier);
 
-      src_row += src_stride;
+      /* Extend the 11 bits to 16 bits, see etc2_r11_fetch_texel() */
+      palette[i] = (color << 5) | (color >> 6);
    }
-}
-
-static void
-etc2_unpack_signed_r11(uint8_t *dst_row,
-                       unsigned dst_stride,
-                       const uint8_t *src_row,
-                       unsigned src_stride,
-                       unsigned width,
-                       unsigned height)
-{
-   /* If internalformat is COMPRESSED_SIGNED_R11_EAC, each 4 × 4 block of
-      red color information is compressed to 64 bits.
-   */
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 1, comp_size = 2;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
-
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_r11_parse_block(&block, src);
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride +
-                           x * comps * comp_size;
-            for (i = 0; i < w; i++) {
-               etc2_signed_r11_fetch_texel(&block, i, j, dst);
-               dst += comps * comp_size;
-            }
-         }
-         src += bs;
-      }
-
-      src_row += src_stride;
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++)
+         dst[(y * 4 + x) * stride] = palette[etc2_get_pixel_index(&block, x, y)];
    }
 }
 
+/** Signed counterpart of etc2_r11_decode_block() */
 static void
-etc2_unpack_signed_rg11(uint8_t *dst_row,
-                        unsigned dst_stride,
-                        const uint8_t *src_row,
-                        unsigned src_stride,
-                        unsigned width,
-                        unsigned height)
+etc2_signed_r11_decode_block(const uint8_t *src, int16_t *dst, unsigned stride)
 {
-   /* If internalformat is COMPRESSED_SIGNED_RG11_EAC, each 4 × 4 block of
-      RG color information is compressed to 128 bits.
-   */
-   const unsigned bw = 4, bh = 4, bs = 16, comps = 2, comp_size = 2;
    struct etc2_block block;
-   unsigned x, y, i, j;
+   int16_t palette[8];
+   int base_codeword;
+   unsigned i, x, y;
 
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
+   etc2_r11_parse_block(&block, src);
 
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         /* red component */
-         etc2_r11_parse_block(&block, src);
+   base_codeword = MAX2((int8_t) block.base_codeword, -127);
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride +
-                          x * comps * comp_size;
-            for (i = 0; i < w; i++) {
-               etc2_signed_r11_fetch_texel(&block, i, j, dst);
-               dst += comps * comp_size;
-            }
-         }
-         /* green component */
-         etc2_r11_parse_block(&block, src + 8);
+   for (i = 0; i < 8; i++) {
+      const int modifier = etc2_modifier_tables[block.table_index][i];
+      int color;
 
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride +
-                           x * comps * comp_size;
-            for (i = 0; i < w; i++) {
-               etc2_signed_r11_fetch_texel(&block, i, j, dst + comp_size);
-               dst += comps * comp_size;
-            }
-         }
-         src += bs;
-      }
+      if (block.multiplier != 0)
+         color = etc2_clamp3(base_codeword * 8 +
+                             modifier * block.multiplier * 8);
+      else
+         color = etc2_clamp3(base_codeword * 8 + modifier);
 
-      src_row += src_stride;
+      /* Extend the 11 bits to 16 bits, see etc2_signed_r11_fetch_texel() */
+      if (color >= 0)
+         palette[i] = (color << 5) | (color >> 5);
+      else
+         palette[i] = -((-color << 5) | (-color >> 5));
+   }
+
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++)
+         dst[(y * 4 + x) * stride] = palette[etc2_get_pixel_index(&block, x, y)];
    }
 }
 
-static void
-etc2_unpack_rgb8_punchthrough_alpha1(uint8_t *dst_row,
-                                     unsigned dst_stride,
-                                     const uint8_t *src_row,
-                                     unsigned src_stride,
-                                     unsigned width,
-                                     unsigned height)
+/** The 4x4 texels of a decoded ETC2 block, row by row */
+union etc2_texels {
+   uint8_t rgba[16][4];
+   uint16_t r11[16 * 2];
+   int16_t signed_r11[16 * 2];
+};
+
+/**
+ * Decodes a block of any ETC2 format and returns the size of a texel: 4
+ * bytes for the RGBA and RG formats, 2 for the R formats.
+ *
+ * The RGBA formats are decoded to BGRA if bgra is set.
+ */
+static unsigned
+etc2_decode_block(const uint8_t *src, mesa_format format, bool bgra,
+                  union etc2_texels *texels)
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
+   uint8_t (*rgba)[4] = texels->rgba;
+   unsigned i;
 
-   for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
-      const uint8_t *src = src_row;
+   switch (format) {
+   case MESA_FORMAT_ETC2_R11_EAC:
+      etc2_r11_decode_block(src, texels->r11, 1);
+      return 2;
+   case MESA_FORMAT_ETC2_RG11_EAC:
+      etc2_r11_decode_block(src, texels->r11, 2);
+      etc2_r11_decode_block(src + 8, texels->r11 + 1, 2);
+      return 4;
+   case MESA_FORMAT_ETC2_SIGNED_R11_EAC:
+      etc2_signed_r11_decode_block(src, texels->signed_r11, 1);
+      return 2;
+   case MESA_FORMAT_ETC2_SIGNED_RG11_EAC:
+      etc2_signed_r11_decode_block(src, texels->signed_r11, 2);
+      etc2_signed_r11_decode_block(src + 8, texels->signed_r11 + 1, 2);
+      return 4;
+   case MESA_FORMAT_ETC2_RGBA8_EAC:
+   case MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC:
+      /* The color block follows the alpha block */
+      etc2_rgb8_decode_block(src + 8, rgba, false /* punchthrough_alpha */);
+      etc2_alpha8_decode_block(src, &rgba[0][3], 4);
+      break;
+   case MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1:
+   case MESA_FORMAT_ETC2_SRGB8_PUNCHTHROUGH_ALPHA1:
+      etc2_rgb8_decode_block(src, rgba, true /* punchthrough_alpha */);
+      break;
+   default:
+      assert(format == MESA_FORMAT_ETC2_RGB8 ||
+             format == MESA_FORMAT_ETC2_SRGB8);
+      etc2_rgb8_decode_block(src, rgba, false /* punchthrough_alpha */);
+      break;
+   }
 
-      for (x = 0; x < width; x+= bw) {
-         const unsigned w = MIN2(bw, width - x);
-         etc2_rgb8_parse_block(&block, src,
-                               true /* punchthrough_alpha */);
-         for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     true /* punchthrough_alpha */);
-               dst += comps;
-            }
-         }
+   if (bgra) {
+      for (i = 0; i < 16; i++) {
+         const uint8_t tmp = rgba[i][0];
 
-         src += bs;
+         rgba[i][0] = rgba[i][2];
+         rgba[i][2] = tmp;
       }
-
-      src_row += src_stride;
    }
+
+   return 4;
 }
 
 static void
-etc2_unpack_srgb8_punchthrough_alpha1(uint8_t *dst_row,
-                                     unsigned dst_stride,
-                                     const uint8_t *src_row,
-                                     unsigned src_stride,
-                                     unsigned width,
-				     unsigned height,
-				     bool bgra)
+etc2_unpack(uint8_t *dst_row,
+            unsigned dst_stride,
+            const uint8_t *src_row,
+            unsigned src_stride,
+            unsigned width,
+            unsigned height,
+            mesa_format format,
+            bool bgra)
 {
-   const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc2_block block;
-   unsigned x, y, i, j;
-   uint8_t tmp;
+   const unsigned bw = 4, bh = 4;
+   const unsigned bs = _mesa_get_format_bytes(format);
+   unsigned x, y, j;
+
+   /* Only the sRGB formats are stored as MESA_FORMAT_B8G8R8A8_SRGB */
+   bgra = bgra && _mesa_get_format_color_encoding(format) == GL_SRGB;
 
    for (y = 0; y < height; y += bh) {
-      const unsigned h = MIN2(bh, height - y);
       const uint8_t *src = src_row;
+      /*
+       * Destination texture may not be a multiple of four texels in
+       * height. Compute a safe height to avoid writing outside the texture.
+       */
+      const unsigned h = MIN2(bh, height - y);
 
-      for (x = 0; x < width; x+= bw) {
+      for (x = 0; x < width; x += bw) {
+         /*
+          * Destination texture may not be a multiple of four texels in
+          * width. Compute a safe width to avoid writing outside the texture.
+          */
          const unsigned w = MIN2(bw, width - x);
-         etc2_rgb8_parse_block(&block, src,
-                               true /* punchthrough_alpha */);
+         union etc2_texels texels;
+         const unsigned texel_bytes =
+            etc2_decode_block(src, format, bgra, &texels);
+
          for (j = 0; j < h; j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < w; i++) {
-               etc2_rgb8_fetch_texel(&block, i, j, dst,
-                                     true /* punchthrough_alpha */);
-
-	       if (bgra) {
-		  /* Convert to MESA_FORMAT_B8G8R8A8_SRGB */
-		  tmp = dst[0];
-		  dst[0] = dst[2];
-		  dst[2] = tmp;
-		  dst[3] = dst[3];
-	       }
-
-               dst += comps;
-            }
+            memcpy(dst_row + (y + j) * dst_stride + x * texel_bytes,
+                   (const uint8_t *) &texels + j * bw * texel_bytes,
+                   w * texel_bytes);
          }
 
          src += bs;
@@ -1189,6 +997,99 @@ _mesa_texstore_etc2_srgb8_punchthrough_alpha1(UNUSED_TEXSTORE_PARAMS)
 }
 
 
+struct etc_unpack_job {
+   uint8_t *dst_row;
+   unsigned dst_stride;
+   const uint8_t *src_row;
+   unsigned src_stride;
+   unsigned width;
+   unsigned height;
+   mesa_format format;
+   bool bgra;
+};
+
+static void
+etc_unpack_rows(void *data, unsigned by1, unsigned by2)
+{
+   const struct etc_unpack_job *job = data;
+   const unsigned y = by1 * 4;
+   uint8_t *dst_row = job->dst_row + (size_t) y * job->dst_stride;
+   const uint8_t *src_row = job->src_row + (size_t) by1 * job->src_stride;
+   const unsigned height = MIN2(by2 * 4, job->height) - y;
+
+   if (job->format == MESA_FORMAT_ETC1_RGB8)
+      etc1_unpack_rgba8888(dst_row, job->dst_stride,
+                           src_row, job->src_stride, job->width, height);
+   else
+      etc2_unpack(dst_row, job->dst_stride, src_row, job->src_stride,
+                  job->width, height, job->format, job->bgra);
+}
+
+/** Cost of a block, in bytes of the simple conversions util_parallel_rows()
+ * is tuned for.
+ */
+#define ETC_BLOCK_COST 256
+
+/**
+ * Decodes large images by bands of rows of blocks on the shared pool.
+ */
+static void
+etc_unpack_parallel(uint8_t *dst_row,
+                    unsigned dst_stride,
+                    const uint8_t *src_row,
+                    unsigned src_stride,
+                    unsigned width,
+                    unsigned height,
+                    mesa_format format,
+                    bool bgra)
+{
+   struct etc_unpack_job job = {
+      .dst_row = dst_row,
+      .dst_stride = dst_stride,
+      .src_row = src_row,
+      .src_stride = src_stride,
+      .width = width,
+      .height = height,
+      .format = format,
+      .bgra = bgra,
+   };
+
+   util_parallel_rows(util_parallel_queue(), DIV_ROUND_UP(height, 4), 1,
+                      (size_t) DIV_ROUND_UP(width, 4) * ETC_BLOCK_COST,
+                      etc_unpack_rows, &job);
+}
+
+/**
+ * Decode texture data in format `MESA_FORMAT_ETC1_RGB8` to
+ * `MESA_FORMAT_ABGR8888`.
+ *
+ * The size of the source data must be a multiple of the ETC1 block size,
+ * which is 8, even if the texture image's dimensions are not aligned to 4.
+ * From the GL_OES_compressed_ETC1_RGB8_texture spec:
+ *   The texture is described as a number of 4x4 pixel blocks. If the
+ *   texture (or a particular mip-level) is smaller than 4 pixels in
+ *   any dimension (such as a 2x2 or a 8x1 texture), the texture is
+ *   found in the upper left part of the block(s), and the rest of the
+ *   pixels are not used. For instance, a texture of size 4x2 will be
+ *   placed in the upper half of a 4x4 block, and the lower half of the
+ *   pixels in the block will not be accessed.
+ *
+ * \param src_width in pixels
+ * \param src_height in pixels
+ * \param dst_stride in bytes
+ */
+void
+_mesa_etc1_unpack_rgba8888(uint8_t *dst_row,
+                           unsigned dst_stride,
+                           const uint8_t *src_row,
+                           unsigned src_stride,
+                           unsigned src_width,
+                           unsigned src_height)
+{
+   etc_unpack_parallel(dst_row, dst_stride, src_row, src_stride,
+                       src_width, src_height, MESA_FORMAT_ETC1_RGB8, false);
+}
+
 /**
  * Decode texture data in any one of following formats:
  * `MESA_FORMAT_ETC2_RGB8`
@@ -1205,6 +1106,9 @@ _mesa_texstore_etc2_srgb8_punchthrough_alpha1(UNUSED_TEXSTORE_PARAMS)
  * The size of the source data must be a multiple of the ETC2 block size
  * even if the texture image's dimensions are not aligned to 4.
  *
+ * The sRGB formats are decoded to `MESA_FORMAT_B8G8R8A8_SRGB` if bgra is
+ * set.
+ *
  * \param src_width in pixels
  * \param src_height in pixels
  * \param dst_stride in bytes
@@ -1220,46 +1124,8 @@ _mesa_unpack_etc2_format(uint8_t *dst_row,
 			 mesa_format format,
 			 bool bgra)
 {
-   if (format == MESA_FORMAT_ETC2_RGB8)
-      etc2_unpack_rgb8(dst_row, dst_stride,
-                       src_row, src_stride,
-                       src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_SRGB8)
-      etc2_unpack_srgb8(dst_row, dst_stride,
-                        src_row, src_stride,
-			src_width, src_height, bgra);
-   else if (format == MESA_FORMAT_ETC2_RGBA8_EAC)
-      etc2_unpack_rgba8(dst_row, dst_stride,
-                        src_row, src_stride,
-                        src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_SRGB8_ALPHA8_EAC)
-      etc2_unpack_srgb8_alpha8(dst_row, dst_stride,
-                               src_row, src_stride,
-			       src_width, src_height, bgra);
-   else if (format == MESA_FORMAT_ETC2_R11_EAC)
-      etc2_unpack_r11(dst_row, dst_stride,
-                      src_row, src_stride,
-                      src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_RG11_EAC)
-      etc2_unpack_rg11(dst_row, dst_stride,
-                       src_row, src_stride,
-                       src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_SIGNED_R11_EAC)
-      etc2_unpack_signed_r11(dst_row, dst_stride,
-                             src_row, src_stride,
-                             src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_SIGNED_RG11_EAC)
-      etc2_unpack_signed_rg11(dst_row, dst_stride,
-                              src_row, src_stride,
-                              src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_RGB8_PUNCHTHROUGH_ALPHA1)
-      etc2_unpack_rgb8_punchthrough_alpha1(dst_row, dst_stride,
-                                           src_row, src_stride,
-                                           src_width, src_height);
-   else if (format == MESA_FORMAT_ETC2_SRGB8_PUNCHTHROUGH_ALPHA1)
-      etc2_unpack_srgb8_punchthrough_alpha1(dst_row, dst_stride,
-                                            src_row, src_stride,
-					    src_width, src_height, bgra);
+   etc_unpack_parallel(dst_row, dst_stride, src_row, src_stride,
+                       src_width, src_height, format, bgra);
 }
 
 
@@ -135,6 +135,51 @@ TAG(etc1_fetch_texel)(const struct TAG(etc1_block) *block,
    dst[2] = TAG(etc1_clamp)(base_color[2], modifier);
 }
 
+/**
+ * Decodes a whole block to 4x4 RGBA texels, row by row, alpha being 255.
+ * The 2 x 4 colors the block can select are computed once, instead of per
+ * texel.
+ */
+static void
+TAG(etc1_decode_block)(const UINT8_TYPE *src, UINT8_TYPE texels[16][4])
+{
+   struct TAG(etc1_block) block;
+   UINT8_TYPE palette[2][4][4];
+   int blk, idx, bit, x, y;
+
+   TAG(etc1_parse_block)(&block, src);
+
+   for (blk = 0; blk < 2; blk++) {
+      for (idx = 0; idx < 4; idx++) {
+         const int modifier = block.modifier_tables[blk][idx];
+
+         palette[blk][idx][0] =
+            TAG(etc1_clamp)(block.base_colors[blk][0], modifier);
+         palette[blk][idx][1] =
+            TAG(etc1_clamp)(block.base_colors[blk][1], modifier);
+         palette[blk][idx][2] =
+            TAG(etc1_clamp)(block.base_colors[blk][2], modifier);
+         palette[blk][idx][3] = 255;
+      }
+   }
+
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++) {
+         UINT8_TYPE *dst = texels[y * 4 + x];
+
+         bit = y + x * 4;
+         idx = ((block.pixel_indices >> (15 + bit)) & 0x2) |
+               ((block.pixel_indices >>      (bit)) & 0x1);
+         blk = (block.flipped) ? (y >= 2) : (x >= 2);
+
+         dst[0] = palette[blk][idx][0];
+         dst[1] = palette[blk][idx][1];
+         dst[2] = palette[blk][idx][2];
+         dst[3] = palette[blk][idx][3];
+      }
+   }
+}
+
 static void
 etc1_unpack_rgba8888(uint8_t *dst_row,
                      unsigned dst_stride,
@@ -144,22 +189,18 @@ etc1_unpack_rgba8888(uint8_t *dst_row,
                      unsigned height)
 {
    const unsigned bw = 4, bh = 4, bs = 8, comps = 4;
-   struct etc1_block block;
-   unsigned x, y, i, j;
+   uint8_t texels[16][4];
+   unsigned x, y, j;
 
    for (y = 0; y < height; y += bh) {
       const uint8_t *src = src_row;
 
       for (x = 0; x < width; x+= bw) {
-         etc1_parse_block(&block, src);
+         etc1_decode_block(src, texels);
 
          for (j = 0; j < MIN2(bh, height - y); j++) {
-            uint8_t *dst = dst_row + (y + j) * dst_stride + x * comps;
-            for (i = 0; i < MIN2(bw, width - x); i++) {
-               etc1_fetch_texel(&block, i, j, dst);
-               dst[3] = 255;
-               dst += comps;
-            }
+            memcpy(dst_row + (y + j) * dst_stride + x * comps,
+                   texels[j * bw], MIN2(bw, width - x) * comps);
          }
 
          src += bs;
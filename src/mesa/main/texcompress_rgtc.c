@@ -41,157 +41,73 @@
 #include "mipmap.h"
 #include "texcompress.h"
 #include "util/rgtc.h"
+#include "util/texcompress_bcn.h"
 #include "texcompress_rgtc.h"
 #include "texstore.h"
 
-static void extractsrc_u( GLubyte srcpixels[4][4], const GLubyte *srcaddr,
-			  GLint srcRowStride, GLint numxpixels, GLint numypixels, GLint comps)
-{
-   GLubyte i, j;
-   const GLubyte *curaddr;
-   for (j = 0; j < numypixels; j++) {
-      curaddr = srcaddr + j * srcRowStride * comps;
-      for (i = 0; i < numxpixels; i++) {
-	 srcpixels[j][i] = *curaddr;
-	 curaddr += comps;
-      }
-   }
-}
-
-static void extractsrc_s( GLbyte srcpixels[4][4], const GLfloat *srcaddr,
-			  GLint srcRowStride, GLint numxpixels, GLint numypixels, GLint comps)
-{
-   GLubyte i, j;
-   const GLfloat *curaddr;
-   for (j = 0; j < numypixels; j++) {
-      curaddr = srcaddr + j * srcRowStride * comps;
-      for (i = 0; i < numxpixels; i++) {
-	 srcpixels[j][i] = FLOAT_TO_BYTE_TEX(*curaddr);
-	 curaddr += comps;
-      }
-   }
-}
-
-
-GLboolean
-_mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
+/**
+ * Converts the user's image to 8-bit red or red/green, the signed or unsigned
+ * flavour matching the format, and compresses that.
+ */
+static GLboolean
+texstore_rgtc(TEXSTORE_PARAMS, mesa_format tempFormat, GLuint comps,
+              enum util_bcn_format bcnFormat)
 {
-   GLubyte *dst;
-   const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff, redRowStride;
+   GLubyte *tempImage;
    GLubyte *tempImageSlices[1];
+   const GLint tempRowStride = comps * srcWidth * sizeof(GLubyte);
 
-   assert(dstFormat == MESA_FORMAT_R_RGTC1_UNORM ||
-          dstFormat == MESA_FORMAT_L_LATC1_UNORM);
-
-   tempImage = malloc(srcWidth * srcHeight * 1 * sizeof(GLubyte));
+   tempImage = malloc(srcWidth * srcHeight * comps * sizeof(GLubyte));
    if (!tempImage)
       return GL_FALSE; /* out of memory */
-   redRowStride = 1 * srcWidth * sizeof(GLubyte);
-   tempImageSlices[0] = (GLubyte *) tempImage;
+   tempImageSlices[0] = tempImage;
    _mesa_texstore(ctx, dims,
                   baseInternalFormat,
-                  MESA_FORMAT_R_UNORM8,
-                  redRowStride, tempImageSlices,
+                  tempFormat,
+                  tempRowStride, tempImageSlices,
                   srcWidth, srcHeight, srcDepth,
                   srcFormat, srcType, srcAddr,
                   srcPacking);
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   util_bcn_compress(bcnFormat, util_bcn_default_quality(),
+                     srcWidth, srcHeight, tempImage, comps, tempRowStride,
+                     dstSlices[0], dstRowStride);
 
-   free((void *) tempImage);
+   free(tempImage);
 
    return GL_TRUE;
 }
 
 GLboolean
-_mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
+_mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
-   const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff, redRowStride;
-   GLfloat *tempImageSlices[1];
+   assert(dstFormat == MESA_FORMAT_R_RGTC1_UNORM ||
+          dstFormat == MESA_FORMAT_L_LATC1_UNORM);
 
+   return texstore_rgtc(ctx, dims, baseInternalFormat, dstFormat,
+                        dstRowStride, dstSlices,
+                        srcWidth, srcHeight, srcDepth,
+                        srcFormat, srcType, srcAddr, srcPacking,
+                        MESA_FORMAT_R_UNORM8, 1, UTIL_BCN_BC4_UNORM);
+}
+
+GLboolean
+_mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
+{
    assert(dstFormat == MESA_FORMAT_R_RGTC1_SNORM ||
           dstFormat == MESA_FORMAT_L_LATC1_SNORM);
 
-   redRowStride = 1 * srcWidth * sizeof(GLfloat);
-   tempImage = malloc(srcWidth * srcHeight * 1 * sizeof(GLfloat));
-   if (!tempImage)
-      return GL_FALSE; /* out of memory */
-   tempImageSlices[0] = (GLfloat *) tempImage;
-   _mesa_texstore(ctx, dims,
-                  baseInternalFormat,
-                  MESA_FORMAT_R_FLOAT32,
-                  redRowStride, (GLubyte **)tempImageSlices,
-                  srcWidth, srcHeight, srcDepth,
-                  srcFormat, srcType, srcAddr,
-                  srcPacking);
-
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
-
-   free((void *) tempImage);
-
-   return GL_TRUE;
+   return texstore_rgtc(ctx, dims, baseInternalFormat, dstFormat,
+                        dstRowStride, dstSlices,
+                        srcWidth, srcHeight, srcDepth,
+                        srcFormat, srcType, srcAddr, srcPacking,
+                        MESA_FORMAT_R_SNORM8, 1, UTIL_BCN_BC4_SNORM);
 }
 
 GLboolean
 _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLubyte *dst;
-   const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff, rgRowStride;
    mesa_format tempFormat;
-   GLubyte *tempImageSlices[1];
 
    assert(dstFormat == MESA_FORMAT_RG_RGTC2_UNORM ||
           dstFormat == MESA_FORMAT_LA_LATC2_UNORM);
@@ -203,113 +119,33 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
       tempFormat = _mesa_little_endian() ? MESA_FORMAT_L8A8_UNORM
                                          : MESA_FORMAT_A8L8_UNORM;
 
-   rgRowStride = 2 * srcWidth * sizeof(GLubyte);
-   tempImage = malloc(srcWidth * srcHeight * 2 * sizeof(GLubyte));
-   if (!tempImage)
-      return GL_FALSE; /* out of memory */
-   tempImageSlices[0] = (GLubyte *) tempImage;
-   _mesa_texstore(ctx, dims,
-                  baseInternalFormat,
-                  tempFormat,
-                  rgRowStride, tempImageSlices,
-                  srcWidth, srcHeight, srcDepth,
-                  srcFormat, srcType, srcAddr,
-                  srcPacking);
-
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-	 extractsrc_u(srcpixels, (GLubyte *)srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 util_format_unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-      }
-      blkaddr += dstRowDiff;
-   }
-
-   free((void *) tempImage);
-
-   return GL_TRUE;
+   return texstore_rgtc(ctx, dims, baseInternalFormat, dstFormat,
+                        dstRowStride, dstSlices,
+                        srcWidth, srcHeight, srcDepth,
+                        srcFormat, srcType, srcAddr, srcPacking,
+                        tempFormat, 2, UTIL_BCN_BC5_UNORM);
 }
 
 GLboolean
 _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
-   const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff, rgRowStride;
    mesa_format tempFormat;
-   GLfloat *tempImageSlices[1];
 
    assert(dstFormat == MESA_FORMAT_RG_RGTC2_SNORM ||
           dstFormat == MESA_FORMAT_LA_LATC2_SNORM);
 
    if (baseInternalFormat == GL_RG)
-      tempFormat = MESA_FORMAT_RG_FLOAT32;
+      tempFormat = _mesa_little_endian() ? MESA_FORMAT_R8G8_SNORM
+                                         : MESA_FORMAT_G8R8_SNORM;
    else
-      tempFormat = MESA_FORMAT_LA_FLOAT32;
-
-   rgRowStride = 2 * srcWidth * sizeof(GLfloat);
-   tempImage = malloc(srcWidth * srcHeight * 2 * sizeof(GLfloat));
-   if (!tempImage)
-      return GL_FALSE; /* out of memory */
-   tempImageSlices[0] = (GLfloat *) tempImage;
-   _mesa_texstore(ctx, dims,
-                  baseInternalFormat,
-                  tempFormat,
-                  rgRowStride, (GLubyte **)tempImageSlices,
-                  srcWidth, srcHeight, srcDepth,
-                  srcFormat, srcType, srcAddr,
-                  srcPacking);
-
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j += 4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 extractsrc_s(srcpixels, srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 util_format_signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-
-      }
-      blkaddr += dstRowDiff;
-   }
-
-   free((void *) tempImage);
-
-   return GL_TRUE;
+      tempFormat = _mesa_little_endian() ? MESA_FORMAT_L8A8_SNORM
+                                         : MESA_FORMAT_A8L8_SNORM;
+
+   return texstore_rgtc(ctx, dims, baseInternalFormat, dstFormat,
+                        dstRowStride, dstSlices,
+                        srcWidth, srcHeight, srcDepth,
+                        srcFormat, srcType, srcAddr, srcPacking,
+                        tempFormat, 2, UTIL_BCN_BC5_SNORM);
 }
 
 static void
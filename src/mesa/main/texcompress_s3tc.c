@@ -40,6 +40,7 @@
 #include "texstore.h"
 #include "format_unpack.h"
 #include "util/format_srgb.h"
+#include "util/texcompress_bcn.h"
 
 
 /**
@@ -84,9 +85,9 @@ _mesa_texstore_rgb_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(3, srcWidth, srcHeight, pixels,
-                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
-                    dst, dstRowStride);
+   util_bcn_compress(UTIL_BCN_BC1_RGB, util_bcn_default_quality(),
+                     srcWidth, srcHeight, pixels, 3, srcWidth * 3,
+                     dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -137,9 +138,9 @@ _mesa_texstore_rgba_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
-                    GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
-                    dst, dstRowStride);
+   util_bcn_compress(UTIL_BCN_BC1_RGBA, util_bcn_default_quality(),
+                     srcWidth, srcHeight, pixels, 4, srcWidth * 4,
+                     dst, dstRowStride);
 
    free((void*) tempImage);
 
@@ -189,9 +190,9 @@ _mesa_texstore_rgba_dxt3(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
-                    GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
-                    dst, dstRowStride);
+   util_bcn_compress(UTIL_BCN_BC2, util_bcn_default_quality(),
+                     srcWidth, srcHeight, pixels, 4, srcWidth * 4,
+                     dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -241,9 +242,9 @@ _mesa_texstore_rgba_dxt5(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
-                    GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
-                    dst, dstRowStride);
+   util_bcn_compress(UTIL_BCN_BC3, util_bcn_default_quality(),
+                     srcWidth, srcHeight, pixels, 4, srcWidth * 4,
+                     dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -48,6 +48,7 @@
 #include "texstore.h"
 #include "format_utils.h"
 #include "pixeltransfer.h"
+#include "util/u_parallel.h"
 
 /**
  * Can the given type represent negative values?
@@ -300,6 +301,107 @@ teximage_needs_rebase(mesa_format texFormat, GLenum baseFormat,
 }
 
 
+/**
+ * Rows of the float RGBA intermediate that readback_rows() works on at a
+ * time, so that it stays in the cache between its two conversions.
+ */
+#define READBACK_CHUNK_BYTES (64 * 1024)
+
+/**
+ * A readback which needs to go through float RGBA, because the texture is
+ * compressed or because of transfer ops.
+ */
+struct readback_job {
+   struct gl_context *ctx;
+   const GLubyte *src;
+   mesa_format src_format;
+   GLint src_stride;
+   GLubyte *dst;
+   uint32_t dst_format;
+   GLint dst_stride;
+   GLsizei width;
+   GLbitfield transferOps;
+   uint8_t *src_swizzle;   /**< rebase when converting to float */
+   uint8_t *dst_swizzle;   /**< rebase when converting from float */
+   bool out_of_memory;
+};
+
+/**
+ * Decompress or convert the rows [y1, y2) to float RGBA a chunk at a time,
+ * apply the transfer ops and convert the chunk to the destination format.
+ */
+static void
+readback_rows(void *data, unsigned y1, unsigned y2)
+{
+   struct readback_job *job = data;
+   const bool compressed = _mesa_is_format_compressed(job->src_format);
+   const int rgba_stride = job->width * 4 * sizeof(GLfloat);
+   /* float RGBA out, the chunks can be converted in place */
+   const bool direct = job->dst_format == RGBA32_FLOAT &&
+                       job->dst_stride == rgba_stride && !job->dst_swizzle;
+   GLfloat *rgba = NULL;
+   GLuint bw, bh, rows, y;
+
+   _mesa_get_format_block_size(job->src_format, &bw, &bh);
+   rows = MAX2(READBACK_CHUNK_BYTES / rgba_stride, 1);
+   rows = DIV_ROUND_UP(rows, bh) * bh;
+
+   if (!direct) {
+      rgba = malloc(rows * rgba_stride);
+      if (!rgba) {
+         job->out_of_memory = true;
+         return;
+      }
+   }
+
+   for (y = y1; y < y2; y += rows) {
+      const GLuint h = MIN2(rows, y2 - y);
+      const GLubyte *src = job->src + (ptrdiff_t) (y / bh) * job->src_stride;
+      GLubyte *dst = job->dst + (ptrdiff_t) y * job->dst_stride;
+      GLfloat *chunk = direct ? (GLfloat *) dst : rgba;
+
+      if (compressed) {
+         _mesa_decompress_image(job->src_format, job->width, h,
+                                src, job->src_stride, chunk);
+      } else {
+         _mesa_format_convert(chunk, RGBA32_FLOAT, rgba_stride,
+                              (void *) src, job->src_format, job->src_stride,
+                              job->width, h, job->src_swizzle);
+      }
+
+      if (job->transferOps) {
+         _mesa_apply_rgba_transfer_ops(job->ctx, job->transferOps,
+                                       job->width * h, (GLfloat (*)[4]) chunk);
+      }
+
+      if (!direct) {
+         _mesa_format_convert(dst, job->dst_format, job->dst_stride,
+                              rgba, RGBA32_FLOAT, rgba_stride,
+                              job->width, h, job->dst_swizzle);
+      }
+   }
+
+   free(rgba);
+}
+
+/**
+ * Run a readback_job over height rows, in parallel bands for large images.
+ */
+static bool
+readback_image(struct readback_job *job, GLsizei height)
+{
+   GLuint bw, bh;
+
+   _mesa_get_format_block_size(job->src_format, &bw, &bh);
+   job->out_of_memory = false;
+
+   util_parallel_rows(util_parallel_queue(), height, bh,
+                      job->width * 4 * sizeof(GLfloat), readback_rows, job);
+
+   return !job->out_of_memory;
+}
+
+
 /**
  * Get a color texture image with decompression.
  */
@@ -315,70 +417,55 @@ get_tex_rgba_compressed(struct gl_context *ctx, GLuint dimensions,
    const mesa_format texFormat =
       _mesa_get_srgb_format_linear(texImage->TexFormat);
    const GLenum baseFormat = _mesa_get_format_base_format(texFormat);
-   GLfloat *tempImage, *tempSlice;
    GLuint slice;
-   int srcStride, dstStride;
-   uint32_t dstFormat;
-   bool needsRebase;
    uint8_t rebaseSwizzle[4];
-
-   /* Decompress into temp float buffer, then pack into user buffer */
-   tempImage = malloc(width * height * depth * 4 * sizeof(GLfloat));
-   if (!tempImage) {
-      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage()");
-      return;
-   }
-
-   /* Decompress the texture image slices - results in 'tempImage' */
+   struct readback_job job = {
+      .ctx = ctx,
+      .src_format = texFormat,
+      .dst_format = _mesa_format_from_format_and_type(format, type),
+      .dst_stride = _mesa_image_row_stride(&ctx->Pack, width, format, type),
+      .width = width,
+   };
+
+   if (teximage_needs_rebase(texFormat, baseFormat, true, rebaseSwizzle))
+      job.dst_swizzle = rebaseSwizzle;
+
+   /* The decompressed rows are packed into the user buffer in chunks,
+    * without a float copy of the whole image.
+    */
    for (slice = 0; slice < depth; slice++) {
       GLubyte *srcMap;
       GLint srcRowStride;
-
-      tempSlice = tempImage + slice * 4 * width * height;
+      void *dest = _mesa_image_address(dimensions, &ctx->Pack, pixels,
+                                       width, height, format, type,
+                                       slice, 0, 0);
 
       ctx->Driver.MapTextureImage(ctx, texImage, zoffset + slice,
                                   xoffset, yoffset, width, height,
                                   GL_MAP_READ_BIT,
                                   &srcMap, &srcRowStride);
-      if (srcMap) {
-         _mesa_decompress_image(texFormat, width, height,
-                                srcMap, srcRowStride, tempSlice);
-
-         ctx->Driver.UnmapTextureImage(ctx, texImage, zoffset + slice);
-      }
-      else {
+      if (!srcMap) {
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage");
-         free(tempImage);
          return;
       }
-   }
 
-   needsRebase = teximage_needs_rebase(texFormat, baseFormat, true,
-                                       rebaseSwizzle);
+      job.src = srcMap;
+      job.src_stride = srcRowStride;
+      job.dst = dest;
+      if (!readback_image(&job, height)) {
+         _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage()");
+         ctx->Driver.UnmapTextureImage(ctx, texImage, zoffset + slice);
+         return;
+      }
 
-   srcStride = 4 * width * sizeof(GLfloat);
-   dstStride = _mesa_image_row_stride(&ctx->Pack, width, format, type);
-   dstFormat = _mesa_format_from_format_and_type(format, type);
-   tempSlice = tempImage;
-   for (slice = 0; slice < depth; slice++) {
-      void *dest = _mesa_image_address(dimensions, &ctx->Pack, pixels,
-                                       width, height, format, type,
-                                       slice, 0, 0);
-      _mesa_format_convert(dest, dstFormat, dstStride,
-                           tempSlice, RGBA32_FLOAT, srcStride,
-                           width, height,
-                           needsRebase ? rebaseSwizzle : NULL);
+      ctx->Driver.UnmapTextureImage(ctx, texImage, zoffset + slice);
 
       /* Handle byte swapping if required */
       if (ctx->Pack.SwapBytes) {
          _mesa_swap_bytes_2d_image(format, type, &ctx->Pack,
                                    width, height, dest, dest);
       }
-
-      tempSlice += 4 * width * height;
    }
-
-   free(tempImage);
 }
 
 
@@ -437,7 +524,6 @@ get_tex_rgba_uncompressed(struct gl_context *ctx, GLuint dimensions,
    int dst_stride;
    uint8_t rebaseSwizzle[4];
    bool needsRebase;
-   void *rgba = NULL;
 
    needsRebase = teximage_needs_rebase(texFormat, texImage->_BaseFormat, false,
                                        rebaseSwizzle);
@@ -458,11 +544,7 @@ get_tex_rgba_uncompressed(struct gl_context *ctx, GLuint dimensions,
    for (img = 0; img < depth; img++) {
       GLubyte *srcMap;
       GLint rowstride;
-      GLubyte *img_src;
       void *dest;
-      void *src;
-      int src_stride;
-      uint32_t src_format;
 
       /* map src texture buffer */
       ctx->Driver.MapTextureImage(ctx, texImage, zoffset + img,
@@ -471,77 +553,44 @@ get_tex_rgba_uncompressed(struct gl_context *ctx, GLuint dimensions,
                                   &srcMap, &rowstride);
       if (!srcMap) {
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage");
-         goto done;
+         return;
       }
 
-      img_src = srcMap;
       dest = _mesa_image_address(dimensions, &ctx->Pack, pixels,
                                  width, height, format, type,
                                  img, 0, 0);
 
       if (transferOps) {
-         uint32_t rgba_format;
-         int rgba_stride;
-         bool need_convert = false;
-
-         /* We will convert to RGBA float */
-         rgba_format = RGBA32_FLOAT;
-         rgba_stride = width * 4 * sizeof(GLfloat);
-
-         /* If we are lucky and the dst format matches the RGBA format we need
-          * to convert to, then we can convert directly into the dst buffer
-          * and avoid the final conversion/copy from the rgba buffer to the dst
-          * buffer.
+         /* Convert to RGBA float, handle the transfer ops and convert to
+          * dst a chunk of rows at a time.  The rebase, if any, is done on
+          * the way to float.
           */
-         if (format == rgba_format) {
-            rgba = dest;
-         } else {
-            need_convert = true;
-            if (rgba == NULL) { /* Allocate the RGBA buffer only once */
-               rgba = malloc(height * rgba_stride);
-               if (!rgba) {
-                  _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage()");
-                  ctx->Driver.UnmapTextureImage(ctx, texImage, img);
-                  return;
-               }
-            }
+         struct readback_job job = {
+            .ctx = ctx,
+            .src = srcMap,
+            .src_format = texFormat,
+            .src_stride = rowstride,
+            .dst = dest,
+            .dst_format = dst_format,
+            .dst_stride = dst_stride,
+            .width = width,
+            .transferOps = transferOps,
+            .src_swizzle = needsRebase ? rebaseSwizzle : NULL,
+         };
+
+         if (!readback_image(&job, height)) {
+            _mesa_error(ctx, GL_OUT_OF_MEMORY, "glGetTexImage()");
+            ctx->Driver.UnmapTextureImage(ctx, texImage, zoffset + img);
+            return;
          }
-
-         _mesa_format_convert(rgba, rgba_format, rgba_stride,
-                              img_src, texFormat, rowstride,
-                              width, height,
-                              needsRebase ? rebaseSwizzle : NULL);
-
-         /* Handle transfer ops now */
-         _mesa_apply_rgba_transfer_ops(ctx, transferOps, width * height, rgba);
-
-         /* If we had to rebase, we have already handled that */
-         needsRebase = false;
-
-         /* If we were lucky and our RGBA conversion matches the dst format,
-          * then we are done.
-          */
-         if (!need_convert)
-            goto do_swap;
-
-         /* Otherwise, we need to convert from RGBA to dst next */
-         src = rgba;
-         src_format = rgba_format;
-         src_stride = rgba_stride;
       } else {
          /* No RGBA conversion needed, convert directly to dst */
-         src = img_src;
-         src_format = texFormat;
-         src_stride = rowstride;
+         _mesa_format_convert(dest, dst_format, dst_stride,
+                              srcMap, texFormat, rowstride,
+                              width, height,
+                              needsRebase ? rebaseSwizzle : NULL);
       }
 
-      /* Do the conversion to destination format */
-      _mesa_format_convert(dest, dst_format, dst_stride,
-                           src, src_format, src_stride,
-                           width, height,
-                           needsRebase ? rebaseSwizzle : NULL);
-
-   do_swap:
       /* Handle byte swapping if required */
       if (ctx->Pack.SwapBytes)
          _mesa_swap_bytes_2d_image(format, type, &ctx->Pack,
@@ -550,9 +599,6 @@ get_tex_rgba_uncompressed(struct gl_context *ctx, GLuint dimensions,
       /* Unmap the src texture buffer */
       ctx->Driver.UnmapTextureImage(ctx, texImage, zoffset + img);
    }
-
-done:
-   free(rgba);
 }
 
 
@@ -653,17 +699,8 @@ get_tex_memcpy(struct gl_context *ctx,
                                   GL_MAP_READ_BIT, &src, &srcRowStride);
 
       if (src) {
-         if (bytesPerRow == dstRowStride && bytesPerRow == srcRowStride) {
-            memcpy(dst, src, bytesPerRow * height);
-         }
-         else {
-            GLuint row;
-            for (row = 0; row < height; row++) {
-               memcpy(dst, src, bytesPerRow);
-               dst += dstRowStride;
-               src += srcRowStride;
-            }
-         }
+         _mesa_copy_mapped_rows(dst, dstRowStride, src, srcRowStride,
+                                bytesPerRow, height);
 
          /* unmap src texture buffer */
          ctx->Driver.UnmapTextureImage(ctx, texImage, zoffset);
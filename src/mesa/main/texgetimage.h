@@ -29,6 +29,10 @@
 
 #include "glheader.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
 struct gl_texture_image;
 struct gl_texture_object;
@@ -88,4 +92,8 @@ _mesa_GetCompressedTextureSubImage(GLuint texture, GLint level,
                                    GLsizei height, GLsizei depth,
                                    GLsizei bufSize, void *pixels);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* TEXGETIMAGE_H */
@@ -528,17 +528,8 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
                                          width, height, format,
                                          type, 0, 0);
 
-      if (tex_xfer->stride == bytesPerRow && destStride == bytesPerRow) {
-         memcpy(dest, map, bytesPerRow * height);
-      } else {
-         GLuint row;
-
-         for (row = 0; row < (unsigned) height; row++) {
-            memcpy(dest, map, bytesPerRow);
-            map += tex_xfer->stride;
-            dest += destStride;
-         }
-      }
+      _mesa_copy_mapped_rows(dest, destStride, map, tex_xfer->stride,
+                             bytesPerRow, height);
    }
 
    pipe_transfer_unmap(pipe, tex_xfer);
@@ -74,6 +74,7 @@
 #include "util/u_sampler.h"
 #include "util/u_math.h"
 #include "util/u_box.h"
+#include "util/u_parallel.h"
 #include "util/u_simple_shaders.h"
 #include "cso_cache/cso_context.h"
 #include "tgsi/tgsi_ureg.h"
@@ -265,6 +266,7 @@ st_MapTextureImage(struct gl_context *ctx,
 {
    struct st_context *st = st_context(ctx);
    struct st_texture_image *stImage = st_texture_image(texImage);
+   struct pipe_resource *pt = stImage->pt;
    GLubyte *map;
    struct pipe_transfer *transfer;
 
@@ -273,8 +275,15 @@ st_MapTextureImage(struct gl_context *ctx,
                     GL_MAP_WRITE_BIT |
                     GL_MAP_INVALIDATE_RANGE_BIT)) == 0);
 
+   /* Replacing the only image of a resource lets the driver throw away the
+    * old contents rather than wait for pending rendering to read them.
+    */
+   const bool whole_resource =
+      pt && pt->last_level == 0 &&
+      util_texrange_covers_whole_level(pt, 0, x, y, slice, w, h, 1);
+
    const enum pipe_transfer_usage transfer_flags =
-      st_access_flags_to_transfer_flags(mode, false);
+      st_access_flags_to_transfer_flags(mode, whole_resource);
 
    map = st_texture_image_map(st, stImage, transfer_flags, x, y, slice, w, h, 1,
                               &transfer);
@@ -1431,20 +1440,30 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    if (!dst)
       goto fallback;
 
-   /* Try texture_subdata, which should be the fastest memcpy path. */
-   if (pixels &&
-       !_mesa_is_bufferobj(unpack->BufferObj) &&
+   /* Try texture_subdata, which should be the fastest memcpy path.  Unless
+    * the driver would rather blit from it, a PBO is mapped and copied from
+    * directly too.
+    */
+   if ((_mesa_is_bufferobj(unpack->BufferObj) ?
+        !st->prefer_blit_based_texture_transfer : pixels != NULL) &&
        _mesa_texstore_can_use_memcpy(ctx, texImage->_BaseFormat,
                                      texImage->TexFormat, format, type,
                                      unpack)) {
       struct pipe_box box;
       unsigned stride, layer_stride;
+      const void *src;
       void *data;
 
+      src = _mesa_validate_pbo_teximage(ctx, dims, width, height, depth,
+                                        format, type, pixels, unpack,
+                                        "glTexSubImage");
+      if (!src)
+         return;
+
       stride = _mesa_image_row_stride(unpack, width, format, type);
       layer_stride = _mesa_image_image_stride(unpack, width, height, format,
                                               type);
-      data = _mesa_image_address(dims, unpack, pixels, width, height, format,
+      data = _mesa_image_address(dims, unpack, src, width, height, format,
                                  type, 0, 0, 0);
 
       /* Convert to Gallium coordinates. */
@@ -1459,6 +1478,7 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
       u_box_3d(xoffset, yoffset, zoffset + dstz, width, height, depth, &box);
       pipe->texture_subdata(pipe, dst, dst_level, 0,
                             &box, data, stride, layer_stride);
+      _mesa_unmap_teximage_pbo(ctx, unpack);
       return;
    }
 
@@ -1847,6 +1867,24 @@ st_CompressedTexImage(struct gl_context *ctx, GLuint dims,
 
 
 
+struct get_tile_rgba_job {
+   struct pipe_transfer *xfer;
+   const void *map;
+   enum pipe_format format;
+   unsigned width;
+   GLfloat *rgba;
+};
+
+static void
+get_tile_rgba_rows(void *data, unsigned y1, unsigned y2)
+{
+   const struct get_tile_rgba_job *job = data;
+
+   pipe_get_tile_rgba_format(job->xfer, job->map, 0, y1, job->width, y2 - y1,
+                             job->format, job->rgba + y1 * job->width * 4);
+}
+
+
 /**
  * Called via ctx->Driver.GetTexSubImage()
  *
@@ -1893,9 +1931,12 @@ st_GetTexSubImage(struct gl_context * ctx,
 
    st_flush_bitmap_cache(st);
 
+   /* Try to avoid the fallback if we're doing texture decompression here,
+    * unless the driver would decompress on the CPU anyway.
+    */
    if (!st->prefer_blit_based_texture_transfer &&
-       !_mesa_is_format_compressed(texImage->TexFormat)) {
-      /* Try to avoid the fallback if we're doing texture decompression here */
+       (st->prefer_cpu_texture_transfer ||
+        !_mesa_is_format_compressed(texImage->TexFormat))) {
       goto fallback;
    }
 
@@ -2118,20 +2159,17 @@ st_GetTexSubImage(struct gl_context * ctx,
                                             ctx->Pack.SwapBytes, NULL)) {
       /* memcpy */
       const uint bytesPerRow = width * util_format_get_blocksize(dst_format);
-      GLuint row, slice;
+      const GLint dstStride =
+         _mesa_image_row_stride(&ctx->Pack, width, format, type);
+      GLuint slice;
 
       for (slice = 0; slice < depth; slice++) {
-         ubyte *slice_map = map;
-
-         for (row = 0; row < height; row++) {
-            void *dest = _mesa_image_address(dims, &ctx->Pack, pixels,
-                                             width, height, format, type,
-                                             slice, row, 0);
-
-            memcpy(dest, slice_map, bytesPerRow);
+         void *dest = _mesa_image_address(dims, &ctx->Pack, pixels,
+                                          width, height, format, type,
+                                          slice, 0, 0);
 
-            slice_map += tex_xfer->stride;
-         }
+         _mesa_copy_mapped_rows(dest, dstStride, map, tex_xfer->stride,
+                                bytesPerRow, height);
 
          map += tex_xfer->layer_stride;
       }
@@ -2161,9 +2199,13 @@ st_GetTexSubImage(struct gl_context * ctx,
                                           width, height, format, type,
                                           slice, 0, 0);
 
-         /* get float[4] rgba row from surface */
-         pipe_get_tile_rgba_format(tex_xfer, map, 0, 0, width, height,
-                                   dst_format, rgba);
+         /* get float[4] rgba rows from surface */
+         struct get_tile_rgba_job job = {
+            tex_xfer, map, dst_format, width, rgba
+         };
+         util_parallel_rows(util_parallel_queue(), height,
+                            util_format_get_blockheight(dst_format),
+                            srcStride, get_tile_rgba_rows, &job);
 
          _mesa_format_convert(dest, dstMesaFormat, dstStride,
                               rgba, RGBA32_FLOAT, srcStride,
@@ -122,6 +122,7 @@ struct st_context
    boolean has_etc2;
    boolean has_astc_2d_ldr;
    boolean prefer_blit_based_texture_transfer;
+   boolean prefer_cpu_texture_transfer;
    boolean force_persample_in_shader;
    boolean has_shareable_shaders;
    boolean has_half_float_packing;
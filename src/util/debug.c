@@ -21,6 +21,7 @@
  * IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "main/macros.h"
 #include "debug.h"
@@ -76,3 +77,23 @@ env_var_as_boolean(const char *var_name, bool default_value)
       return default_value;
    }
 }
+
+/**
+ * Reads an environment variable and interprets its value as an unsigned
+ * integer. If the variable is not set or is not a valid number, the default
+ * value is returned.
+ */
+unsigned
+env_var_as_unsigned(const char *var_name, unsigned default_value)
+{
+   const char *str = getenv(var_name);
+   if (str == NULL)
+      return default_value;
+
+   char *end;
+   unsigned long value = strtoul(str, &end, 0);
+   if (end == str || *end != '\0')
+      return default_value;
+
+   return value;
+}
@@ -45,7 +45,9 @@
 #include "util/u_atomic.h"
 #include "util/u_queue.h"
 #include "util/mesa-sha1.h"
+#include "util/os_time.h"
 #include "util/ralloc.h"
+#include "util/simple_mtx.h"
 #include "main/compiler.h"
 #include "main/errors.h"
 
@@ -98,6 +100,22 @@ struct disk_cache {
    /* Maximum size of all cached objects (in bytes). */
    uint64_t max_size;
 
+   /* Maximum size of the data copies waiting in cache_queue (in bytes).
+    * Puts that would exceed this are dropped rather than queued.  Normal and
+    * low priority puts only get a part of it, see pending_limit().
+    */
+   uint64_t max_pending_size;
+
+   /* zlib compression level used when writing entries. */
+   int compression_level;
+
+   /* Counters reported by disk_cache_get_stats().  They are protected by a
+    * lock rather than updated atomically, as 64-bit atomics aren't available
+    * on all 32-bit targets.
+    */
+   simple_mtx_t stats_lock;
+   struct disk_cache_stats stats;
+
    /* Driver cache keys. */
    uint8_t *driver_keys_blob;
    size_t driver_keys_blob_size;
@@ -119,6 +137,9 @@ struct disk_cache_put_job {
    /* Size of data to be compressed and written. */
    size_t size;
 
+   /* Bytes accounted in cache->stats.pending_bytes for this job. */
+   size_t pending_size;
+
    struct cache_item_metadata cache_item_metadata;
 };
 
@@ -182,6 +203,38 @@ concatenate_and_mkdir(void *ctx, const char *path, const char *name)
       return NULL;
 }
 
+/* Parse a size given as a number optionally followed by 'K', 'M', or 'G'.
+ * Gigabytes are assumed if no unit is given. Returns 0 on parse failure.
+ */
+static uint64_t
+parse_size(const char *str)
+{
+   char *end;
+   uint64_t size = strtoul(str, &end, 10);
+
+   if (end == str)
+      return 0;
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      size *= 1024;
+      break;
+   case 'M':
+   case 'm':
+      size *= 1024*1024;
+      break;
+   case '\0':
+   case 'G':
+   case 'g':
+   default:
+      size *= 1024*1024*1024;
+      break;
+   }
+
+   return size;
+}
+
 #define DRV_KEY_CPY(_dst, _src, _src_size) \
 do {                                       \
    memcpy(_dst, _src, _src_size);          \
@@ -220,6 +273,8 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
    if (cache == NULL)
       goto fail;
 
+   simple_mtx_init(&cache->stats_lock, mtx_plain);
+
    /* Assume failure. */
    cache->path_init_failed = true;
 
@@ -338,30 +393,8 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
    max_size = 0;
 
    max_size_str = getenv("MESA_GLSL_CACHE_MAX_SIZE");
-   if (max_size_str) {
-      char *end;
-      max_size = strtoul(max_size_str, &end, 10);
-      if (end == max_size_str) {
-         max_size = 0;
-      } else {
-         switch (*end) {
-         case 'K':
-         case 'k':
-            max_size *= 1024;
-            break;
-         case 'M':
-         case 'm':
-            max_size *= 1024*1024;
-            break;
-         case '\0':
-         case 'G':
-         case 'g':
-         default:
-            max_size *= 1024*1024*1024;
-            break;
-         }
-      }
-   }
+   if (max_size_str)
+      max_size = parse_size(max_size_str);
 
    /* Default to 1GB for maximum cache size. */
    if (max_size == 0) {
@@ -370,6 +403,26 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
 
    cache->max_size = max_size;
 
+   /* Default to 64MB of data waiting to be written. Beyond that, a burst of
+    * puts at load time would only grow memory usage while the single cache
+    * thread falls further behind, so further puts are dropped instead.
+    */
+   max_size = 0;
+   max_size_str = getenv("MESA_GLSL_CACHE_MAX_PENDING_SIZE");
+   if (max_size_str)
+      max_size = parse_size(max_size_str);
+
+   if (max_size == 0)
+      max_size = 64*1024*1024;
+
+   cache->max_pending_size = max_size;
+
+   cache->compression_level =
+      env_var_as_unsigned("MESA_GLSL_CACHE_COMPRESSION_LEVEL",
+                          Z_BEST_COMPRESSION);
+   if (cache->compression_level > Z_BEST_COMPRESSION)
+      cache->compression_level = Z_BEST_COMPRESSION;
+
    /* 1 thread was chosen because we don't really care about getting things
     * to disk quickly just that it's not blocking other tasks.
     *
@@ -424,8 +477,10 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
  fail:
    if (fd != -1)
       close(fd);
-   if (cache)
+   if (cache) {
+      simple_mtx_destroy(&cache->stats_lock);
       ralloc_free(cache);
+   }
    ralloc_free(local);
 
    return NULL;
@@ -439,6 +494,8 @@ disk_cache_destroy(struct disk_cache *cache)
       munmap(cache->index_mmap, cache->index_mmap_size);
    }
 
+   if (cache)
+      simple_mtx_destroy(&cache->stats_lock);
    ralloc_free(cache);
 }
 
@@ -730,7 +787,7 @@ write_all(int fd, const void *buf, size_t count)
  */
 static size_t
 deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
+                          const char *filename, int level)
 {
    unsigned char out[BUFSIZE];
 
@@ -742,7 +799,7 @@ deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
    strm.next_in = (uint8_t *) in_data;
    strm.avail_in = in_data_size;
 
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
+   int ret = deflateInit(&strm, level);
    if (ret != Z_OK)
        return 0;
 
@@ -837,6 +894,13 @@ destroy_put_job(void *job, int thread_index)
 {
    if (job) {
       struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
+      struct disk_cache *cache = dc_job->cache;
+
+      simple_mtx_lock(&cache->stats_lock);
+      cache->stats.pending_bytes -= dc_job->pending_size;
+      cache->stats.queue_depth--;
+      simple_mtx_unlock(&cache->stats_lock);
+
       free(dc_job->cache_item_metadata.keys);
 
       free(job);
@@ -848,15 +912,88 @@ struct cache_entry_file_data {
    uint32_t uncompressed_size;
 };
 
+/* How much data may be pending when a put of the given priority is queued.
+ * Low priority puts can only use half of the limit and normal ones three
+ * quarters of it, so that a burst of them doesn't get the more important
+ * entries dropped.
+ */
+static uint64_t
+pending_limit(struct disk_cache *cache, enum disk_cache_priority priority)
+{
+   switch (priority) {
+   case DISK_CACHE_PRIORITY_HIGH:
+      return cache->max_pending_size;
+   case DISK_CACHE_PRIORITY_NORMAL:
+      return cache->max_pending_size / 4 * 3;
+   case DISK_CACHE_PRIORITY_LOW:
+   default:
+      return cache->max_pending_size / 2;
+   }
+}
+
+/* Account a put of size bytes as pending, unless that would exceed the limit
+ * of its priority.
+ */
+static bool
+reserve_pending_size(struct disk_cache *cache, size_t size,
+                     enum disk_cache_priority priority)
+{
+   struct disk_cache_stats *stats = &cache->stats;
+   bool reserved = false;
+
+   simple_mtx_lock(&cache->stats_lock);
+   if (stats->pending_bytes + size <= pending_limit(cache, priority)) {
+      stats->pending_bytes += size;
+      stats->max_pending_bytes = MAX2(stats->max_pending_bytes,
+                                      stats->pending_bytes);
+      stats->queue_depth++;
+      stats->max_queue_depth = MAX2(stats->max_queue_depth,
+                                    stats->queue_depth);
+      stats->puts_queued++;
+      reserved = true;
+   } else {
+      stats->puts_dropped++;
+   }
+   simple_mtx_unlock(&cache->stats_lock);
+
+   return reserved;
+}
+
+static bool
+write_cache_entry(struct disk_cache_put_job *dc_job);
+
 static void
 cache_put(void *job, int thread_index)
 {
    assert(job);
 
+   struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
+   struct disk_cache *cache = dc_job->cache;
+   int64_t start = os_time_get_nano();
+
+   bool written = write_cache_entry(dc_job);
+
+   uint64_t time = os_time_get_nano() - start;
+
+   simple_mtx_lock(&cache->stats_lock);
+   cache->stats.write_time_ns += time;
+   cache->stats.max_write_time_ns = MAX2(cache->stats.max_write_time_ns,
+                                         time);
+   if (written)
+      cache->stats.entries_written++;
+   simple_mtx_unlock(&cache->stats_lock);
+}
+
+/* Write a single entry to its file. Returns true if a new file was added
+ * to the cache.
+ */
+static bool
+write_cache_entry(struct disk_cache_put_job *dc_job)
+{
    int fd = -1, fd_final = -1, err, ret;
    unsigned i = 0;
    char *filename = NULL, *filename_tmp = NULL;
-   struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
+   bool written = false;
 
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
@@ -974,7 +1111,8 @@ cache_put(void *job, int thread_index)
     * perform an atomic increment of the total cache size.
     */
    size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
+                                                fd, filename_tmp,
+                                                dc_job->cache->compression_level);
    if (file_size == 0) {
       unlink(filename_tmp);
       goto done;
@@ -993,6 +1131,7 @@ cache_put(void *job, int thread_index)
    }
 
    p_atomic_add(dc_job->cache->size, sb.st_blocks * 512);
+   written = true;
 
  done:
    if (fd_final != -1)
@@ -1004,6 +1143,8 @@ cache_put(void *job, int thread_index)
       close(fd);
    free(filename_tmp);
    free(filename);
+
+   return written;
 }
 
 void
@@ -1011,6 +1152,24 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
                struct cache_item_metadata *cache_item_metadata)
 {
+   disk_cache_put_with_priority(cache, key, data, size, cache_item_metadata,
+                                DISK_CACHE_PRIORITY_NORMAL);
+}
+
+void
+disk_cache_put_with_priority(struct disk_cache *cache, const cache_key key,
+                             const void *data, size_t size,
+                             struct cache_item_metadata *cache_item_metadata,
+                             enum disk_cache_priority priority)
+{
+   static const enum util_queue_priority queue_priorities[] = {
+      [DISK_CACHE_PRIORITY_HIGH] = UTIL_QUEUE_PRIORITY_HIGH,
+      [DISK_CACHE_PRIORITY_NORMAL] = UTIL_QUEUE_PRIORITY_NORMAL,
+      [DISK_CACHE_PRIORITY_LOW] = UTIL_QUEUE_PRIORITY_LOW,
+   };
+
+   assert(priority < ARRAY_SIZE(queue_priorities));
+
    if (cache->blob_put_cb) {
       cache->blob_put_cb(key, CACHE_KEY_SIZE, data, size);
       return;
@@ -1019,13 +1178,31 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    if (cache->path_init_failed)
       return;
 
+   /* Dropping a put only costs a future cache miss, while queueing it would
+    * keep a copy of the data alive until the cache thread catches up.
+    */
+   size_t pending_size = sizeof(struct disk_cache_put_job) + size;
+   if (!reserve_pending_size(cache, pending_size, priority))
+      return;
+
    struct disk_cache_put_job *dc_job =
       create_put_job(cache, key, data, size, cache_item_metadata);
 
    if (dc_job) {
+      dc_job->pending_size = pending_size;
+
+      /* Higher priority entries are also written first. */
       util_queue_fence_init(&dc_job->fence);
-      util_queue_add_job(&cache->cache_queue, dc_job, &dc_job->fence,
-                         cache_put, destroy_put_job);
+      util_queue_add_job_with_priority(&cache->cache_queue, dc_job,
+                                       &dc_job->fence, cache_put,
+                                       destroy_put_job,
+                                       queue_priorities[priority]);
+   } else {
+      simple_mtx_lock(&cache->stats_lock);
+      cache->stats.pending_bytes -= pending_size;
+      cache->stats.queue_depth--;
+      cache->stats.puts_queued--;
+      simple_mtx_unlock(&cache->stats_lock);
    }
 }
 
@@ -1279,4 +1456,19 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    cache->blob_get_cb = get;
 }
 
+void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   if (!cache->path_init_failed)
+      util_queue_finish(&cache->cache_queue);
+}
+
+void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats)
+{
+   simple_mtx_lock(&cache->stats_lock);
+   *stats = cache->stats;
+   simple_mtx_unlock(&cache->stats_lock);
+}
+
 #endif /* ENABLE_SHADER_CACHE */
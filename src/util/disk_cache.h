@@ -30,6 +30,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #ifdef __cplusplus
@@ -73,6 +74,40 @@ struct cache_item_metadata {
 
 struct disk_cache;
 
+/* How important it is to get an entry written, see
+ * disk_cache_put_with_priority().
+ */
+enum disk_cache_priority {
+   DISK_CACHE_PRIORITY_HIGH,
+   DISK_CACHE_PRIORITY_NORMAL,
+   DISK_CACHE_PRIORITY_LOW,
+};
+
+/* Counters describing the background writes of a cache object. */
+struct disk_cache_stats {
+   /** Number of disk_cache_put() calls queued for writing. */
+   uint64_t puts_queued;
+   /** Number of disk_cache_put() calls dropped because too much data was
+    * already waiting to be written (see MESA_GLSL_CACHE_MAX_PENDING_SIZE and
+    * disk_cache_put_with_priority()).
+    */
+   uint64_t puts_dropped;
+   /** Number of entries written to disk. */
+   uint64_t entries_written;
+
+   /** Number of puts currently waiting or being written, and its maximum. */
+   uint64_t queue_depth;
+   uint64_t max_queue_depth;
+
+   /** Bytes currently waiting or being written, and its maximum. */
+   uint64_t pending_bytes;
+   uint64_t max_pending_bytes;
+
+   /** Time spent compressing and writing entries on the cache thread. */
+   uint64_t write_time_ns;
+   uint64_t max_write_time_ns;
+};
+
 static inline char *
 disk_cache_format_hex_id(char *buf, const uint8_t *hex_id, unsigned size)
 {
@@ -165,6 +200,21 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
                struct cache_item_metadata *cache_item_metadata);
 
+/**
+ * Like disk_cache_put(), which uses DISK_CACHE_PRIORITY_NORMAL, for items
+ * which are more or less worth keeping.
+ *
+ * Higher priority items are written first. While the data waiting to be
+ * written exceeds half of MESA_GLSL_CACHE_MAX_PENDING_SIZE, low priority
+ * items are dropped, and normal ones past three quarters of it, leaving the
+ * rest to high priority items.
+ */
+void
+disk_cache_put_with_priority(struct disk_cache *cache, const cache_key key,
+                             const void *data, size_t size,
+                             struct cache_item_metadata *cache_item_metadata,
+                             enum disk_cache_priority priority);
+
 /**
  * Retrieve an item previously stored in the cache with the name <key>.
  *
@@ -217,6 +267,19 @@ void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get);
 
+/**
+ * Wait until all previously queued disk_cache_put() calls have been
+ * processed.
+ */
+void
+disk_cache_wait_for_idle(struct disk_cache *cache);
+
+/**
+ * Return a snapshot of the counters of \cache.
+ */
+void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats);
+
 #else
 
 static inline struct disk_cache *
@@ -239,6 +302,15 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    return;
 }
 
+static inline void
+disk_cache_put_with_priority(struct disk_cache *cache, const cache_key key,
+                             const void *data, size_t size,
+                             struct cache_item_metadata *cache_item_metadata,
+                             enum disk_cache_priority priority)
+{
+   return;
+}
+
 static inline void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
@@ -277,6 +349,18 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    return;
 }
 
+static inline void
+disk_cache_wait_for_idle(struct disk_cache *cache)
+{
+   return;
+}
+
+static inline void
+disk_cache_get_stats(struct disk_cache *cache, struct disk_cache_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
 #ifdef __cplusplus
@@ -27,7 +27,6 @@
 #include <math.h>
 #include <assert.h>
 #include "half_float.h"
-#include "rounding.h"
 #include "macros.h"
 
 typedef union { float f; int32_t i; uint32_t u; } fi_type;
@@ -54,75 +53,37 @@ uint16_t
 _mesa_float_to_half(float val)
 {
    const fi_type fi = {val};
-   const int flt_m = fi.i & 0x7fffff;
-   const int flt_e = (fi.i >> 23) & 0xff;
-   const int flt_s = (fi.i >> 31) & 0x1;
-   int s, e, m = 0;
-   uint16_t result;
+   const uint16_t s = (fi.u >> 16) & 0x8000;
+   uint32_t abs = fi.u & 0x7fffffff;
 
-   /* sign bit */
-   s = flt_s;
-
-   /* handle special cases */
-   if ((flt_e == 0) && (flt_m == 0)) {
-      /* zero */
-      /* m = 0; - already set */
-      e = 0;
-   }
-   else if ((flt_e == 0) && (flt_m != 0)) {
-      /* denorm -- denorm float maps to 0 half */
-      /* m = 0; - already set */
-      e = 0;
-   }
-   else if ((flt_e == 0xff) && (flt_m == 0)) {
-      /* infinity */
-      /* m = 0; - already set */
-      e = 31;
-   }
-   else if ((flt_e == 0xff) && (flt_m != 0)) {
-      /* NaN */
-      m = 1;
-      e = 31;
-   }
-   else {
-      /* regular number */
-      const int new_exp = flt_e - 127;
-      if (new_exp < -14) {
-         /* The float32 lies in the range (0.0, min_normal16) and is rounded
-          * to a nearby float16 value. The result will be either zero, subnormal,
-          * or normal.
-          */
-         e = 0;
-         m = _mesa_lroundevenf((1 << 24) * fabsf(fi.f));
-      }
-      else if (new_exp > 15) {
-         /* map this value to infinity */
-         /* m = 0; - already set */
-         e = 31;
-      }
-      else {
-         /* The float32 lies in the range
-          *   [min_normal16, max_normal16 + max_step16)
-          * and is rounded to a nearby float16 value. The result will be
-          * either normal or infinite.
-          */
-         e = new_exp + 15;
-         m = _mesa_lroundevenf(flt_m / (float) (1 << 13));
-      }
-   }
-
-   assert(0 <= m && m <= 1024);
-   if (m == 1024) {
-      /* The float32 was rounded upwards into the range of the next exponent,
-       * so bump the exponent. This correctly handles the case where f32
-       * should be rounded up to float16 infinity.
+   /* This is on the path of every texture upload to a half float format, so
+    * the rounding is done with integer and float adds rather than by
+    * splitting the value in its fields.
+    */
+   if (abs >= 0x47800000) {
+      /* Infinity, NaN or a value that doesn't fit in a float16 even after
+       * rounding, which maps to infinity.
+       */
+      return s | (abs > 0x7f800000 ? 0x7c01 : 0x7c00);
+   } else if (abs < 0x38800000) {
+      /* The float32 lies in the range [0.0, min_normal16) and is rounded to
+       * a nearby float16 value. The result will be either zero, subnormal,
+       * or normal. Adding 0.5 aligns the float16 subnormal mantissa with the
+       * low bits of the float32 one, and the FPU rounds it to nearest even.
+       */
+      fi_type f = { .u = abs };
+      f.f += 0.5f;
+      return s | (f.u - 0x3f000000);
+   } else {
+      /* The float32 lies in the range [min_normal16, max_normal16 +
+       * max_step16) and is rounded to a nearby float16 value. Rebias the
+       * exponent and round the mantissa to nearest even; a carry out of the
+       * mantissa correctly bumps the exponent, up to infinity.
        */
-      ++e;
-      m = 0;
+      abs -= (127 - 15) << 23;
+      abs += 0xfff + ((abs >> 13) & 1);
+      return s | (abs >> 13);
    }
-
-   result = (s << 15) | (e << 10) | m;
-   return result;
 }
 
 
@@ -137,6 +137,9 @@ struct ra_node {
    /* Register, if assigned, or NO_REG. */
    unsigned int reg;
 
+   /* Register forced with ra_set_node_reg(), or NO_REG. */
+   unsigned int forced_reg;
+
    /**
     * Set when the node is in the trivially colorable stack.  When
     * set, the adjacency to this node is ignored, to implement the
@@ -147,14 +150,28 @@ struct ra_node {
 
    /**
     * The q total, as defined in the Runeson/Nyström paper, for all the
-    * interfering nodes not in the stack.
+    * interfering nodes.
     */
    unsigned int q_total;
 
+   /**
+    * The q total for all the interfering nodes not in the stack.  Only
+    * meaningful during ra_simplify(), which starts it from q_total and
+    * decrements it as nodes are pushed, leaving q_total untouched so that
+    * the graph can be edited and allocated again.
+    */
+   unsigned int q_remaining;
+
    /* For an implementation that needs register spilling, this is the
     * approximate cost of spilling this node.
     */
    float spill_cost;
+
+   /**
+    * The benefit of spilling this node, as defined in
+    * ra_get_best_spill_node(), accumulated as interferences are added.
+    */
+   float spill_benefit;
 };
 
 struct ra_graph {
@@ -400,10 +417,14 @@ ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
    int n1_class = g->nodes[n1].class;
    int n2_class = g->nodes[n2].class;
    g->nodes[n1].q_total += g->regs->classes[n1_class]->q[n2_class];
+   g->nodes[n1].spill_benefit +=
+      ((float)g->regs->classes[n1_class]->q[n2_class] /
+       g->regs->classes[n1_class]->p);
 
    if (g->nodes[n1].adjacency_count >=
        g->nodes[n1].adjacency_list_size) {
-      g->nodes[n1].adjacency_list_size *= 2;
+      g->nodes[n1].adjacency_list_size =
+         MAX2(4, g->nodes[n1].adjacency_list_size * 2);
       g->nodes[n1].adjacency_list = reralloc(g, g->nodes[n1].adjacency_list,
                                              unsigned int,
                                              g->nodes[n1].adjacency_list_size);
@@ -417,6 +438,8 @@ struct ra_graph *
 ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 {
    struct ra_graph *g;
+   BITSET_WORD *adjacency;
+   unsigned int bitset_count = BITSET_WORDS(count);
    unsigned int i;
 
    g = rzalloc(NULL, struct ra_graph);
@@ -426,17 +449,23 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 
    g->stack = rzalloc_array(g, unsigned int, count);
 
+   /* The adjacency bitsets come out of a single allocation, and the
+    * adjacency lists are allocated on the first interference, since large
+    * graphs have many nodes and making thousands of small allocations
+    * shows up in profiles.
+    */
+   adjacency = rzalloc_array(g, BITSET_WORD, (size_t)count * bitset_count);
+
    for (i = 0; i < count; i++) {
-      int bitset_count = BITSET_WORDS(count);
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
+      g->nodes[i].adjacency = adjacency + (size_t)i * bitset_count;
 
-      g->nodes[i].adjacency_list_size = 4;
-      g->nodes[i].adjacency_list =
-         ralloc_array(g, unsigned int, g->nodes[i].adjacency_list_size);
+      g->nodes[i].adjacency_list_size = 0;
+      g->nodes[i].adjacency_list = NULL;
       g->nodes[i].adjacency_count = 0;
       g->nodes[i].q_total = 0;
 
       g->nodes[i].reg = NO_REG;
+      g->nodes[i].forced_reg = NO_REG;
    }
 
    return g;
@@ -469,16 +498,68 @@ ra_add_node_interference(struct ra_graph *g,
    }
 }
 
+static void
+ra_remove_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
+{
+   struct ra_node *node = &g->nodes[n1];
+   int n1_class = node->class;
+   int n2_class = g->nodes[n2].class;
+   unsigned int i;
+
+   BITSET_CLEAR(node->adjacency, n2);
+
+   assert(node->q_total >= g->regs->classes[n1_class]->q[n2_class]);
+   node->q_total -= g->regs->classes[n1_class]->q[n2_class];
+   node->spill_benefit -= ((float)g->regs->classes[n1_class]->q[n2_class] /
+                           g->regs->classes[n1_class]->p);
+
+   for (i = 0; i < node->adjacency_count; i++) {
+      if (node->adjacency_list[i] == n2) {
+         node->adjacency_list[i] = node->adjacency_list[--node->adjacency_count];
+         break;
+      }
+   }
+}
+
+/**
+ * Removes all the interferences of a node.
+ *
+ * When a failed allocation is followed by spilling, the live ranges of
+ * most nodes are unchanged.  Rather than building a new graph, the caller
+ * can reset the interferences of the nodes whose live ranges changed, add
+ * their new ones and call ra_allocate() again.
+ */
+void
+ra_reset_node_interference(struct ra_graph *g, unsigned int n)
+{
+   unsigned int i;
+
+   for (i = 0; i < g->nodes[n].adjacency_count; i++)
+      ra_remove_node_adjacency(g, g->nodes[n].adjacency_list[i], n);
+
+   memset(g->nodes[n].adjacency, 0,
+          BITSET_WORDS(g->count) * sizeof(BITSET_WORD));
+   g->nodes[n].adjacency_count = 0;
+   g->nodes[n].q_total = 0;
+   g->nodes[n].spill_benefit = 0.0f;
+}
+
 static bool
 pq_test(struct ra_graph *g, unsigned int n)
 {
    int n_class = g->nodes[n].class;
 
-   return g->nodes[n].q_total < g->regs->classes[n_class]->p;
+   return g->nodes[n].q_remaining < g->regs->classes[n_class]->p;
 }
 
+/**
+ * Pushes a node on the stack, removing it from the graph.
+ *
+ * Any neighbor whose q total drops below its p because of this, and which
+ * therefore just became trivially colorable, is added to the colorable set.
+ */
 static void
-decrement_q(struct ra_graph *g, unsigned int n)
+add_node_to_stack(struct ra_graph *g, unsigned int n, BITSET_WORD *colorable)
 {
    unsigned int i;
    int n_class = g->nodes[n].class;
@@ -488,10 +569,40 @@ decrement_q(struct ra_graph *g, unsigned int n)
       unsigned int n2_class = g->nodes[n2].class;
 
       if (!g->nodes[n2].in_stack) {
-         assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
-         g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
+         bool was_colorable = pq_test(g, n2);
+
+         assert(g->nodes[n2].q_remaining >=
+                g->regs->classes[n2_class]->q[n_class]);
+         g->nodes[n2].q_remaining -= g->regs->classes[n2_class]->q[n_class];
+
+         if (!was_colorable && pq_test(g, n2) && g->nodes[n2].reg == NO_REG)
+            BITSET_SET(colorable, n2);
       }
    }
+
+   g->stack[g->stack_count] = n;
+   g->stack_count++;
+   g->nodes[n].in_stack = true;
+}
+
+/**
+ * Returns the highest node below n in the set, or -1 if there is none.
+ */
+static int
+find_prev_node(const BITSET_WORD *set, int n)
+{
+   while (n > 0) {
+      unsigned int w = (n - 1) / BITSET_WORDBITS;
+      unsigned int b = (n - 1) % BITSET_WORDBITS;
+      BITSET_WORD bits = set[w] & (~(BITSET_WORD)0 >> (BITSET_WORDBITS - 1 - b));
+
+      if (bits)
+         return w * BITSET_WORDBITS + util_last_bit(bits) - 1;
+
+      n = w * BITSET_WORDBITS;
+   }
+
+   return -1;
 }
 
 /**
@@ -503,69 +614,88 @@ decrement_q(struct ra_graph *g, unsigned int n)
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
  * neighbors and therefore is most likely to be allocated.
+ *
+ * The nodes are pushed in the order of repeated scans from the last node
+ * down to the first, pushing every node that is colorable by the time the
+ * scan reaches it.  Since q totals only ever decrease, a node becomes
+ * trivially colorable at most once, so rather than testing every node on
+ * each scan, the colorable nodes are kept in a bitset and each scan only
+ * visits its set bits.  A node that becomes colorable below the scan
+ * position is pushed in the same scan, and one above it in the next one,
+ * as with a full scan.
  */
 static void
 ra_simplify(struct ra_graph *g)
 {
-   bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
+   BITSET_WORD *colorable = calloc(BITSET_WORDS(g->count),
+                                   sizeof(BITSET_WORD));
+   unsigned int *remaining = malloc(g->count * sizeof(unsigned int));
+   unsigned int remaining_count = 0;
+   bool progress = true;
    int i;
 
+   for (i = 0; i < g->count; i++)
+      g->nodes[i].q_remaining = g->nodes[i].q_total;
+
+   for (i = g->count - 1; i >= 0; i--) {
+      if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
+         continue;
+
+      if (pq_test(g, i))
+         BITSET_SET(colorable, i);
+      else
+         remaining[remaining_count++] = i;
+   }
+
    while (progress) {
       unsigned int best_optimistic_node = ~0;
       unsigned int lowest_q_total = ~0;
+      unsigned int j = 0;
 
       progress = false;
 
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
-
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
+      for (i = find_prev_node(colorable, g->count); i >= 0;
+           i = find_prev_node(colorable, i)) {
+         BITSET_CLEAR(colorable, i);
+         add_node_to_stack(g, i, colorable);
+         progress = true;
       }
 
-      if (!progress && best_optimistic_node != ~0U) {
-         if (stack_optimistic_start == UINT_MAX)
-            stack_optimistic_start = g->stack_count;
+      if (progress)
+         continue;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
-      }
-   }
+      /* Nothing is colorable, so every node that isn't on the stack yet is
+       * in the remaining list, in the scan order.  Drop the others as we
+       * look for the best optimistic choice.
+       */
+      for (unsigned int k = 0; k < remaining_count; k++) {
+         unsigned int n = remaining[k];
 
-   g->stack_optimistic_start = stack_optimistic_start;
-}
+         if (g->nodes[n].in_stack)
+            continue;
 
-static bool
-ra_any_neighbors_conflict(struct ra_graph *g, unsigned int n, unsigned int r)
-{
-   unsigned int i;
+         remaining[j++] = n;
+         if (g->nodes[n].q_remaining < lowest_q_total) {
+            best_optimistic_node = n;
+            lowest_q_total = g->nodes[n].q_remaining;
+         }
+      }
+      remaining_count = j;
 
-   for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[i];
+      if (best_optimistic_node != ~0U) {
+         if (stack_optimistic_start == UINT_MAX)
+            stack_optimistic_start = g->stack_count;
 
-      if (!g->nodes[n2].in_stack &&
-          BITSET_TEST(g->regs->regs[r].conflicts, g->nodes[n2].reg)) {
-         return true;
+         add_node_to_stack(g, best_optimistic_node, colorable);
+         progress = true;
       }
    }
 
-   return false;
+   free(colorable);
+   free(remaining);
+
+   g->stack_optimistic_start = stack_optimistic_start;
 }
 
 /* Computes a bitfield of what regs are available for a given register
@@ -603,6 +733,25 @@ ra_compute_available_regs(struct ra_graph *g, unsigned int n, BITSET_WORD *regs)
    return false;
 }
 
+/**
+ * Returns the first register set in regs, starting the search at start and
+ * wrapping around.
+ */
+static unsigned int
+ra_find_first_reg(const BITSET_WORD *regs, unsigned int count,
+                  unsigned int start)
+{
+   unsigned int ri;
+
+   for (ri = 0; ri < count; ri++) {
+      unsigned int r = (start + ri) % count;
+      if (BITSET_TEST(regs, r))
+         return r;
+   }
+
+   return NO_REG;
+}
+
 /**
  * Pops nodes from the stack back into the graph, coloring them with
  * registers as they go.
@@ -614,44 +763,30 @@ static bool
 ra_select(struct ra_graph *g)
 {
    int start_search_reg = 0;
-   BITSET_WORD *select_regs = NULL;
-
-   if (g->select_reg_callback)
-      select_regs = malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+   BITSET_WORD *select_regs =
+      malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
 
    while (g->stack_count != 0) {
-      unsigned int ri;
-      unsigned int r = -1;
+      unsigned int r;
       int n = g->stack[g->stack_count - 1];
-      struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
       /* set this to false even if we return here so that
        * ra_get_best_spill_node() considers this node later.
        */
       g->nodes[n].in_stack = false;
 
-      if (g->select_reg_callback) {
-         if (!ra_compute_available_regs(g, n, select_regs)) {
-            free(select_regs);
-            return false;
-         }
+      if (!ra_compute_available_regs(g, n, select_regs)) {
+         free(select_regs);
+         return false;
+      }
 
+      if (g->select_reg_callback) {
          r = g->select_reg_callback(g, select_regs, g->select_reg_callback_data);
       } else {
          /* Find the lowest-numbered reg which is not used by a member
           * of the graph adjacent to us.
           */
-         for (ri = 0; ri < g->regs->count; ri++) {
-            r = (start_search_reg + ri) % g->regs->count;
-            if (!reg_belongs_to_class(r, c))
-               continue;
-
-            if (!ra_any_neighbors_conflict(g, n, r))
-               break;
-         }
-
-         if (ri >= g->regs->count)
-            return false;
+         r = ra_find_first_reg(select_regs, g->regs->count, start_search_reg);
       }
 
       g->nodes[n].reg = r;
@@ -679,6 +814,17 @@ ra_select(struct ra_graph *g)
 bool
 ra_allocate(struct ra_graph *g)
 {
+   unsigned int i;
+
+   /* Start over from the forced registers, in case this graph was already
+    * allocated and then edited after a failure.
+    */
+   for (i = 0; i < g->count; i++) {
+      g->nodes[i].reg = g->nodes[i].forced_reg;
+      g->nodes[i].in_stack = false;
+   }
+   g->stack_count = 0;
+
    ra_simplify(g);
    return ra_select(g);
 }
@@ -706,34 +852,19 @@ void
 ra_set_node_reg(struct ra_graph *g, unsigned int n, unsigned int reg)
 {
    g->nodes[n].reg = reg;
+   g->nodes[n].forced_reg = reg;
    g->nodes[n].in_stack = false;
 }
 
-static float
-ra_get_spill_benefit(struct ra_graph *g, unsigned int n)
-{
-   unsigned int j;
-   float benefit = 0;
-   int n_class = g->nodes[n].class;
-
-   /* Define the benefit of eliminating an interference between n, n2
-    * through spilling as q(C, B) / p(C).  This is similar to the
-    * "count number of edges" approach of traditional graph coloring,
-    * but takes classes into account.
-    */
-   for (j = 0; j < g->nodes[n].adjacency_count; j++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[j];
-      unsigned int n2_class = g->nodes[n2].class;
-      benefit += ((float)g->regs->classes[n_class]->q[n2_class] /
-                  g->regs->classes[n_class]->p);
-   }
-
-   return benefit;
-}
-
 /**
  * Returns a node number to be spilled according to the cost/benefit using
  * the pq test, or -1 if there are no spillable nodes.
+ *
+ * The benefit of eliminating an interference between n, n2 through
+ * spilling is defined as q(C, B) / p(C).  This is similar to the "count
+ * number of edges" approach of traditional graph coloring, but takes
+ * classes into account.  The sum over the interferences of each node is
+ * kept up to date by ra_add_node_adjacency().
  */
 int
 ra_get_best_spill_node(struct ra_graph *g)
@@ -757,7 +888,7 @@ ra_get_best_spill_node(struct ra_graph *g)
       if (g->nodes[n].in_stack)
          continue;
 
-      benefit = ra_get_spill_benefit(g, n);
+      benefit = g->nodes[n].spill_benefit;
 
       if (benefit / cost > best_benefit) {
 	 best_benefit = benefit / cost;
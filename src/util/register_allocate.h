@@ -82,9 +82,15 @@ void ra_set_select_reg_callback(struct ra_graph *g,
                                 void *data);
 void ra_add_node_interference(struct ra_graph *g,
 			      unsigned int n1, unsigned int n2);
+void ra_reset_node_interference(struct ra_graph *g, unsigned int n);
 /** @} */
 
-/** @{ Graph-coloring register allocation */
+/** @{ Graph-coloring register allocation
+ *
+ * ra_allocate() may be called again on the same graph after a failure, once
+ * the interferences of the nodes affected by spilling have been updated with
+ * ra_reset_node_interference() and ra_add_node_interference().
+ */
 bool ra_allocate(struct ra_graph *g);
 
 unsigned int ra_get_node_reg(struct ra_graph *g, unsigned int n);
@@ -0,0 +1,298 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Allocates interference graphs shaped like those of a large shader, with a
+ * register set laid out like the i965 FS one (classes of 1 to 4 contiguous
+ * registers), checks the result and reports how long building the graphs,
+ * allocation and spill node selection took.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os_time.h"
+#include "ralloc.h"
+#include "register_allocate.h"
+
+#define NUM_BASE_REGS 128
+#define NUM_CLASSES   4
+
+struct test_regs {
+   struct ra_regs *regs;
+   unsigned classes[NUM_CLASSES];
+   /* First register of each class; register r of class c covers base
+    * registers (r - class_start[c]) to (r - class_start[c] + c).
+    */
+   unsigned class_start[NUM_CLASSES];
+};
+
+static void
+setup_regs(struct test_regs *t, void *mem_ctx)
+{
+   unsigned count = 0;
+
+   for (unsigned c = 0; c < NUM_CLASSES; c++) {
+      t->class_start[c] = count;
+      count += NUM_BASE_REGS - c;
+   }
+
+   t->regs = ra_alloc_reg_set(mem_ctx, count, true);
+
+   for (unsigned c = 0; c < NUM_CLASSES; c++) {
+      t->classes[c] = ra_alloc_reg_class(t->regs);
+      for (unsigned i = 0; i < NUM_BASE_REGS - c; i++) {
+         unsigned reg = t->class_start[c] + i;
+
+         ra_class_add_reg(t->regs, t->classes[c], reg);
+         if (c > 0) {
+            for (unsigned j = 0; j <= c; j++)
+               ra_add_transitive_reg_conflict(t->regs, i + j, reg);
+         }
+      }
+   }
+
+   ra_set_finalize(t->regs, NULL);
+}
+
+static unsigned
+first_base_reg(const struct test_regs *t, unsigned c, unsigned reg)
+{
+   assert(reg >= t->class_start[c] &&
+          reg < t->class_start[c] + NUM_BASE_REGS - c);
+   return reg - t->class_start[c];
+}
+
+struct test_graph {
+   unsigned count;
+   unsigned *start, *end, *class;
+   bool *spilled;
+};
+
+static uint32_t
+next_random(uint32_t *state)
+{
+   /* xorshift32 */
+   *state ^= *state << 13;
+   *state ^= *state >> 17;
+   *state ^= *state << 5;
+   return *state;
+}
+
+/* Live ranges of a straight-line program with num_nodes values, most of them
+ * short-lived and a few living across a large part of the program, which
+ * puts the register pressure at about the given target.
+ */
+static void
+make_graph(struct test_graph *tg, unsigned num_nodes, unsigned pressure,
+           uint32_t seed)
+{
+   tg->count = num_nodes;
+   tg->start = malloc(num_nodes * sizeof(unsigned));
+   tg->end = malloc(num_nodes * sizeof(unsigned));
+   tg->class = malloc(num_nodes * sizeof(unsigned));
+   tg->spilled = calloc(num_nodes, sizeof(bool));
+
+   for (unsigned i = 0; i < num_nodes; i++) {
+      uint32_t r = next_random(&seed);
+      unsigned len = (r & 7) == 0 ? pressure * 4 : r % (pressure / 2) + 1;
+
+      tg->start[i] = i;
+      tg->end[i] = i + len;
+      tg->class[i] = (r >> 8) % 8 == 0 ? (r >> 11) % NUM_CLASSES : 0;
+   }
+}
+
+static void
+free_graph(struct test_graph *tg)
+{
+   free(tg->start);
+   free(tg->end);
+   free(tg->class);
+   free(tg->spilled);
+}
+
+static struct ra_graph *
+build_graph(const struct test_regs *t, const struct test_graph *tg)
+{
+   struct ra_graph *g = ra_alloc_interference_graph(t->regs, tg->count);
+
+   for (unsigned i = 0; i < tg->count; i++) {
+      ra_set_node_class(g, i, t->classes[tg->class[i]]);
+      /* Like the spill temporaries in the backends, spilled nodes can't be
+       * spilled again.
+       */
+      if (!tg->spilled[i])
+         ra_set_node_spill_cost(g, i, 1.0f + (tg->end[i] - tg->start[i]));
+   }
+
+   for (unsigned i = 0; i < tg->count; i++) {
+      for (unsigned j = i + 1; j < tg->count && tg->start[j] < tg->end[i]; j++)
+         ra_add_node_interference(g, i, j);
+   }
+
+   return g;
+}
+
+static void
+check_allocation(const struct test_regs *t, const struct test_graph *tg,
+                 struct ra_graph *g)
+{
+   for (unsigned i = 0; i < tg->count; i++) {
+      unsigned ci = tg->class[i];
+      unsigned bi = first_base_reg(t, ci, ra_get_node_reg(g, i));
+
+      for (unsigned j = i + 1; j < tg->count && tg->start[j] < tg->end[i];
+           j++) {
+         unsigned cj = tg->class[j];
+         unsigned bj = first_base_reg(t, cj, ra_get_node_reg(g, j));
+
+         assert(bi + ci < bj || bj + cj < bi);
+      }
+   }
+}
+
+static void
+spill_node(const struct test_regs *t, struct test_graph *tg,
+           struct ra_graph *g, unsigned node)
+{
+   tg->end[node] = tg->start[node] + 1;
+   tg->spilled[node] = true;
+
+   if (!g)
+      return;
+
+   /* Only the spilled node's interferences change. */
+   ra_reset_node_interference(g, node);
+   ra_set_node_spill_cost(g, node, 0.0f);
+   for (unsigned i = 0; i < node; i++) {
+      if (tg->end[i] > tg->start[node])
+         ra_add_node_interference(g, i, node);
+   }
+}
+
+/* Colors a random graph, spilling until it fits, and checks the result.  The
+ * time spent in each step is only printed when bench is set.
+ */
+static void
+test_graph(const struct test_regs *t, unsigned num_nodes, unsigned pressure,
+           bool incremental, bool bench)
+{
+   struct test_graph tg;
+   struct ra_graph *g = NULL;
+   unsigned spills = 0;
+   int64_t build_time = 0, alloc_time = 0, spill_time = 0;
+
+   make_graph(&tg, num_nodes, pressure, 0x1234567 + num_nodes);
+
+   /* Spill the best node and try again until the graph colors, either
+    * building a new graph each time like the backends do, or updating the
+    * interferences of the spilled node.  Spilling a node here just shortens
+    * its live range to a single instruction.
+    */
+   for (;;) {
+      int64_t start = os_time_get_nano();
+      if (!g)
+         g = build_graph(t, &tg);
+      build_time += os_time_get_nano() - start;
+
+      start = os_time_get_nano();
+      bool ok = ra_allocate(g);
+      alloc_time += os_time_get_nano() - start;
+
+      if (ok)
+         break;
+
+      start = os_time_get_nano();
+      int node = ra_get_best_spill_node(g);
+      spill_time += os_time_get_nano() - start;
+
+      assert(node >= 0);
+      spills++;
+
+      start = os_time_get_nano();
+      if (!incremental) {
+         ralloc_free(g);
+         g = NULL;
+      }
+      spill_node(t, &tg, g, node);
+      build_time += os_time_get_nano() - start;
+   }
+
+   check_allocation(t, &tg, g);
+   ralloc_free(g);
+
+   if (bench) {
+      printf("%5u nodes, pressure %3u, %-11s: %3u spills, build %8.2f ms, "
+             "allocate %8.2f ms, choose spill %6.2f ms\n",
+             num_nodes, pressure, incremental ? "incremental" : "rebuild",
+             spills, build_time / 1e6, alloc_time / 1e6, spill_time / 1e6);
+   }
+
+   free_graph(&tg);
+}
+
+static void
+test_forced_regs(const struct test_regs *t)
+{
+   struct ra_graph *g = ra_alloc_interference_graph(t->regs, 3);
+
+   ra_set_node_class(g, 0, t->classes[0]);
+   ra_set_node_class(g, 1, t->classes[0]);
+   ra_set_node_reg(g, 2, 0);
+   ra_add_node_interference(g, 0, 1);
+   ra_add_node_interference(g, 0, 2);
+   ra_add_node_interference(g, 1, 2);
+
+   bool ok = ra_allocate(g);
+   assert(ok);
+   assert(ra_get_node_reg(g, 2) == 0);
+   assert(ra_get_node_reg(g, 0) != 0 && ra_get_node_reg(g, 1) != 0);
+   assert(ra_get_node_reg(g, 0) != ra_get_node_reg(g, 1));
+
+   ralloc_free(g);
+}
+
+int
+main(void)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   const bool bench = getenv("TEST_BENCH");
+   struct test_regs t;
+
+   setup_regs(&t, mem_ctx);
+
+   test_forced_regs(&t);
+
+   test_graph(&t, 1000, 64, false, bench);
+   test_graph(&t, 4000, 96, false, bench);
+   test_graph(&t, 4000, 120, false, bench);
+   test_graph(&t, 4000, 120, true, bench);
+
+   ralloc_free(mem_ctx);
+
+   return 0;
+}
@@ -32,8 +32,6 @@
 
 #include "rgtc.h"
 
-#define RGTC_DEBUG 0
-
 #define TAG(x) util_format_unsigned_##x
 
 #define TYPE unsigned char
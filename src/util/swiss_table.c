@@ -0,0 +1,422 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "swiss_table.h"
+#include "ralloc.h"
+
+/* Up to 7/8 of the slots may hold entries. */
+static uint32_t
+max_entries_for_size(uint32_t size)
+{
+   return size - size / 8;
+}
+
+static bool
+swiss_table_alloc(struct swiss_table *st, uint32_t size)
+{
+   uint32_t num_groups = size / SWISS_TABLE_GROUP_SIZE;
+   uint8_t *ctrl = ralloc_array(st, uint8_t, size);
+   uint8_t *overflow = rzalloc_array(st, uint8_t, num_groups);
+   struct hash_entry *table = ralloc_array(st, struct hash_entry, size);
+
+   if (ctrl == NULL || overflow == NULL || table == NULL) {
+      ralloc_free(ctrl);
+      ralloc_free(overflow);
+      ralloc_free(table);
+      return false;
+   }
+
+   memset(ctrl, SWISS_TABLE_CTRL_EMPTY, size);
+
+   st->ctrl = ctrl;
+   st->overflow = overflow;
+   st->table = table;
+   st->size = size;
+   st->max_entries = max_entries_for_size(size);
+   st->entries = 0;
+   st->overflow_removals = 0;
+
+   return true;
+}
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b))
+{
+   struct swiss_table *st;
+
+   st = ralloc(mem_ctx, struct swiss_table);
+   if (st == NULL)
+      return NULL;
+
+   st->key_hash_function = key_hash_function;
+   st->key_equals_function = key_equals_function;
+
+   if (!swiss_table_alloc(st, SWISS_TABLE_GROUP_SIZE)) {
+      ralloc_free(st);
+      return NULL;
+   }
+
+   return st;
+}
+
+static uint32_t
+key_hash_pointer(const void *key)
+{
+   return _mesa_hash_pointer(key);
+}
+
+/**
+ * Creates a table keyed by pointer value, usable with
+ * _mesa_swiss_table_search_pointer().
+ */
+struct swiss_table *
+_mesa_swiss_table_create_pointer(void *mem_ctx)
+{
+   return _mesa_swiss_table_create(mem_ctx, key_hash_pointer,
+                                   _mesa_key_pointer_equal);
+}
+
+/**
+ * Creates a table keyed by 32-bit integers stored in the key pointer, usable
+ * with the _mesa_swiss_table_*_u32() functions.
+ */
+struct swiss_table *
+_mesa_swiss_table_create_u32(void *mem_ctx)
+{
+   return _mesa_swiss_table_create(mem_ctx, _mesa_swiss_table_hash_u32,
+                                   _mesa_key_pointer_equal);
+}
+
+struct swiss_table *
+_mesa_swiss_table_clone(struct swiss_table *src, void *dst_mem_ctx)
+{
+   struct swiss_table *st;
+
+   st = ralloc(dst_mem_ctx, struct swiss_table);
+   if (st == NULL)
+      return NULL;
+
+   memcpy(st, src, sizeof(struct swiss_table));
+
+   st->ctrl = ralloc_array(st, uint8_t, st->size);
+   st->overflow = ralloc_array(st, uint8_t,
+                               st->size / SWISS_TABLE_GROUP_SIZE);
+   st->table = ralloc_array(st, struct hash_entry, st->size);
+   if (st->ctrl == NULL || st->overflow == NULL || st->table == NULL) {
+      ralloc_free(st);
+      return NULL;
+   }
+
+   memcpy(st->ctrl, src->ctrl, st->size);
+   memcpy(st->overflow, src->overflow, st->size / SWISS_TABLE_GROUP_SIZE);
+   memcpy(st->table, src->table, st->size * sizeof(struct hash_entry));
+
+   return st;
+}
+
+/**
+ * Frees the given table.
+ *
+ * If delete_function is passed, it gets called on each entry present before
+ * freeing.
+ */
+void
+_mesa_swiss_table_destroy(struct swiss_table *st,
+                          void (*delete_function)(struct hash_entry *entry))
+{
+   if (!st)
+      return;
+
+   if (delete_function) {
+      struct hash_entry *entry;
+
+      swiss_table_foreach(st, entry) {
+         delete_function(entry);
+      }
+   }
+   ralloc_free(st);
+}
+
+/**
+ * Deletes all entries of the given table without deleting the table itself
+ * or changing its size.
+ *
+ * If delete_function is passed, it gets called on each entry present.
+ */
+void
+_mesa_swiss_table_clear(struct swiss_table *st,
+                        void (*delete_function)(struct hash_entry *entry))
+{
+   if (delete_function) {
+      struct hash_entry *entry;
+
+      swiss_table_foreach(st, entry) {
+         delete_function(entry);
+      }
+   }
+
+   memset(st->ctrl, SWISS_TABLE_CTRL_EMPTY, st->size);
+   memset(st->overflow, 0, st->size / SWISS_TABLE_GROUP_SIZE);
+   st->entries = 0;
+   st->overflow_removals = 0;
+}
+
+static struct hash_entry *
+swiss_table_search(struct swiss_table *st, uint32_t hash, const void *key)
+{
+   uint32_t mixed = _mesa_swiss_table_mix(hash);
+   uint8_t h2 = _mesa_swiss_table_h2(mixed);
+
+   swiss_table_foreach_probe(st, mixed, group, i) {
+      const uint8_t *ctrl = st->ctrl + group * SWISS_TABLE_GROUP_SIZE;
+      unsigned match = _mesa_swiss_table_group_match(ctrl, h2);
+
+      while (match) {
+         struct hash_entry *entry =
+            &st->table[group * SWISS_TABLE_GROUP_SIZE + u_bit_scan(&match)];
+         if (entry->hash == hash && st->key_equals_function(key, entry->key))
+            return entry;
+      }
+
+      if (!_mesa_swiss_table_group_overflowed(st, group, h2))
+         return NULL;
+   }
+
+   return NULL;
+}
+
+/**
+ * Finds a table entry with the given key.
+ *
+ * Returns NULL if no entry is found.  Note that the data pointer may be
+ * modified by the user.
+ */
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *st, const void *key)
+{
+   assert(st->key_hash_function);
+   return swiss_table_search(st, st->key_hash_function(key), key);
+}
+
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key)
+{
+   assert(st->key_hash_function == NULL || hash == st->key_hash_function(key));
+   return swiss_table_search(st, hash, key);
+}
+
+/* Places an entry known not to be in the table in the first empty slot of
+ * its probe sequence, marking the overflow bit of the full groups skipped.
+ */
+static struct hash_entry *
+swiss_table_place(struct swiss_table *st, uint32_t hash,
+                  const void *key, void *data)
+{
+   uint32_t mixed = _mesa_swiss_table_mix(hash);
+   uint8_t h2 = _mesa_swiss_table_h2(mixed);
+
+   swiss_table_foreach_probe(st, mixed, group, i) {
+      uint8_t *ctrl = st->ctrl + group * SWISS_TABLE_GROUP_SIZE;
+      unsigned empty = _mesa_swiss_table_group_match_empty(ctrl);
+
+      if (empty) {
+         unsigned slot = u_bit_scan(&empty);
+         struct hash_entry *entry =
+            &st->table[group * SWISS_TABLE_GROUP_SIZE + slot];
+
+         ctrl[slot] = h2;
+         entry->hash = hash;
+         entry->key = key;
+         entry->data = data;
+         st->entries++;
+         return entry;
+      }
+
+      st->overflow[group] |= 1 << (h2 & 7);
+   }
+
+   return NULL;
+}
+
+static void
+swiss_table_rehash(struct swiss_table *st, uint32_t new_size)
+{
+   struct swiss_table old_st = *st;
+   struct hash_entry *entry;
+
+   if (!swiss_table_alloc(st, new_size))
+      return;
+
+   swiss_table_foreach(&old_st, entry) {
+      swiss_table_place(st, entry->hash, entry->key, entry->data);
+   }
+
+   ralloc_free(old_st.ctrl);
+   ralloc_free(old_st.overflow);
+   ralloc_free(old_st.table);
+}
+
+static struct hash_entry *
+swiss_table_insert(struct swiss_table *st, uint32_t hash,
+                   const void *key, void *data)
+{
+   struct hash_entry *entry = swiss_table_search(st, hash, key);
+
+   /* Replace the key and data of an existing entry, like
+    * _mesa_hash_table_insert() does.
+    */
+   if (entry) {
+      entry->key = key;
+      entry->data = data;
+      return entry;
+   }
+
+   if (st->entries + st->overflow_removals >= st->max_entries) {
+      /* Grow if the table is more than half full of live entries, otherwise
+       * only rebuild it to clear the overflow bits.
+       */
+      if (st->entries >= st->max_entries / 2)
+         swiss_table_rehash(st, st->size * 2);
+      else
+         swiss_table_rehash(st, st->size);
+   }
+
+   /* We could hit here if a required resize failed. An unchecked-malloc
+    * application could ignore this result.
+    */
+   if (st->entries + st->overflow_removals >= st->max_entries)
+      return NULL;
+
+   return swiss_table_place(st, hash, key, data);
+}
+
+/**
+ * Inserts the key into the table.
+ *
+ * Note that insertion may rearrange the table on a resize or rehash,
+ * so previously found hash_entries are no longer valid after this function.
+ */
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *st, const void *key, void *data)
+{
+   assert(st->key_hash_function);
+   return swiss_table_insert(st, st->key_hash_function(key), key, data);
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key, void *data)
+{
+   assert(st->key_hash_function == NULL || hash == st->key_hash_function(key));
+   return swiss_table_insert(st, hash, key, data);
+}
+
+/**
+ * This function deletes the given table entry.
+ *
+ * Deletion never moves other entries, so an iteration over the table
+ * deleting entries is safe.
+ */
+void
+_mesa_swiss_table_remove(struct swiss_table *st,
+                         struct hash_entry *entry)
+{
+   if (!entry)
+      return;
+
+   uint32_t index = entry - st->table;
+   uint32_t group = index / SWISS_TABLE_GROUP_SIZE;
+
+   assert(st->ctrl[index] != SWISS_TABLE_CTRL_EMPTY);
+
+   st->ctrl[index] = SWISS_TABLE_CTRL_EMPTY;
+   st->entries--;
+
+   /* Lookups still probe past this group for other entries, so the slot
+    * freed here doesn't shorten any probe sequence.
+    */
+   if (st->overflow[group])
+      st->overflow_removals++;
+}
+
+/**
+ * Removes the entry with the corresponding key, if exists.
+ */
+void
+_mesa_swiss_table_remove_key(struct swiss_table *st, const void *key)
+{
+   _mesa_swiss_table_remove(st, _mesa_swiss_table_search(st, key));
+}
+
+/**
+ * This function is an iterator over the table.
+ *
+ * Pass in NULL for the first entry, as in the start of a for loop.
+ */
+struct hash_entry *
+_mesa_swiss_table_next_entry(struct swiss_table *st,
+                             struct hash_entry *entry)
+{
+   uint32_t index = entry ? entry - st->table + 1 : 0;
+
+   for (; index < st->size; index++) {
+      if (st->ctrl[index] != SWISS_TABLE_CTRL_EMPTY)
+         return &st->table[index];
+   }
+
+   return NULL;
+}
+
+/**
+ * Returns a random entry from the table.
+ *
+ * @predicate may be used to filter entries, or may be set to NULL for no
+ * filtering.
+ */
+struct hash_entry *
+_mesa_swiss_table_random_entry(struct swiss_table *st,
+                               bool (*predicate)(struct hash_entry *entry))
+{
+   uint32_t start = rand() % st->size;
+
+   if (st->entries == 0)
+      return NULL;
+
+   for (uint32_t i = 0; i < st->size; i++) {
+      uint32_t index = (start + i) % st->size;
+
+      if (st->ctrl[index] != SWISS_TABLE_CTRL_EMPTY &&
+          (!predicate || predicate(&st->table[index])))
+         return &st->table[index];
+   }
+
+   return NULL;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * A hash table with the same interface as util/hash_table.h, implemented as
+ * a "Swiss table": the slots are split into groups of 16, and a separate
+ * array holds one control byte per slot with 7 bits of the hash of the key
+ * stored in it.  A lookup compares the control bytes of a whole group at
+ * once (with SSE2 where available) and only looks at the slots whose bits
+ * match.
+ *
+ * Each group also has an overflow byte, with bit (h2 & 7) set when an entry
+ * with that hash had to be placed past the group because it was full.  A
+ * lookup stops at the first group whose overflow bit is clear, so removing
+ * an entry simply empties its slot, and no tombstones are needed.
+ *
+ * Unlike struct hash_table, any key value (including NULL) may be stored.
+ */
+
+#ifndef _SWISS_TABLE_H
+#define _SWISS_TABLE_H
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include "c99_compat.h"
+#include "bitscan.h"
+#include "macros.h"
+#include "hash_table.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWISS_TABLE_GROUP_SIZE 16
+
+/* Control byte value of an empty slot.  Slots holding an entry store 7 bits
+ * of the hash, so only empty slots have the top bit set.
+ */
+#define SWISS_TABLE_CTRL_EMPTY   0x80
+
+struct swiss_table {
+   uint8_t *ctrl;
+   uint8_t *overflow; /* one byte per group */
+   struct hash_entry *table;
+   uint32_t (*key_hash_function)(const void *key);
+   bool (*key_equals_function)(const void *a, const void *b);
+   uint32_t size; /* number of slots, a power of two multiple of 16 */
+   uint32_t max_entries;
+   uint32_t entries;
+   /* Entries removed from groups with overflow bits set.  These count
+    * against max_entries, so that a rehash eventually clears the bits.
+    */
+   uint32_t overflow_removals;
+};
+
+struct swiss_table *
+_mesa_swiss_table_create(void *mem_ctx,
+                         uint32_t (*key_hash_function)(const void *key),
+                         bool (*key_equals_function)(const void *a,
+                                                     const void *b));
+struct swiss_table *
+_mesa_swiss_table_create_pointer(void *mem_ctx);
+struct swiss_table *
+_mesa_swiss_table_create_u32(void *mem_ctx);
+struct swiss_table *
+_mesa_swiss_table_clone(struct swiss_table *src, void *dst_mem_ctx);
+void _mesa_swiss_table_destroy(struct swiss_table *st,
+                               void (*delete_function)(struct hash_entry *entry));
+void _mesa_swiss_table_clear(struct swiss_table *st,
+                             void (*delete_function)(struct hash_entry *entry));
+
+static inline uint32_t _mesa_swiss_table_num_entries(struct swiss_table *st)
+{
+   return st->entries;
+}
+
+struct hash_entry *
+_mesa_swiss_table_insert(struct swiss_table *st, const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_insert_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key, void *data);
+struct hash_entry *
+_mesa_swiss_table_search(struct swiss_table *st, const void *key);
+struct hash_entry *
+_mesa_swiss_table_search_pre_hashed(struct swiss_table *st, uint32_t hash,
+                                    const void *key);
+void _mesa_swiss_table_remove(struct swiss_table *st,
+                              struct hash_entry *entry);
+void _mesa_swiss_table_remove_key(struct swiss_table *st,
+                                  const void *key);
+
+struct hash_entry *_mesa_swiss_table_next_entry(struct swiss_table *st,
+                                                struct hash_entry *entry);
+struct hash_entry *
+_mesa_swiss_table_random_entry(struct swiss_table *st,
+                               bool (*predicate)(struct hash_entry *entry));
+
+/**
+ * This foreach function is safe against deletion, but not against insertion
+ * (which may rehash the table, making entry a dangling pointer).
+ */
+#define swiss_table_foreach(st, entry)                   \
+   for (entry = _mesa_swiss_table_next_entry(st, NULL);  \
+        entry != NULL;                                   \
+        entry = _mesa_swiss_table_next_entry(st, entry))
+
+/* Internal helpers, shared with the inlined lookups below. */
+
+/* Spread the caller's hash over all 32 bits, since hashes like
+ * _mesa_hash_pointer() or small integer keys leave the bits that select the
+ * group and the control byte poorly distributed.
+ */
+static inline uint32_t
+_mesa_swiss_table_mix(uint32_t hash)
+{
+   return hash * 0x9e3779b1u;
+}
+
+static inline uint8_t
+_mesa_swiss_table_h2(uint32_t mixed)
+{
+   return mixed >> 25;
+}
+
+static inline uint32_t
+_mesa_swiss_table_first_group(const struct swiss_table *st, uint32_t mixed)
+{
+   return (mixed >> 7) & (st->size / SWISS_TABLE_GROUP_SIZE - 1);
+}
+
+/* Returns a mask with bit i set if control byte i of the group equals c. */
+static inline uint32_t
+_mesa_swiss_table_group_match(const uint8_t *group, uint8_t c)
+{
+#ifdef __SSE2__
+   __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c)));
+#else
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < SWISS_TABLE_GROUP_SIZE; i++)
+      mask |= (uint32_t)(group[i] == c) << i;
+   return mask;
+#endif
+}
+
+/* Returns a mask with bit i set if slot i of the group holds no entry. */
+static inline uint32_t
+_mesa_swiss_table_group_match_empty(const uint8_t *group)
+{
+#ifdef __SSE2__
+   return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+   uint32_t mask = 0;
+   for (unsigned i = 0; i < SWISS_TABLE_GROUP_SIZE; i++)
+      mask |= (uint32_t)(group[i] >> 7) << i;
+   return mask;
+#endif
+}
+
+/* Whether entries with this h2 may have been placed past the group. */
+static inline bool
+_mesa_swiss_table_group_overflowed(const struct swiss_table *st,
+                                   uint32_t group, uint8_t h2)
+{
+   return st->overflow[group] & (1 << (h2 & 7));
+}
+
+/* Walks the probe sequence of a hash, visiting groups g, g+1, g+3, g+6...
+ * which covers every group since the number of groups is a power of two.
+ */
+#define swiss_table_foreach_probe(st, mixed, group, i)                    \
+   for (uint32_t i = 0, group = _mesa_swiss_table_first_group(st, mixed); \
+        i < (st)->size / SWISS_TABLE_GROUP_SIZE;                          \
+        i++, group = (group + i) & ((st)->size / SWISS_TABLE_GROUP_SIZE - 1))
+
+/**
+ * Looks up a key in a table created with _mesa_swiss_table_create_pointer(),
+ * with the hashing and key comparison inlined.
+ */
+static inline struct hash_entry *
+_mesa_swiss_table_search_pointer(struct swiss_table *st, const void *key)
+{
+   uint32_t hash = _mesa_hash_pointer(key);
+   uint32_t mixed = _mesa_swiss_table_mix(hash);
+   uint8_t h2 = _mesa_swiss_table_h2(mixed);
+
+   swiss_table_foreach_probe(st, mixed, group, i) {
+      const uint8_t *ctrl = st->ctrl + group * SWISS_TABLE_GROUP_SIZE;
+      unsigned match = _mesa_swiss_table_group_match(ctrl, h2);
+
+      while (match) {
+         struct hash_entry *entry =
+            &st->table[group * SWISS_TABLE_GROUP_SIZE + u_bit_scan(&match)];
+         if (entry->key == key)
+            return entry;
+      }
+
+      if (!_mesa_swiss_table_group_overflowed(st, group, h2))
+         return NULL;
+   }
+
+   return NULL;
+}
+
+static inline uint32_t
+_mesa_swiss_table_hash_u32(const void *key)
+{
+   return (uint32_t)(uintptr_t)key;
+}
+
+/**
+ * Looks up a key in a table created with _mesa_swiss_table_create_u32(),
+ * with the hashing and key comparison inlined.
+ */
+static inline struct hash_entry *
+_mesa_swiss_table_search_u32(struct swiss_table *st, uint32_t key)
+{
+   uint32_t mixed = _mesa_swiss_table_mix(key);
+   uint8_t h2 = _mesa_swiss_table_h2(mixed);
+
+   swiss_table_foreach_probe(st, mixed, group, i) {
+      const uint8_t *ctrl = st->ctrl + group * SWISS_TABLE_GROUP_SIZE;
+      unsigned match = _mesa_swiss_table_group_match(ctrl, h2);
+
+      while (match) {
+         struct hash_entry *entry =
+            &st->table[group * SWISS_TABLE_GROUP_SIZE + u_bit_scan(&match)];
+         if (entry->hash == key)
+            return entry;
+      }
+
+      if (!_mesa_swiss_table_group_overflowed(st, group, h2))
+         return NULL;
+   }
+
+   return NULL;
+}
+
+static inline struct hash_entry *
+_mesa_swiss_table_insert_u32(struct swiss_table *st, uint32_t key, void *data)
+{
+   return _mesa_swiss_table_insert_pre_hashed(st, key,
+                                              (const void *)(uintptr_t)key,
+                                              data);
+}
+
+static inline void
+_mesa_swiss_table_remove_u32(struct swiss_table *st, uint32_t key)
+{
+   _mesa_swiss_table_remove(st, _mesa_swiss_table_search_u32(st, key));
+}
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _SWISS_TABLE_H */
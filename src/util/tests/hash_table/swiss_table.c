@@ -0,0 +1,212 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Checks the swiss table against a plain array under random insert/remove
+ * churn.  With --bench, also compares its speed with the regular hash table
+ * on the same workload.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "hash_table.h"
+#include "swiss_table.h"
+#include "os_time.h"
+
+#define NUM_KEYS 4096
+#define NUM_OPS  (200 * 1000)
+
+static uint32_t
+next_random(uint32_t *state)
+{
+   /* xorshift32 */
+   *state ^= *state << 13;
+   *state ^= *state >> 17;
+   *state ^= *state << 5;
+   return *state;
+}
+
+static void
+check_against_array(void)
+{
+   struct swiss_table *st = _mesa_swiss_table_create_u32(NULL);
+   static void *present[NUM_KEYS];
+   struct hash_entry *entry;
+   uint32_t state = 0x12345678;
+   uint32_t num_present = 0;
+
+   for (unsigned op = 0; op < NUM_OPS; op++) {
+      uint32_t r = next_random(&state);
+      uint32_t key = r % NUM_KEYS;
+      void *data = (void *)(uintptr_t)(op + 1);
+
+      entry = _mesa_swiss_table_search_u32(st, key);
+      assert((entry != NULL) == (present[key] != NULL));
+      if (entry)
+         assert(entry->data == present[key]);
+
+      /* Bias towards insertion for the first half, then towards removal,
+       * so the table both grows and shrinks.
+       */
+      bool insert = (r >> 16) % 4 < (op < NUM_OPS / 2 ? 3 : 1);
+
+      if (insert) {
+         if (!present[key])
+            num_present++;
+         present[key] = data;
+         _mesa_swiss_table_insert_u32(st, key, data);
+      } else if (present[key]) {
+         num_present--;
+         present[key] = NULL;
+         _mesa_swiss_table_remove(st, entry);
+      }
+
+      assert(_mesa_swiss_table_num_entries(st) == num_present);
+   }
+
+   uint32_t count = 0;
+   swiss_table_foreach(st, entry) {
+      uint32_t key = (uintptr_t)entry->key;
+      assert(present[key] == entry->data);
+      count++;
+   }
+   assert(count == num_present);
+
+   _mesa_swiss_table_clear(st, NULL);
+   assert(_mesa_swiss_table_num_entries(st) == 0);
+   assert(_mesa_swiss_table_next_entry(st, NULL) == NULL);
+
+   _mesa_swiss_table_destroy(st, NULL);
+}
+
+static void
+check_pointer_keys(void)
+{
+   struct swiss_table *st = _mesa_swiss_table_create_pointer(NULL);
+   static uint32_t objects[NUM_KEYS];
+
+   for (unsigned i = 0; i < NUM_KEYS; i++)
+      _mesa_swiss_table_insert(st, &objects[i], &objects[i]);
+
+   for (unsigned i = 0; i < NUM_KEYS; i++) {
+      struct hash_entry *entry =
+         _mesa_swiss_table_search_pointer(st, &objects[i]);
+      assert(entry && entry->data == &objects[i]);
+      assert(entry == _mesa_swiss_table_search(st, &objects[i]));
+   }
+
+   for (unsigned i = 0; i < NUM_KEYS; i += 2)
+      _mesa_swiss_table_remove_key(st, &objects[i]);
+
+   for (unsigned i = 0; i < NUM_KEYS; i++) {
+      struct hash_entry *entry =
+         _mesa_swiss_table_search_pointer(st, &objects[i]);
+      assert((entry != NULL) == (i % 2 == 1));
+   }
+
+   /* NULL is a valid key. */
+   _mesa_swiss_table_insert(st, NULL, objects);
+   assert(_mesa_swiss_table_search_pointer(st, NULL)->data == objects);
+
+   _mesa_swiss_table_destroy(st, NULL);
+}
+
+static uint32_t
+key_value(const void *key)
+{
+   return (uint32_t)(uintptr_t)key;
+}
+
+static bool
+key_equals(const void *a, const void *b)
+{
+   return a == b;
+}
+
+static double
+churn_hash_table(void)
+{
+   struct hash_table *ht = _mesa_hash_table_create(NULL, key_value,
+                                                   key_equals);
+   uint32_t state = 0x87654321;
+   int64_t start = os_time_get_nano();
+
+   for (unsigned op = 0; op < NUM_OPS; op++) {
+      uint32_t r = next_random(&state);
+      /* _mesa_hash_table reserves the NULL key. */
+      const void *key = (const void *)(uintptr_t)(r % NUM_KEYS + 1);
+      struct hash_entry *entry = _mesa_hash_table_search(ht, key);
+
+      if (entry)
+         _mesa_hash_table_remove(ht, entry);
+      else
+         _mesa_hash_table_insert(ht, key, NULL);
+   }
+
+   int64_t time = os_time_get_nano() - start;
+   _mesa_hash_table_destroy(ht, NULL);
+   return (double)time / NUM_OPS;
+}
+
+static double
+churn_swiss_table(bool inlined)
+{
+   struct swiss_table *st = _mesa_swiss_table_create_u32(NULL);
+   uint32_t state = 0x87654321;
+   int64_t start = os_time_get_nano();
+
+   for (unsigned op = 0; op < NUM_OPS; op++) {
+      uint32_t r = next_random(&state);
+      uint32_t key = r % NUM_KEYS + 1;
+      struct hash_entry *entry = inlined ?
+         _mesa_swiss_table_search_u32(st, key) :
+         _mesa_swiss_table_search(st, (const void *)(uintptr_t)key);
+
+      if (entry)
+         _mesa_swiss_table_remove(st, entry);
+      else
+         _mesa_swiss_table_insert_u32(st, key, NULL);
+   }
+
+   int64_t time = os_time_get_nano() - start;
+   _mesa_swiss_table_destroy(st, NULL);
+   return (double)time / NUM_OPS;
+}
+
+int
+main(int argc, char **argv)
+{
+   check_against_array();
+   check_pointer_keys();
+
+   if (argc < 2 || strcmp(argv[1], "--bench") != 0)
+      return 0;
+
+   printf("insert/remove churn, %u keys:\n", NUM_KEYS);
+   printf("  hash_table:          %.1f ns/op\n", churn_hash_table());
+   printf("  swiss_table:         %.1f ns/op\n", churn_swiss_table(false));
+   printf("  swiss_table (u32):   %.1f ns/op\n", churn_swiss_table(true));
+
+   return 0;
+}
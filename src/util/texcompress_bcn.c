@@ -0,0 +1,1505 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * All formats are encoded the same way: the endpoints start at the extent of
+ * the block along its principal axis, the indices go to the nearest palette
+ * entry and the endpoints are then refitted to the indices by least squares,
+ * once at NORMAL quality and twice at HIGH quality.  Of the BPTC modes, BC7
+ * only uses mode 6 and, for opaque blocks at NORMAL quality and above,
+ * mode 1 on the most promising partitions.  BC6H uses modes 11 and 12.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "texcompress_bcn.h"
+
+#include "c11/threads.h"
+#include "util/bitscan.h"
+#include "util/debug.h"
+#include "util/half_float.h"
+#include "util/macros.h"
+#include "util/u_parallel.h"
+
+/** Cost of a block, in bytes of the simple conversions util_parallel_rows()
+ * is tuned for.
+ */
+#define BCN_BLOCK_COST 1024
+
+static once_flag bcn_once = ONCE_FLAG_INIT;
+static enum util_bcn_quality bcn_quality;
+
+/* Best pair of 5 or 6 bit endpoints to get each 8-bit value from the 2/3
+ * interpolated color of BC1.
+ */
+static uint8_t bc1_match5[256][2];
+static uint8_t bc1_match6[256][2];
+
+static inline unsigned
+expand5(unsigned v)
+{
+   return (v << 3) | (v >> 2);
+}
+
+static inline unsigned
+expand6(unsigned v)
+{
+   return (v << 2) | (v >> 4);
+}
+
+static void
+bc1_init_match(uint8_t match[256][2], unsigned bits)
+{
+   const unsigned max = (1 << bits) - 1;
+
+   for (unsigned v = 0; v < 256; v++) {
+      int best = INT_MAX;
+
+      for (unsigned a = 0; a <= max; a++) {
+         for (unsigned b = 0; b <= max; b++) {
+            const int ea = bits == 5 ? expand5(a) : expand6(a);
+            const int eb = bits == 5 ? expand5(b) : expand6(b);
+            /* Prefer close endpoints, decoders round differently. */
+            const int err = abs((2 * ea + eb) / 3 - (int) v) * 256 +
+                            abs(ea - eb);
+
+            if (err < best) {
+               best = err;
+               match[v][0] = a;
+               match[v][1] = b;
+            }
+         }
+      }
+   }
+}
+
+static void
+bcn_init(void)
+{
+   bcn_quality = MIN2(env_var_as_unsigned("MESA_BCN_QUALITY",
+                                          UTIL_BCN_QUALITY_NORMAL),
+                      UTIL_BCN_QUALITY_HIGH);
+
+   bc1_init_match(bc1_match5, 5);
+   bc1_init_match(bc1_match6, 6);
+}
+
+enum util_bcn_quality
+util_bcn_default_quality(void)
+{
+   call_once(&bcn_once, bcn_init);
+
+   return bcn_quality;
+}
+
+/*
+ * Endpoint fitting, shared by all formats.  Points have up to 4 dimensions
+ * and only the texels in the mask are considered.
+ */
+
+struct bcn_line {
+   float mean[4];
+   float dir[4];   /* unit length, or zero if all points are the same */
+};
+
+static void
+fit_line(const float (*p)[4], uint16_t mask, unsigned dims,
+         struct bcn_line *line)
+{
+   float cov[4][4] = { { 0 } };
+   float v[4];
+   unsigned n = 0, start = 0;
+
+   memset(line, 0, sizeof(*line));
+
+   for (unsigned i = 0; i < 16; i++) {
+      if (mask & (1 << i)) {
+         for (unsigned c = 0; c < dims; c++)
+            line->mean[c] += p[i][c];
+         n++;
+      }
+   }
+
+   if (n == 0)
+      return;
+
+   for (unsigned c = 0; c < dims; c++)
+      line->mean[c] /= n;
+
+   for (unsigned i = 0; i < 16; i++) {
+      if (mask & (1 << i)) {
+         float d[4];
+
+         for (unsigned c = 0; c < dims; c++)
+            d[c] = p[i][c] - line->mean[c];
+         for (unsigned a = 0; a < dims; a++) {
+            for (unsigned b = a; b < dims; b++)
+               cov[a][b] += d[a] * d[b];
+         }
+      }
+   }
+
+   for (unsigned a = 0; a < dims; a++) {
+      for (unsigned b = 0; b < a; b++)
+         cov[a][b] = cov[b][a];
+      if (cov[a][a] > cov[start][start])
+         start = a;
+   }
+
+   if (cov[start][start] <= 0.0f)
+      return;
+
+   /* Power iteration, from the row of the axis of largest variance */
+   for (unsigned c = 0; c < dims; c++)
+      v[c] = cov[start][c];
+
+   for (unsigned iter = 0; iter < 8; iter++) {
+      float w[4] = { 0 };
+      float max = 0.0f;
+
+      for (unsigned a = 0; a < dims; a++) {
+         for (unsigned b = 0; b < dims; b++)
+            w[a] += cov[a][b] * v[b];
+         max = MAX2(max, fabsf(w[a]));
+      }
+
+      if (max == 0.0f)
+         return;
+
+      for (unsigned c = 0; c < dims; c++)
+         v[c] = w[c] / max;
+   }
+
+   float len = 0.0f;
+   for (unsigned c = 0; c < dims; c++)
+      len += v[c] * v[c];
+   len = sqrtf(len);
+
+   for (unsigned c = 0; c < dims; c++)
+      line->dir[c] = v[c] / len;
+}
+
+/* Ends of the segment of the line covering the points, e[0] on the negative
+ * side of the direction.
+ */
+static void
+line_extent(const struct bcn_line *line, const float (*p)[4], uint16_t mask,
+            unsigned dims, float lo, float hi, float e[2][4])
+{
+   float tmin = 0.0f, tmax = 0.0f;
+
+   for (unsigned i = 0; i < 16; i++) {
+      if (mask & (1 << i)) {
+         float t = 0.0f;
+
+         for (unsigned c = 0; c < dims; c++)
+            t += (p[i][c] - line->mean[c]) * line->dir[c];
+         tmin = MIN2(tmin, t);
+         tmax = MAX2(tmax, t);
+      }
+   }
+
+   for (unsigned c = 0; c < dims; c++) {
+      e[0][c] = CLAMP(line->mean[c] + line->dir[c] * tmin, lo, hi);
+      e[1][c] = CLAMP(line->mean[c] + line->dir[c] * tmax, lo, hi);
+   }
+}
+
+/* Least squares endpoints for p[i] = e[0] * (1 - w[i]) + e[1] * w[i].
+ * Returns false if the weights do not determine them.
+ */
+static bool
+solve_endpoints(const float (*p)[4], const float *w, uint16_t mask,
+                unsigned dims, float lo, float hi, float e[2][4])
+{
+   float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+   float ax[4] = { 0 }, bx[4] = { 0 };
+
+   for (unsigned i = 0; i < 16; i++) {
+      if (mask & (1 << i)) {
+         const float wa = 1.0f - w[i], wb = w[i];
+
+         aa += wa * wa;
+         ab += wa * wb;
+         bb += wb * wb;
+         for (unsigned c = 0; c < dims; c++) {
+            ax[c] += wa * p[i][c];
+            bx[c] += wb * p[i][c];
+         }
+      }
+   }
+
+   const float det = aa * bb - ab * ab;
+   if (det < 1e-3f)
+      return false;
+
+   for (unsigned c = 0; c < dims; c++) {
+      e[0][c] = CLAMP((ax[c] * bb - bx[c] * ab) / det, lo, hi);
+      e[1][c] = CLAMP((bx[c] * aa - ax[c] * ab) / det, lo, hi);
+   }
+
+   return true;
+}
+
+static unsigned
+refine_passes(enum util_bcn_quality quality)
+{
+   return quality;
+}
+
+/*
+ * BC1 color, also the color part of BC2 and BC3.
+ */
+
+struct bc1_block {
+   uint16_t c0, c1;
+   uint32_t bits;
+   unsigned err;
+};
+
+static uint16_t
+bc1_pack565(const float c[4])
+{
+   const unsigned r = CLAMP((int) (c[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+   const unsigned g = CLAMP((int) (c[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+   const unsigned b = CLAMP((int) (c[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+
+   return (r << 11) | (g << 5) | b;
+}
+
+/* Indices for the endpoints, in the mode given by their order.  Texels out
+ * of the mask get index 3, transparent in the 3 color mode.  Index 3 is
+ * black otherwise, which the 3 color mode only uses if black_ok.
+ */
+static void
+bc1_try(const uint8_t (*px)[4], uint16_t mask, uint16_t c0, uint16_t c1,
+        bool black_ok, struct bc1_block *best)
+{
+   const bool four_colors = c0 > c1;
+   const unsigned num_colors = four_colors || black_ok ? 4 : 3;
+   int pal[4][3];
+   uint32_t bits = 0;
+   unsigned err = 0;
+
+   pal[0][0] = expand5(c0 >> 11);
+   pal[0][1] = expand6((c0 >> 5) & 0x3f);
+   pal[0][2] = expand5(c0 & 0x1f);
+   pal[1][0] = expand5(c1 >> 11);
+   pal[1][1] = expand6((c1 >> 5) & 0x3f);
+   pal[1][2] = expand5(c1 & 0x1f);
+
+   for (unsigned c = 0; c < 3; c++) {
+      if (four_colors) {
+         pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+         pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+      } else {
+         pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+         pal[3][c] = 0;
+      }
+   }
+
+   for (unsigned i = 0; i < 16 && err < best->err; i++) {
+      unsigned index = 3, min = 0;
+
+      if (mask & (1 << i)) {
+         min = UINT_MAX;
+         for (unsigned k = 0; k < num_colors; k++) {
+            const int dr = px[i][0] - pal[k][0];
+            const int dg = px[i][1] - pal[k][1];
+            const int db = px[i][2] - pal[k][2];
+            const unsigned d = dr * dr + dg * dg + db * db;
+
+            if (d < min) {
+               min = d;
+               index = k;
+            }
+         }
+      }
+
+      bits |= index << (2 * i);
+      err += min;
+   }
+
+   if (err < best->err) {
+      best->c0 = c0;
+      best->c1 = c1;
+      best->bits = bits;
+      best->err = err;
+   }
+}
+
+static void
+bc1_try_ordered(const uint8_t (*px)[4], uint16_t mask, uint16_t c0,
+                uint16_t c1, bool three_colors, bool black_ok,
+                struct bc1_block *best)
+{
+   if (three_colors ? c0 > c1 : c0 < c1)
+      bc1_try(px, mask, c1, c0, black_ok, best);
+   else
+      bc1_try(px, mask, c0, c1, black_ok, best);
+}
+
+static void
+bc1_refine(const uint8_t (*px)[4], const float (*fpx)[4], uint16_t mask,
+           bool three_colors, bool black_ok, unsigned passes,
+           struct bc1_block *best)
+{
+   static const float weights4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+   static const float weights3[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+   for (unsigned pass = 0; pass < passes && best->err > 0; pass++) {
+      const float *weights = best->c0 > best->c1 ? weights4 : weights3;
+      const unsigned prev_err = best->err;
+      uint16_t fit_mask = mask;
+      float w[16], e[2][4];
+
+      for (unsigned i = 0; i < 16; i++) {
+         const unsigned index = (best->bits >> (2 * i)) & 3;
+
+         /* Black or transparent texels do not depend on the endpoints. */
+         if (index == 3 && weights == weights3)
+            fit_mask &= ~(1 << i);
+         w[i] = weights[index];
+      }
+
+      if (!solve_endpoints(fpx, w, fit_mask, 3, 0.0f, 255.0f, e))
+         break;
+
+      bc1_try_ordered(px, mask, bc1_pack565(e[0]), bc1_pack565(e[1]),
+                      three_colors, black_ok, best);
+      if (best->err == prev_err)
+         break;
+   }
+}
+
+static void
+bc1_encode_color(uint8_t *dst, const uint8_t (*px)[4],
+                 enum util_bcn_quality quality, bool is_bc1, bool has_alpha)
+{
+   struct bc1_block best = { .err = UINT_MAX };
+   const bool black_ok = is_bc1 && !has_alpha;
+   uint16_t mask = 0xffff;
+   bool solid = true;
+
+   if (is_bc1 && has_alpha) {
+      for (unsigned i = 0; i < 16; i++) {
+         if (px[i][3] < 128)
+            mask &= ~(1 << i);
+      }
+   }
+
+   const bool transparent = mask != 0xffff;
+
+   if (mask == 0) {
+      best.bits = 0xffffffff;
+   } else {
+      const unsigned first = ffs(mask) - 1;
+
+      for (unsigned i = 0; i < 16; i++) {
+         if ((mask & (1 << i)) &&
+             (px[i][0] != px[first][0] || px[i][1] != px[first][1] ||
+              px[i][2] != px[first][2]))
+            solid = false;
+      }
+
+      if (solid && !transparent) {
+         const uint8_t *c = px[first];
+
+         bc1_try_ordered(px, mask,
+                         (bc1_match5[c[0]][0] << 11) |
+                         (bc1_match6[c[1]][0] << 5) | bc1_match5[c[2]][0],
+                         (bc1_match5[c[0]][1] << 11) |
+                         (bc1_match6[c[1]][1] << 5) | bc1_match5[c[2]][1],
+                         false, black_ok, &best);
+      } else {
+         struct bcn_line line;
+         float fpx[16][4], e[2][4];
+
+         for (unsigned i = 0; i < 16; i++) {
+            for (unsigned c = 0; c < 3; c++)
+               fpx[i][c] = px[i][c];
+         }
+
+         fit_line(fpx, mask, 3, &line);
+         line_extent(&line, fpx, mask, 3, 0.0f, 255.0f, e);
+
+         bc1_try_ordered(px, mask, bc1_pack565(e[1]), bc1_pack565(e[0]),
+                         transparent, black_ok, &best);
+         bc1_refine(px, fpx, mask, transparent, black_ok,
+                    refine_passes(quality), &best);
+
+         /* The 3 color mode only pays off now and then. */
+         if (quality == UTIL_BCN_QUALITY_HIGH && is_bc1 && !transparent &&
+             best.err > 0) {
+            bc1_try_ordered(px, mask, best.c0, best.c1, true, black_ok,
+                            &best);
+            if (best.c0 <= best.c1)
+               bc1_refine(px, fpx, mask, true, black_ok, 1, &best);
+         }
+      }
+   }
+
+   dst[0] = best.c0 & 0xff;
+   dst[1] = best.c0 >> 8;
+   dst[2] = best.c1 & 0xff;
+   dst[3] = best.c1 >> 8;
+   dst[4] = best.bits & 0xff;
+   dst[5] = (best.bits >> 8) & 0xff;
+   dst[6] = (best.bits >> 16) & 0xff;
+   dst[7] = best.bits >> 24;
+}
+
+static void
+bc2_encode_alpha(uint8_t *dst, const uint8_t (*px)[4])
+{
+   for (unsigned i = 0; i < 8; i++) {
+      dst[i] = (px[2 * i][3] + 8) / 17 |
+               ((px[2 * i + 1][3] + 8) / 17) << 4;
+   }
+}
+
+/*
+ * BC4 channel, also the alpha of BC3 and the channels of BC5.
+ */
+
+struct bc4_block {
+   int a0, a1;
+   uint64_t bits;
+   unsigned err;
+};
+
+static void
+bc4_try(const int *v, int a0, int a1, int t_min, int t_max,
+        struct bc4_block *best)
+{
+   int pal[8];
+   uint64_t bits = 0;
+   unsigned err = 0;
+
+   pal[0] = a0;
+   pal[1] = a1;
+   if (a0 > a1) {
+      for (int k = 2; k < 8; k++)
+         pal[k] = (a0 * (8 - k) + a1 * (k - 1)) / 7;
+   } else {
+      for (int k = 2; k < 6; k++)
+         pal[k] = (a0 * (6 - k) + a1 * (k - 1)) / 5;
+      pal[6] = t_min;
+      pal[7] = t_max;
+   }
+
+   for (unsigned i = 0; i < 16 && err < best->err; i++) {
+      unsigned index = 0, min = UINT_MAX;
+
+      for (unsigned k = 0; k < 8; k++) {
+         const unsigned d = abs(v[i] - pal[k]);
+
+         if (d < min) {
+            min = d;
+            index = k;
+         }
+      }
+
+      bits |= (uint64_t) index << (3 * i);
+      err += min * min;
+   }
+
+   if (err < best->err) {
+      best->a0 = a0;
+      best->a1 = a1;
+      best->bits = bits;
+      best->err = err;
+   }
+}
+
+static void
+bc4_encode(uint8_t *dst, const int *v, bool is_signed,
+           enum util_bcn_quality quality)
+{
+   const int t_min = is_signed ? -128 : 0;
+   const int t_max = is_signed ? 127 : 255;
+   struct bc4_block best = { .err = UINT_MAX };
+   int min = t_max, max = t_min;
+   int inner_min = t_max, inner_max = t_min;
+
+   for (unsigned i = 0; i < 16; i++) {
+      min = MIN2(min, v[i]);
+      max = MAX2(max, v[i]);
+      if (v[i] != t_min && v[i] != t_max) {
+         inner_min = MIN2(inner_min, v[i]);
+         inner_max = MAX2(inner_max, v[i]);
+      }
+   }
+
+   /* 8 interpolated values */
+   bc4_try(v, max, min, t_min, t_max, &best);
+
+   if (min != max) {
+      float fv[16][4], w[16], e[2][4];
+
+      for (unsigned i = 0; i < 16; i++)
+         fv[i][0] = v[i];
+
+      for (unsigned pass = 0; pass < refine_passes(quality) && best.err > 0;
+           pass++) {
+         const unsigned prev_err = best.err;
+
+         if (best.a0 <= best.a1)
+            break;
+
+         for (unsigned i = 0; i < 16; i++) {
+            const unsigned index = (best.bits >> (3 * i)) & 7;
+
+            w[i] = index <= 1 ? index : (index - 1) / 7.0f;
+         }
+
+         if (!solve_endpoints(fv, w, 0xffff, 1, t_min, t_max, e))
+            break;
+
+         const int a0 = lroundf(e[0][0]), a1 = lroundf(e[1][0]);
+         if (a0 == a1)
+            break;
+
+         bc4_try(v, MAX2(a0, a1), MIN2(a0, a1), t_min, t_max, &best);
+         if (best.err == prev_err)
+            break;
+      }
+
+      /* 6 interpolated values plus both extremes */
+      if (best.err > 0 &&
+          (quality > UTIL_BCN_QUALITY_FAST || min == t_min || max == t_max)) {
+         if (inner_min > inner_max)
+            bc4_try(v, t_min, t_min, t_min, t_max, &best);
+         else
+            bc4_try(v, inner_min, inner_max, t_min, t_max, &best);
+      }
+   }
+
+   dst[0] = best.a0;
+   dst[1] = best.a1;
+   for (unsigned i = 0; i < 6; i++)
+      dst[2 + i] = (best.bits >> (8 * i)) & 0xff;
+}
+
+/*
+ * BPTC
+ */
+
+static const uint8_t bptc_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t bptc_weights4[16] =
+   { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/* 2 bits per texel, the subset of each texel for the 2 subset modes */
+static const uint32_t bptc_partitions2[64] = {
+   0x50505050U, 0x40404040U, 0x54545454U, 0x54505040U,
+   0x50404000U, 0x55545450U, 0x55545040U, 0x54504000U,
+   0x50400000U, 0x55555450U, 0x55544000U, 0x54400000U,
+   0x55555440U, 0x55550000U, 0x55555500U, 0x55000000U,
+   0x55150100U, 0x00004054U, 0x15010000U, 0x00405054U,
+   0x00004050U, 0x15050100U, 0x05010000U, 0x40505054U,
+   0x00404050U, 0x05010100U, 0x14141414U, 0x05141450U,
+   0x01155440U, 0x00555500U, 0x15014054U, 0x05414150U,
+   0x44444444U, 0x55005500U, 0x11441144U, 0x05055050U,
+   0x05500550U, 0x11114444U, 0x41144114U, 0x44111144U,
+   0x15055054U, 0x01055040U, 0x05041050U, 0x05455150U,
+   0x14414114U, 0x50050550U, 0x41411414U, 0x00141400U,
+   0x00041504U, 0x00105410U, 0x10541000U, 0x04150400U,
+   0x50410514U, 0x41051450U, 0x05415014U, 0x14054150U,
+   0x41050514U, 0x41505014U, 0x40011554U, 0x54150140U,
+   0x50505500U, 0x00555050U, 0x15151010U, 0x54540404U,
+};
+
+/* Anchor texel of the second subset of the 2 subset modes */
+static const uint8_t bptc_anchors2[64] = {
+   15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+   15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+   15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+    6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+struct bptc_bits {
+   uint64_t q[2];
+   unsigned pos;
+};
+
+static inline void
+bptc_put(struct bptc_bits *b, unsigned n, uint64_t value)
+{
+   const unsigned word = b->pos / 64, shift = b->pos % 64;
+
+   value &= (UINT64_C(1) << n) - 1;
+   b->q[word] |= value << shift;
+   if (shift + n > 64)
+      b->q[word + 1] |= value >> (64 - shift);
+   b->pos += n;
+}
+
+static void
+bptc_store(uint8_t *dst, const struct bptc_bits *b)
+{
+   for (unsigned i = 0; i < 16; i++)
+      dst[i] = (b->q[i / 8] >> (8 * (i % 8))) & 0xff;
+}
+
+static inline int
+bptc_interpolate(int a, int b, int weight)
+{
+   return ((64 - weight) * a + weight * b + 32) >> 6;
+}
+
+/* BC7 mode 6: one subset, RGBA 7.7.7.7 with a p-bit per endpoint and 4-bit
+ * indices.
+ */
+struct bc7_mode6 {
+   uint8_t q[2][4];
+   uint8_t p[2];
+   uint8_t index[16];
+   unsigned err;
+};
+
+static void
+bc7_mode6_try(const uint8_t (*px)[4], const float e[2][4],
+              struct bc7_mode6 *best)
+{
+   struct bc7_mode6 c;
+   int ep[2][4], pal[16][4];
+
+   for (unsigned j = 0; j < 2; j++) {
+      unsigned best_err = UINT_MAX;
+
+      for (unsigned p = 0; p < 2; p++) {
+         unsigned err = 0;
+         uint8_t q[4];
+
+         for (unsigned ch = 0; ch < 4; ch++) {
+            q[ch] = CLAMP((int) ((e[j][ch] - p) * 0.5f + 0.5f), 0, 127);
+            const int d = (q[ch] << 1 | p) - (int) (e[j][ch] + 0.5f);
+            err += d * d;
+         }
+
+         if (err < best_err) {
+            best_err = err;
+            c.p[j] = p;
+            memcpy(c.q[j], q, sizeof(q));
+         }
+      }
+
+      for (unsigned ch = 0; ch < 4; ch++)
+         ep[j][ch] = c.q[j][ch] << 1 | c.p[j];
+   }
+
+   for (unsigned k = 0; k < 16; k++) {
+      for (unsigned ch = 0; ch < 4; ch++)
+         pal[k][ch] = bptc_interpolate(ep[0][ch], ep[1][ch], bptc_weights4[k]);
+   }
+
+   /* The palette is close to evenly spaced, so only the entries next to the
+    * projection of the texel on the segment are worth a look.
+    */
+   int dir[4], len2 = 0;
+   for (unsigned ch = 0; ch < 4; ch++) {
+      dir[ch] = ep[1][ch] - ep[0][ch];
+      len2 += dir[ch] * dir[ch];
+   }
+
+   c.err = 0;
+   for (unsigned i = 0; i < 16 && c.err < best->err; i++) {
+      unsigned min = UINT_MAX;
+      int t = 0;
+
+      for (unsigned ch = 0; ch < 4; ch++)
+         t += (px[i][ch] - ep[0][ch]) * dir[ch];
+
+      const int k0 = len2 ? (CLAMP(t, 0, len2) * 15 + len2 / 2) / len2 : 0;
+
+      for (int k = MAX2(k0 - 1, 0); k <= MIN2(k0 + 1, 15); k++) {
+         unsigned d = 0;
+
+         for (unsigned ch = 0; ch < 4; ch++) {
+            const int dc = px[i][ch] - pal[k][ch];
+            d += dc * dc;
+         }
+         if (d < min) {
+            min = d;
+            c.index[i] = k;
+         }
+      }
+      c.err += min;
+   }
+
+   if (c.err < best->err)
+      *best = c;
+}
+
+static void
+bc7_mode6_encode(const uint8_t (*px)[4], const float (*fpx)[4],
+                 enum util_bcn_quality quality, struct bc7_mode6 *best)
+{
+   struct bcn_line line;
+   float e[2][4], w[16];
+
+   fit_line(fpx, 0xffff, 4, &line);
+   line_extent(&line, fpx, 0xffff, 4, 0.0f, 255.0f, e);
+   bc7_mode6_try(px, e, best);
+
+   for (unsigned pass = 0; pass < refine_passes(quality) && best->err > 0;
+        pass++) {
+      const unsigned prev_err = best->err;
+
+      for (unsigned i = 0; i < 16; i++)
+         w[i] = bptc_weights4[best->index[i]] / 64.0f;
+
+      if (!solve_endpoints(fpx, w, 0xffff, 4, 0.0f, 255.0f, e))
+         break;
+
+      bc7_mode6_try(px, e, best);
+      if (best->err == prev_err)
+         break;
+   }
+}
+
+static void
+bc7_mode6_store(uint8_t *dst, struct bc7_mode6 *m)
+{
+   struct bptc_bits b = { { 0, 0 }, 0 };
+
+   /* The MSB of the index of texel 0 is implicitly 0. */
+   if (m->index[0] & 8) {
+      for (unsigned ch = 0; ch < 4; ch++) {
+         const uint8_t t = m->q[0][ch];
+         m->q[0][ch] = m->q[1][ch];
+         m->q[1][ch] = t;
+      }
+      const uint8_t t = m->p[0];
+      m->p[0] = m->p[1];
+      m->p[1] = t;
+      for (unsigned i = 0; i < 16; i++)
+         m->index[i] = 15 - m->index[i];
+   }
+
+   bptc_put(&b, 7, 1 << 6);
+   for (unsigned ch = 0; ch < 4; ch++) {
+      bptc_put(&b, 7, m->q[0][ch]);
+      bptc_put(&b, 7, m->q[1][ch]);
+   }
+   bptc_put(&b, 1, m->p[0]);
+   bptc_put(&b, 1, m->p[1]);
+   for (unsigned i = 0; i < 16; i++)
+      bptc_put(&b, i == 0 ? 3 : 4, m->index[i]);
+
+   bptc_store(dst, &b);
+}
+
+/* BC7 mode 1: two subsets, RGB 6.6.6 with a p-bit per subset and 3-bit
+ * indices.  Alpha is always opaque.
+ */
+struct bc7_subset {
+   uint8_t q[2][3];
+   uint8_t p;
+   uint8_t index[16];
+   unsigned err;
+};
+
+static void
+bc7_mode1_try(const uint8_t (*px)[4], uint16_t mask, const float e[2][4],
+              struct bc7_subset *best)
+{
+   struct bc7_subset c;
+   unsigned best_err = UINT_MAX;
+   int ep[2][3], pal[8][3];
+
+   for (unsigned p = 0; p < 2; p++) {
+      unsigned err = 0;
+      uint8_t q[2][3];
+
+      for (unsigned j = 0; j < 2; j++) {
+         for (unsigned ch = 0; ch < 3; ch++) {
+            const int target = e[j][ch] + 0.5f;
+            const int guess = CLAMP(target >> 2, 0, 63);
+            int min = INT_MAX;
+
+            for (int g = MAX2(guess - 1, 0); g <= MIN2(guess + 1, 63); g++) {
+               const unsigned v = g << 1 | p;
+               const int d = abs((int) (v << 1 | v >> 6) - target);
+
+               if (d < min) {
+                  min = d;
+                  q[j][ch] = g;
+               }
+            }
+            err += min * min;
+         }
+      }
+
+      if (err < best_err) {
+         best_err = err;
+         c.p = p;
+         memcpy(c.q, q, sizeof(q));
+      }
+   }
+
+   for (unsigned j = 0; j < 2; j++) {
+      for (unsigned ch = 0; ch < 3; ch++) {
+         const unsigned v = c.q[j][ch] << 1 | c.p;
+         ep[j][ch] = v << 1 | v >> 6;
+      }
+   }
+
+   for (unsigned k = 0; k < 8; k++) {
+      for (unsigned ch = 0; ch < 3; ch++)
+         pal[k][ch] = bptc_interpolate(ep[0][ch], ep[1][ch], bptc_weights3[k]);
+   }
+
+   c.err = 0;
+   for (unsigned i = 0; i < 16 && c.err < best->err; i++) {
+      if (!(mask & (1 << i)))
+         continue;
+
+      unsigned min = UINT_MAX;
+      for (unsigned k = 0; k < 8; k++) {
+         unsigned d = 0;
+
+         for (unsigned ch = 0; ch < 3; ch++) {
+            const int dc = px[i][ch] - pal[k][ch];
+            d += dc * dc;
+         }
+         if (d < min) {
+            min = d;
+            c.index[i] = k;
+         }
+      }
+      c.err += min;
+   }
+
+   if (c.err < best->err)
+      *best = c;
+}
+
+static void
+bc7_mode1_subset(const uint8_t (*px)[4], const float (*fpx)[4], uint16_t mask,
+                 enum util_bcn_quality quality, struct bc7_subset *best)
+{
+   struct bcn_line line;
+   float e[2][4], w[16];
+
+   best->err = UINT_MAX;
+
+   fit_line(fpx, mask, 3, &line);
+   line_extent(&line, fpx, mask, 3, 0.0f, 255.0f, e);
+   bc7_mode1_try(px, mask, e, best);
+
+   for (unsigned pass = 0; pass < refine_passes(quality) && best->err > 0;
+        pass++) {
+      const unsigned prev_err = best->err;
+
+      for (unsigned i = 0; i < 16; i++)
+         w[i] = bptc_weights3[best->index[i]] / 64.0f;
+
+      if (!solve_endpoints(fpx, w, mask, 3, 0.0f, 255.0f, e))
+         break;
+
+      bc7_mode1_try(px, mask, e, best);
+      if (best->err == prev_err)
+         break;
+   }
+}
+
+/* Error left by fitting a line through each subset, the sum of all but the
+ * largest eigenvalue of their covariance.
+ */
+static float
+bc7_partition_estimate(const float (*fpx)[4], uint32_t partition)
+{
+   float sum[2][3] = { { 0 } }, prod[2][6] = { { 0 } };
+   unsigned n[2] = { 0, 0 };
+   float total = 0.0f;
+
+   for (unsigned i = 0; i < 16; i++) {
+      const unsigned s = (partition >> (2 * i)) & 3;
+      const float *p = fpx[i];
+
+      n[s]++;
+      sum[s][0] += p[0];
+      sum[s][1] += p[1];
+      sum[s][2] += p[2];
+      prod[s][0] += p[0] * p[0];
+      prod[s][1] += p[0] * p[1];
+      prod[s][2] += p[0] * p[2];
+      prod[s][3] += p[1] * p[1];
+      prod[s][4] += p[1] * p[2];
+      prod[s][5] += p[2] * p[2];
+   }
+
+   for (unsigned s = 0; s < 2; s++) {
+      const float inv = 1.0f / n[s];
+      float cov[3][3], v[3] = { 1.0f, 1.0f, 1.0f }, w[3];
+
+      cov[0][0] = prod[s][0] - sum[s][0] * sum[s][0] * inv;
+      cov[0][1] = cov[1][0] = prod[s][1] - sum[s][0] * sum[s][1] * inv;
+      cov[0][2] = cov[2][0] = prod[s][2] - sum[s][0] * sum[s][2] * inv;
+      cov[1][1] = prod[s][3] - sum[s][1] * sum[s][1] * inv;
+      cov[1][2] = cov[2][1] = prod[s][4] - sum[s][1] * sum[s][2] * inv;
+      cov[2][2] = prod[s][5] - sum[s][2] * sum[s][2] * inv;
+
+      total += cov[0][0] + cov[1][1] + cov[2][2];
+
+      for (unsigned iter = 0; iter < 4; iter++) {
+         for (unsigned a = 0; a < 3; a++)
+            w[a] = cov[a][0] * v[0] + cov[a][1] * v[1] + cov[a][2] * v[2];
+
+         const float max = MAX3(fabsf(w[0]), fabsf(w[1]), fabsf(w[2]));
+         if (max == 0.0f)
+            break;
+         for (unsigned a = 0; a < 3; a++)
+            v[a] = w[a] / max;
+      }
+
+      /* Rayleigh quotient, the largest eigenvalue once v has converged */
+      for (unsigned a = 0; a < 3; a++)
+         w[a] = cov[a][0] * v[0] + cov[a][1] * v[1] + cov[a][2] * v[2];
+      const float vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+      if (vv > 0.0f)
+         total -= (v[0] * w[0] + v[1] * w[1] + v[2] * w[2]) / vv;
+   }
+
+   return total;
+}
+
+#define BC7_MAX_PARTITIONS 8
+
+static bool
+bc7_mode1_encode(uint8_t *dst, const uint8_t (*px)[4], const float (*fpx)[4],
+                 enum util_bcn_quality quality, unsigned max_err)
+{
+   const unsigned num_tries =
+      quality == UTIL_BCN_QUALITY_HIGH ? BC7_MAX_PARTITIONS : 2;
+   unsigned tries[BC7_MAX_PARTITIONS];
+   float estimates[BC7_MAX_PARTITIONS];
+   unsigned num_sorted = 0;
+
+   /* Keep the partitions with the lowest estimates, sorted. */
+   for (unsigned p = 0; p < 64; p++) {
+      const float estimate = bc7_partition_estimate(fpx, bptc_partitions2[p]);
+      unsigned pos = num_sorted;
+
+      while (pos > 0 && estimates[pos - 1] > estimate)
+         pos--;
+      if (pos >= num_tries)
+         continue;
+
+      for (unsigned i = MIN2(num_sorted, num_tries - 1); i > pos; i--) {
+         estimates[i] = estimates[i - 1];
+         tries[i] = tries[i - 1];
+      }
+      estimates[pos] = estimate;
+      tries[pos] = p;
+      num_sorted = MIN2(num_sorted + 1, num_tries);
+   }
+
+   struct bc7_subset best[2];
+   unsigned best_partition = 0, best_err = max_err;
+
+   for (unsigned t = 0; t < num_sorted; t++) {
+      const uint32_t partition = bptc_partitions2[tries[t]];
+      struct bc7_subset subsets[2];
+      uint16_t masks[2] = { 0, 0 };
+
+      for (unsigned i = 0; i < 16; i++)
+         masks[(partition >> (2 * i)) & 1] |= 1 << i;
+
+      bc7_mode1_subset(px, fpx, masks[0], quality, &subsets[0]);
+      if (subsets[0].err >= best_err)
+         continue;
+      bc7_mode1_subset(px, fpx, masks[1], quality, &subsets[1]);
+
+      if (subsets[0].err + subsets[1].err < best_err) {
+         best_err = subsets[0].err + subsets[1].err;
+         best_partition = tries[t];
+         memcpy(best, subsets, sizeof(best));
+      }
+   }
+
+   if (best_err >= max_err)
+      return false;
+
+   const uint32_t partition = bptc_partitions2[best_partition];
+   const unsigned anchors[2] = { 0, bptc_anchors2[best_partition] };
+   uint8_t index[16];
+
+   /* The MSB of the index of the anchor texels is implicitly 0. */
+   for (unsigned s = 0; s < 2; s++) {
+      if (best[s].index[anchors[s]] & 4) {
+         for (unsigned ch = 0; ch < 3; ch++) {
+            const uint8_t t = best[s].q[0][ch];
+            best[s].q[0][ch] = best[s].q[1][ch];
+            best[s].q[1][ch] = t;
+         }
+         for (unsigned i = 0; i < 16; i++)
+            best[s].index[i] = 7 - best[s].index[i];
+      }
+   }
+
+   for (unsigned i = 0; i < 16; i++)
+      index[i] = best[(partition >> (2 * i)) & 1].index[i];
+
+   struct bptc_bits b = { { 0, 0 }, 0 };
+
+   bptc_put(&b, 2, 1 << 1);
+   bptc_put(&b, 6, best_partition);
+   for (unsigned ch = 0; ch < 3; ch++) {
+      for (unsigned s = 0; s < 2; s++) {
+         bptc_put(&b, 6, best[s].q[0][ch]);
+         bptc_put(&b, 6, best[s].q[1][ch]);
+      }
+   }
+   bptc_put(&b, 1, best[0].p);
+   bptc_put(&b, 1, best[1].p);
+   for (unsigned i = 0; i < 16; i++)
+      bptc_put(&b, i == anchors[0] || i == anchors[1] ? 2 : 3, index[i]);
+
+   bptc_store(dst, &b);
+
+   return true;
+}
+
+static void
+bc7_encode(uint8_t *dst, const uint8_t (*px)[4], enum util_bcn_quality quality)
+{
+   struct bc7_mode6 mode6 = { .err = UINT_MAX };
+   float fpx[16][4];
+   bool opaque = true;
+
+   for (unsigned i = 0; i < 16; i++) {
+      for (unsigned ch = 0; ch < 4; ch++)
+         fpx[i][ch] = px[i][ch];
+      opaque &= px[i][3] == 255;
+   }
+
+   bc7_mode6_encode(px, fpx, quality, &mode6);
+
+   if (quality > UTIL_BCN_QUALITY_FAST && opaque && mode6.err > 0 &&
+       bc7_mode1_encode(dst, px, fpx, quality, mode6.err))
+      return;
+
+   bc7_mode6_store(dst, &mode6);
+}
+
+/* BC6H modes 11 and 12: one subset with 4-bit indices, endpoints of 10 bits
+ * or of 11 bits with the second one a 9 bit delta.
+ *
+ * Colors are compared as half float bit patterns, negated for negative
+ * values, so the error is close to relative.
+ */
+struct bc6h_block {
+   int q[2][3];
+   uint8_t index[16];
+   unsigned bits;
+   uint64_t err;
+};
+
+static int
+bc6h_from_float(float f, bool is_signed)
+{
+   if (isnan(f))
+      return 0;
+
+   const uint16_t h = _mesa_float_to_half(f);
+   const int mag = MIN2(h & 0x7fff, 0x7bff);
+
+   if (h & 0x8000)
+      return is_signed ? -mag : 0;
+   return mag;
+}
+
+static int
+bc6h_unquantize(int q, unsigned bits, bool is_signed)
+{
+   if (q == 0)
+      return 0;
+
+   if (is_signed) {
+      int mag = abs(q);
+
+      if (mag >= (1 << (bits - 1)) - 1)
+         mag = 0x7fff;
+      else
+         mag = ((mag << 15) + 0x4000) >> (bits - 1);
+      return q < 0 ? -mag : mag;
+   }
+
+   if (q == (1 << bits) - 1)
+      return 0xffff;
+   return ((q << 15) + 0x4000) >> (bits - 1);
+}
+
+static int
+bc6h_finish(int v, bool is_signed)
+{
+   if (!is_signed)
+      return v * 31 / 64;
+   return v < 0 ? -(-v * 31 / 32) : v * 31 / 32;
+}
+
+static int
+bc6h_quantize(float x, unsigned bits, bool is_signed)
+{
+   const int target = lroundf(x);
+   const int max = is_signed ? (1 << (bits - 1)) - 1 : (1 << bits) - 1;
+   const int min = is_signed ? -max : 0;
+   const float scale = (is_signed ? 32.0f : 64.0f) / 31.0f / (1 << (16 - bits));
+   const int guess = lroundf(x * scale);
+   int best = 0, best_d = INT_MAX;
+
+   for (int q = MAX2(guess - 1, min); q <= MIN2(guess + 1, max); q++) {
+      const int d =
+         abs(bc6h_finish(bc6h_unquantize(q, bits, is_signed), is_signed) -
+             target);
+
+      if (d < best_d) {
+         best_d = d;
+         best = q;
+      }
+   }
+
+   return best;
+}
+
+static void
+bc6h_try(const int (*x)[3], const float e[2][4], unsigned bits, bool is_signed,
+         struct bc6h_block *best)
+{
+   struct bc6h_block c;
+   int pal[16][3];
+
+   c.bits = bits;
+   for (unsigned ch = 0; ch < 3; ch++) {
+      int u[2];
+
+      c.q[0][ch] = bc6h_quantize(e[0][ch], bits, is_signed);
+      c.q[1][ch] = bc6h_quantize(e[1][ch], bits, is_signed);
+
+      /* Mode 12 stores the second endpoint as a delta, which has to stay in
+       * range once the endpoints are swapped for the anchor texel.
+       */
+      if (bits == 11)
+         c.q[1][ch] = c.q[0][ch] + CLAMP(c.q[1][ch] - c.q[0][ch], -255, 255);
+
+      u[0] = bc6h_unquantize(c.q[0][ch], bits, is_signed);
+      u[1] = bc6h_unquantize(c.q[1][ch], bits, is_signed);
+      for (unsigned k = 0; k < 16; k++) {
+         pal[k][ch] = bc6h_finish(bptc_interpolate(u[0], u[1],
+                                                   bptc_weights4[k]),
+                                  is_signed);
+      }
+   }
+
+   /* As for BC7 mode 6, search around the projection on the segment. */
+   int64_t dir[3], len2 = 0;
+   for (unsigned ch = 0; ch < 3; ch++) {
+      dir[ch] = pal[15][ch] - pal[0][ch];
+      len2 += dir[ch] * dir[ch];
+   }
+
+   c.err = 0;
+   for (unsigned i = 0; i < 16 && c.err < best->err; i++) {
+      uint64_t min = UINT64_MAX;
+      int64_t t = 0;
+
+      for (unsigned ch = 0; ch < 3; ch++)
+         t += (x[i][ch] - pal[0][ch]) * dir[ch];
+
+      const int k0 = len2 ? (CLAMP(t, 0, len2) * 15 + len2 / 2) / len2 : 0;
+
+      for (int k = MAX2(k0 - 1, 0); k <= MIN2(k0 + 1, 15); k++) {
+         uint64_t d = 0;
+
+         for (unsigned ch = 0; ch < 3; ch++) {
+            const int64_t dc = x[i][ch] - pal[k][ch];
+            d += dc * dc;
+         }
+         if (d < min) {
+            min = d;
+            c.index[i] = k;
+         }
+      }
+      c.err += min;
+   }
+
+   if (c.err < best->err)
+      *best = c;
+}
+
+static void
+bc6h_fit(const int (*x)[3], const float (*fx)[4], const float e0[2][4],
+         unsigned bits, bool is_signed, enum util_bcn_quality quality,
+         struct bc6h_block *best)
+{
+   const float lo = is_signed ? -0x7bff : 0, hi = 0x7bff;
+   float e[2][4], w[16];
+
+   bc6h_try(x, e0, bits, is_signed, best);
+
+   for (unsigned pass = 0; pass < refine_passes(quality) && best->err > 0;
+        pass++) {
+      const uint64_t prev_err = best->err;
+
+      if (best->bits != bits)
+         break;
+
+      for (unsigned i = 0; i < 16; i++)
+         w[i] = bptc_weights4[best->index[i]] / 64.0f;
+
+      if (!solve_endpoints(fx, w, 0xffff, 3, lo, hi, e))
+         break;
+
+      bc6h_try(x, e, bits, is_signed, best);
+      if (best->err == prev_err)
+         break;
+   }
+}
+
+static void
+bc6h_encode(uint8_t *dst, const float (*px)[4], bool is_signed,
+            enum util_bcn_quality quality)
+{
+   struct bc6h_block best = { .err = UINT64_MAX };
+   struct bcn_line line;
+   float fx[16][4], e[2][4];
+   int x[16][3];
+
+   for (unsigned i = 0; i < 16; i++) {
+      for (unsigned ch = 0; ch < 3; ch++) {
+         x[i][ch] = bc6h_from_float(px[i][ch], is_signed);
+         fx[i][ch] = x[i][ch];
+      }
+   }
+
+   fit_line(fx, 0xffff, 3, &line);
+   line_extent(&line, fx, 0xffff, 3, is_signed ? -0x7bff : 0, 0x7bff, e);
+
+   bc6h_fit(x, fx, e, 10, is_signed, quality, &best);
+   if (quality > UTIL_BCN_QUALITY_FAST && best.err > 0)
+      bc6h_fit(x, fx, e, 11, is_signed, quality, &best);
+
+   /* The MSB of the index of texel 0 is implicitly 0. */
+   if (best.index[0] & 8) {
+      for (unsigned ch = 0; ch < 3; ch++) {
+         const int t = best.q[0][ch];
+         best.q[0][ch] = best.q[1][ch];
+         best.q[1][ch] = t;
+      }
+      for (unsigned i = 0; i < 16; i++)
+         best.index[i] = 15 - best.index[i];
+   }
+
+   struct bptc_bits b = { { 0, 0 }, 0 };
+
+   if (best.bits == 10) {
+      bptc_put(&b, 5, 0x03);
+      for (unsigned j = 0; j < 2; j++) {
+         for (unsigned ch = 0; ch < 3; ch++)
+            bptc_put(&b, 10, best.q[j][ch]);
+      }
+   } else {
+      bptc_put(&b, 5, 0x07);
+      for (unsigned ch = 0; ch < 3; ch++)
+         bptc_put(&b, 10, best.q[0][ch]);
+      for (unsigned ch = 0; ch < 3; ch++) {
+         bptc_put(&b, 9, best.q[1][ch] - best.q[0][ch]);
+         bptc_put(&b, 1, best.q[0][ch] >> 10);
+      }
+   }
+
+   for (unsigned i = 0; i < 16; i++)
+      bptc_put(&b, i == 0 ? 3 : 4, best.index[i]);
+
+   bptc_store(dst, &b);
+}
+
+/*
+ * Images
+ */
+
+struct bcn_compress_job {
+   enum util_bcn_format format;
+   enum util_bcn_quality quality;
+   unsigned width, height;
+   const uint8_t *src;
+   unsigned src_comps;
+   ptrdiff_t src_stride;
+   uint8_t *dst;
+   ptrdiff_t dst_stride;
+};
+
+static void
+fetch_block_8bit(const struct bcn_compress_job *job, unsigned bx, unsigned by,
+                 uint8_t px[16][4])
+{
+   const unsigned comps = job->src_comps;
+
+   for (unsigned y = 0; y < 4; y++) {
+      const uint8_t *row =
+         job->src + MIN2(4 * by + y, job->height - 1) * job->src_stride;
+
+      for (unsigned x = 0; x < 4; x++) {
+         const uint8_t *p = row + MIN2(4 * bx + x, job->width - 1) * comps;
+         uint8_t *t = px[4 * y + x];
+
+         t[0] = p[0];
+         t[1] = comps > 1 ? p[1] : 0;
+         t[2] = comps > 2 ? p[2] : 0;
+         t[3] = comps > 3 ? p[3] : 255;
+      }
+   }
+}
+
+static void
+fetch_block_float(const struct bcn_compress_job *job, unsigned bx,
+                  unsigned by, float px[16][4])
+{
+   const unsigned comps = job->src_comps;
+
+   for (unsigned y = 0; y < 4; y++) {
+      const float *row = (const float *)
+         (job->src + MIN2(4 * by + y, job->height - 1) * job->src_stride);
+
+      for (unsigned x = 0; x < 4; x++) {
+         const float *p = row + MIN2(4 * bx + x, job->width - 1) * comps;
+         float *t = px[4 * y + x];
+
+         t[0] = p[0];
+         t[1] = comps > 1 ? p[1] : 0.0f;
+         t[2] = comps > 2 ? p[2] : 0.0f;
+         t[3] = 1.0f;
+      }
+   }
+}
+
+static void
+compress_block(const struct bcn_compress_job *job, unsigned bx, unsigned by,
+               uint8_t *dst)
+{
+   const enum util_bcn_quality quality = job->quality;
+   const bool is_signed = job->format == UTIL_BCN_BC4_SNORM ||
+                          job->format == UTIL_BCN_BC5_SNORM ||
+                          job->format == UTIL_BCN_BC6H_SFLOAT;
+   uint8_t px[16][4];
+   int v[16];
+
+   if (job->format == UTIL_BCN_BC6H_UFLOAT ||
+       job->format == UTIL_BCN_BC6H_SFLOAT) {
+      float fpx[16][4];
+
+      fetch_block_float(job, bx, by, fpx);
+      bc6h_encode(dst, fpx, is_signed, quality);
+      return;
+   }
+
+   fetch_block_8bit(job, bx, by, px);
+
+   switch (job->format) {
+   case UTIL_BCN_BC1_RGB:
+      bc1_encode_color(dst, px, quality, true, false);
+      break;
+   case UTIL_BCN_BC1_RGBA:
+      bc1_encode_color(dst, px, quality, true, true);
+      break;
+   case UTIL_BCN_BC2:
+      bc2_encode_alpha(dst, px);
+      bc1_encode_color(dst + 8, px, quality, false, false);
+      break;
+   case UTIL_BCN_BC3:
+      for (unsigned i = 0; i < 16; i++)
+         v[i] = px[i][3];
+      bc4_encode(dst, v, false, quality);
+      bc1_encode_color(dst + 8, px, quality, false, false);
+      break;
+   case UTIL_BCN_BC4_UNORM:
+   case UTIL_BCN_BC4_SNORM:
+   case UTIL_BCN_BC5_UNORM:
+   case UTIL_BCN_BC5_SNORM: {
+      const unsigned num_channels =
+         job->format == UTIL_BCN_BC5_UNORM ||
+         job->format == UTIL_BCN_BC5_SNORM ? 2 : 1;
+
+      for (unsigned ch = 0; ch < num_channels; ch++) {
+         for (unsigned i = 0; i < 16; i++)
+            v[i] = is_signed ? (int8_t) px[i][ch] : px[i][ch];
+         bc4_encode(dst + 8 * ch, v, is_signed, quality);
+      }
+      break;
+   }
+   case UTIL_BCN_BC7:
+      bc7_encode(dst, px, quality);
+      break;
+   default:
+      unreachable("not an 8-bit format");
+   }
+}
+
+static void
+compress_rows(void *data, unsigned by1, unsigned by2)
+{
+   const struct bcn_compress_job *job = data;
+   const unsigned block_bytes = util_bcn_block_bytes(job->format);
+   const unsigned blocks_x = DIV_ROUND_UP(job->width, 4);
+
+   for (unsigned by = by1; by < by2; by++) {
+      uint8_t *dst = job->dst + by * job->dst_stride;
+
+      for (unsigned bx = 0; bx < blocks_x; bx++)
+         compress_block(job, bx, by, dst + bx * block_bytes);
+   }
+}
+
+void
+util_bcn_compress(enum util_bcn_format format, enum util_bcn_quality quality,
+                  unsigned width, unsigned height,
+                  const void *src, unsigned src_comps, ptrdiff_t src_stride,
+                  uint8_t *dst, ptrdiff_t dst_stride)
+{
+   const unsigned blocks_x = DIV_ROUND_UP(width, 4);
+   const ptrdiff_t row_bytes = blocks_x * util_bcn_block_bytes(format);
+   struct bcn_compress_job job = {
+      .format = format,
+      .quality = quality,
+      .width = width,
+      .height = height,
+      .src = src,
+      .src_comps = src_comps,
+      .src_stride = src_stride,
+      .dst = dst,
+      .dst_stride = MAX2(dst_stride, row_bytes),
+   };
+
+   if (width == 0 || height == 0)
+      return;
+
+   call_once(&bcn_once, bcn_init);
+
+   util_parallel_rows(util_parallel_queue(), DIV_ROUND_UP(height, 4), 1,
+                      (size_t) blocks_x * BCN_BLOCK_COST, compress_rows, &job);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Encoder for the BC1-BC7 block compressed formats (S3TC, RGTC and BPTC),
+ * used when an application hands uncompressed images to a compressed
+ * internal format.
+ */
+
+#ifndef TEXCOMPRESS_BCN_H
+#define TEXCOMPRESS_BCN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum util_bcn_format {
+   UTIL_BCN_BC1_RGB,    /**< DXT1 without alpha */
+   UTIL_BCN_BC1_RGBA,   /**< DXT1 with 1-bit alpha */
+   UTIL_BCN_BC2,        /**< DXT3 */
+   UTIL_BCN_BC3,        /**< DXT5 */
+   UTIL_BCN_BC4_UNORM,  /**< RGTC1 */
+   UTIL_BCN_BC4_SNORM,
+   UTIL_BCN_BC5_UNORM,  /**< RGTC2 */
+   UTIL_BCN_BC5_SNORM,
+   UTIL_BCN_BC6H_UFLOAT,
+   UTIL_BCN_BC6H_SFLOAT,
+   UTIL_BCN_BC7,
+};
+
+/**
+ * How hard the encoder looks for good endpoints.  Each level costs very
+ * roughly twice the time of the previous one.
+ */
+enum util_bcn_quality {
+   UTIL_BCN_QUALITY_FAST,
+   UTIL_BCN_QUALITY_NORMAL,
+   UTIL_BCN_QUALITY_HIGH,
+};
+
+/**
+ * Returns the quality set with MESA_BCN_QUALITY (0 to 2), NORMAL by default.
+ */
+enum util_bcn_quality
+util_bcn_default_quality(void);
+
+/** Returns the size in bytes of one 4x4 block of the format. */
+static inline unsigned
+util_bcn_block_bytes(enum util_bcn_format format)
+{
+   switch (format) {
+   case UTIL_BCN_BC1_RGB:
+   case UTIL_BCN_BC1_RGBA:
+   case UTIL_BCN_BC4_UNORM:
+   case UTIL_BCN_BC4_SNORM:
+      return 8;
+   default:
+      return 16;
+   }
+}
+
+/**
+ * Compresses a width x height image.
+ *
+ * The source has src_comps components per pixel of type uint8_t for the
+ * UNORM formats, int8_t for the SNORM formats and float for BC6H.  BC1 to
+ * BC3 and BC7 read RGBA, missing alpha being opaque, BC4 reads the first
+ * component, BC5 the first two and BC6H RGB.  Blocks crossing the right or
+ * bottom edge of the image are filled by repeating the last column or row.
+ *
+ * dst_stride is the distance between rows of blocks, and is taken to be the
+ * size of a row of blocks if smaller than that.
+ *
+ * Rows of blocks are compressed in parallel on util_parallel_queue().
+ */
+void
+util_bcn_compress(enum util_bcn_format format, enum util_bcn_quality quality,
+                  unsigned width, unsigned height,
+                  const void *src, unsigned src_comps, ptrdiff_t src_stride,
+                  uint8_t *dst, ptrdiff_t dst_stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEXCOMPRESS_BCN_H */
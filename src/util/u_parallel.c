@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "u_parallel.h"
+
+#include "util/debug.h"
+#include "util/macros.h"
+#include "util/u_queue.h"
+
+static struct util_queue parallel_queue;
+static once_flag parallel_queue_once = ONCE_FLAG_INIT;
+
+static void
+parallel_queue_init(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+   long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+   long num_cpus = 1;
+#endif
+   /* The calling thread takes a band as well, so leave it a core. */
+   unsigned num_threads =
+      env_var_as_unsigned("MESA_PIXEL_THREADS",
+                          num_cpus > 1 ? MIN2(num_cpus - 1, 15) : 0);
+
+   num_threads = MIN2(num_threads, UTIL_PARALLEL_MAX_JOBS - 1);
+   if (num_threads == 0)
+      return;
+
+   /* Several contexts may split work at the same time. */
+   util_queue_init(&parallel_queue, "pixel", UTIL_PARALLEL_MAX_JOBS,
+                   num_threads, UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+}
+
+struct util_queue *
+util_parallel_queue(void)
+{
+   call_once(&parallel_queue_once, parallel_queue_init);
+
+   return util_queue_is_initialized(&parallel_queue) ? &parallel_queue : NULL;
+}
+
+struct parallel_rows_job {
+   struct util_queue_fence fence;
+   util_parallel_rows_func func;
+   void *data;
+   unsigned y1, y2;
+};
+
+static void
+parallel_rows_run_job(void *data, int thread_index)
+{
+   const struct parallel_rows_job *job = data;
+
+   job->func(job->data, job->y1, job->y2);
+}
+
+static bool
+is_queue_thread(const struct util_queue *queue)
+{
+   const thrd_t self = thrd_current();
+
+   for (unsigned i = 0; i < queue->num_threads; i++) {
+      if (thrd_equal(queue->threads[i], self))
+         return true;
+   }
+
+   return false;
+}
+
+void
+util_parallel_rows(struct util_queue *queue,
+                   unsigned height, unsigned row_align, size_t row_bytes,
+                   util_parallel_rows_func func, void *data)
+{
+   const unsigned align = MAX2(row_align, 1);
+   const unsigned num_units = DIV_ROUND_UP(height, align);
+   const uint64_t size = (uint64_t) row_bytes * height;
+   unsigned num_jobs = 1;
+
+   if (queue && size >= 2 * UTIL_PARALLEL_MIN_JOB_BYTES) {
+      num_jobs = MIN3(queue->num_threads + 1, num_units,
+                      size / UTIL_PARALLEL_MIN_JOB_BYTES);
+      num_jobs = MIN2(num_jobs, UTIL_PARALLEL_MAX_JOBS);
+
+      /* Waiting on jobs from a thread of the queue could deadlock. */
+      if (num_jobs > 1 && is_queue_thread(queue))
+         num_jobs = 1;
+   }
+
+   if (num_jobs <= 1) {
+      if (height > 0)
+         func(data, 0, height);
+      return;
+   }
+
+   struct parallel_rows_job jobs[UTIL_PARALLEL_MAX_JOBS];
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      jobs[i].func = func;
+      jobs[i].data = data;
+      jobs[i].y1 = (uint64_t) num_units * i / num_jobs * align;
+      jobs[i].y2 = i == num_jobs - 1 ? height :
+         (uint64_t) num_units * (i + 1) / num_jobs * align;
+
+      if (i > 0) {
+         util_queue_fence_init(&jobs[i].fence);
+         util_queue_add_job(queue, &jobs[i], &jobs[i].fence,
+                            parallel_rows_run_job, NULL);
+      }
+   }
+
+   parallel_rows_run_job(&jobs[0], 0);
+
+   for (unsigned i = 1; i < num_jobs; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
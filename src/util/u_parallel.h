@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Splitting of row-based CPU work, such as pixel format conversions, between
+ * the calling thread and a pool of worker threads.
+ */
+
+#ifndef U_PARALLEL_H
+#define U_PARALLEL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct util_queue;
+
+/**
+ * Work below this many bytes is never split, waking up a thread costs more
+ * than converting it.
+ */
+#define UTIL_PARALLEL_MIN_JOB_BYTES (256 * 1024)
+
+/** Upper bound on the number of bands a call is split into. */
+#define UTIL_PARALLEL_MAX_JOBS 32
+
+/** Processes the rows [y1, y2). */
+typedef void (*util_parallel_rows_func)(void *data, unsigned y1, unsigned y2);
+
+/**
+ * Returns the worker pool shared by the whole process, created on first use.
+ *
+ * The number of worker threads defaults to the number of cores minus one, at
+ * most 15, and can be set with MESA_PIXEL_THREADS.  Returns NULL if that is
+ * zero.
+ */
+struct util_queue *
+util_parallel_queue(void);
+
+/**
+ * Calls func over all rows [0, height), split in bands of whole multiples of
+ * row_align rows between the calling thread and the threads of the queue.
+ * Each band gets at least UTIL_PARALLEL_MIN_JOB_BYTES of work, counted as
+ * row_bytes per row.  Returns once all rows are done.
+ *
+ * Everything runs on the calling thread if the queue is NULL, if the work is
+ * too small or if the caller is one of the threads of the queue.
+ */
+void
+util_parallel_rows(struct util_queue *queue,
+                   unsigned height, unsigned row_align, size_t row_bytes,
+                   util_parallel_rows_func func, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_PARALLEL_H */
@@ -0,0 +1,215 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "half_float.h"
+#include "macros.h"
+#include "os_time.h"
+#include "u_atomic.h"
+#include "u_parallel.h"
+#include "u_queue.h"
+
+/* Every row is processed exactly once, by bands aligned as asked */
+
+struct coverage {
+   struct util_queue *queue;
+   unsigned row_align;
+   unsigned *count;
+   unsigned num_bands;
+};
+
+static void
+count_rows(void *data, unsigned y1, unsigned y2)
+{
+   p_atomic_add((unsigned *) data, y2 - y1);
+}
+
+static void
+coverage_rows(void *data, unsigned y1, unsigned y2)
+{
+   struct coverage *c = data;
+
+   assert(y1 < y2);
+   assert(y1 % c->row_align == 0);
+
+   for (unsigned y = y1; y < y2; y++)
+      p_atomic_inc(&c->count[y]);
+
+   p_atomic_inc(&c->num_bands);
+
+   /* Splitting again from a thread of the queue must not deadlock. */
+   if (y1 > 0) {
+      unsigned nested = 0;
+      util_parallel_rows(c->queue, 64, 1, UTIL_PARALLEL_MIN_JOB_BYTES,
+                         count_rows, &nested);
+      assert(nested == 64);
+   }
+}
+
+static void
+test_coverage(struct util_queue *queue)
+{
+   static const unsigned heights[] = { 0, 1, 3, 64, 1000, 4097 };
+   static const unsigned aligns[] = { 1, 4, 32 };
+
+   for (unsigned h = 0; h < ARRAY_SIZE(heights); h++) {
+      for (unsigned a = 0; a < ARRAY_SIZE(aligns); a++) {
+         const unsigned height = heights[h];
+         struct coverage c = {
+            .queue = queue,
+            .row_align = aligns[a],
+            .count = calloc(height + 1, sizeof(unsigned)),
+         };
+
+         util_parallel_rows(queue, height, aligns[a],
+                            UTIL_PARALLEL_MIN_JOB_BYTES, coverage_rows, &c);
+
+         for (unsigned y = 0; y < height; y++)
+            assert(c.count[y] == 1);
+
+         if (!queue || height == 0)
+            assert(c.num_bands <= 1);
+         else
+            assert(c.num_bands <= MIN2(queue->num_threads + 1,
+                                       DIV_ROUND_UP(height, aligns[a])));
+
+         free(c.count);
+      }
+   }
+
+   /* Small work stays on the calling thread. */
+   struct coverage c = {
+      .queue = queue,
+      .row_align = 1,
+      .count = calloc(1000, sizeof(unsigned)),
+   };
+   util_parallel_rows(queue, 1000, 1, 64, coverage_rows, &c);
+   assert(c.num_bands == 1);
+   free(c.count);
+}
+
+/* Throughput of an RGBA float to half float conversion */
+
+#define BENCH_WIDTH  2048
+#define BENCH_HEIGHT 2048
+
+struct convert {
+   const float *src;
+   uint16_t *dst;
+};
+
+static void
+convert_rows(void *data, unsigned y1, unsigned y2)
+{
+   const struct convert *c = data;
+   const size_t start = (size_t) y1 * BENCH_WIDTH * 4;
+   const size_t end = (size_t) y2 * BENCH_WIDTH * 4;
+
+   for (size_t i = start; i < end; i++)
+      c->dst[i] = _mesa_float_to_half(c->src[i]);
+}
+
+/* Checks that the conversion gives the same result with any number of
+ * threads, and prints how fast it is when bench is set.
+ */
+static void
+test_scaling(bool bench)
+{
+   static const unsigned num_threads[] = { 0, 1, 3, 7, 15 };
+   const size_t count = (size_t) BENCH_WIDTH * BENCH_HEIGHT * 4;
+   struct convert c = {
+      .src = malloc(count * sizeof(float)),
+      .dst = malloc(count * sizeof(uint16_t)),
+   };
+   uint16_t *ref = malloc(count * sizeof(uint16_t));
+   float *src = (float *) c.src;
+
+   assert(src && c.dst && ref);
+
+   for (size_t i = 0; i < count; i++)
+      src[i] = (float) (rand() - RAND_MAX / 2) / (RAND_MAX / 64);
+
+   for (unsigned t = 0; t < ARRAY_SIZE(num_threads); t++) {
+      struct util_queue queue;
+      struct util_queue *q = NULL;
+
+      if (num_threads[t]) {
+         bool ok = util_queue_init(&queue, "test", 16, num_threads[t], 0);
+         assert(ok);
+         q = &queue;
+      }
+
+      int64_t best = INT64_MAX;
+      for (unsigned i = 0; i < (bench ? 3 : 1); i++) {
+         int64_t start = os_time_get_nano();
+         util_parallel_rows(q, BENCH_HEIGHT, 1, BENCH_WIDTH * 4 * sizeof(float),
+                            convert_rows, &c);
+         best = MIN2(best, os_time_get_nano() - start);
+      }
+
+      if (t == 0)
+         memcpy(ref, c.dst, count * sizeof(uint16_t));
+      else
+         assert(memcmp(ref, c.dst, count * sizeof(uint16_t)) == 0);
+
+      if (bench) {
+         printf("%ux%u RGBA float to half, %2u queue threads: "
+                "%6.1f Mpixels/s\n", BENCH_WIDTH, BENCH_HEIGHT, num_threads[t],
+                BENCH_WIDTH * BENCH_HEIGHT / (best / 1000.0));
+      }
+
+      if (q)
+         util_queue_destroy(q);
+   }
+
+   free(src);
+   free(c.dst);
+   free(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct util_queue queue;
+   bool ok;
+
+   test_coverage(NULL);
+
+   ok = util_queue_init(&queue, "test", 16, 3, 0);
+   assert(ok);
+   test_coverage(&queue);
+   util_queue_destroy(&queue);
+
+   test_coverage(util_parallel_queue());
+
+   test_scaling(getenv("TEST_BENCH") != NULL);
+
+   return 0;
+}
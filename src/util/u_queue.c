@@ -247,9 +247,10 @@ util_queue_thread_func(void *input)
 
    while (1) {
       struct util_queue_job job;
+      struct util_queue_ring *ring;
 
       mtx_lock(&queue->lock);
-      assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+      assert(queue->num_queued >= 0);
 
       /* wait if the queue is empty */
       while (!queue->kill_threads && queue->num_queued == 0)
@@ -260,12 +261,19 @@ util_queue_thread_func(void *input)
          break;
       }
 
-      job = queue->jobs[queue->read_idx];
-      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
-      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
+      /* take the oldest job of the highest priority */
+      ring = &queue->rings[0];
+      while (ring->num_queued == 0)
+         ring++;
 
+      job = ring->jobs[ring->read_idx];
+      memset(&ring->jobs[ring->read_idx], 0, sizeof(struct util_queue_job));
+      ring->read_idx = (ring->read_idx + 1) % ring->max_jobs;
+
+      ring->num_queued--;
       queue->num_queued--;
-      cnd_signal(&queue->has_space_cond);
+      /* Producers may be waiting for space in different rings. */
+      cnd_broadcast(&queue->has_space_cond);
       mtx_unlock(&queue->lock);
 
       if (job.job) {
@@ -278,14 +286,19 @@ util_queue_thread_func(void *input)
 
    /* signal remaining jobs before terminating */
    mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].job) {
-         util_queue_fence_signal(queue->jobs[i].fence);
-         queue->jobs[i].job = NULL;
+   for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES; p++) {
+      struct util_queue_ring *ring = &queue->rings[p];
+
+      for (unsigned i = ring->read_idx; i != ring->write_idx;
+           i = (i + 1) % ring->max_jobs) {
+         if (ring->jobs[i].job) {
+            util_queue_fence_signal(ring->jobs[i].fence);
+            ring->jobs[i].job = NULL;
+         }
       }
+      ring->read_idx = ring->write_idx;
+      ring->num_queued = 0;
    }
-   queue->read_idx = queue->write_idx;
    queue->num_queued = 0;
    mtx_unlock(&queue->lock);
    return 0;
@@ -330,12 +343,17 @@ util_queue_init(struct util_queue *queue,
 
    queue->flags = flags;
    queue->num_threads = num_threads;
-   queue->max_jobs = max_jobs;
 
-   queue->jobs = (struct util_queue_job*)
-                 calloc(max_jobs, sizeof(struct util_queue_job));
-   if (!queue->jobs)
-      goto fail;
+   /* Most queues only ever get jobs of the normal priority, the rings of the
+    * other priorities are allocated when first used.
+    */
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      queue->rings[i].max_jobs = max_jobs;
+
+   queue->rings[UTIL_QUEUE_PRIORITY_NORMAL].jobs = (struct util_queue_job*)
+      calloc(max_jobs, sizeof(struct util_queue_job));
+   if (!queue->rings[UTIL_QUEUE_PRIORITY_NORMAL].jobs)
+      goto fail_jobs;
 
    (void) mtx_init(&queue->lock, mtx_plain);
    (void) mtx_init(&queue->finish_lock, mtx_plain);
@@ -391,12 +409,15 @@ util_queue_init(struct util_queue *queue,
 fail:
    free(queue->threads);
 
-   if (queue->jobs) {
-      cnd_destroy(&queue->has_space_cond);
-      cnd_destroy(&queue->has_queued_cond);
-      mtx_destroy(&queue->lock);
-      free(queue->jobs);
-   }
+   cnd_destroy(&queue->has_space_cond);
+   cnd_destroy(&queue->has_queued_cond);
+   mtx_destroy(&queue->finish_lock);
+   mtx_destroy(&queue->lock);
+
+fail_jobs:
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].jobs);
+
    /* also util_queue_is_initialized can be used to check for success */
    memset(queue, 0, sizeof(*queue));
    return false;
@@ -428,7 +449,8 @@ util_queue_destroy(struct util_queue *queue)
    cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
    mtx_destroy(&queue->lock);
-   free(queue->jobs);
+   for (unsigned i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].jobs);
    free(queue->threads);
 }
 
@@ -439,8 +461,23 @@ util_queue_add_job(struct util_queue *queue,
                    util_queue_execute_func execute,
                    util_queue_execute_func cleanup)
 {
+   util_queue_add_job_with_priority(queue, job, fence, execute, cleanup,
+                                    UTIL_QUEUE_PRIORITY_NORMAL);
+}
+
+void
+util_queue_add_job_with_priority(struct util_queue *queue,
+                                 void *job,
+                                 struct util_queue_fence *fence,
+                                 util_queue_execute_func execute,
+                                 util_queue_execute_func cleanup,
+                                 enum util_queue_priority priority)
+{
+   struct util_queue_ring *ring = &queue->rings[priority];
    struct util_queue_job *ptr;
 
+   assert(priority < UTIL_QUEUE_NUM_PRIORITIES);
+
    mtx_lock(&queue->lock);
    if (queue->kill_threads) {
       mtx_unlock(&queue->lock);
@@ -452,14 +489,22 @@ util_queue_add_job(struct util_queue *queue,
 
    util_queue_fence_reset(fence);
 
-   assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
+   if (!ring->jobs) {
+      ring->jobs = (struct util_queue_job*)
+                   calloc(ring->max_jobs, sizeof(struct util_queue_job));
+      /* Still better than not running the job at all. */
+      if (!ring->jobs)
+         ring = &queue->rings[UTIL_QUEUE_PRIORITY_NORMAL];
+   }
 
-   if (queue->num_queued == queue->max_jobs) {
+   assert(ring->num_queued >= 0 && ring->num_queued <= ring->max_jobs);
+
+   if (ring->num_queued == ring->max_jobs) {
       if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
          /* If the queue is full, make it larger to avoid waiting for a free
           * slot.
           */
-         unsigned new_max_jobs = queue->max_jobs + 8;
+         unsigned new_max_jobs = ring->max_jobs + 8;
          struct util_queue_job *jobs =
             (struct util_queue_job*)calloc(new_max_jobs,
                                            sizeof(struct util_queue_job));
@@ -467,35 +512,36 @@ util_queue_add_job(struct util_queue *queue,
 
          /* Copy all queued jobs into the new list. */
          unsigned num_jobs = 0;
-         unsigned i = queue->read_idx;
+         unsigned i = ring->read_idx;
 
          do {
-            jobs[num_jobs++] = queue->jobs[i];
-            i = (i + 1) % queue->max_jobs;
-         } while (i != queue->write_idx);
+            jobs[num_jobs++] = ring->jobs[i];
+            i = (i + 1) % ring->max_jobs;
+         } while (i != ring->write_idx);
 
-         assert(num_jobs == queue->num_queued);
+         assert(num_jobs == ring->num_queued);
 
-         free(queue->jobs);
-         queue->jobs = jobs;
-         queue->read_idx = 0;
-         queue->write_idx = num_jobs;
-         queue->max_jobs = new_max_jobs;
+         free(ring->jobs);
+         ring->jobs = jobs;
+         ring->read_idx = 0;
+         ring->write_idx = num_jobs;
+         ring->max_jobs = new_max_jobs;
       } else {
          /* Wait until there is a free slot. */
-         while (queue->num_queued == queue->max_jobs)
+         while (ring->num_queued == ring->max_jobs)
             cnd_wait(&queue->has_space_cond, &queue->lock);
       }
    }
 
-   ptr = &queue->jobs[queue->write_idx];
+   ptr = &ring->jobs[ring->write_idx];
    assert(ptr->job == NULL);
    ptr->job = job;
    ptr->fence = fence;
    ptr->execute = execute;
    ptr->cleanup = cleanup;
-   queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
+   ring->write_idx = (ring->write_idx + 1) % ring->max_jobs;
 
+   ring->num_queued++;
    queue->num_queued++;
    cnd_signal(&queue->has_queued_cond);
    mtx_unlock(&queue->lock);
@@ -520,16 +566,20 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
       return;
 
    mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].fence == fence) {
-         if (queue->jobs[i].cleanup)
-            queue->jobs[i].cleanup(queue->jobs[i].job, -1);
-
-         /* Just clear it. The threads will treat as a no-op job. */
-         memset(&queue->jobs[i], 0, sizeof(queue->jobs[i]));
-         removed = true;
-         break;
+   for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES && !removed; p++) {
+      struct util_queue_ring *ring = &queue->rings[p];
+
+      for (unsigned i = ring->read_idx; i != ring->write_idx;
+           i = (i + 1) % ring->max_jobs) {
+         if (ring->jobs[i].fence == fence) {
+            if (ring->jobs[i].cleanup)
+               ring->jobs[i].cleanup(ring->jobs[i].job, -1);
+
+            /* Just clear it. The threads will treat as a no-op job. */
+            memset(&ring->jobs[i], 0, sizeof(ring->jobs[i]));
+            removed = true;
+            break;
+         }
       }
    }
    mtx_unlock(&queue->lock);
@@ -564,9 +614,14 @@ util_queue_finish(struct util_queue *queue)
     */
    mtx_lock(&queue->finish_lock);
 
+   /* The barrier jobs use the lowest priority, so that they can only start
+    * once all previously added jobs of every priority have started.
+    */
    for (unsigned i = 0; i < queue->num_threads; ++i) {
       util_queue_fence_init(&fences[i]);
-      util_queue_add_job(queue, &barrier, &fences[i], util_queue_finish_execute, NULL);
+      util_queue_add_job_with_priority(queue, &barrier, &fences[i],
+                                       util_queue_finish_execute, NULL,
+                                       UTIL_QUEUE_PRIORITY_LOW);
    }
 
    for (unsigned i = 0; i < queue->num_threads; ++i) {
@@ -190,6 +190,16 @@ util_queue_fence_wait_timeout(struct util_queue_fence *fence,
 
 typedef void (*util_queue_execute_func)(void *job, int thread_index);
 
+/* Jobs of a higher priority are always started before queued jobs of a lower
+ * priority. Jobs of the same priority are started in FIFO order.
+ */
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_HIGH,   /* e.g. results needed by the next draw */
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   UTIL_QUEUE_PRIORITY_LOW,    /* e.g. speculative work */
+   UTIL_QUEUE_NUM_PRIORITIES,
+};
+
 struct util_queue_job {
    void *job;
    struct util_queue_fence *fence;
@@ -197,6 +207,14 @@ struct util_queue_job {
    util_queue_execute_func cleanup;
 };
 
+/* Ring buffer of the jobs of one priority. */
+struct util_queue_ring {
+   int num_queued;
+   int max_jobs;
+   int write_idx, read_idx; /* ring buffer pointers */
+   struct util_queue_job *jobs;
+};
+
 /* Put this into your context. */
 struct util_queue {
    char name[14]; /* 13 characters = the thread name without the index */
@@ -206,12 +224,10 @@ struct util_queue {
    cnd_t has_space_cond;
    thrd_t *threads;
    unsigned flags;
-   int num_queued;
+   int num_queued; /* in all rings */
    unsigned num_threads;
    int kill_threads;
-   int max_jobs;
-   int write_idx, read_idx; /* ring buffer pointers */
-   struct util_queue_job *jobs;
+   struct util_queue_ring rings[UTIL_QUEUE_NUM_PRIORITIES];
 
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
@@ -230,6 +246,12 @@ void util_queue_add_job(struct util_queue *queue,
                         struct util_queue_fence *fence,
                         util_queue_execute_func execute,
                         util_queue_execute_func cleanup);
+void util_queue_add_job_with_priority(struct util_queue *queue,
+                                      void *job,
+                                      struct util_queue_fence *fence,
+                                      util_queue_execute_func execute,
+                                      util_queue_execute_func cleanup,
+                                      enum util_queue_priority priority);
 void util_queue_drop_job(struct util_queue *queue,
                          struct util_queue_fence *fence);
 
@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2018 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "u_queue.h"
+
+/* Job priorities */
+
+struct order_job {
+   struct util_queue_fence fence;
+   unsigned id;
+   unsigned *order;
+   unsigned *num_done;
+};
+
+static void
+order_job_execute(void *data, int thread_index)
+{
+   struct order_job *job = data;
+
+   job->order[(*job->num_done)++] = job->id;
+}
+
+struct gate_job {
+   struct util_queue_fence fence;
+   struct util_queue_fence started;
+   struct util_queue_fence gate;
+};
+
+static void
+gate_job_execute(void *data, int thread_index)
+{
+   struct gate_job *job = data;
+
+   util_queue_fence_signal(&job->started);
+   util_queue_fence_wait(&job->gate);
+}
+
+static void
+test_priorities(void)
+{
+   static const enum util_queue_priority priorities[] = {
+      UTIL_QUEUE_PRIORITY_LOW,
+      UTIL_QUEUE_PRIORITY_NORMAL,
+      UTIL_QUEUE_PRIORITY_HIGH,
+      UTIL_QUEUE_PRIORITY_LOW,
+      UTIL_QUEUE_PRIORITY_HIGH,
+      UTIL_QUEUE_PRIORITY_NORMAL,
+   };
+   static const unsigned expected[] = { 2, 4, 1, 5, 0, 3 };
+   struct order_job jobs[ARRAY_SIZE(priorities)];
+   unsigned order[ARRAY_SIZE(priorities)];
+   unsigned num_done = 0;
+   struct gate_job gate;
+   struct util_queue queue;
+   bool ok;
+
+   ok = util_queue_init(&queue, "test", 2, 1, 0);
+   assert(ok);
+
+   /* Only the rings which get used are allocated. */
+   assert(!queue.rings[UTIL_QUEUE_PRIORITY_HIGH].jobs);
+   assert(!queue.rings[UTIL_QUEUE_PRIORITY_LOW].jobs);
+
+   /* Keep the only thread busy until all jobs are queued. */
+   util_queue_fence_init(&gate.fence);
+   util_queue_fence_init(&gate.started);
+   util_queue_fence_reset(&gate.started);
+   util_queue_fence_init(&gate.gate);
+   util_queue_fence_reset(&gate.gate);
+   util_queue_add_job(&queue, &gate, &gate.fence, gate_job_execute, NULL);
+   util_queue_fence_wait(&gate.started);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(priorities); i++) {
+      jobs[i].id = i;
+      jobs[i].order = order;
+      jobs[i].num_done = &num_done;
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job_with_priority(&queue, &jobs[i], &jobs[i].fence,
+                                       order_job_execute, NULL,
+                                       priorities[i]);
+   }
+
+   assert(queue.rings[UTIL_QUEUE_PRIORITY_HIGH].jobs);
+   assert(queue.rings[UTIL_QUEUE_PRIORITY_LOW].jobs);
+
+   util_queue_fence_signal(&gate.gate);
+   util_queue_finish(&queue);
+
+   assert(num_done == ARRAY_SIZE(expected));
+   for (unsigned i = 0; i < ARRAY_SIZE(expected); i++) {
+      assert(util_queue_fence_is_signalled(&jobs[i].fence));
+      assert(order[i] == expected[i]);
+   }
+
+   util_queue_destroy(&queue);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(priorities); i++)
+      util_queue_fence_destroy(&jobs[i].fence);
+   util_queue_fence_destroy(&gate.fence);
+   util_queue_fence_destroy(&gate.started);
+   util_queue_fence_destroy(&gate.gate);
+}
+
+/* Contention with many small jobs from several producers, the throughput
+ * is only printed when TEST_BENCH is set.
+ */
+
+#define NUM_PRODUCERS   4
+#define JOBS_PER_PRODUCER 20000
+
+struct producer {
+   struct util_queue *queue;
+   struct util_queue_fence *fences;
+   unsigned *counter;
+};
+
+static void
+count_job_execute(void *data, int thread_index)
+{
+   p_atomic_inc((unsigned *)data);
+}
+
+static int
+producer_func(void *data)
+{
+   struct producer *p = data;
+
+   for (unsigned i = 0; i < JOBS_PER_PRODUCER; i++) {
+      util_queue_fence_init(&p->fences[i]);
+      util_queue_add_job_with_priority(p->queue, p->counter, &p->fences[i],
+                                       count_job_execute, NULL,
+                                       i % UTIL_QUEUE_NUM_PRIORITIES);
+   }
+
+   for (unsigned i = 0; i < JOBS_PER_PRODUCER; i++) {
+      util_queue_fence_wait(&p->fences[i]);
+      util_queue_fence_destroy(&p->fences[i]);
+   }
+
+   return 0;
+}
+
+static void
+test_contention(unsigned num_threads, bool bench)
+{
+   struct producer producers[NUM_PRODUCERS];
+   thrd_t threads[NUM_PRODUCERS];
+   struct util_queue queue;
+   unsigned counter = 0;
+   bool ok;
+
+   ok = util_queue_init(&queue, "test", 64, num_threads, 0);
+   assert(ok);
+
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < NUM_PRODUCERS; i++) {
+      producers[i].queue = &queue;
+      producers[i].counter = &counter;
+      producers[i].fences =
+         malloc(JOBS_PER_PRODUCER * sizeof(struct util_queue_fence));
+      assert(producers[i].fences);
+      threads[i] = u_thread_create(producer_func, &producers[i]);
+   }
+
+   for (unsigned i = 0; i < NUM_PRODUCERS; i++)
+      thrd_join(threads[i], NULL);
+
+   int64_t time = os_time_get_nano() - start;
+
+   assert(counter == NUM_PRODUCERS * JOBS_PER_PRODUCER);
+
+   if (bench) {
+      printf("%u producers, %u queue threads: %.0f jobs/s\n",
+             NUM_PRODUCERS, num_threads,
+             counter / (time / 1000000000.0));
+   }
+
+   util_queue_destroy(&queue);
+
+   for (unsigned i = 0; i < NUM_PRODUCERS; i++)
+      free(producers[i].fences);
+}
+
+int
+main(void)
+{
+   const bool bench = getenv("TEST_BENCH");
+
+   test_priorities();
+
+   test_contention(1, bench);
+   test_contention(4, bench);
+
+   return 0;
+}